@@ -0,0 +1,75 @@
+# Copyright (c) 2013-2019  Made to Order Software Corp.  All Rights Reserved
+#
+# https://snapwebsites.org/
+# contact@m2osw.com
+# 
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+#
+# - Try to find Brotli
+#
+# Once done this will define
+#
+# BROTLI_FOUND        - System has Brotli
+# BROTLI_INCLUDE_DIRS - The Brotli include directories
+# BROTLI_LIBRARIES    - The libraries needed to use Brotli
+# BROTLI_DEFINITIONS  - Compiler switches required for using Brotli (none)
+#
+
+find_path(
+    BROTLI_INCLUDE_DIR
+        brotli/encode.h
+
+    PATHS
+        $ENV{BROTLI_INCLUDE_DIR}
+)
+
+find_library(
+    BROTLI_ENCODER_LIBRARY
+        brotlienc
+
+    PATHS
+        $ENV{BROTLI_LIBRARY}
+)
+
+find_library(
+    BROTLI_DECODER_LIBRARY
+        brotlidec
+
+    PATHS
+        $ENV{BROTLI_LIBRARY}
+)
+
+mark_as_advanced(
+    BROTLI_INCLUDE_DIR
+    BROTLI_ENCODER_LIBRARY
+    BROTLI_DECODER_LIBRARY
+)
+
+set(BROTLI_INCLUDE_DIRS ${BROTLI_INCLUDE_DIR})
+set(BROTLI_LIBRARIES    ${BROTLI_ENCODER_LIBRARY} ${BROTLI_DECODER_LIBRARY})
+
+include(FindPackageHandleStandardArgs)
+
+# handle the QUIETLY and REQUIRED arguments and set BROTLI_FOUND to TRUE
+# if all listed variables are TRUE
+find_package_handle_standard_args(
+    Brotli
+    DEFAULT_MSG
+    BROTLI_INCLUDE_DIR
+    BROTLI_ENCODER_LIBRARY
+    BROTLI_DECODER_LIBRARY
+)
+
+# vim: ts=4 sw=4 et
@@ -0,0 +1,65 @@
+# Copyright (c) 2013-2019  Made to Order Software Corp.  All Rights Reserved
+#
+# https://snapwebsites.org/
+# contact@m2osw.com
+# 
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+#
+# - Try to find LZ4
+#
+# Once done this will define
+#
+# LZ4_FOUND        - System has LZ4
+# LZ4_INCLUDE_DIRS - The LZ4 include directories
+# LZ4_LIBRARIES    - The libraries needed to use LZ4
+# LZ4_DEFINITIONS  - Compiler switches required for using LZ4 (none)
+#
+
+find_path(
+    LZ4_INCLUDE_DIR
+        lz4.h
+
+    PATHS
+        $ENV{LZ4_INCLUDE_DIR}
+)
+
+find_library(
+    LZ4_LIBRARY
+        lz4
+
+    PATHS
+        $ENV{LZ4_LIBRARY}
+)
+
+mark_as_advanced(
+    LZ4_INCLUDE_DIR
+    LZ4_LIBRARY
+)
+
+set(LZ4_INCLUDE_DIRS ${LZ4_INCLUDE_DIR})
+set(LZ4_LIBRARIES    ${LZ4_LIBRARY}    )
+
+include(FindPackageHandleStandardArgs)
+
+# handle the QUIETLY and REQUIRED arguments and set LZ4_FOUND to TRUE
+# if all listed variables are TRUE
+find_package_handle_standard_args(
+    LZ4
+    DEFAULT_MSG
+    LZ4_INCLUDE_DIR
+    LZ4_LIBRARY
+)
+
+# vim: ts=4 sw=4 et
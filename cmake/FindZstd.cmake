@@ -0,0 +1,65 @@
+# Copyright (c) 2013-2019  Made to Order Software Corp.  All Rights Reserved
+#
+# https://snapwebsites.org/
+# contact@m2osw.com
+# 
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+#
+# - Try to find Zstd
+#
+# Once done this will define
+#
+# ZSTD_FOUND        - System has Zstd
+# ZSTD_INCLUDE_DIRS - The Zstd include directories
+# ZSTD_LIBRARIES    - The libraries needed to use Zstd
+# ZSTD_DEFINITIONS  - Compiler switches required for using Zstd (none)
+#
+
+find_path(
+    ZSTD_INCLUDE_DIR
+        zstd.h
+
+    PATHS
+        $ENV{ZSTD_INCLUDE_DIR}
+)
+
+find_library(
+    ZSTD_LIBRARY
+        zstd
+
+    PATHS
+        $ENV{ZSTD_LIBRARY}
+)
+
+mark_as_advanced(
+    ZSTD_INCLUDE_DIR
+    ZSTD_LIBRARY
+)
+
+set(ZSTD_INCLUDE_DIRS ${ZSTD_INCLUDE_DIR})
+set(ZSTD_LIBRARIES    ${ZSTD_LIBRARY}    )
+
+include(FindPackageHandleStandardArgs)
+
+# handle the QUIETLY and REQUIRED arguments and set ZSTD_FOUND to TRUE
+# if all listed variables are TRUE
+find_package_handle_standard_args(
+    Zstd
+    DEFAULT_MSG
+    ZSTD_INCLUDE_DIR
+    ZSTD_LIBRARY
+)
+
+# vim: ts=4 sw=4 et
@@ -0,0 +1,321 @@
+// Snap Websites Server -- brotli and zstd compressors
+// Copyright (c) 2019  Made to Order Software Corp.  All Rights Reserved
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+/** \file
+ * \brief Additional compressors: brotli and zstd.
+ *
+ * Modern browsers accept the "br" (brotli) and "zstd" encodings which
+ * both compress text better than gzip. The compressors defined here
+ * register themselves with the compression library the same way as
+ * the gzip and deflate compressors so compression::compress() and
+ * compression::decompress() can be used with the names "brotli" and
+ * "zstd".
+ *
+ * Note that the HTTP Content-Encoding name of brotli is "br".
+ */
+
+
+// self
+//
+#include "snapwebsites/compression.h"
+
+
+// libexcept lib
+//
+#include <libexcept/exception.h>
+
+
+// brotli lib
+//
+#include <brotli/decode.h>
+#include <brotli/encode.h>
+
+
+// zstd lib
+//
+#include <zstd.h>
+
+
+// last include
+//
+#include <snapdev/poison.h>
+
+
+
+
+namespace snap
+{
+namespace compression
+{
+
+
+namespace
+{
+
+
+DECLARE_MAIN_EXCEPTION(decompression_error);
+
+
+
+/** \brief Convert a snap compression level to a library level.
+ *
+ * Our levels go from 0 to 100. This function converts such a level
+ * to a library level between \p min and \p max inclusive.
+ *
+ * \param[in] level  The snap compression level.
+ * \param[in] min  The minimum library level.
+ * \param[in] max  The maximum library level.
+ *
+ * \return The library level.
+ */
+int library_level(level_t level, int min, int max)
+{
+    if(level < 0)
+    {
+        level = 0;
+    }
+    else if(level > 100)
+    {
+        level = 100;
+    }
+    return min + (level * (max - min) + 50) / 100;
+}
+
+
+class brotli_t
+    : public compressor_t
+{
+public:
+    brotli_t()
+        : compressor_t("brotli")
+    {
+    }
+
+    virtual char const * get_name() const
+    {
+        return "brotli";
+    }
+
+    virtual QByteArray compress(QByteArray const & input, level_t level, bool text)
+    {
+        QByteArray result;
+        size_t size(BrotliEncoderMaxCompressedSize(input.size()));
+        if(size == 0)
+        {
+            // input too large
+            //
+            return result;
+        }
+        result.resize(size);
+        if(!BrotliEncoderCompress(
+                  library_level(level, BROTLI_MIN_QUALITY, BROTLI_MAX_QUALITY)
+                , BROTLI_DEFAULT_WINDOW
+                , text ? BROTLI_MODE_TEXT : BROTLI_MODE_GENERIC
+                , input.size()
+                , reinterpret_cast<uint8_t const *>(input.data())
+                , &size
+                , reinterpret_cast<uint8_t *>(result.data())))
+        {
+            result.clear();
+            return result;
+        }
+        result.resize(size);
+        return result;
+    }
+
+    virtual bool compatible(QByteArray const & input) const
+    {
+        // brotli streams have no magic, so we cannot recognize them
+        //
+        static_cast<void>(input);
+        return false;
+    }
+
+    virtual QByteArray decompress(QByteArray const & input)
+    {
+        QByteArray result;
+
+        BrotliDecoderState * state(BrotliDecoderCreateInstance(nullptr, nullptr, nullptr));
+        if(state == nullptr)
+        {
+            throw decompression_error("could not allocate a brotli decoder.");
+        }
+
+        size_t available_in(input.size());
+        uint8_t const * next_in(reinterpret_cast<uint8_t const *>(input.data()));
+        uint8_t buf[64 * 1024];
+        BrotliDecoderResult r(BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT);
+        while(r == BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT)
+        {
+            size_t available_out(sizeof(buf));
+            uint8_t * next_out(buf);
+            r = BrotliDecoderDecompressStream(state, &available_in, &next_in, &available_out, &next_out, nullptr);
+            result.append(reinterpret_cast<char const *>(buf), sizeof(buf) - available_out);
+        }
+        BrotliDecoderDestroyInstance(state);
+
+        if(r != BROTLI_DECODER_RESULT_SUCCESS)
+        {
+            throw decompression_error("brotli data could not be decompressed.");
+        }
+
+        return result;
+    }
+
+    virtual QByteArray decompress(QByteArray const & input, size_t uncompressed_size)
+    {
+        QByteArray result;
+        result.resize(uncompressed_size);
+        size_t size(uncompressed_size);
+        if(BrotliDecoderDecompress(
+                  input.size()
+                , reinterpret_cast<uint8_t const *>(input.data())
+                , &size
+                , reinterpret_cast<uint8_t *>(result.data())) != BROTLI_DECODER_RESULT_SUCCESS
+        || size != uncompressed_size)
+        {
+            throw decompression_error("brotli data could not be decompressed to the expected size.");
+        }
+        return result;
+    }
+} g_brotli; // create statically
+
+
+class zstd_t
+    : public compressor_t
+{
+public:
+    zstd_t()
+        : compressor_t("zstd")
+    {
+    }
+
+    virtual char const * get_name() const
+    {
+        return "zstd";
+    }
+
+    virtual QByteArray compress(QByteArray const & input, level_t level, bool text)
+    {
+        static_cast<void>(text);
+
+        QByteArray result;
+        result.resize(ZSTD_compressBound(input.size()));
+        size_t const size(ZSTD_compress(
+                  result.data()
+                , result.size()
+                , input.data()
+                , input.size()
+                , library_level(level, 1, 19)));
+        if(ZSTD_isError(size))
+        {
+            result.clear();
+            return result;
+        }
+        result.resize(size);
+        return result;
+    }
+
+    virtual bool compatible(QByteArray const & input) const
+    {
+        // the zstd frame magic number is 0xFD2FB528 in little endian
+        //
+        return input.size() >= 4
+            && static_cast<unsigned char>(input[0]) == 0x28
+            && static_cast<unsigned char>(input[1]) == 0xB5
+            && static_cast<unsigned char>(input[2]) == 0x2F
+            && static_cast<unsigned char>(input[3]) == 0xFD;
+    }
+
+    virtual QByteArray decompress(QByteArray const & input)
+    {
+        unsigned long long const size(ZSTD_getFrameContentSize(input.data(), input.size()));
+        if(size != ZSTD_CONTENTSIZE_UNKNOWN
+        && size != ZSTD_CONTENTSIZE_ERROR)
+        {
+            return decompress(input, size);
+        }
+
+        // the size was not saved in the frame, use the streaming API
+        //
+        QByteArray result;
+        ZSTD_DStream * stream(ZSTD_createDStream());
+        if(stream == nullptr)
+        {
+            throw decompression_error("could not allocate a zstd decoder.");
+        }
+        ZSTD_initDStream(stream);
+
+        ZSTD_inBuffer in = { input.data(), static_cast<size_t>(input.size()), 0 };
+        char buf[64 * 1024];
+        size_t r(0);
+        for(;;)
+        {
+            ZSTD_outBuffer out = { buf, sizeof(buf), 0 };
+            r = ZSTD_decompressStream(stream, &out, &in);
+            if(ZSTD_isError(r))
+            {
+                break;
+            }
+            result.append(buf, out.pos);
+            if(in.pos >= in.size
+            && (r == 0 || out.pos == 0))
+            {
+                // done or the input is truncated (r != 0)
+                //
+                break;
+            }
+        }
+        ZSTD_freeDStream(stream);
+
+        if(ZSTD_isError(r)
+        || r != 0)
+        {
+            throw decompression_error("zstd data could not be decompressed.");
+        }
+
+        return result;
+    }
+
+    virtual QByteArray decompress(QByteArray const & input, size_t uncompressed_size)
+    {
+        QByteArray result;
+        result.resize(uncompressed_size);
+        size_t const size(ZSTD_decompress(
+                  result.data()
+                , result.size()
+                , input.data()
+                , input.size()));
+        if(ZSTD_isError(size)
+        || size != uncompressed_size)
+        {
+            throw decompression_error("zstd data could not be decompressed to the expected size.");
+        }
+        return result;
+    }
+} g_zstd; // create statically
+
+
+}
+// no name namespace
+
+
+
+} // namespace compression
+} // namespace snap
+// vim: ts=4 sw=4 et
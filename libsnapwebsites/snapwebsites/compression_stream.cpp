@@ -0,0 +1,355 @@
+// Snap Websites Server -- incremental compression
+// Copyright (c) 2019  Made to Order Software Corp.  All Rights Reserved
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+/** \file
+ * \brief Compress data one piece at a time.
+ *
+ * The compression::compress() function works on a complete buffer and
+ * returns a complete buffer. When sending a large page, this means the
+ * client receives nothing until the whole page was compressed and we
+ * hold the input and the output in memory at the same time.
+ *
+ * The compression_stream objects instead accept the data in pieces and
+ * return whatever compressed data is ready. That data can immediately
+ * be sent to the client.
+ *
+ * The streams use the same names as the compressors: "gzip", "deflate",
+ * "brotli", and "zstd".
+ */
+
+
+// self
+//
+#include "snapwebsites/compression_stream.h"
+
+
+// brotli lib
+//
+#include <brotli/encode.h>
+
+
+// zlib lib
+//
+#include <zlib.h>
+
+
+// zstd lib
+//
+#include <zstd.h>
+
+
+// last include
+//
+#include <snapdev/poison.h>
+
+
+
+
+namespace snap
+{
+
+
+namespace
+{
+
+
+/** \brief Size of the buffer used to retrieve the compressed data.
+ *
+ * The libraries write the compressed data in a buffer of this size.
+ * It gets appended to the result as many times as required.
+ */
+size_t const OUTPUT_BUFFER_SIZE = 16 * 1024;
+
+
+/** \brief Convert a snap compression level to a library level.
+ *
+ * \param[in] level  The snap compression level (0 to 100).
+ * \param[in] min  The minimum library level.
+ * \param[in] max  The maximum library level.
+ *
+ * \return The library level.
+ */
+int library_level(compression::level_t level, int min, int max)
+{
+    if(level < 0)
+    {
+        level = 0;
+    }
+    else if(level > 100)
+    {
+        level = 100;
+    }
+    return min + (level * (max - min) + 50) / 100;
+}
+
+
+class zlib_stream_t
+    : public compression_stream
+{
+public:
+    zlib_stream_t(bool gzip, compression::level_t level)
+    {
+        // a window of 15 bits generates a zlib stream, adding 16
+        // generates a gzip stream instead
+        //
+        if(deflateInit2(&f_stream
+                      , library_level(level, 1, 9)
+                      , Z_DEFLATED
+                      , 15 + (gzip ? 16 : 0)
+                      , 8
+                      , Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            throw compression_stream_error("could not initialize the zlib stream.");
+        }
+    }
+
+    virtual ~zlib_stream_t() override
+    {
+        deflateEnd(&f_stream);
+    }
+
+    virtual QByteArray compress(char const * data, size_t size) override
+    {
+        return run(data, size, Z_NO_FLUSH);
+    }
+
+    virtual QByteArray finish() override
+    {
+        return run(nullptr, 0, Z_FINISH);
+    }
+
+private:
+    QByteArray run(char const * data, size_t size, int flush)
+    {
+        QByteArray result;
+        f_stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+        f_stream.avail_in = size;
+        Bytef buf[OUTPUT_BUFFER_SIZE];
+        do
+        {
+            f_stream.next_out = buf;
+            f_stream.avail_out = sizeof(buf);
+            if(deflate(&f_stream, flush) == Z_STREAM_ERROR)
+            {
+                throw compression_stream_error("zlib stream could not compress the data.");
+            }
+            result.append(reinterpret_cast<char const *>(buf), sizeof(buf) - f_stream.avail_out);
+        }
+        while(f_stream.avail_out == 0);
+        return result;
+    }
+
+    z_stream            f_stream = z_stream();
+};
+
+
+class brotli_stream_t
+    : public compression_stream
+{
+public:
+    brotli_stream_t(compression::level_t level, bool text)
+        : f_state(BrotliEncoderCreateInstance(nullptr, nullptr, nullptr))
+    {
+        if(f_state == nullptr)
+        {
+            throw compression_stream_error("could not allocate a brotli encoder.");
+        }
+        BrotliEncoderSetParameter(f_state, BROTLI_PARAM_QUALITY, library_level(level, BROTLI_MIN_QUALITY, BROTLI_MAX_QUALITY));
+        BrotliEncoderSetParameter(f_state, BROTLI_PARAM_MODE, text ? BROTLI_MODE_TEXT : BROTLI_MODE_GENERIC);
+    }
+
+    virtual ~brotli_stream_t() override
+    {
+        BrotliEncoderDestroyInstance(f_state);
+    }
+
+    virtual QByteArray compress(char const * data, size_t size) override
+    {
+        return run(data, size, BROTLI_OPERATION_PROCESS);
+    }
+
+    virtual QByteArray finish() override
+    {
+        return run(nullptr, 0, BROTLI_OPERATION_FINISH);
+    }
+
+private:
+    QByteArray run(char const * data, size_t size, BrotliEncoderOperation operation)
+    {
+        QByteArray result;
+        size_t available_in(size);
+        uint8_t const * next_in(reinterpret_cast<uint8_t const *>(data));
+        uint8_t buf[OUTPUT_BUFFER_SIZE];
+        for(;;)
+        {
+            size_t available_out(sizeof(buf));
+            uint8_t * next_out(buf);
+            if(!BrotliEncoderCompressStream(f_state, operation, &available_in, &next_in, &available_out, &next_out, nullptr))
+            {
+                throw compression_stream_error("brotli stream could not compress the data.");
+            }
+            result.append(reinterpret_cast<char const *>(buf), sizeof(buf) - available_out);
+            if(available_in == 0
+            && !BrotliEncoderHasMoreOutput(f_state)
+            && (operation != BROTLI_OPERATION_FINISH || BrotliEncoderIsFinished(f_state)))
+            {
+                break;
+            }
+        }
+        return result;
+    }
+
+    BrotliEncoderState *    f_state = nullptr;
+};
+
+
+class zstd_stream_t
+    : public compression_stream
+{
+public:
+    zstd_stream_t(compression::level_t level)
+        : f_context(ZSTD_createCCtx())
+    {
+        if(f_context == nullptr)
+        {
+            throw compression_stream_error("could not allocate a zstd encoder.");
+        }
+        ZSTD_CCtx_setParameter(f_context, ZSTD_c_compressionLevel, library_level(level, 1, 19));
+    }
+
+    virtual ~zstd_stream_t() override
+    {
+        ZSTD_freeCCtx(f_context);
+    }
+
+    virtual QByteArray compress(char const * data, size_t size) override
+    {
+        return run(data, size, ZSTD_e_continue);
+    }
+
+    virtual QByteArray finish() override
+    {
+        return run(nullptr, 0, ZSTD_e_end);
+    }
+
+private:
+    QByteArray run(char const * data, size_t size, ZSTD_EndDirective directive)
+    {
+        QByteArray result;
+        ZSTD_inBuffer in = { data, size, 0 };
+        char buf[OUTPUT_BUFFER_SIZE];
+        for(;;)
+        {
+            ZSTD_outBuffer out = { buf, sizeof(buf), 0 };
+            size_t const remaining(ZSTD_compressStream2(f_context, &out, &in, directive));
+            if(ZSTD_isError(remaining))
+            {
+                throw compression_stream_error("zstd stream could not compress the data.");
+            }
+            result.append(buf, out.pos);
+            if(directive == ZSTD_e_end ? remaining == 0 : in.pos >= in.size)
+            {
+                break;
+            }
+        }
+        return result;
+    }
+
+    ZSTD_CCtx *         f_context = nullptr;
+};
+
+
+}
+// no name namespace
+
+
+
+/** \class compression_stream
+ * \brief Base class of the incremental compressors.
+ *
+ * Call compress() with each piece of data as it becomes available
+ * and send the returned bytes (which may be empty since the libraries
+ * buffer some of the data.) Once all the data was sent, call finish()
+ * to get the last bytes of the compressed stream.
+ *
+ * A stream cannot be reused once finish() was called.
+ */
+
+
+/** \brief Clean up the stream.
+ *
+ * The derived classes release their library resources.
+ */
+compression_stream::~compression_stream()
+{
+}
+
+
+/** \brief Check whether a stream exists for the named compressor.
+ *
+ * \param[in] name  The name of the compressor ("gzip", "deflate",
+ *                  "brotli", or "zstd").
+ *
+ * \return true if create() accepts \p name.
+ */
+bool compression_stream::is_supported(QString const & name)
+{
+    return name == "gzip"
+        || name == "deflate"
+        || name == "brotli"
+        || name == "zstd";
+}
+
+
+/** \brief Create a stream for the named compressor.
+ *
+ * \exception compression_stream_unknown_compressor
+ * The \p name must be one of the names accepted by is_supported().
+ *
+ * \exception compression_stream_error
+ * The library could not allocate its encoder.
+ *
+ * \param[in] name  The name of the compressor.
+ * \param[in] level  The compression level from 0 to 100.
+ * \param[in] text  Whether the data is text (only used by brotli).
+ *
+ * \return A pointer to the new stream.
+ */
+compression_stream::pointer_t compression_stream::create(QString const & name, compression::level_t level, bool text)
+{
+    if(name == "gzip"
+    || name == "deflate")
+    {
+        return std::make_shared<zlib_stream_t>(name == "gzip", level);
+    }
+    if(name == "brotli")
+    {
+        return std::make_shared<brotli_stream_t>(level, text);
+    }
+    if(name == "zstd")
+    {
+        return std::make_shared<zstd_stream_t>(level);
+    }
+
+    throw compression_stream_unknown_compressor(QString("no compression stream named \"%1\".").arg(name).toUtf8().data());
+}
+
+
+
+} // namespace snap
+// vim: ts=4 sw=4 et
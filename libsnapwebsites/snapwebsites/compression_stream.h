@@ -0,0 +1,66 @@
+// Snap Websites Server -- incremental compression
+// Copyright (c) 2019  Made to Order Software Corp.  All Rights Reserved
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+#pragma once
+
+// self
+//
+#include    "snapwebsites/compression.h"
+
+
+// libexcept lib
+//
+#include    <libexcept/exception.h>
+
+
+// Qt lib
+//
+#include    <QByteArray>
+
+
+// C++ lib
+//
+#include    <memory>
+
+
+namespace snap
+{
+
+DECLARE_MAIN_EXCEPTION(compression_stream_exception);
+
+DECLARE_EXCEPTION(compression_stream_exception, compression_stream_error);
+DECLARE_EXCEPTION(compression_stream_exception, compression_stream_unknown_compressor);
+
+
+
+class compression_stream
+{
+public:
+    typedef std::shared_ptr<compression_stream>     pointer_t;
+
+    virtual                     ~compression_stream();
+
+    static bool                 is_supported(QString const & name);
+    static pointer_t            create(QString const & name, compression::level_t level, bool text);
+
+    virtual QByteArray          compress(char const * data, size_t size) = 0;
+    virtual QByteArray          finish() = 0;
+};
+
+
+
+} // namespace snap
+// vim: ts=4 sw=4 et
@@ -0,0 +1,407 @@
+// Snap Websites Server -- batch database reads
+// Copyright (c) 2019  Made to Order Software Corp.  All Rights Reserved
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+/** \file
+ * \brief Read many cells with as few database accesses as possible.
+ *
+ * Plugins often read a handful of cells from the same row one after
+ * the other: exists(), then getCell()->getValue() on one cell, then
+ * on another. Each one of those calls is a round trip to snapdbproxy
+ * which, for a page, quickly adds up to dozens of network accesses.
+ *
+ * The db_prefetch object lets the caller first declare all the cells
+ * it is going to need and then read them at once. Requests are grouped
+ * per row and each row is read with a single cell range predicate.
+ * The values are then available through exists() and get_value().
+ *
+ * Since libdbproxy keeps the cells it last read in its row cache,
+ * code that later reads the same cells with getCell()->getValue()
+ * benefits from the prefetch too.
+ */
+
+
+// self
+//
+#include "snapwebsites/db_prefetch.h"
+
+
+// last include
+//
+#include <snapdev/poison.h>
+
+
+
+
+namespace snap
+{
+
+
+namespace
+{
+
+
+/** \brief Number of cells read per database access.
+ *
+ * A row range may include cells that the caller did not request. If the
+ * range has more cells than this, we read it in multiple pages.
+ */
+int const g_cells_per_page = 100;
+
+
+/** \brief Compute the key right after all the keys starting with a prefix.
+ *
+ * The range predicate end key is inclusive. Incrementing the last
+ * character of the prefix gives us a key which is larger than any
+ * key starting with \p prefix (i.e. "links::" becomes "links:;").
+ *
+ * \param[in] prefix  The prefix to transform.
+ *
+ * \return The end key of the prefix range.
+ */
+QString prefix_end(QString const & prefix)
+{
+    QString end(prefix);
+    if(!end.isEmpty())
+    {
+        end[end.length() - 1] = QChar(end[end.length() - 1].unicode() + 1);
+    }
+    return end;
+}
+
+
+}
+// no name namespace
+
+
+
+/** \brief Change the consistency level used to read the cells.
+ *
+ * By default the prefetch uses the default consistency level of the
+ * database connection. Cells that are expected to change often and
+ * must be seen by all the instances (such as the status of a page)
+ * should be read with QUORUM.
+ *
+ * Once a consistency level is defined, execute() always reads the rows
+ * from the database, even if the cells are already in the libdbproxy
+ * cache, since the cache may be older than what other instances wrote.
+ *
+ * \param[in] level  The consistency level to use with execute().
+ */
+void db_prefetch::set_consistency_level(libdbproxy::consistency_level_t level)
+{
+    f_consistency_level = level;
+    f_consistency_level_defined = true;
+}
+
+
+/** \brief Request a cell to be read.
+ *
+ * This function adds one cell to the list of cells to read from the
+ * database when execute() gets called.
+ *
+ * All the cells added against the same row are read together.
+ *
+ * \param[in] table  The table the row is defined in.
+ * \param[in] row_key  The key of the row to read.
+ * \param[in] cell_name  The name of the cell to read.
+ */
+void db_prefetch::add(libdbproxy::table::pointer_t table, QString const & row_key, QString const & cell_name)
+{
+    get_request(table, row_key).f_cell_names.insert(cell_name);
+    f_executed = false;
+}
+
+
+/** \brief Request all the cells starting with a prefix to be read.
+ *
+ * This function is used when you do not know the exact name of the
+ * cells you are going to need. For example, the current revision of
+ * a page is saved in one cell per locale.
+ *
+ * \param[in] table  The table the row is defined in.
+ * \param[in] row_key  The key of the row to read.
+ * \param[in] cell_prefix  The prefix of the cells to read.
+ */
+void db_prefetch::add_prefix(libdbproxy::table::pointer_t table, QString const & row_key, QString const & cell_prefix)
+{
+    get_request(table, row_key).f_cell_prefixes.insert(cell_prefix);
+    f_executed = false;
+}
+
+
+/** \brief Return the number of rows to be read.
+ *
+ * Each row will require at least one access to the database.
+ *
+ * \return The number of distinct rows added to this prefetch object.
+ */
+size_t db_prefetch::size() const
+{
+    return f_requests.size();
+}
+
+
+/** \brief Read all the requested cells.
+ *
+ * This function reads all the cells added with add() and add_prefix().
+ *
+ * There is one database access per row. When all the cells of a row
+ * are already in the libdbproxy cache, the row is not read again.
+ *
+ * \return The number of database accesses that were necessary.
+ */
+size_t db_prefetch::execute()
+{
+    size_t count(0);
+    for(auto & r : f_requests)
+    {
+        row_request_t & request(r.second);
+        request.f_values.clear();
+        if(!is_cached(request))
+        {
+            read_row(request);
+            ++count;
+        }
+    }
+    f_executed = true;
+
+    return count;
+}
+
+
+/** \brief Check whether a cell was found.
+ *
+ * \exception db_prefetch_not_executed
+ * The execute() function must be called before you can check for cells.
+ *
+ * \param[in] table  The table the row is defined in.
+ * \param[in] row_key  The key of the row.
+ * \param[in] cell_name  The name of the cell to check.
+ *
+ * \return true if the cell was read from the database.
+ */
+bool db_prefetch::exists(libdbproxy::table::pointer_t table, QString const & row_key, QString const & cell_name) const
+{
+    row_request_t const & request(find_request(table, row_key));
+    return request.f_values.find(cell_name) != request.f_values.end();
+}
+
+
+/** \brief Retrieve the value of a cell.
+ *
+ * If the cell does not exist, then the function returns a null value.
+ *
+ * \exception db_prefetch_not_executed
+ * The execute() function must be called before you can retrieve values.
+ *
+ * \param[in] table  The table the row is defined in.
+ * \param[in] row_key  The key of the row.
+ * \param[in] cell_name  The name of the cell to retrieve.
+ *
+ * \return The value of the cell.
+ */
+libdbproxy::value db_prefetch::get_value(libdbproxy::table::pointer_t table, QString const & row_key, QString const & cell_name) const
+{
+    row_request_t const & request(find_request(table, row_key));
+    auto const it(request.f_values.find(cell_name));
+    if(it == request.f_values.end())
+    {
+        return libdbproxy::value();
+    }
+    return it->second;
+}
+
+
+/** \brief Retrieve all the cells read from a row.
+ *
+ * This function is particularly useful with add_prefix() since in that
+ * case the caller may not know the names of the cells that were found.
+ *
+ * The cells are sorted by name.
+ *
+ * \exception db_prefetch_not_executed
+ * The execute() function must be called before you can retrieve values.
+ *
+ * \param[in] table  The table the row is defined in.
+ * \param[in] row_key  The key of the row.
+ *
+ * \return The map of cell names and values found in that row.
+ */
+db_prefetch::cell_values_t const & db_prefetch::get_values(libdbproxy::table::pointer_t table, QString const & row_key) const
+{
+    return find_request(table, row_key).f_values;
+}
+
+
+db_prefetch::row_request_t & db_prefetch::get_request(libdbproxy::table::pointer_t table, QString const & row_key)
+{
+    row_request_t & request(f_requests[row_id_t(table.get(), row_key)]);
+    if(request.f_table == nullptr)
+    {
+        request.f_table = table;
+        request.f_row_key = row_key;
+    }
+    return request;
+}
+
+
+db_prefetch::row_request_t const & db_prefetch::find_request(libdbproxy::table::pointer_t table, QString const & row_key) const
+{
+    if(!f_executed)
+    {
+        throw db_prefetch_not_executed("db_prefetch::execute() must be called before values can be retrieved.");
+    }
+
+    static row_request_t const g_empty_request = row_request_t();
+
+    auto const it(f_requests.find(row_id_t(table.get(), row_key)));
+    if(it == f_requests.end())
+    {
+        return g_empty_request;
+    }
+    return it->second;
+}
+
+
+/** \brief Check whether all the requested cells are in the cache.
+ *
+ * The libdbproxy row keeps the cells it last read or wrote. If all the
+ * cells we are interested in are there, we can avoid the database
+ * access altogether.
+ *
+ * Prefixes cannot be verified in this way so a request with a prefix
+ * is never considered cached.
+ *
+ * When a consistency level was specified, the cache is ignored so the
+ * cells get read again with that consistency level.
+ *
+ * \param[in] request  The request to check.
+ *
+ * \return true if all the values were found in the cache.
+ */
+bool db_prefetch::is_cached(row_request_t & request) const
+{
+    if(f_consistency_level_defined
+    || !request.f_cell_prefixes.empty())
+    {
+        return false;
+    }
+
+    libdbproxy::cells const & cells(request.f_table->getRow(request.f_row_key)->getCells());
+    for(auto const & name : request.f_cell_names)
+    {
+        auto const it(cells.find(name.toUtf8()));
+        if(it == cells.end())
+        {
+            request.f_values.clear();
+            return false;
+        }
+        request.f_values[name] = it.value()->getValue();
+    }
+
+    return true;
+}
+
+
+/** \brief Read the requested cells of one row.
+ *
+ * This function reads all the cells between the smallest and the
+ * largest requested name with one cell range predicate. Only the
+ * cells that were requested are kept in the results.
+ *
+ * When the range includes more than g_cells_per_page cells, the
+ * read continues page by page.
+ *
+ * \param[in,out] request  The request for which cells are to be read.
+ */
+void db_prefetch::read_row(row_request_t & request)
+{
+    QString start_key;
+    QString end_key;
+    auto extend = [&start_key, &end_key](QString const & start, QString const & end)
+        {
+            if(start_key.isEmpty() || start < start_key)
+            {
+                start_key = start;
+            }
+            if(end_key.isEmpty() || end > end_key)
+            {
+                end_key = end;
+            }
+        };
+    for(auto const & name : request.f_cell_names)
+    {
+        extend(name, name);
+    }
+    for(auto const & prefix : request.f_cell_prefixes)
+    {
+        extend(prefix, prefix_end(prefix));
+    }
+
+    auto column_predicate(std::make_shared<libdbproxy::cell_range_predicate>());
+    column_predicate->setCount(g_cells_per_page);
+    column_predicate->setIndex(); // behave like an index
+    column_predicate->setStartCellKey(start_key);
+    column_predicate->setEndCellKey(end_key);
+    if(f_consistency_level_defined)
+    {
+        column_predicate->setConsistencyLevel(f_consistency_level);
+    }
+
+    libdbproxy::row::pointer_t row(request.f_table->getRow(request.f_row_key));
+    for(;;)
+    {
+        row->readCells(column_predicate);
+        libdbproxy::cells const cells(row->getCells());
+        if(cells.isEmpty())
+        {
+            break;
+        }
+        for(libdbproxy::cells::const_iterator c(cells.begin()); c != cells.end(); ++c)
+        {
+            QString const name(QString::fromUtf8(c.key()));
+            bool keep(request.f_cell_names.find(name) != request.f_cell_names.end());
+            if(!keep)
+            {
+                for(auto const & prefix : request.f_cell_prefixes)
+                {
+                    if(name.startsWith(prefix))
+                    {
+                        keep = true;
+                        break;
+                    }
+                }
+            }
+            if(keep)
+            {
+                request.f_values[name] = c.value()->getValue();
+            }
+        }
+        if(cells.size() < g_cells_per_page)
+        {
+            // the last page was not full, no need for another round trip
+            //
+            break;
+        }
+    }
+}
+
+
+
+} // namespace snap
+// vim: ts=4 sw=4 et
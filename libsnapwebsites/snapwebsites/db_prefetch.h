@@ -0,0 +1,88 @@
+// Snap Websites Server -- batch database reads
+// Copyright (c) 2019  Made to Order Software Corp.  All Rights Reserved
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+#pragma once
+
+// libdbproxy lib
+//
+#include    <libdbproxy/libdbproxy.h>
+
+
+// libexcept lib
+//
+#include    <libexcept/exception.h>
+
+
+// C++ lib
+//
+#include    <map>
+#include    <set>
+
+
+namespace snap
+{
+
+DECLARE_MAIN_EXCEPTION(db_prefetch_exception);
+
+DECLARE_EXCEPTION(db_prefetch_exception, db_prefetch_not_executed);
+
+
+
+class db_prefetch
+{
+public:
+    typedef std::map<QString, libdbproxy::value>        cell_values_t;
+
+    void                        set_consistency_level(libdbproxy::consistency_level_t level);
+    void                        add(libdbproxy::table::pointer_t table, QString const & row_key, QString const & cell_name);
+    void                        add_prefix(libdbproxy::table::pointer_t table, QString const & row_key, QString const & cell_prefix);
+    size_t                      size() const;
+
+    size_t                      execute();
+
+    bool                        exists(libdbproxy::table::pointer_t table, QString const & row_key, QString const & cell_name) const;
+    libdbproxy::value           get_value(libdbproxy::table::pointer_t table, QString const & row_key, QString const & cell_name) const;
+    cell_values_t const &       get_values(libdbproxy::table::pointer_t table, QString const & row_key) const;
+
+private:
+    struct row_request_t
+    {
+        libdbproxy::table::pointer_t    f_table = libdbproxy::table::pointer_t();
+        QString                         f_row_key = QString();
+        std::set<QString>               f_cell_names = std::set<QString>();
+        std::set<QString>               f_cell_prefixes = std::set<QString>();
+        cell_values_t                   f_values = cell_values_t();
+    };
+
+    typedef std::pair<libdbproxy::table *, QString>     row_id_t;
+    typedef std::map<row_id_t, row_request_t>           row_requests_t;
+
+    row_request_t &             get_request(libdbproxy::table::pointer_t table, QString const & row_key);
+    row_request_t const &       find_request(libdbproxy::table::pointer_t table, QString const & row_key) const;
+    bool                        is_cached(row_request_t & request) const;
+    void                        read_row(row_request_t & request);
+
+    row_requests_t              f_requests = row_requests_t();
+    libdbproxy::consistency_level_t
+                                f_consistency_level = libdbproxy::CONSISTENCY_LEVEL_ONE;
+    bool                        f_consistency_level_defined = false;
+    bool                        f_executed = false;
+};
+
+
+
+} // namespace snap
+// vim: ts=4 sw=4 et
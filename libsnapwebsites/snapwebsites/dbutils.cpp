@@ -694,9 +694,13 @@ dbutils::column_type_t dbutils::get_column_type( const QByteArray& key ) const
          || n == "content::files::image_height"
          || n == "content::files::image_width"
          || n == "content::files::size"
+         || n == "content::files::size::brotli_compressed"
          || n == "content::files::size::gzip_compressed"
          || n == "content::files::size::minified"
+         || n == "content::files::size::minified::brotli_compressed"
          || n == "content::files::size::minified::gzip_compressed"
+         || n == "content::files::size::minified::zstd_compressed"
+         || n == "content::files::size::zstd_compressed"
          || n == "content::revision_control::attachment::current_branch"
          || n == "content::revision_control::attachment::current_working_branch"
          || n == "content::revision_control::current_branch"
@@ -39,11 +39,17 @@
 #include <snapdev/not_used.h>
 
 
+// C++ lib
+//
+#include <iostream>
+
+
 // C lib
 //
 #include <wait.h>
 #include <fcntl.h>
 #include <sys/resource.h>
+#include <unistd.h>
 
 
 // last include
@@ -2607,5 +2613,74 @@ bool snap_backend::process_backend_uri(QString const & uri)
 }
 
 
+/** \brief Create a worker process.
+ *
+ * A backend action which has a lot of independent work to do can split
+ * it between several worker processes. This function creates one such
+ * worker. It works like fork(): it returns the PID of the worker in
+ * the parent, -1 on error, and 0 in the worker.
+ *
+ * The worker inherits all the data of the parent, including the plugins
+ * and their libdbproxy objects. It gets its own connection to snapdbproxy
+ * so the requests of the parent and its workers do not get mixed up.
+ * The worker does not communicate with snapcommunicator, however, it
+ * can make use of a snap_lock since locks open their own connection.
+ * The worker must not make use of any other database connection the
+ * parent opened (i.e. the MySQL connection of a plugin).
+ *
+ * The worker must end with a call to exit_worker(). The parent is
+ * expected to wait for its workers with waitpid().
+ *
+ * \warning
+ * This function can only be called from within the backend child
+ * process (i.e. from within a backend action.)
+ *
+ * \return The PID of the worker, 0 in the worker, or -1 on error.
+ */
+pid_t snap_backend::fork_worker()
+{
+    if(g_signal_child_death)
+    {
+        throw snap_logic_exception("snap_backend::fork_worker() can only be called from the backend child process.");
+    }
+
+    pid_t const p(fork_child());
+    if(p != 0)
+    {
+        return p;
+    }
+
+    // the worker gets its own snapdbproxy connection
+    //
+    if(!reconnect_cassandra())
+    {
+        SNAP_LOG_FATAL("snap_backend::fork_worker(): the worker could not connect to snapdbproxy.");
+        exit_worker(1);
+    }
+
+    return 0;
+}
+
+
+/** \brief End a worker process.
+ *
+ * A worker shares the sockets of its parent. Calling exit() would run
+ * the destructors of the objects it inherited and, for example, close
+ * the MySQL connection of the parent with a QUIT message. Instead this
+ * function flushes the output streams, which the logger may use, and
+ * calls _exit().
+ *
+ * \param[in] exit_code  The exit code of the worker.
+ */
+void snap_backend::exit_worker(int exit_code)
+{
+    std::cout.flush();
+    std::cerr.flush();
+    std::clog.flush();
+
+    _exit(exit_code);
+}
+
+
 } // namespace snap
 // vim: ts=4 sw=4 et
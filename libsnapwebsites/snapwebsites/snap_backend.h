@@ -49,6 +49,8 @@ public:
     bool                        remove_processed_uri(QString const & action, QByteArray const & key, QString const & website_uri);
 
     void                        run_backend();
+    pid_t                       fork_worker();
+    [[noreturn]] static void    exit_worker(int exit_code);
     void                        stop(bool quitting);
     void                        process_connection_failed();
 
@@ -26,6 +26,7 @@
 // snapwebsites
 //
 #include    "snapwebsites/compression.h"
+#include    "snapwebsites/compression_stream.h"
 #include    "snapwebsites/mail_exchanger.h"
 #include    "snapwebsites/qcompatibility.h"
 #include    "snapwebsites/qdomhelpers.h"
@@ -34,6 +35,7 @@
 #include    "snapwebsites/snapwebsites.h"
 #include    "snapwebsites/snap_lock.h"
 #include    "snapwebsites/snap_magic.h"
+#include    "snapwebsites/xslt.h"
 
 
 // snaplogger
@@ -90,6 +92,7 @@
 #include <stdio.h>
 #include <wait.h>
 #include <sys/prctl.h>
+#include <sys/socket.h>
 #include <sys/syscall.h>
 
 
@@ -104,6 +107,49 @@ namespace snap
 {
 
 
+namespace
+{
+
+
+/** \brief Level used to compress dynamic content.
+ *
+ * Pages generated on each request get compressed on each request. The
+ * highest level (100) costs a lot more time for a very small gain with
+ * brotli and zstd, so dynamic content uses a medium level. Attachments
+ * are compressed once by the backend at the highest level instead.
+ *
+ * This is the default of the "compression_level" parameter.
+ */
+compression::level_t const DYNAMIC_COMPRESSION_LEVEL = 50;
+
+
+/** \brief Default list of encodings used to compress dynamic content.
+ *
+ * The order is used when the client gives the same preference to
+ * several encodings. This is the default of the "compression_algorithms"
+ * parameter.
+ */
+char const * const DEFAULT_COMPRESSION_ALGORITHMS = "br,zstd,gzip,deflate";
+
+
+/** \brief Size from which the output gets compressed incrementally.
+ *
+ * Smaller pages are compressed at once and sent with a Content-Length.
+ * Larger pages are compressed and sent one slice at a time so the
+ * client starts receiving data sooner. This is the default of the
+ * "compression_streaming_threshold" parameter.
+ */
+int const DEFAULT_STREAMING_COMPRESSION_THRESHOLD = 64 * 1024;
+
+
+/** \brief Size of the slices sent to the compression stream.
+ */
+int const STREAMING_COMPRESSION_SLICE_SIZE = 16 * 1024;
+
+
+}
+// no name namespace
+
 
 
 /** \class snap_child
@@ -2506,6 +2552,13 @@ snap_child::snap_child(server_pointer_t s)
  */
 snap_child::~snap_child()
 {
+    // a pre-forked child which never received a client has to be told
+    //
+    if(!f_is_child)
+    {
+        cancel_prefork();
+    }
+
     // detach or wait till it dies?
     if(f_child_pid > 0)
     {
@@ -3107,6 +3160,327 @@ bool snap_child::process(tcp_client_server::bio_client::pointer_t client)
 
     f_client = client;
 
+    process_request();
+    snapdev::NOT_REACHED();
+
+    // compiler expects a return
+    return false;
+}
+
+
+/** \brief Pre-fork a child process waiting for a connection.
+ *
+ * When the server runs with a pool of children (see the child_pool_size
+ * parameter of snapserver.conf) it calls this function ahead of time.
+ * The new child process connects to snapdbproxy and then waits for the
+ * server to send it the socket of a client with hand_over().
+ *
+ * This way the fork(), the database connection, and the compilation of
+ * the most used XSLT stylesheets are not part of the time it takes to
+ * answer a request. A pre-forked child still handles
+ * exactly one request and then exits, just like a child created by
+ * the process() function.
+ *
+ * \return true if the child process was successfully created.
+ *
+ * \sa hand_over()
+ * \sa cancel_prefork()
+ */
+bool snap_child::prefork()
+{
+    if(f_is_child)
+    {
+        SNAP_LOG_FATAL
+            << "BUG: snap_child::prefork() was called from a child process."
+            << SNAP_LOG_SEND;
+        return false;
+    }
+
+    if(f_child_pid != 0)
+    {
+        SNAP_LOG_FATAL
+            << "BUG: snap_child::prefork() called when the process is still in use."
+            << SNAP_LOG_SEND;
+        return false;
+    }
+
+    int channel[2];
+    if(socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, channel) != 0)
+    {
+        int const e(errno);
+        SNAP_LOG_ERROR
+            << "snap_child::prefork() could not create the server channel (errno: "
+            << e
+            << " -- "
+            << strerror(e)
+            << ")."
+            << SNAP_LOG_SEND;
+        return false;
+    }
+
+    pid_t const p(fork_child());
+    if(p != 0)
+    {
+        // parent process
+        //
+        close(channel[1]);
+        if(p == -1)
+        {
+            close(channel[0]);
+            SNAP_LOG_ERROR
+                << "snap_child::prefork() could not create child process."
+                << SNAP_LOG_SEND;
+            return false;
+        }
+
+        f_child_pid = p;
+        f_pool_socket = channel[0];
+        return true;
+    }
+
+    // child process
+    //
+    close(channel[0]);
+    f_pool_socket = channel[1];
+    f_is_child = true;
+
+    // this child may wait a long time for a client, do not keep the
+    // server's sockets open meanwhile
+    //
+    get_server()->close_inherited_connections();
+
+    // connect to the database now, if that fails we try again once we
+    // have a client so it can receive a proper error
+    //
+    snapdev::NOT_USED(connect_cassandra(false));
+
+    // compile the stylesheets most recently used by the other children
+    // so our first evaluation of those does not have to
+    //
+    xslt::warm_compiled_cache();
+
+    f_socket = receive_client();
+    close(f_pool_socket);
+    f_pool_socket = -1;
+    if(f_socket == -1)
+    {
+        // the server does not need us anymore
+        //
+        exit(0);
+        snapdev::NOT_REACHED();
+    }
+
+    process_request();
+    snapdev::NOT_REACHED();
+
+    // compiler expects a return
+    return false;
+}
+
+
+/** \brief Send a client connection to a pre-forked child.
+ *
+ * This function sends the socket of \p client to the child process
+ * created by prefork(). The child then processes the request exactly
+ * as if it had been created by process().
+ *
+ * The socket is passed as is, so this only works with plain connections.
+ * An SSL connection has a state in the server process which cannot be
+ * shared with the child.
+ *
+ * Once this function returns, the child is not waiting for a client
+ * anymore, whether the call succeeded or not. On a failure the child
+ * exits on its own and the caller is expected to use process() with
+ * a different snap_child object.
+ *
+ * \param[in] client  The client connection to attach to this child.
+ *
+ * \return true if the socket was sent to the child.
+ */
+bool snap_child::hand_over(tcp_client_server::bio_client::pointer_t client)
+{
+    if(f_pool_socket == -1)
+    {
+        SNAP_LOG_FATAL
+            << "BUG: snap_child::hand_over() called on a child which was not pre-forked."
+            << SNAP_LOG_SEND;
+        return false;
+    }
+
+    int const s(client->get_socket());
+
+    char command('C');
+    struct iovec iov = {};
+    iov.iov_base = &command;
+    iov.iov_len = sizeof(command);
+
+    char control[CMSG_SPACE(sizeof(s))] = {};
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wold-style-cast"
+    struct cmsghdr * cmsg(CMSG_FIRSTHDR(&msg));
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(s));
+    memcpy(CMSG_DATA(cmsg), &s, sizeof(s));
+#pragma GCC diagnostic pop
+
+    bool const sent(sendmsg(f_pool_socket, &msg, MSG_NOSIGNAL) == sizeof(command));
+    if(!sent)
+    {
+        int const e(errno);
+        SNAP_LOG_ERROR
+            << "snap_child::hand_over() could not send the client socket to child "
+            << f_child_pid
+            << " (errno: "
+            << e
+            << " -- "
+            << strerror(e)
+            << ")."
+            << SNAP_LOG_SEND;
+    }
+
+    close(f_pool_socket);
+    f_pool_socket = -1;
+
+    return sent;
+}
+
+
+/** \brief Tell a pre-forked child that it is not needed anymore.
+ *
+ * This function sends a message to the child process created by
+ * prefork() so it exits without processing any request. This is used
+ * when the server stops or loses one of the services the children
+ * depend on (i.e. snapdbproxy).
+ *
+ * The child still needs to be reaped with check_status().
+ */
+void snap_child::cancel_prefork()
+{
+    if(f_pool_socket == -1)
+    {
+        return;
+    }
+
+    // we cannot only rely on close() because other children may have
+    // inherited a copy of this socket
+    //
+    char command('Q');
+    snapdev::NOT_USED(send(f_pool_socket, &command, sizeof(command), MSG_NOSIGNAL));
+
+    close(f_pool_socket);
+    f_pool_socket = -1;
+}
+
+
+/** \brief Close the channel with a pre-forked child.
+ *
+ * This function closes the server side of the channel without telling
+ * the child anything. It is used by the other pre-forked children
+ * which inherited a copy of that socket. The server itself uses
+ * cancel_prefork() instead.
+ */
+void snap_child::close_pool_socket()
+{
+    if(f_pool_socket == -1)
+    {
+        return;
+    }
+
+    close(f_pool_socket);
+    f_pool_socket = -1;
+}
+
+
+/** \brief Wait for the server to send us a client.
+ *
+ * A pre-forked child calls this function to wait for the server to
+ * send a client connection with hand_over().
+ *
+ * \return The client socket or -1 if the server does not need this
+ *          child anymore.
+ */
+int snap_child::receive_client()
+{
+    for(;;)
+    {
+        char command('\0');
+        struct iovec iov = {};
+        iov.iov_base = &command;
+        iov.iov_len = sizeof(command);
+
+        int s(-1);
+        char control[CMSG_SPACE(sizeof(s))] = {};
+        struct msghdr msg = {};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        ssize_t const r(recvmsg(f_pool_socket, &msg, MSG_CMSG_CLOEXEC));
+        if(r < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            int const e(errno);
+            SNAP_LOG_ERROR
+                << "snap_child::receive_client() could not read the server channel (errno: "
+                << e
+                << " -- "
+                << strerror(e)
+                << ")."
+                << SNAP_LOG_SEND;
+            return -1;
+        }
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wold-style-cast"
+        for(struct cmsghdr * cmsg(CMSG_FIRSTHDR(&msg)); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if(cmsg->cmsg_level == SOL_SOCKET
+            && cmsg->cmsg_type == SCM_RIGHTS
+            && cmsg->cmsg_len == CMSG_LEN(sizeof(s)))
+            {
+                memcpy(&s, CMSG_DATA(cmsg), sizeof(s));
+            }
+        }
+#pragma GCC diagnostic pop
+
+        if(r == 1 && command == 'C')
+        {
+            return s;
+        }
+
+        // 'Q' or the server closed the channel
+        //
+        if(s != -1)
+        {
+            close(s);
+        }
+        return -1;
+    }
+}
+
+
+/** \brief Process the request of the client attached to this child.
+ *
+ * This function is called in the child process once it has a client
+ * connection, whether the child was created by process() or by prefork().
+ * It reads the request, connects to the database if not yet done,
+ * runs the plugins and sends the reply.
+ *
+ * The function never returns. It exits the process once done.
+ */
+void snap_child::process_request()
+{
     try
     {
         f_ready = false;
@@ -3128,7 +3502,12 @@ bool snap_child::process(tcp_client_server::bio_client::pointer_t client)
         // move all possible work that does not required the DB before
         // this line so we avoid a network connection altogether
         //
-        snapdev::NOT_USED(connect_cassandra(true));  // since we pass 'true', the returned value will always be true
+        // (a pre-forked child is likely connected already)
+        //
+        if(!f_cassandra)
+        {
+            snapdev::NOT_USED(connect_cassandra(true));  // since we pass 'true', the returned value will always be true
+        }
 
         canonicalize_domain();      // using the URI, find the domain core::rules and start the canonicalization process
         canonicalize_website();     // using the canonicalized domain, find the website core::rules and continue the canonicalization process
@@ -3179,7 +3558,7 @@ bool snap_child::process(tcp_client_server::bio_client::pointer_t client)
                 snapdev::NOT_REACHED();
 
                 // double protection, this statement is not reachable
-                return false;
+                return;
             }
         }
 
@@ -3200,7 +3579,7 @@ bool snap_child::process(tcp_client_server::bio_client::pointer_t client)
     catch( snap_lock_failed_exception const & except )
     {
         SNAP_LOG_FATAL
-            << "snap_child::process(): snap_lock_failed_exception caught: "
+            << "snap_child::process_request(): snap_lock_failed_exception caught: "
             << except.what()
             << SNAP_LOG_SEND;
 
@@ -3214,14 +3593,14 @@ bool snap_child::process(tcp_client_server::bio_client::pointer_t client)
     catch( snap_exception const & except )
     {
         SNAP_LOG_FATAL
-            << "snap_child::process(): snap_exception caught: "
+            << "snap_child::process_request(): snap_exception caught: "
             << except.what()
             << SNAP_LOG_SEND;
     }
     catch( libexcept::exception_t const & e )
     {
         SNAP_LOG_FATAL
-            << "snap_child::process(): libexcept::exception_t caught: "
+            << "snap_child::process_request(): libexcept::exception_t caught: "
             << e.what()
             << SNAP_LOG_SEND;
         for( auto const & stack_string : e.get_stack_trace() )
@@ -3235,7 +3614,7 @@ bool snap_child::process(tcp_client_server::bio_client::pointer_t client)
     catch( libdbproxy::exception const & e )
     {
         SNAP_LOG_FATAL
-            << "snap_child::process(): libdbproxy::exception caught: "
+            << "snap_child::process_request(): libdbproxy::exception caught: "
             << e.what()
             << SNAP_LOG_SEND;
         for( auto const & stack_string : e.get_stack_trace() )
@@ -3253,22 +3632,19 @@ bool snap_child::process(tcp_client_server::bio_client::pointer_t client)
         // (i.e. libtld, C++ cassandra driver...)
         //
         SNAP_LOG_FATAL
-            << "snap_child::process(): std::exception caught: "
+            << "snap_child::process_request(): std::exception caught: "
             << std_except.what()
             << SNAP_LOG_SEND;
     }
     catch( ... )
     {
         SNAP_LOG_FATAL
-            << "snap_child::process(): unknown exception caught!"
+            << "snap_child::process_request(): unknown exception caught!"
             << SNAP_LOG_SEND;
     }
 
     exit(1);
     snapdev::NOT_REACHED();
-
-    // compiler expects a return
-    return false;
 }
 
 
@@ -3463,9 +3839,8 @@ void snap_child::read_environment()
     class read_env
     {
     public:
-        read_env(snap_child * snap, tcp_client_server::bio_client::pointer_t client, environment_map_t & env, environment_map_t & browser_cookies, environment_map_t & post, post_file_map_t & files)
+        read_env(snap_child * snap, environment_map_t & env, environment_map_t & browser_cookies, environment_map_t & post, post_file_map_t & files)
             : f_snap(snap)
-            , f_client(client)
             , f_env(env)
             , f_browser_cookies(browser_cookies)
             , f_post(post)
@@ -3498,7 +3873,7 @@ void snap_child::read_environment()
             // this read blocks, so we read just 1 char. because we
             // want to stop calling read() as soon as possible (otherwise
             // we would be blocked here forever)
-            if(f_client->read(&c, 1) != 1)
+            if(f_snap->read_client(&c, 1) != 1)
             {
                 int const e(errno);
                 die(QString("I/O error, errno: %1").arg(e));
@@ -4070,8 +4445,6 @@ SNAP_LOG_TRACE
 
     private:
         mutable snap_child *        f_snap = nullptr;
-        tcp_client_server::bio_client::pointer_t
-                                    f_client = tcp_client_server::bio_client::pointer_t();
         //char                        f_unget = 0;
         bool                        f_running = true;
         bool                        f_started = false;
@@ -4103,7 +4476,7 @@ SNAP_LOG_TRACE
     SNAP_LOG_TRACE << "Read environment variables including POST data." << SNAP_LOG_SEND;
 #endif
 
-    read_env r(this, f_client, f_env, f_browser_cookies, f_post, f_files);
+    read_env r(this, f_env, f_browser_cookies, f_post, f_files);
 #ifdef DEBUG
     r.output_debug_log();
 #endif
@@ -4121,6 +4494,41 @@ SNAP_LOG_TRACE
 }
 
 
+/** \brief Read data from the client socket.
+ *
+ * This function reads data from the client connection. The child either
+ * has a client object (created by the process() function) or a plain
+ * socket received from the server (created by the prefork() function.)
+ *
+ * \param[out] buf  The buffer where the data gets saved.
+ * \param[in] size  The maximum number of bytes to read.
+ *
+ * \return The number of bytes read or -1 on an error.
+ */
+ssize_t snap_child::read_client(char * buf, size_t size)
+{
+    if(f_client)
+    {
+        return f_client->read(buf, size);
+    }
+
+    if(f_socket != -1)
+    {
+        for(;;)
+        {
+            ssize_t const r(::read(f_socket, buf, size));
+            if(r >= 0 || errno != EINTR)
+            {
+                return r;
+            }
+        }
+    }
+
+    errno = EBADF;
+    return -1;
+}
+
+
 /** \brief Mark the server for initialization.
  *
  * This special flag allows us to initialize the plugins without having
@@ -4145,6 +4553,31 @@ void snap_child::mark_for_initialization()
  */
 void snap_child::write(char const * data, ssize_t size)
 {
+    if(f_socket != -1)
+    {
+        // pre-forked child, we have a plain socket
+        //
+        while(size > 0)
+        {
+            ssize_t const r(::write(f_socket, data, size));
+            if(r < 0)
+            {
+                if(errno == EINTR)
+                {
+                    continue;
+                }
+                SNAP_LOG_FATAL
+                    << "error while sending data to a client."
+                    << SNAP_LOG_SEND;
+                // XXX throw? we cannot call die() because die() calls write()!
+                throw std::runtime_error("error while sending data to the client");
+            }
+            data += r;
+            size -= r;
+        }
+        return;
+    }
+
     if(!f_client)
     {
         // this happens from backends that do not have snap.cgi running
@@ -4905,6 +5338,56 @@ SNAP_LOG_WARNING
 }
 
 
+/** \brief Open a new connection with snapdbproxy.
+ *
+ * After a fork(), the parent and the child processes share the same
+ * socket to snapdbproxy. Only one of them can continue to use it.
+ * The child calls this function to get its own connection.
+ *
+ * The libdbproxy object is kept as is (libdbproxy::connect() first
+ * disconnects) so the context, tables, and rows already retrieved
+ * by the plugins remain valid and send their requests through the
+ * new connection.
+ *
+ * \return true if the new connection succeeded.
+ */
+bool snap_child::reconnect_cassandra()
+{
+    if(!f_cassandra)
+    {
+        return false;
+    }
+
+    QString snapdbproxy_addr("127.0.0.1");
+    int snapdbproxy_port(4042);
+    snap_config config("snapdbproxy");
+    tcp_client_server::get_addr_port(config["listen"], snapdbproxy_addr, snapdbproxy_port, "tcp");
+
+    try
+    {
+        if(!f_cassandra->connect(snapdbproxy_addr, snapdbproxy_port))
+        {
+            return false;
+        }
+        f_cassandra->setDefaultConsistencyLevel(libdbproxy::CONSISTENCY_LEVEL_QUORUM);
+    }
+    catch(std::exception const & e)
+    {
+        SNAP_LOG_ERROR
+            << "Could not reconnect to the snapdbproxy server ("
+            << snapdbproxy_addr
+            << ":"
+            << snapdbproxy_port
+            << "). Reason: "
+            << e.what()
+            << SNAP_LOG_SEND;
+        return false;
+    }
+
+    return true;
+}
+
+
 /** \brief Completely disconnect from cassandra.
  *
  * Whenever we receive a NOCASSANDRA event in a backend, we want to
@@ -5680,6 +6163,14 @@ void snap_child::canonicalize_options()
                 // not yet implemented though...
                 compressions.push_back(compression_t::COMPRESSION_SDCH);
             }
+            else if(encoding_name == "br")
+            {
+                compressions.push_back(compression_t::COMPRESSION_BROTLI);
+            }
+            else if(encoding_name == "zstd")
+            {
+                compressions.push_back(compression_t::COMPRESSION_ZSTD);
+            }
             else if(encoding_name == "identity")
             {
                 // identity is acceptable
@@ -6472,6 +6963,11 @@ void snap_child::exit(int code)
     // make sure the socket data is pushed to the caller
     //
     f_client.reset();
+    if(f_socket != -1)
+    {
+        close(f_socket);
+        f_socket = -1;
+    }
 
     // after we close the socket the answer is sent to the client so
     // we can take a little time to gather some statistics.
@@ -8650,10 +9146,16 @@ void snap_child::output_result(header_mode_t modes, QByteArray output_data)
     //      buffer so that way here we can "adjust" the compression as
     //      required -- some of that is already done/supported TBD
 
+    // a byte range request gets a 206 with only the requested bytes; the
+    // ranges apply to the data as is so we must not compress it here
+    //
+    bool const partial_content(modes == HEADER_MODE_NO_ERROR && output_byte_ranges(output_data));
+
     // was the output buffer generated from an already compressed file?
     // if so, then skip the encoding handling
     QString const current_content_encoding(get_header("Content-Encoding"));
-    if(current_content_encoding.isEmpty())
+    if(!partial_content
+    && current_content_encoding.isEmpty())
     {
         // TODO image file formats that are already compressed should not be
         //      recompressed (i.e. JPEG, GIF, PNG...)
@@ -8684,25 +9186,84 @@ void snap_child::output_result(header_mode_t modes, QByteArray output_data)
             // plain zlib data is named "deflate"
             float const deflate_level(encodings.get_level("deflate"));
 
-            if(gzip_level > 0.0f && gzip_level >= deflate_level)
+            // brotli is named "br"
+            float const brotli_level(encodings.get_level("br"));
+            float const zstd_level(encodings.get_level("zstd"));
+
+            // pick the encoding with the highest preference; on a tie,
+            // prefer the one which appears first in the administrator
+            // list of algorithms
+            //
+            struct encoding_t
+            {
+                char const *    f_encoding = nullptr;
+                char const *    f_compressor = nullptr;
+                float           f_level = 0.0f;
+            };
+            encoding_t const available_encodings[] =
             {
-                // browser asked for gzip with higher preference
-                QString compressor("gzip");
-                output_data = compression::compress(compressor, output_data, 100, true);
-                if(compressor == "gzip")
+                { "br",      "brotli",  brotli_level },
+                { "zstd",    "zstd",    zstd_level },
+                { "gzip",    "gzip",    gzip_level },
+                { "deflate", "deflate", deflate_level },
+            };
+            snap_string_list algorithms(server->get_parameter("compression_algorithms").split(',', QString::SkipEmptyParts));
+            if(algorithms.isEmpty())
+            {
+                algorithms = QString(DEFAULT_COMPRESSION_ALGORITHMS).split(',');
+            }
+            encoding_t const * selected(nullptr);
+            for(auto const & a : algorithms)
+            {
+                QString const name(a.trimmed());
+                for(auto const & e : available_encodings)
                 {
-                    // compression succeeded
-                    set_header("Content-Encoding", "gzip", HEADER_MODE_EVERYWHERE);
+                    if(name == e.f_encoding
+                    && e.f_level > 0.0f
+                    && (selected == nullptr || e.f_level > selected->f_level))
+                    {
+                        selected = &e;
+                    }
                 }
             }
-            else if(deflate_level > 0.0f)
+
+            if(selected != nullptr)
             {
-                QString compressor("deflate");
-                output_data = compression::compress(compressor, output_data, 100, true);
-                if(compressor == "deflate")
+                // dynamic pages get compressed on each request so we use
+                // a medium level by default; static files get their
+                // variants compressed once at the highest level by the
+                // backend
+                //
+                bool ok(false);
+                compression::level_t level(server->get_parameter("compression_level").toInt(&ok, 10));
+                if(!ok
+                || level < 0
+                || level > 100)
+                {
+                    level = DYNAMIC_COMPRESSION_LEVEL;
+                }
+
+                // large pages are compressed while being sent
+                //
+                int threshold(server->get_parameter("compression_streaming_threshold").toInt(&ok, 10));
+                if(!ok)
+                {
+                    threshold = DEFAULT_STREAMING_COMPRESSION_THRESHOLD;
+                }
+                if(threshold > 0
+                && output_data.size() >= threshold
+                && compression_stream::is_supported(selected->f_compressor))
+                {
+                    output_compression_stream(modes, output_data, selected->f_encoding, compression_stream::create(selected->f_compressor, level, true));
+                    return;
+                }
+
+                QString compressor(selected->f_compressor);
+                output_data = compression::compress(compressor, output_data, level, true);
+                if(compressor == selected->f_compressor)
                 {
                     // compression succeeded
-                    set_header("Content-Encoding", "deflate", HEADER_MODE_EVERYWHERE);
+                    set_header("Content-Encoding", selected->f_encoding, HEADER_MODE_EVERYWHERE);
                 }
             }
             else
@@ -8752,6 +9313,333 @@ void snap_child::output_result(header_mode_t modes, QByteArray output_data)
 }
 
 
+/** \brief Send the output compressed one slice at a time.
+ *
+ * For large pages, compressing the whole buffer before sending anything
+ * delays the first byte the client receives by the time it takes to
+ * compress everything and requires a second buffer as large as the
+ * compressed output.
+ *
+ * This function instead sends the headers right away and then feeds
+ * the compression \p stream with slices of \p output_data, writing
+ * the compressed bytes as soon as the library makes them available.
+ *
+ * No Content-Length header gets sent since the size is not known in
+ * advance. The web server uses chunked transfer encoding instead.
+ *
+ * \param[in] modes  Print the headers for these modes.
+ * \param[in] output_data  The uncompressed output.
+ * \param[in] encoding  The name used in the Content-Encoding header.
+ * \param[in] stream  The compression stream used to compress the data.
+ */
+void snap_child::output_compression_stream(header_mode_t modes, QByteArray const & output_data, QString const & encoding, compression_stream::pointer_t stream)
+{
+    set_header("Content-Encoding", encoding, HEADER_MODE_EVERYWHERE);
+
+    output_headers(modes);
+
+    if(snapenv(get_name(name_t::SNAP_NAME_CORE_REQUEST_METHOD)) == "HEAD")
+    {
+        return;
+    }
+
+    int const size(output_data.size());
+    for(int offset(0); offset < size; offset += STREAMING_COMPRESSION_SLICE_SIZE)
+    {
+        QByteArray const compressed(stream->compress(output_data.data() + offset, std::min(STREAMING_COMPRESSION_SLICE_SIZE, size - offset)));
+        if(!compressed.isEmpty())
+        {
+            write(compressed.data(), compressed.size());
+        }
+    }
+
+    QByteArray const last(stream->finish());
+    if(!last.isEmpty())
+    {
+        write(last.data(), last.size());
+    }
+}
+
+
+/** \brief Mark the current output as supporting byte ranges.
+ *
+ * Plugins which send static data such as attachments can call this
+ * function to let the client request part of the data with the Range
+ * header (i.e. to resume a download or seek within a video.)
+ *
+ * The function adds the "Accept-Ranges: bytes" header. When the
+ * output_result() function is called, the Range header of the request
+ * is checked and a 206 Partial Content response is sent as required.
+ *
+ * \note
+ * The ranges are applied to the output buffer as is. If the plugin
+ * already set a Content-Encoding, the ranges apply to the encoded data.
+ *
+ * \sa output_byte_ranges()
+ */
+void snap_child::accept_byte_ranges()
+{
+    f_accept_byte_ranges = true;
+    set_header("Accept-Ranges", "bytes");
+}
+
+
+/** \brief Reduce the output to the ranges requested by the client.
+ *
+ * If the plugin generating the output called accept_byte_ranges() and
+ * the client sent a Range header, this function reduces \p output_data
+ * to the requested ranges and sets up the 206 Partial Content headers.
+ *
+ * A single range is sent as is with a Content-Range header. Multiple
+ * ranges are sent as a "multipart/byteranges" document.
+ *
+ * The Range header is ignored (i.e. the whole document gets sent) if
+ * the If-Range header does not match the ETag of the document, if the
+ * method is not GET, or if the Range header is not valid.
+ *
+ * If none of the ranges can be satisfied, the function replies with
+ * a 416 Range Not Satisfiable error and does not return.
+ *
+ * \param[in,out] output_data  The data to send to the client.
+ *
+ * \return true if \p output_data was replaced with partial content.
+ */
+bool snap_child::output_byte_ranges(QByteArray & output_data)
+{
+    if(!f_accept_byte_ranges
+    || f_died)
+    {
+        return false;
+    }
+
+    QString const range(snapenv("HTTP_RANGE"));
+    if(range.isEmpty()
+    || snapenv(get_name(name_t::SNAP_NAME_CORE_REQUEST_METHOD)) != "GET")
+    {
+        return false;
+    }
+
+    // the ranges only apply if the client still has the same document;
+    // we only support the ETag form (a date is viewed as a mismatch
+    // which is always safe since we then send the whole document)
+    //
+    QString const if_range(snapenv("HTTP_IF_RANGE"));
+    if(!if_range.isEmpty())
+    {
+        QString const etag(get_header("ETag"));
+        if(etag.isEmpty()
+        || if_range != etag)
+        {
+            return false;
+        }
+    }
+
+    int64_t const size(output_data.size());
+    byte_range_vector_t ranges;
+    if(!parse_byte_ranges(range, size, ranges))
+    {
+        // an invalid Range header is ignored
+        //
+        return false;
+    }
+
+    if(ranges.empty())
+    {
+        set_header("Content-Range", QString("bytes */%1").arg(size), HEADER_MODE_ERROR);
+        die(http_code_t::HTTP_CODE_REQUESTED_RANGE_NOT_SATISFIABLE, "",
+            "The requested range is not available in this document.",
+            QString("none of the ranges in \"%1\" are within the %2 bytes of the document").arg(range).arg(size));
+        snapdev::NOT_REACHED();
+    }
+
+    QString http_name;
+    define_http_name(http_code_t::HTTP_CODE_PARTIAL_CONTENT, http_name);
+    set_header(get_name(name_t::SNAP_NAME_CORE_STATUS_HEADER),
+               QString("%1 %2")
+                    .arg(static_cast<int>(http_code_t::HTTP_CODE_PARTIAL_CONTENT))
+                    .arg(http_name));
+
+    if(ranges.size() == 1)
+    {
+        byte_range_t const & r(ranges[0]);
+        set_header("Content-Range", QString("bytes %1-%2/%3").arg(r.f_first).arg(r.f_last).arg(size));
+        output_data = output_data.mid(r.f_first, r.f_last - r.f_first + 1);
+        return true;
+    }
+
+    // multiple ranges are sent as parts of a multipart document
+    //
+    QString const content_type(get_header(get_name(name_t::SNAP_NAME_CORE_CONTENT_TYPE_HEADER)));
+    QByteArray const boundary(QString("snap-byteranges-%1-%2").arg(f_start_date, 0, 16).arg(getpid(), 0, 16).toUtf8());
+    output_data = byte_ranges_document(output_data, ranges, boundary, content_type);
+
+    set_header(get_name(name_t::SNAP_NAME_CORE_CONTENT_TYPE_HEADER), "multipart/byteranges; boundary=" + QString::fromUtf8(boundary));
+
+    return true;
+}
+
+
+/** \brief Parse the Range header.
+ *
+ * This function parses a Range header as defined in RFC 7233. Only
+ * the "bytes" unit is supported.
+ *
+ * Each range is converted to an absolute first and last byte position
+ * within a document of \p size bytes. Ranges which start after the
+ * end of the document are dropped. Overlapping and adjacent ranges are
+ * merged so we never send the same byte twice.
+ *
+ * \param[in] range  The value of the Range header.
+ * \param[in] size  The size of the document.
+ * \param[out] ranges  The resulting ranges; empty if none is satisfiable.
+ *
+ * \return false if the Range header is not valid and must be ignored.
+ */
+bool snap_child::parse_byte_ranges(QString const & range, int64_t size, byte_range_vector_t & ranges)
+{
+    // we do not want to build documents with an insane number of parts
+    //
+    int const MAX_BYTE_RANGES = 20;
+
+    ranges.clear();
+
+    int const equal(range.indexOf('='));
+    if(equal <= 0
+    || range.left(equal).trimmed().toLower() != "bytes")
+    {
+        return false;
+    }
+
+    snap_string_list const specs(range.mid(equal + 1).split(','));
+    if(specs.size() > MAX_BYTE_RANGES)
+    {
+        return false;
+    }
+    for(auto const & s : specs)
+    {
+        QString const spec(s.trimmed());
+        if(spec.isEmpty())
+        {
+            continue;
+        }
+        int const dash(spec.indexOf('-'));
+        if(dash < 0)
+        {
+            return false;
+        }
+        QString const first_str(spec.left(dash).trimmed());
+        QString const last_str(spec.mid(dash + 1).trimmed());
+
+        bool ok(false);
+        byte_range_t r;
+        if(first_str.isEmpty())
+        {
+            // "-<suffix length>"
+            //
+            int64_t const suffix(last_str.toLongLong(&ok, 10));
+            if(!ok
+            || suffix < 0)
+            {
+                return false;
+            }
+            if(suffix == 0
+            || size == 0)
+            {
+                continue;
+            }
+            r.f_first = std::max(static_cast<int64_t>(0), size - suffix);
+            r.f_last = size - 1;
+        }
+        else
+        {
+            r.f_first = first_str.toLongLong(&ok, 10);
+            if(!ok
+            || r.f_first < 0)
+            {
+                return false;
+            }
+            if(last_str.isEmpty())
+            {
+                // "<first>-" (to the end)
+                //
+                r.f_last = size - 1;
+            }
+            else
+            {
+                r.f_last = last_str.toLongLong(&ok, 10);
+                if(!ok
+                || r.f_last < r.f_first)
+                {
+                    return false;
+                }
+                r.f_last = std::min(r.f_last, size - 1);
+            }
+            if(r.f_first >= size)
+            {
+                continue;
+            }
+        }
+        ranges.push_back(r);
+    }
+
+    std::sort(ranges.begin(), ranges.end(),
+            [](byte_range_t const & lhs, byte_range_t const & rhs)
+            {
+                return lhs.f_first < rhs.f_first;
+            });
+    byte_range_vector_t merged;
+    for(auto const & r : ranges)
+    {
+        if(!merged.empty()
+        && r.f_first <= merged.back().f_last + 1)
+        {
+            merged.back().f_last = std::max(merged.back().f_last, r.f_last);
+        }
+        else
+        {
+            merged.push_back(r);
+        }
+    }
+    ranges.swap(merged);
+
+    return true;
+}
+
+
+/** \brief Generate a "multipart/byteranges" document.
+ *
+ * This function generates the body sent when a client requests more
+ * than one range of a document. Each range becomes one part with its
+ * own Content-Type and Content-Range headers.
+ *
+ * The \p ranges are expected to be valid for \p data, as returned by
+ * parse_byte_ranges().
+ *
+ * \param[in] data  The complete document.
+ * \param[in] ranges  The ranges to include in the result.
+ * \param[in] boundary  The boundary separating the parts.
+ * \param[in] content_type  The type of the document or an empty string.
+ *
+ * \return The multipart document.
+ */
+QByteArray snap_child::byte_ranges_document(QByteArray const & data, byte_range_vector_t const & ranges, QByteArray const & boundary, QString const & content_type)
+{
+    QByteArray result;
+    for(auto const & r : ranges)
+    {
+        result += "\r\n--" + boundary + "\r\n";
+        if(!content_type.isEmpty())
+        {
+            result += "Content-Type: " + content_type.toUtf8() + "\r\n";
+        }
+        result += QString("Content-Range: bytes %1-%2/%3\r\n\r\n").arg(r.f_first).arg(r.f_last).arg(data.size()).toUtf8();
+        result += data.mid(r.f_first, r.f_last - r.f_first + 1);
+    }
+    result += "\r\n--" + boundary + "--\r\n";
+    return result;
+}
+
+
 /** \brief Process the post if there was one.
  *
  * This function processes the post, as in checks all the validity of
@@ -18,6 +18,7 @@
 
 // snapwebsites
 //
+#include    "snapwebsites/compression_stream.h"
 #include    "snapwebsites/snap_version.h"
 
 
@@ -302,10 +303,19 @@ public:
         COMPRESSION_GZIP,
         COMPRESSION_DEFLATE,        // zlib without the gzip magic numbers
         COMPRESSION_BZ2,
-        COMPRESSION_SDCH
+        COMPRESSION_SDCH,
+        COMPRESSION_BROTLI,         // "br"
+        COMPRESSION_ZSTD
     };
     typedef QVector<compression_t> compression_vector_t;
 
+    struct byte_range_t
+    {
+        int64_t         f_first = 0;
+        int64_t         f_last = 0;
+    };
+    typedef std::vector<byte_range_t>           byte_range_vector_t;
+
     enum class verified_email_t
     {
         VERIFIED_EMAIL_UNKNOWN,
@@ -319,6 +329,10 @@ public:
     virtual                     ~snap_child();
 
     bool                        process(ed::tcp_bio_client::pointer_t client);
+    bool                        prefork();
+    bool                        hand_over(ed::tcp_bio_client::pointer_t client);
+    void                        cancel_prefork();
+    void                        close_pool_socket();
     std::shared_ptr<server>     get_server() const;
     pid_t                       get_child_pid() const;
     void                        kill();
@@ -425,6 +439,9 @@ public:
     void                        page_redirect(QString const & path, http_code_t http_code = http_code_t::HTTP_CODE_MOVED_PERMANENTLY, QString const & reason_brief = "Moved", QString const & reason = "This page has moved");
     void                        die(http_code_t err_code, QString err_name, QString const & err_description, QString const & err_details);
     void                        not_modified();
+    void                        accept_byte_ranges();
+    static bool                 parse_byte_ranges(QString const & range, int64_t size, byte_range_vector_t & ranges);
+    static QByteArray           byte_ranges_document(QByteArray const & data, byte_range_vector_t const & ranges, QByteArray const & boundary, QString const & content_type);
     static void                 define_http_name(http_code_t http_code, QString & http_name);
     void                        finish_update();
 
@@ -448,6 +465,7 @@ public:
 protected:
     pid_t                       fork_child();
     bool                        connect_cassandra(bool child);
+    bool                        reconnect_cassandra();
     virtual void                disconnect_cassandra();
     void                        canonicalize_domain();
     void                        canonicalize_website();
@@ -459,6 +477,8 @@ protected:
     bool                                        f_is_child = false;
     pid_t                                       f_child_pid = 0;
     ed::tcp_bio_client::pointer_t               f_client = ed::tcp_bio_client::pointer_t();
+    int                                         f_socket = -1;      // client socket received from the server (pre-forked child)
+    int                                         f_pool_socket = -1; // pre-forked child <-> server channel
     //libdbproxy::libdbproxy::pointer_t           f_cassandra = libdbproxy::libdbproxy::pointer_t();
     //libdbproxy::context::pointer_t              f_context = libdbproxy::context::pointer_t();
     int64_t                                     f_start_date = 0; // time request arrived
@@ -516,6 +536,9 @@ private:
     friend class messenger_runner;
     friend class child_messenger;
 
+    void                        process_request();
+    int                         receive_client();
+    ssize_t                     read_client(char * buf, size_t size);
     void                        read_environment();
     void                        mark_for_initialization();
     void                        setup_uri();
@@ -529,6 +552,8 @@ private:
     void                        write(QString const & str);
     void                        set_cache_control();
     void                        output_headers(header_mode_t modes);
+    void                        output_compression_stream(header_mode_t modes, QByteArray const & output_data, QString const & encoding, compression_stream::pointer_t stream);
+    bool                        output_byte_ranges(QByteArray & output_data);
     void                        output_cookies();
     void                        output_session_log( QString const& what );
     void                        connect_messenger();
@@ -551,6 +576,7 @@ private:
     cookie_map_t                        f_cookies = cookie_map_t();
     bool                                f_ignore_cookies = false;
     bool                                f_died = false; // die() was already called once
+    bool                                f_accept_byte_ranges = false;
     QString                             f_language = QString();
     QString                             f_country = QString();
     QString                             f_language_key = QString();
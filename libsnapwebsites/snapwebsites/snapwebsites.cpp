@@ -30,6 +30,7 @@
 #include "snapwebsites/snap_cassandra.h"
 #include "snapwebsites/snap_lock.h"
 #include "snapwebsites/snap_tables.h"
+#include "snapwebsites/xslt.h"
 
 
 // snapdev lib
@@ -824,6 +825,14 @@ server::~server()
         delete child;
     }
     f_children_running.clear();
+    //
+    for( auto const & child : f_children_warm )
+    {
+        child->cancel_prefork();
+        child->kill();
+        delete child;
+    }
+    f_children_warm.clear();
 
     // Destroy the QApplication instance.
     //
@@ -2045,6 +2054,121 @@ void server::capture_zombies(pid_t child_pid)
             --max_children;
         }
     }
+
+    // pre-forked children are not expected to die before they receive
+    // a client, but if they do, we need to capture them too
+    //
+    for(auto it(f_children_warm.begin()); it != f_children_warm.end(); )
+    {
+        if((*it)->check_status() == snap_child::status_t::SNAP_CHILD_STATUS_READY)
+        {
+            SNAP_LOG_WARNING("pre-forked child process died before it received a client.");
+
+            (*it)->cancel_prefork();
+            f_children_waiting.push_back(*it);
+            it = f_children_warm.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+
+/** \brief Make sure the pool of pre-forked children is full.
+ *
+ * When the child_pool_size parameter is set, the server keeps that many
+ * children ready to process a request. These children are created with
+ * snap_child::prefork() which connects to snapdbproxy ahead of time.
+ *
+ * The pool is only filled once all the services the children depend on
+ * are available (snapdbproxy, snaplock, and snapfirewall.)
+ */
+void server::fill_child_pool()
+{
+    if(f_child_pool_size == 0
+    || f_snapdbproxy_addr.isEmpty()
+    || !f_snaplock
+    || !f_firewall_up)
+    {
+        return;
+    }
+
+    while(f_children_warm.size() < f_child_pool_size)
+    {
+        snap_child * child(nullptr);
+
+        if(f_children_waiting.empty())
+        {
+            child = new snap_child(g_instance);
+        }
+        else
+        {
+            child = f_children_waiting.back();
+            f_children_waiting.pop_back();
+        }
+
+        if(!child->prefork())
+        {
+            // try again on the next request
+            //
+            f_children_waiting.push_back(child);
+            break;
+        }
+
+        f_children_warm.push_back(child);
+    }
+}
+
+
+/** \brief Release all the pre-forked children.
+ *
+ * This function tells all the pre-forked children to exit. This is used
+ * when the server stops or when one of the services the children depend
+ * on goes down (i.e. their database connection would not work anymore.)
+ *
+ * The children are moved to the list of running children so they get
+ * captured once they exit.
+ */
+void server::drain_child_pool()
+{
+    for(auto const & child : f_children_warm)
+    {
+        child->cancel_prefork();
+        f_children_running.push_back(child);
+    }
+    f_children_warm.clear();
+}
+
+
+/** \brief Close the server connections inherited by a pre-forked child.
+ *
+ * A pre-forked child may wait for a client for a long time. Meanwhile
+ * it should not hold the server's sockets: the listener and the
+ * channels of the other pre-forked children (otherwise these other
+ * children would not see the channel getting closed when the server
+ * exits).
+ *
+ * This function must only be called in a pre-forked child process.
+ * The parent keeps its own copy of these sockets.
+ */
+void server::close_inherited_connections()
+{
+    for(auto const & child : f_children_warm)
+    {
+        child->close_pool_socket();
+    }
+
+    if(g_connection != nullptr
+    && g_connection->f_listener != nullptr)
+    {
+        int const s(g_connection->f_listener->get_socket());
+        if(s != -1)
+        {
+            close(s);
+        }
+    }
 }
 
 
@@ -2412,6 +2536,8 @@ void server::process_message(snap_communicator_message const & message)
         f_snapdbproxy_addr.clear();
         f_snapdbproxy_port = 0;
 
+        drain_child_pool();
+
         return;
     }
 
@@ -2428,18 +2554,28 @@ void server::process_message(snap_communicator_message const & message)
                 g_connection->f_cassandra_check_timer->set_enable(true);
             }
         }
+        else
+        {
+            // children connect to snapdbproxy on their own, so we
+            // have to replace those connected to the old instance
+            //
+            drain_child_pool();
+            fill_child_pool();
+        }
         return;
     }
 
     if(command == "FIREWALLUP")
     {
         f_firewall_up = true;
+        fill_child_pool();
         return;
     }
 
     if(command == "FIREWALLDOWN")
     {
         f_firewall_up = false;
+        drain_child_pool();
         return;
     }
 
@@ -2453,6 +2589,14 @@ void server::process_message(snap_communicator_message const & message)
 
             f_snaplock = message.has_parameter("status")
                       && message.get_parameter("status") == "up";
+            if(f_snaplock)
+            {
+                fill_child_pool();
+            }
+            else
+            {
+                drain_child_pool();
+            }
         }
         // else -- ignore all others
 
@@ -2509,6 +2653,8 @@ void server::stop(bool quitting)
 {
     SNAP_LOG_INFO("Stopping server.");
 
+    drain_child_pool();
+
     if(g_connection != nullptr
     && g_connection->f_messenger != nullptr)
     {
@@ -2685,28 +2831,38 @@ listener_impl::listener_impl(server * s, std::string const & addr, int port, std
  *
  * The function retrieves the new connection socket, makes the socket
  * "keep alive" and then calls the process_connection() function of
- * the server.
+ * the server. Once the connection was released, it refills the pool
+ * of pre-forked children.
  */
 void listener_impl::process_accept()
 {
-    // a new client just connected
-    //
-    tcp_client_server::bio_client::pointer_t const new_client(accept());
-    if(!new_client)
     {
-        // TBD: should we call process_error() instead? problem is this
-        //      listener would be removed from the list of connections...
+        // a new client just connected
         //
-        int const e(errno);
-        SNAP_LOG_ERROR("accept() returned an error. (errno: ")(e)(" -- ")(strerror(e))("). No new connection will be created.");
-        return;
+        tcp_client_server::bio_client::pointer_t const new_client(accept());
+        if(!new_client)
+        {
+            // TBD: should we call process_error() instead? problem is this
+            //      listener would be removed from the list of connections...
+            //
+            int const e(errno);
+            SNAP_LOG_ERROR("accept() returned an error. (errno: ")(e)(" -- ")(strerror(e))("). No new connection will be created.");
+            return;
+        }
+
+        // process the new connection, which means create a child process
+        // and run the necessary code to return an HTML page, a document,
+        // robots.txt, etc.
+        //
+        f_server->process_connection(new_client);
     }
 
-    // process the new connection, which means create a child process
-    // and run the necessary code to return an HTML page, a document,
-    // robots.txt, etc.
+    // replace the pre-forked child used by process_connection() now
+    // that the client socket is closed on our side; a child forked
+    // earlier would inherit that socket and keep it open so snap.cgi
+    // would not see the end of the reply until that new child exits
     //
-    f_server->process_connection(new_client);
+    f_server->fill_child_pool();
 }
 
 
@@ -2844,6 +3000,50 @@ void server::listen()
     std::string const certificate(f_parameters["ssl_certificate"]);
     std::string const private_key(f_parameters["ssl_private_key"]);
 
+    // get the number of children to pre-fork (0 turns the feature off)
+    //
+    QString const child_pool_size(f_parameters["child_pool_size"]);
+    if(!child_pool_size.isEmpty())
+    {
+        long const size(child_pool_size.toLong(&ok));
+        if(!ok
+        || size < 0
+        || size > 1000)
+        {
+            SNAP_LOG_FATAL("invalid child_pool_size, a number between 0 and 1000 was expected instead of \"")(child_pool_size)("\".");
+            exit(1);
+        }
+        f_child_pool_size = size;
+    }
+    if(f_child_pool_size > 0
+    && (!certificate.empty() || !private_key.empty())
+    && addr != "127.0.0.1")
+    {
+        // the SSL state cannot be passed to the child with the socket
+        // (the listener ignores the certificate on 127.0.0.1)
+        //
+        SNAP_LOG_WARNING("child_pool_size is ignored when the connections are encrypted (ssl_certificate is defined and listen is not 127.0.0.1).");
+        f_child_pool_size = 0;
+    }
+#ifdef SNAP_NO_FORK
+    if(f_nofork)
+    {
+        f_child_pool_size = 0;
+    }
+#endif
+    if(f_child_pool_size > 0)
+    {
+        // the children save the XSLT stylesheets they compile in there
+        // so the pre-forked children can compile them ahead of time
+        //
+        QString run_path(f_parameters["run_path"]);
+        if(run_path.isEmpty())
+        {
+            run_path = "/run/snapwebsites";
+        }
+        xslt::set_compiled_cache_path(run_path + "/xslt");
+    }
+
     // get the snapcommunicator IP and port
     QString communicator_addr("127.0.0.1");
     int communicator_port(4040);
@@ -2973,6 +3173,28 @@ void server::process_connection(tcp_client_server::bio_client::pointer_t client)
     }
     else
     {
+        // use a pre-forked child if available
+        //
+        if(!f_children_warm.empty())
+        {
+            snap_child * warm(f_children_warm.back());
+            f_children_warm.pop_back();
+
+            // whether the hand over works or not, the child process is
+            // now running (it exits on its own on a failure)
+            //
+            bool const handed_over(warm->hand_over(client));
+            f_children_running.push_back(warm);
+
+            // the child gets replaced by listener_impl::process_accept()
+            // once the client socket was closed on our side
+            //
+            if(handed_over)
+            {
+                return;
+            }
+        }
+
         snap_child * child(nullptr);
 
         if(f_children_waiting.empty())
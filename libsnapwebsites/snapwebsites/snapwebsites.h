@@ -307,6 +307,7 @@ public:
     int                 snapdbproxy_port() const { return f_snapdbproxy_port; }
     QString const &     snapdbproxy_addr() const { return f_snapdbproxy_addr; }
     void                capture_zombies(pid_t child_pid);
+    void                close_inherited_connections();
     void                process_message(ed::message const & message);
 
     unsigned long       connections_count();
@@ -373,6 +374,8 @@ private:
     static void                 sigloghandler( int sig );
 
     void                        process_connection(ed::tcp_bio_client::pointer_t client);
+    void                        fill_child_pool();
+    void                        drain_child_pool();
     void                        stop_thread_func();
     void                        stop(bool quitting);
 
@@ -395,6 +398,8 @@ private:
     uint64_t                    f_connections_count = 0;
     snap_child_vector_t         f_children_running = snap_child_vector_t();
     snap_child_vector_t         f_children_waiting = snap_child_vector_t();
+    snap_child_vector_t         f_children_warm = snap_child_vector_t();
+    size_t                      f_child_pool_size = 0;
 
     getopt_ptr_t                f_opt = getopt_ptr_t();
 
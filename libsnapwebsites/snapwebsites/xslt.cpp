@@ -31,9 +31,30 @@
 
 // Qt lib
 //
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
 #include <QXmlQuery>
 
 
+// snaplogger lib
+//
+#include <snaplogger/message.h>
+
+
+// C++ lib
+//
+#include <map>
+
+
+// C lib
+//
+#include <stdio.h>
+#include <unistd.h>
+#include <utime.h>
+
+
 // last include
 //
 #include <snapdev/poison.h>
@@ -45,6 +66,362 @@ namespace snap
 {
 
 
+namespace
+{
+
+
+/** \brief Message handler attached to a compiled query.
+ *
+ * A compiled query is used by many evaluations, each with its own
+ * QMessageHandler on the stack. The query keeps a pointer to this
+ * handler instead, which lives as long as the query, and the handler
+ * forwards the messages to the QMessageHandler of the evaluation
+ * currently running (if any).
+ */
+class message_forwarder
+    : public QAbstractMessageHandler
+{
+public:
+    void set_target(QAbstractMessageHandler * target)
+    {
+        f_target = target;
+    }
+
+protected:
+    virtual void handleMessage(QtMsgType type, QString const & description, QUrl const & identifier, QSourceLocation const & source_location) override
+    {
+        if(f_target != nullptr)
+        {
+            f_target->message(type, description, identifier, source_location);
+        }
+    }
+
+private:
+    QAbstractMessageHandler *   f_target = nullptr;
+};
+
+
+/** \brief Attach a message handler to a forwarder for one evaluation.
+ *
+ * The handler gets detached when this object goes out of scope, before
+ * the handler itself gets destroyed.
+ */
+class message_target
+{
+public:
+    message_target(message_forwarder & forwarder, QAbstractMessageHandler * target)
+        : f_forwarder(forwarder)
+    {
+        f_forwarder.set_target(target);
+    }
+
+    message_target(message_target const &) = delete;
+    message_target & operator = (message_target const &) = delete;
+
+    ~message_target()
+    {
+        f_forwarder.set_target(nullptr);
+    }
+
+private:
+    message_forwarder &         f_forwarder;
+};
+
+
+/** \brief A query which was already compiled.
+ *
+ * Compiling an XSLT 2.0 stylesheet is expensive (our themes are several
+ * Kb). When the same stylesheet gets used again, we keep the QXmlQuery
+ * object around and only change its focus (the input document) and
+ * variables on the following evaluations.
+ *
+ * The cache lives in the snap_child process which handles one request
+ * and then exits. To get hits on the first evaluation of a request, the
+ * stylesheets compiled by the children get saved in the directory
+ * defined with set_compiled_cache_path(). A pre-forked child compiles
+ * the most recently used ones with warm_compiled_cache() while it waits
+ * for its client. It does not yet know which website the client wants,
+ * so it warms the stylesheets most recently used by all the websites.
+ * The other hits come from stylesheets evaluated several times in the
+ * same request, mainly the layout boxes which all use the same box
+ * stylesheet. The hits and misses are logged at the TRACE level.
+ *
+ * The message handler is declared before the query so it gets
+ * destroyed after the query.
+ */
+struct compiled_query_t
+{
+    typedef std::shared_ptr<compiled_query_t>   pointer_t;
+
+    message_forwarder           f_message_handler;
+    QXmlQuery                   f_query = QXmlQuery(QXmlQuery::XSLT20);
+    bool                        f_compiled = false;
+    bool                        f_used = false;
+    uint64_t                    f_last_used = 0;
+};
+
+
+typedef std::map<QByteArray, compiled_query_t::pointer_t>  compiled_query_map_t;
+
+
+/** \brief The cache of compiled queries.
+ *
+ * The key is a checksum of the XSLT stylesheet followed by the names
+ * of the variables bound to the query (a query is compiled against
+ * a specific set of variables).
+ */
+compiled_query_map_t        g_compiled_queries = compiled_query_map_t();
+
+
+/** \brief Maximum number of compiled queries kept in the cache.
+ *
+ * Each website has a few layouts and each layout has a body and a theme
+ * stylesheet. Plugins such as the editor and form have a few more.
+ * When the cache is full, the least recently used query gets removed.
+ *
+ * Setting this value to zero turns off the cache.
+ */
+size_t                      g_compiled_cache_size = 32;
+
+
+/** \brief Counter used to find the least recently used query.
+ */
+uint64_t                    g_compiled_usage = 0;
+
+
+/** \brief Number of evaluations which found their query in the cache.
+ */
+uint64_t                    g_compiled_hits = 0;
+
+
+/** \brief Number of evaluations which had to compile their query.
+ */
+uint64_t                    g_compiled_misses = 0;
+
+
+/** \brief Directory where the compiled stylesheets get saved.
+ *
+ * When empty, the stylesheets do not get saved and the cache cannot
+ * be warmed.
+ */
+QString                     g_compiled_cache_path = QString();
+
+
+/** \brief Compute the key of a compiled query.
+ *
+ * \param[in] xsl  The XSLT stylesheet.
+ * \param[in] names  The names of the variables bound to the query.
+ *
+ * \return The key of the query in the cache.
+ */
+QByteArray compiled_key(QString const & xsl, QStringList const & names)
+{
+    QByteArray key(QCryptographicHash::hash(xsl.toUtf8(), QCryptographicHash::Md5));
+    for(auto const & n : names)
+    {
+        key += '\0';
+        key += n.toUtf8();
+    }
+    return key;
+}
+
+
+/** \brief Get the name of the file of a compiled query.
+ *
+ * \param[in] key  The key of the query.
+ *
+ * \return The name of the file where the stylesheet gets saved.
+ */
+QString compiled_filename(QByteArray const & key)
+{
+    return g_compiled_cache_path
+         + "/"
+         + QString::fromUtf8(QCryptographicHash::hash(key, QCryptographicHash::Md5).toHex())
+         + ".xsl";
+}
+
+
+/** \brief Save a stylesheet so the next children can warm their cache.
+ *
+ * The first line of the file has the names of the variables, the rest
+ * is the stylesheet. If the file already exists, its modification time
+ * gets updated instead so warm_compiled_cache() knows it was recently
+ * used.
+ *
+ * \param[in] key  The key of the query.
+ * \param[in] xsl  The XSLT stylesheet.
+ * \param[in] names  The names of the variables bound to the query.
+ */
+void save_compiled_query(QByteArray const & key, QString const & xsl, QStringList const & names)
+{
+    if(g_compiled_cache_path.isEmpty())
+    {
+        return;
+    }
+
+    QString const filename(compiled_filename(key));
+    QByteArray const name(QFile::encodeName(filename));
+    if(utime(name.data(), nullptr) == 0)
+    {
+        return;
+    }
+
+    // other children may save the same file, write to a temporary
+    // file and rename it so a reader never sees a partial file
+    //
+    QDir().mkpath(g_compiled_cache_path);
+    QString const tmp(QString("%1.%2").arg(filename).arg(getpid()));
+    QFile out(tmp);
+    if(!out.open(QIODevice::WriteOnly))
+    {
+        SNAP_LOG_WARNING("could not save compiled XSLT stylesheet to "")(tmp)("".");
+        return;
+    }
+    out.write(names.join(' ').toUtf8());
+    out.write("\n");
+    out.write(xsl.toUtf8());
+    out.close();
+
+    QByteArray const tmp_name(QFile::encodeName(tmp));
+    if(rename(tmp_name.data(), name.data()) != 0)
+    {
+        unlink(tmp_name.data());
+    }
+}
+
+
+}
+// no name namespace
+
+
+
+/** \brief Change the number of compiled queries kept in memory.
+ *
+ * This function changes the maximum number of compiled XSLT queries
+ * kept in memory. The default is 32. Setting the size to zero turns
+ * off the cache so every evaluation compiles the stylesheet again.
+ *
+ * \param[in] size  The new maximum number of compiled queries.
+ */
+void xslt::set_compiled_cache_size(size_t size)
+{
+    g_compiled_cache_size = size;
+    if(g_compiled_queries.size() > size)
+    {
+        clear_compiled_cache();
+    }
+}
+
+
+/** \brief Define the directory where compiled stylesheets get saved.
+ *
+ * Each stylesheet compiled by this process gets saved in that directory
+ * so the next processes can compile it ahead of time with
+ * warm_compiled_cache().
+ *
+ * \param[in] path  The directory to use, empty to not save anything.
+ */
+void xslt::set_compiled_cache_path(QString const & path)
+{
+    g_compiled_cache_path = path;
+}
+
+
+/** \brief Compile the stylesheets most recently used by other processes.
+ *
+ * This function is called by a pre-forked child while it waits for a
+ * client. It compiles up to the cache size of the stylesheets found in
+ * the directory defined by set_compiled_cache_path(), the most recently
+ * used first. The first evaluation of those stylesheets is then a hit.
+ *
+ * The files which were not used in the last day get deleted.
+ */
+void xslt::warm_compiled_cache()
+{
+    if(g_compiled_cache_path.isEmpty()
+    || g_compiled_cache_size == 0)
+    {
+        return;
+    }
+
+    QDir const dir(g_compiled_cache_path);
+    QFileInfoList const files(dir.entryInfoList(QStringList("*.xsl"), QDir::Files, QDir::Time));
+    QDateTime const expired(QDateTime::currentDateTime().addDays(-1));
+    size_t warmed(0);
+    for(auto const & info : files)
+    {
+        if(g_compiled_queries.size() >= g_compiled_cache_size)
+        {
+            if(info.lastModified() < expired)
+            {
+                QFile::remove(info.filePath());
+            }
+            continue;
+        }
+
+        QFile in(info.filePath());
+        if(!in.open(QIODevice::ReadOnly))
+        {
+            continue;
+        }
+        QByteArray const content(in.readAll());
+        int const eol(content.indexOf('\n'));
+        if(eol < 0)
+        {
+            continue;
+        }
+        QStringList const names(QString::fromUtf8(content.left(eol)).split(' ', QString::SkipEmptyParts));
+        QString const xsl(QString::fromUtf8(content.mid(eol + 1)));
+        QByteArray const key(compiled_key(xsl, names));
+        if(g_compiled_queries.find(key) != g_compiled_queries.end())
+        {
+            continue;
+        }
+
+        // the variables have to be bound before the stylesheet gets
+        // compiled, the actual values are bound on each evaluation
+        //
+        compiled_query_t::pointer_t compiled(std::make_shared<compiled_query_t>());
+        QMessageHandler msg;
+        msg.set_xsl(xsl);
+        message_target const target(compiled->f_message_handler, &msg);
+        compiled->f_query.setMessageHandler(&compiled->f_message_handler);
+        compiled->f_query.setFocus(QString("<snap/>"));
+        for(auto const & n : names)
+        {
+            compiled->f_query.bindVariable(n, QVariant(QString()));
+        }
+        compiled->f_query.setQuery(xsl);
+        if(!compiled->f_query.isValid())
+        {
+            QFile::remove(info.filePath());
+            continue;
+        }
+        compiled->f_compiled = true;
+
+        ++g_compiled_usage;
+        compiled->f_last_used = g_compiled_usage;
+        g_compiled_queries[key] = compiled;
+        ++warmed;
+    }
+
+    SNAP_LOG_TRACE("XSLT compiled query cache warmed with ")
+                  (warmed)
+                  (" stylesheets.");
+}
+
+
+/** \brief Remove all the compiled queries from memory.
+ *
+ * This function can be used to release the memory used by the
+ * compiled XSLT queries.
+ */
+void xslt::clear_compiled_cache()
+{
+    g_compiled_queries.clear();
+}
+
+
 /** \brief Save the XSLT parser.
  *
  * This function receives a copy of the XSLT parser in the form of a string.
@@ -262,9 +639,61 @@ void xslt::evaluate(QString * output_string, QDomDocument * output_document)
 {
     bool first_attempt(true);
 
+    // search for an already compiled version of this XSLT stylesheet
+    //
+    compiled_query_t::pointer_t compiled;
+    QByteArray key;
+    if(g_compiled_cache_size > 0)
+    {
+        key = compiled_key(f_xsl, f_variables.keys());
+
+        auto it(g_compiled_queries.find(key));
+        if(it == g_compiled_queries.end())
+        {
+            if(g_compiled_queries.size() >= g_compiled_cache_size)
+            {
+                auto lru(g_compiled_queries.begin());
+                for(auto q(g_compiled_queries.begin()); q != g_compiled_queries.end(); ++q)
+                {
+                    if(q->second->f_last_used < lru->second->f_last_used)
+                    {
+                        lru = q;
+                    }
+                }
+                g_compiled_queries.erase(lru);
+            }
+
+            compiled = std::make_shared<compiled_query_t>();
+            g_compiled_queries[key] = compiled;
+            ++g_compiled_misses;
+        }
+        else
+        {
+            compiled = it->second;
+            ++g_compiled_hits;
+        }
+
+        ++g_compiled_usage;
+        compiled->f_last_used = g_compiled_usage;
+
+        SNAP_LOG_TRACE("XSLT compiled query cache: ")
+                      (g_compiled_hits)
+                      (" hits, ")
+                      (g_compiled_misses)
+                      (" misses.");
+    }
+
     for(;;)
     {
-        QXmlQuery q(QXmlQuery::XSLT20);
+        // keep the compiled query alive for this attempt even if it gets
+        // removed from the cache
+        //
+        compiled_query_t::pointer_t const current(compiled);
+
+        message_forwarder uncached_handler;
+        QXmlQuery uncached_query(QXmlQuery::XSLT20);
+        QXmlQuery & q(current != nullptr ? current->f_query : uncached_query);
+        message_forwarder & handler(current != nullptr ? current->f_message_handler : uncached_handler);
 
         QString doc_str(f_input);
         if(doc_str.isEmpty())
@@ -301,7 +730,13 @@ void xslt::evaluate(QString * output_string, QDomDocument * output_document)
 #endif
 
         // setup the XML query object
-        q.setMessageHandler(&msg);
+        //
+        // the query keeps a pointer to its handler, which for a compiled
+        // query outlives msg, so the handler forwards the messages to msg
+        // only while this evaluation runs
+        //
+        message_target const target(handler, &msg);
+        q.setMessageHandler(&handler);
         q.setFocus(doc_str);
 
         // set variables
@@ -319,15 +754,39 @@ void xslt::evaluate(QString * output_string, QDomDocument * output_document)
         }
 
         // setup the transformation data
-        q.setQuery(f_xsl);
+        //
+        // (a compiled query already has it)
+        //
+        if(compiled == nullptr
+        || !compiled->f_compiled)
+        {
+            q.setQuery(f_xsl);
+        }
         if(!q.isValid())
         {
+            // never keep an invalid query in the cache
+            //
+            if(compiled != nullptr)
+            {
+                g_compiled_queries.erase(key);
+                compiled.reset();
+            }
+
             if(first_attempt)
             {
                 goto try_again;
             }
             throw xslt_evaluation_error("Invalid XSLT query detected by Qt.");
         }
+        if(compiled != nullptr)
+        {
+            compiled->f_compiled = true;
+            if(!compiled->f_used)
+            {
+                compiled->f_used = true;
+                save_compiled_query(key, f_xsl, f_variables.keys());
+            }
+        }
 
         if(output_document != nullptr)
         {
@@ -56,6 +56,11 @@ public:
     static QString          filter_entities_out(QString const & html);
     static QString          convert_entity(QString const & entity_name);
 
+    static void             set_compiled_cache_size(size_t size);
+    static void             set_compiled_cache_path(QString const & path);
+    static void             warm_compiled_cache();
+    static void             clear_compiled_cache();
+
 private:
     void                    evaluate(QString * output_string, QDomDocument * output_document);
 
@@ -0,0 +1,251 @@
+// libsnapwebsites -- Test Suite
+// Copyright (c) 2019  Made to Order Software Corp.  All Rights Reserved
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+/** \file
+ * \brief Verify the HTTP Range support of the snap_child class.
+ *
+ * These tests verify the parsing of the Range header and the generation
+ * of the "multipart/byteranges" document sent when more than one range
+ * is requested.
+ */
+
+// self
+//
+#include "catch_tests.h"
+
+// libsnapwebsites
+//
+#include "snapwebsites/snap_child.h"
+
+
+namespace
+{
+
+
+void verify_ranges(snap::snap_child::byte_range_vector_t const & ranges, std::vector<std::pair<int64_t, int64_t>> const & expected)
+{
+    CATCH_REQUIRE(ranges.size() == expected.size());
+    for(size_t idx(0); idx < expected.size(); ++idx)
+    {
+        CATCH_REQUIRE(ranges[idx].f_first == expected[idx].first);
+        CATCH_REQUIRE(ranges[idx].f_last == expected[idx].second);
+    }
+}
+
+
+}
+// no name namespace
+
+
+CATCH_TEST_CASE("byte_ranges", "[byte_ranges]")
+{
+    CATCH_SECTION("simple ranges")
+    {
+        snap::snap_child::byte_range_vector_t ranges;
+
+        CATCH_REQUIRE(snap::snap_child::parse_byte_ranges("bytes=0-499", 10000, ranges));
+        verify_ranges(ranges, {{0, 499}});
+
+        CATCH_REQUIRE(snap::snap_child::parse_byte_ranges("Bytes = 500-999", 10000, ranges));
+        verify_ranges(ranges, {{500, 999}});
+
+        // open-ended range goes to the end of the document
+        //
+        CATCH_REQUIRE(snap::snap_child::parse_byte_ranges("bytes=9500-", 10000, ranges));
+        verify_ranges(ranges, {{9500, 9999}});
+
+        // the last position gets clamped to the size of the document
+        //
+        CATCH_REQUIRE(snap::snap_child::parse_byte_ranges("bytes=9000-20000", 10000, ranges));
+        verify_ranges(ranges, {{9000, 9999}});
+    }
+
+    CATCH_SECTION("suffix ranges")
+    {
+        snap::snap_child::byte_range_vector_t ranges;
+
+        CATCH_REQUIRE(snap::snap_child::parse_byte_ranges("bytes=-500", 10000, ranges));
+        verify_ranges(ranges, {{9500, 9999}});
+
+        // a suffix larger than the document returns the whole document
+        //
+        CATCH_REQUIRE(snap::snap_child::parse_byte_ranges("bytes=-20000", 10000, ranges));
+        verify_ranges(ranges, {{0, 9999}});
+
+        // an empty suffix is not satisfiable
+        //
+        CATCH_REQUIRE(snap::snap_child::parse_byte_ranges("bytes=-0", 10000, ranges));
+        CATCH_REQUIRE(ranges.empty());
+    }
+
+    CATCH_SECTION("overlapping and adjacent ranges get merged")
+    {
+        snap::snap_child::byte_range_vector_t ranges;
+
+        // overlapping, given out of order
+        //
+        CATCH_REQUIRE(snap::snap_child::parse_byte_ranges("bytes=500-700,100-200,150-600", 10000, ranges));
+        verify_ranges(ranges, {{100, 700}});
+
+        // adjacent
+        //
+        CATCH_REQUIRE(snap::snap_child::parse_byte_ranges("bytes=0-99,100-199", 10000, ranges));
+        verify_ranges(ranges, {{0, 199}});
+
+        // a range included in another one
+        //
+        CATCH_REQUIRE(snap::snap_child::parse_byte_ranges("bytes=0-999,10-20", 10000, ranges));
+        verify_ranges(ranges, {{0, 999}});
+
+        // a suffix overlapping an open-ended range
+        //
+        CATCH_REQUIRE(snap::snap_child::parse_byte_ranges("bytes=9000-,-500", 10000, ranges));
+        verify_ranges(ranges, {{9000, 9999}});
+    }
+
+    CATCH_SECTION("multiple ranges")
+    {
+        snap::snap_child::byte_range_vector_t ranges;
+
+        CATCH_REQUIRE(snap::snap_child::parse_byte_ranges("bytes=500-599, 0-9 ,-10", 10000, ranges));
+        verify_ranges(ranges, {{0, 9}, {500, 599}, {9990, 9999}});
+
+        // empty specs are ignored
+        //
+        CATCH_REQUIRE(snap::snap_child::parse_byte_ranges("bytes=0-9,,20-29,", 10000, ranges));
+        verify_ranges(ranges, {{0, 9}, {20, 29}});
+
+        // exactly the maximum number of ranges
+        //
+        QString range("bytes=");
+        for(int idx(0); idx < 20; ++idx)
+        {
+            if(idx != 0)
+            {
+                range += ",";
+            }
+            range += QString("%1-%2").arg(idx * 100).arg(idx * 100 + 9);
+        }
+        CATCH_REQUIRE(snap::snap_child::parse_byte_ranges(range, 10000, ranges));
+        CATCH_REQUIRE(ranges.size() == 20);
+        CATCH_REQUIRE(ranges[19].f_first == 1900);
+        CATCH_REQUIRE(ranges[19].f_last == 1909);
+    }
+
+    CATCH_SECTION("unsatisfiable ranges")
+    {
+        snap::snap_child::byte_range_vector_t ranges;
+
+        // valid but past the end of the document: the caller replies
+        // with a 416
+        //
+        CATCH_REQUIRE(snap::snap_child::parse_byte_ranges("bytes=10000-10099", 10000, ranges));
+        CATCH_REQUIRE(ranges.empty());
+
+        CATCH_REQUIRE(snap::snap_child::parse_byte_ranges("bytes=10000-", 10000, ranges));
+        CATCH_REQUIRE(ranges.empty());
+
+        CATCH_REQUIRE(snap::snap_child::parse_byte_ranges("bytes=-100", 0, ranges));
+        CATCH_REQUIRE(ranges.empty());
+
+        // the satisfiable ranges are kept
+        //
+        CATCH_REQUIRE(snap::snap_child::parse_byte_ranges("bytes=20000-20099,0-9", 10000, ranges));
+        verify_ranges(ranges, {{0, 9}});
+    }
+
+    CATCH_SECTION("invalid ranges")
+    {
+        snap::snap_child::byte_range_vector_t ranges;
+
+        // the Range header is then ignored
+        //
+        CATCH_REQUIRE_FALSE(snap::snap_child::parse_byte_ranges("", 10000, ranges));
+        CATCH_REQUIRE_FALSE(snap::snap_child::parse_byte_ranges("0-499", 10000, ranges));
+        CATCH_REQUIRE_FALSE(snap::snap_child::parse_byte_ranges("=0-499", 10000, ranges));
+        CATCH_REQUIRE_FALSE(snap::snap_child::parse_byte_ranges("items=0-499", 10000, ranges));
+        CATCH_REQUIRE_FALSE(snap::snap_child::parse_byte_ranges("bytes=499", 10000, ranges));
+        CATCH_REQUIRE_FALSE(snap::snap_child::parse_byte_ranges("bytes=500-499", 10000, ranges));
+        CATCH_REQUIRE_FALSE(snap::snap_child::parse_byte_ranges("bytes=a-499", 10000, ranges));
+        CATCH_REQUIRE_FALSE(snap::snap_child::parse_byte_ranges("bytes=0-b", 10000, ranges));
+        CATCH_REQUIRE_FALSE(snap::snap_child::parse_byte_ranges("bytes=-c", 10000, ranges));
+        CATCH_REQUIRE_FALSE(snap::snap_child::parse_byte_ranges("bytes=--5", 10000, ranges));
+
+        // one invalid spec invalidates the whole header
+        //
+        CATCH_REQUIRE_FALSE(snap::snap_child::parse_byte_ranges("bytes=0-9,20-10", 10000, ranges));
+
+        // too many ranges
+        //
+        QString range("bytes=");
+        for(int idx(0); idx < 21; ++idx)
+        {
+            if(idx != 0)
+            {
+                range += ",";
+            }
+            range += QString("%1-%2").arg(idx * 100).arg(idx * 100 + 9);
+        }
+        CATCH_REQUIRE_FALSE(snap::snap_child::parse_byte_ranges(range, 10000, ranges));
+    }
+
+    CATCH_SECTION("multipart document")
+    {
+        QByteArray const data("0123456789abcdefghijklmnopqrstuvwxyz");
+        snap::snap_child::byte_range_vector_t ranges;
+        CATCH_REQUIRE(snap::snap_child::parse_byte_ranges("bytes=-3,0-4,10-12", data.size(), ranges));
+        verify_ranges(ranges, {{0, 4}, {10, 12}, {33, 35}});
+
+        CATCH_REQUIRE(snap::snap_child::byte_ranges_document(data, ranges, "BOUNDARY", "text/plain")
+                == "\r\n--BOUNDARY\r\n"
+                   "Content-Type: text/plain\r\n"
+                   "Content-Range: bytes 0-4/36\r\n"
+                   "\r\n"
+                   "01234"
+                   "\r\n--BOUNDARY\r\n"
+                   "Content-Type: text/plain\r\n"
+                   "Content-Range: bytes 10-12/36\r\n"
+                   "\r\n"
+                   "abc"
+                   "\r\n--BOUNDARY\r\n"
+                   "Content-Type: text/plain\r\n"
+                   "Content-Range: bytes 33-35/36\r\n"
+                   "\r\n"
+                   "xyz"
+                   "\r\n--BOUNDARY--\r\n");
+
+        // without a Content-Type, the parts only include the Content-Range
+        //
+        CATCH_REQUIRE(snap::snap_child::byte_ranges_document(data, ranges, "BOUNDARY", QString())
+                == "\r\n--BOUNDARY\r\n"
+                   "Content-Range: bytes 0-4/36\r\n"
+                   "\r\n"
+                   "01234"
+                   "\r\n--BOUNDARY\r\n"
+                   "Content-Range: bytes 10-12/36\r\n"
+                   "\r\n"
+                   "abc"
+                   "\r\n--BOUNDARY\r\n"
+                   "Content-Range: bytes 33-35/36\r\n"
+                   "\r\n"
+                   "xyz"
+                   "\r\n--BOUNDARY--\r\n");
+    }
+}
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,113 @@
+// libsnapwebsites -- Test Suite
+// Copyright (c) 2019  Made to Order Software Corp.  All Rights Reserved
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+/** \file
+ * \brief Verify the db_prefetch class.
+ *
+ * These tests verify the bookkeeping of the db_prefetch class: how the
+ * requests get grouped per row and that the values cannot be retrieved
+ * before execute() was called.
+ *
+ * \attention
+ * The tests do not connect to a database so they never add a request
+ * and call execute() at the same time. The actual reads are verified
+ * by the snapserver plugins (content::path_info_t and links) running
+ * against a test database.
+ */
+
+// self
+//
+#include "catch_tests.h"
+
+// libsnapwebsites
+//
+#include "snapwebsites/db_prefetch.h"
+
+
+CATCH_TEST_CASE("db_prefetch", "[db_prefetch]")
+{
+    CATCH_SECTION("requests are grouped per row")
+    {
+        libdbproxy::table::pointer_t table;
+        snap::db_prefetch prefetch;
+
+        CATCH_REQUIRE(prefetch.size() == 0);
+
+        prefetch.add(table, "page-1", "content::status");
+        CATCH_REQUIRE(prefetch.size() == 1);
+
+        // same row, another cell
+        //
+        prefetch.add(table, "page-1", "content::primary_owner");
+        CATCH_REQUIRE(prefetch.size() == 1);
+
+        // same row, same cell
+        //
+        prefetch.add(table, "page-1", "content::status");
+        CATCH_REQUIRE(prefetch.size() == 1);
+
+        // same row, a prefix
+        //
+        prefetch.add_prefix(table, "page-1", "links::");
+        CATCH_REQUIRE(prefetch.size() == 1);
+
+        // another row
+        //
+        prefetch.add_prefix(table, "page-2", "links::");
+        CATCH_REQUIRE(prefetch.size() == 2);
+    }
+
+    CATCH_SECTION("values are not available before execute()")
+    {
+        libdbproxy::table::pointer_t table;
+        snap::db_prefetch prefetch;
+
+        CATCH_REQUIRE_THROWS_AS(
+                  prefetch.exists(table, "page-1", "content::status")
+                , snap::db_prefetch_not_executed);
+        CATCH_REQUIRE_THROWS_AS(
+                  prefetch.get_value(table, "page-1", "content::status")
+                , snap::db_prefetch_not_executed);
+        CATCH_REQUIRE_THROWS_AS(
+                  prefetch.get_values(table, "page-1")
+                , snap::db_prefetch_not_executed);
+    }
+
+    CATCH_SECTION("execute() without requests")
+    {
+        libdbproxy::table::pointer_t table;
+        snap::db_prefetch prefetch;
+
+        CATCH_REQUIRE(prefetch.execute() == 0);
+
+        // rows which were not requested are returned empty
+        //
+        CATCH_REQUIRE_FALSE(prefetch.exists(table, "page-1", "content::status"));
+        CATCH_REQUIRE(prefetch.get_value(table, "page-1", "content::status").nullValue());
+        CATCH_REQUIRE(prefetch.get_values(table, "page-1").empty());
+
+        // adding a request invalidates the previous execute()
+        //
+        prefetch.add(table, "page-1", "content::status");
+        CATCH_REQUIRE_THROWS_AS(
+                  prefetch.get_value(table, "page-1", "content::status")
+                , snap::db_prefetch_not_executed);
+    }
+}
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,283 @@
+// Copyright (c) 2019  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+//
+// This benchmark measures the time it takes to apply an XSLT stylesheet
+// to small pages with and without the cache of compiled stylesheets.
+// The pages alternate between two documents so a cached stylesheet
+// has to apply to a new document each time. It also measures the first
+// evaluation after a new process warmed its cache from the stylesheets
+// saved by another process.
+//
+// The stylesheet is generated so it has a size similar to our themes
+// (a few Kb with many templates). Use --templates to change its size
+// and --count to change the number of evaluations.
+//
+
+
+// snapwebsites lib
+//
+#include <snapwebsites/xslt.h>
+
+
+// Qt lib
+//
+#include <QDir>
+
+
+// C++ lib
+//
+#include <chrono>
+#include <iostream>
+
+
+// C lib
+//
+#include <stdlib.h>
+#include <string.h>
+
+
+// last include
+//
+#include <snapdev/poison.h>
+
+
+
+
+
+
+namespace
+{
+
+
+int g_count = 1000;
+int g_templates = 100;
+
+
+QString create_xsl()
+{
+    QString xsl(
+            "<?xml version=\"1.0\"?>"
+            "<xsl:stylesheet version=\"2.0\""
+                " xmlns:xsl=\"http://www.w3.org/1999/XSL/Transform\">"
+              "<xsl:template match=\"snap\">"
+                "<output>"
+                  "<xsl:apply-templates select=\"page/body/*\"/>"
+                "</output>"
+              "</xsl:template>");
+
+    for(int i(0); i < g_templates; ++i)
+    {
+        QString const n(QString::number(i));
+        xsl += "<xsl:template match=\"field" + n + "\">"
+                 "<div class=\"field field" + n + "\">"
+                   "<xsl:if test=\"@title\">"
+                     "<h2><xsl:value-of select=\"@title\"/></h2>"
+                   "</xsl:if>"
+                   "<xsl:choose>"
+                     "<xsl:when test=\"@mode = 'list'\">"
+                       "<ul><xsl:for-each select=\"item\"><li><xsl:copy-of select=\"node()\"/></li></xsl:for-each></ul>"
+                     "</xsl:when>"
+                     "<xsl:otherwise>"
+                       "<p><xsl:copy-of select=\"node()\"/></p>"
+                     "</xsl:otherwise>"
+                   "</xsl:choose>"
+                 "</div>"
+               "</xsl:template>";
+    }
+
+    xsl += "</xsl:stylesheet>";
+
+    return xsl;
+}
+
+
+QString create_document(int page)
+{
+    QString doc("<snap><page><body>");
+
+    for(int i(0); i < 10; ++i)
+    {
+        QString const n(QString::number((i * 7 + page) % g_templates));
+        doc += "<field" + n + " title=\"Field " + n + "\" mode=\"list\">"
+                 "<item>First <b>item</b> of page " + QString::number(page) + "</item>"
+                 "<item>Second item</item>"
+               "</field" + n + ">";
+    }
+
+    doc += "</body></page></snap>";
+
+    return doc;
+}
+
+
+double run(QString const & xsl, QStringList const & docs, QStringList & results)
+{
+    results.clear();
+    for(int i(0); i < docs.size(); ++i)
+    {
+        results << QString();
+    }
+
+    std::chrono::steady_clock::time_point const start(std::chrono::steady_clock::now());
+
+    for(int i(0); i < g_count; ++i)
+    {
+        int const page(i % docs.size());
+        snap::xslt x;
+        x.set_xsl(xsl);
+        x.set_document(docs[page]);
+        results[page] = x.evaluate_to_string();
+    }
+
+    std::chrono::steady_clock::time_point const end(std::chrono::steady_clock::now());
+
+    return std::chrono::duration<double, std::micro>(end - start).count() / g_count;
+}
+
+
+double first_evaluation(QString const & xsl, QString const & doc, QString & result)
+{
+    std::chrono::steady_clock::time_point const start(std::chrono::steady_clock::now());
+
+    snap::xslt x;
+    x.set_xsl(xsl);
+    x.set_document(doc);
+    result = x.evaluate_to_string();
+
+    std::chrono::steady_clock::time_point const end(std::chrono::steady_clock::now());
+
+    return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+
+}
+// no name namespace
+
+
+
+int main(int argc, char * argv[])
+{
+    try
+    {
+        for(int i(1); i < argc; ++i)
+        {
+            if(strcmp(argv[i], "--count") == 0)
+            {
+                ++i;
+                if(i >= argc)
+                {
+                    std::cerr << "error: --count expects a number." << std::endl;
+                    return 1;
+                }
+                g_count = std::stoi(argv[i]);
+            }
+            else if(strcmp(argv[i], "--templates") == 0)
+            {
+                ++i;
+                if(i >= argc)
+                {
+                    std::cerr << "error: --templates expects a number." << std::endl;
+                    return 1;
+                }
+                g_templates = std::stoi(argv[i]);
+            }
+            else
+            {
+                std::cerr << "error: unknown option \"" << argv[i] << "\"." << std::endl;
+                return 1;
+            }
+        }
+        if(g_count < 2
+        || g_templates < 1)
+        {
+            std::cerr << "error: --count must be at least 2 and --templates must be positive." << std::endl;
+            return 1;
+        }
+
+        QString const xsl(create_xsl());
+        QStringList const docs{ create_document(0), create_document(1) };
+
+        snap::xslt::set_compiled_cache_size(0);
+        QStringList uncached_results;
+        double const uncached(run(xsl, docs, uncached_results));
+
+        snap::xslt::set_compiled_cache_size(32);
+        QStringList cached_results;
+        double const cached(run(xsl, docs, cached_results));
+
+        if(uncached_results != cached_results)
+        {
+            std::cerr << "error: the cached and uncached results differ." << std::endl;
+            return 1;
+        }
+        if(cached_results[0] == cached_results[1])
+        {
+            std::cerr << "error: the cached stylesheet gave the same result for two different documents." << std::endl;
+            return 1;
+        }
+
+        // a new process warms its cache with the stylesheet saved by
+        // the previous one, then applies it to a new document
+        //
+        char cache_path[] = "/tmp/benchmark_xslt-XXXXXX";
+        if(mkdtemp(cache_path) == nullptr)
+        {
+            std::cerr << "error: could not create a temporary directory." << std::endl;
+            return 1;
+        }
+        snap::xslt::set_compiled_cache_path(cache_path);
+        snap::xslt::clear_compiled_cache();
+        QString saved_result;
+        double const cold(first_evaluation(xsl, docs[0], saved_result));
+
+        snap::xslt::clear_compiled_cache();
+        std::chrono::steady_clock::time_point const start(std::chrono::steady_clock::now());
+        snap::xslt::warm_compiled_cache();
+        std::chrono::steady_clock::time_point const end(std::chrono::steady_clock::now());
+        double const warming(std::chrono::duration<double, std::micro>(end - start).count());
+        QString warm_result;
+        double const warm(first_evaluation(xsl, docs[1], warm_result));
+
+        snap::xslt::set_compiled_cache_path(QString());
+        QDir(cache_path).removeRecursively();
+
+        if(saved_result != cached_results[0]
+        || warm_result != cached_results[1])
+        {
+            std::cerr << "error: the warmed stylesheet gave a different result." << std::endl;
+            return 1;
+        }
+
+        std::cout << "stylesheet size:  " << xsl.length() << " characters" << std::endl
+                  << "without cache:    " << uncached << " us per evaluation" << std::endl
+                  << "with cache:       " << cached << " us per evaluation" << std::endl
+                  << "first evaluation: " << cold << " us cold, " << warm << " us after warming the cache in " << warming << " us" << std::endl;
+    }
+    catch(std::exception const & e)
+    {
+        std::cerr << "error: an exception occurred: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+
+// vim: ts=4 sw=4 et
@@ -914,6 +914,11 @@ int snap_cgi::process()
             }
             wrote += r;
 
+            // large pages are sent compressed as they get generated,
+            // pass them on to Apache right away
+            //
+            fflush(stdout);
+
             try
             {
                 cache_data(buf, r);
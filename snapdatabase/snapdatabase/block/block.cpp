@@ -29,6 +29,7 @@
 //
 #include    "snapdatabase/block/block.h"
 
+#include    "snapdatabase/block/block_header.h"
 #include    "snapdatabase/exception.h"
 #include    "snapdatabase/database/table.h"
 #include    "snapdatabase/data/structure.h"
@@ -41,6 +42,7 @@
 
 // C++ lib
 //
+#include    <algorithm>
 #include    <iostream>
 
 
@@ -122,7 +124,7 @@ block::~block()
 
         try
         {
-            f_table->get_dbfile()->release_data(f_data);
+            f_file->release_data(f_data);
             //f_data = nullptr;
         }
         catch(page_not_found const & e)
@@ -234,7 +236,7 @@ void block::set_dbtype(dbtype_t type)
 
 version_t block::get_structure_version() const
 {
-    return version_t(static_cast<std::uint32_t>(f_structure->get_uinteger("header.version")));
+    return version_t(get_static_field(detail::g_block_header_version_field));
 }
 
 
@@ -244,7 +246,7 @@ void block::set_structure_version()
     //
     if(get_structure_version() != f_structure_descriptions->f_version)
     {
-        f_structure->set_uinteger("header.version", f_structure_descriptions->f_version.to_binary());
+        set_static_field(detail::g_block_header_version_field, f_structure_descriptions->f_version.to_binary());
     }
 }
 
@@ -273,6 +275,12 @@ data_t block::data(reference_t offset)
         throw snapdatabase_logic_error("block::data() called before set_data().");
     }
 
+    // the caller may modify the data so the views need their own copy
+    // and the page gets saved in the commit log
+    //
+    detach_views();
+    f_file->journal_page(f_offset);
+
     return f_data + (offset % get_table()->get_page_size());
 }
 
@@ -291,7 +299,101 @@ const_data_t block::data(reference_t offset) const
 
 void block::sync(bool immediate)
 {
-    get_table()->get_dbfile()->sync(f_data, immediate);
+    f_file->sync(f_data, immediate);
+}
+
+
+/** \brief Reference data of this block without copying it.
+ *
+ * This function returns a view of \p size bytes at \p offset in this
+ * block. The view keeps the block alive and its data() pointer goes
+ * directly in the block, so reading a row does not copy it.
+ *
+ * The first time the block is about to be modified (i.e. the non-const
+ * data() function gets called), the views get detached: they copy their
+ * data first (copy-on-write). The block cache does the same before it
+ * evicts or replaces a block. So a view always returns the data as it
+ * was when it was created.
+ *
+ * \param[in] offset  The offset of the data in this block.
+ * \param[in] size  The number of bytes to reference.
+ *
+ * \return A view of the data.
+ */
+block_view_pointer_t block::create_view(reference_t offset, std::size_t size)
+{
+    // the const data() does not detach the existing views
+    //
+    const_data_t const ptr(static_cast<block const *>(this)->data(offset));
+    block_view::pointer_t v(std::make_shared<block_view>(shared_from_this(), ptr, size));
+
+    // forget about the views which were released before the vector
+    // has to grow
+    //
+    if(f_views.size() == f_views.capacity())
+    {
+        f_views.erase(
+                  std::remove_if(
+                          f_views.begin()
+                        , f_views.end()
+                        , [](std::weak_ptr<block_view> const & w)
+                            {
+                                return w.expired();
+                            })
+                , f_views.end());
+    }
+    f_views.push_back(v);
+
+    return v;
+}
+
+
+/** \brief Give each view of this block its own copy of the data.
+ *
+ * This function is called before the block gets modified or released.
+ * Once it returns, the views do not reference this block anymore.
+ */
+void block::detach_views()
+{
+    if(f_views.empty())
+    {
+        return;
+    }
+
+    // the views may hold the last references to this block
+    //
+    pointer_t const keep(shared_from_this());
+
+    std::vector<std::weak_ptr<block_view>> views;
+    views.swap(f_views);
+    for(auto const & w : views)
+    {
+        block_view::pointer_t v(w.lock());
+        if(v != nullptr)
+        {
+            v->detach();
+        }
+    }
+}
+
+
+/** \brief Count the views still referencing this block.
+ *
+ * Each view holds a reference to its block. The cache uses this count
+ * to know whether a block is only used by views, in which case the
+ * views can be detached and the block evicted.
+ *
+ * \return The number of views referencing this block.
+ */
+std::size_t block::count_views() const
+{
+    return std::count_if(
+              f_views.begin()
+            , f_views.end()
+            , [](std::weak_ptr<block_view> const & w)
+                {
+                    return !w.expired();
+                });
 }
 
 
@@ -310,5 +412,51 @@ void block::from_current_file_version()
 
 
 
+
+block_view::block_view(block::pointer_t b, const_data_t data, std::size_t size)
+    : f_block(b)
+    , f_data(data)
+    , f_size(size)
+{
+}
+
+
+const_data_t block_view::data() const
+{
+    return f_data;
+}
+
+
+std::size_t block_view::size() const
+{
+    return f_size;
+}
+
+
+bool block_view::is_detached() const
+{
+    return f_block == nullptr;
+}
+
+
+/** \brief Copy the data and release the block.
+ *
+ * Once this function returns, data() points to a copy of the data
+ * which belongs to this view.
+ */
+void block_view::detach()
+{
+    if(f_block == nullptr)
+    {
+        return;
+    }
+
+    f_copy.assign(f_data, f_data + f_size);
+    f_data = f_copy.data();
+    f_block.reset();
+}
+
+
+
 } // namespace snapdatabase
 // vim: ts=4 sw=4 et
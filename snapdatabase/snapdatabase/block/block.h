@@ -34,6 +34,7 @@
 // C++ lib
 //
 #include    <map>
+#include    <vector>
 
 
 namespace snapdatabase
@@ -50,6 +51,12 @@ struct descriptions_by_version_t;
 class structure;
 typedef std::shared_ptr<structure>  structure_pointer_t;
 
+template<typename T>
+struct static_field_t;
+
+class block_view;
+typedef std::shared_ptr<block_view> block_view_pointer_t;
+
 
 
 class block
@@ -79,6 +86,21 @@ public:
     data_t                      data(reference_t offset = 0);
     const_data_t                data(reference_t offset = 0) const;
     void                        sync(bool immediate);
+    block_view_pointer_t        create_view(reference_t offset, std::size_t size);
+    void                        detach_views();
+    std::size_t                 count_views() const;
+
+    template<typename T>
+    T                           get_static_field(static_field_t<T> const & field) const
+                                {
+                                    return field.get(data());
+                                }
+
+    template<typename T>
+    void                        set_static_field(static_field_t<T> const & field, typename static_field_t<T>::value_t value)
+                                {
+                                    field.set(data(), value);
+                                }
 
     void                        from_current_file_version();
 
@@ -93,6 +115,32 @@ protected:
     reference_t                 f_offset = reference_t();
 
     mutable data_t              f_data = nullptr;
+    std::vector<std::weak_ptr<block_view>>
+                                f_views = std::vector<std::weak_ptr<block_view>>();
+};
+
+
+
+class block_view
+{
+public:
+    typedef std::shared_ptr<block_view>         pointer_t;
+
+                                block_view(block::pointer_t b, const_data_t data, std::size_t size);
+                                block_view(block_view const & rhs) = delete;
+
+    block_view &                operator = (block_view const & rhs) = delete;
+
+    const_data_t                data() const;
+    std::size_t                 size() const;
+    bool                        is_detached() const;
+    void                        detach();
+
+private:
+    block::pointer_t            f_block = block::pointer_t();
+    const_data_t                f_data = nullptr;
+    std::size_t                 f_size = 0;
+    std::vector<std::uint8_t>   f_copy = std::vector<std::uint8_t>();
 };
 
 
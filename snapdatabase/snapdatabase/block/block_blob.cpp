@@ -78,6 +78,10 @@ constexpr descriptions_by_version_t const g_descriptions_by_version[] =
 };
 
 
+constexpr static_field_t<std::uint32_t> const g_size_field(define_static_field<std::uint32_t>(g_description, "size"));
+constexpr static_field_t<std::uint64_t> const g_next_blob_field(define_static_field<std::uint64_t>(g_description, "next_blob"));
+
+
 
 }
 // no name namespace
@@ -93,25 +97,25 @@ block_blob::block_blob(dbfile::pointer_t f, reference_t offset)
 
 uint32_t block_blob::get_size()
 {
-    return static_cast<uint32_t>(f_structure->get_uinteger("size"));
+    return static_cast<uint32_t>(get_static_field(g_size_field));
 }
 
 
 void block_blob::set_size(uint32_t size)
 {
-    f_structure->set_uinteger("size", size);
+    set_static_field(g_size_field, size);
 }
 
 
 reference_t block_blob::get_next_blob()
 {
-    return static_cast<reference_t>(f_structure->get_uinteger("next_blob"));
+    return static_cast<reference_t>(get_static_field(g_next_blob_field));
 }
 
 
 void block_blob::set_next_blob(reference_t offset)
 {
-    f_structure->set_uinteger("next_blob", offset);
+    set_static_field(g_next_blob_field, offset);
 }
 
 
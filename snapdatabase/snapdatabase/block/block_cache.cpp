@@ -0,0 +1,542 @@
+// Copyright (c) 2019  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapdatabase
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+/** \file
+ * \brief Block cache implementation.
+ *
+ * The cache follows the CLOCK-Pro algorithm: the resident blocks are
+ * kept in one circular list and are either hot or cold. A cold block
+ * which gets accessed again while in its test period becomes hot. The
+ * offsets of the cold blocks evicted during their test period are
+ * remembered (non-resident test blocks) so a block which gets loaded
+ * again shortly after its eviction comes back hot. The number of cold
+ * blocks adapts to the workload.
+ *
+ * Only cold blocks get evicted. The hot hand demotes the hot blocks
+ * which were not accessed since its last pass. Index blocks get one
+ * more pass than the other blocks before being demoted so the paths
+ * through the indexes remain resident. A few blocks, such as the
+ * header and the schema, are pinned and never evicted.
+ *
+ * Blocks still referenced outside of the cache (i.e. a cursor or a
+ * caller holding a block::pointer_t) are never evicted. This way we
+ * never end up with two block objects for the same page.
+ */
+
+// self
+//
+#include    "snapdatabase/block/block_cache.h"
+
+#include    "snapdatabase/data/structure.h"
+
+
+// C++ lib
+//
+#include    <algorithm>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace snapdatabase
+{
+
+
+
+namespace
+{
+
+
+
+/** \brief Minimum number of blocks in the clock.
+ *
+ * Whatever the memory budget, the cache keeps at least this many
+ * blocks resident. Less than that and a single row insertion would
+ * evict the blocks it is working on.
+ */
+constexpr size_t            MINIMUM_CAPACITY = 16;
+
+
+bool is_pinned(dbtype_t type)
+{
+    switch(type)
+    {
+    case dbtype_t::FILE_TYPE_SNAP_DATABASE_TABLE:
+    case dbtype_t::FILE_TYPE_EXTERNAL_INDEX:
+    case dbtype_t::FILE_TYPE_BLOOM_FILTER:
+    case dbtype_t::BLOCK_TYPE_FREE_SPACE:
+    case dbtype_t::BLOCK_TYPE_SCHEMA:
+    case dbtype_t::BLOCK_TYPE_SCHEMA_LIST:
+        return true;
+
+    default:
+        return false;
+
+    }
+}
+
+
+bool is_index(dbtype_t type)
+{
+    switch(type)
+    {
+    case dbtype_t::BLOCK_TYPE_ENTRY_INDEX:
+    case dbtype_t::BLOCK_TYPE_INDEX_POINTERS:
+    case dbtype_t::BLOCK_TYPE_INDIRECT_INDEX:
+    case dbtype_t::BLOCK_TYPE_PRIMARY_INDEX:
+    case dbtype_t::BLOCK_TYPE_SECONDARY_INDEX:
+    case dbtype_t::BLOCK_TYPE_TOP_INDEX:
+    case dbtype_t::BLOCK_TYPE_TOP_INDIRECT_INDEX:
+        return true;
+
+    default:
+        return false;
+
+    }
+}
+
+
+
+}
+// no name namespace
+
+
+
+block_cache::block_cache(dbfile::pointer_t f, size_t cache_size)
+    : f_file(f)
+    , f_cache_size(cache_size)
+    , f_hot_hand(f_clock.end())
+    , f_cold_hand(f_clock.end())
+{
+}
+
+
+/** \brief Change the memory budget of the cache.
+ *
+ * If the new budget is smaller, blocks get evicted immediately.
+ *
+ * \param[in] cache_size  The maximum number of bytes of blocks to keep
+ * in memory.
+ */
+void block_cache::set_cache_size(size_t cache_size)
+{
+    f_cache_size = cache_size;
+    f_cold_target = std::min(f_cold_target, capacity() - 1);
+    evict();
+}
+
+
+size_t block_cache::get_cache_size() const
+{
+    return f_cache_size;
+}
+
+
+/** \brief Search for a block in the cache.
+ *
+ * If the block is found, it gets marked as referenced and counts as
+ * a hit. Otherwise it counts as a miss and the caller is expected to
+ * load the block and insert() it.
+ *
+ * \param[in] offset  The offset of the block in the file.
+ *
+ * \return The block or nullptr if not in the cache.
+ */
+block::pointer_t block_cache::find(reference_t offset)
+{
+    auto const pinned(f_pinned.find(offset));
+    if(pinned != f_pinned.end())
+    {
+        ++f_hits;
+        return pinned->second;
+    }
+
+    auto it(f_entries.find(offset));
+    if(it != f_entries.end())
+    {
+        ++f_hits;
+        it->second.f_referenced = true;
+        it->second.f_second_chance = false;
+        return it->second.f_block;
+    }
+
+    ++f_misses;
+    return block::pointer_t();
+}
+
+
+/** \brief Add a block to the cache.
+ *
+ * The header, schema, and free space blocks are pinned. The other
+ * blocks get added to the clock. A block found in the list of test
+ * blocks (i.e. it was evicted recently) or an index block, as long as
+ * there is room for more hot blocks, is added as a hot block.
+ * Everything else starts cold.
+ *
+ * Adding a block may evict other blocks.
+ *
+ * \param[in] b  The block to add.
+ */
+void block_cache::insert(block::pointer_t b)
+{
+    reference_t const offset(b->get_offset());
+    dbtype_t const type(b->get_dbtype());
+    if(is_pinned(type))
+    {
+        f_pinned[offset] = b;
+        return;
+    }
+
+    auto existing(f_entries.find(offset));
+    if(existing != f_entries.end())
+    {
+        existing->second.f_block = b;
+        existing->second.f_referenced = true;
+        existing->second.f_index = is_index(type);
+        return;
+    }
+
+    size_t const max(capacity());
+
+    bool hot(false);
+    auto const test(f_test_entries.find(offset));
+    if(test != f_test_entries.end())
+    {
+        // it was evicted too early, give more room to the cold blocks
+        //
+        f_test.erase(test->second);
+        f_test_entries.erase(test);
+        f_cold_target = std::min(f_cold_target + 1, max - 1);
+        hot = true;
+    }
+    else if(is_index(type)
+         && f_hot_count + f_cold_target < max)
+    {
+        hot = true;
+    }
+
+    // new blocks go just behind the hot hand so they are the last ones
+    // it visits
+    //
+    entry_t e;
+    e.f_block = b;
+    e.f_hot = hot;
+    e.f_test = !hot;
+    e.f_index = is_index(type);
+    if(f_clock.empty())
+    {
+        e.f_position = f_clock.insert(f_clock.end(), offset);
+        f_hot_hand = e.f_position;
+        f_cold_hand = e.f_position;
+    }
+    else
+    {
+        e.f_position = f_clock.insert(f_hot_hand, offset);
+    }
+    f_entries[offset] = e;
+    if(hot)
+    {
+        ++f_hot_count;
+        cool_down();
+    }
+
+    evict();
+}
+
+
+/** \brief Remove a block from the cache.
+ *
+ * This is used when a block changes type (i.e. a FREE block becomes a
+ * DATA block). The page is not released since the caller is about to
+ * use it.
+ *
+ * \param[in] offset  The offset of the block to remove.
+ */
+void block_cache::erase(reference_t offset)
+{
+    auto const pinned(f_pinned.find(offset));
+    if(pinned != f_pinned.end())
+    {
+        pinned->second->detach_views();
+        f_pinned.erase(pinned);
+    }
+
+    auto it(f_entries.find(offset));
+    if(it != f_entries.end())
+    {
+        remove(it);
+    }
+
+    auto const test(f_test_entries.find(offset));
+    if(test != f_test_entries.end())
+    {
+        f_test.erase(test->second);
+        f_test_entries.erase(test);
+    }
+}
+
+
+/** \brief Remove all the blocks at or after \p offset.
+ *
+ * This is used when the file gets truncated.
+ *
+ * \param[in] offset  The new end of the file.
+ */
+void block_cache::erase_from(reference_t offset)
+{
+    for(auto it(f_pinned.lower_bound(offset)); it != f_pinned.end(); )
+    {
+        it->second->detach_views();
+        it = f_pinned.erase(it);
+    }
+
+    for(auto it(f_entries.lower_bound(offset)); it != f_entries.end(); )
+    {
+        auto const next(std::next(it));
+        remove(it);
+        it = next;
+    }
+
+    for(auto it(f_test_entries.lower_bound(offset)); it != f_test_entries.end(); )
+    {
+        f_test.erase(it->second);
+        it = f_test_entries.erase(it);
+    }
+}
+
+
+block_cache::statistics_t block_cache::get_statistics() const
+{
+    statistics_t result;
+    result.f_hits = f_hits;
+    result.f_misses = f_misses;
+    result.f_evictions = f_evictions;
+    result.f_resident = f_entries.size() + f_pinned.size();
+    result.f_hot = f_hot_count;
+    result.f_pinned = f_pinned.size();
+    return result;
+}
+
+
+/** \brief Maximum number of blocks in the clock.
+ *
+ * The pinned blocks are part of the budget.
+ *
+ * \return The number of blocks the clock can hold.
+ */
+size_t block_cache::capacity() const
+{
+    size_t const page_size(std::max(f_file->get_page_size(), static_cast<size_t>(1)));
+    size_t const total(f_cache_size / page_size);
+    if(total < f_pinned.size() + MINIMUM_CAPACITY)
+    {
+        return MINIMUM_CAPACITY;
+    }
+    return total - f_pinned.size();
+}
+
+
+void block_cache::remove(entry_map_t::iterator it)
+{
+    ring_t::iterator const position(it->second.f_position);
+    if(f_hot_hand == position)
+    {
+        advance(f_hot_hand);
+    }
+    if(f_cold_hand == position)
+    {
+        advance(f_cold_hand);
+    }
+    f_clock.erase(position);
+    if(f_clock.empty())
+    {
+        f_hot_hand = f_clock.end();
+        f_cold_hand = f_clock.end();
+    }
+
+    if(it->second.f_hot)
+    {
+        --f_hot_count;
+    }
+
+    // rows read from that block may still point to its data, they need
+    // their own copy since the block is going away
+    //
+    it->second.f_block->detach_views();
+
+    f_entries.erase(it);
+}
+
+
+void block_cache::advance(ring_t::iterator & hand)
+{
+    ++hand;
+    if(hand == f_clock.end())
+    {
+        hand = f_clock.begin();
+    }
+}
+
+
+/** \brief Evict cold blocks until the cache is within its budget.
+ *
+ * The number of steps is limited: if all the cold blocks are in use,
+ * the cache remains over its budget until some get released.
+ */
+void block_cache::evict()
+{
+    size_t const max(capacity());
+    for(size_t steps(f_clock.size() * 3); f_entries.size() > max && steps > 0; --steps)
+    {
+        cool_down();
+        run_cold_hand();
+    }
+}
+
+
+/** \brief Run the hot hand until the cold blocks get their share.
+ *
+ * The hot blocks are limited to the capacity minus the cold target.
+ * Without this, a cache full of hot blocks would have nothing the
+ * cold hand can evict.
+ */
+void block_cache::cool_down()
+{
+    size_t const max(capacity());
+    for(size_t steps(f_clock.size() * 3); f_hot_count > 0 && f_hot_count + f_cold_target > max && steps > 0; --steps)
+    {
+        run_hot_hand();
+    }
+}
+
+
+void block_cache::run_cold_hand()
+{
+    auto it(f_entries.find(*f_cold_hand));
+    entry_t & e(it->second);
+    if(e.f_hot)
+    {
+        advance(f_cold_hand);
+        return;
+    }
+
+    if(e.f_referenced)
+    {
+        e.f_referenced = false;
+        advance(f_cold_hand);
+        if(e.f_test)
+        {
+            // accessed again during its test period, it becomes hot
+            //
+            e.f_hot = true;
+            e.f_test = false;
+            ++f_hot_count;
+            f_cold_target = std::min(f_cold_target + 1, capacity() - 1);
+            cool_down();
+        }
+        else
+        {
+            e.f_test = true;
+        }
+        return;
+    }
+
+    // the structure of a block points back to the block so the cache
+    // and that structure hold the only two references of an unused block
+    // other than the views of the rows read from it; the views get their
+    // own copy of the data when the block is removed
+    //
+    if(static_cast<std::size_t>(e.f_block.use_count()) > 2 + e.f_block->count_views())
+    {
+        // someone is still using that block, we cannot evict it
+        //
+        advance(f_cold_hand);
+        return;
+    }
+
+    reference_t const offset(it->first);
+    if(e.f_test)
+    {
+        add_test(offset);
+    }
+    e.f_block->get_structure()->release_block();
+    remove(it);
+    f_file->release_page(offset);
+    ++f_evictions;
+}
+
+
+void block_cache::run_hot_hand()
+{
+    entry_t & e(f_entries.find(*f_hot_hand)->second);
+    advance(f_hot_hand);
+    if(!e.f_hot)
+    {
+        // the hot hand ends the test period of the cold blocks it passes
+        //
+        e.f_test = false;
+        return;
+    }
+
+    if(e.f_referenced)
+    {
+        e.f_referenced = false;
+        return;
+    }
+
+    if(e.f_index
+    && !e.f_second_chance)
+    {
+        e.f_second_chance = true;
+        return;
+    }
+
+    e.f_hot = false;
+    e.f_second_chance = false;
+    --f_hot_count;
+}
+
+
+void block_cache::add_test(reference_t offset)
+{
+    f_test_entries[offset] = f_test.insert(f_test.end(), offset);
+
+    // too many test blocks means the cold blocks do not get reused,
+    // give more room to the hot blocks
+    //
+    size_t const max(capacity());
+    while(f_test.size() > max)
+    {
+        f_test_entries.erase(f_test.front());
+        f_test.pop_front();
+        if(f_cold_target > 1)
+        {
+            --f_cold_target;
+        }
+    }
+}
+
+
+
+} // namespace snapdatabase
+// vim: ts=4 sw=4 et
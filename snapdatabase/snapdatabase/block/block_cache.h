@@ -0,0 +1,123 @@
+// Copyright (c) 2019  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapdatabase
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+
+/** \file
+ * \brief Cache of the blocks of one table.
+ *
+ * The table keeps the blocks it loads in this cache. The cache has a
+ * memory budget and evicts blocks using a CLOCK-Pro like algorithm
+ * once that budget is reached, keeping the index blocks resident in
+ * preference to the data blocks.
+ */
+
+// self
+//
+#include    "snapdatabase/block/block.h"
+
+
+// C++ lib
+//
+#include    <list>
+
+
+
+namespace snapdatabase
+{
+
+
+
+class block_cache
+{
+public:
+    static constexpr size_t     DEFAULT_CACHE_SIZE = 32 * 1024 * 1024;
+    static constexpr size_t     MINIMUM_CACHE_SIZE = 64 * 1024;
+    static constexpr size_t     MAXIMUM_CACHE_SIZE = 64UL * 1024 * 1024 * 1024;
+
+    struct statistics_t
+    {
+        std::uint64_t           f_hits = 0;
+        std::uint64_t           f_misses = 0;
+        std::uint64_t           f_evictions = 0;
+        std::size_t             f_resident = 0;
+        std::size_t             f_hot = 0;
+        std::size_t             f_pinned = 0;
+    };
+
+                                block_cache(dbfile::pointer_t f, size_t cache_size = DEFAULT_CACHE_SIZE);
+                                block_cache(block_cache const & rhs) = delete;
+
+    block_cache &               operator = (block_cache const & rhs) = delete;
+
+    void                        set_cache_size(size_t cache_size);
+    size_t                      get_cache_size() const;
+    block::pointer_t            find(reference_t offset);
+    void                        insert(block::pointer_t b);
+    void                        erase(reference_t offset);
+    void                        erase_from(reference_t offset);
+    statistics_t                get_statistics() const;
+
+private:
+    typedef std::list<reference_t>              ring_t;
+
+    struct entry_t
+    {
+        block::pointer_t        f_block = block::pointer_t();
+        ring_t::iterator        f_position = ring_t::iterator();
+        bool                    f_referenced = false;
+        bool                    f_hot = false;
+        bool                    f_test = false;
+        bool                    f_index = false;
+        bool                    f_second_chance = false;
+    };
+
+    typedef std::map<reference_t, entry_t>      entry_map_t;
+    typedef std::map<reference_t, ring_t::iterator>
+                                                test_map_t;
+
+    size_t                      capacity() const;
+    void                        remove(entry_map_t::iterator it);
+    void                        advance(ring_t::iterator & hand);
+    void                        evict();
+    void                        cool_down();
+    void                        run_cold_hand();
+    void                        run_hot_hand();
+    void                        add_test(reference_t offset);
+
+    dbfile::pointer_t           f_file = dbfile::pointer_t();
+    size_t                      f_cache_size = DEFAULT_CACHE_SIZE;
+    size_t                      f_cold_target = 1;
+    block::map_t                f_pinned = block::map_t();
+    entry_map_t                 f_entries = entry_map_t();
+    ring_t                      f_clock = ring_t();
+    ring_t::iterator            f_hot_hand = ring_t::iterator();
+    ring_t::iterator            f_cold_hand = ring_t::iterator();
+    size_t                      f_hot_count = 0;
+    ring_t                      f_test = ring_t();
+    test_map_t                  f_test_entries = test_map_t();
+    std::uint64_t               f_hits = 0;
+    std::uint64_t               f_misses = 0;
+    std::uint64_t               f_evictions = 0;
+};
+
+
+
+} // namespace snapdatabase
+// vim: ts=4 sw=4 et
@@ -37,6 +37,7 @@
 
 // C++ lib
 //
+#include    <algorithm>
 #include    <iostream>
 
 
@@ -120,6 +121,12 @@ constexpr descriptions_by_version_t const g_descriptions_by_version[] =
 };
 
 
+constexpr static_field_t<std::uint32_t> const g_count_field(define_static_field<std::uint32_t>(g_description, "count"));
+constexpr static_field_t<std::uint32_t> const g_size_field(define_static_field<std::uint32_t>(g_description, "size"));
+constexpr static_field_t<std::uint64_t> const g_next_field(define_static_field<std::uint64_t>(g_description, "next"));
+constexpr static_field_t<std::uint64_t> const g_previous_field(define_static_field<std::uint64_t>(g_description, "previous"));
+
+
 
 }
 // no name namespace
@@ -135,19 +142,19 @@ block_entry_index::block_entry_index(dbfile::pointer_t f, reference_t offset)
 
 std::uint32_t block_entry_index::get_count() const
 {
-    return static_cast<uint32_t>(f_structure->get_uinteger("count"));
+    return static_cast<uint32_t>(get_static_field(g_count_field));
 }
 
 
 void block_entry_index::set_count(std::uint32_t count)
 {
-    f_structure->set_uinteger("count", count);
+    set_static_field(g_count_field, count);
 }
 
 
 std::uint32_t block_entry_index::get_size() const
 {
-    return static_cast<uint32_t>(f_structure->get_uinteger("size"));
+    return static_cast<uint32_t>(get_static_field(g_size_field));
 }
 
 
@@ -166,7 +173,7 @@ void block_entry_index::set_size(std::uint32_t size)
         throw snapdatabase_logic_error("the size of a block_entry_index must be large enough to support a flag, an oid_t, and at the very least one byte from your key.");
     }
 
-    f_structure->set_uinteger("size", size);
+    set_static_field(g_size_field, size);
 }
 
 
@@ -178,25 +185,25 @@ void block_entry_index::set_key_size(std::uint32_t size)
 
 reference_t block_entry_index::get_next() const
 {
-    return static_cast<reference_t>(f_structure->get_uinteger("next"));
+    return static_cast<reference_t>(get_static_field(g_next_field));
 }
 
 
 void block_entry_index::set_next(reference_t offset)
 {
-    f_structure->set_uinteger("next", offset);
+    set_static_field(g_next_field, offset);
 }
 
 
 reference_t block_entry_index::get_previous() const
 {
-    return static_cast<reference_t>(f_structure->get_uinteger("previous"));
+    return static_cast<reference_t>(get_static_field(g_previous_field));
 }
 
 
 void block_entry_index::set_previous(reference_t offset)
 {
-    f_structure->set_uinteger("previous", offset);
+    set_static_field(g_previous_field, offset);
 }
 
 
@@ -209,40 +216,20 @@ oid_t block_entry_index::find_entry(buffer_t const & key) const
     std::uint32_t const count(get_count());
     if(count == 0)
     {
-std::cerr << "count == 0 -- entry block is empty?!\n";
         f_position = 0;
         return NULL_FILE_ADDR;
     }
-std::cerr << "key being sought -> ";
-for(int k(0); k < 16; ++k)
-{
-std::cerr << " " << std::hex << static_cast<int>(key[k]) << std::dec;
-}
-std::cerr << "\n";
 
     std::uint8_t const * buffer(data(f_structure->get_size()));
     std::uint32_t const size(get_size());
     std::uint32_t const length(std::min(size - sizeof(std::uint8_t) - sizeof(reference_t), key.size()));
     std::uint32_t i(0);
     std::uint32_t j(count);
-std::cerr << "count = " << count << " -- if less than 3 we may fail our search?!\n";
     while(i < j)
     {
         f_position = (j - i) / 2 + i;
         std::uint8_t const * ptr(buffer + f_position * size);
-std::cerr << "   f_position = " << f_position << "\n";
-for(int k(0); k < 1 + 8 + 16; ++k)
-{
-std::cerr << " " << std::hex << static_cast<int>(ptr[k]) << std::dec;
-}
-std::cerr << "\n";
-for(int k(0); k < 16; ++k)
-{
-std::cerr << " " << std::hex << static_cast<int>(key[k]) << std::dec;
-}
-std::cerr << "\n";
         int const r(memcmp(ptr + sizeof(std::uint8_t) + sizeof(reference_t), key.data(), length));
-std::cerr << " and r = " << r << " for size " << length << "\n";
         if(r < 0)
         {
             ++f_position;
@@ -256,14 +243,12 @@ std::cerr << " and r = " << r << " for size " << length << "\n";
         {
             reference_t aligned_reference(0);
             memcpy(&aligned_reference, ptr + sizeof(std::uint8_t), sizeof(reference_t));
-std::cerr << "   found it -> " << aligned_reference << "\n";
             return aligned_reference;
         }
     }
 
     // TBD: save current position close to point where we can do an insertion
-
-std::cerr << "--- NOT FOUND ---\n";
+    //
     return NULL_FILE_ADDR;
 }
 
@@ -301,7 +286,6 @@ void block_entry_index::add_entry(buffer_t const & key, oid_t position_oid, std:
     //
     std::uint8_t * buffer(data(f_structure->get_size()));
     std::uint32_t const count(get_count());
-std::cerr << "add_entry() starting with count = " << count << "and OID=" << position_oid << "\n";
     std::uint32_t const size(get_size());
     std::uint32_t const length(get_size() - sizeof(std::uint8_t) - sizeof(reference_t));
     std::uint32_t const min_length(std::min(length, static_cast<std::uint32_t>(key.size())));
@@ -320,17 +304,6 @@ std::cerr << "add_entry() starting with count = " << count << "and OID=" << posi
         {
             close_position = (j - i) / 2 + i;
             std::uint8_t const * ptr(buffer + close_position * size);
-std::cerr << "\n--- ptr = " << reinterpret_cast<void const *>(buffer)
-                    << " + " << sizeof(std::uint8_t)
-                    << " + " << sizeof(reference_t)
-                    << " + " << close_position * size
-
-                    << " data = " << reinterpret_cast<void const *>(key.data())
-                    << " len = " << min_length
-                    << " pos = " << close_position
-                    << " size = " << size
-                    << " ptr = " << reinterpret_cast<void const *>(ptr)
-                    << "\n";
             int const r(memcmp(ptr + sizeof(std::uint8_t) + sizeof(reference_t), key.data(), min_length));
             if(r < 0)
             {
@@ -416,6 +389,167 @@ throw snapdatabase_not_yet_implemented("block EIDX overflow case 2");
 }
 
 
+/** \brief Remove one entry from this block.
+ *
+ * The entries after \p position are moved down by one. The block may
+ * end up empty in which case the caller is expected to unlink it from
+ * its siblings and its parent `TIDX` and free it.
+ *
+ * \note
+ * If the entry has the ENTRY_INDEX_FLAG_MULTIPLE flag, the `IDXP`
+ * blocks it references are not released by this function.
+ *
+ * \param[in] position  The position of the entry to remove.
+ */
+void block_entry_index::remove_entry(std::uint32_t position)
+{
+    std::uint32_t const count(get_count());
+    if(position >= count)
+    {
+        throw out_of_bounds(
+                  "entry position "
+                + std::to_string(position)
+                + " is out of bounds in this EIDX block.");
+    }
+
+    std::uint32_t const size(get_size());
+    std::uint8_t * buffer(data(f_structure->get_size()));
+    memmove(buffer + position * size
+          , buffer + (position + 1) * size
+          , (count - position - 1) * size);
+    set_count(count - 1);
+}
+
+
+/** \brief Maximum number of entries this block can hold.
+ *
+ * The entries all have the same size so the maximum is the size of
+ * the page minus the header divided by the size of one entry.
+ *
+ * \return The maximum number of entries in this `EIDX`.
+ */
+std::uint32_t block_entry_index::get_max_count() const
+{
+    std::uint32_t const size(get_size());
+    if(size == 0)
+    {
+        throw snapdatabase_logic_error("the size of this block_entry_index is not yet defined calling get_max_count().");
+    }
+
+    size_t const page_size(get_table()->get_page_size());
+    return static_cast<std::uint32_t>((page_size - f_structure->get_size()) / size);
+}
+
+
+std::uint8_t block_entry_index::get_entry_flags(std::uint32_t position) const
+{
+    if(position >= get_count())
+    {
+        throw out_of_bounds(
+                  "entry position "
+                + std::to_string(position)
+                + " is out of bounds in this EIDX block.");
+    }
+
+    return data(f_structure->get_size())[position * get_size()];
+}
+
+
+/** \brief Get the reference of an entry.
+ *
+ * The reference is an `oid_t` to the row unless the entry has the
+ * ENTRY_INDEX_FLAG_MULTIPLE flag set, in which case it is the
+ * reference to the first `IDXP` block holding the list of OIDs.
+ *
+ * \param[in] position  The position of the entry in this block.
+ *
+ * \return The OID or `IDXP` reference.
+ */
+reference_t block_entry_index::get_entry_reference(std::uint32_t position) const
+{
+    if(position >= get_count())
+    {
+        throw out_of_bounds(
+                  "entry position "
+                + std::to_string(position)
+                + " is out of bounds in this EIDX block.");
+    }
+
+    reference_t aligned_reference(0);
+    memcpy(&aligned_reference
+         , data(f_structure->get_size()) + position * get_size() + sizeof(std::uint8_t)
+         , sizeof(reference_t));
+    return aligned_reference;
+}
+
+
+void block_entry_index::set_entry_reference(std::uint32_t position, std::uint8_t flags, reference_t reference)
+{
+    if(position >= get_count())
+    {
+        throw out_of_bounds(
+                  "entry position "
+                + std::to_string(position)
+                + " is out of bounds in this EIDX block.");
+    }
+
+    std::uint8_t * ptr(data(f_structure->get_size()) + position * get_size());
+    ptr[0] = flags;
+    memcpy(ptr + sizeof(std::uint8_t), &reference, sizeof(reference_t));
+}
+
+
+buffer_t block_entry_index::get_entry_key(std::uint32_t position) const
+{
+    if(position >= get_count())
+    {
+        throw out_of_bounds(
+                  "entry position "
+                + std::to_string(position)
+                + " is out of bounds in this EIDX block.");
+    }
+
+    std::uint32_t const size(get_size());
+    std::uint8_t const * ptr(data(f_structure->get_size())
+                                + position * size
+                                + sizeof(std::uint8_t)
+                                + sizeof(reference_t));
+    return buffer_t(ptr, ptr + size - sizeof(std::uint8_t) - sizeof(reference_t));
+}
+
+
+/** \brief Move the upper half of the entries to \p new_block.
+ *
+ * When an `EIDX` is full, the table allocates a new `EIDX` and calls
+ * this function to move half of the entries to it. The \p new_block
+ * must be empty. It gets the same entry size as this block.
+ *
+ * The function does not link the blocks together. The caller is
+ * responsible for updating the next and previous references and
+ * for adding the new block to the top index.
+ *
+ * \param[in] new_block  The empty block receiving the upper entries.
+ */
+void block_entry_index::split_entries(pointer_t new_block)
+{
+    if(new_block->get_count() != 0)
+    {
+        throw snapdatabase_logic_error("the new block_entry_index must be empty to split an EIDX.");
+    }
+
+    std::uint32_t const count(get_count());
+    std::uint32_t const size(get_size());
+    std::uint32_t const keep(count / 2);
+
+    new_block->set_size(size);
+    memcpy(new_block->data(new_block->f_structure->get_size())
+         , data(f_structure->get_size()) + keep * size
+         , (count - keep) * size);
+    new_block->set_count(count - keep);
+    set_count(keep);
+}
+
+
 
 
 
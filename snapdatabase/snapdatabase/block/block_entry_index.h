@@ -59,6 +59,14 @@ public:
     oid_t                       find_entry(buffer_t const & key) const;
     std::uint32_t               get_position() const;
     void                        add_entry(buffer_t const & key, oid_t position_oid, std::int32_t close_position = -1);
+    void                        remove_entry(std::uint32_t position);
+
+    std::uint32_t               get_max_count() const;
+    std::uint8_t                get_entry_flags(std::uint32_t position) const;
+    reference_t                 get_entry_reference(std::uint32_t position) const;
+    void                        set_entry_reference(std::uint32_t position, std::uint8_t flags, reference_t reference);
+    buffer_t                    get_entry_key(std::uint32_t position) const;
+    void                        split_entries(pointer_t new_block);
 
 private:
     mutable std::uint32_t       f_position = 0;
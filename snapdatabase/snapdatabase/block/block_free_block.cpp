@@ -76,6 +76,9 @@ constexpr descriptions_by_version_t const g_descriptions_by_version[] =
 };
 
 
+constexpr static_field_t<std::uint64_t> const g_next_free_block_field(define_static_field<std::uint64_t>(g_description, "next_free_block"));
+
+
 
 }
 // no name namespace
@@ -92,13 +95,13 @@ block_free_block::block_free_block(dbfile::pointer_t f, reference_t offset)
 
 reference_t block_free_block::get_next_free_block() const
 {
-    return static_cast<reference_t>(f_structure->get_uinteger("next_free_block"));
+    return static_cast<reference_t>(get_static_field(g_next_free_block_field));
 }
 
 
 void block_free_block::set_next_free_block(reference_t offset)
 {
-    f_structure->set_uinteger("next_free_block", offset);
+    set_static_field(g_next_free_block_field, offset);
 }
 
 
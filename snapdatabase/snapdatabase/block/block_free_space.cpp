@@ -200,6 +200,7 @@ public:
 
     free_space_t                get_free_space(std::uint32_t minimum_size);
     void                        release_space(reference_t offset);
+    bool                        compact_block(block::pointer_t data_block, moved_callback_t moved);
 
 private:
     reference_t *               get_free_space_pointer(std::uint32_t size);
@@ -485,7 +486,7 @@ free_space_t block_free_space_impl::get_free_space(std::uint32_t minimum_size)
         //
         free_space_link_t * link(reinterpret_cast<free_space_link_t *>(result.f_block->data(result.f_reference)));
         std::uint32_t const remaining_size(total_space - minimum_size);
-        if(remaining_size >= sizeof(free_space_meta_t))
+        if(remaining_size >= sizeof(free_space_link_t))
         {
             data_t data(reinterpret_cast<data_t>(link));
             free_space_link_t * new_link(reinterpret_cast<free_space_link_t *>(data + minimum_size));
@@ -498,6 +499,7 @@ free_space_t block_free_space_impl::get_free_space(std::uint32_t minimum_size)
         else
         {
             link->f_meta.f_size = total_space;
+            result.f_size = total_space;
         }
 
         link->f_meta.f_flags = FREE_SPACE_FLAG_ALLOCATED;
@@ -510,17 +512,19 @@ free_space_t block_free_space_impl::get_free_space(std::uint32_t minimum_size)
 
 void block_free_space_impl::release_space(reference_t offset)
 {
+    // get_free_space() returns the reference just after the meta data
+    //
+    offset -= sizeof(free_space_meta_t);
     if(offset % sizeof(reference_t) != 0)
     {
         throw snapdatabase_logic_error(
                   "release_space() called with an invalid offset ("
-                + std::to_string(offset)
+                + std::to_string(offset + sizeof(free_space_meta_t))
                 + "); it must be a multiple of "
                 + BOOST_PP_STRINGIZE(sizeof(reference_t))
-                + ".");
+                + " plus the size of the meta data.");
     }
 
-    offset -= sizeof(free_space_meta_t);
     block::pointer_t b(f_block.get_table()->get_block(offset));
     free_space_link_t * link(reinterpret_cast<free_space_link_t *>(b->data(offset)));
 
@@ -528,69 +532,148 @@ void block_free_space_impl::release_space(reference_t offset)
     {
         // keep reseting the data when releasing it
         //
-        memset(reinterpret_cast<data_t>(link + 1), 0, link->f_meta.f_size - sizeof(link->f_meta));
+        memset(reinterpret_cast<data_t>(link) + sizeof(link->f_meta), 0, link->f_meta.f_size - sizeof(link->f_meta));
     }
 
-    uint32_t const next_pos(link->f_meta.f_size + offset % f_block.get_table()->get_page_size());
-    uint32_t const total_space(total_space_available_in_one_data_block());
-    if(next_pos + sizeof(free_space_link_t) < total_space)
+    // the next space is found right after this one, if it is free, merge
+    //
+    std::uint32_t const page_size(f_block.get_table()->get_page_size());
+    std::uint32_t const next_pos(offset % page_size + link->f_meta.f_size);
+    if(next_pos < page_size)
     {
         free_space_link_t * next_link(reinterpret_cast<free_space_link_t *>(b->data(next_pos)));
-        if((next_link->f_meta.f_flags & FREE_SPACE_FLAG_ALLOCATED) != 0)
+        if((next_link->f_meta.f_flags & FREE_SPACE_FLAG_ALLOCATED) == 0)
         {
-            // merge the next with this one
+            // unlink first since the list depends on the size
             //
-            link->f_meta.f_size += next_link->f_meta.f_size;
             unlink_space(next_link);
+            link->f_meta.f_size += next_link->f_meta.f_size;
         }
     }
 
-    reference_t start(f_block.get_table()->get_page_size() - total_space);
-    if((link - reinterpret_cast<free_space_link_t *>(0)) % f_block.get_table()->get_page_size() > start)
+    // for the previous we need to start searching from the beginning of the
+    // block; the `DATA` is an array of spaces which are each defined by
+    // their size
+    //
+    std::uint32_t const start(page_size - total_space_available_in_one_data_block());
+    std::uint32_t const position(offset % page_size);
+    for(std::uint32_t o(start); o < position; )
     {
-        free_space_link_t * previous_link(reinterpret_cast<free_space_link_t *>(b->data(start)));
-        for(reference_t o(start);;)
+        free_space_link_t * previous_link(reinterpret_cast<free_space_link_t *>(b->data(o)));
+        if(previous_link->f_meta.f_size == 0)
         {
-            free_space_link_t * link_after(reinterpret_cast<free_space_link_t *>(reinterpret_cast<data_t>(previous_link) + previous_link->f_meta.f_size));
-            if(link_after == link)
+            throw snapdatabase_logic_error(
+                      "found a space of size 0 in DATA block at "
+                    + std::to_string(b->get_offset())
+                    + ".");
+        }
+        std::uint32_t const after(o + previous_link->f_meta.f_size);
+        if(after == position)
+        {
+            if((previous_link->f_meta.f_flags & FREE_SPACE_FLAG_ALLOCATED) == 0)
             {
-                if((previous_link->f_meta.f_flags & FREE_SPACE_FLAG_ALLOCATED) == 0)
-                {
-                    unlink_space(previous_link);
-                    previous_link->f_meta.f_size += link->f_meta.f_size;
-                    link_space(o, previous_link);
-
-                    link = previous_link;
-                }
-                break;
+                unlink_space(previous_link);
+                previous_link->f_meta.f_size += link->f_meta.f_size;
+
+                link = previous_link;
+                offset = b->get_offset() + o;
             }
-            else if(link_after > link)
+            break;
+        }
+        o = after;
+    }
+
+    link_space(offset, link);
+}
+
+
+/** \brief Repack the spaces of a `DATA` block.
+ *
+ * This function moves all the allocated spaces of the \p data_block
+ * at the start of the block and transforms all the free spaces in one
+ * single free space at the end of the block.
+ *
+ * Each time an allocated space moves, the \p moved callback gets called
+ * with the old and the new reference. The callback is expected to update
+ * whatever references that space (i.e. the indirect index).
+ *
+ * If the block does not include any allocated space, then no free space
+ * gets linked and the function returns true. The caller is expected to
+ * release the block.
+ *
+ * \param[in] data_block  The `DATA` block to compact.
+ * \param[in] moved  The function called each time a space moves.
+ *
+ * \return true if the block is now empty.
+ */
+bool block_free_space_impl::compact_block(block::pointer_t data_block, moved_callback_t moved)
+{
+    std::uint32_t const page_size(f_block.get_table()->get_page_size());
+    std::uint32_t const start(page_size - total_space_available_in_one_data_block());
+    reference_t const base(data_block->get_offset());
+    data_t const d(data_block->data(base));
+
+    std::uint32_t write(start);
+    std::uint32_t last_allocated(0);
+    for(std::uint32_t read(start); read < page_size; )
+    {
+        free_space_link_t * link(reinterpret_cast<free_space_link_t *>(d + read));
+        std::uint32_t const size(link->f_meta.f_size);
+        if(size == 0
+        || read + size > page_size)
+        {
+            throw snapdatabase_logic_error(
+                      "found a space of invalid size ("
+                    + std::to_string(size)
+                    + ") in DATA block at "
+                    + std::to_string(base)
+                    + ".");
+        }
+
+        if((link->f_meta.f_flags & FREE_SPACE_FLAG_ALLOCATED) == 0)
+        {
+            unlink_space(link);
+        }
+        else
+        {
+            if(read != write)
             {
-                break;
+                memmove(d + write, d + read, size);
+                moved(base + read + sizeof(free_space_meta_t), base + write + sizeof(free_space_meta_t));
             }
-            o += previous_link->f_meta.f_size;
-            previous_link = link_after;
+            last_allocated = write;
+            write += size;
         }
+
+        read += size;
     }
 
-    // for the previous we need to start searching from the beginning of the
-    // block; the `DATA` is an array of 
-    //
+    if(write == start)
+    {
+        return true;
+    }
 
-    link_space(offset, link);
+    std::uint32_t const remaining_size(page_size - write);
+    if(f_block.get_table()->is_secure())
+    {
+        memset(d + write, 0, remaining_size);
+    }
 
-    // TODO: look into agglomerating multiple free spaces if immediately
-    //       possible; here are the 4 possible cases
-    //
-    //       1. nothing before, nothing after, done
-    //       2. something before, enlarge previous block
-    //       3. something after, enlarge & move next block
-    //       4. something before and after, enlarge previous block, drop next block
-    //
-    //       right now, though we do not have a good way of finding a
-    //       previous block; the next block, though, should be at this
-    //       block + size so that one is easy and the block header is
-    //       enough to find it in our FSPC table
+    if(remaining_size >= sizeof(free_space_link_t))
+    {
+        free_space_link_t * link(reinterpret_cast<free_space_link_t *>(d + write));
+        link->f_meta.f_size = remaining_size;
+        link->f_meta.f_flags = 0;
+        link_space(base + write, link);
+    }
+    else if(remaining_size > 0)
+    {
+        // too small to be a free space, give it to the last row
+        //
+        reinterpret_cast<free_space_meta_t *>(d + last_allocated)->f_size += remaining_size;
+    }
+
+    return false;
 }
 
 
@@ -669,6 +752,12 @@ void block_free_space::release_space(reference_t offset)
 }
 
 
+bool block_free_space::compact_block(block::pointer_t data_block, moved_callback_t moved)
+{
+    return f_impl->compact_block(data_block, moved);
+}
+
+
 bool block_free_space::get_flag(const_data_t ptr, std::uint8_t flag)
 {
     detail::free_space_meta_t const * meta(reinterpret_cast<detail::free_space_meta_t const *>(ptr) - 1);
@@ -697,6 +786,22 @@ std::uint32_t block_free_space::get_size(const_data_t ptr)
 }
 
 
+/** \brief Get the number of bytes available to the caller.
+ *
+ * The get_size() function returns the size of the whole space, which
+ * includes the meta data found just before \p ptr. This function returns
+ * the number of bytes which can be used starting at \p ptr.
+ *
+ * \param[in] ptr  A pointer as returned by get_free_space().
+ *
+ * \return The number of bytes available at \p ptr.
+ */
+std::uint32_t block_free_space::get_data_size(const_data_t ptr)
+{
+    return get_size(ptr) - sizeof(detail::free_space_meta_t);
+}
+
+
 
 } // namespace snapdatabase
 // vim: ts=4 sw=4 et
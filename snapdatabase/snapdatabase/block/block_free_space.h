@@ -29,6 +29,11 @@
 #include    "snapdatabase/data/structure.h"
 
 
+// C++ lib
+//
+#include    <functional>
+
+
 
 namespace snapdatabase
 {
@@ -55,6 +60,10 @@ struct free_space_t
 };
 
 
+typedef std::function<void(reference_t old_reference, reference_t new_reference)>
+                                moved_callback_t;
+
+
 class block_free_space
     : public block
 {
@@ -66,11 +75,13 @@ public:
 
     free_space_t                get_free_space(std::uint32_t minimum_size);
     void                        release_space(reference_t offset);
+    bool                        compact_block(block::pointer_t data_block, moved_callback_t moved);
 
     static bool                 get_flag(const_data_t ptr, std::uint8_t flag);
     static void                 set_flag(data_t ptr, std::uint8_t flag);
     static void                 clear_flag(data_t ptr, std::uint8_t flag);
     static std::uint32_t        get_size(const_data_t ptr);
+    static std::uint32_t        get_data_size(const_data_t ptr);
 
 private:
     std::unique_ptr<detail::block_free_space_impl>
@@ -66,6 +66,13 @@ constexpr struct_description_t g_block_header[] =
 };
 
 
+// all the block descriptions start with this header so these fields
+// are at the same offset in any block
+//
+constexpr static_field_t<std::uint32_t> const g_block_header_magic_field(define_static_field<std::uint32_t>(g_block_header, "magic"));
+constexpr static_field_t<std::uint32_t> const g_block_header_version_field(define_static_field<std::uint32_t>(g_block_header, "version"));
+
+
 }
 
 } // namespace snapdatabase
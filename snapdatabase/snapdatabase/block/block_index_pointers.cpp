@@ -26,9 +26,12 @@
  * Index Pointer block. The address in the `EIDX` points to an array of
  * a list of pointers (`oid_t`, really).
  *
- * \todo
- * Determine how to properly grow such lists because that's not too easy
- * in the way it is defined now.
+ * When the array is full, a new `IDXP` gets allocated and linked using
+ * the `next` field. The list of pointers is not sorted, new pointers
+ * are appended at the end.
+ *
+ * The same block is used by the table header to list the `SIDX` blocks,
+ * one per secondary index.
  */
 
 // self
@@ -36,6 +39,7 @@
 #include    "snapdatabase/block/block_index_pointers.h"
 
 #include    "snapdatabase/block/block_header.h"
+#include    "snapdatabase/database/table.h"
 
 
 // last include
@@ -62,6 +66,19 @@ constexpr struct_description_t g_description[] =
         , FieldType(struct_type_t::STRUCT_TYPE_STRUCTURE)
         , FieldSubDescription(detail::g_block_header)
     ),
+    define_description(
+          FieldName("count")
+        , FieldType(struct_type_t::STRUCT_TYPE_UINT32)
+    ),
+    define_description(
+          FieldName("next")
+        , FieldType(struct_type_t::STRUCT_TYPE_REFERENCE)
+    ),
+    //define_description(
+    //      FieldName("pointers")
+    //    , FieldType(struct_type_t::STRUCT_TYPE_ARRAY32) -- we use "count" for the size
+    //    , FieldDescription(g_pointer_description)
+    //),
     end_descriptions()
 };
 
@@ -76,6 +93,10 @@ constexpr descriptions_by_version_t const g_descriptions_by_version[] =
 };
 
 
+constexpr static_field_t<std::uint32_t> const g_count_field(define_static_field<std::uint32_t>(g_description, "count"));
+constexpr static_field_t<std::uint64_t> const g_next_field(define_static_field<std::uint64_t>(g_description, "next"));
+
+
 
 }
 // no name namespace
@@ -89,6 +110,102 @@ block_index_pointers::block_index_pointers(dbfile::pointer_t f, reference_t offs
 }
 
 
+std::uint32_t block_index_pointers::get_count() const
+{
+    return static_cast<std::uint32_t>(get_static_field(g_count_field));
+}
+
+
+void block_index_pointers::set_count(std::uint32_t count)
+{
+    set_static_field(g_count_field, count);
+}
+
+
+reference_t block_index_pointers::get_next() const
+{
+    return static_cast<reference_t>(get_static_field(g_next_field));
+}
+
+
+void block_index_pointers::set_next(reference_t offset)
+{
+    set_static_field(g_next_field, offset);
+}
+
+
+std::uint32_t block_index_pointers::get_max_count() const
+{
+    size_t const page_size(get_table()->get_page_size());
+    return static_cast<std::uint32_t>((page_size - f_structure->get_size()) / sizeof(reference_t));
+}
+
+
+reference_t block_index_pointers::get_pointer(std::uint32_t position) const
+{
+    if(position >= get_count())
+    {
+        throw out_of_bounds(
+                  "pointer position "
+                + std::to_string(position)
+                + " is out of bounds in this IDXP block.");
+    }
+
+    reference_t aligned_reference(0);
+    memcpy(&aligned_reference
+         , data(f_structure->get_size()) + position * sizeof(reference_t)
+         , sizeof(reference_t));
+    return aligned_reference;
+}
+
+
+/** \brief Append a pointer to this block.
+ *
+ * The caller is expected to check whether the block is full first.
+ * If so, it has to allocate a new `IDXP` and link it with set_next().
+ *
+ * \param[in] pointer  The OID or reference to append.
+ */
+void block_index_pointers::add_pointer(reference_t pointer)
+{
+    std::uint32_t const count(get_count());
+    if(count >= get_max_count())
+    {
+        throw out_of_bounds("this IDXP block is full, link a new one to add more pointers.");
+    }
+
+    memcpy(data(f_structure->get_size()) + count * sizeof(reference_t)
+         , &pointer
+         , sizeof(reference_t));
+    set_count(count + 1);
+}
+
+
+
+/** \brief Remove the pointer at \p position from this block.
+ *
+ * The following pointers are moved down by one. The caller is
+ * expected to free the block once it is empty.
+ *
+ * \param[in] position  The position of the pointer to remove.
+ */
+void block_index_pointers::remove_pointer(std::uint32_t position)
+{
+    std::uint32_t const count(get_count());
+    if(position >= count)
+    {
+        throw out_of_bounds(
+                  "pointer position "
+                + std::to_string(position)
+                + " is out of bounds in this IDXP block.");
+    }
+
+    std::uint8_t * ptr(data(f_structure->get_size()) + position * sizeof(reference_t));
+    memmove(ptr, ptr + sizeof(reference_t), (count - position - 1) * sizeof(reference_t));
+    memset(data(f_structure->get_size()) + (count - 1) * sizeof(reference_t), 0, sizeof(reference_t));
+    set_count(count - 1);
+}
+
 
 
 
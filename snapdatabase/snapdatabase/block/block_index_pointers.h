@@ -43,6 +43,14 @@ public:
 
                                 block_index_pointers(dbfile::pointer_t f, reference_t offset);
 
+    std::uint32_t               get_count() const;
+    void                        set_count(std::uint32_t count);
+    reference_t                 get_next() const;
+    void                        set_next(reference_t offset);
+    std::uint32_t               get_max_count() const;
+    reference_t                 get_pointer(std::uint32_t position) const;
+    void                        add_pointer(reference_t pointer);
+    void                        remove_pointer(std::uint32_t position);
 
 private:
 };
@@ -84,6 +84,10 @@ constexpr descriptions_by_version_t const g_descriptions_by_version[] =
 };
 
 
+constexpr static_field_t<std::uint32_t> const g_size_field(define_static_field<std::uint32_t>(g_description, "size"));
+constexpr static_field_t<std::uint64_t> const g_next_schema_block_field(define_static_field<std::uint64_t>(g_description, "next_schema_block"));
+
+
 
 }
 // no name namespace
@@ -98,25 +102,25 @@ block_schema::block_schema(dbfile::pointer_t f, reference_t offset)
 
 std::uint32_t block_schema::get_size()
 {
-    return static_cast<uint32_t>(f_structure->get_uinteger("size"));
+    return static_cast<uint32_t>(get_static_field(g_size_field));
 }
 
 
 void block_schema::set_size(std::uint32_t size)
 {
-    f_structure->set_uinteger("size", size);
+    set_static_field(g_size_field, size);
 }
 
 
 reference_t block_schema::get_next_schema_block()
 {
-    return static_cast<reference_t>(f_structure->get_uinteger("next_schema_block"));
+    return static_cast<reference_t>(get_static_field(g_next_schema_block_field));
 }
 
 
 void block_schema::set_next_schema_block(reference_t offset)
 {
-    f_structure->set_uinteger("next_schema_block", offset);
+    set_static_field(g_next_schema_block_field, offset);
 }
 
 
@@ -116,6 +116,9 @@ constexpr descriptions_by_version_t const g_descriptions_by_version[] =
 };
 
 
+constexpr static_field_t<std::uint16_t> const g_count_field(define_static_field<std::uint16_t>(g_description, "count"));
+
+
 
 }
 // no name namespace
@@ -131,13 +134,13 @@ block_schema_list::block_schema_list(dbfile::pointer_t f, reference_t offset)
 
 std::uint32_t block_schema_list::get_count() const
 {
-    return static_cast<std::uint32_t>(f_structure->get_uinteger("count"));
+    return static_cast<std::uint32_t>(get_static_field(g_count_field));
 }
 
 
 void block_schema_list::set_count(std::uint32_t id)
 {
-    f_structure->set_uinteger("count", id);
+    set_static_field(g_count_field, static_cast<std::uint16_t>(id));
 }
 
 
@@ -90,6 +90,12 @@ constexpr descriptions_by_version_t const g_descriptions_by_version[] =
 };
 
 
+constexpr static_field_t<std::uint32_t> const g_id_field(define_static_field<std::uint32_t>(g_description, "id"));
+constexpr static_field_t<std::uint64_t> const g_number_of_rows_field(define_static_field<std::uint64_t>(g_description, "number_of_rows"));
+constexpr static_field_t<std::uint64_t> const g_top_index_field(define_static_field<std::uint64_t>(g_description, "top_index"));
+constexpr static_field_t<std::uint32_t> const g_bloom_filter_flags_field(define_static_field<std::uint32_t>(g_description, "bloom_filter_flags"));
+
+
 
 }
 // no name namespace
@@ -105,49 +111,49 @@ block_secondary_index::block_secondary_index(dbfile::pointer_t f, reference_t of
 
 uint32_t block_secondary_index::get_id() const
 {
-    return static_cast<uint32_t>(f_structure->get_uinteger("id"));
+    return static_cast<uint32_t>(get_static_field(g_id_field));
 }
 
 
 void block_secondary_index::set_id(uint32_t id)
 {
-    f_structure->set_uinteger("id", id);
+    set_static_field(g_id_field, id);
 }
 
 
 uint64_t block_secondary_index::get_number_of_rows() const
 {
-    return static_cast<reference_t>(f_structure->get_uinteger("number_of_rows"));
+    return static_cast<reference_t>(get_static_field(g_number_of_rows_field));
 }
 
 
 void block_secondary_index::set_number_of_rows(uint64_t count)
 {
-    f_structure->set_uinteger("number_of_rows", count);
+    set_static_field(g_number_of_rows_field, count);
 }
 
 
 reference_t block_secondary_index::get_top_index() const
 {
-    return static_cast<reference_t>(f_structure->get_uinteger("top_index"));
+    return static_cast<reference_t>(get_static_field(g_top_index_field));
 }
 
 
 void block_secondary_index::set_top_index(reference_t offset)
 {
-    f_structure->set_uinteger("top_index", offset);
+    set_static_field(g_top_index_field, offset);
 }
 
 
 uint32_t block_secondary_index::get_bloom_filter_flags() const
 {
-    return static_cast<reference_t>(f_structure->get_uinteger("bloom_filter_flags"));
+    return static_cast<reference_t>(get_static_field(g_bloom_filter_flags_field));
 }
 
 
 void block_secondary_index::set_bloom_filter_flags(uint32_t flags)
 {
-    f_structure->set_uinteger("bloom_filter_flags", flags);
+    set_static_field(g_bloom_filter_flags_field, flags);
 }
 
 
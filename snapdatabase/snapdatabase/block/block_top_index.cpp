@@ -30,6 +30,12 @@
 #include    "snapdatabase/block/block_top_index.h"
 
 #include    "snapdatabase/block/block_header.h"
+#include    "snapdatabase/database/table.h"
+
+
+// C++ lib
+//
+#include    <algorithm>
 
 
 // last include
@@ -99,6 +105,10 @@ constexpr descriptions_by_version_t const g_descriptions_by_version[] =
 };
 
 
+constexpr static_field_t<std::uint32_t> const g_count_field(define_static_field<std::uint32_t>(g_description, "count"));
+constexpr static_field_t<std::uint32_t> const g_size_field(define_static_field<std::uint32_t>(g_description, "size"));
+
+
 
 }
 // no name namespace
@@ -114,13 +124,13 @@ block_top_index::block_top_index(dbfile::pointer_t f, reference_t offset)
 
 std::uint32_t block_top_index::get_count() const
 {
-    return static_cast<std::uint32_t>(f_structure->get_uinteger("count"));
+    return static_cast<std::uint32_t>(get_static_field(g_count_field));
 }
 
 
 void block_top_index::set_count(std::uint32_t id)
 {
-    f_structure->set_uinteger("count", id);
+    set_static_field(g_count_field, id);
 }
 
 
@@ -128,7 +138,7 @@ void block_top_index::set_count(std::uint32_t id)
 //
 std::uint32_t block_top_index::get_size() const
 {
-    return static_cast<std::uint32_t>(f_structure->get_uinteger("size"));
+    return static_cast<std::uint32_t>(get_static_field(g_size_field));
 }
 
 
@@ -136,7 +146,7 @@ void block_top_index::set_size(std::uint32_t size)
 {
     // size can be really anything, we don't try to align anything
     //
-    f_structure->set_uinteger("size", size);
+    set_static_field(g_size_field, size);
 }
 
 
@@ -193,6 +203,249 @@ std::uint32_t block_top_index::get_position() const
 }
 
 
+/** \brief Find the child block which may include \p key.
+ *
+ * Contrary to the find_index() function, this one does not expect
+ * an exact match. Each entry in this block is the smallest key found
+ * in the corresponding child block. So the child which may include
+ * \p key is the last entry with a key smaller or equal to \p key.
+ * If \p key is smaller than all the keys, the first child is returned.
+ *
+ * This is what is used to search secondary indexes where the keys
+ * define ranges.
+ *
+ * The position of that entry is available with get_position().
+ *
+ * \param[in] key  The key to search.
+ *
+ * \return The reference to the child block or NULL_FILE_ADDR if empty.
+ */
+reference_t block_top_index::find_child(buffer_t const & key) const
+{
+    std::uint32_t const count(get_count());
+    f_position = 0;
+    if(count == 0)
+    {
+        return NULL_FILE_ADDR;
+    }
+
+    std::uint8_t const * buffer(data(f_structure->get_size()));
+    std::uint32_t const size(get_size());
+    std::uint32_t const length(std::min(key.size(), size - sizeof(reference_t)));
+    std::uint32_t i(0);
+    std::uint32_t j(count);
+    while(i < j)
+    {
+        std::uint32_t const p((j - i) / 2 + i);
+        int const r(memcmp(buffer + p * size + sizeof(reference_t), key.data(), length));
+        if(r <= 0)
+        {
+            i = p + 1;
+        }
+        else
+        {
+            j = p;
+        }
+    }
+
+    // `i` is the first entry larger than `key`, we want the one before
+    //
+    f_position = i == 0 ? 0 : i - 1;
+
+    reference_t aligned_reference(0);
+    memcpy(&aligned_reference, buffer + f_position * size, sizeof(reference_t));
+    return aligned_reference;
+}
+
+
+std::uint32_t block_top_index::get_max_count() const
+{
+    std::uint32_t const size(get_size());
+    if(size <= sizeof(reference_t))
+    {
+        throw snapdatabase_logic_error("the size of this block_top_index is not yet defined calling get_max_count().");
+    }
+
+    size_t const page_size(get_table()->get_page_size());
+    return static_cast<std::uint32_t>((page_size - f_structure->get_size()) / size);
+}
+
+
+reference_t block_top_index::get_index_reference(std::uint32_t position) const
+{
+    if(position >= get_count())
+    {
+        throw out_of_bounds(
+                  "index position "
+                + std::to_string(position)
+                + " is out of bounds in this TIDX block.");
+    }
+
+    reference_t aligned_reference(0);
+    memcpy(&aligned_reference
+         , data(f_structure->get_size()) + position * get_size()
+         , sizeof(reference_t));
+    return aligned_reference;
+}
+
+
+buffer_t block_top_index::get_index_key(std::uint32_t position) const
+{
+    if(position >= get_count())
+    {
+        throw out_of_bounds(
+                  "index position "
+                + std::to_string(position)
+                + " is out of bounds in this TIDX block.");
+    }
+
+    std::uint32_t const size(get_size());
+    std::uint8_t const * ptr(data(f_structure->get_size()) + position * size + sizeof(reference_t));
+    return buffer_t(ptr, ptr + size - sizeof(reference_t));
+}
+
+
+/** \brief Change the key of an existing entry.
+ *
+ * The keys must remain sorted. This is used to lower the first key of
+ * a top index when a smaller key gets added to its first child.
+ *
+ * \param[in] position  The position of the entry to change.
+ * \param[in] key  The new key of that entry.
+ */
+void block_top_index::set_index_key(std::uint32_t position, buffer_t const & key)
+{
+    if(position >= get_count())
+    {
+        throw out_of_bounds(
+                  "index position "
+                + std::to_string(position)
+                + " is out of bounds in this TIDX block.");
+    }
+
+    std::uint32_t const size(get_size());
+    std::uint32_t const length(size - sizeof(reference_t));
+    std::uint32_t const min_length(std::min(length, static_cast<std::uint32_t>(key.size())));
+    std::uint8_t * ptr(data(f_structure->get_size()) + position * size + sizeof(reference_t));
+    memcpy(ptr, key.data(), min_length);
+    if(min_length < length)
+    {
+        memset(ptr + min_length, 0, length - min_length);
+    }
+}
+
+
+/** \brief Insert a new child in this top index.
+ *
+ * The \p key is expected to be the smallest key of the child block
+ * found at \p reference. The new entry is inserted in order.
+ *
+ * The caller must make sure that there is enough room (see
+ * get_max_count()) and split the block otherwise.
+ *
+ * \param[in] key  The smallest key of the child block.
+ * \param[in] reference  The reference to the child block.
+ */
+void block_top_index::add_index(buffer_t const & key, reference_t reference)
+{
+    std::uint32_t const count(get_count());
+    if(count >= get_max_count())
+    {
+        throw out_of_bounds("this TIDX block is full, it needs to be split before adding more indexes.");
+    }
+
+    std::uint8_t * buffer(data(f_structure->get_size()));
+    std::uint32_t const size(get_size());
+    std::uint32_t const length(size - sizeof(reference_t));
+    std::uint32_t const min_length(std::min(length, static_cast<std::uint32_t>(key.size())));
+    std::uint32_t i(0);
+    std::uint32_t j(count);
+    while(i < j)
+    {
+        std::uint32_t const p((j - i) / 2 + i);
+        int const r(memcmp(buffer + p * size + sizeof(reference_t), key.data(), min_length));
+        if(r <= 0)
+        {
+            i = p + 1;
+        }
+        else
+        {
+            j = p;
+        }
+    }
+
+    std::uint8_t * ptr(buffer + i * size);
+    if(i < count)
+    {
+        memmove(ptr + size, ptr, (count - i) * size);
+    }
+    memcpy(ptr, &reference, sizeof(reference_t));
+    memcpy(ptr + sizeof(reference_t), key.data(), min_length);
+    if(min_length < length)
+    {
+        memset(ptr + sizeof(reference_t) + min_length, 0, length - min_length);
+    }
+
+    set_count(count + 1);
+}
+
+
+/** \brief Remove the child at \p position from this top index.
+ *
+ * This is used once a child block becomes empty and gets freed. The
+ * following entries are moved down by one.
+ *
+ * \param[in] position  The position of the child to remove.
+ */
+void block_top_index::remove_index(std::uint32_t position)
+{
+    std::uint32_t const count(get_count());
+    if(position >= count)
+    {
+        throw out_of_bounds(
+                  "index position "
+                + std::to_string(position)
+                + " is out of bounds in this TIDX block.");
+    }
+
+    std::uint8_t * buffer(data(f_structure->get_size()));
+    std::uint32_t const size(get_size());
+    std::uint8_t * ptr(buffer + position * size);
+    memmove(ptr, ptr + size, (count - position - 1) * size);
+    memset(buffer + (count - 1) * size, 0, size);
+
+    set_count(count - 1);
+}
+
+
+/** \brief Move the upper half of the indexes to \p new_block.
+ *
+ * This function is used when a top index is full. The \p new_block
+ * must be empty. The caller is responsible for adding the new block
+ * in the parent top index.
+ *
+ * \param[in] new_block  The empty block receiving the upper indexes.
+ */
+void block_top_index::split_indexes(pointer_t new_block)
+{
+    if(new_block->get_count() != 0)
+    {
+        throw snapdatabase_logic_error("the new block_top_index must be empty to split a TIDX.");
+    }
+
+    std::uint32_t const count(get_count());
+    std::uint32_t const size(get_size());
+    std::uint32_t const keep(count / 2);
+
+    new_block->set_size(size);
+    memcpy(new_block->data(new_block->f_structure->get_size())
+         , data(f_structure->get_size()) + keep * size
+         , (count - keep) * size);
+    new_block->set_count(count - keep);
+    set_count(keep);
+}
+
+
 
 } // namespace snapdatabase
 // vim: ts=4 sw=4 et
@@ -49,8 +49,17 @@ public:
     void                        set_size(std::uint32_t size);
 
     reference_t                 find_index(buffer_t key) const;
+    reference_t                 find_child(buffer_t const & key) const;
     std::uint32_t               get_position() const;
 
+    std::uint32_t               get_max_count() const;
+    reference_t                 get_index_reference(std::uint32_t position) const;
+    buffer_t                    get_index_key(std::uint32_t position) const;
+    void                        set_index_key(std::uint32_t position, buffer_t const & key);
+    void                        add_index(buffer_t const & key, reference_t reference);
+    void                        remove_index(std::uint32_t position);
+    void                        split_indexes(pointer_t new_block);
+
 private:
     mutable std::uint32_t       f_position = 0;
 };
@@ -103,6 +103,9 @@ constexpr descriptions_by_version_t const g_descriptions_by_version[] =
 };
 
 
+constexpr static_field_t<std::uint8_t> const g_block_level_field(define_static_field<std::uint8_t>(g_description, "block_level"));
+
+
 
 }
 // no name namespace
@@ -153,13 +156,13 @@ size_t block_top_indirect_index::get_max_count() const
 
 uint8_t block_top_indirect_index::get_block_level() const
 {
-    return static_cast<uint8_t>(f_structure->get_uinteger("block_level"));
+    return static_cast<uint8_t>(get_static_field(g_block_level_field));
 }
 
 
 void block_top_indirect_index::set_block_level(uint8_t level)
 {
-    f_structure->set_uinteger("block_level", level);
+    set_static_field(g_block_level_field, level);
 }
 
 
@@ -0,0 +1,522 @@
+// Copyright (c) 2019  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapdatabase
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+/** \file
+ * \brief Commit log implementation.
+ *
+ * The commit log is a simple append only file. Each record starts with
+ * a small header followed by the payload (a page image or a row).
+ *
+ * The header includes a checksum of the payload. When replaying the log,
+ * the first record which is incomplete or which has an invalid checksum
+ * marks the end of the log (i.e. a write which did not make it to disk
+ * before a crash).
+ */
+
+// self
+//
+#include    "snapdatabase/data/commit_log.h"
+
+#include    "snapdatabase/exception.h"
+#include    "snapdatabase/file/hash.h"
+
+
+// snaplogger lib
+//
+#include    <snaplogger/message.h>
+
+
+// C++ lib
+//
+#include    <algorithm>
+
+
+// C lib
+//
+#include    <fcntl.h>
+#include    <string.h>
+#include    <sys/stat.h>
+#include    <unistd.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace snapdatabase
+{
+
+
+namespace
+{
+
+
+constexpr char const *          g_commit_log_extension = ".snaplog";
+
+
+struct commit_log_header_t
+{
+    dbtype_t                    f_magic = dbtype_t::FILE_TYPE_COMMIT_LOG;
+    commit_log_record_t         f_type = commit_log_record_t::COMMIT_LOG_RECORD_ROW;
+    std::uint8_t                f_mode = 0;
+    std::uint16_t               f_reserved = 0;
+    std::uint32_t               f_size = 0;
+    hash_t                      f_checksum = 0;
+    std::uint64_t               f_sequence = 0;
+    reference_t                 f_offset = NULL_FILE_ADDR;
+};
+
+static_assert(sizeof(commit_log_header_t) == 32, "the commit log header is expected to be exactly 32 bytes");
+
+
+hash_t record_checksum(commit_log_header_t const & header, const_data_t data, std::size_t size)
+{
+    hash h(static_cast<hash_t>(header.f_sequence));
+    h.add(reinterpret_cast<std::uint8_t const *>(&header.f_offset), sizeof(header.f_offset));
+    h.add(data, size);
+    return h.get();
+}
+
+
+}
+// no name namespace
+
+
+
+commit_log::commit_log(std::string const & dirname, std::string const & filename)
+    : f_fullname(dirname + "/" + filename + g_commit_log_extension)
+{
+}
+
+
+commit_log::~commit_log()
+{
+    try
+    {
+        sync();
+    }
+    catch(io_error const & e)
+    {
+        SNAP_LOG_ERROR
+            << "could not synchronize commit log \""
+            << f_fullname
+            << "\" on exit: "
+            << e.what()
+            << SNAP_LOG_SEND;
+    }
+
+    if(f_fd != -1)
+    {
+        ::close(f_fd);
+    }
+}
+
+
+std::string commit_log::get_fullname() const
+{
+    return f_fullname;
+}
+
+
+/** \brief Define the group commit policy.
+ *
+ * By default, each commit() synchronizes the log. This is the safest
+ * but also the slowest since each row then costs one fdatasync().
+ *
+ * With a \p count larger than 1 and/or a \p delay_us larger than 0,
+ * the log gets synchronized only once \p count rows were committed
+ * or once the oldest row not yet synchronized is \p delay_us
+ * microseconds old. Rows which were not yet synchronized may be
+ * lost on a crash, however, the table always remains consistent.
+ *
+ * The delay only gets checked when a row gets committed. Once the
+ * rows stop coming, sync_expired() has to be called to synchronize
+ * the last ones.
+ *
+ * \param[in] count  The number of rows to accumulate before a sync.
+ * \param[in] delay_us  The maximum amount of time to wait before a sync.
+ */
+void commit_log::set_group_commit(std::uint32_t count, std::int64_t delay_us)
+{
+    f_group_commit_count = std::max(count, static_cast<std::uint32_t>(1));
+    f_group_commit_delay = std::max(delay_us, static_cast<std::int64_t>(0));
+}
+
+
+/** \brief Save the image of a page before it gets modified.
+ *
+ * The log gets synchronized before this function returns. The caller
+ * modifies the page right after and the kernel may write that dirty
+ * mmap()'ed page back to the table file at any time, so the image must
+ * be on disk first. Otherwise a crash could leave a modified or torn
+ * page in the file with nothing to restore it from.
+ *
+ * This happens only the first time a page gets modified after a
+ * checkpoint so the cost gets amortized over all the rows modifying
+ * that page until the next checkpoint.
+ *
+ * The \p file_id is saved as the mode of the record. It identifies the
+ * file the page belongs to since the table file and the files attached
+ * to it (i.e. the Bloom Filter) share the same log.
+ *
+ * \param[in] offset  The offset of the page in its file.
+ * \param[in] page  A pointer to the page data.
+ * \param[in] size  The size of the page.
+ * \param[in] file_id  The identifier of the file the page belongs to.
+ */
+void commit_log::append_page(reference_t offset, const_data_t page, std::size_t size, std::uint8_t file_id)
+{
+    append(commit_log_record_t::COMMIT_LOG_RECORD_PAGE, file_id, offset, page, size);
+
+    f_pending_pages = true;
+    sync();
+}
+
+
+/** \brief Save a committed row.
+ *
+ * The row is appended to the log. It does not get synchronized until
+ * the commit() function decides that it is time to do so.
+ *
+ * \param[in] mode  The commit mode used to save this row.
+ * \param[in] row  The binary representation of the row.
+ */
+void commit_log::append_row(std::uint8_t mode, buffer_t const & row)
+{
+    append(commit_log_record_t::COMMIT_LOG_RECORD_ROW, mode, NULL_FILE_ADDR, row.data(), row.size());
+}
+
+
+/** \brief Mark the end of a transaction.
+ *
+ * This function applies the group commit policy. If enough rows were
+ * committed or enough time elapsed since the first row which was not
+ * yet synchronized, then the log gets synchronized.
+ *
+ * The page images do not need to be taken in account here since
+ * append_page() synchronizes them right away.
+ *
+ * \return true if the log was synchronized.
+ */
+bool commit_log::commit()
+{
+    std::chrono::steady_clock::time_point const now(std::chrono::steady_clock::now());
+    if(f_pending == 0)
+    {
+        f_first_pending = now;
+    }
+    ++f_pending;
+
+    if(f_pending < f_group_commit_count
+    && std::chrono::duration_cast<std::chrono::microseconds>(now - f_first_pending).count() < f_group_commit_delay)
+    {
+        return false;
+    }
+
+    sync();
+    return true;
+}
+
+
+/** \brief Synchronize the rows which waited long enough.
+ *
+ * The commit() function only checks the delay of the group commit policy
+ * when a new row gets committed. When the table goes idle, the last rows
+ * would remain unsynchronized until the next checkpoint. This function
+ * is expected to be called from a timer: if the oldest row which was not
+ * yet synchronized is at least \em delay microseconds old, the log gets
+ * synchronized.
+ *
+ * \return The number of microseconds until the next call is due or -1
+ * if no rows are waiting to be synchronized.
+ */
+std::int64_t commit_log::sync_expired()
+{
+    if(f_pending == 0)
+    {
+        return -1;
+    }
+
+    std::int64_t const elapsed(std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - f_first_pending).count());
+    if(elapsed < f_group_commit_delay)
+    {
+        return f_group_commit_delay - elapsed;
+    }
+
+    sync();
+    return -1;
+}
+
+
+/** \brief Synchronize the log to disk.
+ *
+ * This function calls fdatasync() if anything was appended to the log
+ * since the last call.
+ */
+void commit_log::sync()
+{
+    if((f_pending == 0 && !f_pending_pages)
+    || f_fd == -1)
+    {
+        return;
+    }
+
+    if(fdatasync(f_fd) != 0)
+    {
+        int const e(errno);
+        throw io_error(
+              "fdatasync() failed on \""
+            + f_fullname
+            + "\" (errno: "
+            + std::to_string(e)
+            + ", "
+            + strerror(e)
+            + ").");
+    }
+
+    f_pending = 0;
+    f_pending_pages = false;
+}
+
+
+std::uint64_t commit_log::get_size()
+{
+    open_file();
+    return f_size;
+}
+
+
+/** \brief Read all the valid records of the log.
+ *
+ * This function reads the log from the start and calls \p callback
+ * once per valid record. The first invalid record (incomplete or with
+ * a bad checksum) ends the replay and the log gets truncated at that
+ * point so new records do not get appended after garbage.
+ *
+ * \param[in] callback  The function called with each record.
+ */
+void commit_log::replay(replay_callback_t callback)
+{
+    open_file();
+    if(f_size == 0)
+    {
+        return;
+    }
+
+    buffer_t log(f_size);
+    std::uint64_t pos(0);
+    while(pos < f_size)
+    {
+        ssize_t const r(pread(f_fd, log.data() + pos, f_size - pos, pos));
+        if(r <= 0)
+        {
+            if(r == -1 && errno == EINTR)
+            {
+                continue;
+            }
+            int const e(errno);
+            throw io_error(
+                  "System could not read commit log \""
+                + f_fullname
+                + "\" (errno: "
+                + std::to_string(e)
+                + ", "
+                + strerror(e)
+                + ").");
+        }
+        pos += r;
+    }
+
+    pos = 0;
+    while(pos + sizeof(commit_log_header_t) <= f_size)
+    {
+        commit_log_header_t header;
+        memcpy(&header, log.data() + pos, sizeof(header));
+        if(header.f_magic != dbtype_t::FILE_TYPE_COMMIT_LOG
+        || pos + sizeof(header) + header.f_size > f_size)
+        {
+            break;
+        }
+        const_data_t const data(log.data() + pos + sizeof(header));
+        if(record_checksum(header, data, header.f_size) != header.f_checksum)
+        {
+            break;
+        }
+
+        callback(header.f_type, header.f_mode, header.f_offset, data, header.f_size);
+
+        f_sequence = header.f_sequence + 1;
+        pos += sizeof(header) + header.f_size;
+    }
+
+    if(pos != f_size)
+    {
+        SNAP_LOG_WARNING
+            << "commit log \""
+            << f_fullname
+            << "\" ends with "
+            << f_size - pos
+            << " bytes of incomplete data; ignoring."
+            << SNAP_LOG_SEND;
+
+        if(ftruncate(f_fd, pos) != 0)
+        {
+            int const e(errno);
+            throw io_error(
+                  "System could not truncate commit log \""
+                + f_fullname
+                + "\" (errno: "
+                + std::to_string(e)
+                + ", "
+                + strerror(e)
+                + ").");
+        }
+        f_size = pos;
+    }
+}
+
+
+/** \brief Empty the log.
+ *
+ * Once the table file was flushed to disk (a checkpoint) the log is not
+ * necessary anymore and this function is used to truncate it.
+ */
+void commit_log::truncate()
+{
+    open_file();
+
+    if(ftruncate(f_fd, 0) != 0
+    || fdatasync(f_fd) != 0)
+    {
+        int const e(errno);
+        throw io_error(
+              "System could not truncate commit log \""
+            + f_fullname
+            + "\" (errno: "
+            + std::to_string(e)
+            + ", "
+            + strerror(e)
+            + ").");
+    }
+
+    f_size = 0;
+    f_pending = 0;
+    f_pending_pages = false;
+}
+
+
+int commit_log::open_file()
+{
+    if(f_fd != -1)
+    {
+        return f_fd;
+    }
+
+    f_fd = open(f_fullname.c_str(), O_RDWR | O_CLOEXEC | O_NOATIME | O_NOFOLLOW | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR);
+    if(f_fd == -1)
+    {
+        int const e(errno);
+        throw io_error(
+              "System could not open commit log \""
+            + f_fullname
+            + "\" (errno: "
+            + std::to_string(e)
+            + ", "
+            + strerror(e)
+            + ").");
+    }
+
+    struct stat s;
+    if(fstat(f_fd, &s) != 0)
+    {
+        int const e(errno);
+        throw io_error(
+              "stat() failed on \""
+            + f_fullname
+            + "\" (errno: "
+            + std::to_string(e)
+            + ", "
+            + strerror(e)
+            + ").");
+    }
+    f_size = s.st_size;
+
+    return f_fd;
+}
+
+
+void commit_log::append(
+      commit_log_record_t type
+    , std::uint8_t mode
+    , reference_t offset
+    , const_data_t data
+    , std::size_t size)
+{
+    open_file();
+
+    commit_log_header_t header;
+    header.f_type = type;
+    header.f_mode = mode;
+    header.f_size = size;
+    header.f_sequence = f_sequence;
+    header.f_offset = offset;
+    header.f_checksum = record_checksum(header, data, size);
+
+    // write the header and payload at once so a record is never
+    // interleaved with another
+    //
+    buffer_t record(sizeof(header) + size);
+    memcpy(record.data(), &header, sizeof(header));
+    memcpy(record.data() + sizeof(header), data, size);
+
+    std::size_t pos(0);
+    while(pos < record.size())
+    {
+        ssize_t const r(write(f_fd, record.data() + pos, record.size() - pos));
+        if(r <= 0)
+        {
+            if(r == -1 && errno == EINTR)
+            {
+                continue;
+            }
+            int const e(errno);
+            throw io_error(
+                  "System could not write to commit log \""
+                + f_fullname
+                + "\" (errno: "
+                + std::to_string(e)
+                + ", "
+                + strerror(e)
+                + ").");
+        }
+        pos += r;
+    }
+
+    ++f_sequence;
+    f_size += record.size();
+}
+
+
+
+} // namespace snapdatabase
+// vim: ts=4 sw=4 et
@@ -0,0 +1,137 @@
+// Copyright (c) 2019  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapdatabase
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+
+/** \file
+ * \brief Commit log (write-ahead log) of a table.
+ *
+ * Each table has one commit log file. The file is append only. Two
+ * types of records get saved in it:
+ *
+ * \li Page images -- the first time a page of the table file gets
+ * modified after a checkpoint, its current content is saved in the
+ * log and the log gets synchronized before the modification happens,
+ * whatever the group commit policy. This protects the table against
+ * torn pages since the kernel may write a dirty mmap()'ed page back
+ * to disk at any time.
+ * The pages of the files attached to the table, such as its Bloom
+ * Filter, are saved in the same log. The record says which file the
+ * page belongs to.
+ *
+ * \li Rows -- once a row was committed, its binary representation is
+ * appended to the log. On a restart, the page images are restored
+ * and the rows are committed again.
+ *
+ * The synchronization of the row records (i.e. fdatasync()) is batched
+ * with a group commit policy: the log is synchronized once \em count
+ * rows were appended or \em delay microseconds elapsed since the first
+ * row which was not yet synchronized, whichever comes first. Since no
+ * more rows may be committed for a while, the owner of the log has to
+ * call sync_expired() once the delay is over (the server does so from
+ * its event loop).
+ *
+ * Once the log grows over a certain size, the table runs a checkpoint:
+ * the table file is flushed to disk and the log is truncated.
+ */
+
+// self
+//
+#include    "snapdatabase/data/dbfile.h"
+#include    "snapdatabase/data/virtual_buffer.h"
+
+
+// C++ lib
+//
+#include    <chrono>
+#include    <functional>
+
+
+
+namespace snapdatabase
+{
+
+
+
+enum class commit_log_record_t : std::uint8_t
+{
+    COMMIT_LOG_RECORD_PAGE = 1,
+    COMMIT_LOG_RECORD_ROW = 2
+};
+
+
+class commit_log
+{
+public:
+    typedef std::shared_ptr<commit_log>         pointer_t;
+    typedef std::function<void(
+                  commit_log_record_t type
+                , std::uint8_t mode
+                , reference_t offset
+                , const_data_t data
+                , std::size_t size)>            replay_callback_t;
+
+    static constexpr std::uint32_t  DEFAULT_GROUP_COMMIT_COUNT = 1;
+    static constexpr std::uint32_t  MAXIMUM_GROUP_COMMIT_COUNT = 65536;
+    static constexpr std::int64_t   DEFAULT_GROUP_COMMIT_DELAY = 0;
+    static constexpr std::int64_t   MAXIMUM_GROUP_COMMIT_DELAY = 1000000;
+    static constexpr std::uint64_t  DEFAULT_CHECKPOINT_SIZE = 64 * 1024 * 1024;
+
+                                commit_log(std::string const & dirname, std::string const & filename);
+                                commit_log(commit_log const & rhs) = delete;
+                                ~commit_log();
+
+    commit_log &                operator = (commit_log const & rhs) = delete;
+
+    std::string                 get_fullname() const;
+    void                        set_group_commit(std::uint32_t count, std::int64_t delay_us);
+    void                        append_page(reference_t offset, const_data_t page, std::size_t size, std::uint8_t file_id);
+    void                        append_row(std::uint8_t mode, buffer_t const & row);
+    bool                        commit();
+    std::int64_t                sync_expired();
+    void                        sync();
+    std::uint64_t               get_size();
+    void                        replay(replay_callback_t callback);
+    void                        truncate();
+
+private:
+    int                         open_file();
+    void                        append(
+                                      commit_log_record_t type
+                                    , std::uint8_t mode
+                                    , reference_t offset
+                                    , const_data_t data
+                                    , std::size_t size);
+
+    std::string                 f_fullname = std::string();
+    int                         f_fd = -1;
+    std::uint64_t               f_size = 0;
+    std::uint64_t               f_sequence = 0;
+    std::uint32_t               f_group_commit_count = DEFAULT_GROUP_COMMIT_COUNT;
+    std::int64_t                f_group_commit_delay = DEFAULT_GROUP_COMMIT_DELAY;
+    std::uint32_t               f_pending = 0;
+    bool                        f_pending_pages = false;
+    std::chrono::steady_clock::time_point
+                                f_first_pending = std::chrono::steady_clock::time_point();
+};
+
+
+
+} // namespace snapdatabase
+// vim: ts=4 sw=4 et
@@ -0,0 +1,278 @@
+// Copyright (c) 2019  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapdatabase
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+/** \file
+ * \brief Column compression implementation.
+ *
+ * The compress_buffer() function is used when a row gets saved and the
+ * decompress_buffer() function when the value of a compressed cell is
+ * read.
+ *
+ * The compressed data does not include the size of the uncompressed
+ * data. The caller is expected to save it along the compressed data
+ * so the output buffer can be allocated once.
+ */
+
+// self
+//
+#include    "snapdatabase/data/compression.h"
+
+#include    "snapdatabase/exception.h"
+
+
+// lz4 lib
+//
+#include    <lz4.h>
+
+
+// zstd lib
+//
+#include    <zstd.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace snapdatabase
+{
+
+
+
+namespace
+{
+
+
+
+// zstd default level (3) offers a good speed to ratio compromise
+//
+constexpr int                   g_zstd_level = 3;
+
+
+
+}
+// no name namespace
+
+
+
+compression_t name_to_compression(std::string const & name)
+{
+    if(name.empty()
+    || name == "none")
+    {
+        return compression_t::COMPRESSION_NONE;
+    }
+    if(name == "lz4")
+    {
+        return compression_t::COMPRESSION_LZ4;
+    }
+    if(name == "zstd")
+    {
+        return compression_t::COMPRESSION_ZSTD;
+    }
+
+    throw invalid_parameter(
+              "unknown compression \""
+            + name
+            + "\"; expected \"lz4\" or \"zstd\".");
+}
+
+
+std::string to_string(compression_t compression)
+{
+    switch(compression)
+    {
+    case compression_t::COMPRESSION_NONE:
+        return std::string("none");
+
+    case compression_t::COMPRESSION_LZ4:
+        return std::string("lz4");
+
+    case compression_t::COMPRESSION_ZSTD:
+        return std::string("zstd");
+
+    }
+
+    return std::string("unknown compression (")
+         + std::to_string(static_cast<int>(compression))
+         + ")";
+}
+
+
+/** \brief Compress a buffer.
+ *
+ * This function compresses \p data with the specified algorithm and
+ * saves the result in \p result.
+ *
+ * If the data is too small to be worth compressing or if the compressed
+ * data is not smaller than the input, then the function returns false
+ * and the caller is expected to save the data as is.
+ *
+ * \param[in] compression  The compression algorithm to use.
+ * \param[in] data  The data to compress.
+ * \param[in] size  The size of \p data.
+ * \param[out] result  The compressed data.
+ *
+ * \return true if \p result holds the compressed data.
+ */
+bool compress_buffer(
+      compression_t compression
+    , std::uint8_t const * data
+    , std::size_t size
+    , buffer_t & result)
+{
+    if(size < COMPRESSION_MINIMUM_SIZE)
+    {
+        return false;
+    }
+
+    switch(compression)
+    {
+    case compression_t::COMPRESSION_NONE:
+        return false;
+
+    case compression_t::COMPRESSION_LZ4:
+        {
+            if(size > static_cast<std::size_t>(LZ4_MAX_INPUT_SIZE))
+            {
+                return false;
+            }
+            result.resize(LZ4_compressBound(size));
+            int const sz(LZ4_compress_default(
+                      reinterpret_cast<char const *>(data)
+                    , reinterpret_cast<char *>(result.data())
+                    , size
+                    , result.size()));
+            if(sz <= 0
+            || static_cast<std::size_t>(sz) >= size)
+            {
+                return false;
+            }
+            result.resize(sz);
+        }
+        return true;
+
+    case compression_t::COMPRESSION_ZSTD:
+        {
+            result.resize(ZSTD_compressBound(size));
+            std::size_t const sz(ZSTD_compress(
+                      result.data()
+                    , result.size()
+                    , data
+                    , size
+                    , g_zstd_level));
+            if(ZSTD_isError(sz)
+            || sz >= size)
+            {
+                return false;
+            }
+            result.resize(sz);
+        }
+        return true;
+
+    }
+
+    throw invalid_parameter(
+              "unsupported compression "
+            + to_string(compression)
+            + " in compress_buffer().");
+}
+
+
+/** \brief Decompress a buffer.
+ *
+ * This function decompresses \p data in \p result. The \p result buffer
+ * must be exactly the size of the uncompressed data.
+ *
+ * \exception invalid_size
+ * The decompression failed or the size of the decompressed data does
+ * not match \p result_size.
+ *
+ * \param[in] compression  The compression algorithm used on \p data.
+ * \param[in] data  The compressed data.
+ * \param[in] size  The size of \p data.
+ * \param[out] result  The buffer receiving the decompressed data.
+ * \param[in] result_size  The size of the uncompressed data.
+ */
+void decompress_buffer(
+      compression_t compression
+    , std::uint8_t const * data
+    , std::size_t size
+    , std::uint8_t * result
+    , std::size_t result_size)
+{
+    switch(compression)
+    {
+    case compression_t::COMPRESSION_NONE:
+        if(size != result_size)
+        {
+            break;
+        }
+        memcpy(result, data, size);
+        return;
+
+    case compression_t::COMPRESSION_LZ4:
+        {
+            int const sz(LZ4_decompress_safe(
+                      reinterpret_cast<char const *>(data)
+                    , reinterpret_cast<char *>(result)
+                    , size
+                    , result_size));
+            if(sz < 0
+            || static_cast<std::size_t>(sz) != result_size)
+            {
+                break;
+            }
+        }
+        return;
+
+    case compression_t::COMPRESSION_ZSTD:
+        {
+            std::size_t const sz(ZSTD_decompress(
+                      result
+                    , result_size
+                    , data
+                    , size));
+            if(ZSTD_isError(sz)
+            || sz != result_size)
+            {
+                break;
+            }
+        }
+        return;
+
+    }
+
+    throw invalid_size(
+              "could not decompress "
+            + std::to_string(size)
+            + " bytes of "
+            + to_string(compression)
+            + " data to "
+            + std::to_string(result_size)
+            + " bytes.");
+}
+
+
+
+} // namespace snapdatabase
+// vim: ts=4 sw=4 et
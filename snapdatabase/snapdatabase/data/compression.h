@@ -0,0 +1,75 @@
+// Copyright (c) 2019  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapdatabase
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+
+/** \file
+ * \brief Column compression.
+ *
+ * Columns can be marked as compressed in the schema using the
+ * `compress="lz4|zstd"` attribute. This file defines the functions
+ * used to compress and decompress the values of those columns.
+ *
+ * LZ4 is very fast and is a good choice for data which gets read
+ * often. Zstd compresses better (especially HTML/XML) at a somewhat
+ * higher CPU cost.
+ */
+
+// self
+//
+#include    "snapdatabase/data/virtual_buffer.h"
+
+
+
+namespace snapdatabase
+{
+
+
+
+// SAVED IN FILE, DO NOT CHANGE VALUES
+enum class compression_t : std::uint8_t
+{
+    COMPRESSION_NONE = 0,
+    COMPRESSION_LZ4 = 1,
+    COMPRESSION_ZSTD = 2
+};
+
+
+// values smaller than this are never compressed
+constexpr std::size_t           COMPRESSION_MINIMUM_SIZE = 64;
+
+
+compression_t                   name_to_compression(std::string const & name);
+std::string                     to_string(compression_t compression);
+bool                            compress_buffer(
+                                      compression_t compression
+                                    , std::uint8_t const * data
+                                    , std::size_t size
+                                    , buffer_t & result);
+void                            decompress_buffer(
+                                      compression_t compression
+                                    , std::uint8_t const * data
+                                    , std::size_t size
+                                    , std::uint8_t * result
+                                    , std::size_t result_size);
+
+
+
+} // namespace snapdatabase
+// vim: ts=4 sw=4 et
@@ -30,6 +30,7 @@
 #include    "snapdatabase/data/dbfile.h"
 
 #include    "snapdatabase/block/block_free_block.h"
+#include    "snapdatabase/data/commit_log.h"
 #include    "snapdatabase/data/dbtype.h"
 #include    "snapdatabase/exception.h"
 #include    "snapdatabase/file/file_snap_database_table.h"
@@ -37,6 +38,11 @@
 #include    "snapdatabase/database/table.h"
 
 
+// snaplogger lib
+//
+#include    <snaplogger/message.h>
+
+
 // snapdev lib
 //
 #include    <snapdev/not_used.h>
@@ -44,13 +50,14 @@
 
 // C lib
 //
+#include    <fcntl.h>
 #include    <sys/mman.h>
 #include    <sys/stat.h>
 
 
 // C++ lib
 //
-#include    <iostream>
+#include    <algorithm>
 
 
 // last include
@@ -128,6 +135,7 @@ dbfile::dbfile(std::string const & path, std::string const & table_name, std::st
 dbfile::~dbfile()
 {
     close();
+    unmap_segments();
 }
 
 
@@ -137,6 +145,12 @@ std::string dbfile::get_fullname() const
 }
 
 
+std::string dbfile::get_dirname() const
+{
+    return f_dirname;
+}
+
+
 void dbfile::set_table(table::pointer_t t)
 {
     f_table = t;
@@ -186,6 +200,11 @@ void dbfile::set_page_size(size_t page_size)
     {
         f_page_size = count * system_page_size;
     }
+
+    // the segments must be a multiple of our pages so a block never
+    // crosses a segment boundary
+    //
+    f_segment_size = std::max(DEFAULT_SEGMENT_SIZE / f_page_size, static_cast<size_t>(1)) * f_page_size;
 }
 
 
@@ -287,6 +306,14 @@ int dbfile::open_file()
                 + "\".");
         }
 
+        // other types of files (i.e. the bloom filter) are initialized
+        // by their owner
+        //
+        if(f_type != dbtype_t::FILE_TYPE_SNAP_DATABASE_TABLE)
+        {
+            return f_fd;
+        }
+
         // in this one case we are in creation mode which means we
         // create the header block, which is important because it has
         // the special offset of 0 and we use that block to allocate
@@ -308,79 +335,519 @@ int dbfile::open_file()
 }
 
 
+size_t dbfile::get_segment_size() const
+{
+    if(f_segment_size == 0)
+    {
+        throw snapdatabase_logic_error("The dbfile segment size is not yet defined.");
+    }
+
+    return f_segment_size;
+}
+
+
+/** \brief Change the access pattern used with the mapped segments.
+ *
+ * By default, we expect random accesses (i.e. row fetches through the
+ * indexes) so we tell the kernel that read-ahead is not useful. When
+ * going through a large number of blocks in file order (i.e. a cursor
+ * reading a table sequentially, a backup, a compaction) you can switch
+ * the pattern to sequential.
+ *
+ * The new pattern gets applied to all the segments already mapped and
+ * the segments mapped later.
+ *
+ * \param[in] pattern  The new access pattern.
+ */
+void dbfile::set_access_pattern(access_pattern_t pattern)
+{
+    if(f_access_pattern == pattern)
+    {
+        return;
+    }
+
+    f_access_pattern = pattern;
+    for(auto const & s : f_segments)
+    {
+        if(s.f_data != nullptr)
+        {
+            advise(s.f_data, f_segment_size, f_access_pattern);
+        }
+    }
+}
+
+
+access_pattern_t dbfile::get_access_pattern() const
+{
+    return f_access_pattern;
+}
+
+
+/** \brief Tell the kernel we are about to read these blocks.
+ *
+ * This function maps the segments covering the specified area and
+ * calls madvise() with MADV_WILLNEED so the kernel starts reading
+ * the data in the background.
+ *
+ * \param[in] offset  The offset of the first block to prefetch.
+ * \param[in] size  The number of bytes to prefetch.
+ */
+void dbfile::prefetch(reference_t offset, size_t size)
+{
+    if(size == 0)
+    {
+        return;
+    }
+
+    open_file();
+
+    size_t const segment_size(get_segment_size());
+    size_t const system_page_size(get_system_page_size());
+    reference_t const end(offset + size);
+    while(offset < end)
+    {
+        segment_t const & s(map_segment(offset / segment_size));
+        reference_t const segment_offset(offset - s.f_offset);
+        reference_t const start(segment_offset - segment_offset % system_page_size);
+        size_t const length(std::min(static_cast<reference_t>(segment_size), segment_offset + (end - offset)) - start);
+        if(madvise(s.f_data + start, length, MADV_WILLNEED) != 0)
+        {
+            SNAP_LOG_DEBUG
+                << "madvise(MADV_WILLNEED) failed on \""
+                << f_filename
+                << "\"."
+                << SNAP_LOG_SEND;
+        }
+        offset = s.f_offset + segment_size;
+    }
+}
+
+
+/** \brief Get a pointer to the block at \p offset.
+ *
+ * The file is mapped in segments of get_segment_size() bytes. The
+ * first time a block within a segment is accessed, the whole segment
+ * gets mapped. Further accesses to that segment are just an index in
+ * a vector (O(1)).
+ *
+ * The segments are mapped in full, even past the current end of the
+ * file. This means appending blocks to the file does not require us
+ * to remap anything (i.e. no mremap(), which could move the segment
+ * and invalidate the pointers held by our blocks). Accessing memory
+ * past the end of the file generates a SIGBUS, but the tables never
+ * access a block which was not first allocated.
+ *
+ * \param[in] offset  The offset of the data in the file.
+ *
+ * \return A pointer to the data at \p offset.
+ */
 data_t dbfile::data(reference_t offset)
 {
-    int fd(open_file());
+    open_file();
+
+    size_t const segment_size(get_segment_size());
+    segment_t const & s(map_segment(offset / segment_size));
+    return s.f_data + (offset - s.f_offset);
+}
+
+
+/** \brief Release a pointer returned by data().
+ *
+ * Since the segments remain mapped until the dbfile gets destroyed,
+ * this function does not actually unmap anything. It still verifies
+ * that the pointer was returned by data() and throws if not.
+ *
+ * \exception page_not_found
+ * The \p data pointer is not part of any of our segments.
+ *
+ * \param[in] data  A pointer as returned by data().
+ */
+void dbfile::release_data(data_t data)
+{
+    snapdev::NOT_USED(find_segment(data));
+}
+
+
+/** \brief Release the memory used by one page.
+ *
+ * The block cache calls this function when it evicts a block so the
+ * resident memory of the process does not grow with the size of the
+ * table.
+ *
+ * The segments are mapped with MAP_SHARED so MADV_DONTNEED only
+ * removes the page from our address space. The data, modified or not,
+ * remains in the kernel page cache and the next access to that page
+ * reads it back from there.
+ *
+ * \param[in] offset  The offset of the page to release.
+ */
+void dbfile::release_page(reference_t offset)
+{
+    size_t const index(offset / get_segment_size());
+    if(index >= f_segments.size()
+    || f_segments[index].f_data == nullptr)
+    {
+        return;
+    }
+
+    segment_t const & s(f_segments[index]);
+    if(madvise(s.f_data + (offset - s.f_offset), get_page_size(), MADV_DONTNEED) != 0)
+    {
+        SNAP_LOG_DEBUG
+            << "madvise(MADV_DONTNEED) failed on \""
+            << f_filename
+            << "\"."
+            << SNAP_LOG_SEND;
+    }
+}
+
+
+void dbfile::sync(data_t data, bool immediate)
+{
+    segment_t const & s(find_segment(data));
 
     size_t const sz(get_page_size());
+    size_t const page_offset(data - s.f_data);
+
+    msync(s.f_data + page_offset - page_offset % sz
+        , sz
+        , (immediate ? MS_SYNC : MS_ASYNC) | MS_INVALIDATE);
+}
+
+
+/** \brief Write all the modified pages to disk.
+ *
+ * This function synchronously writes all the segments of this file
+ * and then calls fdatasync() so the size of the file is also saved.
+ *
+ * This is used when checkpointing the commit log: once this function
+ * returns, the commit log can safely be truncated.
+ */
+void dbfile::flush()
+{
+    if(f_fd == -1)
+    {
+        return;
+    }
+
+    size_t const file_size(get_size());
+    for(auto const & s : f_segments)
+    {
+        if(s.f_data == nullptr
+        || s.f_offset >= file_size)
+        {
+            continue;
+        }
+
+        size_t const size(std::min(f_segment_size, file_size - s.f_offset));
+        if(msync(s.f_data, size, MS_SYNC) != 0)
+        {
+            int const e(errno);
+            throw io_error(
+                  "msync() failed on \""
+                + f_fullname
+                + "\" (errno: "
+                + std::to_string(e)
+                + ", "
+                + strerror(e)
+                + ").");
+        }
+    }
+
+    if(fdatasync(f_fd) != 0)
+    {
+        int const e(errno);
+        throw io_error(
+              "fdatasync() failed on \""
+            + f_fullname
+            + "\" (errno: "
+            + std::to_string(e)
+            + ", "
+            + strerror(e)
+            + ").");
+    }
+}
+
+
+/** \brief Attach a commit log to this file.
+ *
+ * Once a commit log is attached, pages which get modified while
+ * journaling is turned on are first saved in that log.
+ *
+ * If the log is not empty, the last run did not end with a checkpoint.
+ * In that case, the page images found in the log are restored so the
+ * file is back to what it was at the time of that last checkpoint.
+ * The rows found in the log have to be committed again by the caller.
+ *
+ * Several files can share the same log. The \p file_id distinguishes
+ * their pages: only the pages saved with the same identifier get
+ * restored in this file. The table file uses 0 and is the owner of
+ * the log (see checkpoint()).
+ *
+ * \note
+ * Pages that were appended after the checkpoint are not part of the
+ * log. They are not referenced by the restored pages so they are
+ * simply lost.
+ *
+ * \param[in] log  The commit log to attach to this file.
+ * \param[in] file_id  The identifier of this file in the log.
+ */
+void dbfile::set_commit_log(commit_log::pointer_t log, std::uint8_t file_id)
+{
+    f_commit_log = log;
+    f_commit_log_file_id = file_id;
+    f_journaling = false;
+    f_journaled_pages.clear();
+    f_journal_size = 0;
+
+    if(f_commit_log == nullptr)
+    {
+        return;
+    }
+
+    open_file();
+    size_t const page_size(get_page_size());
+    size_t const file_size(get_size());
+
+    // the first image of a page is the one saved right after the last
+    // checkpoint so that's the one we want to restore
+    //
+    f_commit_log->replay([&](
+              commit_log_record_t type
+            , std::uint8_t mode
+            , reference_t offset
+            , const_data_t page
+            , std::size_t size)
+        {
+            if(type != commit_log_record_t::COMMIT_LOG_RECORD_PAGE
+            || mode != f_commit_log_file_id)
+            {
+                return;
+            }
+            if(size != page_size
+            || offset % page_size != 0
+            || offset + size > file_size)
+            {
+                SNAP_LOG_WARNING
+                    << "commit log of \""
+                    << f_fullname
+                    << "\" has an invalid page image at offset "
+                    << offset
+                    << "; ignored."
+                    << SNAP_LOG_SEND;
+                return;
+            }
+            if(!f_journaled_pages.insert(offset).second)
+            {
+                return;
+            }
+            memcpy(data(offset), page, size);
+        });
+
+    if(!f_journaled_pages.empty())
+    {
+        SNAP_LOG_WARNING
+            << "restored "
+            << f_journaled_pages.size()
+            << " page"
+            << (f_journaled_pages.size() == 1 ? "" : "s")
+            << " of \""
+            << f_fullname
+            << "\" from its commit log."
+            << SNAP_LOG_SEND;
+
+        flush();
+        f_journaled_pages.clear();
+    }
+
+    f_journal_size = get_size();
+}
+
+
+/** \brief Turn the journaling of modified pages on or off.
+ *
+ * The table turns the journaling on while it commits a row.
+ *
+ * \param[in] journaling  Whether pages get journaled.
+ */
+void dbfile::set_journaling(bool journaling)
+{
+    f_journaling = journaling && f_commit_log != nullptr;
+}
+
+
+/** \brief A page is about to be modified.
+ *
+ * If journaling is turned on and this is the first time the page gets
+ * modified since the last checkpoint, its current content is saved in
+ * the commit log. The log is synchronized before this function returns
+ * so the image is on disk before the page gets modified.
+ *
+ * Pages which did not exist at the time of the last checkpoint are not
+ * journaled since nothing references them from the older pages.
+ *
+ * \param[in] offset  An offset within the page being modified.
+ */
+void dbfile::journal_page(reference_t offset)
+{
+    if(!f_journaling)
+    {
+        return;
+    }
 
-    reference_t const page_offset(offset % sz);
-    reference_t const page_start(offset - page_offset);
+    reference_t const page(offset - offset % f_page_size);
+    if(page >= f_journal_size)
+    {
+        return;
+    }
 
-    auto it(f_pages.left.find(page_start));
-    if(it != f_pages.left.end())
+    if(!f_journaled_pages.insert(page).second)
     {
-        return it->second;
+        return;
     }
 
-static int count(0);
-++count;
-std::cerr << ">>> data() calling mmap() for the " << count << " times\n";
+    f_commit_log->append_page(page, data(page), f_page_size, f_commit_log_file_id);
+}
+
+
+/** \brief Flush the file and empty the commit log.
+ *
+ * After a checkpoint, the file on disk is up to date and the commit
+ * log is not necessary anymore.
+ *
+ * When the log is shared, only its owner (the file attached with
+ * identifier 0) truncates it. The other files must be checkpointed
+ * first so their pages are on disk before their images get lost.
+ */
+void dbfile::checkpoint()
+{
+    flush();
+
+    if(f_commit_log != nullptr
+    && f_commit_log_file_id == 0)
+    {
+        f_commit_log->truncate();
+    }
+
+    f_journaled_pages.clear();
+    f_journal_size = f_fd == -1 ? 0 : get_size();
+}
+
+
+dbfile::segment_t const & dbfile::map_segment(size_t index)
+{
+    if(index < f_segments.size()
+    && f_segments[index].f_data != nullptr)
+    {
+        return f_segments[index];
+    }
+
+    size_t const segment_size(get_segment_size());
+    reference_t const segment_offset(index * segment_size);
 
     data_t ptr(reinterpret_cast<data_t>(mmap(
           nullptr
-        , sz
+        , segment_size
         , PROT_READ | PROT_WRITE
         , MAP_SHARED
-        , fd
-        , page_start)));
+        , f_fd
+        , segment_offset)));
 
-    if(ptr == nullptr)
+    if(ptr == MAP_FAILED)
     {
+        int const e(errno);
         throw io_error(
                   "mmap() failed on \""
                 + f_filename
                 + "\" at offset "
-                + std::to_string(offset)
-                + ".");
+                + std::to_string(segment_offset)
+                + " (errno: "
+                + std::to_string(e)
+                + ", "
+                + strerror(e)
+                + ").");
     }
 
-    f_pages.insert(page_bimap_t::value_type(page_start, ptr));
+    advise(ptr, segment_size, f_access_pattern);
 
-    return ptr + page_offset;
+    if(index >= f_segments.size())
+    {
+        f_segments.resize(index + 1);
+    }
+    f_segments[index].f_offset = segment_offset;
+    f_segments[index].f_data = ptr;
+    f_segment_by_pointer[ptr] = index;
+
+    return f_segments[index];
 }
 
 
-void dbfile::release_data(data_t data)
+dbfile::segment_t const & dbfile::find_segment(data_t data) const
 {
-    size_t const sz(get_page_size());
-
-    intptr_t const data_ptr(reinterpret_cast<intptr_t>(data));
-    intptr_t const page_ptr(data_ptr - data_ptr % sz);
-    auto it(f_pages.right.find(reinterpret_cast<data_t>(page_ptr)));
-    if(it == f_pages.right.end())
+    // find the first segment which starts after data, the previous
+    // one is the only one which may include data
+    //
+    auto it(f_segment_by_pointer.upper_bound(data));
+    if(it != f_segment_by_pointer.begin())
     {
-        throw page_not_found(
-                  "page "
-                + std::to_string(page_ptr)
-                + " not found. It cannot be unmapped.");
+        --it;
+        segment_t const & s(f_segments[it->second]);
+        if(data < s.f_data + f_segment_size)
+        {
+            return s;
+        }
     }
-    f_pages.right.erase(it);
 
-    munmap(reinterpret_cast<data_t>(page_ptr), sz);
+    throw page_not_found(
+              "page "
+            + std::to_string(reinterpret_cast<intptr_t>(data))
+            + " not found in any of the mapped segments.");
 }
 
 
-void dbfile::sync(data_t data, bool immediate)
+void dbfile::advise(data_t data, size_t size, access_pattern_t pattern)
 {
-    size_t const sz(get_page_size());
+    int advice(MADV_NORMAL);
+    switch(pattern)
+    {
+    case access_pattern_t::ACCESS_PATTERN_NORMAL:
+        break;
 
-    intptr_t const data_ptr(reinterpret_cast<intptr_t>(data));
-    intptr_t const page_ptr(data_ptr - data_ptr % sz);
+    case access_pattern_t::ACCESS_PATTERN_RANDOM:
+        advice = MADV_RANDOM;
+        break;
 
-    msync(reinterpret_cast<data_t>(page_ptr)
-        , sz
-        , (immediate ? MS_SYNC : MS_ASYNC) | MS_INVALIDATE);
+    case access_pattern_t::ACCESS_PATTERN_SEQUENTIAL:
+        advice = MADV_SEQUENTIAL;
+        break;
+
+    }
+
+    // this is just a hint, a failure is not fatal
+    //
+    if(madvise(data, size, advice) != 0)
+    {
+        SNAP_LOG_DEBUG
+            << "madvise() failed on \""
+            << f_filename
+            << "\"."
+            << SNAP_LOG_SEND;
+    }
+}
+
+
+void dbfile::unmap_segments()
+{
+    for(auto & s : f_segments)
+    {
+        if(s.f_data != nullptr)
+        {
+            munmap(s.f_data, f_segment_size);
+            s.f_data = nullptr;
+        }
+    }
+    f_segments.clear();
+    f_segment_by_pointer.clear();
 }
 
 
@@ -433,7 +900,7 @@ reference_t dbfile::append_free_block(reference_t const previous_block_offset)
     {
         // make sure to write the rest too so for sure it's not sparse
         //
-        std::vector<uint8_t> zeroes(get_page_size() - sizeof(magic) - sizeof(previous_block_offset));
+        std::vector<uint8_t> zeroes(get_page_size() - sizeof(magic) - sizeof(v) - sizeof(previous_block_offset));
         write_data(zeroes.data(), zeroes.size());
     }
     else
@@ -460,6 +927,141 @@ reference_t dbfile::append_free_block(reference_t const previous_block_offset)
 }
 
 
+/** \brief Make sure the file is at least \p size bytes.
+ *
+ * This function is used by files which are not composed of a list of
+ * free blocks (i.e. the bloom filter). The new space is filled with
+ * zeroes. If the file is already that large or larger, nothing happens.
+ *
+ * \exception io_error
+ * On an error, the function raises this exception.
+ *
+ * \param[in] size  The minimum size of the file.
+ */
+void dbfile::grow(size_t size)
+{
+    open_file();
+
+    if(get_size() >= size)
+    {
+        return;
+    }
+
+    if(ftruncate(f_fd, size) != 0)
+    {
+        int const e(errno);
+        throw io_error(
+              "System could not grow file \""
+            + f_filename
+            + "\" to "
+            + std::to_string(size)
+            + " bytes (errno: "
+            + std::to_string(e)
+            + ", "
+            + strerror(e)
+            + ").");
+    }
+}
+
+
+/** \brief Shrink the file to \p size bytes.
+ *
+ * This function is used by the compaction process to return the `FREE`
+ * blocks found at the end of the file to the file system. The caller is
+ * responsible for making sure that none of the blocks past \p size are
+ * still in use.
+ *
+ * The segments remain mapped. Accessing a page past the end of the file
+ * would generate a SIGBUS until the file grows again.
+ *
+ * \exception io_error
+ * On an error, the function raises this exception.
+ *
+ * \param[in] size  The new size of the file.
+ */
+void dbfile::truncate(size_t size)
+{
+    open_file();
+
+    if(size % get_page_size() != 0)
+    {
+        throw snapdatabase_logic_error(
+              "truncate() called with a size ("
+            + std::to_string(size)
+            + ") which is not a multiple of the page size.");
+    }
+
+    if(get_size() <= size)
+    {
+        return;
+    }
+
+    if(ftruncate(f_fd, size) != 0)
+    {
+        int const e(errno);
+        throw io_error(
+              "System could not truncate file \""
+            + f_filename
+            + "\" to "
+            + std::to_string(size)
+            + " bytes (errno: "
+            + std::to_string(e)
+            + ", "
+            + strerror(e)
+            + ").");
+    }
+
+    f_journaled_pages.erase(f_journaled_pages.lower_bound(size), f_journaled_pages.end());
+    f_journal_size = std::min(f_journal_size, size);
+}
+
+
+/** \brief Release the disk space used by part of a page.
+ *
+ * For sparse files, this function lets the file system know that the
+ * specified area is not used anymore (it reads as zeroes). The size
+ * of the file does not change.
+ *
+ * If the file system does not support punching holes, the function
+ * silently ignores the request.
+ *
+ * \exception io_error
+ * On an error other than "not supported", the function raises this
+ * exception.
+ *
+ * \param[in] offset  The start of the area to release.
+ * \param[in] size  The number of bytes to release.
+ */
+void dbfile::punch_hole(reference_t offset, size_t size)
+{
+    open_file();
+
+    if(fallocate(f_fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, size) != 0)
+    {
+        int const e(errno);
+        if(e == EOPNOTSUPP)
+        {
+            SNAP_LOG_DEBUG
+                << "fallocate() cannot punch holes in \""
+                << f_filename
+                << "\"."
+                << SNAP_LOG_SEND;
+            return;
+        }
+        throw io_error(
+              "System could not punch a hole in file \""
+            + f_filename
+            + "\" at "
+            + std::to_string(offset)
+            + " (errno: "
+            + std::to_string(e)
+            + ", "
+            + strerror(e)
+            + ").");
+    }
+}
+
+
 /** \brief Grow the file.
  *
  * We use this function to grow the file with a full page of data.
@@ -506,6 +1108,9 @@ std::string to_string(dbtype_t type)
     case dbtype_t::FILE_TYPE_BLOOM_FILTER:
         return std::string("Bloom Filter File (BLMF)");
 
+    case dbtype_t::FILE_TYPE_COMMIT_LOG:
+        return std::string("Commit Log File (CLOG)");
+
     case dbtype_t::BLOCK_TYPE_BLOB:
         return std::string("Blob Block (BLOB)");
 
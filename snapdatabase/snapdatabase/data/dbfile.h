@@ -24,6 +24,11 @@
  *
  * The block base class handles the loading of the block in memory using
  * mmap() and gives information such as its type and location.
+ *
+ * The dbfile does not map one page at a time. Instead it maps large
+ * segments of the file (64Mb by default) and returns pointers within
+ * those segments. This way a table with millions of blocks still only
+ * uses a few VMAs and finding the pointer of a block is O(1).
  */
 
 // snapdatabase lib
@@ -36,9 +41,11 @@
 #include    <snapdev/lockfile.h>
 
 
-// boost lib
+// C++ lib
 //
-#include    <boost/bimap.hpp>
+#include    <map>
+#include    <set>
+#include    <vector>
 
 
 
@@ -59,17 +66,28 @@ constexpr oid_t                     NULL_OID = static_cast<oid_t>(0);
 class table;
 typedef std::shared_ptr<table>      table_pointer_t;
 
+class commit_log;
+typedef std::shared_ptr<commit_log> commit_log_pointer_t;
+
 
 static_assert(sizeof(reference_t) == sizeof(oid_t), "the OID and references must fit in each other's variables");
 
 
+enum class access_pattern_t
+{
+    ACCESS_PATTERN_NORMAL,
+    ACCESS_PATTERN_RANDOM,
+    ACCESS_PATTERN_SEQUENTIAL
+};
+
+
 class dbfile
     : public std::enable_shared_from_this<dbfile>
 {
 public:
     typedef std::shared_ptr<dbfile>             pointer_t;
-    //typedef std::map<reference_t, data_t>   page_map_t;
-    typedef boost::bimap<reference_t, data_t>  page_bimap_t;
+
+    static constexpr size_t DEFAULT_SEGMENT_SIZE = 64 * 1024 * 1024;
 
                             dbfile(std::string const & path, std::string const & table_name, std::string const & filename);
                             dbfile(dbfile const & rhs) = delete;
@@ -78,6 +96,7 @@ public:
     dbfile &                operator = (dbfile const & rhs) = delete;
 
     std::string             get_fullname() const;
+    std::string             get_dirname() const;
     void                    set_table(table_pointer_t t);
     table_pointer_t         get_table() const;
     void                    close();
@@ -88,15 +107,41 @@ public:
     bool                    get_sparse() const;
     void                    set_type(dbtype_t type);
     dbtype_t                get_type() const;
+    size_t                  get_segment_size() const;
+    void                    set_access_pattern(access_pattern_t pattern);
+    access_pattern_t        get_access_pattern() const;
+    void                    prefetch(reference_t offset, size_t size);
     data_t                  data(reference_t offset);
     void                    release_data(data_t data);
+    void                    release_page(reference_t offset);
     void                    sync(data_t data, bool immediate);
+    void                    flush();
+    void                    set_commit_log(commit_log_pointer_t log, std::uint8_t file_id = 0);
+    void                    set_journaling(bool journaling);
+    void                    journal_page(reference_t offset);
+    void                    checkpoint();
     size_t                  get_size() const;
     reference_t             append_free_block(reference_t const previous_block_offset);
+    void                    grow(size_t size);
+    void                    truncate(size_t size);
+    void                    punch_hole(reference_t offset, size_t size);
 
 private:
+    struct segment_t
+    {
+        reference_t         f_offset = NULL_FILE_ADDR;
+        data_t              f_data = nullptr;
+    };
+
+    typedef std::vector<segment_t>          segment_vector_t;
+    typedef std::map<data_t, size_t>        segment_by_pointer_t;
+
     int                     open_file();
     void                    write_data(void const * ptr, size_t size);
+    segment_t const &       map_segment(size_t index);
+    segment_t const &       find_segment(data_t data) const;
+    void                    advise(data_t data, size_t size, access_pattern_t pattern);
+    void                    unmap_segments();
 
     table_pointer_t         f_table = table_pointer_t();
     std::string             f_path = std::string();
@@ -106,11 +151,19 @@ private:
     std::string             f_fullname = std::string();
     std::string             f_lock_filename = std::string();
     size_t                  f_page_size = 0;
+    size_t                  f_segment_size = 0;
     dbtype_t                f_type = dbtype_t::DBTYPE_UNKNOWN;
     pid_t                   f_pid = -1;
     int                     f_fd = -1;
-    page_bimap_t            f_pages = page_bimap_t();
+    segment_vector_t        f_segments = segment_vector_t();
+    segment_by_pointer_t    f_segment_by_pointer = segment_by_pointer_t();
+    access_pattern_t        f_access_pattern = access_pattern_t::ACCESS_PATTERN_RANDOM;
     bool                    f_sparse_file = false;
+    commit_log_pointer_t    f_commit_log = commit_log_pointer_t();
+    std::uint8_t            f_commit_log_file_id = 0;
+    bool                    f_journaling = false;
+    size_t                  f_journal_size = 0;
+    std::set<reference_t>   f_journaled_pages = std::set<reference_t>();
 };
 
 
@@ -49,6 +49,7 @@ enum class dbtype_t : std::uint32_t
     FILE_TYPE_SNAP_DATABASE_TABLE   = DBTYPE_NAME("SDBT"),      // Snap! Database Table
     FILE_TYPE_EXTERNAL_INDEX        = DBTYPE_NAME("INDX"),      // External Index
     FILE_TYPE_BLOOM_FILTER          = DBTYPE_NAME("BLMF"),      // Bloom Filter
+    FILE_TYPE_COMMIT_LOG            = DBTYPE_NAME("CLOG"),      // Commit Log (WAL)
 
     BLOCK_TYPE_BLOB                 = DBTYPE_NAME("BLOB"),
     BLOCK_TYPE_DATA                 = DBTYPE_NAME("DATA"),
@@ -107,7 +107,7 @@ struct_description_t g_column_description[] =
         , FieldType(struct_type_t::STRUCT_TYPE_UINT16)
     ),
     define_description(
-          FieldName("flags=limited/required/blob/system/revision_type:2")
+          FieldName("flags=limited/required/blob/system/revision_type:2/compression:2")
         , FieldType(struct_type_t::STRUCT_TYPE_BITS32)
     ),
     define_description(
@@ -311,6 +311,13 @@ index_type_t index_name_to_index_type(std::string const & name)
         }
         break;
 
+    case 'j':
+        if(name == "journal")
+        {
+            return index_type_t::INDEX_TYPE_JOURNAL;
+        }
+        break;
+
     case 'p':
         if(name == "primary")
         {
@@ -341,6 +348,7 @@ std::string index_type_to_index_name(index_type_t type)
     case index_type_t::INDEX_TYPE_PRIMARY:    return "primary";
     case index_type_t::INDEX_TYPE_EXPIRATION: return "expiration";
     case index_type_t::INDEX_TYPE_TREE:       return "tree";
+    case index_type_t::INDEX_TYPE_JOURNAL:    return "journal";
     case index_type_t::INDEX_TYPE_INVALID:    break;
     case index_type_t::INDEX_TYPE_SECONDARY:  break;
     }
@@ -365,6 +373,7 @@ model_and_name_t g_model_and_name[] =
     MODEL_AND_NAME(CONTENT),
     MODEL_AND_NAME(DATA),
     MODEL_AND_NAME(DEFAULT),
+    MODEL_AND_NAME(JOURNAL),
     MODEL_AND_NAME(LOG),
     MODEL_AND_NAME(QUEUE),
     MODEL_AND_NAME(SEQUENCIAL),
@@ -411,11 +420,11 @@ model_t name_to_model(std::string const & name)
         int const r(uc.compare(g_model_and_name[p].f_name));
         if(r < 0)
         {
-            i = p + 1;
+            j = p;
         }
         else if(r > 0)
         {
-            j = p;
+            i = p + 1;
         }
         else
         {
@@ -634,6 +643,28 @@ schema_column::schema_column(schema_table::pointer_t table, xml_node::pointer_t
         f_flags |= COLUMN_FLAG_BLOB;
     }
 
+    compression_t const compression(name_to_compression(x->attribute("compress")));
+    if(compression != compression_t::COMPRESSION_NONE)
+    {
+        switch(f_type)
+        {
+        case struct_type_t::STRUCT_TYPE_P8STRING:
+        case struct_type_t::STRUCT_TYPE_P16STRING:
+        case struct_type_t::STRUCT_TYPE_P32STRING:
+            break;
+
+        default:
+            throw invalid_xml(
+                      "column \""
+                    + f_name
+                    + "\" can't be compressed, only string columns support the compress=\"...\" attribute ("
+                    + to_string(f_type)
+                    + " is not valid).");
+
+        }
+        f_flags |= static_cast<flag32_t>(compression) << COLUMN_FLAG_COMPRESSION_SHIFT;
+    }
+
     f_encrypt_key_name = x->attribute("encrypt");
 
     for(auto child(x->first_child()); child != nullptr; child = child->next())
@@ -868,6 +899,19 @@ std::string schema_column::encrypt_key_name() const
 }
 
 
+/** \brief Get the compression used on this column.
+ *
+ * String columns can be compressed using the `compress="lz4|zstd"`
+ * attribute. The compression is saved in the column flags.
+ *
+ * \return The compression of this column.
+ */
+compression_t schema_column::compression() const
+{
+    return static_cast<compression_t>((f_flags & COLUMN_FLAG_COMPRESSION) >> COLUMN_FLAG_COMPRESSION_SHIFT);
+}
+
+
 buffer_t schema_column::default_value() const
 {
     return f_default_value;
@@ -1433,6 +1477,10 @@ void schema_table::from_xml(xml_node::pointer_t x)
             //            + ".");
             //}
         }
+        else if(child->tag_name() == "expected-rows")
+        {
+            f_expected_rows = convert_to_uint(child->text(), 64);
+        }
         else if(child->tag_name() == "description")
         {
             if(!f_description.empty())
@@ -1725,6 +1773,40 @@ void schema_table::from_xml(xml_node::pointer_t x)
     // the precision and what the value should be (it's just like a standard
     // column) -- see is_expiration_date_column()
 
+    // journal columns -- the JOURNAL model manages the processing of
+    // each row (see doc/JOURNAL.md); the priority and process date are
+    // set by the client, the other columns are managed by the table
+    //
+    // the rows are sorted by priority and process date in a system
+    // index, see table_impl::get_journal_index()
+    //
+    if(f_model == model_t::TABLE_MODEL_JOURNAL)
+    {
+        struct journal_column_t
+        {
+            char const *    f_name = nullptr;
+            struct_type_t   f_type = struct_type_t::STRUCT_TYPE_VOID;
+        };
+        journal_column_t const journal_columns[] =
+        {
+            { g_journal_priority_column,              struct_type_t::STRUCT_TYPE_UINT8  },
+            { g_journal_process_date_column,          struct_type_t::STRUCT_TYPE_MSTIME },
+            { g_journal_status_column,                struct_type_t::STRUCT_TYPE_UINT8  },
+            { g_journal_start_processing_date_column, struct_type_t::STRUCT_TYPE_MSTIME },
+            { g_journal_timeout_counter_column,       struct_type_t::STRUCT_TYPE_UINT8  },
+        };
+        for(auto const & jc : journal_columns)
+        {
+            auto c(std::make_shared<schema_column>(
+                          shared_from_this()
+                        , jc.f_name
+                        , jc.f_type
+                        , COLUMN_FLAG_REQUIRED | COLUMN_FLAG_SYSTEM));
+
+            f_columns_by_name[c->name()] = c;
+        }
+    }
+
     // 3. parse user columns
     //
 
@@ -2393,6 +2475,12 @@ schema_secondary_index::pointer_t schema_table::secondary_index(std::string cons
 }
 
 
+schema_secondary_index::map_t const & schema_table::secondary_indexes() const
+{
+    return f_secondary_indexes;
+}
+
+
 schema_complex_type::pointer_t schema_table::complex_type(std::string const & name) const
 {
     auto const & it(f_complex_types->find(name));
@@ -2417,6 +2505,12 @@ std::uint32_t schema_table::block_size() const
 }
 
 
+std::uint64_t schema_table::expected_rows() const
+{
+    return f_expected_rows;
+}
+
+
 void schema_table::schema_offset(reference_t offset)
 {
     f_schema_offset = offset;
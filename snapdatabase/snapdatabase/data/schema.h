@@ -30,6 +30,7 @@
 
 // self
 //
+#include    "snapdatabase/data/compression.h"
 #include    "snapdatabase/data/structure.h"
 #include    "snapdatabase/data/xml.h"
 
@@ -55,6 +56,15 @@ typedef std::vector<column_id_t>        column_ids_t;
 std::string const &                     expiration_date_column_name();
 
 
+// system columns added to the tables using the JOURNAL model
+//
+constexpr char const *                  g_journal_priority_column               = "_priority";
+constexpr char const *                  g_journal_process_date_column           = "_process_date";
+constexpr char const *                  g_journal_status_column                 = "_status";
+constexpr char const *                  g_journal_start_processing_date_column  = "_start_processing_date";
+constexpr char const *                  g_journal_timeout_counter_column        = "_timeout_counter";
+
+
 
 enum class model_t
 {
@@ -65,6 +75,7 @@ enum class model_t
     TABLE_MODEL_SEQUENCIAL,
     TABLE_MODEL_SESSION,
     TABLE_MODEL_TREE,
+    TABLE_MODEL_JOURNAL,
 
     TABLE_MODEL_DEFAULT = TABLE_MODEL_CONTENT
 };
@@ -102,6 +113,9 @@ constexpr flag32_t                          COLUMN_FLAG_REQUIRED
 constexpr flag32_t                          COLUMN_FLAG_BLOB                    = (1ULL << 2);
 constexpr flag32_t                          COLUMN_FLAG_SYSTEM                  = (1ULL << 3);
 constexpr flag32_t                          COLUMN_FLAG_REVISION_TYPE           = (3ULL << 4);   // TWO BITS (see COLUMN_REVISION_TYPE_...)
+constexpr flag32_t                          COLUMN_FLAG_COMPRESSION             = (3ULL << 6);   // TWO BITS (see compression_t)
+
+constexpr int                               COLUMN_FLAG_COMPRESSION_SHIFT       = 6;
 
 // Revision Types (after the shift, TBD: should we keep the shift?)
 constexpr flag32_t                          COLUMN_REVISION_TYPE_GLOBAL         = 0;
@@ -129,7 +143,8 @@ enum index_type_t
     INDEX_TYPE_INDIRECT,                    // indirect index, based on OID
     INDEX_TYPE_PRIMARY,                     // primary index, using primary key
     INDEX_TYPE_EXPIRATION,                  // expiration index (TBD)
-    INDEX_TYPE_TREE                         // tree index, based on a path
+    INDEX_TYPE_TREE,                        // tree index, based on a path
+    INDEX_TYPE_JOURNAL                      // journal index, priority and process date
 };
 
 index_type_t                                index_name_to_index_type(std::string const & name);
@@ -201,6 +216,7 @@ public:
     struct_type_t                           type() const;
     flag32_t                                flags() const;
     std::string                             encrypt_key_name() const;
+    compression_t                           compression() const;
     buffer_t                                default_value() const;
     buffer_t                                minimum_value() const;
     buffer_t                                maximum_value() const;
@@ -339,10 +355,12 @@ public:
     schema_column::map_by_id_t              columns_by_id() const;
     schema_column::map_by_name_t            columns_by_name() const;
     schema_secondary_index::pointer_t       secondary_index(std::string const & name) const;
+    schema_secondary_index::map_t const &   secondary_indexes() const;
     schema_complex_type::pointer_t          complex_type(std::string const & name) const;
 
     std::string                             description() const;
     std::uint32_t                           block_size() const;
+    std::uint64_t                           expected_rows() const;
 
     void                                    schema_offset(reference_t offset);
     reference_t                             schema_offset() const;
@@ -367,6 +385,7 @@ private:
     // not saved in database, only in XML
     //
     std::string                             f_description = std::string();
+    std::uint64_t                           f_expected_rows = 0;
 
     // only memory parameters
     //
@@ -706,6 +706,18 @@ void structure::set_block(block::pointer_t b, std::uint64_t offset, std::uint64_
 }
 
 
+/** \brief Detach this structure from its block.
+ *
+ * The buffer of a block structure holds a pointer back to that block.
+ * The block cache calls this function when it evicts a block, otherwise
+ * that loop would keep the block in memory.
+ */
+void structure::release_block()
+{
+    f_buffer.reset();
+}
+
+
 void structure::init_buffer()
 {
     f_buffer = std::make_shared<virtual_buffer>();
@@ -969,7 +981,7 @@ flag_definition::pointer_t structure::get_flag(std::string const & flag_name, fi
                 + "\" must at least include a field name and a flag name.");
     }
 
-    std::string const field_name(s, e - s);
+    std::string const field_name(s, e - s - 1);
     f = get_field(field_name);
 
     // bit fields have sub-names we can check for `field_name`
@@ -1414,10 +1426,14 @@ void structure::set_bits(std::string const & flag_name, uint64_t value)
     // some day we may want to optimize better, but this is the easiest
     // right now
     //
-    uint64_t v(get_uinteger(f->field_name()));
+    // f->field_name() includes the flag definitions, use the name
+    // we were given minus the flag name
+    //
+    std::string const field_name(flag_name.substr(0, flag_name.rfind('.')));
+    uint64_t v(get_uinteger(field_name));
     v &= ~flag->mask();
     v |= value << flag->pos();
-    set_uinteger(f->field_name(), v);
+    set_uinteger(field_name, v);
 }
 
 
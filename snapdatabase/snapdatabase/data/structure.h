@@ -51,6 +51,11 @@
 #include    <map>
 
 
+// C lib
+//
+#include    <string.h>
+
+
 
 namespace snapdatabase
 {
@@ -540,6 +545,234 @@ constexpr struct_description_t end_descriptions()
 
 
 
+
+/** \brief Size of a fixed size type.
+ *
+ * This is the compile time equivalent of the sizes used by the structure
+ * parser. Types without a fixed size return VARIABLE_SIZE. The
+ * STRUCT_TYPE_STRUCTURE size depends on its sub-description, see
+ * static_structure_size().
+ *
+ * \param[in] type  The type of the field.
+ *
+ * \return The size of the type in bytes or VARIABLE_SIZE.
+ */
+constexpr ssize_t static_type_size(struct_type_t type)
+{
+    switch(type)
+    {
+    case struct_type_t::STRUCT_TYPE_VOID:
+        return 0;
+
+    case struct_type_t::STRUCT_TYPE_BITS8:
+    case struct_type_t::STRUCT_TYPE_INT8:
+    case struct_type_t::STRUCT_TYPE_UINT8:
+        return 1;
+
+    case struct_type_t::STRUCT_TYPE_BITS16:
+    case struct_type_t::STRUCT_TYPE_INT16:
+    case struct_type_t::STRUCT_TYPE_UINT16:
+        return 2;
+
+    case struct_type_t::STRUCT_TYPE_BITS32:
+    case struct_type_t::STRUCT_TYPE_INT32:
+    case struct_type_t::STRUCT_TYPE_UINT32:
+    case struct_type_t::STRUCT_TYPE_FLOAT32:
+    case struct_type_t::STRUCT_TYPE_VERSION:
+        return 4;
+
+    case struct_type_t::STRUCT_TYPE_BITS64:
+    case struct_type_t::STRUCT_TYPE_INT64:
+    case struct_type_t::STRUCT_TYPE_UINT64:
+    case struct_type_t::STRUCT_TYPE_FLOAT64:
+    case struct_type_t::STRUCT_TYPE_REFERENCE:
+    case struct_type_t::STRUCT_TYPE_OID:
+    case struct_type_t::STRUCT_TYPE_TIME:
+    case struct_type_t::STRUCT_TYPE_MSTIME:
+    case struct_type_t::STRUCT_TYPE_USTIME:
+        return 8;
+
+    case struct_type_t::STRUCT_TYPE_BITS128:
+    case struct_type_t::STRUCT_TYPE_INT128:
+    case struct_type_t::STRUCT_TYPE_UINT128:
+    case struct_type_t::STRUCT_TYPE_FLOAT128:
+        return 16;
+
+    case struct_type_t::STRUCT_TYPE_BITS256:
+    case struct_type_t::STRUCT_TYPE_INT256:
+    case struct_type_t::STRUCT_TYPE_UINT256:
+        return 32;
+
+    case struct_type_t::STRUCT_TYPE_BITS512:
+    case struct_type_t::STRUCT_TYPE_INT512:
+    case struct_type_t::STRUCT_TYPE_UINT512:
+        return 64;
+
+    default:
+        return VARIABLE_SIZE;
+
+    }
+}
+
+
+/** \brief Compare a description field name at compile time.
+ *
+ * The bits fields have their flag definitions appended after an equal
+ * sign (i.e. "flags=algorithm:4/renewing"). Only the part before the
+ * equal sign is the name of the field.
+ *
+ * \param[in] field_name  The name as defined in the description.
+ * \param[in] name  The name we are looking for.
+ *
+ * \return true if both names are equal.
+ */
+constexpr bool static_field_name_equal(char const * field_name, char const * name)
+{
+    for(; *name != '\0'; ++field_name, ++name)
+    {
+        if(*field_name != *name)
+        {
+            return false;
+        }
+    }
+    return *field_name == '\0' || *field_name == '=';
+}
+
+
+/** \brief Compute the size of a structure at compile time.
+ *
+ * All the fields of the description must have a fixed size.
+ *
+ * \exception invalid_size
+ * A field with a variable size was found. When evaluated at compile
+ * time, this is a compile time error.
+ *
+ * \param[in] descriptions  The description of the structure.
+ *
+ * \return The size of the structure in bytes.
+ */
+constexpr std::uint64_t static_structure_size(struct_description_t const * descriptions)
+{
+    std::uint64_t size(0);
+    for(; descriptions->f_type != struct_type_t::STRUCT_TYPE_END; ++descriptions)
+    {
+        if(descriptions->f_type == struct_type_t::STRUCT_TYPE_STRUCTURE)
+        {
+            size += static_structure_size(descriptions->f_sub_description);
+            continue;
+        }
+        ssize_t const field_size(static_type_size(descriptions->f_type));
+        if(field_size < 0)
+        {
+            throw invalid_size(
+                      std::string("Field \"")
+                    + descriptions->f_field_name
+                    + "\" does not have a fixed size.");
+        }
+        size += field_size;
+    }
+    return size;
+}
+
+
+/** \brief Offset and type of a field computed at compile time.
+ *
+ * The structure class finds fields by name which means a map lookup
+ * and some string parsing on each access. The blocks use this object
+ * instead to access the fields of their headers directly: the offset
+ * gets computed from the description at compile time by
+ * define_static_field() and the accessors are a simple memcpy().
+ *
+ * \tparam T  The C++ type of the field (i.e. std::uint32_t).
+ */
+template<typename T>
+struct static_field_t
+{
+    typedef T                               value_t;
+
+    T get(const_data_t data) const
+    {
+        T value;
+        memcpy(&value, data + f_offset, sizeof(value));
+        return value;
+    }
+
+    void set(data_t data, T value) const
+    {
+        memcpy(data + f_offset, &value, sizeof(value));
+    }
+
+    std::uint64_t const                     f_offset = 0;
+};
+
+
+/** \brief Define a static field from its description.
+ *
+ * Only the fields found before any variable size field can be defined
+ * this way. The size of the field type must match the size of \p T.
+ *
+ * Use this function to define a constexpr so any error is caught at
+ * compile time:
+ *
+ * \code
+ *     constexpr static_field_t<std::uint32_t> g_count_field(
+ *              define_static_field<std::uint32_t>(g_description, "count"));
+ * \endcode
+ *
+ * \exception field_not_found
+ * The named field is not part of \p descriptions.
+ *
+ * \exception invalid_size
+ * A field with a variable size appears before the named field or the
+ * size of the named field is not sizeof(T).
+ *
+ * \tparam T  The C++ type of the field.
+ * \param[in] descriptions  The description of the structure.
+ * \param[in] field_name  The name of the field.
+ *
+ * \return The static field.
+ */
+template<typename T>
+constexpr static_field_t<T> define_static_field(struct_description_t const * descriptions, char const * field_name)
+{
+    std::uint64_t offset(0);
+    for(; descriptions->f_type != struct_type_t::STRUCT_TYPE_END; ++descriptions)
+    {
+        if(descriptions->f_type == struct_type_t::STRUCT_TYPE_STRUCTURE)
+        {
+            offset += static_structure_size(descriptions->f_sub_description);
+            continue;
+        }
+        ssize_t const field_size(static_type_size(descriptions->f_type));
+        if(static_field_name_equal(descriptions->f_field_name, field_name))
+        {
+            if(field_size != static_cast<ssize_t>(sizeof(T)))
+            {
+                throw invalid_size(
+                          std::string("Field \"")
+                        + field_name
+                        + "\" size does not match the size of its static field.");
+            }
+            return static_field_t<T>{ offset };
+        }
+        if(field_size < 0)
+        {
+            throw invalid_size(
+                      std::string("Field \"")
+                    + field_name
+                    + "\" appears after a variable size field.");
+        }
+        offset += field_size;
+    }
+
+    throw field_not_found(
+              std::string("Field \"")
+            + field_name
+            + "\" not found in this description.");
+}
+
+
+
 struct descriptions_by_version_t
 {
     version_t                       f_version = version_t();
@@ -725,6 +958,7 @@ public:
                                                   block::pointer_t b
                                                 , std::uint64_t offset
                                                 , std::uint64_t size);
+    void                                    release_block();
     void                                    init_buffer();
     void                                    set_virtual_buffer(
                                                   virtual_buffer::pointer_t buffer
@@ -51,19 +51,58 @@ namespace snapdatabase
 
 
 
-virtual_buffer::vbuf_t::vbuf_t()
+virtual_buffer::vbuf_t::vbuf_t(std::uint32_t priority)
+    : f_priority(priority)
 {
 }
 
 
-virtual_buffer::vbuf_t::vbuf_t(block::pointer_t b, std::uint64_t offset, std::uint64_t size)
+virtual_buffer::vbuf_t::vbuf_t(block::pointer_t b, std::uint64_t offset, std::uint64_t size, std::uint32_t priority)
     : f_block(b)
     , f_offset(offset)
     , f_size(size)
+    , f_total_size(size)
+    , f_priority(priority)
 {
 }
 
 
+/** \brief Recalculate the cached values of this extent.
+ *
+ * The total size and count of a node include its own size and the
+ * size of its children. Each time the children or the size of the
+ * extent change, this function must be called.
+ */
+void virtual_buffer::vbuf_t::update()
+{
+    f_total_size = f_size + total_size(f_left) + total_size(f_right);
+    f_count = 1 + count(f_left) + count(f_right);
+}
+
+
+data_t virtual_buffer::vbuf_t::data()
+{
+    if(f_block != nullptr)
+    {
+        return f_block->data() + f_offset;
+    }
+    return f_data.data();
+}
+
+
+const_data_t virtual_buffer::vbuf_t::data() const
+{
+    if(f_block != nullptr)
+    {
+        // use the const version so reading does not journal the page
+        //
+        block const & b(*f_block);
+        return b.data() + f_offset;
+    }
+    return f_data.data();
+}
+
+
 
 virtual_buffer::virtual_buffer()
 {
@@ -76,6 +115,11 @@ virtual_buffer::virtual_buffer(block::pointer_t b, std::uint64_t offset, std::ui
 }
 
 
+virtual_buffer::~virtual_buffer()
+{
+}
+
+
 void virtual_buffer::add_buffer(block::pointer_t b, std::uint64_t offset, std::uint64_t size)
 {
     if(f_modified)
@@ -85,10 +129,7 @@ void virtual_buffer::add_buffer(block::pointer_t b, std::uint64_t offset, std::u
                 " another buffer until you commit this virtual buffer.");
     }
 
-    vbuf_t const append(b, offset, size);
-    f_buffers.push_back(append);
-
-    f_total_size += size;
+    f_root = merge(std::move(f_root), std::make_unique<vbuf_t>(b, offset, size, priority()));
 }
 
 
@@ -100,19 +141,19 @@ bool virtual_buffer::modified() const
 
 std::size_t virtual_buffer::count_buffers() const
 {
-    return f_buffers.size();
+    return count(f_root);
 }
 
 
 std::uint64_t virtual_buffer::size() const
 {
-    return f_total_size;
+    return total_size(f_root);
 }
 
 
 bool virtual_buffer::is_data_available(std::uint64_t offset, std::uint64_t size) const
 {
-    return offset + size <= f_total_size;
+    return offset + size <= total_size(f_root);
 }
 
 
@@ -123,6 +164,7 @@ int virtual_buffer::pread(void * buf, std::uint64_t size, std::uint64_t offset,
         return 0;
     }
 
+    std::uint64_t const total(total_size(f_root));
     if(full
     && !is_data_available(offset, size))
     {
@@ -132,47 +174,20 @@ int virtual_buffer::pread(void * buf, std::uint64_t size, std::uint64_t offset,
                 + " bytes at "
                 + std::to_string(offset)
                 + ", when the buffer is "
-                + std::to_string(f_total_size)
+                + std::to_string(total)
                 + " bytes total (missing: "
-                + std::to_string((offset + size) - f_total_size)
+                + std::to_string((offset + size) - total)
                 + " bytes).");
     }
 
+    std::uint8_t * out(reinterpret_cast<std::uint8_t *>(buf));
     std::uint64_t bytes_read(0);
-    for(auto const & b : f_buffers)
-    {
-        if(offset >= b.f_size)
-        {
-            offset -= b.f_size;
-        }
-        else
+    auto read_extent = [&](vbuf_t const & e, std::uint64_t extent_offset, std::uint64_t sz)
         {
-            auto sz(size);
-            if(sz > b.f_size - offset)
-            {
-                sz = b.f_size - offset;
-            }
-            if(b.f_block != nullptr)
-            {
-                memcpy(buf, b.f_block->data() + b.f_offset + offset, sz);
-            }
-            else
-            {
-                memcpy(buf, b.f_data.data() + offset, sz);
-            }
-            size -= sz;
+            memcpy(out + bytes_read, e.data() + extent_offset, sz);
             bytes_read += sz;
-
-            if(size == 0)
-            {
-                return bytes_read;
-            }
-
-            buf = reinterpret_cast<char *>(buf) + sz;
-
-            offset = 0;
-        }
-    }
+        };
+    visit(static_cast<vbuf_t const *>(f_root.get()), offset, size, read_extent);
 
     return bytes_read;
 }
@@ -185,6 +200,7 @@ int virtual_buffer::pwrite(void const * buf, std::uint64_t size, std::uint64_t o
         return 0;
     }
 
+    std::uint64_t const total(total_size(f_root));
     if(!allow_growth
     && !is_data_available(offset, size))
     {
@@ -194,316 +210,390 @@ int virtual_buffer::pwrite(void const * buf, std::uint64_t size, std::uint64_t o
                 + " bytes at "
                 + std::to_string(offset)
                 + ", when the buffer is "
-                + std::to_string(f_total_size)
+                + std::to_string(total)
                 + " bytes only.");
     }
+    if(offset > total)
+    {
+        throw invalid_size(
+                  "Virtual buffer can't be written at "
+                + std::to_string(offset)
+                + " since it is only "
+                + std::to_string(total)
+                + " bytes (no holes allowed).");
+    }
 
     std::uint8_t const * in(reinterpret_cast<std::uint8_t const *>(buf));
     std::uint64_t bytes_written(0);
 
-    auto check_modified = [&]()
+    // overwrite the existing data
+    //
+    auto write_extent = [&](vbuf_t & e, std::uint64_t extent_offset, std::uint64_t sz)
         {
-            if(!f_modified && bytes_written != 0)
-            {
-                f_modified = true;
-            }
+            memcpy(e.data() + extent_offset, in + bytes_written, sz);
+            bytes_written += sz;
         };
+    visit(f_root.get(), offset, size, write_extent);
 
-    for(auto & b : f_buffers)
+    // append the rest, if any; the last extent is used first if it is
+    // a memory extent which is not yet full
+    //
+    if(bytes_written < size)
     {
-        if(offset >= b.f_size)
+        bytes_written += append_to_last(f_root.get(), in + bytes_written, size - bytes_written);
+        if(bytes_written < size)
         {
-            offset -= b.f_size;
+            f_root = merge(std::move(f_root), new_extent(in + bytes_written, size - bytes_written));
+            bytes_written = size;
         }
-        else
-        {
-            auto sz(size);
-            if(sz > b.f_size - offset)
-            {
-                sz = b.f_size - offset;
-            }
-            if(b.f_block != nullptr)
-            {
-                memcpy(b.f_block->data() + offset, in, sz);
-            }
-            else
-            {
-                memcpy(b.f_data.data() + offset, in, sz);
-            }
-            size -= sz;
-            bytes_written += sz;
+    }
 
-            if(size == 0)
-            {
-                check_modified();
-                return bytes_written;
-            }
+    if(bytes_written != 0)
+    {
+        f_modified = true;
+    }
 
-            in += sz;
+    return bytes_written;
+}
 
-            offset = 0;
-        }
-    }
 
-    // this can happen if the caller calls us with an empty buffer
+int virtual_buffer::pinsert(void const * buf, std::uint64_t size, std::uint64_t offset)
+{
+    // avoid an insert if possible
     //
     if(size == 0)
     {
-        check_modified();
-        return bytes_written;
+        return 0;
     }
 
-    if(!f_buffers.empty()
-    && f_buffers.back().f_block == nullptr)
+    if(offset >= total_size(f_root))
     {
-        std::uint64_t const available(f_buffers.back().f_data.capacity() - f_buffers.back().f_size);
-        if(available > 0)
-        {
-            auto const sz(std::min(available, size));
-            f_buffers.back().f_data.resize(f_buffers.back().f_size + sz);
-            memcpy(f_buffers.back().f_data.data() + f_buffers.back().f_size, in, sz);
-            size -= sz;
-            bytes_written += sz;
-            f_buffers.back().f_size += sz;
-            f_total_size += sz;
+        return pwrite(buf, size, offset, true);
+    }
 
-            if(size == 0)
-            {
-                check_modified();
-                return bytes_written;
-            }
+    std::uint8_t const * in(reinterpret_cast<std::uint8_t const *>(buf));
 
-            in += sz;
-        }
+    // small inserts in a small memory extent happen in place, otherwise
+    // we add a new extent
+    //
+    if(!insert_in_extent(f_root.get(), offset, in, size))
+    {
+        vbuf_t::pointer_t left;
+        vbuf_t::pointer_t right;
+        split(std::move(f_root), offset, left, right);
+        left = merge(std::move(left), new_extent(in, size));
+        f_root = merge(std::move(left), std::move(right));
     }
 
-    // TBD: we may want to allocate multiple buffers of 4Kb instead of
-    //      a buffer large enough for this data? At the same time, we
-    //      can't save exactly 4Kb of data in the blocks anyway...
-    //
-    //      however, we could probably use a form of binary search to
-    //      reduce the number iterations; however, after _many_ insertions
-    //      it is likely that such a search would not be working very well
-    //      and either way we'd need to update offsets though the entire
-    //      list of items
-    //
-    //      on the other hand maybe we could use a larger buffer such
-    //      as 64Kb at once to avoid too many allocations total
-    //      (or use a hint / user settings / stats / ...)
+    f_modified = true;
+    return size;
+}
+
+
+int virtual_buffer::perase(std::uint64_t size, std::uint64_t offset)
+{
+    if(size == 0)
+    {
+        return 0;
+    }
+
+    std::uint64_t const total(total_size(f_root));
+    if(offset >= total)
+    {
+        return 0;
+    }
+
+    // clamp the amount of data we can erase
     //
-    vbuf_t append;
-    append.f_data.reserve((size + 4095) & -4096);
-    append.f_data.resize(size);
-    append.f_size = size;
+    if(size > total - offset)
+    {
+        size = total - offset;
+    }
 
-    memcpy(append.f_data.data(), in, size);
+    vbuf_t::pointer_t left;
+    vbuf_t::pointer_t middle;
+    vbuf_t::pointer_t right;
+    split(std::move(f_root), offset, left, middle);
+    split(std::move(middle), size, middle, right);
+    f_root = merge(std::move(left), std::move(right));
 
-    f_buffers.push_back(append);
+    f_modified = true;
+    return size;
+}
 
-    bytes_written += size;
-    f_total_size += size;
 
-    check_modified();
-    return bytes_written;
+std::uint64_t virtual_buffer::total_size(vbuf_t::pointer_t const & n)
+{
+    return n == nullptr ? 0 : n->f_total_size;
 }
 
 
-int virtual_buffer::pinsert(void const * buf, std::uint64_t size, std::uint64_t offset)
+std::size_t virtual_buffer::count(vbuf_t::pointer_t const & n)
 {
-    // avoid an insert if possible
-    //
-    if(size == 0)
+    return n == nullptr ? 0 : n->f_count;
+}
+
+
+/** \brief Generate the priority of a new extent.
+ *
+ * The treap remains balanced as long as the priorities are random. We
+ * use a simple xorshift generator which is plenty for this purpose and
+ * keeps the shape of the tree reproducible.
+ */
+std::uint32_t virtual_buffer::priority()
+{
+    f_random ^= f_random << 13;
+    f_random ^= f_random >> 17;
+    f_random ^= f_random << 5;
+    return f_random;
+}
+
+
+/** \brief Create a set of memory extents with a copy of \p buf.
+ *
+ * The data is broken up in extents of at most MAXIMUM_EXTENT_SIZE bytes.
+ */
+virtual_buffer::vbuf_t::pointer_t virtual_buffer::new_extent(void const * buf, std::uint64_t size)
+{
+    std::uint8_t const * in(reinterpret_cast<std::uint8_t const *>(buf));
+
+    vbuf_t::pointer_t result;
+    while(size > 0)
     {
-        return 0;
+        std::uint64_t const sz(std::min(size, MAXIMUM_EXTENT_SIZE));
+
+        vbuf_t::pointer_t e(std::make_unique<vbuf_t>(priority()));
+        e->f_data.reserve((sz + 4095) & -4096);
+        e->f_data.insert(e->f_data.end(), in, in + sz);
+        e->f_size = sz;
+        e->f_total_size = sz;
+
+        result = merge(std::move(result), std::move(e));
+
+        in += sz;
+        size -= sz;
     }
 
-    if(offset >= f_total_size)
+    return result;
+}
+
+
+/** \brief Concatenate two trees.
+ *
+ * All the data in \p left appears before the data in \p right in the
+ * resulting tree.
+ */
+virtual_buffer::vbuf_t::pointer_t virtual_buffer::merge(vbuf_t::pointer_t left, vbuf_t::pointer_t right)
+{
+    if(left == nullptr)
     {
-        return pwrite(buf, size, offset, true);
+        return right;
+    }
+    if(right == nullptr)
+    {
+        return left;
     }
 
-    std::uint8_t const * in(reinterpret_cast<std::uint8_t const *>(buf));
+    if(left->f_priority >= right->f_priority)
+    {
+        left->f_right = merge(std::move(left->f_right), std::move(right));
+        left->update();
+        return left;
+    }
 
-    // insert has to happen... search the buffer where it will happen
-    //
-    for(auto b(f_buffers.begin()); b != f_buffers.end(); ++b)
+    right->f_left = merge(std::move(left), std::move(right->f_left));
+    right->update();
+    return right;
+}
+
+
+/** \brief Split a tree at \p offset.
+ *
+ * The first \p offset bytes end up in \p left and the rest in \p right.
+ * If \p offset falls in the middle of an extent, that one extent gets
+ * split in two. A block extent only needs its offset adjusted. A memory
+ * extent gets its tail copied in a new buffer.
+ */
+void virtual_buffer::split(vbuf_t::pointer_t n, std::uint64_t offset, vbuf_t::pointer_t & left, vbuf_t::pointer_t & right)
+{
+    if(n == nullptr)
     {
-        if(offset >= b->f_size)
-        {
-            offset -= b->f_size;
-        }
-        else
-        {
-            if(b->f_block != nullptr)
-            {
-                // if inserting within a block, we have to break the block
-                // in two
-                {
-                    vbuf_t append;
-                    append.f_block = b->f_block;
-                    append.f_size = b->f_size - offset;
-                    append.f_offset = b->f_offset + offset;
-                    f_buffers.insert(b + 1, append);
-                }
+        left.reset();
+        right.reset();
+        return;
+    }
 
-                b->f_size = offset;
+    std::uint64_t const left_size(total_size(n->f_left));
+    if(offset <= left_size)
+    {
+        vbuf_t::pointer_t l;
+        split(std::move(n->f_left), offset, l, n->f_left);
+        n->update();
+        left = std::move(l);
+        right = std::move(n);
+        return;
+    }
 
-                {
-                    vbuf_t append;
-                    append.f_size = size;
-                    memcpy(append.f_data.data(), in, size);
-                    f_buffers.insert(b + 1, append);
-                }
-            }
-            else
-            {
-                b->f_data.insert(b->f_data.begin() + offset, in, in + size);
-                b->f_size += size;
-            }
-            f_total_size += size;
-            f_modified = true;
-            return size;
-        }
+    if(offset >= left_size + n->f_size)
+    {
+        vbuf_t::pointer_t r;
+        split(std::move(n->f_right), offset - left_size - n->f_size, n->f_right, r);
+        n->update();
+        left = std::move(n);
+        right = std::move(r);
+        return;
     }
 
-    if(offset == 0)
+    // the split happens within this extent; the tail gets the same
+    // priority so it can take over the right subtree
+    //
+    std::uint64_t const cut(offset - left_size);
+    vbuf_t::pointer_t tail(std::make_unique<vbuf_t>(n->f_priority));
+    if(n->f_block != nullptr)
     {
-        // append at the end
-        //
-        if(!f_buffers.empty()
-        && f_buffers.back().f_block == nullptr)
-        {
-            f_buffers.back().f_data.insert(f_buffers.back().f_data.end(), in, in + size);
-        }
-        else
-        {
-            vbuf_t append;
-            append.f_size = size;
-            memcpy(append.f_data.data(), in, size);
-            f_buffers.push_back(append);
-        }
-        f_total_size += size;
-        f_modified = true;
-        return size;
+        tail->f_block = n->f_block;
+        tail->f_offset = n->f_offset + cut;
     }
+    else
+    {
+        tail->f_data.assign(n->f_data.begin() + cut, n->f_data.end());
+        n->f_data.resize(cut);
+    }
+    tail->f_size = n->f_size - cut;
+    tail->f_right = std::move(n->f_right);
+    tail->update();
 
-    throw snapdatabase_logic_error(
-              "Reached the end of the pinsert() function. Offset should be 0, it is "
-            + std::to_string(offset)
-            + " instead, which should never happen.");
+    n->f_size = cut;
+    n->update();
+
+    left = std::move(n);
+    right = std::move(tail);
 }
 
 
-int virtual_buffer::perase(std::uint64_t size, std::uint64_t offset)
+/** \brief Append data to the last extent.
+ *
+ * If the last extent is a memory extent which is not yet full, the
+ * data gets appended to it. The cached sizes of the nodes on the path
+ * get updated.
+ *
+ * \return The number of bytes appended.
+ */
+std::uint64_t virtual_buffer::append_to_last(vbuf_t * n, std::uint8_t const * in, std::uint64_t size)
 {
-    if(size == 0)
+    if(n == nullptr)
     {
         return 0;
     }
 
-    if(offset >= f_total_size)
+    std::uint64_t sz(0);
+    if(n->f_right != nullptr)
     {
-        return 0;
+        sz = append_to_last(n->f_right.get(), in, size);
+    }
+    else if(n->f_block == nullptr
+         && n->f_size < MAXIMUM_EXTENT_SIZE)
+    {
+        sz = std::min(MAXIMUM_EXTENT_SIZE - n->f_size, size);
+        n->f_data.insert(n->f_data.end(), in, in + sz);
+        n->f_size += sz;
     }
 
-    // clamp the amount of data we can erase
-    //
-    if(size > f_total_size - offset)
+    if(sz != 0)
     {
-        size = f_total_size - offset;
+        n->update();
     }
 
-    // since we are going to erase/add some buffers (eventually)
-    // we need to use our own iterator
-    //
-    std::uint64_t bytes_erased(0);
-    for(auto it(f_buffers.begin()); it != f_buffers.end() && size > 0; )
+    return sz;
+}
+
+
+/** \brief Insert data in the memory extent found at \p offset.
+ *
+ * If the extent found at \p offset is a memory extent and the data fits
+ * in it, then it gets inserted there and the cached sizes of the nodes
+ * on the path get updated.
+ *
+ * \return true if the data was inserted.
+ */
+bool virtual_buffer::insert_in_extent(vbuf_t * n, std::uint64_t offset, std::uint8_t const * in, std::uint64_t size)
+{
+    if(n == nullptr)
+    {
+        return false;
+    }
+
+    bool inserted(false);
+    std::uint64_t const left_size(total_size(n->f_left));
+    if(offset < left_size)
+    {
+        inserted = insert_in_extent(n->f_left.get(), offset, in, size);
+    }
+    else if(offset - left_size < n->f_size)
+    {
+        if(n->f_block == nullptr
+        && n->f_size + size <= MAXIMUM_EXTENT_SIZE)
+        {
+            n->f_data.insert(n->f_data.begin() + (offset - left_size), in, in + size);
+            n->f_size += size;
+            inserted = true;
+        }
+    }
+    else
+    {
+        inserted = insert_in_extent(n->f_right.get(), offset - left_size - n->f_size, in, size);
+    }
+
+    if(inserted)
+    {
+        n->update();
+    }
+
+    return inserted;
+}
+
+
+/** \brief Call \p f on each extent part found between offset and size.
+ *
+ * Only the branches of the tree which overlap the specified area get
+ * visited so the cost is O(log n) plus the number of extents visited.
+ */
+template<class T, class F>
+void virtual_buffer::visit(T * n, std::uint64_t offset, std::uint64_t size, F & f)
+{
+    if(n == nullptr
+    || size == 0)
+    {
+        return;
+    }
+
+    std::uint64_t const left_size(total_size(n->f_left));
+    if(offset < left_size)
     {
-        auto next(it + 1);
-        if(offset >= it->f_size)
+        std::uint64_t const sz(std::min(size, left_size - offset));
+        visit(static_cast<T *>(n->f_left.get()), offset, sz, f);
+        offset += sz;
+        size -= sz;
+        if(size == 0)
         {
-            offset -= it->f_size;
+            return;
         }
-        else
+    }
+
+    offset -= left_size;
+    if(offset < n->f_size)
+    {
+        std::uint64_t const sz(std::min(size, n->f_size - offset));
+        f(*n, offset, sz);
+        offset += sz;
+        size -= sz;
+        if(size == 0)
         {
-            if(size >= it->f_size)
-            {
-                if(offset == 0)
-                {
-                    // remove this entry entirely
-                    //
-                    size -= it->f_size;
-                    f_total_size -= it->f_size;
-                    bytes_erased += it->f_size;
-                    f_buffers.erase(it);
-                }
-                else
-                {
-                    // remove end of this block
-                    //
-                    std::uint64_t const sz(it->f_size - offset);
-                    it->f_size = offset;
-                    f_total_size -= sz;
-                    size -= sz;
-                    bytes_erased += sz;
-                    offset = 0;
-                }
-            }
-            else
-            {
-                if(offset == 0)
-                {
-                    // remove the start of this block
-                    //
-                    if(it->f_block != nullptr)
-                    {
-                        it->f_offset += size;
-                    }
-                    else
-                    {
-                        it->f_data.erase(it->f_data.begin(), it->f_data.begin() + size);
-                    }
-                    it->f_size -= size;
-                }
-                else
-                {
-                    // remove data from the middle of the block
-                    //
-                    if(it->f_block != nullptr)
-                    {
-                        if(offset + size >= it->f_size)
-                        {
-                            it->f_offset += offset;
-                            it->f_size -= size;
-                        }
-                        else
-                        {
-                            vbuf_t append;
-                            append.f_block = it->f_block;
-                            append.f_size = it->f_size - size - offset;
-                            append.f_offset = it->f_offset + size + offset;
-                            f_buffers.insert(it, append);
-
-                            it->f_size = offset;
-                        }
-                    }
-                    else
-                    {
-                        it->f_data.erase(it->f_data.begin() + offset, it->f_data.begin() + offset + size);
-                        it->f_size -= size;
-                    }
-                }
-                f_total_size -= size;
-                bytes_erased += size;
-                f_modified = bytes_erased != 0;
-                return bytes_erased;
-            }
+            return;
         }
-        it = next;
     }
 
-    f_modified = bytes_erased != 0;
-    return bytes_erased;
+    visit(static_cast<T *>(n->f_right.get()), offset - n->f_size, size, f);
 }
 
 
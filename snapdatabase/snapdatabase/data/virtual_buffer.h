@@ -35,6 +35,12 @@
  * practical because that way we do not have to handle the fact that
  * the buffer is multiple buffers. The virtual buffer gives us one
  * linear offset starting at `0` and going up to `size - 1`.
+ *
+ * The buffers (extents) are saved in a balanced tree (a treap) where
+ * each node caches the total size of its subtree. This way finding the
+ * extent at a given offset, inserting, and erasing data are all
+ * O(log n) operations. Inserting and erasing never move the data found
+ * after the modification, at most one extent gets split in two.
  */
 
 // self
@@ -44,7 +50,7 @@
 
 // C++ lib
 //
-#include    <deque>
+#include    <memory>
 
 
 
@@ -61,8 +67,18 @@ class virtual_buffer
 public:
     typedef std::shared_ptr<virtual_buffer> pointer_t;
 
+    // memory extents do not grow past this size, instead new extents
+    // get created; this limits the amount of data copied when an
+    // extent gets split
+    //
+    static constexpr std::uint64_t      MAXIMUM_EXTENT_SIZE = 64 * 1024;
+
                                         virtual_buffer();
                                         virtual_buffer(block::pointer_t b, std::uint64_t offset, std::uint64_t size);
+                                        virtual_buffer(virtual_buffer const & rhs) = delete;
+                                        ~virtual_buffer();
+
+    virtual_buffer &                    operator = (virtual_buffer const & rhs) = delete;
 
     void                                add_buffer(block::pointer_t b, std::uint64_t offset, std::uint64_t size);
 
@@ -79,19 +95,39 @@ public:
 private:
     struct vbuf_t
     {
-        typedef std::deque<vbuf_t>          deque_t;
+        typedef std::unique_ptr<vbuf_t>     pointer_t;
+
+                                            vbuf_t(std::uint32_t priority);
+                                            vbuf_t(block::pointer_t b, std::uint64_t offset, std::uint64_t size, std::uint32_t priority);
 
-                                            vbuf_t();
-                                            vbuf_t(block::pointer_t b, std::uint64_t offset, std::uint64_t size);
+        void                                update();
+        data_t                              data();
+        const_data_t                        data() const;
 
         block::pointer_t                    f_block = block::pointer_t();
         buffer_t                            f_data = buffer_t();    // data not (yet) in the block(s)
         std::uint64_t                       f_offset = 0;
         std::uint64_t                       f_size = 0;
+        std::uint64_t                       f_total_size = 0;       // this extent and its children
+        std::size_t                         f_count = 1;            // this extent and its children
+        std::uint32_t                       f_priority = 0;
+        pointer_t                           f_left = pointer_t();
+        pointer_t                           f_right = pointer_t();
     };
 
-    vbuf_t::deque_t                     f_buffers = vbuf_t::deque_t();
-    std::uint64_t                       f_total_size = 0;
+    static std::uint64_t                total_size(vbuf_t::pointer_t const & n);
+    static std::size_t                  count(vbuf_t::pointer_t const & n);
+    std::uint32_t                       priority();
+    vbuf_t::pointer_t                   new_extent(void const * buf, std::uint64_t size);
+    vbuf_t::pointer_t                   merge(vbuf_t::pointer_t left, vbuf_t::pointer_t right);
+    void                                split(vbuf_t::pointer_t n, std::uint64_t offset, vbuf_t::pointer_t & left, vbuf_t::pointer_t & right);
+    std::uint64_t                       append_to_last(vbuf_t * n, std::uint8_t const * in, std::uint64_t size);
+    bool                                insert_in_extent(vbuf_t * n, std::uint64_t offset, std::uint8_t const * in, std::uint64_t size);
+    template<class T, class F>
+    static void                         visit(T * n, std::uint64_t offset, std::uint64_t size, F & f);
+
+    vbuf_t::pointer_t                   f_root = vbuf_t::pointer_t();
+    std::uint32_t                       f_random = 0x9E3779B9;
     bool                                f_modified = false;
 };
 
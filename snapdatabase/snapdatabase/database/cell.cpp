@@ -29,6 +29,9 @@
 //
 #include    "snapdatabase/database/cell.h"
 
+#include    "snapdatabase/block/block.h"
+
+#include    "snapdatabase/data/compression.h"
 #include    "snapdatabase/data/convert.h"
 
 
@@ -49,6 +52,30 @@ namespace snapdatabase
 
 
 std::uint8_t read_uint8(buffer_t const & buffer, size_t & pos)
+{
+    return read_uint8(buffer.data(), pos);
+}
+
+
+std::uint16_t read_be_uint16(buffer_t const & buffer, size_t & pos)
+{
+    return read_be_uint16(buffer.data(), pos);
+}
+
+
+std::uint32_t read_be_uint32(buffer_t const & buffer, size_t & pos)
+{
+    return read_be_uint32(buffer.data(), pos);
+}
+
+
+std::uint64_t read_be_uint64(buffer_t const & buffer, size_t & pos)
+{
+    return read_be_uint64(buffer.data(), pos);
+}
+
+
+std::uint8_t read_uint8(const_data_t buffer, size_t & pos)
 {
     pos += sizeof(std::uint8_t);
 
@@ -56,7 +83,7 @@ std::uint8_t read_uint8(buffer_t const & buffer, size_t & pos)
 }
 
 
-std::uint16_t read_be_uint16(buffer_t const & buffer, size_t & pos)
+std::uint16_t read_be_uint16(const_data_t buffer, size_t & pos)
 {
     pos += sizeof(std::uint16_t);
 
@@ -65,7 +92,7 @@ std::uint16_t read_be_uint16(buffer_t const & buffer, size_t & pos)
 }
 
 
-std::uint32_t read_be_uint32(buffer_t const & buffer, size_t & pos)
+std::uint32_t read_be_uint32(const_data_t buffer, size_t & pos)
 {
     pos += sizeof(std::uint32_t);
 
@@ -76,7 +103,7 @@ std::uint32_t read_be_uint32(buffer_t const & buffer, size_t & pos)
 }
 
 
-std::uint64_t read_be_uint64(buffer_t const & buffer, size_t & pos)
+std::uint64_t read_be_uint64(const_data_t buffer, size_t & pos)
 {
     pos += sizeof(std::uint64_t);
 
@@ -164,6 +191,8 @@ void cell::set_void()
     verify_cell_type({
               struct_type_t::STRUCT_TYPE_VOID
         });
+
+    f_binary_view.reset();
 }
 
 
@@ -173,6 +202,8 @@ oid_t cell::get_oid() const
               struct_type_t::STRUCT_TYPE_OID
         });
 
+    load_binary_value();
+
     return f_integer.f_value[0];
 }
 
@@ -183,6 +214,8 @@ void cell::set_oid(oid_t oid)
               struct_type_t::STRUCT_TYPE_OID
         });
 
+    f_binary_view.reset();
+
     set_uinteger(oid);
 }
 
@@ -193,6 +226,8 @@ std::int8_t cell::get_int8() const
               struct_type_t::STRUCT_TYPE_INT8
         });
 
+    load_binary_value();
+
     return f_integer.f_value[0];
 }
 
@@ -203,6 +238,8 @@ void cell::set_int8(std::int8_t value)
               struct_type_t::STRUCT_TYPE_INT8
         });
 
+    f_binary_view.reset();
+
     set_integer(value);
 }
 
@@ -214,6 +251,8 @@ std::uint8_t cell::get_uint8() const
             , struct_type_t::STRUCT_TYPE_UINT8
         });
 
+    load_binary_value();
+
     return f_integer.f_value[0];
 }
 
@@ -225,6 +264,8 @@ void cell::set_uint8(std::uint8_t value)
             , struct_type_t::STRUCT_TYPE_UINT8
         });
 
+    f_binary_view.reset();
+
     set_uinteger(value);
 }
 
@@ -235,6 +276,8 @@ std::int16_t cell::get_int16() const
               struct_type_t::STRUCT_TYPE_INT16
         });
 
+    load_binary_value();
+
     return f_integer.f_value[0];
 }
 
@@ -245,6 +288,8 @@ void cell::set_int16(std::int16_t value)
               struct_type_t::STRUCT_TYPE_INT16
         });
 
+    f_binary_view.reset();
+
     set_integer(value);
 }
 
@@ -256,6 +301,8 @@ std::uint16_t cell::get_uint16() const
             , struct_type_t::STRUCT_TYPE_UINT16
         });
 
+    load_binary_value();
+
     return f_integer.f_value[0];
 }
 
@@ -267,6 +314,8 @@ void cell::set_uint16(std::uint16_t value)
             , struct_type_t::STRUCT_TYPE_UINT16
         });
 
+    f_binary_view.reset();
+
     set_uinteger(value);
 }
 
@@ -277,6 +326,8 @@ std::int32_t cell::get_int32() const
               struct_type_t::STRUCT_TYPE_INT32
         });
 
+    load_binary_value();
+
     return f_integer.f_value[0];
 }
 
@@ -287,6 +338,8 @@ void cell::set_int32(std::int32_t value)
               struct_type_t::STRUCT_TYPE_INT32
         });
 
+    f_binary_view.reset();
+
     set_integer(value);
 }
 
@@ -298,6 +351,8 @@ std::uint32_t cell::get_uint32() const
             , struct_type_t::STRUCT_TYPE_UINT32
         });
 
+    load_binary_value();
+
     return f_integer.f_value[0];
 }
 
@@ -309,6 +364,8 @@ void cell::set_uint32(std::uint32_t value)
             , struct_type_t::STRUCT_TYPE_UINT32
         });
 
+    f_binary_view.reset();
+
     set_uinteger(value);
 }
 
@@ -319,6 +376,8 @@ std::int64_t cell::get_int64() const
               struct_type_t::STRUCT_TYPE_INT64
         });
 
+    load_binary_value();
+
     return f_integer.f_value[0];
 }
 
@@ -329,6 +388,8 @@ void cell::set_int64(std::int64_t value)
               struct_type_t::STRUCT_TYPE_INT64
         });
 
+    f_binary_view.reset();
+
     set_integer(value);
 }
 
@@ -340,6 +401,8 @@ std::uint64_t cell::get_uint64() const
             , struct_type_t::STRUCT_TYPE_UINT64
         });
 
+    load_binary_value();
+
     return f_integer.f_value[0];
 }
 
@@ -351,6 +414,8 @@ void cell::set_uint64(std::uint64_t value)
             , struct_type_t::STRUCT_TYPE_UINT64
         });
 
+    f_binary_view.reset();
+
     set_uinteger(value);
 }
 
@@ -361,6 +426,8 @@ int512_t cell::get_int128() const
               struct_type_t::STRUCT_TYPE_INT128
         });
 
+    load_binary_value();
+
     return f_integer;
 }
 
@@ -371,6 +438,8 @@ void cell::set_int128(int512_t value)
               struct_type_t::STRUCT_TYPE_INT128
         });
 
+    f_binary_view.reset();
+
     f_integer = value;
 }
 
@@ -381,6 +450,8 @@ uint512_t cell::get_uint128() const
               struct_type_t::STRUCT_TYPE_UINT128
         });
 
+    load_binary_value();
+
     return f_integer;
 }
 
@@ -391,6 +462,8 @@ void cell::set_uint128(uint512_t value)
               struct_type_t::STRUCT_TYPE_UINT128
         });
 
+    f_binary_view.reset();
+
     f_integer = value;
 }
 
@@ -401,6 +474,8 @@ int512_t cell::get_int256() const
               struct_type_t::STRUCT_TYPE_INT256
         });
 
+    load_binary_value();
+
     return f_integer;
 }
 
@@ -411,6 +486,8 @@ void cell::set_int256(int512_t value)
               struct_type_t::STRUCT_TYPE_INT256
         });
 
+    f_binary_view.reset();
+
     f_integer = value;
 }
 
@@ -421,6 +498,8 @@ uint512_t cell::get_uint256() const
               struct_type_t::STRUCT_TYPE_UINT256
         });
 
+    load_binary_value();
+
     return f_integer;
 }
 
@@ -431,6 +510,8 @@ void cell::set_uint256(uint512_t value)
               struct_type_t::STRUCT_TYPE_UINT256
         });
 
+    f_binary_view.reset();
+
     f_integer = value;
 }
 
@@ -441,6 +522,8 @@ int512_t cell::get_int512() const
               struct_type_t::STRUCT_TYPE_INT512
         });
 
+    load_binary_value();
+
     return f_integer;
 }
 
@@ -451,6 +534,8 @@ void cell::set_int512(int512_t value)
               struct_type_t::STRUCT_TYPE_INT512
         });
 
+    f_binary_view.reset();
+
     f_integer = value;
 }
 
@@ -461,6 +546,8 @@ uint512_t cell::get_uint512() const
               struct_type_t::STRUCT_TYPE_UINT512
         });
 
+    load_binary_value();
+
     return f_integer;
 }
 
@@ -471,6 +558,8 @@ void cell::set_uint512(uint512_t value)
               struct_type_t::STRUCT_TYPE_UINT512
         });
 
+    f_binary_view.reset();
+
     f_integer = value;
 }
 
@@ -481,6 +570,8 @@ std::uint64_t cell::get_time() const
               struct_type_t::STRUCT_TYPE_TIME
         });
 
+    load_binary_value();
+
     return f_integer.f_value[0];
 }
 
@@ -491,6 +582,8 @@ void cell::set_time(std::uint64_t t)
               struct_type_t::STRUCT_TYPE_TIME
         });
 
+    f_binary_view.reset();
+
     set_uinteger(t);
 }
 
@@ -501,6 +594,8 @@ std::uint64_t cell::get_time_ms() const
               struct_type_t::STRUCT_TYPE_MSTIME
         });
 
+    load_binary_value();
+
     return f_integer.f_value[0];
 }
 
@@ -511,6 +606,8 @@ void cell::set_time_ms(std::uint64_t t)
               struct_type_t::STRUCT_TYPE_MSTIME
         });
 
+    f_binary_view.reset();
+
     set_uinteger(t);
 }
 
@@ -521,6 +618,8 @@ std::uint64_t cell::get_time_us() const
               struct_type_t::STRUCT_TYPE_USTIME
         });
 
+    load_binary_value();
+
     return f_integer.f_value[0];
 }
 
@@ -531,6 +630,8 @@ void cell::set_time_us(std::uint64_t t)
               struct_type_t::STRUCT_TYPE_USTIME
         });
 
+    f_binary_view.reset();
+
     set_uinteger(t);
 }
 
@@ -541,6 +642,8 @@ float cell::get_float32() const
               struct_type_t::STRUCT_TYPE_FLOAT32
         });
 
+    load_binary_value();
+
     return f_float_value;
 }
 
@@ -551,6 +654,8 @@ void cell::set_float32(float value)
               struct_type_t::STRUCT_TYPE_FLOAT32
         });
 
+    f_binary_view.reset();
+
     f_float_value = value;
 }
 
@@ -561,6 +666,8 @@ double cell::get_float64() const
               struct_type_t::STRUCT_TYPE_FLOAT64
         });
 
+    load_binary_value();
+
     return f_float_value;
 }
 
@@ -571,6 +678,8 @@ void cell::set_float64(double value)
               struct_type_t::STRUCT_TYPE_FLOAT64
         });
 
+    f_binary_view.reset();
+
     f_float_value = value;
 }
 
@@ -581,6 +690,8 @@ long double cell::get_float128() const
               struct_type_t::STRUCT_TYPE_FLOAT128
         });
 
+    load_binary_value();
+
     return f_float_value;
 }
 
@@ -591,6 +702,8 @@ void cell::set_float128(long double value)
               struct_type_t::STRUCT_TYPE_FLOAT128
         });
 
+    f_binary_view.reset();
+
     f_float_value = value;
 }
 
@@ -601,6 +714,8 @@ version_t cell::get_version() const
               struct_type_t::STRUCT_TYPE_VERSION
         });
 
+    load_binary_value();
+
     return version_t(f_integer.f_value[0]);
 }
 
@@ -611,6 +726,8 @@ void cell::set_version(version_t value)
               struct_type_t::STRUCT_TYPE_VERSION
         });
 
+    f_binary_view.reset();
+
     set_uinteger(value.to_binary());
 }
 
@@ -623,6 +740,8 @@ std::string cell::get_string() const
             , struct_type_t::STRUCT_TYPE_P32STRING
         });
 
+    load_binary_value();
+
     return f_string;
 }
 
@@ -635,10 +754,210 @@ void cell::set_string(std::string const & value)
             , struct_type_t::STRUCT_TYPE_P32STRING
         });
 
+    f_binary_view.reset();
+
     f_string = value;
 }
 
 
+/** \brief Get a direct pointer to the string data.
+ *
+ * This function returns a pointer to the string without making a copy.
+ * If the cell was loaded from a block and not yet modified, the pointer
+ * is directly in the block of the row.
+ *
+ * \warning
+ * The pointer remains valid only as long as the cell (and its row) are
+ * not modified or destroyed and the block of the row is not modified
+ * or evicted from the cache. At that point the cell gets a copy of the
+ * row and this function returns a pointer to that copy instead.
+ *
+ * \param[out] size  The size of the string in bytes.
+ *
+ * \return A pointer to the string data.
+ */
+const_data_t cell::get_string_data(std::size_t & size) const
+{
+    verify_cell_type({
+              struct_type_t::STRUCT_TYPE_P8STRING
+            , struct_type_t::STRUCT_TYPE_P16STRING
+            , struct_type_t::STRUCT_TYPE_P32STRING
+        });
+
+    if(f_binary_view != nullptr
+    && f_schema_column->compression() != compression_t::COMPRESSION_NONE)
+    {
+        // a compressed string has to be decompressed in f_string
+        //
+        load_binary_value();
+    }
+
+    const_data_t const value(binary_value());
+    if(value != nullptr)
+    {
+        size_t pos(0);
+        switch(f_schema_column->type())
+        {
+        case struct_type_t::STRUCT_TYPE_P8STRING:
+            size = read_uint8(value, pos);
+            break;
+
+        case struct_type_t::STRUCT_TYPE_P16STRING:
+            size = read_be_uint16(value, pos);
+            break;
+
+        default: // STRUCT_TYPE_P32STRING
+            size = read_be_uint32(value, pos);
+            break;
+
+        }
+        return value + pos;
+    }
+
+    size = f_string.length();
+    return reinterpret_cast<const_data_t>(f_string.data());
+}
+
+
+/** \brief Define the value of this cell from its binary representation.
+ *
+ * This function saves a reference to the binary value (as written by
+ * value_to_binary()) instead of decoding it. The value gets decoded the
+ * first time one of the get_...() functions is called. When one of the
+ * set_...() functions is called first, the binary value is just ignored.
+ *
+ * This is used when reading rows from a block: the cells reference the
+ * binary data of their row directly, which saves many memory allocations
+ * and copies, especially for large strings which are not even looked at.
+ *
+ * The cell keeps a reference to \p view so the value remains valid for
+ * as long as this cell exists, even if the row gets released first. The
+ * view points directly in the block of the row until that block gets
+ * modified or evicted, at which point the view makes a copy of the row.
+ * So get_string_data() returns a pointer which may change with time.
+ *
+ * \param[in] view  The view of the row binary data.
+ * \param[in] offset  The offset of the binary value in \p view.
+ * \param[in] size  The size of the binary value.
+ */
+void cell::set_binary_value(binary_pointer_t view, std::size_t offset, std::size_t size)
+{
+    f_binary_view = view;
+    f_binary_offset = offset;
+    f_binary_size = size;
+}
+
+
+/** \brief Get a pointer to the binary value.
+ *
+ * The pointer is only valid until the block of the row gets modified.
+ * The view then holds a copy of the row at a different address.
+ *
+ * \return A pointer to the binary value or nullptr.
+ */
+const_data_t cell::binary_value() const
+{
+    if(f_binary_view == nullptr)
+    {
+        return nullptr;
+    }
+
+    return f_binary_view->data() + f_binary_offset;
+}
+
+
+/** \brief Calculate the size of a value in binary.
+ *
+ * This function returns the number of bytes used by a value of type
+ * \p type saved at \p buffer. For strings, the size includes the size
+ * of the length prefix.
+ *
+ * \param[in] type  The type of the value.
+ * \param[in] buffer  A pointer to the value.
+ *
+ * \return The number of bytes used by this value.
+ */
+std::size_t cell::value_binary_size(struct_type_t type, const_data_t buffer)
+{
+    size_t pos(0);
+    switch(type)
+    {
+    case struct_type_t::STRUCT_TYPE_VOID:
+        return 0;
+
+    case struct_type_t::STRUCT_TYPE_BITS8:
+    case struct_type_t::STRUCT_TYPE_UINT8:
+    case struct_type_t::STRUCT_TYPE_INT8:
+        return sizeof(std::uint8_t);
+
+    case struct_type_t::STRUCT_TYPE_BITS16:
+    case struct_type_t::STRUCT_TYPE_UINT16:
+    case struct_type_t::STRUCT_TYPE_INT16:
+        return sizeof(std::uint16_t);
+
+    case struct_type_t::STRUCT_TYPE_BITS32:
+    case struct_type_t::STRUCT_TYPE_UINT32:
+    case struct_type_t::STRUCT_TYPE_VERSION:
+    case struct_type_t::STRUCT_TYPE_INT32:
+    case struct_type_t::STRUCT_TYPE_FLOAT32:
+        return sizeof(std::uint32_t);
+
+    case struct_type_t::STRUCT_TYPE_BITS64:
+    case struct_type_t::STRUCT_TYPE_UINT64:
+    case struct_type_t::STRUCT_TYPE_REFERENCE:
+    case struct_type_t::STRUCT_TYPE_OID:
+    case struct_type_t::STRUCT_TYPE_TIME:
+    case struct_type_t::STRUCT_TYPE_MSTIME:
+    case struct_type_t::STRUCT_TYPE_USTIME:
+    case struct_type_t::STRUCT_TYPE_INT64:
+    case struct_type_t::STRUCT_TYPE_FLOAT64:
+        return sizeof(std::uint64_t);
+
+    case struct_type_t::STRUCT_TYPE_BITS128:
+    case struct_type_t::STRUCT_TYPE_UINT128:
+    case struct_type_t::STRUCT_TYPE_INT128:
+    case struct_type_t::STRUCT_TYPE_FLOAT128:
+        return sizeof(std::uint64_t) * 2;
+
+    case struct_type_t::STRUCT_TYPE_BITS256:
+    case struct_type_t::STRUCT_TYPE_UINT256:
+    case struct_type_t::STRUCT_TYPE_INT256:
+        return sizeof(std::uint64_t) * 4;
+
+    case struct_type_t::STRUCT_TYPE_BITS512:
+    case struct_type_t::STRUCT_TYPE_UINT512:
+    case struct_type_t::STRUCT_TYPE_INT512:
+        return sizeof(std::uint64_t) * 8;
+
+    case struct_type_t::STRUCT_TYPE_P8STRING:
+        return sizeof(std::uint8_t) + read_uint8(buffer, pos);
+
+    case struct_type_t::STRUCT_TYPE_P16STRING:
+        return sizeof(std::uint16_t) + read_be_uint16(buffer, pos);
+
+    case struct_type_t::STRUCT_TYPE_P32STRING:
+        return sizeof(std::uint32_t) + read_be_uint32(buffer, pos);
+
+    case struct_type_t::STRUCT_TYPE_STRUCTURE:
+    case struct_type_t::STRUCT_TYPE_ARRAY8:
+    case struct_type_t::STRUCT_TYPE_ARRAY16:
+    case struct_type_t::STRUCT_TYPE_ARRAY32:
+    case struct_type_t::STRUCT_TYPE_BUFFER8:
+    case struct_type_t::STRUCT_TYPE_BUFFER16:
+    case struct_type_t::STRUCT_TYPE_BUFFER32:
+    case struct_type_t::STRUCT_TYPE_END:
+    case struct_type_t::STRUCT_TYPE_RENAMED:
+        break;
+
+    }
+
+    throw type_mismatch(
+              "Unexpected type ("
+            + std::to_string(static_cast<int>(type))
+            + ") to compute the size of a binary cell value.");
+}
+
+
 void cell::column_id_to_binary(buffer_t & buffer) const
 {
     column_id_t const id(f_schema_column->column_id());
@@ -658,6 +977,15 @@ column_id_t cell::column_id_from_binary(buffer_t const & buffer, size_t & pos)
 
 void cell::value_to_binary(buffer_t & buffer) const
 {
+    const_data_t const value(binary_value());
+    if(value != nullptr)
+    {
+        // the value was not modified, copy it as is
+        //
+        buffer.insert(buffer.end(), value, value + f_binary_size);
+        return;
+    }
+
     switch(f_schema_column->type())
     {
     case struct_type_t::STRUCT_TYPE_VOID:
@@ -762,16 +1090,24 @@ void cell::value_to_binary(buffer_t & buffer) const
 
     case struct_type_t::STRUCT_TYPE_P8STRING:
         {
-            size_t const size(f_string.length());
+            buffer_t payload;
+            bool const compressed(string_to_payload(payload));
+            size_t const size(compressed ? payload.size() : f_string.length());
             if(size > 255)
             {
                 throw out_of_bounds(
-                          "string to long for a P8STRING (max: 255, actually: "
+                          std::string("string to long for a P8STRING (max: 255")
+                        + (compressed ? " including the compression header" : "")
+                        + ", actually: "
                         + std::to_string(size)
                         + ").");
             }
             push_uint8(buffer, size);
-            if(size > 0)
+            if(compressed)
+            {
+                buffer.insert(buffer.end(), payload.begin(), payload.end());
+            }
+            else if(size > 0)
             {
                 uint8_t const * s(reinterpret_cast<uint8_t const *>(f_string.c_str()));
                 buffer.insert(buffer.end(), s, s + size);
@@ -781,16 +1117,24 @@ void cell::value_to_binary(buffer_t & buffer) const
 
     case struct_type_t::STRUCT_TYPE_P16STRING:
         {
-            size_t const size(f_string.length());
+            buffer_t payload;
+            bool const compressed(string_to_payload(payload));
+            size_t const size(compressed ? payload.size() : f_string.length());
             if(size > 65535)
             {
                 throw out_of_bounds(
-                          "string to long for a P16STRING (max: 64Kb, actually: "
+                          std::string("string to long for a P16STRING (max: 64Kb")
+                        + (compressed ? " including the compression header" : "")
+                        + ", actually: "
                         + std::to_string(size)
                         + ").");
             }
             push_be_uint16(buffer, size);
-            if(size > 0)
+            if(compressed)
+            {
+                buffer.insert(buffer.end(), payload.begin(), payload.end());
+            }
+            else if(size > 0)
             {
                 uint8_t const * s(reinterpret_cast<uint8_t const *>(f_string.c_str()));
                 buffer.insert(buffer.end(), s, s + size);
@@ -800,16 +1144,24 @@ void cell::value_to_binary(buffer_t & buffer) const
 
     case struct_type_t::STRUCT_TYPE_P32STRING:
         {
-            size_t const size(f_string.length());
+            buffer_t payload;
+            bool const compressed(string_to_payload(payload));
+            size_t const size(compressed ? payload.size() : f_string.length());
             if(size > 4294967295)
             {
                 throw out_of_bounds(
-                          "string to long for a P32STRING (max: 4Gb, actually: "
+                          std::string("string to long for a P32STRING (max: 4Gb")
+                        + (compressed ? " including the compression header" : "")
+                        + ", actually: "
                         + std::to_string(size)
                         + ").");
             }
             push_be_uint32(buffer, size);
-            if(size > 0)
+            if(compressed)
+            {
+                buffer.insert(buffer.end(), payload.begin(), payload.end());
+            }
+            else if(size > 0)
             {
                 uint8_t const * s(reinterpret_cast<uint8_t const *>(f_string.c_str()));
                 buffer.insert(buffer.end(), s, s + size);
@@ -837,6 +1189,14 @@ void cell::value_to_binary(buffer_t & buffer) const
 
 void cell::value_from_binary(buffer_t const & buffer, size_t & pos)
 {
+    value_from_binary(buffer.data(), pos);
+}
+
+
+void cell::value_from_binary(const_data_t buffer, size_t & pos)
+{
+    f_binary_view.reset();
+
     switch(f_schema_column->type())
     {
     case struct_type_t::STRUCT_TYPE_VOID:
@@ -988,8 +1348,7 @@ void cell::value_from_binary(buffer_t const & buffer, size_t & pos)
     case struct_type_t::STRUCT_TYPE_P8STRING:
         {
             size_t const size(read_uint8(buffer, pos));
-            f_string.resize(size);
-            memcpy(&f_string[0], buffer.data() + pos, size);
+            string_from_payload(buffer + pos, size);
             pos += size;
         }
         break;
@@ -997,8 +1356,7 @@ void cell::value_from_binary(buffer_t const & buffer, size_t & pos)
     case struct_type_t::STRUCT_TYPE_P16STRING:
         {
             size_t const size(read_be_uint16(buffer, pos));
-            f_string.resize(size);
-            memcpy(&f_string[0], buffer.data() + pos, size);
+            string_from_payload(buffer + pos, size);
             pos += size;
         }
         break;
@@ -1006,8 +1364,7 @@ void cell::value_from_binary(buffer_t const & buffer, size_t & pos)
     case struct_type_t::STRUCT_TYPE_P32STRING:
         {
             size_t const size(read_be_uint32(buffer, pos));
-            f_string.resize(size);
-            memcpy(&f_string[0], buffer.data() + pos, size);
+            string_from_payload(buffer + pos, size);
             pos += size;
         }
         break;
@@ -1030,8 +1387,100 @@ void cell::value_from_binary(buffer_t const & buffer, size_t & pos)
 }
 
 
+/** \brief Convert the value to a key usable in an index.
+ *
+ * The binary value of a cell is not always sorted properly when
+ * compared with memcmp(). This function generates a buffer which
+ * can be compared that way:
+ *
+ * \li signed integers have their sign bit flipped;
+ * \li floating points have their sign bit flipped when positive and
+ * all their bits inverted when negative;
+ * \li strings are saved without their size and followed by a '\0'
+ * so a shorter string sorts first.
+ *
+ * The other types are saved as is since their big endian binary value
+ * already sorts as expected.
+ *
+ * \param[in,out] key  The buffer where the key gets appended.
+ */
+void cell::value_to_key(buffer_t & key) const
+{
+    struct_type_t const type(f_schema_column->type());
+    if(type == struct_type_t::STRUCT_TYPE_P8STRING
+    || type == struct_type_t::STRUCT_TYPE_P16STRING
+    || type == struct_type_t::STRUCT_TYPE_P32STRING)
+    {
+        std::size_t size(0);
+        const_data_t s(get_string_data(size));
+        key.insert(key.end(), s, s + size);
+        push_uint8(key, 0);
+        return;
+    }
+
+    buffer_t value;
+    value_to_binary(value);
+    if(value.empty())
+    {
+        return;
+    }
+
+    switch(type)
+    {
+    case struct_type_t::STRUCT_TYPE_INT8:
+    case struct_type_t::STRUCT_TYPE_INT16:
+    case struct_type_t::STRUCT_TYPE_INT32:
+    case struct_type_t::STRUCT_TYPE_INT64:
+    case struct_type_t::STRUCT_TYPE_INT128:
+    case struct_type_t::STRUCT_TYPE_INT256:
+    case struct_type_t::STRUCT_TYPE_INT512:
+        value[0] ^= 0x80;
+        break;
+
+    case struct_type_t::STRUCT_TYPE_FLOAT128:
+        // the long double binary format includes padding in its most
+        // significant bytes, use the double format for the key
+        //
+        {
+            union fi {
+                uint64_t    f_int = 0;
+                double      f_float;
+            };
+            fi v;
+            v.f_float = static_cast<double>(get_float128());
+            value.clear();
+            push_be_uint64(value, v.f_int);
+        }
+        [[fallthrough]];
+    case struct_type_t::STRUCT_TYPE_FLOAT32:
+    case struct_type_t::STRUCT_TYPE_FLOAT64:
+        if((value[0] & 0x80) != 0)
+        {
+            for(auto & b : value)
+            {
+                b = ~b;
+            }
+        }
+        else
+        {
+            value[0] ^= 0x80;
+        }
+        break;
+
+    default:
+        break;
+
+    }
+
+    key.insert(key.end(), value.begin(), value.end());
+}
+
+
 void cell::copy_from(cell const & source)
 {
+    source.load_binary_value();
+    f_binary_view.reset();
+
     if(f_schema_column->type() == source.f_schema_column->type())
     {
         // no conversion needed, a direct copy will work just fine
@@ -1279,6 +1728,121 @@ void cell::copy_from(cell const & source)
 }
 
 
+/** \brief Compress the string of this cell.
+ *
+ * When the column is marked as compressed (`compress="lz4|zstd"`) the
+ * string values get compressed. In that case, the value saved in the
+ * row is a payload composed of:
+ *
+ * \li one byte with the compression used (compression_t)
+ * \li the size of the uncompressed string (32 bits, big endian) unless
+ * the compression is COMPRESSION_NONE
+ * \li the string, compressed unless the compression is COMPRESSION_NONE
+ *
+ * Small strings and strings which do not compress well are saved with
+ * COMPRESSION_NONE.
+ *
+ * \note
+ * The header is part of the value so the longest string a compressed
+ * P8STRING or P16STRING can hold is one byte shorter (254 and 65534
+ * bytes) unless it compresses.
+ *
+ * \param[out] payload  The buffer where the payload gets saved.
+ *
+ * \return true if the column is compressed and \p payload was defined.
+ */
+bool cell::string_to_payload(buffer_t & payload) const
+{
+    compression_t const compression(f_schema_column->compression());
+    if(compression == compression_t::COMPRESSION_NONE)
+    {
+        return false;
+    }
+
+    buffer_t compressed;
+    uint8_t const * s(reinterpret_cast<uint8_t const *>(f_string.c_str()));
+    if(compress_buffer(compression, s, f_string.length(), compressed)
+    && sizeof(std::uint32_t) + compressed.size() < f_string.length())
+    {
+        push_uint8(payload, static_cast<std::uint8_t>(compression));
+        push_be_uint32(payload, f_string.length());
+        payload.insert(payload.end(), compressed.begin(), compressed.end());
+    }
+    else
+    {
+        push_uint8(payload, static_cast<std::uint8_t>(compression_t::COMPRESSION_NONE));
+        payload.insert(payload.end(), s, s + f_string.length());
+    }
+
+    return true;
+}
+
+
+/** \brief Load the string of this cell from its binary payload.
+ *
+ * If the column is not compressed, the payload is the string as is.
+ * Otherwise the payload is as described in string_to_payload().
+ *
+ * \param[in] payload  The binary payload.
+ * \param[in] size  The size of the payload.
+ */
+void cell::string_from_payload(const_data_t payload, std::size_t size)
+{
+    if(f_schema_column->compression() == compression_t::COMPRESSION_NONE)
+    {
+        f_string.resize(size);
+        memcpy(&f_string[0], payload, size);
+        return;
+    }
+
+    if(size < 1)
+    {
+        throw invalid_size("a compressed string payload must be at least 1 byte.");
+    }
+
+    size_t pos(0);
+    compression_t const compression(static_cast<compression_t>(read_uint8(payload, pos)));
+    if(compression == compression_t::COMPRESSION_NONE)
+    {
+        f_string.resize(size - pos);
+        memcpy(&f_string[0], payload + pos, size - pos);
+        return;
+    }
+
+    if(size < pos + sizeof(std::uint32_t))
+    {
+        throw invalid_size("a compressed string payload is missing its size.");
+    }
+    size_t const uncompressed_size(read_be_uint32(payload, pos));
+    f_string.resize(uncompressed_size);
+    decompress_buffer(
+              compression
+            , payload + pos
+            , size - pos
+            , reinterpret_cast<std::uint8_t *>(&f_string[0])
+            , uncompressed_size);
+}
+
+
+void cell::load_binary_value() const
+{
+    if(f_binary_view == nullptr)
+    {
+        return;
+    }
+
+    // the decoding releases the view, keep it until we are done with it
+    //
+    binary_pointer_t const view(f_binary_view);
+
+    // the decoding changes the value fields which are not mutable, but
+    // from the outside the cell value does not change
+    //
+    size_t pos(0);
+    const_cast<cell *>(this)->value_from_binary(view->data() + f_binary_offset, pos);
+}
+
+
 void cell::set_integer(int64_t value)
 {
     f_integer.f_value[0] = value;
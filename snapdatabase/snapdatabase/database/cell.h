@@ -40,6 +40,9 @@ namespace snapdatabase
 {
 
 
+class block_view;
+
+
 // all of the following columns are recognized by the system
 // you are free to read any one of them, you can write to some of them
 //
@@ -52,6 +55,11 @@ std::uint16_t read_be_uint16(buffer_t const & buffer, size_t & pos);
 std::uint32_t read_be_uint32(buffer_t const & buffer, size_t & pos);
 std::uint64_t read_be_uint64(buffer_t const & buffer, size_t & pos);
 
+std::uint8_t  read_uint8(const_data_t buffer, size_t & pos);
+std::uint16_t read_be_uint16(const_data_t buffer, size_t & pos);
+std::uint32_t read_be_uint32(const_data_t buffer, size_t & pos);
+std::uint64_t read_be_uint64(const_data_t buffer, size_t & pos);
+
 void push_uint8(buffer_t & buffer, uint8_t value);
 void push_be_uint16(buffer_t & buffer, uint16_t value);
 void push_be_uint32(buffer_t & buffer, uint32_t value);
@@ -64,6 +72,7 @@ class cell
 public:
     typedef std::shared_ptr<cell>               pointer_t;
     typedef std::map<column_id_t, pointer_t>    map_t;
+    typedef std::shared_ptr<block_view>         binary_pointer_t;
 
                                                 cell(schema_column::pointer_t t);
 
@@ -142,12 +151,17 @@ public:
 
     std::string                                 get_string() const;
     void                                        set_string(std::string const & value);
+    const_data_t                                get_string_data(std::size_t & size) const;
 
     void                                        column_id_to_binary(buffer_t & buffer) const;
     static column_id_t                          column_id_from_binary(buffer_t const & buffer, size_t & pos);
 
     void                                        value_to_binary(buffer_t & buffer) const;
     void                                        value_from_binary(buffer_t const & buffer, size_t & pos);
+    void                                        value_from_binary(const_data_t buffer, size_t & pos);
+    void                                        set_binary_value(binary_pointer_t view, std::size_t offset, std::size_t size);
+    static std::size_t                          value_binary_size(struct_type_t type, const_data_t buffer);
+    void                                        value_to_key(buffer_t & key) const;
 
     void                                        copy_from(cell const & source);
 
@@ -155,11 +169,18 @@ private:
     void                                        set_integer(std::int64_t value);
     void                                        set_uinteger(std::uint64_t value);
     void                                        verify_cell_type(std::vector<struct_type_t> const & expected) const;
+    const_data_t                                binary_value() const;
+    void                                        load_binary_value() const;
+    bool                                        string_to_payload(buffer_t & payload) const;
+    void                                        string_from_payload(const_data_t payload, std::size_t size);
 
     schema_column::pointer_t                    f_schema_column = schema_column::pointer_t();
     uint512_t                                   f_integer = uint512_t();
     long double                                 f_float_value = 0.0L;
     std::string                                 f_string = std::string();
+    binary_pointer_t                            f_binary_view = binary_pointer_t();
+    std::size_t                                 f_binary_offset = 0;
+    std::size_t                                 f_binary_size = 0;
 };
 
 
@@ -0,0 +1,236 @@
+// Copyright (c) 2019  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapdatabase
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+/** \file
+ * \brief Change feed implementation.
+ *
+ * The feed is a ring buffer of the last rows committed to a table. The
+ * first change gets sequence number 1 and each new change increments
+ * the sequence. Change number N is saved at position (N - 1) modulo the
+ * capacity of the ring so the oldest change gets overwritten once the
+ * ring is full.
+ *
+ * The feed only lives in memory. When the table gets opened again, the
+ * sequence restarts at 1 with a new epoch. A listener which saved an
+ * epoch and a sequence must compare the epochs before resuming, if they
+ * differ, it missed changes and has to scan the table once.
+ */
+
+// self
+//
+#include    "snapdatabase/database/change_feed.h"
+
+
+// snapwebsites lib
+//
+#include    <snapwebsites/snap_child.h>
+
+
+// snaplogger lib
+//
+#include    <snaplogger/message.h>
+
+
+// C++ lib
+//
+#include    <algorithm>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace snapdatabase
+{
+
+
+
+/** \brief Initialize a change feed.
+ *
+ * The epoch of the feed is set to the current date in microseconds.
+ *
+ * \param[in] capacity  The maximum number of changes kept in memory.
+ */
+change_feed::change_feed(std::size_t capacity)
+    : f_epoch(snap::snap_child::get_current_date())
+    , f_ring(std::max(capacity, static_cast<std::size_t>(1)))
+{
+}
+
+
+/** \brief Get the epoch of this feed.
+ *
+ * The sequence numbers are only meaningful within one epoch.
+ *
+ * \return The date, in microseconds, when this feed was created.
+ */
+std::int64_t change_feed::get_epoch() const
+{
+    return f_epoch;
+}
+
+
+/** \brief Get the sequence number of the last change.
+ *
+ * \return The sequence of the last change or 0 if no change happened yet.
+ */
+std::uint64_t change_feed::get_sequence() const
+{
+    return f_sequence;
+}
+
+
+/** \brief Get the sequence number of the oldest change still available.
+ *
+ * \return The sequence of the oldest change in the ring.
+ */
+std::uint64_t change_feed::get_oldest_sequence() const
+{
+    if(f_sequence < f_ring.size())
+    {
+        return 1;
+    }
+    return f_sequence - f_ring.size() + 1;
+}
+
+
+std::size_t change_feed::get_capacity() const
+{
+    return f_ring.size();
+}
+
+
+/** \brief Add a change to the feed.
+ *
+ * The change is saved in the ring and then sent to all the listeners.
+ * A listener which throws does not prevent the other listeners from
+ * receiving the change. The row is already committed at this point.
+ *
+ * \param[in] type  Whether the row was inserted or updated.
+ * \param[in] row_data  The row as committed.
+ *
+ * \return The sequence number of this change.
+ */
+std::uint64_t change_feed::append(change_type_t type, buffer_t const & row_data)
+{
+    ++f_sequence;
+
+    change_t & c(f_ring[(f_sequence - 1) % f_ring.size()]);
+    c.f_sequence = f_sequence;
+    c.f_type = type;
+    c.f_date = snap::snap_child::get_current_date();
+    c.f_row = row_data;
+
+    // a listener may add or remove listeners
+    //
+    listener_map_t const listeners(f_listeners);
+    for(auto const & l : listeners)
+    {
+        try
+        {
+            l.second(c);
+        }
+        catch(std::exception const & e)
+        {
+            SNAP_LOG_ERROR
+                << "change feed listener #"
+                << l.first
+                << " failed: "
+                << e.what()
+                << SNAP_LOG_SEND;
+        }
+    }
+
+    return f_sequence;
+}
+
+
+/** \brief Read the changes which happened after \p after.
+ *
+ * The function appends to \p changes the changes with a sequence
+ * number larger than \p after, oldest first, up to \p max changes.
+ * Use 0 to read all the changes still in the ring.
+ *
+ * If some of the changes following \p after were already overwritten,
+ * the function returns false and \p changes starts with the oldest
+ * change still available. This also happens if \p after is larger than
+ * the current sequence, which means it comes from a previous epoch.
+ *
+ * \param[in] after  The sequence of the last change already processed.
+ * \param[in,out] changes  The vector where the changes get appended.
+ * \param[in] max  The maximum number of changes to append.
+ *
+ * \return false if changes were lost.
+ */
+bool change_feed::read(
+          std::uint64_t after
+        , change_t::vector_t & changes
+        , std::size_t max) const
+{
+    bool lost(false);
+    std::uint64_t const oldest(get_oldest_sequence());
+    if(after > f_sequence
+    || after + 1 < oldest)
+    {
+        after = oldest - 1;
+        lost = true;
+    }
+
+    if(max == 0)
+    {
+        max = f_ring.size();
+    }
+    for(std::uint64_t sequence(after + 1); sequence <= f_sequence && max > 0; ++sequence, --max)
+    {
+        changes.push_back(f_ring[(sequence - 1) % f_ring.size()]);
+    }
+
+    return !lost;
+}
+
+
+/** \brief Add a listener.
+ *
+ * The listener gets called each time a change gets appended, right
+ * after the row was committed and in the same thread.
+ *
+ * \param[in] l  The function to call with each change.
+ *
+ * \return The identifier to use with remove_listener().
+ */
+change_feed::listener_id_t change_feed::add_listener(listener_t l)
+{
+    ++f_next_listener_id;
+    f_listeners[f_next_listener_id] = l;
+    return f_next_listener_id;
+}
+
+
+void change_feed::remove_listener(listener_id_t id)
+{
+    f_listeners.erase(id);
+}
+
+
+
+} // namespace snapdatabase
+// vim: ts=4 sw=4 et
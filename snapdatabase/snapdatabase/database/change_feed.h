@@ -0,0 +1,110 @@
+// Copyright (c) 2019  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapdatabase
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+
+/** \file
+ * \brief Feed of the changes made to a table.
+ *
+ * Each table keeps the last rows which were committed in a ring buffer.
+ * Each change gets a sequence number so a listener can resume reading
+ * the feed from the last change it processed instead of scanning the
+ * table on a timer.
+ */
+
+// self
+//
+#include    "snapdatabase/data/virtual_buffer.h"
+
+
+// C++ lib
+//
+#include    <functional>
+#include    <map>
+
+
+
+namespace snapdatabase
+{
+
+
+
+enum class change_type_t : std::uint8_t
+{
+    CHANGE_TYPE_NONE = 0,       // update which did not change the row
+    CHANGE_TYPE_INSERT = 1,
+    CHANGE_TYPE_UPDATE = 2
+};
+
+
+struct change_t
+{
+    typedef std::vector<change_t>       vector_t;
+
+    std::uint64_t                       f_sequence = 0;
+    change_type_t                       f_type = change_type_t::CHANGE_TYPE_INSERT;
+    std::int64_t                        f_date = 0;
+    buffer_t                            f_row = buffer_t();
+};
+
+
+class change_feed
+{
+public:
+    typedef std::shared_ptr<change_feed>            pointer_t;
+    typedef std::uint32_t                           listener_id_t;
+    typedef std::function<void(change_t const &)>   listener_t;
+
+    static constexpr std::size_t        DEFAULT_CAPACITY = 1024;
+    static constexpr std::size_t        MINIMUM_CAPACITY = 1;
+    static constexpr std::size_t        MAXIMUM_CAPACITY = 1024 * 1024;
+
+                                        change_feed(std::size_t capacity = DEFAULT_CAPACITY);
+                                        change_feed(change_feed const & rhs) = delete;
+
+    change_feed &                       operator = (change_feed const & rhs) = delete;
+
+    std::int64_t                        get_epoch() const;
+    std::uint64_t                       get_sequence() const;
+    std::uint64_t                       get_oldest_sequence() const;
+    std::size_t                         get_capacity() const;
+
+    std::uint64_t                       append(change_type_t type, buffer_t const & row_data);
+    bool                                read(
+                                              std::uint64_t after
+                                            , change_t::vector_t & changes
+                                            , std::size_t max = static_cast<std::size_t>(-1)) const;
+
+    listener_id_t                       add_listener(listener_t l);
+    void                                remove_listener(listener_id_t id);
+
+private:
+    typedef std::map<listener_id_t, listener_t> listener_map_t;
+
+    std::int64_t                        f_epoch = 0;
+    std::uint64_t                       f_sequence = 0;
+    change_t::vector_t                  f_ring = change_t::vector_t();
+    listener_map_t                      f_listeners = listener_map_t();
+    listener_id_t                       f_next_listener_id = 0;
+};
+
+
+
+} // namespace snapdatabase
+// vim: ts=4 sw=4 et
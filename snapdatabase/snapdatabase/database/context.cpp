@@ -91,6 +91,7 @@ public:
     table::pointer_t                    get_table(std::string const & name) const;
     table::map_t                        list_tables() const;
     std::string                         get_path() const;
+    std::int64_t                        sync_commit_logs();
     size_t                              get_config_size(std::string const & name) const;
     std::string                         get_config_string(std::string const & name, int idx) const;
     long                                get_config_long(std::string const & name, int idx) const;
@@ -365,6 +366,22 @@ std::string context_impl::get_path() const
 }
 
 
+std::int64_t context_impl::sync_commit_logs()
+{
+    std::int64_t result(-1);
+    for(auto const & t : f_tables)
+    {
+        std::int64_t const next(t.second->sync_commit_log());
+        if(next != -1
+        && (result == -1 || next < result))
+        {
+            result = next;
+        }
+    }
+    return result;
+}
+
+
 size_t context_impl::get_config_size(std::string const & name) const
 {
     return f_opts->size(name);
@@ -457,6 +474,21 @@ void context::limit_allocated_memory()
 }
 
 
+/** \brief Synchronize the commit logs of all the tables.
+ *
+ * The group commit policy may leave the last rows committed to a table
+ * unsynchronized. This function synchronizes the rows which waited for
+ * the group commit delay. It is expected to be called from a timer.
+ *
+ * \return The number of microseconds until the next call is due or -1
+ * if no rows are waiting in any of the tables.
+ */
+std::int64_t context::sync_commit_logs()
+{
+    return f_impl->sync_commit_logs();
+}
+
+
 size_t context::get_config_size(std::string const & name) const
 {
     return f_impl->get_config_size(name);
@@ -29,6 +29,8 @@
 //
 #include    "snapdatabase/database/row.h"
 
+#include    "snapdatabase/block/block.h"
+
 
 // murmur3 lib
 //
@@ -101,15 +103,19 @@ buffer_t row::to_binary() const
     table::pointer_t t(get_table());
     push_be_uint32(result, t->schema_version().to_binary());
 
+    load_binary_cells();
+
     // TODO: have several loops:
     //
     //    1. columns that are needed by filters
-    //    2. data that we want to compress
-    //    3. data that we want to encrypt
+    //    2. data that we want to encrypt
     //
     // Ultimately, filters should work against any columns, but speed wise
     // it's just not good if compressed and/or encrypted;
     //
+    // Note: columns marked with compress="..." get compressed by the
+    //       cell itself (see cell::value_to_binary())
+    //
     for(auto const & c : f_cells)
     {
         c.second->column_id_to_binary(result);
@@ -197,7 +203,6 @@ void row::from_binary(buffer_t const & blob)
                 break;
             }
 
-std::cerr << "READ COLUMN DATA... pos = " << pos << " vs " << blob.size() << " column ID " << column_id << "\n";
             cell::pointer_t cell(get_cell(column_id, true));
             cell->value_from_binary(blob, pos);
         }
@@ -205,6 +210,53 @@ std::cerr << "READ COLUMN DATA... pos = " << pos << " vs " << blob.size() << " c
 }
 
 
+/** \brief Attach the binary data of a row to this row object.
+ *
+ * This function is similar to the from_binary() with a buffer except that
+ * it does not decode the data. Instead it keeps the \p view and creates
+ * cells only when they get accessed. Those cells keep a reference to
+ * their value in that view and decode it only when read.
+ *
+ * This means reading a row with many columns, when only one or two are
+ * used, does not allocate anything for the other columns. It also means
+ * large values (i.e. a page of HTML) do not get decoded if they are only
+ * sent to a client (see cell::get_string_data()).
+ *
+ * The view points directly in the block the row was read from and
+ * keeps that block in memory, so the row does not get copied. The block
+ * can be modified at any time once this function returns (a compaction
+ * moves rows, an update may overwrite the row in place, a journal reset
+ * clears the blocks). Before that happens, or when the cache evicts the
+ * block, the view makes a copy of the row (copy-on-write). The view is
+ * shared between the row and its cells so a cell remains valid even
+ * after its row was released.
+ *
+ * When a cell gets modified, its binary value is ignored (copy-on-write).
+ *
+ * If the row was written with an older schema, then the data has to be
+ * converted. In that case, this function calls the other from_binary()
+ * function.
+ *
+ * \param[in] view  The view of the row binary data.
+ */
+void row::from_binary(cell::binary_pointer_t view)
+{
+    table::pointer_t t(f_table.lock());
+    const_data_t const blob(view->data());
+    size_t pos(0);
+    version_t const version(read_be_uint32(blob, pos));
+    if(version != t->schema_version())
+    {
+        // the row needs to be converted, go the slow way
+        //
+        from_binary(buffer_t(blob, blob + view->size()));
+        return;
+    }
+
+    f_binary = view;
+}
+
+
 cell::pointer_t row::get_cell(column_id_t const & column_id, bool create)
 {
     auto it(f_cells.find(column_id));
@@ -224,6 +276,12 @@ cell::pointer_t row::get_cell(column_id_t const & column_id, bool create)
                 + "\" (get_cell).");
     }
 
+    cell::pointer_t const binary_cell(load_binary_cells(column_id));
+    if(binary_cell != nullptr)
+    {
+        return binary_cell;
+    }
+
     if(!create)
     {
         return cell::pointer_t();
@@ -254,6 +312,12 @@ cell::pointer_t row::get_cell(std::string const & column_name, bool create)
             return it->second;
     }
 
+    cell::pointer_t const binary_cell(load_binary_cells(column->column_id()));
+    if(binary_cell != nullptr)
+    {
+        return binary_cell;
+    }
+
     if(!create)
     {
         return cell::pointer_t();
@@ -267,6 +331,10 @@ cell::pointer_t row::get_cell(std::string const & column_name, bool create)
 
 void row::delete_cell(column_id_t const & column_id)
 {
+    // make sure the cell does not get resurrected from the binary data
+    //
+    load_binary_cells();
+
     auto it(f_cells.find(column_id));
     if(it != f_cells.end())
     {
@@ -294,10 +362,81 @@ void row::delete_cell(std::string const & column_name)
 
 cell::map_t row::cells() const
 {
+    load_binary_cells();
+
     return f_cells;
 }
 
 
+/** \brief Create cells from the binary data.
+ *
+ * This function goes through the binary data attached with the
+ * from_binary() function and creates the cell with \p column_id.
+ *
+ * If \p column_id is 0, then all the cells which were not yet created
+ * get created and the binary data gets detached from the row (the
+ * cells keep their pointer to their binary value, though).
+ *
+ * \param[in] column_id  The identifier of the cell to create or 0.
+ *
+ * \return The cell with \p column_id or nullptr.
+ */
+cell::pointer_t row::load_binary_cells(column_id_t column_id) const
+{
+    if(f_binary == nullptr)
+    {
+        return cell::pointer_t();
+    }
+
+    table::pointer_t t(get_table());
+    const_data_t const binary(f_binary->data());
+    size_t pos(sizeof(std::uint32_t));      // skip version
+    while(pos + sizeof(std::uint16_t) <= f_binary->size())
+    {
+        column_id_t const id(static_cast<column_id_t>(read_be_uint16(binary, pos)));
+        if(id == 0)
+        {
+            // this happens because we align the data
+            break;
+        }
+
+        schema_column::pointer_t column(t->column(id));
+        if(column == nullptr)
+        {
+            throw column_not_found(
+                      "Column with identifier "
+                    + std::to_string(static_cast<int>(id))
+                    + " does not exist in \""
+                    + t->name()
+                    + "\" (load_binary_cells).");
+        }
+
+        std::size_t const size(cell::value_binary_size(column->type(), binary + pos));
+        if(column_id == 0 || column_id == id)
+        {
+            if(f_cells.find(id) == f_cells.end())
+            {
+                cell::pointer_t c(std::make_shared<cell>(column));
+                c->set_binary_value(f_binary, pos, size);
+                f_cells[id] = c;
+                if(column_id == id)
+                {
+                    return c;
+                }
+            }
+        }
+        pos += size;
+    }
+
+    if(column_id == 0)
+    {
+        f_binary.reset();
+    }
+
+    return cell::pointer_t();
+}
+
+
 bool row::commit()
 {
     return get_table()->row_commit(shared_from_this());
@@ -421,5 +560,59 @@ void row::generate_mumur3(buffer_t & murmur3, version_t version, std::string con
 }
 
 
+/** \brief Generate the key used to sort this row in a secondary index.
+ *
+ * The key is the concatenation of the values of the sort columns of the
+ * secondary \p index, in order. The values are converted with the
+ * cell::value_to_key() function so the keys can be compared with
+ * memcmp(). A descending column gets all of its bits inverted. Each
+ * value is truncated to the length defined in the sort column.
+ *
+ * The function stops at the first column which is not defined in this
+ * row. This is how a partial key gets defined for the min/max keys of
+ * a range search (i.e. you can search on the first column only).
+ *
+ * \todo
+ * Apply the sort column function and the index filter.
+ *
+ * \param[in] index  The secondary index for which a key is generated.
+ * \param[out] key  The buffer where the key gets saved.
+ *
+ * \return The number of sort columns used to generate the key.
+ */
+std::size_t row::generate_secondary_key(schema_secondary_index::pointer_t index, buffer_t & key)
+{
+    key.clear();
+
+    std::size_t const max(index->get_column_count());
+    for(std::size_t idx(0); idx < max; ++idx)
+    {
+        schema_sort_column::pointer_t sc(index->get_sort_column(idx));
+        cell::pointer_t const cell(get_cell(sc->get_column_id(), false));
+        if(cell == nullptr)
+        {
+            return idx;
+        }
+
+        buffer_t value;
+        cell->value_to_key(value);
+        if(value.size() > sc->get_length())
+        {
+            value.resize(sc->get_length());
+        }
+        if(!sc->is_ascending())
+        {
+            for(auto & b : value)
+            {
+                b = ~b;
+            }
+        }
+        key.insert(key.end(), value.begin(), value.end());
+    }
+
+    return max;
+}
+
+
 } // namespace snapdatabase
 // vim: ts=4 sw=4 et
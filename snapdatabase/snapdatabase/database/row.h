@@ -61,6 +61,7 @@ public:
 
     buffer_t                                    to_binary() const;
     void                                        from_binary(buffer_t const & blob);
+    void                                        from_binary(cell::binary_pointer_t view);
 
     cell::pointer_t                             get_cell(column_id_t const & column_id, bool create);
     cell::pointer_t                             get_cell(std::string const & column_name, bool create);
@@ -73,10 +74,17 @@ public:
     bool                                        update();
 
     void                                        generate_mumur3(buffer_t & murmur3, version_t version = version_t(), std::string const language = std::string());
+    std::size_t                                 generate_secondary_key(schema_secondary_index::pointer_t index, buffer_t & key);
 
 private:
+    cell::pointer_t                             load_binary_cells(column_id_t column_id = 0) const;
+
     table::weak_pointer_t                       f_table = table::weak_pointer_t();
-    cell::map_t                                 f_cells = cell::map_t();
+    mutable cell::map_t                         f_cells = cell::map_t();
+
+    // when reading a row, the cells are created only when accessed
+    //
+    mutable cell::binary_pointer_t              f_binary = cell::binary_pointer_t();
 };
 
 
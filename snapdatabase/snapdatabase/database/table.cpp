@@ -35,6 +35,7 @@
 // all the blocks since we create them here
 //
 #include    "snapdatabase/block/block_blob.h"
+#include    "snapdatabase/block/block_cache.h"
 #include    "snapdatabase/block/block_data.h"
 #include    "snapdatabase/block/block_entry_index.h"
 #include    "snapdatabase/block/block_free_block.h"
@@ -48,9 +49,11 @@
 #include    "snapdatabase/block/block_schema_list.h"
 #include    "snapdatabase/block/block_top_index.h"
 #include    "snapdatabase/block/block_top_indirect_index.h"
+#include    "snapdatabase/data/commit_log.h"
 #include    "snapdatabase/file/file_bloom_filter.h"
 #include    "snapdatabase/file/file_external_index.h"
 #include    "snapdatabase/file/file_snap_database_table.h"
+#include    "snapdatabase/file/hash.h"
 
 
 // snapwebsites lib
@@ -58,6 +61,16 @@
 #include    <snapwebsites/snap_child.h>
 
 
+// advgetopt lib
+//
+#include    <advgetopt/validator_integer.h>
+
+
+// snaplogger lib
+//
+#include    <snaplogger/message.h>
+
+
 // snapdev lib
 //
 #include    <snapdev/not_used.h>
@@ -65,7 +78,10 @@
 
 // C++ lib
 //
+#include    <algorithm>
+#include    <chrono>
 #include    <iostream>
+#include    <limits>
 
 
 // last include
@@ -84,6 +100,23 @@ namespace detail
 
 
 
+namespace
+{
+
+
+
+/** \brief Identifier of the Bloom Filter pages in the commit log.
+ *
+ * The pages of the Bloom Filter file are saved in the commit log of
+ * the table. This identifier distinguishes them from the pages of the
+ * table file which use identifier 0.
+ */
+constexpr std::uint8_t const    g_bloom_filter_file_id = 1;
+
+
+
+}
+// no name namespace
 
 
 
@@ -101,6 +134,18 @@ public:
         std::uint32_t                       f_index_position = 0;       // position within the index at end of a read
     };
 
+    struct scan_position_t
+    {
+        reference_t                         f_entry_index = NULL_FILE_ADDR;     // EIDX being read
+        std::uint32_t                       f_position = 0;                     // position within that EIDX
+        std::uint32_t                       f_pointer = 0;                      // position within the IDXP list of that entry
+        std::size_t                         f_count = 0;                        // number of rows returned so far
+        buffer_t                            f_min_key = buffer_t();
+        buffer_t                            f_max_key = buffer_t();
+        bool                                f_started = false;
+        bool                                f_done = false;
+    };
+
                                         cursor_state(index_type_t index_type, schema_secondary_index::pointer_t secondary_index);
 
     index_type_t                        get_index_type() const;
@@ -112,6 +157,9 @@ public:
     void                                set_entry_index(block_entry_index::pointer_t entry_index);
     std::uint32_t                       get_entry_index_close_position() const;
     void                                set_entry_index_close_position(std::uint32_t position);
+    bool                                get_bloom_filter_miss() const;
+    void                                set_bloom_filter_miss(bool miss);
+    scan_position_t &                   get_scan_position();
 
 private:
     index_type_t                        f_index_type = index_type_t::INDEX_TYPE_INVALID;
@@ -119,6 +167,8 @@ private:
     index_reference_t::vector_t         f_row_references = index_reference_t::vector_t();
     block_entry_index::pointer_t        f_entry_index = block_entry_index::pointer_t();
     std::uint32_t                       f_entry_index_position = std::uint32_t(0);
+    bool                                f_bloom_filter_miss = false;
+    scan_position_t                     f_scan_position = scan_position_t();
 };
 
 
@@ -177,6 +227,42 @@ void cursor_state::set_entry_index_close_position(std::uint32_t position)
 }
 
 
+/** \brief Whether the index search was skipped.
+ *
+ * When the Bloom Filter tells us that a key is not present, the
+ * read_primary() function returns immediately without searching
+ * the index. This means the entry index and close position are not
+ * defined in this state. An insert has to do the search if this
+ * flag is true.
+ *
+ * \return true if the search was skipped because of the Bloom Filter.
+ */
+bool cursor_state::get_bloom_filter_miss() const
+{
+    return f_bloom_filter_miss;
+}
+
+
+void cursor_state::set_bloom_filter_miss(bool miss)
+{
+    f_bloom_filter_miss = miss;
+}
+
+
+/** \brief The position of a range scan.
+ *
+ * The secondary index scans go through the `EIDX` blocks one entry at
+ * a time. This position is used to continue the scan where we left
+ * off when the cursor asks for more rows.
+ *
+ * \return A reference to the scan position of this cursor.
+ */
+cursor_state::scan_position_t & cursor_state::get_scan_position()
+{
+    return f_scan_position;
+}
+
+
 
 
 
@@ -218,6 +304,60 @@ enum class commit_mode_t
 };
 
 
+/** \brief Read a size from the configuration.
+ *
+ * The value is read as a string so we can verify it before using it.
+ * If the value is not a valid integer or is out of range, an error is
+ * logged and the default is used instead. In particular, a negative
+ * value never gets cast to a huge size_t.
+ *
+ * \param[in] c  The context with the configuration.
+ * \param[in] name  The name of the parameter.
+ * \param[in] default_value  The value to use when undefined or invalid.
+ * \param[in] minimum  The smallest acceptable value.
+ * \param[in] maximum  The largest acceptable value.
+ *
+ * \return The size to use.
+ */
+std::size_t get_config_size_in_range(
+          context * c
+        , std::string const & name
+        , std::size_t default_value
+        , std::size_t minimum
+        , std::size_t maximum)
+{
+    if(c->get_config_size(name) == 0)
+    {
+        return default_value;
+    }
+
+    std::string const value(c->get_config_string(name, 0));
+    std::int64_t size(0);
+    if(!advgetopt::validator_integer::convert_string(value, size)
+    || size < 0
+    || static_cast<std::uint64_t>(size) < minimum
+    || static_cast<std::uint64_t>(size) > maximum)
+    {
+        SNAP_LOG_ERROR
+            << "invalid "
+            << name
+            << " \""
+            << value
+            << "\", expected a number between "
+            << minimum
+            << " and "
+            << maximum
+            << "; using the default of "
+            << default_value
+            << " instead."
+            << SNAP_LOG_SEND;
+        return default_value;
+    }
+
+    return static_cast<std::size_t>(size);
+}
+
+
 
 class table_impl
 {
@@ -228,6 +368,7 @@ public:
                                                     , xml_node::pointer_t x
                                                     , schema_complex_type::map_pointer_t complex_types);
                                                 table_impl(table_impl const & rhs) = delete;
+                                                ~table_impl();
 
     table_impl                                  operator = (table_impl const & rhs) = delete;
 
@@ -253,22 +394,77 @@ public:
     schema_table::pointer_t                     get_schema(version_t const & version);
     schema_secondary_index::pointer_t           secondary_index(std::string const & name) const;
     bool                                        row_commit(row_pointer_t row, commit_mode_t mode);
+    void                                        replay_commit_log();
+    void                                        set_group_commit(std::uint32_t count, std::int64_t delay_us);
+    std::int64_t                                sync_commit_log();
+    void                                        checkpoint();
+    void                                        set_journaling(bool journaling);
+    bool                                        compact(std::uint32_t max_blocks, std::int64_t max_time_us);
+    row::pointer_t                              journal_next(std::uint64_t now_ms, std::uint64_t timeout_ms);
+    bool                                        journal_done(row::pointer_t row_data);
+    void                                        journal_reset();
     void                                        row_insert(row::pointer_t row_data, cursor::pointer_t cur);
-    void                                        row_update(row::pointer_t row_data, cursor::pointer_t cur);
+    bool                                        row_update(row::pointer_t row_data, row::pointer_t existing_row);
     block_primary_index::pointer_t              get_primary_index_block(bool create);
     void                                        read_rows(cursor_data & data);
+    block_cache::statistics_t                   get_cache_statistics() const;
+    change_feed::pointer_t                      get_change_feed() const;
+    file_bloom_filter::pointer_t                get_bloom_filter();
 
 private:
     block::pointer_t                            allocate_block(dbtype_t type, reference_t offset);
     void                                        start_update_process(bool restart);
+    void                                        open_commit_log();
+    change_type_t                               row_apply(row::pointer_t row_data, commit_mode_t mode);
+    block_indirect_index::pointer_t             find_indirect_index(oid_t & oid);
     reference_t                                 get_indirect_reference(oid_t oid);
+    void                                        move_row(reference_t old_reference, reference_t new_reference);
+    void                                        release_tail_blocks();
     row::pointer_t                              get_indirect_row(oid_t oid);
     row::pointer_t                              get_row(reference_t row_reference);
+    oid_t                                       find_primary_entry(buffer_t const & key, cursor_state::pointer_t state);
+    schema_secondary_index::pointer_t           get_expiration_index();
+    schema_secondary_index::pointer_t           get_journal_index();
+    void                                        init_journal_cells(row::pointer_t row_data);
+    void                                        set_journal_state(oid_t oid, std::uint8_t status, std::uint64_t start_date, std::uint8_t timeout_counter);
+    block_secondary_index::pointer_t            get_secondary_index_block(schema_secondary_index::pointer_t index, bool create);
+    std::uint32_t                               secondary_key_size(schema_secondary_index::pointer_t index) const;
+    void                                        add_secondary_entry(schema_secondary_index::pointer_t index, row::pointer_t row_data, oid_t oid);
+    block_entry_index::pointer_t                find_insert_entry_index(
+                                                      std::string const & index_name
+                                                    , reference_t root
+                                                    , buffer_t const & key
+                                                    , std::vector<block_top_index::pointer_t> & path);
+    reference_t                                 add_index_entry(
+                                                      block_entry_index::pointer_t entry_index
+                                                    , std::vector<block_top_index::pointer_t> & path
+                                                    , buffer_t const & key
+                                                    , oid_t oid);
+    reference_t                                 add_top_index_entry(
+                                                      std::vector<block_top_index::pointer_t> & path
+                                                    , buffer_t left_key
+                                                    , reference_t left_reference
+                                                    , buffer_t key
+                                                    , reference_t reference);
+    void                                        add_index_pointer(block_entry_index::pointer_t entry_index, std::uint32_t position, oid_t oid);
+    oid_t                                       get_index_pointer(reference_t reference, std::uint32_t position);
+    bool                                        remove_index_pointer(block_entry_index::pointer_t entry_index, std::uint32_t position, oid_t oid);
+    bool                                        remove_secondary_entry(schema_secondary_index::pointer_t index, row::pointer_t row_data, oid_t oid);
+    void                                        remove_entry_index(
+                                                      block_secondary_index::pointer_t secondary_index
+                                                    , std::vector<block_top_index::pointer_t> & path
+                                                    , block_entry_index::pointer_t entry_index);
+    block_entry_index::pointer_t                find_secondary_entry_index(schema_secondary_index::pointer_t index, block_secondary_index::pointer_t secondary_index, buffer_t const & key);
+    void                                        start_secondary_scan(cursor_data & data, schema_secondary_index::pointer_t index);
+    void                                        seek_secondary_scan(schema_secondary_index::pointer_t index, buffer_t const & key, bool reverse, cursor_state::scan_position_t & scan);
+    oid_t                                       next_secondary_oid(cursor_state::scan_position_t & scan, bool reverse, buffer_t * entry_key = nullptr);
+    void                                        read_secondary_index(cursor_data & data, schema_secondary_index::pointer_t index);
 
     void                                        read_secondary(cursor_data & data);
     void                                        read_indirect(cursor_data & data);
     void                                        read_primary(cursor_data & data);
     void                                        read_expiration(cursor_data & data);
+    void                                        read_journal(cursor_data & data);
     void                                        read_tree(cursor_data & data);
 
     context *                                   f_context = nullptr;
@@ -276,7 +472,18 @@ private:
     schema_table::pointer_t                     f_schema_table = schema_table::pointer_t();
     schema_table::map_by_version_t              f_schema_table_by_version = schema_table::map_by_version_t();
     dbfile::pointer_t                           f_dbfile = dbfile::pointer_t();
-    block::map_t                                f_blocks = block::map_t();
+    std::unique_ptr<block_cache>                f_blocks = std::unique_ptr<block_cache>();
+    dbfile::pointer_t                           f_bloom_filter_file = dbfile::pointer_t();
+    file_bloom_filter::pointer_t                f_bloom_filter = file_bloom_filter::pointer_t();
+    bool                                        f_bloom_filter_checked = false;
+    schema_secondary_index::pointer_t           f_expiration_index = schema_secondary_index::pointer_t();
+    schema_secondary_index::pointer_t           f_journal_index = schema_secondary_index::pointer_t();
+    commit_log::pointer_t                       f_commit_log = commit_log::pointer_t();
+    std::uint64_t                               f_checkpoint_size = commit_log::DEFAULT_CHECKPOINT_SIZE;
+    bool                                        f_commit_log_replayed = false;
+    bool                                        f_replaying = false;
+    change_feed::pointer_t                      f_change_feed = change_feed::pointer_t();
+    reference_t                                 f_compact_offset = NULL_FILE_ADDR;
 };
 
 
@@ -293,6 +500,42 @@ table_impl::table_impl(
     f_schema_table->from_xml(x);
     f_dbfile = std::make_shared<dbfile>(c->get_path(), f_schema_table->name(), "main");
     f_dbfile->set_page_size(f_schema_table->block_size());
+    f_dbfile->set_type(dbtype_t::FILE_TYPE_SNAP_DATABASE_TABLE);
+
+    f_blocks = std::make_unique<block_cache>(
+                  f_dbfile
+                , get_config_size_in_range(
+                          c
+                        , "block_cache_size"
+                        , block_cache::DEFAULT_CACHE_SIZE
+                        , block_cache::MINIMUM_CACHE_SIZE
+                        , block_cache::MAXIMUM_CACHE_SIZE));
+
+    f_change_feed = std::make_shared<change_feed>(
+                get_config_size_in_range(
+                          c
+                        , "change_feed_size"
+                        , change_feed::DEFAULT_CAPACITY
+                        , change_feed::MINIMUM_CAPACITY
+                        , change_feed::MAXIMUM_CAPACITY));
+}
+
+
+table_impl::~table_impl()
+{
+    try
+    {
+        checkpoint();
+    }
+    catch(std::exception const & e)
+    {
+        SNAP_LOG_ERROR
+            << "could not checkpoint table \""
+            << f_schema_table->name()
+            << "\" on exit: "
+            << e.what()
+            << SNAP_LOG_SEND;
+    }
 }
 
 
@@ -310,6 +553,14 @@ dbfile::pointer_t table_impl::get_dbfile() const
 
 schema_table::pointer_t table_impl::get_schema(version_t const & version)
 {
+    // before reading anything, restore the pages saved in the commit
+    // log in case we did not properly checkpoint on the last run
+    //
+    if(f_commit_log == nullptr)
+    {
+        open_commit_log();
+    }
+
     // the very first time `get_schema()` is called, `version` must be
     // set to `0.0` (a.k.a. `version_t()`) which is how the latest schema
     // gets added to the table if necessary
@@ -326,6 +577,14 @@ schema_table::pointer_t table_impl::get_schema(version_t const & version)
     // they are read-only anyway so they are never going to change
     // once loaded in our cache
     //
+    // `0.0` means the current schema, once the cache is initialized
+    // that's always `f_schema_table`
+    //
+    if(version == version_t()
+    && !f_schema_table_by_version.empty())
+    {
+        return f_schema_table;
+    }
     auto const it(f_schema_table_by_version.find(version.to_binary()));
     if(it != f_schema_table_by_version.end())
     {
@@ -561,26 +820,26 @@ size_t table_impl::get_page_size() const
 
 block::pointer_t table_impl::allocate_block(dbtype_t type, reference_t offset)
 {
-    auto it(f_blocks.find(offset));
-    if(it != f_blocks.end())
+    block::pointer_t cached(f_blocks->find(offset));
+    if(cached != nullptr)
     {
-        if(type == it->second->get_dbtype())
+        if(type == cached->get_dbtype())
         {
-            return it->second;
+            return cached;
         }
         // TBD: I think only FREE blocks can be replaced by something else
         //      and vice versa or we've got a bug on our hands
         //
         if(type != dbtype_t::BLOCK_TYPE_FREE_BLOCK
-        && it->second->get_dbtype() != dbtype_t::BLOCK_TYPE_FREE_BLOCK)
+        && cached->get_dbtype() != dbtype_t::BLOCK_TYPE_FREE_BLOCK)
         {
             throw snapdatabase_logic_error(
                       "allocate_block() called a non-free block type trying to allocate a non-free block ("
                     + to_string(type)
                     + "). You can go from a free to non-free and non-free to free only.");
         }
-        //it->second->replacing(); -- this won't work right at this time TODO...
-        f_blocks.erase(it);
+        //cached->replacing(); -- this won't work right at this time TODO...
+        f_blocks->erase(offset);
     }
 
     block::pointer_t b;
@@ -660,12 +919,9 @@ block::pointer_t table_impl::allocate_block(dbtype_t type, reference_t offset)
     b->get_structure()->set_block(b, 0, get_page_size());
     b->set_dbtype(type);
 
-    f_context->limit_allocated_memory();
-
-    // we add this block to the list of blocks only after the call to
-    // limit the allocated memory
+    // the cache evicts older blocks if this one brings it over its budget
     //
-    f_blocks[offset] = b;
+    f_blocks->insert(b);
 
     return b;
 }
@@ -758,25 +1014,24 @@ void table_impl::start_update_process(bool restart)
 
 block::pointer_t table_impl::get_block(reference_t offset)
 {
+    // callers often pass the reference of something within the block
+    // (i.e. a row or a free space link); the cache only knows about the
+    // start of the blocks
+    //
+    offset -= offset % get_page_size();
+
     if(offset != 0
     && offset >= f_dbfile->get_size())
     {
         throw snapdatabase_logic_error("Requested a block with an offset >= to the existing file size.");
     }
 
-    structure::pointer_t s(std::make_shared<structure>(g_block_header));
-    data_t d(f_dbfile->data(offset));
-    virtual_buffer::pointer_t header(std::make_shared<virtual_buffer>());
-#ifdef _DEBUG
-    if(s->get_size() != BLOCK_HEADER_SIZE)
-    {
-        throw snapdatabase_logic_error("sizeof(g_block_header) != BLOCK_HEADER_SIZE");
-    }
-#endif
-    header->pwrite(d, s->get_size(), 0, true);
-    s->set_virtual_buffer(header, 0);
-    dbtype_t const type(static_cast<dbtype_t>(s->get_uinteger("magic")));
-    //version_t const version(s->get_uinteger("version"));
+    static_assert(static_structure_size(g_block_header) == BLOCK_HEADER_SIZE, "sizeof(g_block_header) != BLOCK_HEADER_SIZE");
+
+    // this is called for each block access so read the magic directly
+    // instead of creating a structure to read the header
+    //
+    dbtype_t const type(static_cast<dbtype_t>(g_block_header_magic_field.get(f_dbfile->data(offset))));
 
     block::pointer_t b(allocate_block(type, offset));
 
@@ -899,6 +1154,7 @@ void table_impl::free_block(block::pointer_t block, bool clear_block)
     reference_t const offset(block->get_offset());
     block_free_block::pointer_t p(std::static_pointer_cast<block_free_block>(
             allocate_block(dbtype_t::BLOCK_TYPE_FREE_BLOCK, offset)));
+    p->set_structure_version();
 
     if(clear_block)
     {
@@ -912,589 +1168,2819 @@ void table_impl::free_block(block::pointer_t block, bool clear_block)
 }
 
 
+/** \brief Commit a row.
+ *
+ * This function saves the row in the table and then appends it to the
+ * commit log. While the row gets saved, the pages which get modified
+ * for the first time since the last checkpoint are saved in the commit
+ * log so we can restore them on a crash.
+ *
+ * The page images get synchronized before the pages get modified. The
+ * row itself gets synchronized according to the group commit policy
+ * (see set_group_commit()). Once the log is large enough, a checkpoint
+ * happens.
+ *
+ * Finally, the row gets appended to the change feed of the table which
+ * wakes up its listeners. The rows replayed from the commit log on
+ * startup are not added to the feed. An update which does not change
+ * the row is neither logged nor added to the feed.
+ *
+ * \param[in] row_data  The row to commit.
+ * \param[in] mode  Whether to insert, update, or either.
+ *
+ * \return true if the row was committed, false if it was an update
+ * which did not change anything.
+ */
 bool table_impl::row_commit(row::pointer_t row_data, commit_mode_t mode)
 {
-    conditions cond;
-    cond.set_columns({"_oid"});
-    cond.set_key("primary", row_data, row::pointer_t());
-    cursor::pointer_t cur(f_table->row_select(cond));
+    replay_commit_log();
 
-    row::pointer_t r(cur->next_row());
-    if(r == nullptr)
+    change_type_t type(change_type_t::CHANGE_TYPE_INSERT);
+    set_journaling(true);
+    try
     {
-std::cerr << "+++ mode = " << static_cast<int>(mode) << "\n";
-        if(mode == commit_mode_t::COMMIT_MODE_UPDATE)
-        {
-            throw row_not_found(
-                      "Row with key \""
-                    + std::string("...")
-                    + "\" was not found so it can't be updated.");
-        }
+        type = row_apply(row_data, mode);
+    }
+    catch(...)
+    {
+        set_journaling(false);
+        throw;
+    }
+    set_journaling(false);
 
-std::cerr << "+++ row_insert()\n";
-        row_insert(row_data, cur);
+    if(type == change_type_t::CHANGE_TYPE_NONE)
+    {
+        return false;
     }
-    else
+
+    if(!f_replaying)
     {
-        if(mode == commit_mode_t::COMMIT_MODE_INSERT)
+        buffer_t const binary(row_data->to_binary());
+        f_commit_log->append_row(static_cast<std::uint8_t>(mode), binary);
+        f_commit_log->commit();
+
+        if(f_commit_log->get_size() >= f_checkpoint_size)
         {
-            throw row_already_exists(
-                      "Row with key \""
-                    + std::string("...")
-                    + "\" already exists so it can't be inserted.");
+            checkpoint();
         }
 
-        row_update(row_data, cur);
+        f_change_feed->append(type, binary);
     }
 
     return true;
 }
 
 
-/** \brief Insert a new row.
+/** \brief Open the commit log of this table.
  *
- * This is an internal function which the table_impl uses to insert a new
- * row.
+ * This function attaches the commit log to the table file. If the log
+ * is not empty, the pages it includes get restored. The rows get
+ * committed again later by replay_commit_log() since at this point the
+ * schema is not yet available.
  *
- * \note
- * The row_commit() is called first and determines whether to call
- * insert or update or generate an error.
+ * The group commit policy is defined by the `group_commit_count` and
+ * `group_commit_delay` parameters. By default, each commit synchronizes
+ * the log.
+ */
+void table_impl::open_commit_log()
+{
+    f_commit_log = std::make_shared<commit_log>(f_dbfile->get_dirname(), "commit_log");
+    f_commit_log->set_group_commit(
+              get_config_size_in_range(
+                      f_context
+                    , "group_commit_count"
+                    , commit_log::DEFAULT_GROUP_COMMIT_COUNT
+                    , 1
+                    , commit_log::MAXIMUM_GROUP_COMMIT_COUNT)
+            , get_config_size_in_range(
+                      f_context
+                    , "group_commit_delay"
+                    , commit_log::DEFAULT_GROUP_COMMIT_DELAY
+                    , 0
+                    , commit_log::MAXIMUM_GROUP_COMMIT_DELAY));
+    f_dbfile->set_commit_log(f_commit_log);
+}
+
+
+/** \brief Commit the rows found in the commit log again.
  *
- * \param[in] row_data  The row to be inserted.
+ * The first time the table is accessed, this function commits the rows
+ * found in the commit log. These are rows which were committed after
+ * the last checkpoint. Since the pages were restored to their state
+ * at the time of that checkpoint, this brings the table back to its
+ * state at the time of the last row which made it to the log.
+ *
+ * Once done, a checkpoint happens which empties the log.
  */
-void table_impl::row_insert(row::pointer_t row_data, cursor::pointer_t cur)
+void table_impl::replay_commit_log()
 {
-    // if inserting, we first need to allocation this row's OID
-    //
-    file_snap_database_table::pointer_t header(std::static_pointer_cast<file_snap_database_table>(get_block(0)));
-    oid_t oid(header->get_first_free_oid());
-    bool const must_exist(oid != NULL_OID);
-    if(!must_exist)
+    if(f_commit_log_replayed)
     {
-        // no free OID, generate a new one
-        //
-        oid = header->get_last_oid();
-        header->set_last_oid(oid + 1);
+        return;
     }
+    f_commit_log_replayed = true;
 
-    // found a free OID, go to it in the indirect table and replace
-    // the first free OID with the one in that table (i.e. unlink
-    // `oid` from the list)
+    if(f_commit_log == nullptr)
+    {
+        open_commit_log();
+    }
+
+    // the Bloom Filter pages saved in the log get restored when the
+    // filter is opened, do it before the log gets truncated
     //
-    oid_t position_oid(oid);
-    oid_t parent_oid(oid);
-    block_indirect_index::pointer_t indr;
-    reference_t offset(header->get_indirect_index());
-std::cerr << "+++ GET INDIRECT INDEX: " << offset << " from " << oid << "\n";
-    if(offset == NULL_FILE_ADDR)
+    snapdev::NOT_USED(get_bloom_filter());
+
+    std::vector<std::pair<commit_mode_t, buffer_t>> rows;
+    f_commit_log->replay([&rows](
+              commit_log_record_t type
+            , std::uint8_t mode
+            , reference_t offset
+            , const_data_t data
+            , std::size_t size)
+        {
+            snapdev::NOT_USED(offset);
+
+            if(type == commit_log_record_t::COMMIT_LOG_RECORD_ROW)
+            {
+                rows.emplace_back(static_cast<commit_mode_t>(mode), buffer_t(data, data + size));
+            }
+        });
+    if(rows.empty())
     {
-        // the very first time we'll hit a null
-        //
-        if(oid != 1)
+        return;
+    }
+
+    SNAP_LOG_WARNING
+        << "committing "
+        << rows.size()
+        << " row"
+        << (rows.size() == 1 ? "" : "s")
+        << " found in the commit log of table \""
+        << name()
+        << "\"."
+        << SNAP_LOG_SEND;
+
+    f_replaying = true;
+    for(auto const & r : rows)
+    {
+        try
         {
-            throw snapdatabase_logic_error("the indirect index offset is null but the first OID is not 1.");
+            row::pointer_t row_data(std::make_shared<row>(f_table->get_pointer()));
+            row_data->from_binary(r.second);
+            row_commit(row_data, r.first);
         }
-        indr = std::static_pointer_cast<block_indirect_index>(
-                        allocate_new_block(dbtype_t::BLOCK_TYPE_INDIRECT_INDEX));
+        catch(std::exception const & e)
+        {
+            SNAP_LOG_ERROR
+                << "could not commit row from the commit log of table \""
+                << name()
+                << "\": "
+                << e.what()
+                << SNAP_LOG_SEND;
+        }
+    }
+    f_replaying = false;
 
-        header->set_indirect_index(indr->get_offset());
+    checkpoint();
+}
+
+
+/** \brief Define the group commit policy of this table.
+ *
+ * \param[in] count  The number of rows to commit before a sync.
+ * \param[in] delay_us  The maximum number of microseconds before a sync.
+ *
+ * \sa commit_log::set_group_commit()
+ */
+void table_impl::set_group_commit(std::uint32_t count, std::int64_t delay_us)
+{
+    if(f_commit_log == nullptr)
+    {
+        open_commit_log();
     }
-    else
+    f_commit_log->set_group_commit(count, delay_us);
+}
+
+
+/** \brief Synchronize the rows which waited long enough in the log.
+ *
+ * \return The number of microseconds until the next call is due or -1.
+ *
+ * \sa commit_log::sync_expired()
+ */
+std::int64_t table_impl::sync_commit_log()
+{
+    if(f_commit_log == nullptr)
     {
-        block_top_indirect_index::pointer_t parent_tind;
-        reference_t parent_offset(offset);
-        block::pointer_t block(get_block(offset));
-        while(block->get_dbtype() == dbtype_t::BLOCK_TYPE_TOP_INDIRECT_INDEX)
+        return -1;
+    }
+    return f_commit_log->sync_expired();
+}
+
+
+/** \brief Flush the table file and empty the commit log.
+ *
+ * The rows found in the log are first committed again if that was not
+ * yet done, otherwise the truncation would lose them.
+ *
+ * The Bloom Filter file gets flushed before the table file since the
+ * table file checkpoint is the one truncating the commit log.
+ */
+void table_impl::checkpoint()
+{
+    if(f_commit_log == nullptr)
+    {
+        return;
+    }
+
+    replay_commit_log();
+
+    f_commit_log->sync();
+    if(f_bloom_filter_file != nullptr)
+    {
+        f_bloom_filter_file->checkpoint();
+    }
+    f_dbfile->checkpoint();
+}
+
+
+/** \brief Turn the journaling of modified pages on or off.
+ *
+ * The pages of the table file and of the Bloom Filter file get saved
+ * in the commit log while journaling is on.
+ *
+ * \param[in] journaling  Whether pages get journaled.
+ */
+void table_impl::set_journaling(bool journaling)
+{
+    f_dbfile->set_journaling(journaling);
+    if(f_bloom_filter_file != nullptr)
+    {
+        f_bloom_filter_file->set_journaling(journaling);
+    }
+}
+
+
+/** \brief Run one step of the compaction process.
+ *
+ * The compaction goes through the `DATA` blocks of the table one at a
+ * time. Each block gets repacked: the rows are moved at the start of the
+ * block and the free spaces are merged in one free space at the end.
+ * Blocks which do not include any rows anymore are returned to the list
+ * of free blocks (in a sparse table, the disk space of those blocks is
+ * also released). Once the whole file was processed, the free blocks
+ * found at the end of the file are removed from the file.
+ *
+ * The process is incremental. Each call processes at most \p max_blocks
+ * `DATA` blocks and stops once \p max_time_us microseconds elapsed. The
+ * next call continues where the previous one stopped. This way the owner
+ * of the table can run the compaction when idle without blocking other
+ * accesses for long.
+ *
+ * The changes are journaled like a row commit and a checkpoint happens
+ * at the end of each step.
+ *
+ * Rows read from the table hold a copy of their data so they remain
+ * valid after a call to this function.
+ *
+ * \param[in] max_blocks  The maximum number of `DATA` blocks to process.
+ * \param[in] max_time_us  The maximum amount of time to spend in this call
+ * or 0 for no limit.
+ *
+ * \return true once a complete pass over the file is done.
+ */
+bool table_impl::compact(std::uint32_t max_blocks, std::int64_t max_time_us)
+{
+    replay_commit_log();
+
+    file_snap_database_table::pointer_t header(std::static_pointer_cast<file_snap_database_table>(get_block(0)));
+    reference_t const fspc_offset(header->get_blobs_with_free_space());
+    if(fspc_offset == NULL_FILE_ADDR)
+    {
+        // no rows were ever saved, nothing to compact
+        //
+        return true;
+    }
+    block_free_space::pointer_t fspc(std::static_pointer_cast<block_free_space>(get_block(fspc_offset)));
+
+    std::chrono::steady_clock::time_point const start_time(std::chrono::steady_clock::now());
+    size_t const page_size(get_page_size());
+    size_t const system_page_size(dbfile::get_system_page_size());
+    if(f_compact_offset == NULL_FILE_ADDR)
+    {
+        f_compact_offset = page_size;
+    }
+
+    bool done(true);
+    set_journaling(true);
+    try
+    {
+        std::uint32_t count(0);
+        for(; f_compact_offset < f_dbfile->get_size(); f_compact_offset += page_size)
         {
-            block_top_indirect_index::pointer_t tind(std::static_pointer_cast<block_top_indirect_index>(block));
-            oid_t const save_oid(position_oid);
-            offset = tind->get_reference(position_oid, must_exist);
-std::cerr << "+++ GET REFERENCE FROM SUB-OID: " << offset << " from " << position_oid << "\n";
-            if(offset == NULL_FILE_ADDR)
+            if(count >= max_blocks
+            || (max_time_us > 0
+                && std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count() >= max_time_us))
             {
-                // no child exists yet, create an INDR
-                //
-                indr = std::static_pointer_cast<block_indirect_index>(
-                                allocate_new_block(dbtype_t::BLOCK_TYPE_INDIRECT_INDEX));
-                position_oid = save_oid;
-                tind->set_reference(position_oid, indr->get_offset());
+                done = false;
                 break;
             }
 
-            if(offset == MISSING_FILE_ADDR)
+            // avoid loading all the blocks, only `DATA` blocks are of interest
+            //
+            dbtype_t const type(*reinterpret_cast<dbtype_t const *>(f_dbfile->data(f_compact_offset)));
+            if(type != dbtype_t::BLOCK_TYPE_DATA)
             {
-                if(tind->get_block_level() >= 255)
-                {
-                    throw out_of_bounds("too many block levels.");
-                }
-
-                block_top_indirect_index::pointer_t top_tind(
-                            std::static_pointer_cast<block_top_indirect_index>(
-                                allocate_new_block(dbtype_t::BLOCK_TYPE_TOP_INDIRECT_INDEX)));
-                top_tind->set_block_level(tind->get_block_level() + 1);
+                continue;
+            }
+            ++count;
 
-                if(parent_tind != nullptr)
+            block::pointer_t data_block(get_block(f_compact_offset));
+            bool const empty(fspc->compact_block(
+                      data_block
+                    , [this](reference_t old_reference, reference_t new_reference)
+                    {
+                        move_row(old_reference, new_reference);
+                    }));
+            if(empty)
+            {
+                bool const sparse(f_dbfile->get_sparse());
+                free_block(data_block, !sparse || is_secure());
+                if(sparse
+                && page_size > system_page_size)
                 {
-                    // we overflowed an intermediate entry we have to
-                    // add an intermediate (the `top_tind` is actually
-                    // an intermediate) so we need to add a link in the
-                    // parent to this new `TIND`
+                    // keep the first system page, it holds the `FREE` block
+                    // header
                     //
-                    position_oid = parent_oid;
-                    parent_tind->set_reference(position_oid, parent_offset);
-                }
-                else
-                {
-                    header->set_indirect_index(top_tind->get_offset());
+                    f_dbfile->punch_hole(f_compact_offset + system_page_size, page_size - system_page_size);
                 }
-
-                position_oid = save_oid - 1;
-                top_tind->set_reference(position_oid, tind->get_offset());
-
-                indr = std::static_pointer_cast<block_indirect_index>(
-                                allocate_new_block(dbtype_t::BLOCK_TYPE_INDIRECT_INDEX));
-                position_oid = save_oid;
-                top_tind->set_reference(position_oid, indr->get_offset());
-                break;
             }
+        }
 
-            parent_tind = tind;
-            parent_offset = offset;
-            parent_oid = save_oid;
-            block = get_block(parent_offset);
+        if(done)
+        {
+            release_tail_blocks();
         }
+    }
+    catch(...)
+    {
+        set_journaling(false);
+        throw;
+    }
+    set_journaling(false);
 
-        if(indr == nullptr)
+    if(done)
+    {
+        f_compact_offset = NULL_FILE_ADDR;
+    }
+
+    checkpoint();
+
+    return done;
+}
+
+
+/** \brief Remove the `FREE` blocks found at the end of the file.
+ *
+ * This function searches for the `FREE` blocks at the end of the file,
+ * removes them from the list of free blocks and truncates the file.
+ */
+void table_impl::release_tail_blocks()
+{
+    size_t const page_size(get_page_size());
+    size_t const file_size(f_dbfile->get_size());
+    reference_t end(file_size);
+    while(end > page_size
+       && *reinterpret_cast<dbtype_t const *>(f_dbfile->data(end - page_size)) == dbtype_t::BLOCK_TYPE_FREE_BLOCK)
+    {
+        end -= page_size;
+    }
+    if(end == file_size)
+    {
+        return;
+    }
+
+    file_snap_database_table::pointer_t header(std::static_pointer_cast<file_snap_database_table>(get_block(0)));
+    block_free_block::pointer_t previous;
+    reference_t offset(header->get_first_free_block());
+    while(offset != NULL_FILE_ADDR)
+    {
+        block_free_block::pointer_t p(std::static_pointer_cast<block_free_block>(get_block(offset)));
+        reference_t const next(p->get_next_free_block());
+        if(offset >= end)
         {
-            if(block->get_dbtype() != dbtype_t::BLOCK_TYPE_INDIRECT_INDEX)
+            if(previous == nullptr)
             {
-                throw type_mismatch(
-                          "expected block of type INDIRECT INDEX (INDR) (got \""
-                        + to_string(block->get_dbtype())
-                        + "\" instead).");
+                header->set_first_free_block(next);
             }
-            indr = std::static_pointer_cast<block_indirect_index>(block);
-std::cerr << "+++ GOT AN EXISTING INDIRECT INDEX BLOCK! " << position_oid << " vs " << indr->get_max_count() << "\n";
-            if(position_oid > indr->get_max_count())
+            else
             {
-                oid_t const save_oid(position_oid);
+                previous->set_next_free_block(next);
+            }
+        }
+        else
+        {
+            previous = p;
+        }
+        offset = next;
+    }
 
-                // that `INDR` is full, create a new top `TIND`
-                //
-                block_top_indirect_index::pointer_t top_tind(
-                            std::static_pointer_cast<block_top_indirect_index>(
-                                allocate_new_block(dbtype_t::BLOCK_TYPE_TOP_INDIRECT_INDEX)));
-                if(parent_tind == nullptr)
-                {
-                    top_tind->set_block_level(1);
+    f_blocks->erase_from(end);
 
-                    header->set_indirect_index(top_tind->get_offset());
-                }
-                else
-                {
-                    std::uint8_t block_level(parent_tind->get_block_level());
-                    if(block_level <= 1)
-                    {
-                        throw snapdatabase_logic_error(
-                                  "parent_tind block level is "
-                                + std::to_string(static_cast<int>(parent_tind->get_block_level()))
-                                + " which is not valid here, it is expected to be at least 2.");
-                    }
+    // make sure the commit log does not include pages past the new end
+    // of the file before we truncate it
+    //
+    checkpoint();
+    f_dbfile->truncate(end);
+}
 
-                    // we may have many levels, we need to create them all
-                    // in this case (we may later ameliorate our algorithm
-                    // to avoid this early cascade...)
-                    //
-                    position_oid = parent_oid;
-                    for(;;)
-                    {
-                        --block_level;
-                        top_tind->set_block_level(block_level);
 
-                        parent_tind->set_reference(position_oid, top_tind->get_offset());
+/** \brief Retrieve the next row to be processed from a journal.
+ *
+ * The journal index sorts the rows by priority and then by process
+ * date. For each priority, we search the first row. If its process
+ * date is in the future, no rows of that priority are due and we jump
+ * to the next priority with a new O(log n) search. So the cost of
+ * this function depends on the number of priorities in use and not
+ * the number of rows in the journal.
+ *
+ * The priority and process date are read from the index key so the
+ * rows which are not due are never loaded. The `_status` changes too
+ * often to be part of the key, so the row gets loaded once it is due.
+ * That row is the one returned. The payload itself is not saved in
+ * the index (see "Covering Index" in JOURNAL.md).
+ *
+ * The row returned is marked as being processed (`_status` is set to
+ * JOURNAL_STATUS_PROCESSING and `_start_processing_date` to \p now_ms).
+ * Once the work is done, call journal_done() with that row.
+ *
+ * Rows being processed since more than \p timeout_ms are considered
+ * waiting again: their `_timeout_counter` gets incremented and they
+ * get returned. Once that counter goes over
+ * JOURNAL_MAXIMUM_TIMEOUT_COUNTER, the row is considered done and
+ * an error is logged.
+ *
+ * These changes are made in place: the columns have a fixed size and
+ * are not part of any key. They are saved in the table file but not
+ * in the commit log so on a crash a row may be processed a second time.
+ *
+ * \exception type_mismatch
+ * The table does not use the JOURNAL model.
+ *
+ * \param[in] now_ms  The current time in milliseconds.
+ * \param[in] timeout_ms  How long processing one row is expected to take
+ * at most.
+ *
+ * \return The next row to be processed or nullptr if no rows are due.
+ */
+row::pointer_t table_impl::journal_next(std::uint64_t now_ms, std::uint64_t timeout_ms)
+{
+    schema_secondary_index::pointer_t index(get_journal_index());
+    if(index == nullptr)
+    {
+        throw type_mismatch(
+                  "table \""
+                + name()
+                + "\" is not a journal.");
+    }
 
-                        if(block_level <= 1)
-                        {
-                            break;
-                        }
+    replay_commit_log();
 
-                        parent_tind = top_tind;
+    std::uint32_t const key_size(secondary_key_size(index));
+    cursor_state::scan_position_t scan;
+    scan.f_max_key.resize(key_size, 0xFF);
 
-                        top_tind = std::static_pointer_cast<block_top_indirect_index>(
-                                allocate_new_block(dbtype_t::BLOCK_TYPE_TOP_INDIRECT_INDEX));
-                    }
-                }
+    std::uint32_t priority(0);
+    buffer_t key(key_size, 0);
+    seek_secondary_scan(index, key, false, scan);
 
-                position_oid = save_oid - 1;
-                top_tind->set_reference(position_oid, block->get_offset());
+    // the key is <priority:1> <process date:8> <oid:8>
+    //
+    row::pointer_t result;
+    buffer_t entry_key;
+    set_journaling(true);
+    try
+    {
+        for(;;)
+        {
+            oid_t const oid(next_secondary_oid(scan, false, &entry_key));
+            if(oid == NULL_OID)
+            {
+                break;
+            }
 
-                indr = std::static_pointer_cast<block_indirect_index>(
-                                allocate_new_block(dbtype_t::BLOCK_TYPE_INDIRECT_INDEX));
-                position_oid = save_oid;
-                top_tind->set_reference(position_oid, indr->get_offset());
+            priority = std::max(priority, static_cast<std::uint32_t>(entry_key[0]));
+            size_t pos(sizeof(std::uint8_t));
+            if(read_be_uint64(entry_key, pos) > now_ms)
+            {
+                // nothing is due with this priority, jump to the next one
+                //
+                ++priority;
+                if(priority > std::numeric_limits<std::uint8_t>::max())
+                {
+                    break;
+                }
+                key[0] = static_cast<std::uint8_t>(priority);
+                seek_secondary_scan(index, key, false, scan);
+                continue;
             }
-        }
-    }
 
-    // we always overwrite the _oid, actually the user should never set
-    // this column directly
-    //
-    cell::pointer_t oid_cell(row_data->get_cell("_oid", true));
-    oid_cell->set_oid(oid);
+            row::pointer_t r(get_indirect_row(oid));
+            std::uint8_t timeout_counter(r->get_cell(g_journal_timeout_counter_column, true)->get_uint8());
+            if(r->get_cell(g_journal_status_column, true)->get_uint8() == JOURNAL_STATUS_PROCESSING)
+            {
+                if(r->get_cell(g_journal_start_processing_date_column, true)->get_time_ms() + timeout_ms > now_ms)
+                {
+                    // another process is working on this one
+                    //
+                    continue;
+                }
 
-    block_free_space::pointer_t fspc;
-    reference_t fspc_offset(header->get_blobs_with_free_space());
-    if(fspc_offset == NULL_FILE_ADDR)
-    {
-        // not yet allocated, create a Free Space block
-        //
-        fspc = std::static_pointer_cast<block_free_space>(
-                        allocate_new_block(dbtype_t::BLOCK_TYPE_FREE_SPACE));
+                ++timeout_counter;
+                if(timeout_counter > JOURNAL_MAXIMUM_TIMEOUT_COUNTER)
+                {
+                    SNAP_LOG_ERROR
+                        << "journal \""
+                        << name()
+                        << "\" row "
+                        << oid
+                        << " timed out "
+                        << static_cast<int>(timeout_counter)
+                        << " times; it is now considered done."
+                        << SNAP_LOG_SEND;
+
+                    // removing the entry moves the next one at the current
+                    // position, so we have to search again
+                    //
+                    key = entry_key;
+                    remove_secondary_entry(index, r, oid);
+                    set_journal_state(oid, JOURNAL_STATUS_DONE, now_ms, timeout_counter);
+                    seek_secondary_scan(index, key, false, scan);
+                    key.assign(key_size, 0);
+                    continue;
+                }
+            }
 
-        header->set_blobs_with_free_space(fspc->get_offset());
+            // the row does not follow the changes made in the block,
+            // update its copy of the journal columns too
+            //
+            set_journal_state(oid, JOURNAL_STATUS_PROCESSING, now_ms, timeout_counter);
+            r->get_cell(g_journal_status_column, true)->set_uint8(JOURNAL_STATUS_PROCESSING);
+            r->get_cell(g_journal_start_processing_date_column, true)->set_time_ms(now_ms);
+            r->get_cell(g_journal_timeout_counter_column, true)->set_uint8(timeout_counter);
+            result = r;
+            break;
+        }
     }
-    else
+    catch(...)
     {
-        fspc = std::static_pointer_cast<block_free_space>(get_block(fspc_offset));
-
-        assert(fspc->get_dbtype() == dbtype_t::BLOCK_TYPE_FREE_SPACE);
+        set_journaling(false);
+        throw;
     }
+    set_journaling(false);
 
-    buffer_t const blob(row_data->to_binary());
-
-    free_space_t free_space(fspc->get_free_space(blob.size()));
+    // no row record follows these changes, synchronize their pages now
+    //
+    f_commit_log->sync();
 
-    assert(free_space.f_size >= blob.size());
+    return result;
+}
 
-    memcpy(free_space.f_block->data(free_space.f_reference), blob.data(), blob.size());
-    indr->set_reference(position_oid, free_space.f_reference);
 
-    block_entry_index::pointer_t entry_index(cur->get_state()->get_entry_index());
-    if(entry_index != nullptr)
+/** \brief Mark a journal row as done.
+ *
+ * The row gets removed from the journal index so journal_next() never
+ * returns it again. Its status is set to JOURNAL_STATUS_DONE. The space
+ * used by the row is only reclaimed by journal_reset() which is expected
+ * to be called once the journal is empty.
+ *
+ * \exception type_mismatch
+ * The table does not use the JOURNAL model.
+ *
+ * \param[in] row_data  A row returned by journal_next().
+ *
+ * \return true if the row was still in the journal.
+ */
+bool table_impl::journal_done(row::pointer_t row_data)
+{
+    schema_secondary_index::pointer_t index(get_journal_index());
+    if(index == nullptr)
     {
-        std::uint32_t const position(cur->get_state()->get_entry_index_close_position());
-        conditions const & cond(cur->get_conditions());
-        buffer_t const & key(cond.get_murmur_key());
-        entry_index->add_entry(key, oid, position);
-        return;
+        throw type_mismatch(
+                  "table \""
+                + name()
+                + "\" is not a journal.");
     }
 
-    cursor_state::index_reference_t::vector_t const & index_references(cur->get_state()->get_index_references());
-    if(index_references.empty())
-    {
-        // this happens when we have a brand new table
-        //
-        block_primary_index::pointer_t primary_index(get_primary_index_block(true));
-
-        conditions const & cond(cur->get_conditions());
-        buffer_t const & key(cond.get_murmur_key());
-
-std::cerr << "+++ CREATE A NEW ENTRY INDEX THOUGH... (references is empty)\n";
-        entry_index = std::static_pointer_cast<block_entry_index>(
-                        allocate_new_block(dbtype_t::BLOCK_TYPE_ENTRY_INDEX));
-
-        // a murmur key is 16 bytes
-        //
-        entry_index->set_key_size(16);
+    replay_commit_log();
 
-        entry_index->add_entry(key, oid);
+    cell::pointer_t oid_cell(row_data->get_cell("_oid", false));
+    if(oid_cell == nullptr)
+    {
+        return false;
+    }
+    oid_t const oid(oid_cell->get_oid());
+    std::uint64_t const start_date(row_data->get_cell(g_journal_start_processing_date_column, true)->get_time_ms());
+    std::uint8_t const timeout_counter(row_data->get_cell(g_journal_timeout_counter_column, true)->get_uint8());
 
-// 1583048029
-std::cerr << "set_top_index() -- " << static_cast<int>(key[14]) << " " << static_cast<int>(key[15]) << "\n";
-        primary_index->set_top_index(key, entry_index->get_offset());
+    bool removed(false);
+    set_journaling(true);
+    try
+    {
+        removed = remove_secondary_entry(index, row_data, oid);
+        if(removed)
+        {
+            set_journal_state(oid, JOURNAL_STATUS_DONE, start_date, timeout_counter);
+        }
     }
-    else
+    catch(...)
     {
-throw snapdatabase_not_yet_implemented("table: TODO implement insert close to existing entry");
+        set_journaling(false);
+        throw;
     }
-}
+    set_journaling(false);
 
+    f_commit_log->sync();
 
-void table_impl::row_update(row::pointer_t row_data, cursor::pointer_t cur)
-{
-// 'cur' has the OID which we can use to find the data (we will also save
-// the exact location so we don't have to search again)
-snapdev::NOT_USED(row_data, cur);
+    return removed;
 }
 
 
-block_primary_index::pointer_t table_impl::get_primary_index_block(bool create)
+/** \brief Remove all the rows from a journal.
+ *
+ * A journal is short lived. Instead of deleting rows one by one, the
+ * whole table gets reset once empty: all the blocks except the header
+ * and the schema are freed and the free blocks are removed from the
+ * end of the file. The Bloom Filter gets cleared. Then the table is
+ * as good as new.
+ *
+ * \warning
+ * The cursors of this table must not be used after a call to this
+ * function. Rows are not affected since they hold a copy of their data.
+ *
+ * \exception type_mismatch
+ * The table does not use the JOURNAL model.
+ */
+void table_impl::journal_reset()
 {
-    block_primary_index::pointer_t primary_index;
+    if(get_journal_index() == nullptr)
+    {
+        throw type_mismatch(
+                  "table \""
+                + name()
+                + "\" is not a journal.");
+    }
 
-    file_snap_database_table::pointer_t header(std::static_pointer_cast<file_snap_database_table>(get_block(0)));
-    reference_t const index_block_offset(header->get_primary_index_block());
-    if(index_block_offset == NULL_FILE_ADDR)
+    replay_commit_log();
+
+    size_t const page_size(get_page_size());
+    bool const clear_blocks(!f_dbfile->get_sparse() || is_secure());
+    set_journaling(true);
+    try
     {
-        if(create)
+        file_snap_database_table::pointer_t header(std::static_pointer_cast<file_snap_database_table>(get_block(0)));
+        header->set_indirect_index(NULL_FILE_ADDR);
+        header->set_last_oid(1);
+        header->set_first_free_oid(NULL_OID);
+        header->set_blobs_with_free_space(NULL_FILE_ADDR);
+        header->set_first_compactable_block(NULL_FILE_ADDR);
+        header->set_primary_index_block(NULL_FILE_ADDR);
+        header->set_primary_index_reference_zero(NULL_FILE_ADDR);
+        header->set_expiration_index_block(NULL_FILE_ADDR);
+        header->set_secondary_index_block(NULL_FILE_ADDR);
+        header->set_tree_index_block(NULL_FILE_ADDR);
+        header->set_deleted_rows(NULL_FILE_ADDR);
+
+        for(reference_t offset(page_size); offset < f_dbfile->get_size(); offset += page_size)
         {
-            primary_index = std::static_pointer_cast<block_primary_index>(
-                        allocate_new_block(dbtype_t::BLOCK_TYPE_PRIMARY_INDEX));
+            dbtype_t const type(*reinterpret_cast<dbtype_t const *>(f_dbfile->data(offset)));
+            if(type == dbtype_t::BLOCK_TYPE_FREE_BLOCK
+            || type == dbtype_t::BLOCK_TYPE_SCHEMA
+            || type == dbtype_t::BLOCK_TYPE_SCHEMA_LIST)
+            {
+                continue;
+            }
+            free_block(get_block(offset), clear_blocks);
+        }
 
-            header->set_primary_index_block(primary_index->get_offset());
+        release_tail_blocks();
+
+        file_bloom_filter::pointer_t bloom_filter(get_bloom_filter());
+        if(bloom_filter != nullptr)
+        {
+            bloom_filter->clear();
         }
     }
-    else
+    catch(...)
     {
-        primary_index = std::static_pointer_cast<block_primary_index>(get_block(index_block_offset));
+        set_journaling(false);
+        throw;
     }
+    set_journaling(false);
 
-    return primary_index;
+    f_compact_offset = NULL_FILE_ADDR;
+
+    checkpoint();
 }
 
 
-/** \brief Retrieve the reference to a row.
+/** \brief Initialize the journal columns of a new row.
  *
- * This function searches for a row by OID.
+ * The client defines the `_priority` and `_process_date` columns. If
+ * not defined, they default to 0 and now. The other columns are
+ * managed by the table and always get reset here.
  *
- * \warning
- * This function is considered internal because it does not implement a
- * way to determine whether the OID points to an actual row or was released.
- * The only way to know whether it was released would be to go through the
- * list of OIDs which would be really slow. (TODO: implement such a function
- * for debug purposes)
+ * All the journal columns get defined so they can later be updated
+ * in place (see set_journal_state()).
  *
- * \exception snapdatabase_logic_error
- * The function must be called with a valid OID. If that OID cannot be found
- * in the database, then a logic error is returned. This is because this
- * function is not to be used to dynamically search for a row, which is not
- * currently doable on the indirect index (because some of the entries may
- * be Free OIDs and not existing OIDs). This is also why the row_insert()
- * implements its own search which is capable of properly finding a free
- * spot.
+ * \param[in] row_data  The row being inserted.
+ */
+void table_impl::init_journal_cells(row::pointer_t row_data)
+{
+    if(row_data->get_cell(g_journal_priority_column, false) == nullptr)
+    {
+        row_data->get_cell(g_journal_priority_column, true)->set_uint8(0);
+    }
+    if(row_data->get_cell(g_journal_process_date_column, false) == nullptr)
+    {
+        std::uint64_t const now(std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()).count());
+        row_data->get_cell(g_journal_process_date_column, true)->set_time_ms(now);
+    }
+    row_data->get_cell(g_journal_status_column, true)->set_uint8(JOURNAL_STATUS_WAITING);
+    row_data->get_cell(g_journal_start_processing_date_column, true)->set_time_ms(0);
+    row_data->get_cell(g_journal_timeout_counter_column, true)->set_uint8(0);
+}
+
+
+/** \brief Update the processing state of a journal row in place.
  *
- * \param[in] oid  The OID of an existing row.
+ * The `_status`, `_start_processing_date`, and `_timeout_counter`
+ * columns have a fixed size. Changing them does not change the size of
+ * the row so we directly overwrite their value in the `DATA` block
+ * instead of rewriting the whole row.
  *
- * \return The reference to a row or NULL_FILE_ADDR.
+ * \param[in] oid  The OID of the row to update.
+ * \param[in] status  The new status.
+ * \param[in] start_date  The new start processing date in milliseconds.
+ * \param[in] timeout_counter  The new timeout counter.
  */
-reference_t table_impl::get_indirect_reference(oid_t oid)
+void table_impl::set_journal_state(
+          oid_t oid
+        , std::uint8_t status
+        , std::uint64_t start_date
+        , std::uint8_t timeout_counter)
 {
-    // search for a row using its OID
-    //
-    // TODO: we probably want to keep track of all the blocks we handle here
-    //       so the insert and update functions can make use of them; right
-    //       now each OID accessor is optimized but that means we end up doing
-    //       the search multiple times
+    column_id_t const status_id(f_schema_table->column(g_journal_status_column)->column_id());
+    column_id_t const start_date_id(f_schema_table->column(g_journal_start_processing_date_column)->column_id());
+    column_id_t const timeout_counter_id(f_schema_table->column(g_journal_timeout_counter_column)->column_id());
+
+    reference_t const row_reference(get_indirect_reference(oid));
+    block::pointer_t data(get_block(row_reference));
+    data_t ptr(data->data(row_reference));
+    std::uint32_t const size(block_free_space::get_data_size(ptr));
+
+    size_t pos(sizeof(std::uint32_t));      // skip version
+    while(pos + sizeof(std::uint16_t) <= size)
+    {
+        column_id_t const id(static_cast<column_id_t>(read_be_uint16(ptr, pos)));
+        if(id == 0)
+        {
+            break;
+        }
+
+        schema_column::pointer_t column(f_schema_table->column(id));
+        if(column == nullptr)
+        {
+            throw column_not_found(
+                      "Column with identifier "
+                    + std::to_string(static_cast<int>(id))
+                    + " does not exist in \""
+                    + name()
+                    + "\" (set_journal_state).");
+        }
+
+        if(id == status_id)
+        {
+            ptr[pos] = status;
+        }
+        else if(id == timeout_counter_id)
+        {
+            ptr[pos] = timeout_counter;
+        }
+        else if(id == start_date_id)
+        {
+            buffer_t value;
+            push_be_uint64(value, start_date);
+            memcpy(ptr + pos, value.data(), value.size());
+        }
+
+        pos += cell::value_binary_size(column->type(), ptr + pos);
+    }
+}
+
+
+change_type_t table_impl::row_apply(row::pointer_t row_data, commit_mode_t mode)
+{
+    conditions cond;
+    cond.set_columns({"_oid"});
+    cond.set_key("primary", row_data, row::pointer_t());
+    cursor::pointer_t cur(f_table->row_select(cond));
+
+    row::pointer_t r(cur->next_row());
+    if(r == nullptr)
+    {
+        if(mode == commit_mode_t::COMMIT_MODE_UPDATE)
+        {
+            throw row_not_found(
+                      "Row with key \""
+                    + std::string("...")
+                    + "\" was not found so it can't be updated.");
+        }
+
+        row_insert(row_data, cur);
+        return change_type_t::CHANGE_TYPE_INSERT;
+    }
+    else
+    {
+        if(mode == commit_mode_t::COMMIT_MODE_INSERT)
+        {
+            throw row_already_exists(
+                      "Row with key \""
+                    + std::string("...")
+                    + "\" already exists so it can't be inserted.");
+        }
+
+        if(!row_update(row_data, r))
+        {
+            return change_type_t::CHANGE_TYPE_NONE;
+        }
+        return change_type_t::CHANGE_TYPE_UPDATE;
+    }
+}
+
+
+/** \brief Insert a new row.
+ *
+ * This is an internal function which the table_impl uses to insert a new
+ * row.
+ *
+ * \note
+ * The row_commit() is called first and determines whether to call
+ * insert or update or generate an error.
+ *
+ * \param[in] row_data  The row to be inserted.
+ */
+void table_impl::row_insert(row::pointer_t row_data, cursor::pointer_t cur)
+{
+    // if inserting, we first need to allocation this row's OID
     //
     file_snap_database_table::pointer_t header(std::static_pointer_cast<file_snap_database_table>(get_block(0)));
+    oid_t oid(header->get_first_free_oid());
+    bool const must_exist(oid != NULL_OID);
+    if(!must_exist)
+    {
+        // no free OID, generate a new one
+        //
+        oid = header->get_last_oid();
+        header->set_last_oid(oid + 1);
+    }
+
+    // found a free OID, go to it in the indirect table and replace
+    // the first free OID with the one in that table (i.e. unlink
+    // `oid` from the list)
+    //
+    oid_t position_oid(oid);
+    oid_t parent_oid(oid);
+    block_indirect_index::pointer_t indr;
     reference_t offset(header->get_indirect_index());
     if(offset == NULL_FILE_ADDR)
     {
-        throw snapdatabase_logic_error("somehow the get_indirect_reference() was called when no row exists.");
+        // the very first time we'll hit a null
+        //
+        if(oid != 1)
+        {
+            throw snapdatabase_logic_error("the indirect index offset is null but the first OID is not 1.");
+        }
+        indr = std::static_pointer_cast<block_indirect_index>(
+                        allocate_new_block(dbtype_t::BLOCK_TYPE_INDIRECT_INDEX));
+
+        header->set_indirect_index(indr->get_offset());
+    }
+    else
+    {
+        block_top_indirect_index::pointer_t parent_tind;
+        reference_t parent_offset(offset);
+        block::pointer_t block(get_block(offset));
+        while(block->get_dbtype() == dbtype_t::BLOCK_TYPE_TOP_INDIRECT_INDEX)
+        {
+            block_top_indirect_index::pointer_t tind(std::static_pointer_cast<block_top_indirect_index>(block));
+            oid_t const save_oid(position_oid);
+            offset = tind->get_reference(position_oid, must_exist);
+            if(offset == NULL_FILE_ADDR)
+            {
+                // no child exists yet, create an INDR
+                //
+                indr = std::static_pointer_cast<block_indirect_index>(
+                                allocate_new_block(dbtype_t::BLOCK_TYPE_INDIRECT_INDEX));
+                position_oid = save_oid;
+                tind->set_reference(position_oid, indr->get_offset());
+                break;
+            }
+
+            if(offset == MISSING_FILE_ADDR)
+            {
+                if(tind->get_block_level() >= 255)
+                {
+                    throw out_of_bounds("too many block levels.");
+                }
+
+                block_top_indirect_index::pointer_t top_tind(
+                            std::static_pointer_cast<block_top_indirect_index>(
+                                allocate_new_block(dbtype_t::BLOCK_TYPE_TOP_INDIRECT_INDEX)));
+                top_tind->set_block_level(tind->get_block_level() + 1);
+
+                if(parent_tind != nullptr)
+                {
+                    // we overflowed an intermediate entry we have to
+                    // add an intermediate (the `top_tind` is actually
+                    // an intermediate) so we need to add a link in the
+                    // parent to this new `TIND`
+                    //
+                    position_oid = parent_oid;
+                    parent_tind->set_reference(position_oid, parent_offset);
+                }
+                else
+                {
+                    header->set_indirect_index(top_tind->get_offset());
+                }
+
+                position_oid = save_oid - 1;
+                top_tind->set_reference(position_oid, tind->get_offset());
+
+                indr = std::static_pointer_cast<block_indirect_index>(
+                                allocate_new_block(dbtype_t::BLOCK_TYPE_INDIRECT_INDEX));
+                position_oid = save_oid;
+                top_tind->set_reference(position_oid, indr->get_offset());
+                break;
+            }
+
+            parent_tind = tind;
+            parent_offset = offset;
+            parent_oid = save_oid;
+            block = get_block(parent_offset);
+        }
+
+        if(indr == nullptr)
+        {
+            if(block->get_dbtype() != dbtype_t::BLOCK_TYPE_INDIRECT_INDEX)
+            {
+                throw type_mismatch(
+                          "expected block of type INDIRECT INDEX (INDR) (got \""
+                        + to_string(block->get_dbtype())
+                        + "\" instead).");
+            }
+            indr = std::static_pointer_cast<block_indirect_index>(block);
+            if(position_oid > indr->get_max_count())
+            {
+                oid_t const save_oid(position_oid);
+
+                // that `INDR` is full, create a new top `TIND`
+                //
+                block_top_indirect_index::pointer_t top_tind(
+                            std::static_pointer_cast<block_top_indirect_index>(
+                                allocate_new_block(dbtype_t::BLOCK_TYPE_TOP_INDIRECT_INDEX)));
+                if(parent_tind == nullptr)
+                {
+                    top_tind->set_block_level(1);
+
+                    header->set_indirect_index(top_tind->get_offset());
+                }
+                else
+                {
+                    std::uint8_t block_level(parent_tind->get_block_level());
+                    if(block_level <= 1)
+                    {
+                        throw snapdatabase_logic_error(
+                                  "parent_tind block level is "
+                                + std::to_string(static_cast<int>(parent_tind->get_block_level()))
+                                + " which is not valid here, it is expected to be at least 2.");
+                    }
+
+                    // we may have many levels, we need to create them all
+                    // in this case (we may later ameliorate our algorithm
+                    // to avoid this early cascade...)
+                    //
+                    position_oid = parent_oid;
+                    for(;;)
+                    {
+                        --block_level;
+                        top_tind->set_block_level(block_level);
+
+                        parent_tind->set_reference(position_oid, top_tind->get_offset());
+
+                        if(block_level <= 1)
+                        {
+                            break;
+                        }
+
+                        parent_tind = top_tind;
+
+                        top_tind = std::static_pointer_cast<block_top_indirect_index>(
+                                allocate_new_block(dbtype_t::BLOCK_TYPE_TOP_INDIRECT_INDEX));
+                    }
+                }
+
+                position_oid = save_oid - 1;
+                top_tind->set_reference(position_oid, block->get_offset());
+
+                indr = std::static_pointer_cast<block_indirect_index>(
+                                allocate_new_block(dbtype_t::BLOCK_TYPE_INDIRECT_INDEX));
+                position_oid = save_oid;
+                top_tind->set_reference(position_oid, indr->get_offset());
+            }
+        }
+    }
+
+    // we always overwrite the _oid, actually the user should never set
+    // this column directly
+    //
+    cell::pointer_t oid_cell(row_data->get_cell("_oid", true));
+    oid_cell->set_oid(oid);
+
+    block_free_space::pointer_t fspc;
+    reference_t fspc_offset(header->get_blobs_with_free_space());
+    if(fspc_offset == NULL_FILE_ADDR)
+    {
+        // not yet allocated, create a Free Space block
+        //
+        fspc = std::static_pointer_cast<block_free_space>(
+                        allocate_new_block(dbtype_t::BLOCK_TYPE_FREE_SPACE));
+
+        header->set_blobs_with_free_space(fspc->get_offset());
+    }
+    else
+    {
+        fspc = std::static_pointer_cast<block_free_space>(get_block(fspc_offset));
+
+        assert(fspc->get_dbtype() == dbtype_t::BLOCK_TYPE_FREE_SPACE);
+    }
+
+    if(f_schema_table->model() == model_t::TABLE_MODEL_JOURNAL)
+    {
+        init_journal_cells(row_data);
+    }
+
+    buffer_t const blob(row_data->to_binary());
+
+    free_space_t free_space(fspc->get_free_space(blob.size()));
+
+    assert(free_space.f_size >= blob.size());
+
+    data_t const ptr(free_space.f_block->data(free_space.f_reference));
+    memcpy(ptr, blob.data(), blob.size());
+
+    // the space may be a little larger, the padding must be zeroes since
+    // a column identifier of 0 marks the end of the row
+    //
+    memset(ptr + blob.size(), 0, block_free_space::get_data_size(ptr) - blob.size());
+    indr->set_reference(position_oid, free_space.f_reference);
+
+    // add the row to the secondary indexes
+    //
+    for(auto const & index : f_schema_table->secondary_indexes())
+    {
+        add_secondary_entry(index.second, row_data, oid);
+    }
+    schema_secondary_index::pointer_t expiration_index(get_expiration_index());
+    if(expiration_index != nullptr)
+    {
+        add_secondary_entry(expiration_index, row_data, oid);
+    }
+    schema_secondary_index::pointer_t journal_index(get_journal_index());
+    if(journal_index != nullptr)
+    {
+        add_secondary_entry(journal_index, row_data, oid);
+    }
+
+    conditions const & cond(cur->get_conditions());
+    buffer_t const & key(cond.get_murmur_key());
+
+    file_bloom_filter::pointer_t bloom_filter(get_bloom_filter());
+    if(bloom_filter != nullptr)
+    {
+        bloom_filter->add(key);
+    }
+
+    if(cur->get_state()->get_bloom_filter_miss())
+    {
+        // the select did not search the index, we need the position now
+        //
+        snapdev::NOT_USED(find_primary_entry(key, cur->get_state()));
+    }
+
+    // when the `EIDX` is directly referenced by the `PIDX` and it has
+    // room for one more entry, the select already found the position
+    //
+    block_entry_index::pointer_t entry_index(cur->get_state()->get_entry_index());
+    if(entry_index != nullptr
+    && cur->get_state()->get_index_references().empty()
+    && entry_index->get_count() < entry_index->get_max_count())
+    {
+        std::uint32_t const position(cur->get_state()->get_entry_index_close_position());
+        entry_index->add_entry(key, oid, position);
+        return;
+    }
+
+    block_primary_index::pointer_t primary_index(get_primary_index_block(true));
+    reference_t const top_index(primary_index->get_top_index(key));
+    if(top_index == NULL_FILE_ADDR)
+    {
+        // first row with this part of the key
+        //
+        entry_index = std::static_pointer_cast<block_entry_index>(
+                        allocate_new_block(dbtype_t::BLOCK_TYPE_ENTRY_INDEX));
+
+        // a murmur key is 16 bytes
+        //
+        entry_index->set_key_size(16);
+
+        entry_index->add_entry(key, oid);
+        primary_index->set_top_index(key, entry_index->get_offset());
+        return;
+    }
+
+    std::vector<block_top_index::pointer_t> path;
+    entry_index = find_insert_entry_index("primary", top_index, key, path);
+    snapdev::NOT_USED(entry_index->find_entry(key));
+    reference_t const root(add_index_entry(entry_index, path, key, oid));
+    if(root != NULL_FILE_ADDR)
+    {
+        primary_index->set_top_index(key, root);
+    }
+}
+
+
+/** \brief Update an existing row.
+ *
+ * The new row replaces the existing row. It keeps the OID and the
+ * creation date of the existing row. The primary key does not change
+ * so the primary index and the Bloom Filter are not affected.
+ *
+ * The secondary, expiration, and journal indexes get updated when the
+ * key of the row changes for that index. Updating a journal row
+ * schedules it again (i.e. its status is reset to waiting).
+ *
+ * If the new row fits in the space of the existing row, it gets
+ * written in place. Otherwise, new space gets allocated, the indirect
+ * index is updated, and the old space gets released.
+ *
+ * \param[in] row_data  The new version of the row.
+ * \param[in] existing_row  The row found with the same primary key.
+ *
+ * \return false if the new row is the same as the existing row, in
+ * which case nothing gets written.
+ */
+bool table_impl::row_update(row::pointer_t row_data, row::pointer_t existing_row)
+{
+    oid_t const oid(existing_row->get_cell("_oid", true)->get_oid());
+    row_data->get_cell("_oid", true)->set_oid(oid);
+
+    oid_t position_oid(oid);
+    block_indirect_index::pointer_t indr(find_indirect_index(position_oid));
+    oid_t reference_oid(position_oid);
+    reference_t const old_reference(indr->get_reference(reference_oid, true));
+    row::pointer_t old_row(get_row(old_reference));
+
+    cell::pointer_t created_on(old_row->get_cell("_created_on", false));
+    if(created_on != nullptr)
+    {
+        row_data->get_cell("_created_on", true)->set_time_us(created_on->get_time_us());
+    }
+
+    if(f_schema_table->model() == model_t::TABLE_MODEL_JOURNAL)
+    {
+        init_journal_cells(row_data);
+    }
+
+    // the space of a row is padded with zeroes and a column identifier
+    // of 0 marks the end of the row
+    //
+    buffer_t const blob(row_data->to_binary());
+    block_data::pointer_t old_data(std::static_pointer_cast<block_data>(get_block(old_reference)));
+    data_t const old_ptr(old_data->data(old_reference));
+    std::uint32_t const old_size(block_free_space::get_data_size(old_ptr));
+    if(blob.size() <= old_size
+    && memcmp(old_ptr, blob.data(), blob.size()) == 0
+    && (old_size - blob.size() < sizeof(std::uint16_t)
+        || (old_ptr[blob.size()] == 0 && old_ptr[blob.size() + 1] == 0)))
+    {
+        return false;
+    }
+
+    auto update_index = [&](schema_secondary_index::pointer_t index)
+    {
+        buffer_t old_key;
+        buffer_t new_key;
+        std::size_t const old_count(old_row->generate_secondary_key(index, old_key));
+        std::size_t const new_count(row_data->generate_secondary_key(index, new_key));
+        if(old_count == new_count
+        && old_key == new_key)
+        {
+            return;
+        }
+        remove_secondary_entry(index, old_row, oid);
+        add_secondary_entry(index, row_data, oid);
+    };
+    for(auto const & index : f_schema_table->secondary_indexes())
+    {
+        update_index(index.second);
+    }
+    schema_secondary_index::pointer_t expiration_index(get_expiration_index());
+    if(expiration_index != nullptr)
+    {
+        update_index(expiration_index);
+    }
+    schema_secondary_index::pointer_t journal_index(get_journal_index());
+    if(journal_index != nullptr)
+    {
+        update_index(journal_index);
+    }
+
+    if(blob.size() <= old_size)
+    {
+        memcpy(old_ptr, blob.data(), blob.size());
+        memset(old_ptr + blob.size(), 0, old_size - blob.size());
+        return true;
+    }
+
+    file_snap_database_table::pointer_t header(std::static_pointer_cast<file_snap_database_table>(get_block(0)));
+    block_free_space::pointer_t fspc(std::static_pointer_cast<block_free_space>(get_block(header->get_blobs_with_free_space())));
+    free_space_t free_space(fspc->get_free_space(blob.size()));
+
+    data_t const ptr(free_space.f_block->data(free_space.f_reference));
+    memcpy(ptr, blob.data(), blob.size());
+    memset(ptr + blob.size(), 0, block_free_space::get_data_size(ptr) - blob.size());
+    indr->set_reference(position_oid, free_space.f_reference);
+
+    fspc->release_space(old_reference);
+
+    return true;
+}
+
+
+block_primary_index::pointer_t table_impl::get_primary_index_block(bool create)
+{
+    block_primary_index::pointer_t primary_index;
+
+    file_snap_database_table::pointer_t header(std::static_pointer_cast<file_snap_database_table>(get_block(0)));
+    reference_t const index_block_offset(header->get_primary_index_block());
+    if(index_block_offset == NULL_FILE_ADDR)
+    {
+        if(create)
+        {
+            primary_index = std::static_pointer_cast<block_primary_index>(
+                        allocate_new_block(dbtype_t::BLOCK_TYPE_PRIMARY_INDEX));
+
+            header->set_primary_index_block(primary_index->get_offset());
+        }
+    }
+    else
+    {
+        primary_index = std::static_pointer_cast<block_primary_index>(get_block(index_block_offset));
+    }
+
+    return primary_index;
+}
+
+
+/** \brief Search the `INDR` block holding the reference of an OID.
+ *
+ * This function goes through the `TIND` blocks, if any, to find the
+ * `INDR` block which holds the reference to the row with \p oid.
+ *
+ * \param[in,out] oid  The OID to search, on return the position in the
+ * returned block.
+ *
+ * \return The `INDR` block holding the reference.
+ */
+block_indirect_index::pointer_t table_impl::find_indirect_index(oid_t & oid)
+{
+    // search for a row using its OID
+    //
+    // TODO: we probably want to keep track of all the blocks we handle here
+    //       so the insert and update functions can make use of them; right
+    //       now each OID accessor is optimized but that means we end up doing
+    //       the search multiple times
+    //
+    file_snap_database_table::pointer_t header(std::static_pointer_cast<file_snap_database_table>(get_block(0)));
+    reference_t offset(header->get_indirect_index());
+    if(offset == NULL_FILE_ADDR)
+    {
+        throw snapdatabase_logic_error("somehow the get_indirect_reference() was called when no row exists.");
+    }
+
+    block::pointer_t block;
+    for(;;)
+    {
+        block = get_block(offset);
+        if(block->get_dbtype() != dbtype_t::BLOCK_TYPE_TOP_INDIRECT_INDEX)
+        {
+            break;
+        }
+        block_top_indirect_index::pointer_t tind(std::static_pointer_cast<block_top_indirect_index>(block));
+        offset = tind->get_reference(oid, true);
+        if(offset == NULL_FILE_ADDR)
+        {
+            throw snapdatabase_logic_error("somehow the get_indirect_reference() was called with a still unused OID.");
+        }
+    }
+
+    if(block->get_dbtype() != dbtype_t::BLOCK_TYPE_INDIRECT_INDEX)
+    {
+        throw type_mismatch(
+                  "expected block of type INDIRECT INDEX (INDR), got \""
+                + to_string(block->get_dbtype())
+                + "\" instead.");
+    }
+
+    return std::static_pointer_cast<block_indirect_index>(block);
+}
+
+
+/** \brief Retrieve the reference to a row.
+ *
+ * This function searches for a row by OID.
+ *
+ * \warning
+ * This function is considered internal because it does not implement a
+ * way to determine whether the OID points to an actual row or was released.
+ * The only way to know whether it was released would be to go through the
+ * list of OIDs which would be really slow. (TODO: implement such a function
+ * for debug purposes)
+ *
+ * \exception snapdatabase_logic_error
+ * The function must be called with a valid OID. If that OID cannot be found
+ * in the database, then a logic error is returned. This is because this
+ * function is not to be used to dynamically search for a row, which is not
+ * currently doable on the indirect index (because some of the entries may
+ * be Free OIDs and not existing OIDs). This is also why the row_insert()
+ * implements its own search which is capable of properly finding a free
+ * spot.
+ *
+ * \param[in] oid  The OID of an existing row.
+ *
+ * \return The reference to a row or NULL_FILE_ADDR.
+ */
+reference_t table_impl::get_indirect_reference(oid_t oid)
+{
+    block_indirect_index::pointer_t indr(find_indirect_index(oid));
+    return indr->get_reference(oid, true);
+}
+
+
+/** \brief Update the indirect index after a row moved.
+ *
+ * The compaction process moves rows within their `DATA` block. This
+ * function is called each time a row moves. It reads the OID of the
+ * row and saves the new reference in the indirect index.
+ *
+ * \exception snapdatabase_logic_error
+ * The row has no OID or the indirect index does not point to the old
+ * location of the row.
+ *
+ * \param[in] old_reference  The reference to the row before it moved.
+ * \param[in] new_reference  The reference to the row now.
+ */
+void table_impl::move_row(reference_t old_reference, reference_t new_reference)
+{
+    row::pointer_t r(get_row(new_reference));
+    cell::pointer_t oid_cell(r->get_cell("_oid", false));
+    if(oid_cell == nullptr)
+    {
+        throw snapdatabase_logic_error(
+                  "row at "
+                + std::to_string(new_reference)
+                + " has no \"_oid\" so it can't be moved.");
+    }
+
+    oid_t position_oid(oid_cell->get_oid());
+    block_indirect_index::pointer_t indr(find_indirect_index(position_oid));
+    oid_t check_oid(position_oid);
+    if(indr->get_reference(check_oid, true) != old_reference)
+    {
+        throw snapdatabase_logic_error(
+                  "the indirect index of OID "
+                + std::to_string(oid_cell->get_oid())
+                + " does not point to the row being moved.");
+    }
+    indr->set_reference(position_oid, new_reference);
+}
+
+
+row::pointer_t table_impl::get_indirect_row(oid_t oid)
+{
+    return get_row(get_indirect_reference(oid));
+}
+
+
+row::pointer_t table_impl::get_row(reference_t row_reference)
+{
+    block_data::pointer_t data(std::static_pointer_cast<block_data>(get_block(row_reference)));
+
+    // reading the row does not modify the block, use the const data() so
+    // the page does not get journaled
+    //
+    const_data_t ptr(static_cast<block_data const &>(*data).data(row_reference));
+    std::uint32_t const size(block_free_space::get_data_size(ptr));
+    row::pointer_t row(std::make_shared<row>(f_table->get_pointer()));
+
+    // the cells get decoded only when accessed and reference the block
+    // directly until it gets modified
+    //
+    row->from_binary(data->create_view(row_reference, size));
+
+    return row;
+}
+
+
+/** \brief Get the block cache counters.
+ *
+ * The hits and misses tell how well the cache budget (the
+ * `block_cache_size` parameter) fits the working set of this table.
+ *
+ * \return A copy of the current statistics.
+ */
+block_cache::statistics_t table_impl::get_cache_statistics() const
+{
+    return f_blocks->get_statistics();
+}
+
+
+change_feed::pointer_t table_impl::get_change_feed() const
+{
+    return f_change_feed;
+}
+
+
+void table_impl::read_rows(cursor_data & data)
+{
+    switch(data.f_state->get_index_type())
+    {
+    case index_type_t::INDEX_TYPE_SECONDARY:
+        read_secondary(data);
+        break;
+
+    case index_type_t::INDEX_TYPE_INDIRECT:
+        read_indirect(data);
+        break;
+
+    case index_type_t::INDEX_TYPE_PRIMARY:
+        read_primary(data);
+        break;
+
+    case index_type_t::INDEX_TYPE_EXPIRATION:
+        read_expiration(data);
+        break;
+
+    case index_type_t::INDEX_TYPE_JOURNAL:
+        read_journal(data);
+        break;
+
+    case index_type_t::INDEX_TYPE_TREE:
+        read_tree(data);
+        break;
+
+    default:
+        throw snapdatabase_logic_error("unexpected index type in read_rows().");
+
+    }
+}
+
+
+void table_impl::read_secondary(cursor_data & data)
+{
+    read_secondary_index(data, data.f_state->get_secondary_index());
+}
+
+
+/** \brief Read the rows in the order of their OID.
+ *
+ * The indirect index is a direct mapping of OIDs to rows. This function
+ * returns the rows in that order. The `_oid` column of the min/max keys
+ * can be used to limit the range of OIDs to return.
+ *
+ * Since the position of the cursor maps directly to an OID, we do not
+ * need to save a state to continue the scan.
+ *
+ * \todo
+ * Skip OIDs which were freed once deleting rows is supported.
+ *
+ * \param[in] data  The cursor data where the rows get saved.
+ */
+void table_impl::read_indirect(cursor_data & data)
+{
+    file_snap_database_table::pointer_t header(std::static_pointer_cast<file_snap_database_table>(get_block(0)));
+    reference_t tref(header->get_indirect_index());
+    if(tref == NULL_FILE_ADDR)
+    {
+        // we have nothing here
+        // (happens until we do some commit)
+        //
+        return;
+    }
+
+    conditions const & cond(data.f_cursor->get_conditions());
+
+    oid_t min_oid(1);
+    oid_t max_oid(header->get_last_oid() - 1);
+    row::pointer_t min_key(cond.get_min_key());
+    if(min_key != nullptr)
+    {
+        cell::pointer_t c(min_key->get_cell("_oid", false));
+        if(c != nullptr)
+        {
+            min_oid = std::max(min_oid, static_cast<oid_t>(c->get_oid()));
+        }
+    }
+    row::pointer_t max_key(cond.get_max_key());
+    if(max_key != nullptr)
+    {
+        cell::pointer_t c(max_key->get_cell("_oid", false));
+        if(c != nullptr)
+        {
+            max_oid = std::min(max_oid, static_cast<oid_t>(c->get_oid()));
+        }
+    }
+    if(min_oid > max_oid)
+    {
+        return;
+    }
+
+    bool const reverse(cond.get_reverse());
+    count_t const limit(cond.get_limit());
+    count_t const count(cond.get_count());
+    size_t const position(data.f_cursor->get_position());
+    for(count_t idx(0); count == CURSOR_NO_LIMIT || idx < count; ++idx)
+    {
+        if(limit != CURSOR_NO_LIMIT
+        && position + idx >= limit)
+        {
+            break;
+        }
+
+        oid_t const delta(cond.get_offset() + position + idx);
+        if(delta > max_oid - min_oid)
+        {
+            break;
+        }
+
+        oid_t const oid(reverse ? max_oid - delta : min_oid + delta);
+        reference_t const row_reference(get_indirect_reference(oid));
+        if(row_reference != NULL_FILE_ADDR)
+        {
+            data.f_rows.push_back(get_row(row_reference));
+        }
+    }
+}
+
+
+void table_impl::read_primary(cursor_data & data)
+{
+    // the primary index has a single position at position 0
+    //
+    if(data.f_cursor->get_position() > 0)
+    {
+        return;
+    }
+
+    // the primary key is "special" in that we get the content of the
+    // columns and then calculate the murmur value; the murmur is what's
+    // used as the key, not the content of the columns
+    //
+    conditions const & cond(data.f_cursor->get_conditions());
+    buffer_t const & key(cond.get_murmur_key());
+
+    // if the Bloom Filter says the key is not present, it's 100% sure
+    // so we can avoid loading any of the index blocks
+    //
+    file_bloom_filter::pointer_t bloom_filter(get_bloom_filter());
+    if(bloom_filter != nullptr
+    && !bloom_filter->contains(key))
+    {
+        data.f_state->set_bloom_filter_miss(true);
+        return;
+    }
+
+    oid_t const oid(find_primary_entry(key, data.f_state));
+    if(oid == NULL_FILE_ADDR)
+    {
+        return;
+    }
+
+    row::pointer_t r(get_indirect_row(oid));
+    data.f_rows.push_back(r);
+}
+
+
+/** \brief Search the primary index for \p key.
+ *
+ * This function goes through the `PIDX`, the `TIDX` and finally the
+ * `EIDX` blocks to find the OID of the row with \p key.
+ *
+ * The \p state is updated with the index references, the entry index
+ * and the close position within that entry index so that way an insert
+ * can happen without having to search again.
+ *
+ * \param[in] key  The murmur key of the row to search.
+ * \param[in] state  The state of the cursor to update.
+ *
+ * \return The OID of the row or NULL_FILE_ADDR if not found.
+ */
+oid_t table_impl::find_primary_entry(buffer_t const & key, cursor_state::pointer_t state)
+{
+    state->set_bloom_filter_miss(false);
+
+    block_primary_index::pointer_t primary_index(get_primary_index_block(false));
+    if(primary_index == nullptr)
+    {
+        // we have nothing here
+        // (happens until we do some commit)
+        //
+        return NULL_FILE_ADDR;
+    }
+
+    // we may have one `PIDX`
+    //
+    // TODO: consider making the primary index optional
+    //
+    reference_t ref(primary_index->get_top_index(key));
+    if(ref == NULL_FILE_ADDR)
+    {
+        // no such entry, "SELECT" returns an empty list
+        //
+        return NULL_FILE_ADDR;
+    }
+    block::pointer_t block(get_block(ref));
+
+    // we can have any number of `TIDX` or directly an `EIDX`
+    //
+    while(block->get_dbtype() == dbtype_t::BLOCK_TYPE_TOP_INDEX)
+    {
+        // we have a top index
+        //
+        block_top_index::pointer_t top_index(std::static_pointer_cast<block_top_index>(block));
+        ref = top_index->find_child(key);
+        cursor_state::index_reference_t idx_ref = {
+              ref
+            , top_index->get_position()
+        };
+        state->add_index_reference(idx_ref);
+        if(ref == NULL_FILE_ADDR)
+        {
+            // no such entry, "SELECT" returns an empty list
+            //
+            return NULL_FILE_ADDR;
+        }
+        block = get_block(ref);
+    }
+
+    if(block->get_dbtype() != dbtype_t::BLOCK_TYPE_ENTRY_INDEX)
+    {
+        throw type_mismatch(
+                  "Found unexpected block of type \""
+                + to_string(block->get_dbtype())
+                + "\". Expected an  \""
+                + to_string(dbtype_t::BLOCK_TYPE_ENTRY_INDEX)
+                + "\".");
+    }
+
+    block_entry_index::pointer_t entry_index(std::static_pointer_cast<block_entry_index>(block));
+    state->set_entry_index(entry_index);
+
+    oid_t const oid(entry_index->find_entry(key));
+    state->set_entry_index_close_position(entry_index->get_position());
+
+    return oid;
+}
+
+
+/** \brief Get the Bloom Filter of this table.
+ *
+ * The Bloom Filter is saved in a separate file named `bloom_filter`.
+ * It gets created along the table: if the table was created before
+ * we had support for the Bloom Filter and it already has rows, then
+ * no filter gets created since it would return false negatives.
+ *
+ * The size of the filter is calculated from the `<expected-rows>`
+ * parameter of the table.
+ *
+ * \return The Bloom Filter or nullptr if this table does not use one.
+ */
+file_bloom_filter::pointer_t table_impl::get_bloom_filter()
+{
+    if(f_bloom_filter_checked)
+    {
+        return f_bloom_filter;
+    }
+    f_bloom_filter_checked = true;
+
+    file_snap_database_table::pointer_t header(std::static_pointer_cast<file_snap_database_table>(get_block(0)));
+    bloom_filter_algorithm_t algorithm(header->get_bloom_filter_algorithm());
+    bool const create(algorithm == bloom_filter_algorithm_t::BLOOM_FILTER_ALGORITHM_NONE);
+    if(create)
+    {
+        if(header->get_last_oid() != 1)
+        {
+            // the table already has rows, we can't use a new filter
+            // (TODO: implement the regeneration of the filter)
+            //
+            return f_bloom_filter;
+        }
+
+        // by default we use counters so we can delete rows
+        //
+        algorithm = bloom_filter_algorithm_t::BLOOM_FILTER_ALGORITHM_ONE_COUNTERS;
+    }
+
+    size_t const page_size(get_page_size());
+    f_bloom_filter_file = std::make_shared<dbfile>(f_context->get_path(), name(), "bloom_filter");
+    f_bloom_filter_file->set_page_size(page_size);
+    f_bloom_filter_file->set_type(dbtype_t::FILE_TYPE_BLOOM_FILTER);
+    f_bloom_filter_file->set_table(f_table->get_pointer());
+    if(create)
+    {
+        f_bloom_filter_file->grow(file_bloom_filter::file_size(
+                                  f_schema_table->expected_rows()
+                                , algorithm
+                                , page_size));
+    }
+    else
+    {
+        // this opens the file without changing its size
+        //
+        f_bloom_filter_file->grow(0);
+        if(f_bloom_filter_file->get_size() < page_size)
+        {
+            SNAP_LOG_WARNING
+                << "the Bloom Filter file of table \""
+                << name()
+                << "\" is missing; the filter is ignored."
+                << SNAP_LOG_SEND;
+            f_bloom_filter_file.reset();
+            return f_bloom_filter;
+        }
+    }
+
+    // the pages of the filter are journaled along the table pages
+    //
+    if(f_commit_log == nullptr)
+    {
+        open_commit_log();
+    }
+    f_bloom_filter_file->set_commit_log(f_commit_log, g_bloom_filter_file_id);
+
+    file_bloom_filter::pointer_t bloom_filter(std::make_shared<file_bloom_filter>(f_bloom_filter_file, 0));
+    bloom_filter->set_table(f_table->get_pointer());
+    bloom_filter->set_data(f_bloom_filter_file->data(0));
+    bloom_filter->get_structure()->set_block(bloom_filter, 0, page_size);
+
+    if(create)
+    {
+        bloom_filter->set_dbtype(dbtype_t::FILE_TYPE_BLOOM_FILTER);
+        bloom_filter->set_structure_version();
+        bloom_filter->initialize(f_schema_table->expected_rows(), algorithm);
+        bloom_filter->sync(true);
+
+        header->set_bloom_filter_algorithm(algorithm);
+        header->sync(true);
+    }
+    else if(bloom_filter->get_dbtype() != dbtype_t::FILE_TYPE_BLOOM_FILTER)
+    {
+        throw type_mismatch(
+                  "expected the Bloom Filter file to start with a \""
+                + to_string(dbtype_t::FILE_TYPE_BLOOM_FILTER)
+                + "\" block, found \""
+                + to_string(bloom_filter->get_dbtype())
+                + "\" instead.");
+    }
+
+    f_bloom_filter = bloom_filter;
+    return f_bloom_filter;
+}
+
+
+/** \brief Read the rows sorted by expiration date.
+ *
+ * The expiration index is a secondary index on the `expiration_date`
+ * column. It is maintained by the system when the table has such a
+ * column. The min/max keys are expected to define that column.
+ *
+ * \param[in] data  The cursor data where the rows get saved.
+ */
+void table_impl::read_expiration(cursor_data & data)
+{
+    schema_secondary_index::pointer_t index(get_expiration_index());
+    if(index == nullptr)
+    {
+        // no expiration date column, no rows in this index
+        //
+        return;
+    }
+
+    read_secondary_index(data, index);
+}
+
+
+/** \brief Get the definition of the expiration index.
+ *
+ * The expiration index is not defined in the schema. Instead we create
+ * a secondary index definition with one sort column, the
+ * `expiration_date` column, when the table has such a column.
+ *
+ * \return The definition of the expiration index or nullptr.
+ */
+schema_secondary_index::pointer_t table_impl::get_expiration_index()
+{
+    if(f_expiration_index == nullptr
+    && f_schema_table->has_expiration_date_column())
+    {
+        schema_sort_column::pointer_t sort_column(std::make_shared<schema_sort_column>());
+        sort_column->set_column_id(f_schema_table->expiration_date_column()->column_id());
+        sort_column->set_length(sizeof(std::uint64_t));
+
+        f_expiration_index = std::make_shared<schema_secondary_index>();
+        f_expiration_index->set_index_name("expiration");
+        f_expiration_index->add_sort_column(sort_column);
+    }
+
+    return f_expiration_index;
+}
+
+
+/** \brief Read the rows of a journal in processing order.
+ *
+ * The rows are sorted by priority and then by process date. This
+ * cursor returns all the rows still in the journal, whatever their
+ * status. Use table::journal_next() to retrieve the next row to be
+ * processed.
+ *
+ * \param[in] data  The cursor data where the rows get saved.
+ */
+void table_impl::read_journal(cursor_data & data)
+{
+    schema_secondary_index::pointer_t index(get_journal_index());
+    if(index == nullptr)
+    {
+        // not a journal, no rows in this index
+        //
+        return;
+    }
+
+    read_secondary_index(data, index);
+}
+
+
+/** \brief Get the definition of the journal index.
+ *
+ * Like the expiration index, the journal index is not defined in the
+ * schema. It is created for tables using the JOURNAL model and sorts
+ * the rows by `_priority` and `_process_date`. The `_oid` is appended
+ * to the key so each entry is unique which means an entry can always
+ * be found and removed in O(log n).
+ *
+ * \return The definition of the journal index or nullptr.
+ */
+schema_secondary_index::pointer_t table_impl::get_journal_index()
+{
+    if(f_journal_index == nullptr
+    && f_schema_table->model() == model_t::TABLE_MODEL_JOURNAL)
+    {
+        struct sort_column_t
+        {
+            char const *    f_name = nullptr;
+            std::uint32_t   f_length = 0;
+        };
+        sort_column_t const sort_columns[] =
+        {
+            { g_journal_priority_column,     sizeof(std::uint8_t)  },
+            { g_journal_process_date_column, sizeof(std::uint64_t) },
+            { "_oid",                        sizeof(oid_t)         },
+        };
+
+        schema_secondary_index::pointer_t index(std::make_shared<schema_secondary_index>());
+        index->set_index_name("journal");
+        for(auto const & sc : sort_columns)
+        {
+            schema_column::pointer_t column(f_schema_table->column(sc.f_name));
+            if(column == nullptr)
+            {
+                throw column_not_found(
+                          "Column \""
+                        + std::string(sc.f_name)
+                        + "\" is missing from journal table \""
+                        + name()
+                        + "\".");
+            }
+            schema_sort_column::pointer_t sort_column(std::make_shared<schema_sort_column>());
+            sort_column->set_column_id(column->column_id());
+            sort_column->set_length(sc.f_length);
+            index->add_sort_column(sort_column);
+        }
+        f_journal_index = index;
+    }
+
+    return f_journal_index;
+}
+
+
+/** \brief Get the `SIDX` block of a secondary index.
+ *
+ * The table header points to an `IDXP` block which lists all the `SIDX`
+ * blocks of this table. The `SIDX` identifier is a hash of the name
+ * of the secondary index.
+ *
+ * The expiration index is referenced directly from the table header.
+ *
+ * \param[in] index  The secondary index definition.
+ * \param[in] create  Whether to create the block if it does not exist yet.
+ *
+ * \return The `SIDX` block or nullptr if it does not exist and \p create
+ * is false.
+ */
+block_secondary_index::pointer_t table_impl::get_secondary_index_block(schema_secondary_index::pointer_t index, bool create)
+{
+    file_snap_database_table::pointer_t header(std::static_pointer_cast<file_snap_database_table>(get_block(0)));
+
+    block_secondary_index::pointer_t secondary_index;
+    if(index == f_expiration_index)
+    {
+        reference_t const ref(header->get_expiration_index_block());
+        if(ref != NULL_FILE_ADDR)
+        {
+            return std::static_pointer_cast<block_secondary_index>(get_block(ref));
+        }
+        if(create)
+        {
+            secondary_index = std::static_pointer_cast<block_secondary_index>(
+                        allocate_new_block(dbtype_t::BLOCK_TYPE_SECONDARY_INDEX));
+            header->set_expiration_index_block(secondary_index->get_offset());
+        }
+        return secondary_index;
+    }
+
+    std::string const name(index->get_index_name());
+    hash h(0);
+    h.add(reinterpret_cast<std::uint8_t const *>(name.c_str()), name.length());
+    std::uint32_t const id(h.get());
+
+    block_index_pointers::pointer_t list;
+    reference_t ref(header->get_secondary_index_block());
+    while(ref != NULL_FILE_ADDR)
+    {
+        list = std::static_pointer_cast<block_index_pointers>(get_block(ref));
+        std::uint32_t const count(list->get_count());
+        for(std::uint32_t idx(0); idx < count; ++idx)
+        {
+            secondary_index = std::static_pointer_cast<block_secondary_index>(get_block(list->get_pointer(idx)));
+            if(secondary_index->get_id() == id)
+            {
+                return secondary_index;
+            }
+        }
+        ref = list->get_next();
+    }
+
+    if(!create)
+    {
+        return block_secondary_index::pointer_t();
+    }
+
+    secondary_index = std::static_pointer_cast<block_secondary_index>(
+                allocate_new_block(dbtype_t::BLOCK_TYPE_SECONDARY_INDEX));
+    secondary_index->set_id(id);
+
+    if(list == nullptr)
+    {
+        list = std::static_pointer_cast<block_index_pointers>(
+                    allocate_new_block(dbtype_t::BLOCK_TYPE_INDEX_POINTERS));
+        header->set_secondary_index_block(list->get_offset());
+    }
+    else if(list->get_count() >= list->get_max_count())
+    {
+        block_index_pointers::pointer_t next(std::static_pointer_cast<block_index_pointers>(
+                    allocate_new_block(dbtype_t::BLOCK_TYPE_INDEX_POINTERS)));
+        list->set_next(next->get_offset());
+        list = next;
+    }
+    list->add_pointer(secondary_index->get_offset());
+
+    return secondary_index;
+}
+
+
+/** \brief Calculate the size of the keys of a secondary index.
+ *
+ * All the entries of an `EIDX` have the same size. The size of the
+ * key is the sum of the length of each sort column. We limit that
+ * size so one `EIDX` can hold at least 8 entries.
+ *
+ * \param[in] index  The secondary index definition.
+ *
+ * \return The number of bytes used by each key.
+ */
+std::uint32_t table_impl::secondary_key_size(schema_secondary_index::pointer_t index) const
+{
+    std::uint32_t size(0);
+    std::size_t const max(index->get_column_count());
+    for(std::size_t idx(0); idx < max; ++idx)
+    {
+        size += index->get_sort_column(idx)->get_length();
+    }
+
+    std::uint32_t const max_size(static_cast<std::uint32_t>(
+                get_page_size() / 8 - sizeof(std::uint8_t) - sizeof(oid_t)));
+    return std::min(std::max(size, static_cast<std::uint32_t>(1)), max_size);
+}
+
+
+/** \brief Add a row to a secondary index.
+ *
+ * The secondary index is a B+tree: the `SIDX` points to the root which
+ * is a `TIDX` or directly an `EIDX` when the index is small. The `EIDX`
+ * blocks are linked together (next/previous) so a range can be read
+ * without going back up the tree.
+ *
+ * When an `EIDX` or a `TIDX` is full, it gets split in two and the new
+ * block gets added to its parent.
+ *
+ * When multiple rows have the same key, the entry points to an `IDXP`
+ * block listing all the OIDs of those rows.
+ *
+ * Rows where one of the sort columns is not defined are not added to
+ * the index.
+ *
+ * \param[in] index  The secondary index definition.
+ * \param[in] row_data  The row being added.
+ * \param[in] oid  The OID of that row.
+ */
+void table_impl::add_secondary_entry(schema_secondary_index::pointer_t index, row::pointer_t row_data, oid_t oid)
+{
+    buffer_t key;
+    if(row_data->generate_secondary_key(index, key) != index->get_column_count())
+    {
+        return;
+    }
+    std::uint32_t const key_size(secondary_key_size(index));
+    key.resize(key_size, 0);
+
+    block_secondary_index::pointer_t secondary_index(get_secondary_index_block(index, true));
+    secondary_index->set_number_of_rows(secondary_index->get_number_of_rows() + 1);
+
+    reference_t const ref(secondary_index->get_top_index());
+    if(ref == NULL_FILE_ADDR)
+    {
+        block_entry_index::pointer_t entry_index(std::static_pointer_cast<block_entry_index>(
+                        allocate_new_block(dbtype_t::BLOCK_TYPE_ENTRY_INDEX)));
+        entry_index->set_key_size(key_size);
+        entry_index->add_entry(key, oid);
+        secondary_index->set_top_index(entry_index->get_offset());
+        return;
+    }
+
+    std::vector<block_top_index::pointer_t> path;
+    block_entry_index::pointer_t entry_index(find_insert_entry_index(index->get_index_name(), ref, key, path));
+    if(entry_index->find_entry(key) != NULL_FILE_ADDR)
+    {
+        add_index_pointer(entry_index, entry_index->get_position(), oid);
+        return;
+    }
+
+    reference_t const root(add_index_entry(entry_index, path, key, oid));
+    if(root != NULL_FILE_ADDR)
+    {
+        secondary_index->set_top_index(root);
+    }
+}
+
+
+/** \brief Search the `EIDX` where \p key gets inserted.
+ *
+ * This function goes down the tree starting at \p root and saves the
+ * `TIDX` blocks it goes through in \p path.
+ *
+ * Each key of a `TIDX` is the smallest key of the corresponding child.
+ * A key smaller than all the keys of a `TIDX` goes to the first child
+ * so the first key gets lowered to \p key. Otherwise, a later split of
+ * that child would add a key smaller than the first key and the `TIDX`
+ * would not be sorted anymore.
+ *
+ * \param[in] index_name  The name of the index, used in errors.
+ * \param[in] root  The reference to the root of the tree.
+ * \param[in] key  The key being inserted.
+ * \param[out] path  The list of `TIDX` from the root to the `EIDX`.
+ *
+ * \return The `EIDX` where \p key is or would be inserted.
+ */
+block_entry_index::pointer_t table_impl::find_insert_entry_index(
+          std::string const & index_name
+        , reference_t root
+        , buffer_t const & key
+        , std::vector<block_top_index::pointer_t> & path)
+{
+    block::pointer_t block(get_block(root));
+    while(block->get_dbtype() == dbtype_t::BLOCK_TYPE_TOP_INDEX)
+    {
+        block_top_index::pointer_t top_index(std::static_pointer_cast<block_top_index>(block));
+        path.push_back(top_index);
+        reference_t const child(top_index->find_child(key));
+        if(top_index->get_position() == 0)
+        {
+            buffer_t const first_key(top_index->get_index_key(0));
+            if(memcmp(key.data(), first_key.data(), std::min(key.size(), first_key.size())) < 0)
+            {
+                top_index->set_index_key(0, key);
+            }
+        }
+        block = get_block(child);
+    }
+    if(block->get_dbtype() != dbtype_t::BLOCK_TYPE_ENTRY_INDEX)
+    {
+        throw type_mismatch(
+                  "Found unexpected block of type \""
+                + to_string(block->get_dbtype())
+                + "\" in index \""
+                + index_name
+                + "\". Expected an \""
+                + to_string(dbtype_t::BLOCK_TYPE_ENTRY_INDEX)
+                + "\".");
+    }
+
+    return std::static_pointer_cast<block_entry_index>(block);
+}
+
+
+/** \brief Add a new key to an `EIDX`.
+ *
+ * The \p entry_index must have been found with find_insert_entry_index()
+ * and the key must not already exist in it.
+ *
+ * If the \p entry_index is full, it gets split in two. The upper half
+ * of the entries go to a new `EIDX` which gets linked right after it
+ * and added to the parent `TIDX` (see add_top_index_entry()).
+ *
+ * \param[in] entry_index  The `EIDX` where the key goes.
+ * \param[in] path  The list of `TIDX` from the root to \p entry_index.
+ * \param[in] key  The key to add.
+ * \param[in] oid  The OID of the row with that key.
+ *
+ * \return The reference to a new root or NULL_FILE_ADDR if the root
+ * did not change.
+ */
+reference_t table_impl::add_index_entry(
+          block_entry_index::pointer_t entry_index
+        , std::vector<block_top_index::pointer_t> & path
+        , buffer_t const & key
+        , oid_t oid)
+{
+    reference_t root(NULL_FILE_ADDR);
+    if(entry_index->get_count() >= entry_index->get_max_count())
+    {
+        block_entry_index::pointer_t new_entry_index(std::static_pointer_cast<block_entry_index>(
+                        allocate_new_block(dbtype_t::BLOCK_TYPE_ENTRY_INDEX)));
+        entry_index->split_entries(new_entry_index);
+
+        reference_t const next(entry_index->get_next());
+        new_entry_index->set_previous(entry_index->get_offset());
+        new_entry_index->set_next(next);
+        if(next != NULL_FILE_ADDR)
+        {
+            std::static_pointer_cast<block_entry_index>(get_block(next))->set_previous(new_entry_index->get_offset());
+        }
+        entry_index->set_next(new_entry_index->get_offset());
+
+        buffer_t const split_key(new_entry_index->get_entry_key(0));
+        root = add_top_index_entry(
+                  path
+                , entry_index->get_entry_key(0)
+                , entry_index->get_offset()
+                , split_key
+                , new_entry_index->get_offset());
+
+        if(memcmp(key.data(), split_key.data(), std::min(key.size(), split_key.size())) >= 0)
+        {
+            entry_index = new_entry_index;
+        }
+        snapdev::NOT_USED(entry_index->find_entry(key));
+    }
+
+    entry_index->add_entry(key, oid, static_cast<std::int32_t>(entry_index->get_position()));
+
+    return root;
+}
+
+
+/** \brief Add a reference to a new child in the top indexes.
+ *
+ * After an `EIDX` was split, the new block needs to be added to its
+ * parent `TIDX`. If that parent is full, it gets split too and so on
+ * up to the root. When the root itself gets split (or the root was
+ * the `EIDX`), a new root is created with the two blocks.
+ *
+ * \param[in] path  The list of `TIDX` from the root to the split block.
+ * \param[in] left_key  The first key of the block which was split.
+ * \param[in] left_reference  The reference to the block which was split.
+ * \param[in] key  The first key of the new block.
+ * \param[in] reference  The reference to the new block.
+ *
+ * \return The reference to the new root or NULL_FILE_ADDR if the root
+ * did not change.
+ */
+reference_t table_impl::add_top_index_entry(
+          std::vector<block_top_index::pointer_t> & path
+        , buffer_t left_key
+        , reference_t left_reference
+        , buffer_t key
+        , reference_t reference)
+{
+    while(!path.empty())
+    {
+        block_top_index::pointer_t top_index(path.back());
+        path.pop_back();
+
+        if(top_index->get_count() < top_index->get_max_count())
+        {
+            top_index->add_index(key, reference);
+            return NULL_FILE_ADDR;
+        }
+
+        block_top_index::pointer_t new_top_index(std::static_pointer_cast<block_top_index>(
+                        allocate_new_block(dbtype_t::BLOCK_TYPE_TOP_INDEX)));
+        top_index->split_indexes(new_top_index);
+
+        buffer_t const split_key(new_top_index->get_index_key(0));
+        if(memcmp(key.data(), split_key.data(), key.size()) >= 0)
+        {
+            new_top_index->add_index(key, reference);
+        }
+        else
+        {
+            top_index->add_index(key, reference);
+        }
+
+        left_key = top_index->get_index_key(0);
+        left_reference = top_index->get_offset();
+        key = split_key;
+        reference = new_top_index->get_offset();
+    }
+
+    block_top_index::pointer_t root(std::static_pointer_cast<block_top_index>(
+                    allocate_new_block(dbtype_t::BLOCK_TYPE_TOP_INDEX)));
+    root->set_size(sizeof(reference_t) + key.size());
+    root->add_index(left_key, left_reference);
+    root->add_index(key, reference);
+    return root->get_offset();
+}
+
+
+/** \brief Add an OID to an existing entry.
+ *
+ * When a secondary index entry already exists with the same key, the
+ * OIDs are saved in an `IDXP` block. The first time, the entry gets
+ * converted: its OID is moved to a new `IDXP` and the entry is marked
+ * with the ENTRY_INDEX_FLAG_MULTIPLE flag.
+ *
+ * \param[in] entry_index  The `EIDX` with the entry.
+ * \param[in] position  The position of the entry in \p entry_index.
+ * \param[in] oid  The OID of the new row.
+ */
+void table_impl::add_index_pointer(block_entry_index::pointer_t entry_index, std::uint32_t position, oid_t oid)
+{
+    std::uint8_t const flags(entry_index->get_entry_flags(position));
+    block_index_pointers::pointer_t list;
+    if((flags & ENTRY_INDEX_FLAG_MULTIPLE) == 0)
+    {
+        list = std::static_pointer_cast<block_index_pointers>(
+                    allocate_new_block(dbtype_t::BLOCK_TYPE_INDEX_POINTERS));
+        list->add_pointer(entry_index->get_entry_reference(position));
+        list->add_pointer(oid);
+        entry_index->set_entry_reference(
+                  position
+                , flags | ENTRY_INDEX_FLAG_MULTIPLE
+                , list->get_offset());
+        return;
+    }
+
+    list = std::static_pointer_cast<block_index_pointers>(get_block(entry_index->get_entry_reference(position)));
+    while(list->get_next() != NULL_FILE_ADDR)
+    {
+        list = std::static_pointer_cast<block_index_pointers>(get_block(list->get_next()));
+    }
+    if(list->get_count() >= list->get_max_count())
+    {
+        block_index_pointers::pointer_t next(std::static_pointer_cast<block_index_pointers>(
+                    allocate_new_block(dbtype_t::BLOCK_TYPE_INDEX_POINTERS)));
+        list->set_next(next->get_offset());
+        list = next;
+    }
+    list->add_pointer(oid);
+}
+
+
+oid_t table_impl::get_index_pointer(reference_t reference, std::uint32_t position)
+{
+    while(reference != NULL_FILE_ADDR)
+    {
+        block_index_pointers::pointer_t list(std::static_pointer_cast<block_index_pointers>(get_block(reference)));
+        std::uint32_t const count(list->get_count());
+        if(position < count)
+        {
+            return list->get_pointer(position);
+        }
+        position -= count;
+        reference = list->get_next();
+    }
+
+    return NULL_OID;
+}
+
+
+/** \brief Remove an OID from an entry with multiple OIDs.
+ *
+ * The \p oid is searched in the list of `IDXP` blocks of the entry and
+ * removed. A block which becomes empty gets freed. Once a single OID
+ * remains, the entry gets converted back to a plain entry (i.e. the
+ * reverse of add_index_pointer()).
+ *
+ * \param[in] entry_index  The `EIDX` with the entry.
+ * \param[in] position  The position of the entry in \p entry_index.
+ * \param[in] oid  The OID of the row to remove.
+ *
+ * \return true if \p oid was found and removed.
+ */
+bool table_impl::remove_index_pointer(block_entry_index::pointer_t entry_index, std::uint32_t position, oid_t oid)
+{
+    bool const clear_block(!f_dbfile->get_sparse() || is_secure());
+    std::uint8_t const flags(entry_index->get_entry_flags(position));
+
+    block_index_pointers::pointer_t previous;
+    reference_t reference(entry_index->get_entry_reference(position));
+    while(reference != NULL_FILE_ADDR)
+    {
+        block_index_pointers::pointer_t list(std::static_pointer_cast<block_index_pointers>(get_block(reference)));
+        std::uint32_t const count(list->get_count());
+        for(std::uint32_t idx(0); idx < count; ++idx)
+        {
+            if(list->get_pointer(idx) != oid)
+            {
+                continue;
+            }
+
+            list->remove_pointer(idx);
+            if(list->get_count() == 0)
+            {
+                if(previous == nullptr)
+                {
+                    entry_index->set_entry_reference(position, flags, list->get_next());
+                }
+                else
+                {
+                    previous->set_next(list->get_next());
+                }
+                free_block(list, clear_block);
+            }
+
+            // with a single OID left, go back to a plain entry
+            //
+            block_index_pointers::pointer_t first(std::static_pointer_cast<block_index_pointers>(
+                        get_block(entry_index->get_entry_reference(position))));
+            if(first->get_count() == 1
+            && first->get_next() == NULL_FILE_ADDR)
+            {
+                entry_index->set_entry_reference(
+                          position
+                        , flags & ~ENTRY_INDEX_FLAG_MULTIPLE
+                        , first->get_pointer(0));
+                free_block(first, clear_block);
+            }
+            return true;
+        }
+        previous = list;
+        reference = list->get_next();
+    }
+
+    return false;
+}
+
+
+/** \brief Remove a row from a secondary index.
+ *
+ * The key of the row is searched going down the tree and the entry
+ * gets removed from its `EIDX`. When several rows share that key,
+ * only \p oid gets removed from the list of OIDs.
+ *
+ * An `EIDX` which becomes empty gets freed and removed from its
+ * parent `TIDX` (see remove_entry_index()).
+ *
+ * \param[in] index  The secondary index definition.
+ * \param[in] row_data  The row to remove from the index.
+ * \param[in] oid  The OID of that row.
+ *
+ * \return true if the entry was found and removed.
+ */
+bool table_impl::remove_secondary_entry(schema_secondary_index::pointer_t index, row::pointer_t row_data, oid_t oid)
+{
+    buffer_t key;
+    if(row_data->generate_secondary_key(index, key) != index->get_column_count())
+    {
+        return false;
+    }
+    key.resize(secondary_key_size(index), 0);
+
+    block_secondary_index::pointer_t secondary_index(get_secondary_index_block(index, false));
+    if(secondary_index == nullptr
+    || secondary_index->get_top_index() == NULL_FILE_ADDR)
+    {
+        return false;
+    }
+
+    std::vector<block_top_index::pointer_t> path;
+    block::pointer_t block(get_block(secondary_index->get_top_index()));
+    while(block->get_dbtype() == dbtype_t::BLOCK_TYPE_TOP_INDEX)
+    {
+        block_top_index::pointer_t top_index(std::static_pointer_cast<block_top_index>(block));
+        path.push_back(top_index);
+        block = get_block(top_index->find_child(key));
+    }
+    if(block->get_dbtype() != dbtype_t::BLOCK_TYPE_ENTRY_INDEX)
+    {
+        throw type_mismatch(
+                  "Found unexpected block of type \""
+                + to_string(block->get_dbtype())
+                + "\" in secondary index \""
+                + index->get_index_name()
+                + "\". Expected an \""
+                + to_string(dbtype_t::BLOCK_TYPE_ENTRY_INDEX)
+                + "\".");
+    }
+    block_entry_index::pointer_t entry_index(std::static_pointer_cast<block_entry_index>(block));
+    if(entry_index->find_entry(key) == NULL_FILE_ADDR)
+    {
+        return false;
     }
 
-    block::pointer_t block;
-    for(;;)
+    std::uint32_t const position(entry_index->get_position());
+    if((entry_index->get_entry_flags(position) & ENTRY_INDEX_FLAG_MULTIPLE) != 0)
     {
-        block = get_block(offset);
-        if(block->get_dbtype() != dbtype_t::BLOCK_TYPE_TOP_INDIRECT_INDEX)
+        if(!remove_index_pointer(entry_index, position, oid))
         {
-            break;
+            return false;
         }
-        block_top_indirect_index::pointer_t tind(std::static_pointer_cast<block_top_indirect_index>(block));
-        offset = tind->get_reference(oid, true);
-        if(offset == NULL_FILE_ADDR)
+    }
+    else
+    {
+        if(entry_index->get_entry_reference(position) != oid)
         {
-            throw snapdatabase_logic_error("somehow the get_indirect_reference() was called with a still unused OID.");
+            return false;
+        }
+        entry_index->remove_entry(position);
+        if(entry_index->get_count() == 0)
+        {
+            remove_entry_index(secondary_index, path, entry_index);
         }
     }
 
-    if(block->get_dbtype() != dbtype_t::BLOCK_TYPE_INDIRECT_INDEX)
+    std::uint64_t const count(secondary_index->get_number_of_rows());
+    if(count > 0)
     {
-        throw type_mismatch(
-                  "expected block of type INDIRECT INDEX (INDR), got \""
-                + to_string(block->get_dbtype())
-                + "\" instead.");
+        secondary_index->set_number_of_rows(count - 1);
     }
 
-    block_indirect_index::pointer_t indr(std::static_pointer_cast<block_indirect_index>(block));
-    return indr->get_reference(oid, true);
+    return true;
 }
 
 
-row::pointer_t table_impl::get_indirect_row(oid_t oid)
+/** \brief Free an empty `EIDX`.
+ *
+ * The block gets unlinked from its siblings and removed from its parent
+ * `TIDX`. If that parent becomes empty, it gets freed too and so on up
+ * to the root. When the root goes, the secondary index becomes empty.
+ *
+ * \param[in] secondary_index  The `SIDX` of the index being updated.
+ * \param[in] path  The list of `TIDX` from the root to \p entry_index.
+ * \param[in] entry_index  The empty `EIDX` to free.
+ */
+void table_impl::remove_entry_index(
+          block_secondary_index::pointer_t secondary_index
+        , std::vector<block_top_index::pointer_t> & path
+        , block_entry_index::pointer_t entry_index)
 {
-    return get_row(get_indirect_reference(oid));
-}
+    bool const clear_block(!f_dbfile->get_sparse() || is_secure());
 
+    reference_t const previous(entry_index->get_previous());
+    reference_t const next(entry_index->get_next());
+    if(previous != NULL_FILE_ADDR)
+    {
+        std::static_pointer_cast<block_entry_index>(get_block(previous))->set_next(next);
+    }
+    if(next != NULL_FILE_ADDR)
+    {
+        std::static_pointer_cast<block_entry_index>(get_block(next))->set_previous(previous);
+    }
 
-row::pointer_t table_impl::get_row(reference_t row_reference)
-{
-    block_data::pointer_t data(std::static_pointer_cast<block_data>(get_block(row_reference)));
-    const_data_t ptr(data->data(row_reference));
-    std::uint32_t const size(block_free_space::get_size(ptr));
-    row::pointer_t row(std::make_shared<row>(f_table->get_pointer()));
+    reference_t reference(entry_index->get_offset());
+    free_block(entry_index, clear_block);
 
-    // TODO: rework the from_binary() to access the ptr/size pair instead
-    //       so we can avoid one copy
-    //
-    buffer_t const blob(ptr, ptr + size);
-    row->from_binary(blob);
+    while(!path.empty())
+    {
+        block_top_index::pointer_t top_index(path.back());
+        path.pop_back();
 
-    return row;
+        std::uint32_t const count(top_index->get_count());
+        for(std::uint32_t idx(0); idx < count; ++idx)
+        {
+            if(top_index->get_index_reference(idx) == reference)
+            {
+                top_index->remove_index(idx);
+                break;
+            }
+        }
+        if(top_index->get_count() > 0)
+        {
+            return;
+        }
+
+        reference = top_index->get_offset();
+        free_block(top_index, clear_block);
+    }
+
+    secondary_index->set_top_index(NULL_FILE_ADDR);
 }
 
 
-void table_impl::read_rows(cursor_data & data)
+/** \brief Read a set of rows from a secondary index.
+ *
+ * This function searches the first key of the range (the min key or
+ * the max key if reverse is true) going down the tree. This is an
+ * O(log n) search. Then it reads the following entries until the
+ * other end of the range is reached, one `EIDX` after the other.
+ *
+ * The function reads at most "count" rows at a time. The position in
+ * the index is saved in the cursor state so the next call continues
+ * from there. If the cursor position changed (rewind(), previous_row()),
+ * the scan restarts.
+ *
+ * \param[in] data  The cursor data where the rows get saved.
+ * \param[in] index  The secondary index definition.
+ */
+void table_impl::read_secondary_index(cursor_data & data, schema_secondary_index::pointer_t index)
 {
-    switch(data.f_state->get_index_type())
-    {
-    case index_type_t::INDEX_TYPE_SECONDARY:
-        read_secondary(data);
-        break;
-
-    case index_type_t::INDEX_TYPE_INDIRECT:
-        read_indirect(data);
-        break;
+    conditions const & cond(data.f_cursor->get_conditions());
+    bool const reverse(cond.get_reverse());
+    size_t const position(data.f_cursor->get_position());
 
-    case index_type_t::INDEX_TYPE_PRIMARY:
-        read_primary(data);
-        break;
+    cursor_state::scan_position_t & scan(data.f_state->get_scan_position());
+    if(!scan.f_started
+    || scan.f_count != position)
+    {
+        start_secondary_scan(data, index);
 
-    case index_type_t::INDEX_TYPE_EXPIRATION:
-        read_expiration(data);
-        break;
+        count_t const skip(cond.get_offset() + position);
+        for(count_t idx(0); idx < skip; ++idx)
+        {
+            if(next_secondary_oid(scan, reverse) == NULL_OID)
+            {
+                break;
+            }
+        }
+        scan.f_count = position;
+    }
 
-    case index_type_t::INDEX_TYPE_TREE:
-        read_tree(data);
-        break;
+    count_t const limit(cond.get_limit());
+    count_t const count(cond.get_count());
+    for(count_t idx(0); count == CURSOR_NO_LIMIT || idx < count; ++idx)
+    {
+        if(limit != CURSOR_NO_LIMIT
+        && scan.f_count >= limit)
+        {
+            break;
+        }
 
-    default:
-        throw snapdatabase_logic_error("unexpected index type in read_rows().");
+        oid_t const oid(next_secondary_oid(scan, reverse));
+        if(oid == NULL_OID)
+        {
+            break;
+        }
 
+        data.f_rows.push_back(get_indirect_row(oid));
+        ++scan.f_count;
     }
 }
 
 
-void table_impl::read_secondary(cursor_data & data)
+void table_impl::start_secondary_scan(cursor_data & data, schema_secondary_index::pointer_t index)
 {
-snapdev::NOT_USED(data);
-std::cerr << "table: TODO implement read secondary...\n";
-throw snapdatabase_not_yet_implemented("table: TODO implement read secondary");
-}
+    conditions const & cond(data.f_cursor->get_conditions());
+    bool const reverse(cond.get_reverse());
 
+    cursor_state::scan_position_t & scan(data.f_state->get_scan_position());
+    scan = cursor_state::scan_position_t();
+    scan.f_started = true;
 
-void table_impl::read_indirect(cursor_data & data)
-{
-    file_snap_database_table::pointer_t header(std::static_pointer_cast<file_snap_database_table>(get_block(0)));
-    reference_t tref(header->get_indirect_index());
-    if(tref == NULL_FILE_ADDR)
+    // a partial key is padded with 0x00 for the min key and 0xFF for
+    // the max key so all the entries starting with that key match
+    //
+    std::uint32_t const key_size(secondary_key_size(index));
+    row::pointer_t min_key(cond.get_min_key());
+    if(min_key != nullptr)
     {
-        // we have nothing here
-        // (happens until we do some commit)
-        //
-        return;
+        min_key->generate_secondary_key(index, scan.f_min_key);
+    }
+    scan.f_min_key.resize(key_size, 0x00);
+    row::pointer_t max_key(cond.get_max_key());
+    if(max_key != nullptr)
+    {
+        max_key->generate_secondary_key(index, scan.f_max_key);
     }
+    scan.f_max_key.resize(key_size, 0xFF);
 
-snapdev::NOT_USED(data);
-std::cerr << "table: TODO implement read indirect...\n";
-throw snapdatabase_not_yet_implemented("table: TODO implement read indirect");
+    seek_secondary_scan(index, reverse ? scan.f_max_key : scan.f_min_key, reverse, scan);
 }
 
 
-void table_impl::read_primary(cursor_data & data)
+/** \brief Move a secondary index scan to the specified key.
+ *
+ * This function searches \p key going down the tree, an O(log n)
+ * search, and saves the position found in \p scan. The next call to
+ * next_secondary_oid() returns the first entry with a key larger or
+ * equal to \p key (smaller or equal if \p reverse is true).
+ *
+ * The min/max keys of the scan are not modified.
+ *
+ * \param[in] index  The secondary index definition.
+ * \param[in] key  The key to search, padded to the size of the index keys.
+ * \param[in] reverse  Whether the scan goes backward.
+ * \param[in,out] scan  The position of the scan.
+ */
+void table_impl::seek_secondary_scan(
+          schema_secondary_index::pointer_t index
+        , buffer_t const & key
+        , bool reverse
+        , cursor_state::scan_position_t & scan)
 {
-    // the primary index has a single position at position 0
-    //
-std::cerr << "the position is: " << data.f_cursor->get_position() << "\n";
-    if(data.f_cursor->get_position() > 0)
-    {
-        return;
-    }
+    scan.f_started = true;
+    scan.f_done = false;
+    scan.f_pointer = 0;
 
-    block_primary_index::pointer_t primary_index(get_primary_index_block(false));
-    if(primary_index == nullptr)
+    block_secondary_index::pointer_t secondary_index(get_secondary_index_block(index, false));
+    if(secondary_index == nullptr
+    || secondary_index->get_top_index() == NULL_FILE_ADDR)
     {
-        // we have nothing here
-        // (happens until we do some commit)
-        //
-std::cerr << "read_primary: no primary index block!?\n";
+        scan.f_done = true;
         return;
     }
 
-    // the primary key is "special" in that we get the content of the
-    // columns and then calculate the murmur value; the murmur is what's
-    // used as the key, not the content of the columns
-    //
-    conditions const & cond(data.f_cursor->get_conditions());
-    buffer_t const & key(cond.get_murmur_key());
-std::cerr << "read primary with \"set_top_index()\" -- " << static_cast<int>(key[14]) << " " << static_cast<int>(key[15]) << "\n";
-
-    // we may have one `PIDX`
-    //
-    // TODO: consider making the primary index optional
+    // going forward, f_position is the next entry to read; going
+    // backward, it is one after the next entry to read
     //
-    reference_t ref(primary_index->get_top_index(key));
-    if(ref == NULL_FILE_ADDR)
+    block_entry_index::pointer_t entry_index(find_secondary_entry_index(index, secondary_index, key));
+    bool const found(entry_index->find_entry(key) != NULL_FILE_ADDR);
+    scan.f_entry_index = entry_index->get_offset();
+    scan.f_position = entry_index->get_position();
+    if(reverse && found)
     {
-        // no such entry, "SELECT" returns an empty list
-        //
-std::cerr << "read_primary: no top index reference!?\n";
-        return;
+        ++scan.f_position;
     }
-    block::pointer_t block(get_block(ref));
+}
 
-    // we can have any number of `TIDX` or directly an `EIDX`
-    //
-std::cerr << "read_primary: loop through top indexex if any!?\n";
+
+/** \brief Search the `EIDX` where \p key is or would be.
+ *
+ * \param[in] index  The secondary index definition.
+ * \param[in] secondary_index  The `SIDX` of that index, which must have
+ * a top index.
+ * \param[in] key  The key to search.
+ *
+ * \return The `EIDX` block where \p key is or would be inserted.
+ */
+block_entry_index::pointer_t table_impl::find_secondary_entry_index(
+          schema_secondary_index::pointer_t index
+        , block_secondary_index::pointer_t secondary_index
+        , buffer_t const & key)
+{
+    block::pointer_t block(get_block(secondary_index->get_top_index()));
     while(block->get_dbtype() == dbtype_t::BLOCK_TYPE_TOP_INDEX)
     {
-std::cerr << "read_primary: got at least one top indexex!\n";
-        // we have a top index
-        //
         block_top_index::pointer_t top_index(std::static_pointer_cast<block_top_index>(block));
-        ref = top_index->find_index(key);
-        cursor_state::index_reference_t idx_ref = {
-              ref
-            , top_index->get_position()
-        };
-std::cerr << "read_primary: found a top index!?\n";
-        data.f_state->add_index_reference(idx_ref);
-        if(ref == NULL_FILE_ADDR)
-        {
-            // no such entry, "SELECT" returns an empty list
-            //
-std::cerr << "read_primary: top index has null reference!?\n";
-            return;
-        }
-        block = get_block(ref);
+        block = get_block(top_index->find_child(key));
     }
-
     if(block->get_dbtype() != dbtype_t::BLOCK_TYPE_ENTRY_INDEX)
     {
         throw type_mismatch(
                   "Found unexpected block of type \""
                 + to_string(block->get_dbtype())
-                + "\". Expected an  \""
+                + "\" in secondary index \""
+                + index->get_index_name()
+                + "\". Expected an \""
                 + to_string(dbtype_t::BLOCK_TYPE_ENTRY_INDEX)
                 + "\".");
     }
 
-    block_entry_index::pointer_t entry_index(std::static_pointer_cast<block_entry_index>(block));
-    data.f_state->set_entry_index(entry_index);
+    return std::static_pointer_cast<block_entry_index>(block);
+}
 
-    oid_t const oid(entry_index->find_entry(key));
-    data.f_state->set_entry_index_close_position(entry_index->get_position());
-    if(oid == NULL_FILE_ADDR)
+
+/** \brief Get the next OID of a secondary index scan.
+ *
+ * This function returns the OID of the next row in the scan and moves
+ * the position forward (or backward if \p reverse is true).
+ *
+ * When \p entry_key is not nullptr, the key of the entry the OID comes
+ * from gets saved there. This allows the caller to check the values of
+ * the sort columns without reading the row.
+ *
+ * \param[in,out] scan  The position of the scan.
+ * \param[in] reverse  Whether the scan goes backward.
+ * \param[out] entry_key  Where the key of the entry gets saved or nullptr.
+ *
+ * \return The next OID or NULL_OID once the end of the range is reached.
+ */
+oid_t table_impl::next_secondary_oid(cursor_state::scan_position_t & scan, bool reverse, buffer_t * entry_key)
+{
+    while(!scan.f_done)
     {
-std::cerr << "read_primary: indirect index has null reference!?\n";
-        return;
-    }
+        block_entry_index::pointer_t entry_index(std::static_pointer_cast<block_entry_index>(get_block(scan.f_entry_index)));
+        std::uint32_t position(scan.f_position);
+        if(reverse)
+        {
+            if(position == 0)
+            {
+                reference_t const previous(entry_index->get_previous());
+                if(previous == NULL_FILE_ADDR)
+                {
+                    scan.f_done = true;
+                    break;
+                }
+                scan.f_entry_index = previous;
+                scan.f_position = std::static_pointer_cast<block_entry_index>(get_block(previous))->get_count();
+                scan.f_pointer = 0;
+                continue;
+            }
+            --position;
+        }
+        else if(position >= entry_index->get_count())
+        {
+            reference_t const next(entry_index->get_next());
+            if(next == NULL_FILE_ADDR)
+            {
+                scan.f_done = true;
+                break;
+            }
+            scan.f_entry_index = next;
+            scan.f_position = 0;
+            scan.f_pointer = 0;
+            continue;
+        }
 
-std::cerr << "read_primary: reading row!?\n";
-    row::pointer_t r(get_indirect_row(oid));
-    data.f_rows.push_back(r);
+        buffer_t const key(entry_index->get_entry_key(position));
+        if(reverse
+                ? memcmp(key.data(), scan.f_min_key.data(), key.size()) < 0
+                : memcmp(key.data(), scan.f_max_key.data(), key.size()) > 0)
+        {
+            scan.f_done = true;
+            break;
+        }
 
-//std::cerr << "table: TODO implement read primary...\n";
-//throw snapdatabase_not_yet_implemented("table: TODO implement read primary");
-}
+        reference_t const reference(entry_index->get_entry_reference(position));
+        if((entry_index->get_entry_flags(position) & ENTRY_INDEX_FLAG_MULTIPLE) != 0)
+        {
+            oid_t const oid(get_index_pointer(reference, scan.f_pointer));
+            if(oid != NULL_OID)
+            {
+                ++scan.f_pointer;
+                if(entry_key != nullptr)
+                {
+                    *entry_key = key;
+                }
+                return oid;
+            }
 
+            // we are done with this list, move to the next entry
+            //
+            scan.f_pointer = 0;
+            scan.f_position = reverse ? scan.f_position - 1 : scan.f_position + 1;
+            continue;
+        }
 
-void table_impl::read_expiration(cursor_data & data)
-{
-snapdev::NOT_USED(data);
-std::cerr << "table: TODO implement read expiration...\n";
-throw snapdatabase_not_yet_implemented("table: TODO implement read expiration");
+        scan.f_position = reverse ? scan.f_position - 1 : scan.f_position + 1;
+        if(entry_key != nullptr)
+        {
+            *entry_key = key;
+        }
+        return reference;
+    }
+
+    return NULL_OID;
 }
 
 
@@ -1670,6 +4156,8 @@ row::pointer_t table::row_new() const
 
 cursor::pointer_t table::row_select(conditions const & cond)
 {
+    f_impl->replay_commit_log();
+
     // verify that the index name is acceptable
     //
     std::string const & index_name(cond.get_index_name());
@@ -1721,6 +4209,96 @@ bool table::row_update(row_pointer_t row)
 }
 
 
+row_pointer_t table::journal_next(std::uint64_t now_ms, std::uint64_t timeout_ms)
+{
+    return f_impl->journal_next(now_ms, timeout_ms);
+}
+
+
+bool table::journal_done(row_pointer_t row)
+{
+    return f_impl->journal_done(row);
+}
+
+
+void table::journal_reset()
+{
+    f_impl->journal_reset();
+}
+
+
+void table::set_group_commit(std::uint32_t count, std::int64_t delay_us)
+{
+    f_impl->set_group_commit(count, delay_us);
+}
+
+
+/** \brief Synchronize the rows which waited long enough in the log.
+ *
+ * With a group commit delay, the last rows committed before the table
+ * goes idle are not synchronized by the commit itself. This function
+ * synchronizes them once their delay is over. Call it again after the
+ * returned number of microseconds.
+ *
+ * \return The number of microseconds until the next call is due or -1
+ * if no rows are waiting.
+ */
+std::int64_t table::sync_commit_log()
+{
+    return f_impl->sync_commit_log();
+}
+
+
+void table::checkpoint()
+{
+    f_impl->checkpoint();
+}
+
+
+bool table::compact(std::uint32_t max_blocks, std::int64_t max_time_us)
+{
+    return f_impl->compact(max_blocks, max_time_us);
+}
+
+
+block_cache::statistics_t table::get_cache_statistics() const
+{
+    return f_impl->get_cache_statistics();
+}
+
+
+/** \brief Retrieve the Bloom Filter of this table.
+ *
+ * The filter is used internally to avoid searching the primary index
+ * for keys which are not present. It is made available for maintenance
+ * and verification purposes.
+ *
+ * \return The Bloom Filter or nullptr if this table does not use one.
+ */
+file_bloom_filter_pointer_t table::get_bloom_filter()
+{
+    f_impl->replay_commit_log();
+
+    return f_impl->get_bloom_filter();
+}
+
+
+/** \brief Retrieve the change feed of this table.
+ *
+ * Each row committed to the table gets appended to its change feed.
+ * Local consumers can add a listener to the feed to be called on each
+ * commit, or read the changes which happened since the last sequence
+ * they processed. The size of the feed is defined by the
+ * `change_feed_size` parameter.
+ *
+ * \return The change feed of this table.
+ */
+change_feed::pointer_t table::get_change_feed() const
+{
+    return f_impl->get_change_feed();
+}
+
+
 void table::read_rows(cursor::pointer_t cursor)
 {
     detail::cursor_data data(cursor, cursor->get_state(), cursor->get_rows());
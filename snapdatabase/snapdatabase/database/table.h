@@ -38,6 +38,8 @@
 
 // self
 //
+#include    "snapdatabase/block/block_cache.h"
+#include    "snapdatabase/database/change_feed.h"
 #include    "snapdatabase/data/schema.h"
 #include    "snapdatabase/data/xml.h"
 #include    "snapdatabase/database/cursor.h"
@@ -57,12 +59,25 @@ class table_impl;
 
 
 constexpr size_t const                          BLOCK_HEADER_SIZE = 4 + 4;  // magic + version (32 bits each)
+constexpr std::uint32_t const                   DEFAULT_COMPACT_BLOCKS = 64;
+
+// status of a row in a JOURNAL table
+//
+constexpr std::uint8_t const                    JOURNAL_STATUS_WAITING = 'W';
+constexpr std::uint8_t const                    JOURNAL_STATUS_PROCESSING = 'P';
+constexpr std::uint8_t const                    JOURNAL_STATUS_DONE = 'D';
+
+// once a row timed out this many times, we give up on it
+//
+constexpr std::uint8_t const                    JOURNAL_MAXIMUM_TIMEOUT_COUNTER = 5;
 
 class context;
 class dbfile;
 typedef std::shared_ptr<dbfile>                 dbfile_pointer_t;
 class block;
 typedef std::shared_ptr<block>                  block_pointer_t;
+class file_bloom_filter;
+typedef std::shared_ptr<file_bloom_filter>      file_bloom_filter_pointer_t;
 
 
 
@@ -115,6 +130,28 @@ public:
     bool                                        row_insert(row_pointer_t row);
     bool                                        row_update(row_pointer_t row);
 
+    // journal management
+    //
+    row_pointer_t                               journal_next(std::uint64_t now_ms, std::uint64_t timeout_ms);
+    bool                                        journal_done(row_pointer_t row);
+    void                                        journal_reset();
+
+    // durability
+    //
+    void                                        set_group_commit(std::uint32_t count, std::int64_t delay_us = 0);
+    std::int64_t                                sync_commit_log();
+    void                                        checkpoint();
+
+    // maintenance
+    //
+    bool                                        compact(std::uint32_t max_blocks = DEFAULT_COMPACT_BLOCKS, std::int64_t max_time_us = 0);
+    block_cache::statistics_t                   get_cache_statistics() const;
+    file_bloom_filter_pointer_t                 get_bloom_filter();
+
+    // change notifications
+    //
+    change_feed::pointer_t                      get_change_feed() const;
+
 private:
     friend cursor;
 
@@ -68,6 +68,7 @@ DECLARE_EXCEPTION(snapdatabase_error, invalid_xml);
 DECLARE_EXCEPTION(snapdatabase_error, io_error);
 DECLARE_EXCEPTION(snapdatabase_error, node_already_in_tree);
 DECLARE_EXCEPTION(snapdatabase_error, page_not_found);
+DECLARE_EXCEPTION(snapdatabase_error, protocol_error);
 DECLARE_EXCEPTION(snapdatabase_error, row_already_exists);
 DECLARE_EXCEPTION(snapdatabase_error, row_not_found);
 DECLARE_EXCEPTION(snapdatabase_error, schema_not_found);
@@ -19,10 +19,21 @@
 
 
 /** \file
- * \brief Database file implementation.
+ * \brief Bloom Filter file implementation.
  *
- * Each table uses one or more files. Each file is handled by a dbfile
- * object and a corresponding set of blocks.
+ * The Bloom Filter of a table is saved in a separate file. The first
+ * block is the `BLMF` header and the bits or counters follow.
+ *
+ * We use the double hashing technique to compute the k positions of
+ * a key: two 64 bit hashes are calculated with our incremental hash
+ * class (using four different seeds) and position i is defined as
+ * `(h1 + i * h2) % size`. This gives us results equivalent to k
+ * independent hashes for a fraction of the cost.
+ *
+ * The size is rounded up to a power of two. With an odd h2, the k
+ * positions are then all different (h2 has an inverse modulo a power
+ * of two) and the 64 bit overflow of `h1 + i * h2` does not change
+ * the result of the modulo.
  */
 
 // self
@@ -30,6 +41,18 @@
 #include    "snapdatabase/file/file_bloom_filter.h"
 
 #include    "snapdatabase/block/block_header.h"
+#include    "snapdatabase/file/hash.h"
+
+
+// C++ lib
+//
+#include    <algorithm>
+#include    <cmath>
+
+
+// C lib
+//
+#include    <string.h>
 
 
 // last include
@@ -56,6 +79,22 @@ constexpr struct_description_t g_description[] =
         , FieldType(struct_type_t::STRUCT_TYPE_STRUCTURE)
         , FieldSubDescription(detail::g_block_header)
     ),
+    define_description(
+          FieldName("bloom_filter_flags=algorithm:4/renewing")
+        , FieldType(struct_type_t::STRUCT_TYPE_BITS32)
+    ),
+    define_description(
+          FieldName("hash_count")
+        , FieldType(struct_type_t::STRUCT_TYPE_UINT32)
+    ),
+    define_description(
+          FieldName("size")     // number of bits or counters
+        , FieldType(struct_type_t::STRUCT_TYPE_UINT64)
+    ),
+    define_description(
+          FieldName("item_count")
+        , FieldType(struct_type_t::STRUCT_TYPE_UINT64)
+    ),
     end_descriptions()
 };
 
@@ -70,6 +109,63 @@ constexpr descriptions_by_version_t const g_descriptions_by_version[] =
 };
 
 
+constexpr static_field_t<std::uint32_t> const g_hash_count_field(define_static_field<std::uint32_t>(g_description, "hash_count"));
+constexpr static_field_t<std::uint64_t> const g_size_field(define_static_field<std::uint64_t>(g_description, "size"));
+constexpr static_field_t<std::uint64_t> const g_item_count_field(define_static_field<std::uint64_t>(g_description, "item_count"));
+
+
+
+// the seeds used to compute the two 64 bit hashes
+//
+constexpr hash_t const g_seeds[4] =
+{
+    0x8E3A57C1,
+    0x2F6D09B4,
+    0xD5147E93,
+    0x61B8C02F,
+};
+
+
+void compute_parameters(
+          std::uint64_t expected_rows
+        , double false_positive_rate
+        , std::uint64_t & size
+        , std::uint32_t & hash_count)
+{
+    if(expected_rows == 0)
+    {
+        expected_rows = file_bloom_filter::DEFAULT_EXPECTED_ROWS;
+    }
+    if(false_positive_rate <= 0.0
+    || false_positive_rate >= 1.0)
+    {
+        throw invalid_parameter(
+                  "the Bloom Filter false positive rate must be between 0.0 and 1.0 exclusive, "
+                + std::to_string(false_positive_rate)
+                + " is not valid.");
+    }
+
+    // m = -n ln(p) / ln(2)^2
+    //
+    double const ln2(std::log(2.0));
+    double const n(static_cast<double>(expected_rows));
+    std::uint64_t const m(std::max(static_cast<std::uint64_t>(std::ceil(-n * std::log(false_positive_rate) / (ln2 * ln2)))
+                                 , static_cast<std::uint64_t>(64)));
+
+    // use a power of two so the double hashing positions all differ
+    //
+    size = 64;
+    while(size < m)
+    {
+        size <<= 1;
+    }
+
+    // k = m / n ln(2)
+    //
+    hash_count = static_cast<std::uint32_t>(std::round(static_cast<double>(size) / n * ln2));
+    hash_count = std::min(std::max(hash_count, static_cast<std::uint32_t>(1)), file_bloom_filter::MAX_HASH_COUNT);
+}
+
 
 }
 // no name namespace
@@ -83,6 +179,299 @@ file_bloom_filter::file_bloom_filter(dbfile::pointer_t f, reference_t offset)
 }
 
 
+/** \brief Calculate the size of a Bloom Filter file.
+ *
+ * The size includes the header block. It is rounded up to a multiple
+ * of \p page_size.
+ *
+ * \param[in] expected_rows  The number of rows the table is expected to hold.
+ * \param[in] algorithm  The algorithm: ONE_BITS or ONE_COUNTERS.
+ * \param[in] page_size  The size of one page in the file.
+ * \param[in] false_positive_rate  The acceptable rate of false positives.
+ *
+ * \return The size of the file in bytes.
+ */
+std::uint64_t file_bloom_filter::file_size(
+          std::uint64_t expected_rows
+        , bloom_filter_algorithm_t algorithm
+        , size_t page_size
+        , double false_positive_rate)
+{
+    std::uint64_t size(0);
+    std::uint32_t hash_count(0);
+    compute_parameters(expected_rows, false_positive_rate, size, hash_count);
+
+    switch(algorithm)
+    {
+    case bloom_filter_algorithm_t::BLOOM_FILTER_ALGORITHM_ONE_BITS:
+        size = (size + 7) / 8;
+        break;
+
+    case bloom_filter_algorithm_t::BLOOM_FILTER_ALGORITHM_ONE_COUNTERS:
+        break;
+
+    default:
+        throw snapdatabase_not_yet_implemented(
+                  "Bloom Filter algorithm "
+                + std::to_string(static_cast<int>(algorithm))
+                + " is not yet supported.");
+
+    }
+
+    return page_size + (size + page_size - 1) / page_size * page_size;
+}
+
+
+/** \brief Initialize a new Bloom Filter.
+ *
+ * This function saves the parameters of the Bloom Filter in the header.
+ * The file must already be large enough (see file_size()) and the data
+ * is expected to be all zeroes.
+ *
+ * \param[in] expected_rows  The number of rows the table is expected to hold.
+ * \param[in] algorithm  The algorithm: ONE_BITS or ONE_COUNTERS.
+ * \param[in] false_positive_rate  The acceptable rate of false positives.
+ */
+void file_bloom_filter::initialize(
+          std::uint64_t expected_rows
+        , bloom_filter_algorithm_t algorithm
+        , double false_positive_rate)
+{
+    std::uint64_t size(0);
+    std::uint32_t hash_count(0);
+    compute_parameters(expected_rows, false_positive_rate, size, hash_count);
+
+    f_structure->set_bits("bloom_filter_flags.algorithm", static_cast<std::uint64_t>(algorithm));
+    set_static_field(g_hash_count_field, hash_count);
+    set_static_field(g_size_field, size);
+    set_static_field(g_item_count_field, 0);
+}
+
+
+bloom_filter_algorithm_t file_bloom_filter::get_algorithm() const
+{
+    return static_cast<bloom_filter_algorithm_t>(f_structure->get_bits("bloom_filter_flags.algorithm"));
+}
+
+
+std::uint32_t file_bloom_filter::get_hash_count() const
+{
+    return static_cast<std::uint32_t>(get_static_field(g_hash_count_field));
+}
+
+
+std::uint64_t file_bloom_filter::get_size() const
+{
+    return get_static_field(g_size_field);
+}
+
+
+std::uint64_t file_bloom_filter::get_item_count() const
+{
+    return get_static_field(g_item_count_field);
+}
+
+
+/** \brief Add a key to the Bloom Filter.
+ *
+ * Once added, contains() always returns true for that \p key.
+ *
+ * With the counters algorithm, counters which already reached 255
+ * are not incremented (they become sticky).
+ *
+ * \param[in] key  The key to add.
+ */
+void file_bloom_filter::add(buffer_t const & key)
+{
+    std::uint64_t h1(0);
+    std::uint64_t h2(0);
+    positions(key, h1, h2);
+
+    bool const bits(get_algorithm() == bloom_filter_algorithm_t::BLOOM_FILTER_ALGORITHM_ONE_BITS);
+    std::uint64_t const size(get_size());
+    std::uint32_t const hash_count(get_hash_count());
+    for(std::uint32_t i(0); i < hash_count; ++i)
+    {
+        std::uint64_t const position((h1 + i * h2) % size);
+        data_t ptr(modify_counter(position));
+        if(bits)
+        {
+            *ptr |= 1 << (position & 7);
+        }
+        else if(*ptr != 255)
+        {
+            ++*ptr;
+        }
+    }
+
+    set_static_field(g_item_count_field, get_item_count() + 1);
+}
+
+
+/** \brief Check whether a key may be present.
+ *
+ * If this function returns false, the key is definitely not present
+ * in the table. If it returns true, the key is likely present but
+ * the caller has to verify by searching the corresponding index.
+ *
+ * \param[in] key  The key to check.
+ *
+ * \return false if the key is definitely not present.
+ */
+bool file_bloom_filter::contains(buffer_t const & key) const
+{
+    std::uint64_t h1(0);
+    std::uint64_t h2(0);
+    positions(key, h1, h2);
+
+    bool const bits(get_algorithm() == bloom_filter_algorithm_t::BLOOM_FILTER_ALGORITHM_ONE_BITS);
+    std::uint64_t const size(get_size());
+    std::uint32_t const hash_count(get_hash_count());
+    for(std::uint32_t i(0); i < hash_count; ++i)
+    {
+        std::uint64_t const position((h1 + i * h2) % size);
+        const_data_t ptr(counter(position));
+        if(bits)
+        {
+            if((*ptr & (1 << (position & 7))) == 0)
+            {
+                return false;
+            }
+        }
+        else if(*ptr == 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/** \brief Remove a key from the Bloom Filter.
+ *
+ * This is only possible with the counters algorithm. With the bits
+ * algorithm, the function does nothing (the filter can only be fixed
+ * by regenerating it).
+ *
+ * \warning
+ * The key must have been added before or the filter becomes invalid.
+ *
+ * \param[in] key  The key to remove.
+ */
+void file_bloom_filter::remove(buffer_t const & key)
+{
+    if(get_algorithm() != bloom_filter_algorithm_t::BLOOM_FILTER_ALGORITHM_ONE_COUNTERS)
+    {
+        return;
+    }
+
+    std::uint64_t h1(0);
+    std::uint64_t h2(0);
+    positions(key, h1, h2);
+
+    std::uint64_t const size(get_size());
+    std::uint32_t const hash_count(get_hash_count());
+    for(std::uint32_t i(0); i < hash_count; ++i)
+    {
+        data_t ptr(modify_counter((h1 + i * h2) % size));
+        if(*ptr != 0
+        && *ptr != 255)
+        {
+            --*ptr;
+        }
+    }
+
+    std::uint64_t const count(get_item_count());
+    if(count > 0)
+    {
+        set_static_field(g_item_count_field, count - 1);
+    }
+}
+
+
+/** \brief Remove all the keys from the Bloom Filter.
+ *
+ * This function is used when all the rows of a table get removed at
+ * once (see table::journal_reset()). All the counters or bits are
+ * reset to zero so the filter is as good as new.
+ */
+void file_bloom_filter::clear()
+{
+    std::uint64_t size(get_size());
+    if(get_algorithm() == bloom_filter_algorithm_t::BLOOM_FILTER_ALGORITHM_ONE_BITS)
+    {
+        size = (size + 7) / 8;
+    }
+
+    // the data is only contiguous within one page
+    //
+    size_t const page_size(f_file->get_page_size());
+    for(std::uint64_t offset(0); offset < size; )
+    {
+        std::uint64_t const length(std::min(size - offset, page_size - offset % page_size));
+        f_file->journal_page(page_size + offset);
+        memset(f_file->data(page_size + offset), 0, length);
+        offset += length;
+    }
+
+    set_static_field(g_item_count_field, 0);
+}
+
+
+void file_bloom_filter::positions(buffer_t const & key, std::uint64_t & h1, std::uint64_t & h2) const
+{
+    hash_t v[4];
+    for(int idx(0); idx < 4; ++idx)
+    {
+        hash h(g_seeds[idx]);
+        h.add(key.data(), key.size());
+        v[idx] = h.get();
+    }
+
+    h1 = (static_cast<std::uint64_t>(v[0]) << 32) | v[1];
+
+    // h2 must be odd so all the positions differ (the size is a power
+    // of two, see compute_parameters())
+    //
+    h2 = (static_cast<std::uint64_t>(v[2]) << 32) | v[3] | 1;
+}
+
+
+reference_t file_bloom_filter::counter_offset(std::uint64_t position) const
+{
+    size_t const page_size(f_file->get_page_size());
+    if(get_algorithm() == bloom_filter_algorithm_t::BLOOM_FILTER_ALGORITHM_ONE_BITS)
+    {
+        return page_size + position / 8;
+    }
+    return page_size + position;
+}
+
+
+const_data_t file_bloom_filter::counter(std::uint64_t position) const
+{
+    return f_file->data(counter_offset(position));
+}
+
+
+/** \brief Get a pointer to a counter which is about to be modified.
+ *
+ * The page holding the counter gets saved in the commit log first so
+ * the filter can be restored along the table after a crash.
+ *
+ * \param[in] position  The position of the counter (or bit).
+ *
+ * \return A pointer to the byte holding the counter.
+ */
+data_t file_bloom_filter::modify_counter(std::uint64_t position)
+{
+    reference_t const offset(counter_offset(position));
+    f_file->journal_page(offset);
+    return f_file->data(offset);
+}
+
+
 
 } // namespace snapdatabase
 // vim: ts=4 sw=4 et
@@ -32,12 +32,27 @@
  * Bloom Filter. In most case, we will lazily load the file using
  * mmap() against the entire file.
  *
- * A Bloom Filter
+ * A Bloom Filter is used to very quickly know whether a key is not
+ * present in a table. When the filter says the key is not present,
+ * it is 100% sure. When it says the key may be present, we still have
+ * to search the indexes (i.e. false positives are possible). Since
+ * a large number of our lookups are for rows which do not exist (does
+ * this page exist? does this session exist?) this saves us from
+ * loading many index blocks.
+ *
+ * The first block of the file is the header. The bits (or counters)
+ * start at the second block. Since the dbfile maps the file in large
+ * segments, accessing any bit is just a pointer computation.
+ *
+ * The pages of the filter get saved in the commit log of the table
+ * before they are modified, like the pages of the table file, so the
+ * filter and the table remain consistent after a crash.
  */
 
 // self
 //
 #include    "snapdatabase/data/structure.h"
+#include    "snapdatabase/file/file_snap_database_table.h"
 
 
 
@@ -52,10 +67,39 @@ class file_bloom_filter
 public:
     typedef std::shared_ptr<file_bloom_filter>       pointer_t;
 
+    static constexpr double     DEFAULT_FALSE_POSITIVE_RATE = 0.01;
+    static constexpr std::uint64_t
+                                DEFAULT_EXPECTED_ROWS = 100000;
+    static constexpr std::uint32_t
+                                MAX_HASH_COUNT = 23;
+
                                 file_bloom_filter(dbfile::pointer_t f, reference_t offset);
 
+    static std::uint64_t        file_size(
+                                      std::uint64_t expected_rows
+                                    , bloom_filter_algorithm_t algorithm
+                                    , size_t page_size
+                                    , double false_positive_rate = DEFAULT_FALSE_POSITIVE_RATE);
+
+    void                        initialize(
+                                      std::uint64_t expected_rows
+                                    , bloom_filter_algorithm_t algorithm
+                                    , double false_positive_rate = DEFAULT_FALSE_POSITIVE_RATE);
+    bloom_filter_algorithm_t    get_algorithm() const;
+    std::uint32_t               get_hash_count() const;
+    std::uint64_t               get_size() const;
+    std::uint64_t               get_item_count() const;
+
+    void                        add(buffer_t const & key);
+    bool                        contains(buffer_t const & key) const;
+    void                        remove(buffer_t const & key);
+    void                        clear();
 
 private:
+    void                        positions(buffer_t const & key, std::uint64_t & h1, std::uint64_t & h2) const;
+    reference_t                 counter_offset(std::uint64_t position) const;
+    const_data_t                counter(std::uint64_t position) const;
+    data_t                      modify_counter(std::uint64_t position);
 };
 
 
@@ -166,6 +166,26 @@ constexpr descriptions_by_version_t const g_descriptions_by_version[] =
 };
 
 
+constexpr static_field_t<std::uint32_t> const g_file_version_field(define_static_field<std::uint32_t>(g_description, "file_version"));
+constexpr static_field_t<std::uint32_t> const g_block_size_field(define_static_field<std::uint32_t>(g_description, "block_size"));
+constexpr static_field_t<std::uint64_t> const g_table_definition_field(define_static_field<std::uint64_t>(g_description, "table_definition"));
+constexpr static_field_t<std::uint64_t> const g_first_free_block_field(define_static_field<std::uint64_t>(g_description, "first_free_block"));
+constexpr static_field_t<std::uint64_t> const g_indirect_index_field(define_static_field<std::uint64_t>(g_description, "indirect_index"));
+constexpr static_field_t<std::uint64_t> const g_last_oid_field(define_static_field<std::uint64_t>(g_description, "last_oid"));
+constexpr static_field_t<std::uint64_t> const g_first_free_oid_field(define_static_field<std::uint64_t>(g_description, "first_free_oid"));
+constexpr static_field_t<std::uint64_t> const g_update_last_oid_field(define_static_field<std::uint64_t>(g_description, "update_last_oid"));
+constexpr static_field_t<std::uint64_t> const g_update_oid_field(define_static_field<std::uint64_t>(g_description, "update_oid"));
+constexpr static_field_t<std::uint64_t> const g_blobs_with_free_space_field(define_static_field<std::uint64_t>(g_description, "blobs_with_free_space"));
+constexpr static_field_t<std::uint64_t> const g_first_compactable_block_field(define_static_field<std::uint64_t>(g_description, "first_compactable_block"));
+constexpr static_field_t<std::uint64_t> const g_primary_index_block_field(define_static_field<std::uint64_t>(g_description, "primary_index_block"));
+constexpr static_field_t<std::uint64_t> const g_primary_index_reference_zero_field(define_static_field<std::uint64_t>(g_description, "primary_index_reference_zero"));
+constexpr static_field_t<std::uint64_t> const g_expiration_index_block_field(define_static_field<std::uint64_t>(g_description, "expiration_index_block"));
+constexpr static_field_t<std::uint64_t> const g_secondary_index_block_field(define_static_field<std::uint64_t>(g_description, "secondary_index_block"));
+constexpr static_field_t<std::uint64_t> const g_tree_index_block_field(define_static_field<std::uint64_t>(g_description, "tree_index_block"));
+constexpr static_field_t<std::uint64_t> const g_deleted_rows_field(define_static_field<std::uint64_t>(g_description, "deleted_rows"));
+constexpr static_field_t<std::uint32_t> const g_bloom_filter_flags_field(define_static_field<std::uint32_t>(g_description, "bloom_filter_flags"));
+
+
 
 }
 // no name namespace
@@ -186,217 +206,229 @@ file_snap_database_table::file_snap_database_table(dbfile::pointer_t f, referenc
 
 version_t file_snap_database_table::get_file_version() const
 {
-    return static_cast<version_t>(static_cast<uint32_t>(f_structure->get_uinteger("file_version")));
+    return static_cast<version_t>(static_cast<uint32_t>(get_static_field(g_file_version_field)));
 }
 
 
 void file_snap_database_table::set_file_version(version_t v)
 {
-    f_structure->set_uinteger("file_version", v.to_binary());
+    set_static_field(g_file_version_field, v.to_binary());
 }
 
 
 uint32_t file_snap_database_table::get_block_size() const
 {
-    return static_cast<reference_t>(f_structure->get_uinteger("block_size"));
+    return static_cast<reference_t>(get_static_field(g_block_size_field));
 }
 
 
 void file_snap_database_table::set_block_size(uint32_t size)
 {
-    f_structure->set_uinteger("block_size", size);
+    set_static_field(g_block_size_field, size);
 }
 
 
 reference_t file_snap_database_table::get_table_definition() const
 {
-    return static_cast<reference_t>(f_structure->get_uinteger("table_definition"));
+    return static_cast<reference_t>(get_static_field(g_table_definition_field));
 }
 
 
 void file_snap_database_table::set_table_definition(reference_t offset)
 {
-    f_structure->set_uinteger("table_definition", offset);
+    set_static_field(g_table_definition_field, offset);
 }
 
 
 reference_t file_snap_database_table::get_first_free_block() const
 {
-    return static_cast<reference_t>(f_structure->get_uinteger("first_free_block"));
+    return static_cast<reference_t>(get_static_field(g_first_free_block_field));
 }
 
 
 void file_snap_database_table::set_first_free_block(reference_t offset)
 {
-    f_structure->set_uinteger("first_free_block", offset);
+    set_static_field(g_first_free_block_field, offset);
 }
 
 
 reference_t file_snap_database_table::get_indirect_index() const
 {
-    return static_cast<reference_t>(f_structure->get_uinteger("indirect_index"));
+    return static_cast<reference_t>(get_static_field(g_indirect_index_field));
 }
 
 
 void file_snap_database_table::set_indirect_index(reference_t reference)
 {
-    f_structure->set_uinteger("indirect_index", reference);
+    set_static_field(g_indirect_index_field, reference);
 }
 
 
 oid_t file_snap_database_table::get_last_oid() const
 {
-    return static_cast<oid_t>(f_structure->get_uinteger("last_oid"));
+    return static_cast<oid_t>(get_static_field(g_last_oid_field));
 }
 
 
 void file_snap_database_table::set_last_oid(oid_t oid)
 {
-    f_structure->set_uinteger("last_oid", oid);
+    set_static_field(g_last_oid_field, oid);
 }
 
 
 oid_t file_snap_database_table::get_first_free_oid() const
 {
-    return static_cast<oid_t>(f_structure->get_uinteger("first_free_oid"));
+    return static_cast<oid_t>(get_static_field(g_first_free_oid_field));
 }
 
 
 void file_snap_database_table::set_first_free_oid(oid_t oid)
 {
-    f_structure->set_uinteger("first_free_oid", oid);
+    set_static_field(g_first_free_oid_field, oid);
 }
 
 
 oid_t file_snap_database_table::get_update_last_oid() const
 {
-    return static_cast<oid_t>(f_structure->get_uinteger("update_last_oid"));
+    return static_cast<oid_t>(get_static_field(g_update_last_oid_field));
 }
 
 
 void file_snap_database_table::set_update_last_oid(oid_t oid)
 {
-    f_structure->set_uinteger("update_last_oid", oid);
+    set_static_field(g_update_last_oid_field, oid);
 }
 
 
 oid_t file_snap_database_table::get_update_oid() const
 {
-    return static_cast<oid_t>(f_structure->get_uinteger("update_oid"));
+    return static_cast<oid_t>(get_static_field(g_update_oid_field));
 }
 
 
 void file_snap_database_table::set_update_oid(oid_t oid)
 {
-    f_structure->set_uinteger("update_oid", oid);
+    set_static_field(g_update_oid_field, oid);
 }
 
 
 reference_t file_snap_database_table::get_blobs_with_free_space() const
 {
-    return static_cast<reference_t>(f_structure->get_uinteger("blobs_with_free_space"));
+    return static_cast<reference_t>(get_static_field(g_blobs_with_free_space_field));
 }
 
 
 void file_snap_database_table::set_blobs_with_free_space(reference_t reference)
 {
-    f_structure->set_uinteger("blobs_with_free_space", reference);
+    set_static_field(g_blobs_with_free_space_field, reference);
 }
 
 
 reference_t file_snap_database_table::get_first_compactable_block() const
 {
-    return static_cast<reference_t>(f_structure->get_uinteger("first_compactable_block"));
+    return static_cast<reference_t>(get_static_field(g_first_compactable_block_field));
 }
 
 
 void file_snap_database_table::set_first_compactable_block(reference_t reference)
 {
-    f_structure->set_uinteger("first_compactable_block", reference);
+    set_static_field(g_first_compactable_block_field, reference);
 }
 
 
 reference_t file_snap_database_table::get_primary_index_block() const
 {
-    return static_cast<reference_t>(f_structure->get_uinteger("primary_index_block"));
+    return static_cast<reference_t>(get_static_field(g_primary_index_block_field));
 }
 
 
 void file_snap_database_table::set_primary_index_block(reference_t reference)
 {
-    f_structure->set_uinteger("primary_index_block", reference);
+    set_static_field(g_primary_index_block_field, reference);
 }
 
 
 reference_t file_snap_database_table::get_primary_index_reference_zero() const
 {
-    return static_cast<reference_t>(f_structure->get_uinteger("primary_index_reference_zero"));
+    return static_cast<reference_t>(get_static_field(g_primary_index_reference_zero_field));
 }
 
 
 void file_snap_database_table::set_primary_index_reference_zero(reference_t reference)
 {
-    f_structure->set_uinteger("primary_index_reference_zero", reference);
+    set_static_field(g_primary_index_reference_zero_field, reference);
 }
 
 
 reference_t file_snap_database_table::get_expiration_index_block() const
 {
-    return static_cast<reference_t>(f_structure->get_uinteger("expiration_index_block"));
+    return static_cast<reference_t>(get_static_field(g_expiration_index_block_field));
 }
 
 
 void file_snap_database_table::set_expiration_index_block(reference_t reference)
 {
-    f_structure->set_uinteger("expiration_index_block", reference);
+    set_static_field(g_expiration_index_block_field, reference);
 }
 
 
 reference_t file_snap_database_table::get_secondary_index_block() const
 {
-    return static_cast<reference_t>(f_structure->get_uinteger("secondary_index_block"));
+    return static_cast<reference_t>(get_static_field(g_secondary_index_block_field));
 }
 
 
 void file_snap_database_table::set_secondary_index_block(reference_t reference)
 {
-    f_structure->set_uinteger("secondary_index_block", reference);
+    set_static_field(g_secondary_index_block_field, reference);
 }
 
 
 reference_t file_snap_database_table::get_tree_index_block() const
 {
-    return static_cast<reference_t>(f_structure->get_uinteger("tree_index_block"));
+    return static_cast<reference_t>(get_static_field(g_tree_index_block_field));
 }
 
 
 void file_snap_database_table::set_tree_index_block(reference_t reference)
 {
-    f_structure->set_uinteger("tree_index_block", reference);
+    set_static_field(g_tree_index_block_field, reference);
 }
 
 
 reference_t file_snap_database_table::get_deleted_rows() const
 {
-    return static_cast<reference_t>(f_structure->get_uinteger("deleted_rows"));
+    return static_cast<reference_t>(get_static_field(g_deleted_rows_field));
 }
 
 
 void file_snap_database_table::set_deleted_rows(reference_t reference)
 {
-    f_structure->set_uinteger("deleted_rows", reference);
+    set_static_field(g_deleted_rows_field, reference);
 }
 
 
 reference_t file_snap_database_table::get_bloom_filter_flags() const
 {
-    return static_cast<reference_t>(f_structure->get_uinteger("bloom_filter_flags"));
+    return static_cast<reference_t>(get_static_field(g_bloom_filter_flags_field));
 }
 
 
 void file_snap_database_table::set_bloom_filter_flags(flags_t flags)
 {
-    f_structure->set_uinteger("bloom_filter_flags", flags);
+    set_static_field(g_bloom_filter_flags_field, static_cast<std::uint32_t>(flags));
+}
+
+
+bloom_filter_algorithm_t file_snap_database_table::get_bloom_filter_algorithm() const
+{
+    return static_cast<bloom_filter_algorithm_t>(f_structure->get_bits("bloom_filter_flags.algorithm"));
+}
+
+
+void file_snap_database_table::set_bloom_filter_algorithm(bloom_filter_algorithm_t algorithm)
+{
+    f_structure->set_bits("bloom_filter_flags.algorithm", static_cast<std::uint64_t>(algorithm));
 }
 
 
@@ -146,6 +146,8 @@ public:
     void                        set_deleted_rows(reference_t reference);
     reference_t                 get_bloom_filter_flags() const;
     void                        set_bloom_filter_flags(flags_t flags);
+    bloom_filter_algorithm_t    get_bloom_filter_algorithm() const;
+    void                        set_bloom_filter_algorithm(bloom_filter_algorithm_t algorithm);
 
 private:
     //schema_table::pointer_t     f_schema = schema_table::pointer_t();
@@ -0,0 +1,685 @@
+// Copyright (c) 2019  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapdatabase
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+/** \file
+ * \brief Client implementation.
+ *
+ * The client uses a blocking socket. The requests posted with post()
+ * are accumulated in an output buffer which gets written once it is
+ * large enough or when wait() gets called. Replies which arrive while
+ * waiting for another request are kept until their own wait(). In the
+ * same way, the changes which arrive are queued until next_change()
+ * gets called.
+ */
+
+// self
+//
+#include    "snapdatabase/network/client.h"
+
+#include    "snapdatabase/exception.h"
+
+
+// snapdev lib
+//
+#include    <snapdev/not_used.h>
+
+
+// C lib
+//
+#include    <netdb.h>
+#include    <netinet/in.h>
+#include    <netinet/tcp.h>
+#include    <poll.h>
+#include    <string.h>
+#include    <sys/socket.h>
+#include    <unistd.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace snapdatabase
+{
+
+
+
+namespace
+{
+
+
+
+constexpr std::size_t           READ_BUFFER_SIZE = 64 * 1024;
+constexpr std::size_t           OUTPUT_FLUSH_SIZE = 64 * 1024;
+
+
+
+}
+// no name namespace
+
+
+
+/** \brief Connect to a snapdatabase server.
+ *
+ * The constructor connects and sends the CONNECT command. It returns
+ * once the server acknowledged the connection.
+ *
+ * \exception io_error
+ * The connection failed.
+ *
+ * \exception protocol_error
+ * The server refused the connection (i.e. the protocol versions do not
+ * match).
+ *
+ * \param[in] address  The address or name of the server.
+ * \param[in] port  The port the server listens on.
+ * \param[in] name  The name of the client, used in the server logs.
+ */
+client::client(
+          std::string const & address
+        , std::uint16_t port
+        , std::string const & name)
+{
+    struct addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_NUMERICSERV;
+    struct addrinfo * info(nullptr);
+    int const r(getaddrinfo(address.c_str(), std::to_string(port).c_str(), &hints, &info));
+    if(r != 0)
+    {
+        throw invalid_parameter(
+                  "invalid snapdatabase server address \""
+                + address
+                + "\": "
+                + gai_strerror(r)
+                + ".");
+    }
+    std::shared_ptr<struct addrinfo> info_deleter(info, freeaddrinfo);
+
+    f_socket = socket(info->ai_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(f_socket == -1
+    || connect(f_socket, info->ai_addr, info->ai_addrlen) != 0)
+    {
+        int const e(errno);
+        if(f_socket != -1)
+        {
+            close(f_socket);
+        }
+        throw io_error(
+                  "could not connect to snapdatabase server \""
+                + address
+                + ":"
+                + std::to_string(port)
+                + "\" (errno: "
+                + std::to_string(e)
+                + ", "
+                + strerror(e)
+                + ").");
+    }
+
+    int const optval(1);
+    setsockopt(f_socket, IPPROTO_TCP, TCP_NODELAY, &optval, sizeof(optval));
+
+    try
+    {
+        message msg(command_t::COMMAND_CONNECT);
+        msg.add_uint32(PROTOCOL_VERSION);
+        msg.add_string(name);
+        message reply(wait(post(msg)));
+        if(!is_acknowledged(reply))
+        {
+            throw protocol_error("snapdatabase server refused the connection.");
+        }
+        snapdev::NOT_USED(reply.read_uint32());
+        f_server_version = reply.read_string();
+    }
+    catch(...)
+    {
+        close(f_socket);
+        throw;
+    }
+}
+
+
+client::~client()
+{
+    if(f_socket != -1)
+    {
+        close(f_socket);
+    }
+}
+
+
+std::string const & client::get_server_version() const
+{
+    return f_server_version;
+}
+
+
+/** \brief Send a request without waiting for its reply.
+ *
+ * The function assigns a new request identifier to \p msg. Use that
+ * identifier with wait() to retrieve the reply.
+ *
+ * The request may remain in the output buffer until wait() or flush()
+ * gets called.
+ *
+ * \param[in,out] msg  The request to send.
+ *
+ * \return The identifier of the request.
+ */
+request_id_t client::post(message & msg)
+{
+    ++f_next_request_id;
+    if(f_next_request_id == 0)
+    {
+        // 0 is used by the server for errors not tied to a request
+        //
+        f_next_request_id = 1;
+    }
+    msg.set_request_id(f_next_request_id);
+    msg.to_binary(f_output);
+
+    if(f_output.size() >= OUTPUT_FLUSH_SIZE)
+    {
+        write_output();
+    }
+
+    return f_next_request_id;
+}
+
+
+void client::flush()
+{
+    write_output();
+}
+
+
+/** \brief Wait for the reply of a request.
+ *
+ * \exception io_error
+ * The connection failed or was closed.
+ *
+ * \exception protocol_error
+ * The server closed the connection because of an invalid message.
+ *
+ * \param[in] request_id  The identifier returned by post().
+ *
+ * \return The reply.
+ */
+message client::wait(request_id_t request_id)
+{
+    write_output();
+
+    for(;;)
+    {
+        auto it(f_replies.find(request_id));
+        if(it != f_replies.end())
+        {
+            message const reply(it->second);
+            f_replies.erase(it);
+            return reply;
+        }
+
+        if(!read_input())
+        {
+            throw io_error("snapdatabase server closed the connection.");
+        }
+    }
+}
+
+
+void client::ping()
+{
+    message msg(command_t::COMMAND_PING);
+    if(!is_acknowledged(wait(post(msg))))
+    {
+        throw protocol_error("snapdatabase server did not acknowledge the PING.");
+    }
+}
+
+
+bool client::set(std::string const & table_name, buffer_t const & row_data)
+{
+    message msg(make_commit(command_t::COMMAND_SET, table_name, row_data));
+    return is_acknowledged(wait(post(msg)));
+}
+
+
+bool client::set(row::pointer_t row_data)
+{
+    return set(row_data->get_table()->name(), row_data->to_binary());
+}
+
+
+/** \brief Insert a new row.
+ *
+ * \return false if a row with the same key already exists.
+ */
+bool client::insert(std::string const & table_name, buffer_t const & row_data)
+{
+    message msg(make_commit(command_t::COMMAND_INSERT, table_name, row_data));
+    return is_acknowledged(wait(post(msg)));
+}
+
+
+bool client::insert(row::pointer_t row_data)
+{
+    return insert(row_data->get_table()->name(), row_data->to_binary());
+}
+
+
+/** \brief Update an existing row.
+ *
+ * \return false if no row with that key exists.
+ */
+bool client::update(std::string const & table_name, buffer_t const & row_data)
+{
+    message msg(make_commit(command_t::COMMAND_UPDATE, table_name, row_data));
+    return is_acknowledged(wait(post(msg)));
+}
+
+
+bool client::update(row::pointer_t row_data)
+{
+    return update(row_data->get_table()->name(), row_data->to_binary());
+}
+
+
+/** \brief Read a batch of rows.
+ *
+ * Each key is a row with the primary key columns set. The result has
+ * one entry per key, in the same order. Rows which do not exist are
+ * returned as an empty buffer.
+ *
+ * \param[in] table_name  The name of the table to read from.
+ * \param[in] keys  The binary rows with the primary key columns.
+ * \param[in] columns  The columns to return, all of them if empty.
+ *
+ * \return The binary rows.
+ */
+client::buffers_t client::get(
+          std::string const & table_name
+        , buffers_t const & keys
+        , column_names_t const & columns)
+{
+    message msg(make_get(table_name, keys, columns));
+    message reply(wait(post(msg)));
+    return read_rows(reply);
+}
+
+
+/** \brief Read a batch of rows.
+ *
+ * This is the same as the other get() but the rows get converted
+ * from and to row objects. Rows which do not exist are returned as
+ * nullptr.
+ */
+row::vector_t client::get(
+          table::pointer_t t
+        , row::vector_t const & keys
+        , column_names_t const & columns)
+{
+    buffers_t binary_keys;
+    binary_keys.reserve(keys.size());
+    for(auto const & k : keys)
+    {
+        binary_keys.push_back(k->to_binary());
+    }
+
+    row::vector_t result;
+    result.reserve(keys.size());
+    for(auto const & b : get(t->name(), binary_keys, columns))
+    {
+        if(b.empty())
+        {
+            result.push_back(row::pointer_t());
+        }
+        else
+        {
+            row::pointer_t r(t->row_new());
+            r->from_binary(b);
+            result.push_back(r);
+        }
+    }
+
+    return result;
+}
+
+
+/** \brief Listen for the changes made to a table.
+ *
+ * Once the server acknowledged the LISTEN, it sends a CHANGE message
+ * each time a row of that table gets committed. Use next_change() to
+ * retrieve them.
+ *
+ * To resume after a disconnection, pass the epoch returned by the
+ * previous listen() and the sequence of the last change you processed.
+ * The changes which happened in between get sent first. If some of
+ * them were lost (the feed is limited in size and does not survive
+ * a restart of the server) the f_lost flag of the result is true and
+ * you need to scan the table once to catch up. With an epoch of 0,
+ * you only receive the changes which happen from now on.
+ *
+ * \exception protocol_error
+ * The table does not exist.
+ *
+ * \param[in] table_name  The name of the table to listen to.
+ * \param[in] epoch  The epoch of the last change processed or 0.
+ * \param[in] sequence  The sequence of the last change processed.
+ *
+ * \return The identifier of the LISTEN and the state of the feed.
+ */
+client::listen_t client::listen(
+          std::string const & table_name
+        , std::int64_t epoch
+        , std::uint64_t sequence)
+{
+    message msg(command_t::COMMAND_LISTEN);
+    msg.add_string(table_name);
+    msg.add_uint64(epoch);
+    msg.add_uint64(sequence);
+
+    listen_t result;
+    result.f_request_id = post(msg);
+    message reply(wait(result.f_request_id));
+    is_acknowledged(reply);
+    result.f_epoch = reply.read_uint64();
+    result.f_sequence = reply.read_uint64();
+    result.f_lost = reply.read_uint8() != 0;
+    return result;
+}
+
+
+/** \brief Retrieve the next change.
+ *
+ * \exception io_error
+ * The connection failed or was closed.
+ *
+ * \param[out] change  The change.
+ * \param[out] listen_id  The request identifier of the listen() which
+ * this change is for.
+ * \param[in] timeout_ms  The maximum amount of time to wait for data
+ * from the server, -1 to wait until a change arrives.
+ *
+ * \return false if no change arrived within \p timeout_ms.
+ */
+bool client::next_change(change_t & change, request_id_t & listen_id, int timeout_ms)
+{
+    write_output();
+
+    while(f_changes.empty())
+    {
+        if(timeout_ms >= 0)
+        {
+            struct pollfd fd = {};
+            fd.fd = f_socket;
+            fd.events = POLLIN;
+            int const r(poll(&fd, 1, timeout_ms));
+            if(r == 0)
+            {
+                return false;
+            }
+            if(r < 0)
+            {
+                int const e(errno);
+                if(e == EINTR)
+                {
+                    continue;
+                }
+                throw io_error(
+                          "could not poll the snapdatabase server connection (errno: "
+                        + std::to_string(e)
+                        + ", "
+                        + strerror(e)
+                        + ").");
+            }
+        }
+
+        if(!read_input())
+        {
+            throw io_error("snapdatabase server closed the connection.");
+        }
+    }
+
+    listen_id = f_changes.front().first;
+    change = f_changes.front().second;
+    f_changes.pop_front();
+
+    return true;
+}
+
+
+/** \brief Close the connection.
+ *
+ * The server gets a chance to reply with BYE before the socket gets
+ * closed.
+ */
+void client::disconnect()
+{
+    if(f_socket == -1)
+    {
+        return;
+    }
+
+    message msg(command_t::COMMAND_DISCONNECT);
+    try
+    {
+        snapdev::NOT_USED(wait(post(msg)));
+    }
+    catch(io_error const &)
+    {
+        // the server may close the connection before we read the BYE
+    }
+    close(f_socket);
+    f_socket = -1;
+}
+
+
+message client::make_commit(
+          command_t command
+        , std::string const & table_name
+        , buffer_t const & row_data)
+{
+    message msg(command);
+    msg.add_string(table_name);
+    msg.add_buffer(row_data);
+    return msg;
+}
+
+
+message client::make_get(
+          std::string const & table_name
+        , buffers_t const & keys
+        , column_names_t const & columns)
+{
+    message msg(command_t::COMMAND_GET);
+    msg.add_string(table_name);
+    msg.add_uint16(columns.size());
+    for(auto const & c : columns)
+    {
+        msg.add_string(c);
+    }
+    msg.add_uint32(keys.size());
+    for(auto const & k : keys)
+    {
+        msg.add_buffer(k);
+    }
+    return msg;
+}
+
+
+/** \brief Check the status of an acknowledgement.
+ *
+ * \exception protocol_error
+ * The reply is an error other than a row which already exists (INSERT)
+ * or a row which does not exist (UPDATE). The error message sent by
+ * the server is included in the exception.
+ *
+ * \param[in] reply  The reply to check.
+ *
+ * \return true if the command succeeded.
+ */
+bool client::is_acknowledged(message const & reply)
+{
+    switch(reply.get_status())
+    {
+    case status_t::STATUS_OK:
+        return true;
+
+    case status_t::STATUS_ROW_ALREADY_EXISTS:
+    case status_t::STATUS_ROW_NOT_FOUND:
+        return false;
+
+    default:
+        {
+            message copy(reply);
+            std::string error_message;
+            if(!copy.end())
+            {
+                error_message = copy.read_string();
+            }
+            throw protocol_error(
+                      "snapdatabase server replied to request #"
+                    + std::to_string(reply.get_request_id())
+                    + " with error "
+                    + std::to_string(static_cast<int>(reply.get_status()))
+                    + ": "
+                    + error_message);
+        }
+
+    }
+}
+
+
+client::buffers_t client::read_rows(message & reply)
+{
+    if(reply.get_command() != command_t::COMMAND_ROWS)
+    {
+        is_acknowledged(reply);
+        throw protocol_error(
+                  std::string("expected ROWS from snapdatabase server, got ")
+                + command_to_string(reply.get_command())
+                + ".");
+    }
+
+    buffers_t result;
+    std::uint32_t const count(reply.read_uint32());
+    result.reserve(count);
+    for(std::uint32_t idx(0); idx < count; ++idx)
+    {
+        result.push_back(reply.read_buffer());
+    }
+    return result;
+}
+
+
+void client::write_output()
+{
+    std::size_t pos(0);
+    while(pos < f_output.size())
+    {
+        ssize_t const r(send(f_socket, f_output.data() + pos, f_output.size() - pos, MSG_NOSIGNAL));
+        if(r < 0)
+        {
+            int const e(errno);
+            if(e == EINTR)
+            {
+                continue;
+            }
+            throw io_error(
+                      "could not send data to the snapdatabase server (errno: "
+                    + std::to_string(e)
+                    + ", "
+                    + strerror(e)
+                    + ").");
+        }
+        pos += r;
+    }
+    f_output.clear();
+}
+
+
+/** \brief Read at least one reply.
+ *
+ * \return false if the server closed the connection.
+ */
+bool client::read_input()
+{
+    std::size_t const size(f_input.size());
+    f_input.resize(size + READ_BUFFER_SIZE);
+    ssize_t r(-1);
+    do
+    {
+        r = ::read(f_socket, f_input.data() + size, READ_BUFFER_SIZE);
+    }
+    while(r < 0 && errno == EINTR);
+    if(r <= 0)
+    {
+        f_input.resize(size);
+        return false;
+    }
+    f_input.resize(size + r);
+
+    std::size_t pos(0);
+    for(;;)
+    {
+        message msg;
+        std::size_t const used(message::from_binary(f_input.data() + pos, f_input.size() - pos, msg));
+        if(used == 0)
+        {
+            break;
+        }
+        pos += used;
+
+        if(msg.get_command() == command_t::COMMAND_BYE
+        && msg.get_request_id() == 0)
+        {
+            // the server gave up on us
+            //
+            is_acknowledged(msg);
+            throw io_error("snapdatabase server closed the connection.");
+        }
+
+        if(msg.get_command() == command_t::COMMAND_CHANGE)
+        {
+            change_t c;
+            c.f_sequence = msg.read_uint64();
+            c.f_type = static_cast<change_type_t>(msg.read_uint8());
+            c.f_date = msg.read_uint64();
+            c.f_row = msg.read_buffer();
+            f_changes.emplace_back(msg.get_request_id(), c);
+            continue;
+        }
+
+        f_replies[msg.get_request_id()] = msg;
+    }
+    f_input.erase(f_input.begin(), f_input.begin() + pos);
+
+    return true;
+}
+
+
+
+} // namespace snapdatabase
+// vim: ts=4 sw=4 et
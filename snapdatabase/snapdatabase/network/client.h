@@ -0,0 +1,137 @@
+// Copyright (c) 2019  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapdatabase
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+
+/** \file
+ * \brief Client connection to a snapdatabase server.
+ *
+ * The client connects to a server and sends it commands. The simple
+ * functions (ping(), set(), get(), etc.) send one request and wait for
+ * its reply.
+ *
+ * To pipeline requests, build the messages with the make_...() functions,
+ * send them with post(), and later retrieve the replies with wait().
+ *
+ * To be notified of the changes made to a table, call listen() and then
+ * next_change() to retrieve the changes as they arrive.
+ */
+
+// self
+//
+#include    "snapdatabase/database/change_feed.h"
+#include    "snapdatabase/database/row.h"
+#include    "snapdatabase/network/message.h"
+
+
+// C++ lib
+//
+#include    <deque>
+#include    <map>
+
+
+
+namespace snapdatabase
+{
+
+
+
+class client
+{
+public:
+    typedef std::shared_ptr<client>     pointer_t;
+    typedef std::vector<buffer_t>       buffers_t;
+
+    struct listen_t
+    {
+        request_id_t                    f_request_id = 0;
+        std::int64_t                    f_epoch = 0;
+        std::uint64_t                   f_sequence = 0;
+        bool                            f_lost = false;
+    };
+
+                                        client(
+                                              std::string const & address
+                                            , std::uint16_t port = DEFAULT_PORT
+                                            , std::string const & name = "snapdatabase-client");
+                                        client(client const & rhs) = delete;
+                                        ~client();
+
+    client &                            operator = (client const & rhs) = delete;
+
+    std::string const &                 get_server_version() const;
+
+    request_id_t                        post(message & msg);
+    void                                flush();
+    message                             wait(request_id_t request_id);
+
+    void                                ping();
+    bool                                set(std::string const & table_name, buffer_t const & row_data);
+    bool                                set(row::pointer_t row_data);
+    bool                                insert(std::string const & table_name, buffer_t const & row_data);
+    bool                                insert(row::pointer_t row_data);
+    bool                                update(std::string const & table_name, buffer_t const & row_data);
+    bool                                update(row::pointer_t row_data);
+    buffers_t                           get(
+                                              std::string const & table_name
+                                            , buffers_t const & keys
+                                            , column_names_t const & columns = column_names_t());
+    row::vector_t                       get(
+                                              table::pointer_t t
+                                            , row::vector_t const & keys
+                                            , column_names_t const & columns = column_names_t());
+    listen_t                            listen(
+                                              std::string const & table_name
+                                            , std::int64_t epoch = 0
+                                            , std::uint64_t sequence = 0);
+    bool                                next_change(
+                                              change_t & change
+                                            , request_id_t & listen_id
+                                            , int timeout_ms = -1);
+    void                                disconnect();
+
+    static message                      make_commit(
+                                              command_t command
+                                            , std::string const & table_name
+                                            , buffer_t const & row_data);
+    static message                      make_get(
+                                              std::string const & table_name
+                                            , buffers_t const & keys
+                                            , column_names_t const & columns = column_names_t());
+    static bool                         is_acknowledged(message const & reply);
+    static buffers_t                    read_rows(message & reply);
+
+private:
+    void                                write_output();
+    bool                                read_input();
+
+    int                                 f_socket = -1;
+    request_id_t                        f_next_request_id = 0;
+    std::string                         f_server_version = std::string();
+    buffer_t                            f_input = buffer_t();
+    buffer_t                            f_output = buffer_t();
+    std::map<request_id_t, message>     f_replies = std::map<request_id_t, message>();
+    std::deque<std::pair<request_id_t, change_t>>
+                                        f_changes = std::deque<std::pair<request_id_t, change_t>>();
+};
+
+
+
+} // namespace snapdatabase
+// vim: ts=4 sw=4 et
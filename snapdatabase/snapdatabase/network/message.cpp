@@ -0,0 +1,366 @@
+// Copyright (c) 2019  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapdatabase
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+/** \file
+ * \brief Message implementation.
+ *
+ * The frame header looks like this (all numbers in big endian):
+ *
+ * \code
+ *     char         f_magic[2];         // "SD"
+ *     uint8_t      f_command;          // command_t
+ *     uint8_t      f_status;           // status_t, 0 in requests
+ *     uint32_t     f_request_id;
+ *     uint32_t     f_size;             // size of the payload
+ * \endcode
+ *
+ * In the payload, the strings and buffers are saved as a 32 bit size
+ * followed by the data.
+ */
+
+// self
+//
+#include    "snapdatabase/network/message.h"
+
+#include    "snapdatabase/database/cell.h"
+#include    "snapdatabase/exception.h"
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace snapdatabase
+{
+
+
+
+namespace
+{
+
+
+
+constexpr std::uint8_t          g_magic[2] = { 'S', 'D' };
+
+
+
+}
+// no name namespace
+
+
+
+/** \brief Get the name of a command.
+ *
+ * This is used for error messages and logs.
+ *
+ * \param[in] command  The command to convert.
+ *
+ * \return The name of the command as found in doc/COMMANDS.md.
+ */
+char const * command_to_string(command_t command)
+{
+    switch(command)
+    {
+    case command_t::COMMAND_UNKNOWN:
+        return "UNKNOWN";
+
+    case command_t::COMMAND_CONNECT:
+        return "CONNECT";
+
+    case command_t::COMMAND_DISCONNECT:
+        return "DISCONNECT";
+
+    case command_t::COMMAND_SET:
+        return "SET";
+
+    case command_t::COMMAND_INSERT:
+        return "INSERT";
+
+    case command_t::COMMAND_UPDATE:
+        return "UPDATE";
+
+    case command_t::COMMAND_GET:
+        return "GET";
+
+    case command_t::COMMAND_DELETE:
+        return "DELETE";
+
+    case command_t::COMMAND_LOCK:
+        return "LOCK";
+
+    case command_t::COMMAND_PING:
+        return "PING";
+
+    case command_t::COMMAND_LISTEN:
+        return "LISTEN";
+
+    case command_t::COMMAND_ACKNOWLEDGEMENT:
+        return "ACKNOWLEDGEMENT";
+
+    case command_t::COMMAND_ROWS:
+        return "ROWS";
+
+    case command_t::COMMAND_CHANGE:
+        return "CHANGE";
+
+    case command_t::COMMAND_STATUS:
+        return "STATUS";
+
+    case command_t::COMMAND_BYE:
+        return "BYE";
+
+    }
+
+    return "UNKNOWN";
+}
+
+
+
+message::message(command_t command, request_id_t request_id, status_t status)
+    : f_command(command)
+    , f_status(status)
+    , f_request_id(request_id)
+{
+}
+
+
+command_t message::get_command() const
+{
+    return f_command;
+}
+
+
+request_id_t message::get_request_id() const
+{
+    return f_request_id;
+}
+
+
+void message::set_request_id(request_id_t request_id)
+{
+    f_request_id = request_id;
+}
+
+
+status_t message::get_status() const
+{
+    return f_status;
+}
+
+
+buffer_t const & message::get_payload() const
+{
+    return f_payload;
+}
+
+
+void message::add_uint8(std::uint8_t value)
+{
+    push_uint8(f_payload, value);
+}
+
+
+void message::add_uint16(std::uint16_t value)
+{
+    push_be_uint16(f_payload, value);
+}
+
+
+void message::add_uint32(std::uint32_t value)
+{
+    push_be_uint32(f_payload, value);
+}
+
+
+void message::add_uint64(std::uint64_t value)
+{
+    push_be_uint64(f_payload, value);
+}
+
+
+void message::add_string(std::string const & value)
+{
+    push_be_uint32(f_payload, value.length());
+    f_payload.insert(f_payload.end(), value.begin(), value.end());
+}
+
+
+void message::add_buffer(buffer_t const & value)
+{
+    push_be_uint32(f_payload, value.size());
+    f_payload.insert(f_payload.end(), value.begin(), value.end());
+}
+
+
+/** \brief Check whether all the payload was read.
+ *
+ * \return true once the read functions consumed the entire payload.
+ */
+bool message::end() const
+{
+    return f_position >= f_payload.size();
+}
+
+
+std::uint8_t message::read_uint8()
+{
+    verify_available(sizeof(std::uint8_t));
+    return snapdatabase::read_uint8(f_payload, f_position);
+}
+
+
+std::uint16_t message::read_uint16()
+{
+    verify_available(sizeof(std::uint16_t));
+    return read_be_uint16(f_payload, f_position);
+}
+
+
+std::uint32_t message::read_uint32()
+{
+    verify_available(sizeof(std::uint32_t));
+    return read_be_uint32(f_payload, f_position);
+}
+
+
+std::uint64_t message::read_uint64()
+{
+    verify_available(sizeof(std::uint64_t));
+    return read_be_uint64(f_payload, f_position);
+}
+
+
+std::string message::read_string()
+{
+    std::uint32_t const size(read_uint32());
+    verify_available(size);
+    std::string const result(
+              reinterpret_cast<char const *>(f_payload.data()) + f_position
+            , size);
+    f_position += size;
+    return result;
+}
+
+
+buffer_t message::read_buffer()
+{
+    std::uint32_t const size(read_uint32());
+    verify_available(size);
+    buffer_t const result(
+              f_payload.begin() + f_position
+            , f_payload.begin() + f_position + size);
+    f_position += size;
+    return result;
+}
+
+
+/** \brief Append the binary frame of this message to \p out.
+ *
+ * The frame gets appended so many messages can be written to the
+ * socket in one system call.
+ *
+ * \param[in,out] out  The buffer receiving the frame.
+ */
+void message::to_binary(buffer_t & out) const
+{
+    out.reserve(out.size() + MESSAGE_HEADER_SIZE + f_payload.size());
+    push_uint8(out, g_magic[0]);
+    push_uint8(out, g_magic[1]);
+    push_uint8(out, static_cast<std::uint8_t>(f_command));
+    push_uint8(out, static_cast<std::uint8_t>(f_status));
+    push_be_uint32(out, f_request_id);
+    push_be_uint32(out, f_payload.size());
+    out.insert(out.end(), f_payload.begin(), f_payload.end());
+}
+
+
+/** \brief Extract one message from a buffer.
+ *
+ * The buffer may include less than one message, in which case the
+ * function returns 0 and \p msg is not modified. The caller is expected
+ * to read more data and try again.
+ *
+ * \exception protocol_error
+ * The buffer does not start with a valid frame header or the payload
+ * is larger than MAXIMUM_PAYLOAD_SIZE. The connection cannot be used
+ * any further.
+ *
+ * \param[in] data  The received data.
+ * \param[in] size  The number of bytes in \p data.
+ * \param[out] msg  The message receiving the frame.
+ *
+ * \return The number of bytes used by the frame or 0.
+ */
+std::size_t message::from_binary(const_data_t data, std::size_t size, message & msg)
+{
+    if(size < MESSAGE_HEADER_SIZE)
+    {
+        return 0;
+    }
+
+    if(data[0] != g_magic[0]
+    || data[1] != g_magic[1])
+    {
+        throw protocol_error("invalid magic in snapdatabase message header.");
+    }
+
+    std::size_t pos(4);
+    request_id_t const request_id(read_be_uint32(data, pos));
+    std::uint32_t const payload_size(read_be_uint32(data, pos));
+    if(payload_size > MAXIMUM_PAYLOAD_SIZE)
+    {
+        throw protocol_error(
+                  "snapdatabase message payload of "
+                + std::to_string(payload_size)
+                + " bytes is too large.");
+    }
+
+    if(size < MESSAGE_HEADER_SIZE + payload_size)
+    {
+        return 0;
+    }
+
+    msg.f_command = static_cast<command_t>(data[2]);
+    msg.f_status = static_cast<status_t>(data[3]);
+    msg.f_request_id = request_id;
+    msg.f_payload.assign(data + MESSAGE_HEADER_SIZE, data + MESSAGE_HEADER_SIZE + payload_size);
+    msg.f_position = 0;
+
+    return MESSAGE_HEADER_SIZE + payload_size;
+}
+
+
+void message::verify_available(std::size_t size) const
+{
+    if(f_position + size > f_payload.size())
+    {
+        throw protocol_error(
+                  std::string("payload of snapdatabase message ")
+                + command_to_string(f_command)
+                + " is too short.");
+    }
+}
+
+
+
+} // namespace snapdatabase
+// vim: ts=4 sw=4 et
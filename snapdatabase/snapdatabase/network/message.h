@@ -0,0 +1,146 @@
+// Copyright (c) 2019  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapdatabase
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+
+/** \file
+ * \brief Messages sent between the clients and the snapdatabase daemon.
+ *
+ * Each message is a small binary frame: a 12 byte header followed by
+ * the payload. The header includes the command, a status (used by the
+ * replies), the request identifier, and the size of the payload.
+ *
+ * The request identifier is chosen by the client and copied in the
+ * reply. This allows the client to send many requests without waiting
+ * for the replies (pipelining). The server replies in the order in
+ * which it received the requests.
+ *
+ * See doc/COMMANDS.md for the payload of each command.
+ */
+
+// self
+//
+#include    "snapdatabase/data/virtual_buffer.h"
+
+
+
+namespace snapdatabase
+{
+
+
+
+typedef std::uint32_t                   request_id_t;
+
+constexpr std::uint32_t                 PROTOCOL_VERSION = 1;
+constexpr std::uint16_t                 DEFAULT_PORT = 4012;
+constexpr std::size_t                   MESSAGE_HEADER_SIZE = 12;
+constexpr std::uint32_t                 MAXIMUM_PAYLOAD_SIZE = 64 * 1024 * 1024;
+
+
+enum class command_t : std::uint8_t
+{
+    COMMAND_UNKNOWN = 0,
+
+    // requests
+    //
+    COMMAND_CONNECT = 1,
+    COMMAND_DISCONNECT = 2,
+    COMMAND_SET = 3,
+    COMMAND_INSERT = 4,
+    COMMAND_UPDATE = 5,
+    COMMAND_GET = 6,
+    COMMAND_DELETE = 7,
+    COMMAND_LOCK = 8,
+    COMMAND_PING = 9,
+    COMMAND_LISTEN = 10,
+
+    // replies
+    //
+    COMMAND_ACKNOWLEDGEMENT = 128,
+    COMMAND_ROWS = 129,
+    COMMAND_CHANGE = 130,
+    COMMAND_STATUS = 131,
+    COMMAND_BYE = 132,
+};
+
+
+enum class status_t : std::uint8_t
+{
+    STATUS_OK = 0,
+    STATUS_INVALID_MESSAGE = 1,
+    STATUS_UNKNOWN_COMMAND = 2,
+    STATUS_NOT_IMPLEMENTED = 3,
+    STATUS_TABLE_NOT_FOUND = 4,
+    STATUS_ROW_ALREADY_EXISTS = 5,
+    STATUS_ROW_NOT_FOUND = 6,
+    STATUS_FAILED = 7,
+};
+
+
+char const *                            command_to_string(command_t command);
+
+
+class message
+{
+public:
+    typedef std::vector<message>        vector_t;
+
+                                        message(
+                                              command_t command = command_t::COMMAND_UNKNOWN
+                                            , request_id_t request_id = 0
+                                            , status_t status = status_t::STATUS_OK);
+
+    command_t                           get_command() const;
+    request_id_t                        get_request_id() const;
+    void                                set_request_id(request_id_t request_id);
+    status_t                            get_status() const;
+    buffer_t const &                    get_payload() const;
+
+    void                                add_uint8(std::uint8_t value);
+    void                                add_uint16(std::uint16_t value);
+    void                                add_uint32(std::uint32_t value);
+    void                                add_uint64(std::uint64_t value);
+    void                                add_string(std::string const & value);
+    void                                add_buffer(buffer_t const & value);
+
+    bool                                end() const;
+    std::uint8_t                        read_uint8();
+    std::uint16_t                       read_uint16();
+    std::uint32_t                       read_uint32();
+    std::uint64_t                       read_uint64();
+    std::string                         read_string();
+    buffer_t                            read_buffer();
+
+    void                                to_binary(buffer_t & out) const;
+    static std::size_t                  from_binary(const_data_t data, std::size_t size, message & msg);
+
+private:
+    void                                verify_available(std::size_t size) const;
+
+    command_t                           f_command = command_t::COMMAND_UNKNOWN;
+    status_t                            f_status = status_t::STATUS_OK;
+    request_id_t                        f_request_id = 0;
+    buffer_t                            f_payload = buffer_t();
+    std::size_t                         f_position = 0;
+};
+
+
+
+} // namespace snapdatabase
+// vim: ts=4 sw=4 et
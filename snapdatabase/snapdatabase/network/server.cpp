@@ -0,0 +1,1193 @@
+// Copyright (c) 2019  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapdatabase
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+/** \file
+ * \brief Server implementation.
+ *
+ * The server uses epoll() to handle all of its sockets in one thread.
+ * Each connection has an input and an output buffer. Whenever data
+ * arrives, all the complete messages found in the input buffer get
+ * executed one after the other and their replies are appended to the
+ * output buffer. The output buffer is then written in one system call.
+ * This way a client which pipelines its requests gets all the replies
+ * of one batch in one write().
+ *
+ * If a client does not read its replies, we stop executing its requests
+ * once its output buffer is over MAXIMUM_PENDING_OUTPUT bytes. We also
+ * stop reading from that client until the output buffer was sent so its
+ * input buffer does not grow either. The input buffer is otherwise
+ * limited to one frame of the maximum size (MAXIMUM_PENDING_INPUT).
+ *
+ * A connection which sent a LISTEN gets a listener added to the change
+ * feed of that table. The listener appends a CHANGE message to the
+ * output buffer of the connection each time a row gets committed and
+ * the buffer gets written at the end of the current batch of events.
+ * A listener which does not read its changes gets disconnected once
+ * its output buffer reaches MAXIMUM_LISTENER_OUTPUT bytes. It can then
+ * reconnect and resume from the last change it received.
+ */
+
+// self
+//
+#include    "snapdatabase/network/server.h"
+
+#include    "snapdatabase/data/commit_log.h"
+#include    "snapdatabase/database/row.h"
+#include    "snapdatabase/exception.h"
+#include    "snapdatabase/version.h"
+
+
+// snaplogger lib
+//
+#include    <snaplogger/message.h>
+
+
+// C++ lib
+//
+#include    <algorithm>
+#include    <map>
+#include    <set>
+
+
+// C lib
+//
+#include    <netdb.h>
+#include    <netinet/in.h>
+#include    <netinet/tcp.h>
+#include    <string.h>
+#include    <sys/epoll.h>
+#include    <sys/eventfd.h>
+#include    <sys/socket.h>
+#include    <unistd.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace snapdatabase
+{
+
+
+
+namespace detail
+{
+
+
+
+namespace
+{
+
+
+
+constexpr std::size_t           READ_BUFFER_SIZE = 64 * 1024;
+constexpr std::size_t           MAXIMUM_PENDING_OUTPUT = 16 * 1024 * 1024;
+constexpr std::size_t           MAXIMUM_LISTENER_OUTPUT = MAXIMUM_PENDING_OUTPUT * 2;
+constexpr std::size_t           MAXIMUM_PENDING_INPUT = snapdatabase::MESSAGE_HEADER_SIZE + snapdatabase::MAXIMUM_PAYLOAD_SIZE;
+constexpr int                   MAXIMUM_EVENTS = 64;
+constexpr int                   LISTEN_BACKLOG = 128;
+
+
+
+}
+// no name namespace
+
+
+
+class server_impl
+{
+public:
+                                        server_impl(
+                                              context::pointer_t c
+                                            , std::string const & address
+                                            , std::uint16_t port);
+                                        server_impl(server_impl const & rhs) = delete;
+                                        ~server_impl();
+
+    server_impl &                       operator = (server_impl const & rhs) = delete;
+
+    std::uint16_t                       get_port() const;
+    void                                run();
+    bool                                process_events(int timeout_ms);
+    void                                stop();
+    server::statistics_t                get_statistics() const;
+
+private:
+    typedef std::vector<std::pair<change_feed::pointer_t, change_feed::listener_id_t>>
+                                        listeners_t;
+
+    struct connection_t
+    {
+        int                             f_socket = -1;
+        buffer_t                        f_input = buffer_t();
+        buffer_t                        f_output = buffer_t();
+        std::size_t                     f_output_position = 0;
+        std::uint32_t                   f_events = EPOLLIN;
+        bool                            f_writing = false;
+        bool                            f_closing = false;
+        listeners_t                     f_listeners = listeners_t();
+    };
+
+    typedef std::map<int, connection_t> connection_map_t;
+
+    void                                open_listener(std::string const & address, std::uint16_t port);
+    void                                accept_connections();
+    bool                                read_connection(connection_t & conn);
+    bool                                write_connection(connection_t & conn);
+    void                                update_events(connection_t & conn);
+    void                                close_connection(int s);
+    void                                process_input(connection_t & conn);
+    void                                process_message(connection_t & conn, message & msg);
+    void                                execute_connect(message & msg, message & reply);
+    void                                execute_commit(message & msg, message & reply);
+    void                                execute_get(message & msg, message & reply);
+    void                                execute_listen(
+                                              connection_t & conn
+                                            , message & msg
+                                            , message & reply
+                                            , change_t::vector_t & backlog);
+    void                                push_change(
+                                              int s
+                                            , request_id_t request_id
+                                            , change_t const & change);
+    void                                write_pending();
+    table::pointer_t                    get_table(message & msg);
+    void                                sync_commit_logs();
+
+    context::pointer_t                  f_context = context::pointer_t();
+    int                                 f_epoll = -1;
+    int                                 f_listener = -1;
+    int                                 f_stop = -1;
+    std::uint16_t                       f_port = 0;
+    bool                                f_stopped = false;
+    int                                 f_sync_timeout = -1;
+    connection_map_t                    f_connections = connection_map_t();
+    std::set<int>                       f_pending = std::set<int>();
+    server::statistics_t                f_statistics = server::statistics_t();
+};
+
+
+
+server_impl::server_impl(
+          context::pointer_t c
+        , std::string const & address
+        , std::uint16_t port)
+    : f_context(c)
+{
+    f_epoll = epoll_create1(EPOLL_CLOEXEC);
+    if(f_epoll == -1)
+    {
+        int const e(errno);
+        throw io_error(
+                  "could not create the epoll of the snapdatabase server (errno: "
+                + std::to_string(e)
+                + ", "
+                + strerror(e)
+                + ").");
+    }
+
+    f_stop = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(f_stop == -1)
+    {
+        int const e(errno);
+        close(f_epoll);
+        throw io_error(
+                  "could not create the stop event of the snapdatabase server (errno: "
+                + std::to_string(e)
+                + ", "
+                + strerror(e)
+                + ").");
+    }
+
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = f_stop;
+    epoll_ctl(f_epoll, EPOLL_CTL_ADD, f_stop, &event);
+
+    try
+    {
+        open_listener(address, port);
+    }
+    catch(...)
+    {
+        close(f_stop);
+        close(f_epoll);
+        throw;
+    }
+}
+
+
+server_impl::~server_impl()
+{
+    while(!f_connections.empty())
+    {
+        close_connection(f_connections.begin()->first);
+    }
+    if(f_listener != -1)
+    {
+        close(f_listener);
+    }
+    close(f_stop);
+    close(f_epoll);
+}
+
+
+void server_impl::open_listener(std::string const & address, std::uint16_t port)
+{
+    struct addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE | AI_NUMERICHOST | AI_NUMERICSERV;
+    struct addrinfo * info(nullptr);
+    int const r(getaddrinfo(
+              address.empty() ? nullptr : address.c_str()
+            , std::to_string(port).c_str()
+            , &hints
+            , &info));
+    if(r != 0)
+    {
+        throw invalid_parameter(
+                  "invalid snapdatabase server address \""
+                + address
+                + "\": "
+                + gai_strerror(r)
+                + ".");
+    }
+    std::shared_ptr<struct addrinfo> info_deleter(info, freeaddrinfo);
+
+    f_listener = socket(info->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(f_listener == -1)
+    {
+        int const e(errno);
+        throw io_error(
+                  "could not create the snapdatabase server socket (errno: "
+                + std::to_string(e)
+                + ", "
+                + strerror(e)
+                + ").");
+    }
+
+    int const optval(1);
+    setsockopt(f_listener, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+
+    if(bind(f_listener, info->ai_addr, info->ai_addrlen) != 0
+    || listen(f_listener, LISTEN_BACKLOG) != 0)
+    {
+        int const e(errno);
+        close(f_listener);
+        f_listener = -1;
+        throw io_error(
+                  "could not listen on \""
+                + address
+                + ":"
+                + std::to_string(port)
+                + "\" (errno: "
+                + std::to_string(e)
+                + ", "
+                + strerror(e)
+                + ").");
+    }
+
+    // when port 0 is used, the system chooses the port
+    //
+    struct sockaddr_storage addr = {};
+    socklen_t addr_len(sizeof(addr));
+    getsockname(f_listener, reinterpret_cast<struct sockaddr *>(&addr), &addr_len);
+    if(addr.ss_family == AF_INET6)
+    {
+        f_port = ntohs(reinterpret_cast<struct sockaddr_in6 *>(&addr)->sin6_port);
+    }
+    else
+    {
+        f_port = ntohs(reinterpret_cast<struct sockaddr_in *>(&addr)->sin_port);
+    }
+
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = f_listener;
+    epoll_ctl(f_epoll, EPOLL_CTL_ADD, f_listener, &event);
+
+    SNAP_LOG_NOTICE
+        << "snapdatabase server listening on \""
+        << address
+        << ":"
+        << f_port
+        << "\"."
+        << SNAP_LOG_SEND;
+}
+
+
+std::uint16_t server_impl::get_port() const
+{
+    return f_port;
+}
+
+
+void server_impl::run()
+{
+    while(process_events(-1));
+}
+
+
+bool server_impl::process_events(int timeout_ms)
+{
+    if(f_stopped)
+    {
+        return false;
+    }
+
+    // wake up in time to synchronize the rows waiting for their group
+    // commit, even if no more rows get committed
+    //
+    if(f_sync_timeout != -1
+    && (timeout_ms == -1 || f_sync_timeout < timeout_ms))
+    {
+        timeout_ms = f_sync_timeout;
+    }
+
+    struct epoll_event events[MAXIMUM_EVENTS];
+    int const count(epoll_wait(f_epoll, events, MAXIMUM_EVENTS, timeout_ms));
+    if(count == -1)
+    {
+        int const e(errno);
+        if(e == EINTR)
+        {
+            return true;
+        }
+        throw io_error(
+                  "epoll_wait() failed in the snapdatabase server (errno: "
+                + std::to_string(e)
+                + ", "
+                + strerror(e)
+                + ").");
+    }
+
+    for(int idx(0); idx < count; ++idx)
+    {
+        int const s(events[idx].data.fd);
+        if(s == f_stop)
+        {
+            std::uint64_t value(0);
+            if(read(f_stop, &value, sizeof(value)) == sizeof(value))
+            {
+                f_stopped = true;
+            }
+            continue;
+        }
+        if(s == f_listener)
+        {
+            accept_connections();
+            continue;
+        }
+
+        auto it(f_connections.find(s));
+        if(it == f_connections.end())
+        {
+            // closed by a previous event of this batch
+            //
+            continue;
+        }
+
+        bool keep(true);
+        if((events[idx].events & (EPOLLERR | EPOLLHUP)) != 0
+        && (events[idx].events & EPOLLIN) == 0)
+        {
+            keep = false;
+        }
+        if(keep
+        && (events[idx].events & EPOLLIN) != 0)
+        {
+            keep = read_connection(it->second);
+        }
+        if(keep)
+        {
+            keep = write_connection(it->second);
+        }
+        if(!keep)
+        {
+            close_connection(s);
+        }
+    }
+
+    write_pending();
+    sync_commit_logs();
+
+    return !f_stopped;
+}
+
+
+/** \brief Request the server to stop.
+ *
+ * This function can be called from any thread or from a signal handler.
+ * The event loop returns once it wakes up.
+ */
+void server_impl::stop()
+{
+    std::uint64_t const value(1);
+    if(write(f_stop, &value, sizeof(value)) != sizeof(value))
+    {
+        // the counter can only overflow after 2^64 calls
+        //
+        f_stopped = true;
+    }
+}
+
+
+server::statistics_t server_impl::get_statistics() const
+{
+    return f_statistics;
+}
+
+
+void server_impl::accept_connections()
+{
+    for(;;)
+    {
+        int const s(accept4(f_listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC));
+        if(s == -1)
+        {
+            int const e(errno);
+            if(e != EAGAIN
+            && e != EWOULDBLOCK
+            && e != EINTR)
+            {
+                SNAP_LOG_ERROR
+                    << "accept() failed in the snapdatabase server (errno: "
+                    << e
+                    << ", "
+                    << strerror(e)
+                    << ")."
+                    << SNAP_LOG_SEND;
+            }
+            return;
+        }
+
+        // replies are small, we do not want them delayed
+        //
+        int const optval(1);
+        setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &optval, sizeof(optval));
+
+        struct epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = s;
+        if(epoll_ctl(f_epoll, EPOLL_CTL_ADD, s, &event) != 0)
+        {
+            close(s);
+            continue;
+        }
+
+        f_connections[s].f_socket = s;
+        ++f_statistics.f_connections;
+    }
+}
+
+
+/** \brief Read the data available on a connection.
+ *
+ * The input buffer never grows over MAXIMUM_PENDING_INPUT bytes. When
+ * full, the messages it holds get executed to make room. If that is
+ * not possible because the client does not read its replies, we stop
+ * reading until the output buffer was sent.
+ *
+ * \param[in] conn  The connection to read from.
+ *
+ * \return false if the connection needs to be closed.
+ */
+bool server_impl::read_connection(connection_t & conn)
+{
+    for(;;)
+    {
+        if(conn.f_input.size() >= MAXIMUM_PENDING_INPUT)
+        {
+            process_input(conn);
+            if(conn.f_input.size() >= MAXIMUM_PENDING_INPUT)
+            {
+                break;
+            }
+        }
+        if(conn.f_closing
+        || conn.f_output.size() - conn.f_output_position >= MAXIMUM_PENDING_OUTPUT)
+        {
+            break;
+        }
+
+        std::size_t const size(conn.f_input.size());
+        std::size_t const available(std::min(READ_BUFFER_SIZE, MAXIMUM_PENDING_INPUT - size));
+        conn.f_input.resize(size + available);
+        ssize_t const r(read(conn.f_socket, conn.f_input.data() + size, available));
+        if(r <= 0)
+        {
+            conn.f_input.resize(size);
+            if(r == 0)
+            {
+                // the client closed its side
+                //
+                return false;
+            }
+            int const e(errno);
+            if(e == EAGAIN
+            || e == EWOULDBLOCK)
+            {
+                break;
+            }
+            if(e != EINTR)
+            {
+                return false;
+            }
+            continue;
+        }
+        conn.f_input.resize(size + r);
+        f_statistics.f_bytes_received += r;
+
+        if(static_cast<std::size_t>(r) < available)
+        {
+            break;
+        }
+    }
+
+    process_input(conn);
+    update_events(conn);
+
+    return true;
+}
+
+
+/** \brief Write the pending replies of a connection.
+ *
+ * If the socket does not accept all the data, the connection waits
+ * for EPOLLOUT. Once all the data was sent, the requests which were
+ * left in the input buffer, if any, get executed.
+ *
+ * \param[in] conn  The connection to write to.
+ *
+ * \return false if the connection needs to be closed.
+ */
+bool server_impl::write_connection(connection_t & conn)
+{
+    while(conn.f_output_position < conn.f_output.size())
+    {
+        ssize_t const r(send(
+                  conn.f_socket
+                , conn.f_output.data() + conn.f_output_position
+                , conn.f_output.size() - conn.f_output_position
+                , MSG_NOSIGNAL));
+        if(r < 0)
+        {
+            int const e(errno);
+            if(e == EAGAIN
+            || e == EWOULDBLOCK)
+            {
+                conn.f_writing = true;
+                update_events(conn);
+                return true;
+            }
+            if(e != EINTR)
+            {
+                return false;
+            }
+            continue;
+        }
+        conn.f_output_position += r;
+        f_statistics.f_bytes_sent += r;
+    }
+
+    conn.f_output.clear();
+    conn.f_output_position = 0;
+    conn.f_writing = false;
+
+    if(conn.f_closing)
+    {
+        return false;
+    }
+
+    if(!conn.f_input.empty())
+    {
+        // we may have stopped because of MAXIMUM_PENDING_OUTPUT
+        //
+        process_input(conn);
+        if(!conn.f_output.empty())
+        {
+            return write_connection(conn);
+        }
+    }
+
+    update_events(conn);
+
+    return true;
+}
+
+
+/** \brief Update the events epoll() reports for a connection.
+ *
+ * We wait for EPOLLOUT while the output buffer could not be sent in
+ * full. We wait for EPOLLIN unless the connection is closing or its
+ * input or output buffer is full. Since epoll() is level triggered,
+ * the data left in the socket gets reported again once EPOLLIN gets
+ * restored.
+ *
+ * \param[in] conn  The connection to update.
+ */
+void server_impl::update_events(connection_t & conn)
+{
+    std::uint32_t events(0);
+    if(!conn.f_closing
+    && conn.f_input.size() < MAXIMUM_PENDING_INPUT
+    && conn.f_output.size() - conn.f_output_position < MAXIMUM_PENDING_OUTPUT)
+    {
+        events |= EPOLLIN;
+    }
+    if(conn.f_writing)
+    {
+        events |= EPOLLOUT;
+    }
+    if(events == conn.f_events)
+    {
+        return;
+    }
+
+    struct epoll_event event = {};
+    event.events = events;
+    event.data.fd = conn.f_socket;
+    epoll_ctl(f_epoll, EPOLL_CTL_MOD, conn.f_socket, &event);
+    conn.f_events = events;
+}
+
+
+void server_impl::close_connection(int s)
+{
+    auto it(f_connections.find(s));
+    if(it != f_connections.end())
+    {
+        for(auto const & l : it->second.f_listeners)
+        {
+            l.first->remove_listener(l.second);
+        }
+        f_connections.erase(it);
+    }
+    f_pending.erase(s);
+
+    epoll_ctl(f_epoll, EPOLL_CTL_DEL, s, nullptr);
+    close(s);
+}
+
+
+/** \brief Write the changes pushed to the listening connections.
+ *
+ * Executing the requests of one connection may add CHANGE messages to
+ * the output buffers of other connections. This function writes those
+ * buffers once the current batch of events was processed.
+ */
+void server_impl::write_pending()
+{
+    while(!f_pending.empty())
+    {
+        std::set<int> pending;
+        pending.swap(f_pending);
+        for(auto const s : pending)
+        {
+            auto it(f_connections.find(s));
+            if(it != f_connections.end()
+            && !write_connection(it->second))
+            {
+                close_connection(s);
+            }
+        }
+    }
+}
+
+
+/** \brief Execute the complete messages found in the input buffer.
+ *
+ * The replies are appended to the output buffer in the same order.
+ *
+ * \param[in] conn  The connection which received data.
+ */
+void server_impl::process_input(connection_t & conn)
+{
+    std::size_t pos(0);
+    try
+    {
+        while(!conn.f_closing
+           && conn.f_output.size() - conn.f_output_position < MAXIMUM_PENDING_OUTPUT)
+        {
+            message msg;
+            std::size_t const size(message::from_binary(
+                      conn.f_input.data() + pos
+                    , conn.f_input.size() - pos
+                    , msg));
+            if(size == 0)
+            {
+                break;
+            }
+            pos += size;
+
+            process_message(conn, msg);
+        }
+    }
+    catch(protocol_error const & e)
+    {
+        // we cannot find the start of the next message, give up on
+        // this client
+        //
+        SNAP_LOG_ERROR
+            << "invalid data received by the snapdatabase server: "
+            << e.what()
+            << SNAP_LOG_SEND;
+
+        message reply(command_t::COMMAND_BYE, 0, status_t::STATUS_INVALID_MESSAGE);
+        reply.add_string(e.what());
+        reply.to_binary(conn.f_output);
+        conn.f_closing = true;
+        ++f_statistics.f_errors;
+        pos = conn.f_input.size();
+    }
+
+    conn.f_input.erase(conn.f_input.begin(), conn.f_input.begin() + pos);
+}
+
+
+void server_impl::process_message(connection_t & conn, message & msg)
+{
+    ++f_statistics.f_requests;
+
+    message reply(command_t::COMMAND_ACKNOWLEDGEMENT, msg.get_request_id());
+    change_t::vector_t backlog;
+    try
+    {
+        switch(msg.get_command())
+        {
+        case command_t::COMMAND_CONNECT:
+            execute_connect(msg, reply);
+            break;
+
+        case command_t::COMMAND_DISCONNECT:
+            reply = message(command_t::COMMAND_BYE, msg.get_request_id());
+            conn.f_closing = true;
+            break;
+
+        case command_t::COMMAND_PING:
+            break;
+
+        case command_t::COMMAND_SET:
+        case command_t::COMMAND_INSERT:
+        case command_t::COMMAND_UPDATE:
+            execute_commit(msg, reply);
+            break;
+
+        case command_t::COMMAND_GET:
+            execute_get(msg, reply);
+            break;
+
+        case command_t::COMMAND_LISTEN:
+            execute_listen(conn, msg, reply, backlog);
+            break;
+
+        case command_t::COMMAND_DELETE:
+        case command_t::COMMAND_LOCK:
+            reply = message(command_t::COMMAND_ACKNOWLEDGEMENT, msg.get_request_id(), status_t::STATUS_NOT_IMPLEMENTED);
+            reply.add_string(std::string(command_to_string(msg.get_command())) + " is not yet implemented.");
+            break;
+
+        default:
+            reply = message(command_t::COMMAND_ACKNOWLEDGEMENT, msg.get_request_id(), status_t::STATUS_UNKNOWN_COMMAND);
+            reply.add_string("unknown command " + std::to_string(static_cast<int>(msg.get_command())) + ".");
+            break;
+
+        }
+    }
+    catch(protocol_error const & e)
+    {
+        reply = message(command_t::COMMAND_ACKNOWLEDGEMENT, msg.get_request_id(), status_t::STATUS_INVALID_MESSAGE);
+        reply.add_string(e.what());
+    }
+    catch(row_already_exists const & e)
+    {
+        reply = message(command_t::COMMAND_ACKNOWLEDGEMENT, msg.get_request_id(), status_t::STATUS_ROW_ALREADY_EXISTS);
+        reply.add_string(e.what());
+    }
+    catch(row_not_found const & e)
+    {
+        reply = message(command_t::COMMAND_ACKNOWLEDGEMENT, msg.get_request_id(), status_t::STATUS_ROW_NOT_FOUND);
+        reply.add_string(e.what());
+    }
+    catch(std::exception const & e)
+    {
+        reply = message(command_t::COMMAND_ACKNOWLEDGEMENT, msg.get_request_id(), status_t::STATUS_FAILED);
+        reply.add_string(e.what());
+    }
+
+    if(reply.get_status() != status_t::STATUS_OK)
+    {
+        ++f_statistics.f_errors;
+    }
+
+    reply.to_binary(conn.f_output);
+
+    for(auto const & c : backlog)
+    {
+        push_change(conn.f_socket, msg.get_request_id(), c);
+    }
+}
+
+
+void server_impl::execute_connect(message & msg, message & reply)
+{
+    std::uint32_t const version(msg.read_uint32());
+    std::string const name(msg.read_string());
+    if(version != PROTOCOL_VERSION)
+    {
+        reply = message(command_t::COMMAND_ACKNOWLEDGEMENT, msg.get_request_id(), status_t::STATUS_INVALID_MESSAGE);
+        reply.add_string(
+                  "client \""
+                + name
+                + "\" uses protocol version "
+                + std::to_string(version)
+                + ", expected "
+                + std::to_string(PROTOCOL_VERSION)
+                + ".");
+        return;
+    }
+
+    reply.add_uint32(PROTOCOL_VERSION);
+    reply.add_string(SNAPDATABASE_VERSION_STRING);
+}
+
+
+void server_impl::execute_commit(message & msg, message & reply)
+{
+    table::pointer_t t(get_table(msg));
+    if(t == nullptr)
+    {
+        reply = message(command_t::COMMAND_ACKNOWLEDGEMENT, msg.get_request_id(), status_t::STATUS_TABLE_NOT_FOUND);
+        reply.add_string("table not found.");
+        return;
+    }
+
+    row::pointer_t r(t->row_new());
+    r->from_binary(msg.read_buffer());
+
+    switch(msg.get_command())
+    {
+    case command_t::COMMAND_INSERT:
+        t->row_insert(r);
+        break;
+
+    case command_t::COMMAND_UPDATE:
+        t->row_update(r);
+        break;
+
+    default:
+        t->row_commit(r);
+        break;
+
+    }
+}
+
+
+/** \brief Read a batch of rows.
+ *
+ * The message includes the list of columns to return (all the columns
+ * if empty) and the list of keys. Each key is a row including the
+ * primary key columns.
+ *
+ * The reply includes one row per key, in the same order. A row which
+ * does not exist is returned as an empty buffer.
+ */
+void server_impl::execute_get(message & msg, message & reply)
+{
+    table::pointer_t t(get_table(msg));
+    if(t == nullptr)
+    {
+        reply = message(command_t::COMMAND_ACKNOWLEDGEMENT, msg.get_request_id(), status_t::STATUS_TABLE_NOT_FOUND);
+        reply.add_string("table not found.");
+        return;
+    }
+
+    column_names_t columns;
+    std::uint16_t const column_count(msg.read_uint16());
+    for(std::uint16_t idx(0); idx < column_count; ++idx)
+    {
+        columns.push_back(msg.read_string());
+    }
+
+    std::uint32_t const key_count(msg.read_uint32());
+    reply = message(command_t::COMMAND_ROWS, msg.get_request_id());
+    reply.add_uint32(key_count);
+    for(std::uint32_t idx(0); idx < key_count; ++idx)
+    {
+        row::pointer_t key(t->row_new());
+        key->from_binary(msg.read_buffer());
+
+        conditions cond;
+        cond.set_columns(columns);
+        cond.set_key("primary", key, row::pointer_t());
+        cursor::pointer_t cur(t->row_select(cond));
+        row::pointer_t r(cur->next_row());
+        if(r == nullptr)
+        {
+            reply.add_buffer(buffer_t());
+        }
+        else
+        {
+            reply.add_buffer(r->to_binary());
+        }
+    }
+}
+
+
+/** \brief Start sending the changes of a table to a connection.
+ *
+ * The message includes the epoch and sequence of the last change the
+ * client received. With an epoch of 0, the client only receives the
+ * changes which happen from now on. Otherwise the changes following
+ * that sequence and still in the feed get sent right after the reply.
+ *
+ * The reply includes the epoch and the current sequence of the feed
+ * and a flag set to 1 if some of the requested changes were lost, in
+ * which case the client needs to scan the table once.
+ *
+ * \param[in] conn  The connection which sent the LISTEN.
+ * \param[in] msg  The LISTEN message.
+ * \param[out] reply  The reply to the LISTEN.
+ * \param[out] backlog  The changes to send after the reply.
+ */
+void server_impl::execute_listen(
+          connection_t & conn
+        , message & msg
+        , message & reply
+        , change_t::vector_t & backlog)
+{
+    table::pointer_t t(get_table(msg));
+    if(t == nullptr)
+    {
+        reply = message(command_t::COMMAND_ACKNOWLEDGEMENT, msg.get_request_id(), status_t::STATUS_TABLE_NOT_FOUND);
+        reply.add_string("table not found.");
+        return;
+    }
+
+    std::int64_t const epoch(msg.read_uint64());
+    std::uint64_t const sequence(msg.read_uint64());
+
+    change_feed::pointer_t feed(t->get_change_feed());
+    bool lost(false);
+    if(epoch != 0)
+    {
+        if(epoch == feed->get_epoch())
+        {
+            lost = !feed->read(sequence, backlog);
+        }
+        else
+        {
+            // the feed was created after the client's last change
+            //
+            feed->read(0, backlog);
+            lost = true;
+        }
+    }
+
+    int const s(conn.f_socket);
+    request_id_t const request_id(msg.get_request_id());
+    conn.f_listeners.emplace_back(feed, feed->add_listener(
+            [this, s, request_id](change_t const & change)
+            {
+                push_change(s, request_id, change);
+            }));
+
+    reply.add_uint64(feed->get_epoch());
+    reply.add_uint64(feed->get_sequence());
+    reply.add_uint8(lost ? 1 : 0);
+}
+
+
+/** \brief Send a change to a listening connection.
+ *
+ * The CHANGE message uses the request identifier of the LISTEN so the
+ * client knows which table it is from.
+ *
+ * \param[in] s  The socket of the listening connection.
+ * \param[in] request_id  The identifier of the LISTEN request.
+ * \param[in] change  The change to send.
+ */
+void server_impl::push_change(
+          int s
+        , request_id_t request_id
+        , change_t const & change)
+{
+    auto it(f_connections.find(s));
+    if(it == f_connections.end()
+    || it->second.f_closing)
+    {
+        return;
+    }
+    connection_t & conn(it->second);
+
+    if(conn.f_output.size() - conn.f_output_position >= MAXIMUM_LISTENER_OUTPUT)
+    {
+        SNAP_LOG_WARNING
+            << "disconnecting snapdatabase listener which does not read its changes."
+            << SNAP_LOG_SEND;
+
+        message bye(command_t::COMMAND_BYE, 0, status_t::STATUS_FAILED);
+        bye.add_string("too many changes pending, reconnect and LISTEN again.");
+        bye.to_binary(conn.f_output);
+        conn.f_closing = true;
+        ++f_statistics.f_errors;
+    }
+    else
+    {
+        message msg(command_t::COMMAND_CHANGE, request_id);
+        msg.add_uint64(change.f_sequence);
+        msg.add_uint8(static_cast<std::uint8_t>(change.f_type));
+        msg.add_uint64(change.f_date);
+        msg.add_buffer(change.f_row);
+        msg.to_binary(conn.f_output);
+        ++f_statistics.f_changes;
+    }
+
+    f_pending.insert(s);
+}
+
+
+table::pointer_t server_impl::get_table(message & msg)
+{
+    return f_context->get_table(msg.read_string());
+}
+
+
+/** \brief Synchronize the rows waiting for their group commit.
+ *
+ * This function synchronizes the commit logs which have rows older than
+ * the group commit delay and computes the timeout of the next epoll_wait()
+ * so the other rows get synchronized in time.
+ */
+void server_impl::sync_commit_logs()
+{
+    f_sync_timeout = -1;
+
+    std::int64_t next_us(-1);
+    try
+    {
+        next_us = f_context->sync_commit_logs();
+    }
+    catch(std::exception const & e)
+    {
+        SNAP_LOG_ERROR
+            << "could not synchronize the commit logs: "
+            << e.what()
+            << SNAP_LOG_SEND;
+
+        // try again later
+        //
+        next_us = commit_log::MAXIMUM_GROUP_COMMIT_DELAY;
+    }
+
+    if(next_us != -1)
+    {
+        // round up, otherwise we would wake up a little too early
+        //
+        f_sync_timeout = static_cast<int>((next_us + 999) / 1000);
+    }
+}
+
+
+
+} // namespace detail
+
+
+
+/** \class server
+ * \brief TCP server executing the client commands against a context.
+ *
+ * The server is event driven: call run() to process events until
+ * stop() gets called, or call process_events() from your own loop.
+ */
+
+
+/** \brief Create a server listening on \p address and \p port.
+ *
+ * The \p address must be a numeric IPv4 or IPv6 address. Use port 0
+ * to let the system choose a port (see get_port()).
+ *
+ * \exception invalid_parameter
+ * The address is not valid.
+ *
+ * \exception io_error
+ * The server socket could not be created.
+ *
+ * \param[in] c  The context to give access to.
+ * \param[in] address  The address to listen on.
+ * \param[in] port  The port to listen on.
+ */
+server::server(
+          context::pointer_t c
+        , std::string const & address
+        , std::uint16_t port)
+    : f_impl(std::make_unique<detail::server_impl>(c, address, port))
+{
+}
+
+
+server::~server()
+{
+}
+
+
+std::uint16_t server::get_port() const
+{
+    return f_impl->get_port();
+}
+
+
+void server::run()
+{
+    f_impl->run();
+}
+
+
+/** \brief Process the events available within \p timeout_ms.
+ *
+ * \param[in] timeout_ms  The maximum amount of time to wait for events,
+ * -1 to wait until an event occurs.
+ *
+ * \return false once stop() was called.
+ */
+bool server::process_events(int timeout_ms)
+{
+    return f_impl->process_events(timeout_ms);
+}
+
+
+void server::stop()
+{
+    f_impl->stop();
+}
+
+
+server::statistics_t server::get_statistics() const
+{
+    return f_impl->get_statistics();
+}
+
+
+
+} // namespace snapdatabase
+// vim: ts=4 sw=4 et
@@ -0,0 +1,87 @@
+// Copyright (c) 2019  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapdatabase
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+
+/** \file
+ * \brief Server giving access to a context over TCP.
+ *
+ * The server listens for client connections and executes the commands
+ * it receives against the tables of one context. It runs an event loop
+ * in a single thread: the context and its tables are only ever accessed
+ * from that thread.
+ */
+
+// self
+//
+#include    "snapdatabase/database/context.h"
+#include    "snapdatabase/network/message.h"
+
+
+
+namespace snapdatabase
+{
+
+
+
+namespace detail
+{
+class server_impl;
+}
+
+
+
+class server
+{
+public:
+    typedef std::shared_ptr<server>         pointer_t;
+
+    struct statistics_t
+    {
+        std::uint64_t                       f_connections = 0;
+        std::uint64_t                       f_requests = 0;
+        std::uint64_t                       f_errors = 0;
+        std::uint64_t                       f_changes = 0;
+        std::uint64_t                       f_bytes_received = 0;
+        std::uint64_t                       f_bytes_sent = 0;
+    };
+
+                                            server(
+                                                  context::pointer_t c
+                                                , std::string const & address
+                                                , std::uint16_t port = DEFAULT_PORT);
+                                            server(server const & rhs) = delete;
+                                            ~server();
+
+    server &                                operator = (server const & rhs) = delete;
+
+    std::uint16_t                           get_port() const;
+    void                                    run();
+    bool                                    process_events(int timeout_ms);
+    void                                    stop();
+    statistics_t                            get_statistics() const;
+
+private:
+    std::unique_ptr<detail::server_impl>    f_impl;
+};
+
+
+
+} // namespace snapdatabase
+// vim: ts=4 sw=4 et
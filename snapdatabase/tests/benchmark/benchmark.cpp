@@ -0,0 +1,987 @@
+// Copyright (c) 2019  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapdatabase
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+/** \file
+ * \brief Storage engine micro-benchmarks.
+ *
+ * This tool measures the cost of the basic operations of the storage
+ * engine:
+ *
+ * \li `allocate_block` and `free_block` -- table::allocate_new_block()
+ * and table::free_block() of `DATA` blocks
+ * \li `insert` -- table::row_insert() of new rows
+ * \li `lookup` -- table::row_select() of one row by primary key
+ * \li `scan` -- table::row_select() of a range of rows through a
+ * secondary index
+ * \li `blob_append` and `blob_insert` -- virtual_buffer::pwrite() at the
+ * end and virtual_buffer::pinsert() in the middle of a growing blob
+ *
+ * With `--network`, the same table is also accessed through a server
+ * listening on the loopback interface, as a client of the daemon would:
+ *
+ * \li `net_ping` -- one PING at a time, the cost of a round trip
+ * \li `net_set` -- SET of new rows, with up to `--pipeline` requests
+ * waiting for their reply
+ * \li `net_get` -- GET of `--batch` rows per request, also pipelined
+ *
+ * The pipelined operations give their throughput against the elapsed
+ * time instead of the sum of the latencies.
+ *
+ * The dataset is generated from the `--seed` so two runs with the same
+ * parameters work on exactly the same data and access the rows in the
+ * same order. This allows for comparing the results of two versions of
+ * the library.
+ *
+ * The results are output in JSON. For each operation, we give the number
+ * of operations, the throughput, and the minimum, median, 99th percentile
+ * and maximum latency in microseconds.
+ *
+ * \code
+ *     snapdatabase-benchmark --rows 100000 --seed 7 --output before.json
+ * \endcode
+ */
+
+// snapdatabase lib
+//
+#include    <snapdatabase/data/virtual_buffer.h>
+#include    <snapdatabase/database/context.h>
+#include    <snapdatabase/database/row.h>
+#include    <snapdatabase/network/client.h>
+#include    <snapdatabase/network/server.h>
+#include    <snapdatabase/version.h>
+
+
+// advgetopt lib
+//
+#include    <advgetopt/exception.h>
+#include    <advgetopt/options.h>
+
+
+// snapdev lib
+//
+#include    <snapdev/not_used.h>
+
+
+// boost lib
+//
+#include    <boost/preprocessor/stringize.hpp>
+
+
+// C++ lib
+//
+#include    <algorithm>
+#include    <chrono>
+#include    <deque>
+#include    <filesystem>
+#include    <fstream>
+#include    <iomanip>
+#include    <iostream>
+#include    <random>
+#include    <thread>
+
+
+// C lib
+//
+#include    <sys/stat.h>
+#include    <sys/types.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+
+
+namespace
+{
+
+
+
+advgetopt::option const g_options[] =
+{
+    advgetopt::define_option(
+          advgetopt::Name("batch")
+        , advgetopt::Flags(advgetopt::all_flags<
+                      advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+                    , advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::DefaultValue("16")
+        , advgetopt::Help("number of rows read by one GET through the network.")
+    ),
+    advgetopt::define_option(
+          advgetopt::Name("blob-size")
+        , advgetopt::Flags(advgetopt::all_flags<
+                      advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+                    , advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::DefaultValue("1048576")
+        , advgetopt::Help("grow a blob up to this many bytes.")
+    ),
+    advgetopt::define_option(
+          advgetopt::Name("blocks")
+        , advgetopt::Flags(advgetopt::all_flags<
+                      advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+                    , advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::DefaultValue("1000")
+        , advgetopt::Help("number of blocks to allocate and free.")
+    ),
+    advgetopt::define_option(
+          advgetopt::Name("lookups")
+        , advgetopt::Flags(advgetopt::all_flags<
+                      advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+                    , advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::DefaultValue("10000")
+        , advgetopt::Help("number of point lookups.")
+    ),
+    advgetopt::define_option(
+          advgetopt::Name("network")
+        , advgetopt::Flags(advgetopt::standalone_all_flags<
+                      advgetopt::GETOPT_FLAG_GROUP_OPTIONS>())
+        , advgetopt::Help("also measure PING, SET, and GET through a server on the loopback interface.")
+    ),
+    advgetopt::define_option(
+          advgetopt::Name("network-requests")
+        , advgetopt::Flags(advgetopt::all_flags<
+                      advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+                    , advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::DefaultValue("10000")
+        , advgetopt::Help("number of requests of each type sent through the network.")
+    ),
+    advgetopt::define_option(
+          advgetopt::Name("output")
+        , advgetopt::ShortName('o')
+        , advgetopt::Flags(advgetopt::all_flags<
+                      advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+                    , advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::Help("save the JSON results in this file instead of stdout.")
+    ),
+    advgetopt::define_option(
+          advgetopt::Name("path")
+        , advgetopt::Flags(advgetopt::all_flags<
+                      advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+                    , advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::DefaultValue("/tmp/snapdatabase-benchmark")
+        , advgetopt::Help("directory where the benchmark table gets created; its previous content is deleted.")
+    ),
+    advgetopt::define_option(
+          advgetopt::Name("pipeline")
+        , advgetopt::Flags(advgetopt::all_flags<
+                      advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+                    , advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::DefaultValue("64")
+        , advgetopt::Help("maximum number of network requests waiting for their reply.")
+    ),
+    advgetopt::define_option(
+          advgetopt::Name("rows")
+        , advgetopt::ShortName('n')
+        , advgetopt::Flags(advgetopt::all_flags<
+                      advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+                    , advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::DefaultValue("10000")
+        , advgetopt::Help("number of rows to insert.")
+    ),
+    advgetopt::define_option(
+          advgetopt::Name("scan-size")
+        , advgetopt::Flags(advgetopt::all_flags<
+                      advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+                    , advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::DefaultValue("100")
+        , advgetopt::Help("maximum number of rows read by one range scan.")
+    ),
+    advgetopt::define_option(
+          advgetopt::Name("scans")
+        , advgetopt::Flags(advgetopt::all_flags<
+                      advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+                    , advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::DefaultValue("1000")
+        , advgetopt::Help("number of range scans.")
+    ),
+    advgetopt::define_option(
+          advgetopt::Name("seed")
+        , advgetopt::Flags(advgetopt::all_flags<
+                      advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+                    , advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::DefaultValue("1")
+        , advgetopt::Help("seed used to generate the dataset and the access order.")
+    ),
+    advgetopt::define_option(
+          advgetopt::Name("verbose")
+        , advgetopt::ShortName('v')
+        , advgetopt::Flags(advgetopt::standalone_all_flags<
+                      advgetopt::GETOPT_FLAG_GROUP_OPTIONS>())
+        , advgetopt::Help("show progress in stderr.")
+    ),
+    advgetopt::end_options()
+};
+
+
+advgetopt::group_description const g_group_descriptions[] =
+{
+    advgetopt::define_group(
+          advgetopt::GroupNumber(advgetopt::GETOPT_FLAG_GROUP_OPTIONS)
+        , advgetopt::GroupName("option")
+        , advgetopt::GroupDescription("Options:")
+    ),
+    advgetopt::end_groups()
+};
+
+
+// until we have C++20, remove warnings this way
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+advgetopt::options_environment const g_options_environment =
+{
+    .f_project_name = "snapdatabase",
+    .f_group_name = nullptr,
+    .f_options = g_options,
+    .f_options_files_directory = nullptr,
+    .f_environment_variable_name = "SNAPDATABASE_BENCHMARK",
+    .f_section_variables_name = nullptr,
+    .f_configuration_files = nullptr,
+    .f_configuration_filename = nullptr,
+    .f_configuration_directories = nullptr,
+    .f_environment_flags = advgetopt::GETOPT_ENVIRONMENT_FLAG_PROCESS_SYSTEM_PARAMETERS,
+    .f_help_header = "Usage: %p [--<opt>]\n"
+                     "where --<opt> is one or more of:",
+    .f_help_footer = "%c",
+    .f_version = SNAPDATABASE_VERSION_STRING,
+    .f_license = "GNU GPL v2",
+    .f_copyright = "Copyright (c) 2019-"
+                   BOOST_PP_STRINGIZE(UTC_BUILD_YEAR)
+                   " by Made to Order Software Corporation -- All Rights Reserved",
+    .f_build_date = UTC_BUILD_DATE,
+    .f_build_time = UTC_BUILD_TIME,
+    .f_groups = g_group_descriptions
+};
+#pragma GCC diagnostic pop
+
+
+constexpr char const *      g_table_name = "benchmark";
+
+constexpr char const *      g_benchmark_context =
+        "<!-- name=benchmark -->\n"
+        "<context>\n"
+          "<table name='benchmark' model='content' row-key='key'>\n"
+            "<block-size>4096</block-size>\n"
+            "<description>Table used by the snapdatabase benchmark</description>\n"
+            "<schema>\n"
+              "<column name='key' type='uint64' required='required'>\n"
+                "<description>the primary key</description>\n"
+              "</column>\n"
+              "<column name='value' type='uint64'>\n"
+                "<description>value used by the range scans</description>\n"
+              "</column>\n"
+              "<column name='data' type='p32string'>\n"
+                "<description>a payload of variable size</description>\n"
+              "</column>\n"
+            "</schema>\n"
+            "<secondary-index name='by_value'>\n"
+              "<order>\n"
+                "<column-name name='value'/>\n"
+              "</order>\n"
+            "</secondary-index>\n"
+          "</table>\n"
+        "</context>\n";
+
+
+/** \brief Mix the bits of a number.
+ *
+ * This is the splitmix64 finalizer. It is a bijection so each row index
+ * gives us a distinct key which does not follow the insertion order.
+ */
+std::uint64_t mix(std::uint64_t x)
+{
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+
+class result
+{
+public:
+    typedef std::vector<result>     vector_t;
+
+                                result(std::string const & name);
+
+    void                        add(std::chrono::steady_clock::duration const & d);
+    void                        add_error();
+    void                        add_rows(std::size_t count);
+    void                        set_elapsed(std::chrono::steady_clock::duration const & d);
+    void                        output(std::ostream & out) const;
+
+private:
+    std::string                 f_name = std::string();
+    std::vector<std::int64_t>   f_latencies = std::vector<std::int64_t>();   // in nanoseconds
+    std::size_t                 f_errors = 0;
+    std::size_t                 f_rows = 0;
+    std::int64_t                f_elapsed = 0;      // in nanoseconds
+};
+
+
+result::result(std::string const & name)
+    : f_name(name)
+{
+}
+
+
+void result::add(std::chrono::steady_clock::duration const & d)
+{
+    f_latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+}
+
+
+void result::add_error()
+{
+    ++f_errors;
+}
+
+
+void result::add_rows(std::size_t count)
+{
+    f_rows += count;
+}
+
+
+/** \brief Set the elapsed time of the whole operation.
+ *
+ * When the requests overlap (i.e. pipelined network requests), the sum
+ * of the latencies is larger than the time it took to run them all.
+ * In that case, the throughput gets calculated with the elapsed time.
+ */
+void result::set_elapsed(std::chrono::steady_clock::duration const & d)
+{
+    f_elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+}
+
+
+void result::output(std::ostream & out) const
+{
+    std::vector<std::int64_t> sorted(f_latencies);
+    std::sort(sorted.begin(), sorted.end());
+
+    std::int64_t total(0);
+    for(auto const l : sorted)
+    {
+        total += l;
+    }
+
+    auto percentile = [&sorted](double p)
+        {
+            if(sorted.empty())
+            {
+                return 0.0;
+            }
+            std::size_t idx(static_cast<std::size_t>(p * sorted.size() + 0.5));
+            idx = std::min(std::max(idx, static_cast<std::size_t>(1)), sorted.size()) - 1;
+            return sorted[idx] / 1000.0;
+        };
+
+    double const seconds((f_elapsed > 0 ? f_elapsed : total) / 1000000000.0);
+
+    out << std::fixed << std::setprecision(3)
+        << "    {\n"
+        << "      \"name\": \"" << f_name << "\",\n"
+        << "      \"count\": " << sorted.size() << ",\n"
+        << "      \"errors\": " << f_errors << ",\n"
+        << "      \"rows\": " << f_rows << ",\n"
+        << "      \"total_seconds\": " << seconds << ",\n"
+        << "      \"ops_per_second\": " << (seconds > 0.0 ? sorted.size() / seconds : 0.0) << ",\n"
+        << "      \"min_us\": " << percentile(0.0) << ",\n"
+        << "      \"p50_us\": " << percentile(0.50) << ",\n"
+        << "      \"p99_us\": " << percentile(0.99) << ",\n"
+        << "      \"max_us\": " << percentile(1.0) << "\n"
+        << "    }";
+}
+
+
+
+class benchmark
+{
+public:
+    int                             init(int argc, char * argv[]);
+    int                             execute();
+
+private:
+    void                            progress(std::string const & msg);
+    void                            setup_context();
+    snapdatabase::row::pointer_t    generate_row(std::size_t idx);
+    void                            bench_blocks();
+    void                            bench_insert();
+    void                            bench_lookup();
+    void                            bench_scan();
+    void                            bench_blob();
+    void                            bench_network();
+    void                            bench_pipeline(
+                                          result & r
+                                        , snapdatabase::client & c
+                                        , std::vector<snapdatabase::message> & requests);
+    void                            output();
+
+    advgetopt::getopt::pointer_t    f_opt = advgetopt::getopt::pointer_t();
+    advgetopt::getopt::pointer_t    f_context_opt = advgetopt::getopt::pointer_t();
+    std::string                     f_path = std::string();
+    std::string                     f_database_path = std::string();
+    std::string                     f_tables_path = std::string();
+    snapdatabase::context::pointer_t
+                                    f_context = snapdatabase::context::pointer_t();
+    snapdatabase::table::pointer_t  f_table = snapdatabase::table::pointer_t();
+    std::mt19937_64                 f_random = std::mt19937_64();
+    std::uint64_t                   f_seed = 1;
+    std::size_t                     f_rows = 0;
+    bool                            f_verbose = false;
+    result::vector_t                f_results = result::vector_t();
+};
+
+
+
+int benchmark::init(int argc, char * argv[])
+{
+    f_opt = std::make_shared<advgetopt::getopt>(g_options_environment, argc, argv);
+
+    f_verbose = f_opt->is_defined("verbose");
+    f_seed = f_opt->get_long("seed");
+    f_rows = f_opt->get_long("rows");
+    f_path = f_opt->get_string("path");
+
+    return 0;
+}
+
+
+int benchmark::execute()
+{
+    setup_context();
+
+    bench_blocks();
+    bench_insert();
+    bench_lookup();
+    bench_scan();
+    bench_blob();
+    if(f_opt->is_defined("network"))
+    {
+        bench_network();
+    }
+
+    f_table.reset();
+    f_context.reset();
+
+    output();
+
+    return 0;
+}
+
+
+void benchmark::progress(std::string const & msg)
+{
+    if(f_verbose)
+    {
+        std::cerr << "benchmark: " << msg << std::endl;
+    }
+}
+
+
+void benchmark::setup_context()
+{
+    if(f_path.empty()
+    || f_path == "/")
+    {
+        throw std::runtime_error("the --path must be a valid sub-directory.");
+    }
+
+    // always start with a brand new table so the results are comparable
+    //
+    std::error_code ec;
+    std::filesystem::remove_all(f_path + "/database", ec);
+    if(!ec)
+    {
+        std::filesystem::remove_all(f_path + "/tables", ec);
+    }
+    if(ec)
+    {
+        throw std::runtime_error(
+                  "could not delete the previous benchmark data in \""
+                + f_path
+                + "\" ("
+                + ec.message()
+                + ").");
+    }
+
+    f_database_path = f_path + "/database";
+    f_tables_path = f_path + "/tables";
+    for(auto const & p : { f_path, f_database_path, f_tables_path })
+    {
+        if(mkdir(p.c_str(), 0700) != 0
+        && errno != EEXIST)
+        {
+            throw std::runtime_error("could not create directory \"" + p + "\".");
+        }
+    }
+
+    {
+        std::ofstream o(f_tables_path + "/" + g_table_name + ".xml");
+        o << g_benchmark_context;
+    }
+
+    advgetopt::option options[] =
+    {
+        advgetopt::define_option(
+              advgetopt::Name("context")
+            , advgetopt::Flags(advgetopt::standalone_all_flags<
+                          advgetopt::GETOPT_FLAG_GROUP_OPTIONS>())
+            , advgetopt::Help("context is mandatory")
+        ),
+        advgetopt::define_option(
+              advgetopt::Name("table-schema-path")
+            , advgetopt::Flags(advgetopt::command_flags<
+                          advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+                        , advgetopt::GETOPT_FLAG_REQUIRED
+                        , advgetopt::GETOPT_FLAG_MULTIPLE>())
+            , advgetopt::Help("path to the list of table schemata is mandatory")
+        ),
+        advgetopt::end_options()
+    };
+
+    options[0].f_default = f_database_path.c_str();
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+    advgetopt::options_environment const options_environment =
+    {
+        .f_project_name = "database",
+        .f_group_name = nullptr,
+        .f_options = options,
+    };
+#pragma GCC diagnostic pop
+
+    char const * cargv[] =
+    {
+        "/usr/bin/snapdatabase-benchmark",
+        "--table-schema-path",
+        f_tables_path.c_str(),
+        nullptr
+    };
+    int const argc(sizeof(cargv) / sizeof(cargv[0]) - 1);
+    char ** argv = const_cast<char **>(cargv);
+
+    f_context_opt = std::make_shared<advgetopt::getopt>(options_environment, argc, argv);
+    f_context = snapdatabase::context::create_context(f_context_opt);
+    f_table = f_context->get_table(g_table_name);
+    if(f_table == nullptr)
+    {
+        throw std::runtime_error("could not create the benchmark table.");
+    }
+}
+
+
+/** \brief Generate row number \p idx of the dataset.
+ *
+ * The row only depends on the seed and \p idx so we can generate it
+ * again to verify the data or to search for it.
+ */
+snapdatabase::row::pointer_t benchmark::generate_row(std::size_t idx)
+{
+    std::uint64_t const key(mix(f_seed ^ mix(idx)));
+
+    snapdatabase::row::pointer_t row(f_table->row_new());
+    row->get_cell("key", true)->set_uint64(key);
+    row->get_cell("value", true)->set_uint64(mix(key));
+
+    // payloads vary between 16 and 528 bytes
+    //
+    std::string data(16 + key % 513, ' ');
+    for(std::size_t i(0); i < data.length(); ++i)
+    {
+        data[i] = static_cast<char>('a' + (key >> (i % 56)) % 26);
+    }
+    row->get_cell("data", true)->set_string(data);
+
+    return row;
+}
+
+
+void benchmark::bench_blocks()
+{
+    std::size_t const count(f_opt->get_long("blocks"));
+    progress("allocate and free " + std::to_string(count) + " blocks");
+
+    result allocate("allocate_block");
+    result release("free_block");
+
+    std::vector<snapdatabase::block_pointer_t> blocks;
+    blocks.reserve(count);
+    for(std::size_t idx(0); idx < count; ++idx)
+    {
+        auto const start(std::chrono::steady_clock::now());
+        blocks.push_back(f_table->allocate_new_block(snapdatabase::dbtype_t::BLOCK_TYPE_DATA));
+        allocate.add(std::chrono::steady_clock::now() - start);
+    }
+    for(auto & b : blocks)
+    {
+        auto const start(std::chrono::steady_clock::now());
+        f_table->free_block(b);
+        release.add(std::chrono::steady_clock::now() - start);
+    }
+
+    f_results.push_back(allocate);
+    f_results.push_back(release);
+}
+
+
+void benchmark::bench_insert()
+{
+    progress("insert " + std::to_string(f_rows) + " rows");
+
+    result r("insert");
+    for(std::size_t idx(0); idx < f_rows; ++idx)
+    {
+        snapdatabase::row::pointer_t row(generate_row(idx));
+
+        auto const start(std::chrono::steady_clock::now());
+        try
+        {
+            f_table->row_insert(row);
+        }
+        catch(std::exception const & e)
+        {
+            progress(std::string("insert failed: ") + e.what());
+            r.add_error();
+        }
+        r.add(std::chrono::steady_clock::now() - start);
+    }
+    r.add_rows(f_rows);
+
+    f_results.push_back(r);
+}
+
+
+void benchmark::bench_lookup()
+{
+    std::size_t const count(f_opt->get_long("lookups"));
+    progress("look up " + std::to_string(count) + " rows");
+
+    result r("lookup");
+    if(f_rows == 0)
+    {
+        f_results.push_back(r);
+        return;
+    }
+
+    f_random.seed(f_seed + 1);
+    for(std::size_t n(0); n < count; ++n)
+    {
+        std::size_t const idx(f_random() % f_rows);
+        std::uint64_t const key(mix(f_seed ^ mix(idx)));
+
+        snapdatabase::conditions cond;
+        cond.set_columns({"key", "value", "data"});
+        snapdatabase::row::pointer_t key_row(f_table->row_new());
+        key_row->get_cell("key", true)->set_uint64(key);
+        cond.set_key("primary", key_row, snapdatabase::row::pointer_t());
+
+        auto const start(std::chrono::steady_clock::now());
+        snapdatabase::cursor::pointer_t cursor(f_table->row_select(cond));
+        snapdatabase::row::pointer_t row(cursor->next_row());
+        r.add(std::chrono::steady_clock::now() - start);
+
+        if(row == nullptr
+        || row->get_cell("key", false) == nullptr
+        || row->get_cell("key", false)->get_uint64() != key)
+        {
+            r.add_error();
+        }
+        else
+        {
+            r.add_rows(1);
+        }
+    }
+
+    f_results.push_back(r);
+}
+
+
+void benchmark::bench_scan()
+{
+    std::size_t const count(f_opt->get_long("scans"));
+    std::size_t const scan_size(f_opt->get_long("scan-size"));
+    progress("scan " + std::to_string(count) + " ranges of up to " + std::to_string(scan_size) + " rows");
+
+    result r("scan");
+    f_random.seed(f_seed + 2);
+    for(std::size_t n(0); n < count; ++n)
+    {
+        snapdatabase::conditions cond;
+        cond.set_columns({"key", "value"});
+        cond.set_limit(scan_size);
+        snapdatabase::row::pointer_t min_key(f_table->row_new());
+        min_key->get_cell("value", true)->set_uint64(f_random());
+        cond.set_key("by_value", min_key, snapdatabase::row::pointer_t());
+
+        auto const start(std::chrono::steady_clock::now());
+        snapdatabase::cursor::pointer_t cursor(f_table->row_select(cond));
+        std::size_t rows(0);
+        while(cursor->next_row() != nullptr)
+        {
+            ++rows;
+        }
+        r.add(std::chrono::steady_clock::now() - start);
+        r.add_rows(rows);
+    }
+
+    f_results.push_back(r);
+}
+
+
+void benchmark::bench_blob()
+{
+    std::size_t const blob_size(f_opt->get_long("blob-size"));
+    progress("grow a blob to " + std::to_string(blob_size) + " bytes");
+
+    // half the data is appended, the other half is inserted at random
+    // positions which forces the virtual buffer to split its buffers
+    //
+    result append("blob_append");
+    result insert("blob_insert");
+
+    f_random.seed(f_seed + 4);
+    std::vector<std::uint8_t> chunk(256);
+    for(auto & c : chunk)
+    {
+        c = static_cast<std::uint8_t>(f_random());
+    }
+
+    snapdatabase::virtual_buffer blob;
+    for(std::size_t n(0); blob.size() < blob_size; ++n)
+    {
+        auto const start(std::chrono::steady_clock::now());
+        if((n & 1) == 0
+        || blob.size() == 0)
+        {
+            blob.pwrite(chunk.data(), chunk.size(), blob.size(), true);
+            append.add(std::chrono::steady_clock::now() - start);
+        }
+        else
+        {
+            std::uint64_t const offset(f_random() % blob.size());
+            blob.pinsert(chunk.data(), chunk.size(), offset);
+            insert.add(std::chrono::steady_clock::now() - start);
+        }
+    }
+
+    f_results.push_back(append);
+    f_results.push_back(insert);
+}
+
+
+/** \brief Access the table through a server on the loopback interface.
+ *
+ * The server runs in a separate thread. The context is not thread safe
+ * so all the requests are generated before the server starts and the
+ * main thread only uses the client until the server is stopped.
+ */
+void benchmark::bench_network()
+{
+    std::size_t const count(f_opt->get_long("network-requests"));
+    std::size_t const batch(std::max(f_opt->get_long("batch"), 1L));
+    progress("send " + std::to_string(count) + " requests of each type through the network");
+
+    std::vector<snapdatabase::message> sets;
+    sets.reserve(count);
+    for(std::size_t idx(0); idx < count; ++idx)
+    {
+        sets.push_back(snapdatabase::client::make_commit(
+                  snapdatabase::command_t::COMMAND_SET
+                , g_table_name
+                , generate_row(f_rows + idx)->to_binary()));
+    }
+
+    std::vector<snapdatabase::message> gets;
+    gets.reserve(count);
+    f_random.seed(f_seed + 5);
+    for(std::size_t n(0); n < count; ++n)
+    {
+        snapdatabase::client::buffers_t keys;
+        for(std::size_t k(0); k < batch; ++k)
+        {
+            std::uint64_t const key(mix(f_seed ^ mix(f_random() % (f_rows + count))));
+            snapdatabase::row::pointer_t key_row(f_table->row_new());
+            key_row->get_cell("key", true)->set_uint64(key);
+            keys.push_back(key_row->to_binary());
+        }
+        gets.push_back(snapdatabase::client::make_get(g_table_name, keys, {"key", "value", "data"}));
+    }
+
+    snapdatabase::server s(f_context, "127.0.0.1", 0);
+    std::thread server_thread([&s]() { s.run(); });
+
+    result ping("net_ping");
+    result set("net_set");
+    result get("net_get");
+    try
+    {
+        snapdatabase::client c("127.0.0.1", s.get_port(), "snapdatabase-benchmark");
+
+        for(std::size_t n(0); n < count; ++n)
+        {
+            auto const start(std::chrono::steady_clock::now());
+            c.ping();
+            ping.add(std::chrono::steady_clock::now() - start);
+        }
+
+        bench_pipeline(set, c, sets);
+        bench_pipeline(get, c, gets);
+
+        c.disconnect();
+    }
+    catch(...)
+    {
+        s.stop();
+        server_thread.join();
+        throw;
+    }
+    s.stop();
+    server_thread.join();
+
+    f_results.push_back(ping);
+    f_results.push_back(set);
+    f_results.push_back(get);
+}
+
+
+void benchmark::bench_pipeline(
+          result & r
+        , snapdatabase::client & c
+        , std::vector<snapdatabase::message> & requests)
+{
+    typedef std::pair<snapdatabase::request_id_t, std::chrono::steady_clock::time_point> pending_t;
+
+    std::size_t const pipeline(std::max(f_opt->get_long("pipeline"), 1L));
+    std::deque<pending_t> pending;
+
+    auto receive = [&]()
+        {
+            snapdatabase::message reply(c.wait(pending.front().first));
+            r.add(std::chrono::steady_clock::now() - pending.front().second);
+            pending.pop_front();
+
+            if(reply.get_command() == snapdatabase::command_t::COMMAND_ROWS)
+            {
+                for(auto const & b : snapdatabase::client::read_rows(reply))
+                {
+                    if(b.empty())
+                    {
+                        r.add_error();
+                    }
+                    else
+                    {
+                        r.add_rows(1);
+                    }
+                }
+            }
+            else if(reply.get_status() == snapdatabase::status_t::STATUS_OK)
+            {
+                r.add_rows(1);
+            }
+            else
+            {
+                r.add_error();
+            }
+        };
+
+    auto const start(std::chrono::steady_clock::now());
+    for(auto & msg : requests)
+    {
+        if(pending.size() >= pipeline)
+        {
+            receive();
+        }
+        auto const now(std::chrono::steady_clock::now());
+        pending.emplace_back(c.post(msg), now);
+    }
+    while(!pending.empty())
+    {
+        receive();
+    }
+    r.set_elapsed(std::chrono::steady_clock::now() - start);
+}
+
+
+void benchmark::output()
+{
+    std::ofstream file;
+    if(f_opt->is_defined("output"))
+    {
+        file.open(f_opt->get_string("output"));
+        if(!file.is_open())
+        {
+            throw std::runtime_error("could not open output file \"" + f_opt->get_string("output") + "\".");
+        }
+    }
+    std::ostream & out(file.is_open() ? file : std::cout);
+
+    out << "{\n"
+        << "  \"version\": \"" << SNAPDATABASE_VERSION_STRING << "\",\n"
+        << "  \"seed\": " << f_seed << ",\n"
+        << "  \"rows\": " << f_rows << ",\n"
+        << "  \"results\": [\n";
+    char const * sep("");
+    for(auto const & r : f_results)
+    {
+        out << sep;
+        r.output(out);
+        sep = ",\n";
+    }
+    out << "\n  ]\n"
+        << "}\n";
+}
+
+
+
+}
+// no name namespace
+
+
+
+int main(int argc, char * argv[])
+{
+    try
+    {
+        benchmark b;
+        if(b.init(argc, argv) != 0)
+        {
+            return 0;
+        }
+
+        return b.execute();
+    }
+    catch(advgetopt::getopt_exit const & e)
+    {
+        snapdev::NOT_USED(e);
+        return 0;
+    }
+    catch(std::exception const & e)
+    {
+        std::cerr << "error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+
+// vim: ts=4 sw=4 et
@@ -26,6 +26,7 @@
 //
 #include    <snapdatabase/database/context.h>
 #include    <snapdatabase/database/row.h>
+#include    <snapdatabase/file/file_bloom_filter.h>
 //#include    <snapdatabase/database/context.h>
 
 
@@ -34,6 +35,19 @@
 #include    <advgetopt/options.h>
 
 
+// C++ lib
+//
+#include    <fstream>
+#include    <iterator>
+#include    <limits>
+
+
+// C lib
+//
+#include    <sys/stat.h>
+#include    <unistd.h>
+
+
 
 
 CATCH_TEST_CASE("Context", "[centext]")
@@ -72,6 +86,9 @@ CATCH_TEST_CASE("Context", "[centext]")
                             "<description>column 3</description>\n"
                             "<default>0</default>\n"
                           "</column>\n"
+                          "<column name='c4' type='p32string' compress='zstd'>\n"
+                            "<description>column 4</description>\n"
+                          "</column>\n"
                         "</schema>\n"
                         "<secondary-index name='created_on'>\n"
                           "<order>\n"
@@ -166,6 +183,10 @@ CATCH_TEST_CASE("Context", "[centext]")
         table = context->get_table("foo");
         CATCH_REQUIRE(table != nullptr);
 
+        // batch the fdatasync() of the commit log
+        //
+        table->set_group_commit(16, 1000);
+
         struct row_data_t
         {
             typedef std::vector<row_data_t> vector_t;
@@ -173,6 +194,7 @@ CATCH_TEST_CASE("Context", "[centext]")
             std::uint16_t       f_c1 = 0;
             std::int16_t        f_c2 = 0;
             std::uint64_t       f_c3 = 0;
+            std::string         f_c4 = std::string();
         };
         row_data_t::vector_t row_data;
 
@@ -197,10 +219,21 @@ std::cerr << "+++ row count = " << count << "\n";
             c3_value |= count + 1;
             c3->set_uint64(c3_value);
 
+            // a string which compresses well
+            //
+            snapdatabase::cell::pointer_t c4(row->get_cell("c4", true));
+            std::string c4_value;
+            for(int repeat(rand() % 50 + 1); repeat > 0; --repeat)
+            {
+                c4_value += "<p>row #" + std::to_string(count) + "</p>";
+            }
+            c4->set_string(c4_value);
+
             row_data_t data;
             data.f_c1 = c1_value;
             data.f_c2 = c2_value;
             data.f_c3 = c3_value;
+            data.f_c4 = c4_value;
             row_data.push_back(data);
 
 std::cerr << "---------------------- INSERT ROW\n";
@@ -228,7 +261,7 @@ std::cerr << "---------------------- VERIFY " << row_data.size() << " ROWS\n";
                 row_data_t & d(row_data[indexes[p]]);
 
                 snapdatabase::conditions cond;
-                cond.set_columns({"c1", "c2", "c3"});
+                cond.set_columns({"c1", "c2", "c3", "c4"});
                 snapdatabase::row::pointer_t key(table->row_new());
                 snapdatabase::cell::pointer_t c2_key(key->get_cell("c2", true));
                 c2_key->set_int16(d.f_c2);
@@ -249,6 +282,9 @@ std::cerr << "---------------------- READ ROW: " << d.f_c2 << ", " << d.f_c1 <<
                 snapdatabase::cell::pointer_t c3_data(r->get_cell("c3", false));
                 CATCH_REQUIRE(c3_data != nullptr);
                 CATCH_REQUIRE(c3_data->get_uint64() == d.f_c3);
+                snapdatabase::cell::pointer_t c4_data(r->get_cell("c4", false));
+                CATCH_REQUIRE(c4_data != nullptr);
+                CATCH_REQUIRE(c4_data->get_string() == d.f_c4);
 
                 // only one primary row with a specific key
                 //
@@ -261,6 +297,1345 @@ std::cerr << "---------------------- VERIFY UNIQUE ROW\n";
             }
         }
 
+        // the "created_on" secondary index returns all the rows sorted
+        // by creation date, newest first
+        //
+        {
+            snapdatabase::conditions cond;
+            cond.set_columns({"_created_on", "c1", "c2", "c3"});
+            cond.set_key("created_on", snapdatabase::row::pointer_t(), snapdatabase::row::pointer_t());
+
+            snapdatabase::cursor::pointer_t cursor(table->row_select(cond));
+            std::size_t count(0);
+            std::uint64_t previous_created_on(std::numeric_limits<std::uint64_t>::max());
+            for(;;)
+            {
+                snapdatabase::row::pointer_t r(cursor->next_row());
+                if(r == nullptr)
+                {
+                    break;
+                }
+                ++count;
+
+                snapdatabase::cell::pointer_t created_on(r->get_cell("_created_on", false));
+                CATCH_REQUIRE(created_on != nullptr);
+                CATCH_REQUIRE(created_on->get_time_us() <= previous_created_on);
+                previous_created_on = created_on->get_time_us();
+            }
+            CATCH_REQUIRE(count == row_data.size());
+
+            // the same index in reverse returns the oldest first
+            //
+            cond.set_reverse();
+            cursor = table->row_select(cond);
+            count = 0;
+            previous_created_on = 0;
+            for(;;)
+            {
+                snapdatabase::row::pointer_t r(cursor->next_row());
+                if(r == nullptr)
+                {
+                    break;
+                }
+                ++count;
+
+                snapdatabase::cell::pointer_t created_on(r->get_cell("_created_on", false));
+                CATCH_REQUIRE(created_on != nullptr);
+                CATCH_REQUIRE(created_on->get_time_us() >= previous_created_on);
+                previous_created_on = created_on->get_time_us();
+            }
+            CATCH_REQUIRE(count == row_data.size());
+        }
+
+        // a checkpoint empties the commit log
+        //
+        table->checkpoint();
+        struct stat s;
+        CATCH_REQUIRE(stat((database_path + "/foo/commit_log.snaplog").c_str(), &s) == 0);
+        CATCH_REQUIRE(s.st_size == 0);
+
+        // compacting one block at a time does not lose any rows and
+        // does not grow the file
+        //
+        {
+            // cells read before the compaction remain valid even once
+            // their row is gone
+            //
+            std::vector<snapdatabase::cell::pointer_t> c4_cells;
+            for(std::size_t p(0); p < 10; ++p)
+            {
+                snapdatabase::conditions cond;
+                cond.set_columns({"c4"});
+                snapdatabase::row::pointer_t key(table->row_new());
+                key->get_cell("c2", true)->set_int16(row_data[p].f_c2);
+                key->get_cell("c1", true)->set_uint16(row_data[p].f_c1);
+                cond.set_key("primary", key, snapdatabase::row::pointer_t());
+
+                snapdatabase::cursor::pointer_t cursor(table->row_select(cond));
+                snapdatabase::row::pointer_t r(cursor->next_row());
+                CATCH_REQUIRE(r != nullptr);
+                c4_cells.push_back(r->get_cell("c4", false));
+                CATCH_REQUIRE(c4_cells.back() != nullptr);
+            }
+
+            // read the complete rows before and after the compaction
+            // and make sure they are identical
+            //
+            auto read_row = [&table, &row_data](std::size_t p)
+                {
+                    snapdatabase::conditions cond;
+                    cond.set_columns({"_created_on", "c1", "c2", "c3", "c4"});
+                    snapdatabase::row::pointer_t key(table->row_new());
+                    key->get_cell("c2", true)->set_int16(row_data[p].f_c2);
+                    key->get_cell("c1", true)->set_uint16(row_data[p].f_c1);
+                    cond.set_key("primary", key, snapdatabase::row::pointer_t());
+
+                    snapdatabase::cursor::pointer_t cursor(table->row_select(cond));
+                    snapdatabase::row::pointer_t r(cursor->next_row());
+                    CATCH_REQUIRE(r != nullptr);
+                    CATCH_REQUIRE(cursor->next_row() == nullptr);
+                    return r;
+                };
+            std::vector<snapdatabase::buffer_t> rows_before;
+            for(std::size_t p(0); p < row_data.size(); ++p)
+            {
+                rows_before.push_back(read_row(p)->to_binary());
+            }
+
+            std::size_t const size_before(table->get_size());
+            while(!table->compact(1))
+            {
+            }
+            CATCH_REQUIRE(table->get_size() <= size_before);
+
+            for(std::size_t p(0); p < row_data.size(); ++p)
+            {
+                snapdatabase::row::pointer_t r(read_row(p));
+                CATCH_REQUIRE(r->to_binary() == rows_before[p]);
+                CATCH_REQUIRE(r->get_cell("c1", false)->get_uint16() == row_data[p].f_c1);
+                CATCH_REQUIRE(r->get_cell("c2", false)->get_int16() == row_data[p].f_c2);
+                CATCH_REQUIRE(r->get_cell("c3", false)->get_uint64() == row_data[p].f_c3);
+                CATCH_REQUIRE(r->get_cell("c4", false)->get_string() == row_data[p].f_c4);
+            }
+
+            for(std::size_t p(0); p < c4_cells.size(); ++p)
+            {
+                CATCH_REQUIRE(c4_cells[p]->get_string() == row_data[p].f_c4);
+            }
+
+            snapdatabase::conditions cond;
+            cond.set_columns({"_created_on", "c1"});
+            cond.set_key("created_on", snapdatabase::row::pointer_t(), snapdatabase::row::pointer_t());
+
+            snapdatabase::cursor::pointer_t cursor(table->row_select(cond));
+            std::size_t count(0);
+            while(cursor->next_row() != nullptr)
+            {
+                ++count;
+            }
+            CATCH_REQUIRE(count == row_data.size());
+        }
+
+        context.reset();
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("journal")
+    {
+        std::vector<std::string> const journal_context =
+            {
+                {
+                    "<!-- name=journal-context -->\n"
+                    "<context>\n"
+                      "<table name='actions' model='journal' row-key='key'>\n"
+                        "<block-size>4096</block-size>\n"
+                        "<description>A Journal of Actions</description>\n"
+                        "<schema>\n"
+                          "<column name='key' type='uint32' required='required'>\n"
+                            "<description>the key of the action</description>\n"
+                          "</column>\n"
+                          "<column name='action' type='p8string'>\n"
+                            "<description>the action to perform</description>\n"
+                          "</column>\n"
+                        "</schema>\n"
+                      "</table>\n"
+                    "</context>\n"
+                }
+            };
+
+        std::string const created(SNAP_CATCH2_NAMESPACE::setup_context("journal-context", journal_context));
+        CATCH_REQUIRE_FALSE(created.empty());
+        if(created.empty())
+        {
+            return;
+        }
+
+        std::string database_path(created + "/database");
+        std::string tables_path(created + "/tables");
+
+        advgetopt::option options[] =
+        {
+            advgetopt::define_option(
+                  advgetopt::Name("context")
+                , advgetopt::Flags(advgetopt::standalone_all_flags<
+                              advgetopt::GETOPT_FLAG_GROUP_OPTIONS>())
+                , advgetopt::Help("context is mandatory")
+            ),
+            advgetopt::define_option(
+                  advgetopt::Name("table-schema-path")
+                , advgetopt::Flags(advgetopt::command_flags<
+                              advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+                            , advgetopt::GETOPT_FLAG_REQUIRED
+                            , advgetopt::GETOPT_FLAG_MULTIPLE>())
+                , advgetopt::Help("path to the list of table schemata is mandatory")
+            ),
+            advgetopt::end_options()
+        };
+
+        options[0].f_default = database_path.c_str();
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+        advgetopt::options_environment const options_environment =
+        {
+            .f_project_name = "database",
+            .f_group_name = nullptr,
+            .f_options = options,
+        };
+#pragma GCC diagnostic pop
+
+        char const * cargv[] =
+        {
+            "/usr/bin/journal",
+            "--table-schema-path",
+            tables_path.c_str(),
+            nullptr
+        };
+        int const argc(sizeof(cargv) / sizeof(cargv[0]) - 1);
+        char ** argv = const_cast<char **>(cargv);
+
+        advgetopt::getopt::pointer_t opt(std::make_shared<advgetopt::getopt>(options_environment, argc, argv));
+        snapdatabase::context::pointer_t context(snapdatabase::context::create_context(opt));
+
+        snapdatabase::table::pointer_t table(context->get_table("actions"));
+        CATCH_REQUIRE(table != nullptr);
+        CATCH_REQUIRE(table->model() == snapdatabase::model_t::TABLE_MODEL_JOURNAL);
+
+        // rows with keys 0 to 19, priority 2, 1, 0, 2, 1, 0, ...
+        // the rows with a key multiple of 7 are due in the future
+        //
+        std::uint64_t const now(1000000);
+        for(std::uint32_t key(0); key < 20; ++key)
+        {
+            snapdatabase::row::pointer_t row(table->row_new());
+            row->get_cell("key", true)->set_uint32(key);
+            row->get_cell("action", true)->set_string("action #" + std::to_string(key));
+            row->get_cell(snapdatabase::g_journal_priority_column, true)->set_uint8(2 - key % 3);
+            row->get_cell(snapdatabase::g_journal_process_date_column, true)->set_time_ms(
+                        key % 7 == 0 ? now + 60000 : now - 1000 + key);
+            table->row_insert(row);
+        }
+
+        // the due rows come out sorted by priority and process date
+        //
+        std::uint32_t previous_priority(0);
+        std::uint64_t previous_date(0);
+        snapdatabase::row::pointer_t timed_out;
+        std::size_t count(0);
+        for(;;)
+        {
+            snapdatabase::row::pointer_t r(table->journal_next(now, 5000));
+            if(r == nullptr)
+            {
+                break;
+            }
+            ++count;
+
+            std::uint32_t const key(r->get_cell("key", false)->get_uint32());
+            CATCH_REQUIRE(key % 7 != 0);
+            CATCH_REQUIRE(r->get_cell(snapdatabase::g_journal_status_column, false)->get_uint8() == snapdatabase::JOURNAL_STATUS_PROCESSING);
+            CATCH_REQUIRE(r->get_cell(snapdatabase::g_journal_start_processing_date_column, false)->get_time_ms() == now);
+
+            std::uint32_t const priority(r->get_cell(snapdatabase::g_journal_priority_column, false)->get_uint8());
+            std::uint64_t const date(r->get_cell(snapdatabase::g_journal_process_date_column, false)->get_time_ms());
+            CATCH_REQUIRE(priority >= previous_priority);
+            if(priority == previous_priority)
+            {
+                CATCH_REQUIRE(date >= previous_date);
+            }
+            previous_priority = priority;
+            previous_date = date;
+
+            // keep one row in the PROCESSING state
+            //
+            if(timed_out == nullptr)
+            {
+                timed_out = r;
+                continue;
+            }
+            CATCH_REQUIRE(table->journal_done(r));
+            CATCH_REQUIRE_FALSE(table->journal_done(r));
+        }
+        CATCH_REQUIRE(count == 20 - 3);
+        CATCH_REQUIRE(timed_out != nullptr);
+
+        // the row which was not marked done comes back once it timed out
+        //
+        {
+            std::uint32_t const key(timed_out->get_cell("key", false)->get_uint32());
+            snapdatabase::row::pointer_t r(table->journal_next(now + 6000, 5000));
+            CATCH_REQUIRE(r != nullptr);
+            CATCH_REQUIRE(r->get_cell("key", false)->get_uint32() == key);
+            CATCH_REQUIRE(r->get_cell(snapdatabase::g_journal_timeout_counter_column, false)->get_uint8() == 1);
+            CATCH_REQUIRE(table->journal_done(r));
+        }
+
+        // the rows due in the future are still in the journal index
+        //
+        {
+            snapdatabase::conditions cond;
+            cond.set_columns({"key"});
+            cond.set_key("journal", snapdatabase::row::pointer_t(), snapdatabase::row::pointer_t());
+
+            snapdatabase::cursor::pointer_t cursor(table->row_select(cond));
+            count = 0;
+            while(cursor->next_row() != nullptr)
+            {
+                ++count;
+            }
+            CATCH_REQUIRE(count == 3);
+        }
+
+        // once all the rows are done, the journal index is empty and
+        // its blocks were freed; it gets recreated by the next insert
+        //
+        for(count = 0;; ++count)
+        {
+            snapdatabase::row::pointer_t r(table->journal_next(now + 60000, 5000));
+            if(r == nullptr)
+            {
+                break;
+            }
+            CATCH_REQUIRE(r->get_cell("key", false)->get_uint32() % 7 == 0);
+            CATCH_REQUIRE(table->journal_done(r));
+        }
+        CATCH_REQUIRE(count == 3);
+        {
+            snapdatabase::conditions cond;
+            cond.set_columns({"key"});
+            cond.set_key("journal", snapdatabase::row::pointer_t(), snapdatabase::row::pointer_t());
+
+            snapdatabase::cursor::pointer_t cursor(table->row_select(cond));
+            CATCH_REQUIRE(cursor->next_row() == nullptr);
+        }
+        {
+            snapdatabase::row::pointer_t row(table->row_new());
+            row->get_cell("key", true)->set_uint32(50);
+            row->get_cell(snapdatabase::g_journal_process_date_column, true)->set_time_ms(now);
+            table->row_insert(row);
+
+            snapdatabase::row::pointer_t r(table->journal_next(now, 5000));
+            CATCH_REQUIRE(r != nullptr);
+            CATCH_REQUIRE(r->get_cell("key", false)->get_uint32() == 50);
+            CATCH_REQUIRE(table->journal_done(r));
+        }
+
+        // all of these blocks fit in the default cache
+        //
+        {
+            snapdatabase::block_cache::statistics_t const stats(table->get_cache_statistics());
+            CATCH_REQUIRE(stats.f_hits > 0);
+            CATCH_REQUIRE(stats.f_misses > 0);
+            CATCH_REQUIRE(stats.f_evictions == 0);
+            CATCH_REQUIRE(stats.f_pinned > 0);
+        }
+
+        // a reset empties the journal and shrinks the file
+        //
+        std::size_t const size_before(table->get_size());
+        table->journal_reset();
+        CATCH_REQUIRE(table->get_size() < size_before);
+        CATCH_REQUIRE(table->journal_next(now + 120000, 5000) == nullptr);
+
+        // and the table can be used again
+        //
+        {
+            snapdatabase::row::pointer_t row(table->row_new());
+            row->get_cell("key", true)->set_uint32(100);
+            row->get_cell(snapdatabase::g_journal_process_date_column, true)->set_time_ms(now);
+            table->row_insert(row);
+
+            snapdatabase::row::pointer_t r(table->journal_next(now, 5000));
+            CATCH_REQUIRE(r != nullptr);
+            CATCH_REQUIRE(r->get_cell("key", false)->get_uint32() == 100);
+        }
+
+        context.reset();
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("small block cache")
+    {
+        std::vector<std::string> const cache_context =
+            {
+                {
+                    "<!-- name=cache-context -->\n"
+                    "<context>\n"
+                      "<table name='pages' model='content' row-key='key'>\n"
+                        "<block-size>4096</block-size>\n"
+                        "<description>A Table Larger than its Cache</description>\n"
+                        "<schema>\n"
+                          "<column name='key' type='uint32' required='required'>\n"
+                            "<description>the key of the page</description>\n"
+                          "</column>\n"
+                          "<column name='body' type='p16string'>\n"
+                            "<description>the body of the page</description>\n"
+                          "</column>\n"
+                        "</schema>\n"
+                      "</table>\n"
+                    "</context>\n"
+                }
+            };
+
+        std::string const created(SNAP_CATCH2_NAMESPACE::setup_context("cache-context", cache_context));
+        CATCH_REQUIRE_FALSE(created.empty());
+        if(created.empty())
+        {
+            return;
+        }
+
+        std::string database_path(created + "/database");
+        std::string tables_path(created + "/tables");
+
+        advgetopt::option options[] =
+        {
+            advgetopt::define_option(
+                  advgetopt::Name("context")
+                , advgetopt::Flags(advgetopt::standalone_all_flags<
+                              advgetopt::GETOPT_FLAG_GROUP_OPTIONS>())
+                , advgetopt::Help("context is mandatory")
+            ),
+            advgetopt::define_option(
+                  advgetopt::Name("table-schema-path")
+                , advgetopt::Flags(advgetopt::command_flags<
+                              advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+                            , advgetopt::GETOPT_FLAG_REQUIRED
+                            , advgetopt::GETOPT_FLAG_MULTIPLE>())
+                , advgetopt::Help("path to the list of table schemata is mandatory")
+            ),
+            advgetopt::define_option(
+                  advgetopt::Name("block-cache-size")
+                , advgetopt::Flags(advgetopt::command_flags<
+                              advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+                            , advgetopt::GETOPT_FLAG_REQUIRED>())
+                , advgetopt::Help("the size of the cache of each table")
+            ),
+            advgetopt::define_option(
+                  advgetopt::Name("group-commit-count")
+                , advgetopt::Flags(advgetopt::command_flags<
+                              advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+                            , advgetopt::GETOPT_FLAG_REQUIRED>())
+                , advgetopt::Help("the number of rows to commit before a sync")
+            ),
+            advgetopt::define_option(
+                  advgetopt::Name("group-commit-delay")
+                , advgetopt::Flags(advgetopt::command_flags<
+                              advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+                            , advgetopt::GETOPT_FLAG_REQUIRED>())
+                , advgetopt::Help("the maximum delay before a sync")
+            ),
+            advgetopt::end_options()
+        };
+
+        options[0].f_default = database_path.c_str();
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+        advgetopt::options_environment const options_environment =
+        {
+            .f_project_name = "database",
+            .f_group_name = nullptr,
+            .f_options = options,
+        };
+#pragma GCC diagnostic pop
+
+        // a cache of 32 blocks of 4Kb
+        //
+        std::size_t const cache_size(snapdatabase::block_cache::MINIMUM_CACHE_SIZE * 2);
+        std::string const cache_size_str(std::to_string(cache_size));
+
+        // and a group commit of up to 1,000 rows or 0.2 seconds
+        //
+        std::int64_t const group_commit_delay(200000);
+        std::string const group_commit_delay_str(std::to_string(group_commit_delay));
+        char const * cargv[] =
+        {
+            "/usr/bin/cache",
+            "--table-schema-path",
+            tables_path.c_str(),
+            "--block-cache-size",
+            cache_size_str.c_str(),
+            "--group-commit-count",
+            "1000",
+            "--group-commit-delay",
+            group_commit_delay_str.c_str(),
+            nullptr
+        };
+        int const argc(sizeof(cargv) / sizeof(cargv[0]) - 1);
+        char ** argv = const_cast<char **>(cargv);
+
+        advgetopt::getopt::pointer_t opt(std::make_shared<advgetopt::getopt>(options_environment, argc, argv));
+        snapdatabase::context::pointer_t context(snapdatabase::context::create_context(opt));
+
+        snapdatabase::table::pointer_t table(context->get_table("pages"));
+        CATCH_REQUIRE(table != nullptr);
+
+        // about 300 bytes per row, so 600 rows need more than 32 blocks
+        //
+        std::size_t const row_count(600);
+        auto body = [](std::uint32_t key)
+        {
+            return std::string(300, static_cast<char>('a' + key % 26)) + std::to_string(key);
+        };
+        for(std::uint32_t key(0); key < row_count; ++key)
+        {
+            snapdatabase::row::pointer_t row(table->row_new());
+            row->get_cell("key", true)->set_uint32(key);
+            row->get_cell("body", true)->set_string(body(key));
+            table->row_insert(row);
+        }
+        CATCH_REQUIRE(table->get_size() > cache_size);
+
+        for(std::uint32_t key(0); key < row_count; ++key)
+        {
+            snapdatabase::conditions cond;
+            cond.set_columns({"key", "body"});
+            snapdatabase::row::pointer_t k(table->row_new());
+            k->get_cell("key", true)->set_uint32(key);
+            cond.set_key("primary", k, snapdatabase::row::pointer_t());
+
+            snapdatabase::cursor::pointer_t cursor(table->row_select(cond));
+            snapdatabase::row::pointer_t r(cursor->next_row());
+            CATCH_REQUIRE(r != nullptr);
+            CATCH_REQUIRE(r->get_cell("body", false)->get_string() == body(key));
+        }
+
+        // blocks were evicted to stay within the budget
+        //
+        snapdatabase::block_cache::statistics_t const stats(table->get_cache_statistics());
+        CATCH_REQUIRE(stats.f_evictions > 0);
+        CATCH_REQUIRE(stats.f_resident <= cache_size / table->get_page_size());
+        CATCH_REQUIRE(stats.f_hot + 1 <= stats.f_resident - stats.f_pinned);
+
+        // the last rows get synchronized once they waited for the group
+        // commit delay even if no more rows get committed
+        //
+        std::int64_t next(context->sync_commit_logs());
+        if(next != -1)
+        {
+            CATCH_REQUIRE(next <= group_commit_delay);
+            usleep(next);
+            CATCH_REQUIRE(context->sync_commit_logs() == -1);
+        }
+
+        {
+            snapdatabase::row::pointer_t row(table->row_new());
+            row->get_cell("key", true)->set_uint32(row_count);
+            row->get_cell("body", true)->set_string(body(row_count));
+            table->row_insert(row);
+        }
+        next = table->sync_commit_log();
+        CATCH_REQUIRE(next > 0);
+        CATCH_REQUIRE(next <= group_commit_delay);
+        CATCH_REQUIRE(context->sync_commit_logs() > 0);
+        usleep(next);
+        CATCH_REQUIRE(context->sync_commit_logs() == -1);
+        CATCH_REQUIRE(table->sync_commit_log() == -1);
+
+        context.reset();
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("update rows")
+    {
+        std::vector<std::string> const update_context =
+            {
+                {
+                    "<!-- name=update-context -->\n"
+                    "<context>\n"
+                      "<table name='users' model='content' row-key='key'>\n"
+                        "<block-size>4096</block-size>\n"
+                        "<description>Rows which Get Updated</description>\n"
+                        "<schema>\n"
+                          "<column name='key' type='uint32' required='required'>\n"
+                            "<description>the key of the user</description>\n"
+                          "</column>\n"
+                          "<column name='age' type='uint8'>\n"
+                            "<description>the age of the user</description>\n"
+                          "</column>\n"
+                          "<column name='name' type='p8string'>\n"
+                            "<description>the name of the user</description>\n"
+                          "</column>\n"
+                        "</schema>\n"
+                        "<secondary-index name='by_age'>\n"
+                          "<order>\n"
+                            "<column-name name='age'/>\n"
+                          "</order>\n"
+                        "</secondary-index>\n"
+                      "</table>\n"
+                    "</context>\n"
+                }
+            };
+
+        std::string const created(SNAP_CATCH2_NAMESPACE::setup_context("update-context", update_context));
+        CATCH_REQUIRE_FALSE(created.empty());
+        if(created.empty())
+        {
+            return;
+        }
+
+        std::string database_path(created + "/database");
+        std::string tables_path(created + "/tables");
+
+        advgetopt::option options[] =
+        {
+            advgetopt::define_option(
+                  advgetopt::Name("context")
+                , advgetopt::Flags(advgetopt::standalone_all_flags<
+                              advgetopt::GETOPT_FLAG_GROUP_OPTIONS>())
+                , advgetopt::Help("context is mandatory")
+            ),
+            advgetopt::define_option(
+                  advgetopt::Name("table-schema-path")
+                , advgetopt::Flags(advgetopt::command_flags<
+                              advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+                            , advgetopt::GETOPT_FLAG_REQUIRED
+                            , advgetopt::GETOPT_FLAG_MULTIPLE>())
+                , advgetopt::Help("path to the list of table schemata is mandatory")
+            ),
+            advgetopt::end_options()
+        };
+
+        options[0].f_default = database_path.c_str();
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+        advgetopt::options_environment const options_environment =
+        {
+            .f_project_name = "database",
+            .f_group_name = nullptr,
+            .f_options = options,
+        };
+#pragma GCC diagnostic pop
+
+        char const * cargv[] =
+        {
+            "/usr/bin/update",
+            "--table-schema-path",
+            tables_path.c_str(),
+            nullptr
+        };
+        int const argc(sizeof(cargv) / sizeof(cargv[0]) - 1);
+        char ** argv = const_cast<char **>(cargv);
+
+        advgetopt::getopt::pointer_t opt(std::make_shared<advgetopt::getopt>(options_environment, argc, argv));
+        snapdatabase::context::pointer_t context(snapdatabase::context::create_context(opt));
+
+        snapdatabase::table::pointer_t table(context->get_table("users"));
+        CATCH_REQUIRE(table != nullptr);
+
+        // ten rows share each age so the by_age index has entries with
+        // multiple OIDs
+        //
+        std::uint32_t const row_count(100);
+        std::vector<std::uint64_t> created_on;
+        for(std::uint32_t key(0); key < row_count; ++key)
+        {
+            snapdatabase::row::pointer_t row(table->row_new());
+            row->get_cell("key", true)->set_uint32(key);
+            row->get_cell("age", true)->set_uint8(key % 10);
+            row->get_cell("name", true)->set_string("user #" + std::to_string(key));
+            created_on.push_back(row->get_cell("_created_on", false)->get_time_us());
+            table->row_insert(row);
+        }
+
+        // the even rows get a new age; every other one of those gets a
+        // longer name so it has to move, the others get updated in place
+        //
+        auto name = [](std::uint32_t key)
+        {
+            if(key % 2 != 0)
+            {
+                return "user #" + std::to_string(key);
+            }
+            if(key % 4 == 0)
+            {
+                return std::string(100, 'u') + std::to_string(key);
+            }
+            return "u" + std::to_string(key);
+        };
+        auto age = [](std::uint32_t key)
+        {
+            return static_cast<std::uint8_t>(key % 2 == 0 ? 50 + key % 10 : key % 10);
+        };
+        for(std::uint32_t key(0); key < row_count; key += 2)
+        {
+            snapdatabase::row::pointer_t row(table->row_new());
+            row->get_cell("key", true)->set_uint32(key);
+            row->get_cell("age", true)->set_uint8(age(key));
+            row->get_cell("name", true)->set_string(name(key));
+            CATCH_REQUIRE(table->row_update(row));
+        }
+
+        // updating a row which does not exist fails
+        //
+        {
+            snapdatabase::row::pointer_t row(table->row_new());
+            row->get_cell("key", true)->set_uint32(row_count);
+            CATCH_REQUIRE_THROWS_AS(table->row_update(row), snapdatabase::row_not_found);
+        }
+
+        // updating a row with the same values is not a change
+        //
+        {
+            std::uint64_t const sequence(table->get_change_feed()->get_sequence());
+            CATCH_REQUIRE(sequence == row_count + row_count / 2);
+
+            snapdatabase::row::pointer_t row(table->row_new());
+            row->get_cell("key", true)->set_uint32(4);
+            row->get_cell("age", true)->set_uint8(age(4));
+            row->get_cell("name", true)->set_string(name(4));
+            CATCH_REQUIRE_FALSE(table->row_update(row));
+            CATCH_REQUIRE_FALSE(table->row_commit(row));
+            CATCH_REQUIRE(table->get_change_feed()->get_sequence() == sequence);
+
+            row->get_cell("age", true)->set_uint8(age(4));
+            row->get_cell("name", true)->set_string(name(4) + "!");
+            CATCH_REQUIRE(table->row_update(row));
+            CATCH_REQUIRE(table->get_change_feed()->get_sequence() == sequence + 1);
+
+            snapdatabase::change_t::vector_t changes;
+            CATCH_REQUIRE(table->get_change_feed()->read(sequence, changes, 0));
+            CATCH_REQUIRE(changes.size() == 1);
+            CATCH_REQUIRE(changes[0].f_type == snapdatabase::change_type_t::CHANGE_TYPE_UPDATE);
+
+            row->get_cell("name", true)->set_string(name(4));
+            CATCH_REQUIRE(table->row_update(row));
+        }
+
+        // the primary index returns the new version of the rows which
+        // kept their creation date
+        //
+        for(std::uint32_t key(0); key < row_count; ++key)
+        {
+            snapdatabase::conditions cond;
+            cond.set_columns({"_created_on", "key", "age", "name"});
+            snapdatabase::row::pointer_t k(table->row_new());
+            k->get_cell("key", true)->set_uint32(key);
+            cond.set_key("primary", k, snapdatabase::row::pointer_t());
+
+            snapdatabase::cursor::pointer_t cursor(table->row_select(cond));
+            snapdatabase::row::pointer_t r(cursor->next_row());
+            CATCH_REQUIRE(r != nullptr);
+            CATCH_REQUIRE(r->get_cell("age", false)->get_uint8() == age(key));
+            CATCH_REQUIRE(r->get_cell("name", false)->get_string() == name(key));
+            CATCH_REQUIRE(r->get_cell("_created_on", false)->get_time_us() == created_on[key]);
+            CATCH_REQUIRE(cursor->next_row() == nullptr);
+        }
+
+        // the by_age index moved the even rows to their new age
+        //
+        auto select_ages = [&](std::uint8_t min_age, std::uint8_t max_age)
+        {
+            snapdatabase::conditions cond;
+            cond.set_columns({"key", "age", "name"});
+            snapdatabase::row::pointer_t min_key(table->row_new());
+            min_key->get_cell("age", true)->set_uint8(min_age);
+            snapdatabase::row::pointer_t max_key(table->row_new());
+            max_key->get_cell("age", true)->set_uint8(max_age);
+            cond.set_key("by_age", min_key, max_key);
+
+            std::vector<std::uint32_t> keys;
+            std::uint8_t previous_age(0);
+            snapdatabase::cursor::pointer_t cursor(table->row_select(cond));
+            for(;;)
+            {
+                snapdatabase::row::pointer_t r(cursor->next_row());
+                if(r == nullptr)
+                {
+                    break;
+                }
+                std::uint32_t const key(r->get_cell("key", false)->get_uint32());
+                std::uint8_t const a(r->get_cell("age", false)->get_uint8());
+                CATCH_REQUIRE(a == age(key));
+                CATCH_REQUIRE(a >= previous_age);
+                CATCH_REQUIRE(r->get_cell("name", false)->get_string() == name(key));
+                previous_age = a;
+                keys.push_back(key);
+            }
+            return keys;
+        };
+
+        std::vector<std::uint32_t> keys(select_ages(50, 59));
+        CATCH_REQUIRE(keys.size() == row_count / 2);
+        for(auto const k : keys)
+        {
+            CATCH_REQUIRE(k % 2 == 0);
+        }
+
+        keys = select_ages(0, 9);
+        CATCH_REQUIRE(keys.size() == row_count / 2);
+        for(auto const k : keys)
+        {
+            CATCH_REQUIRE(k % 2 == 1);
+        }
+
+        // a row read from the table points directly in its block until
+        // that block gets modified, then it gets its own copy
+        //
+        {
+            auto read_name = [&](std::uint32_t key)
+            {
+                snapdatabase::conditions cond;
+                cond.set_columns({"key", "name"});
+                snapdatabase::row::pointer_t k(table->row_new());
+                k->get_cell("key", true)->set_uint32(key);
+                cond.set_key("primary", k, snapdatabase::row::pointer_t());
+
+                snapdatabase::cursor::pointer_t cursor(table->row_select(cond));
+                snapdatabase::row::pointer_t r(cursor->next_row());
+                CATCH_REQUIRE(r != nullptr);
+                return r->get_cell("name", false);
+            };
+            auto in_file = [&](snapdatabase::const_data_t ptr)
+            {
+                snapdatabase::const_data_t const start(table->get_dbfile()->data(0));
+                return ptr >= start && ptr < start + table->get_dbfile()->get_size();
+            };
+            auto string_data = [](snapdatabase::cell::pointer_t c)
+            {
+                std::size_t size(0);
+                snapdatabase::const_data_t const ptr(c->get_string_data(size));
+                return std::make_pair(ptr, std::string(reinterpret_cast<char const *>(ptr), size));
+            };
+
+            snapdatabase::cell::pointer_t old_name(read_name(6));
+            auto const before(string_data(old_name));
+            CATCH_REQUIRE(in_file(before.first));
+            CATCH_REQUIRE(before.second == name(6));
+
+            // the same length, so the row gets updated in place
+            //
+            snapdatabase::row::pointer_t row(table->row_new());
+            row->get_cell("key", true)->set_uint32(6);
+            row->get_cell("age", true)->set_uint8(age(6));
+            row->get_cell("name", true)->set_string("v6");
+            CATCH_REQUIRE(table->row_update(row));
+
+            auto const after(string_data(old_name));
+            CATCH_REQUIRE_FALSE(in_file(after.first));
+            CATCH_REQUIRE(after.second == name(6));
+            CATCH_REQUIRE(old_name->get_string() == name(6));
+
+            snapdatabase::cell::pointer_t new_name(read_name(6));
+            auto const updated(string_data(new_name));
+            CATCH_REQUIRE(in_file(updated.first));
+            CATCH_REQUIRE(updated.second == "v6");
+        }
+
+        context.reset();
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("commit log replay")
+    {
+        std::vector<std::string> const replay_context =
+            {
+                {
+                    "<!-- name=replay-context -->\n"
+                    "<context>\n"
+                      "<table name='kv' model='content' row-key='key'>\n"
+                        "<block-size>4096</block-size>\n"
+                        "<description>Rows which Survive a Crash</description>\n"
+                        "<schema>\n"
+                          "<column name='key' type='uint32' required='required'>\n"
+                            "<description>the key</description>\n"
+                          "</column>\n"
+                          "<column name='value' type='p8string'>\n"
+                            "<description>the value</description>\n"
+                          "</column>\n"
+                        "</schema>\n"
+                      "</table>\n"
+                    "</context>\n"
+                }
+            };
+
+        std::string const created(SNAP_CATCH2_NAMESPACE::setup_context("replay-context", replay_context));
+        CATCH_REQUIRE_FALSE(created.empty());
+        if(created.empty())
+        {
+            return;
+        }
+
+        std::string database_path(created + "/database");
+        std::string tables_path(created + "/tables");
+
+        advgetopt::option options[] =
+        {
+            advgetopt::define_option(
+                  advgetopt::Name("context")
+                , advgetopt::Flags(advgetopt::standalone_all_flags<
+                              advgetopt::GETOPT_FLAG_GROUP_OPTIONS>())
+                , advgetopt::Help("context is mandatory")
+            ),
+            advgetopt::define_option(
+                  advgetopt::Name("table-schema-path")
+                , advgetopt::Flags(advgetopt::command_flags<
+                              advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+                            , advgetopt::GETOPT_FLAG_REQUIRED
+                            , advgetopt::GETOPT_FLAG_MULTIPLE>())
+                , advgetopt::Help("path to the list of table schemata is mandatory")
+            ),
+            advgetopt::end_options()
+        };
+
+        options[0].f_default = database_path.c_str();
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+        advgetopt::options_environment const options_environment =
+        {
+            .f_project_name = "database",
+            .f_group_name = nullptr,
+            .f_options = options,
+        };
+#pragma GCC diagnostic pop
+
+        char const * cargv[] =
+        {
+            "/usr/bin/replay",
+            "--table-schema-path",
+            tables_path.c_str(),
+            nullptr
+        };
+        int const argc(sizeof(cargv) / sizeof(cargv[0]) - 1);
+        char ** argv = const_cast<char **>(cargv);
+
+        auto find_row = [](snapdatabase::table::pointer_t table, std::uint32_t key)
+        {
+            snapdatabase::conditions cond;
+            cond.set_columns({"key", "value"});
+            snapdatabase::row::pointer_t k(table->row_new());
+            k->get_cell("key", true)->set_uint32(key);
+            cond.set_key("primary", k, snapdatabase::row::pointer_t());
+            return table->row_select(cond)->next_row();
+        };
+
+        std::string const table_path(database_path + "/kv");
+        std::vector<std::string> const filenames{
+                  "main.snapdb"
+                , "bloom_filter.snapdb"
+                , "commit_log.snaplog"
+            };
+        std::vector<std::string> crash_files;
+
+        std::uint32_t const row_count(20);
+        {
+            advgetopt::getopt::pointer_t opt(std::make_shared<advgetopt::getopt>(options_environment, argc, argv));
+            snapdatabase::context::pointer_t context(snapdatabase::context::create_context(opt));
+
+            snapdatabase::table::pointer_t table(context->get_table("kv"));
+            CATCH_REQUIRE(table != nullptr);
+
+            // the first half is part of the table file, the second half
+            // is only found in the commit log
+            //
+            for(std::uint32_t key(0); key < row_count; ++key)
+            {
+                if(key == row_count / 2)
+                {
+                    table->checkpoint();
+                }
+
+                snapdatabase::row::pointer_t row(table->row_new());
+                row->get_cell("key", true)->set_uint32(key);
+                row->get_cell("value", true)->set_string("value #" + std::to_string(key));
+                table->row_insert(row);
+            }
+            CATCH_REQUIRE(find_row(table, row_count - 1) != nullptr);
+
+            // "crash" now: save the files as they are on disk
+            //
+            for(auto const & n : filenames)
+            {
+                std::ifstream in(table_path + "/" + n, std::ios::binary);
+                crash_files.emplace_back(
+                          std::istreambuf_iterator<char>(in)
+                        , std::istreambuf_iterator<char>());
+            }
+            CATCH_REQUIRE_FALSE(crash_files[2].empty());
+
+            context.reset();
+        }
+
+        // the last record of the log was not completely written
+        //
+        crash_files[2].resize(crash_files[2].size() - 5);
+        for(std::size_t idx(0); idx < filenames.size(); ++idx)
+        {
+            std::ofstream out(table_path + "/" + filenames[idx], std::ios::binary | std::ios::trunc);
+            out.write(crash_files[idx].data(), crash_files[idx].size());
+        }
+
+        {
+            advgetopt::getopt::pointer_t opt(std::make_shared<advgetopt::getopt>(options_environment, argc, argv));
+            snapdatabase::context::pointer_t context(snapdatabase::context::create_context(opt));
+
+            snapdatabase::table::pointer_t table(context->get_table("kv"));
+            CATCH_REQUIRE(table != nullptr);
+
+            // the pages modified by the last row were restored and the
+            // other rows were committed again
+            //
+            for(std::uint32_t key(0); key < row_count - 1; ++key)
+            {
+                snapdatabase::row::pointer_t r(find_row(table, key));
+                CATCH_REQUIRE(r != nullptr);
+                CATCH_REQUIRE(r->get_cell("value", false)->get_string() == "value #" + std::to_string(key));
+            }
+            CATCH_REQUIRE(find_row(table, row_count - 1) == nullptr);
+
+            struct stat s;
+            CATCH_REQUIRE(stat((table_path + "/commit_log.snaplog").c_str(), &s) == 0);
+            CATCH_REQUIRE(s.st_size == 0);
+
+            // the lost row can be inserted again
+            //
+            snapdatabase::row::pointer_t row(table->row_new());
+            row->get_cell("key", true)->set_uint32(row_count - 1);
+            row->get_cell("value", true)->set_string("value #" + std::to_string(row_count - 1));
+            CATCH_REQUIRE(table->row_insert(row));
+            CATCH_REQUIRE(find_row(table, row_count - 1) != nullptr);
+
+            context.reset();
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("bloom filter")
+    {
+        std::vector<std::string> const bloom_context =
+            {
+                {
+                    "<!-- name=bloom-context -->\n"
+                    "<context>\n"
+                      "<table name='keys' model='content' row-key='key'>\n"
+                        "<block-size>4096</block-size>\n"
+                        "<expected-rows>1000</expected-rows>\n"
+                        "<description>Keys Checked against the Bloom Filter</description>\n"
+                        "<schema>\n"
+                          "<column name='key' type='uint32' required='required'>\n"
+                            "<description>the key</description>\n"
+                          "</column>\n"
+                          "<column name='value' type='p8string'>\n"
+                            "<description>the value</description>\n"
+                          "</column>\n"
+                        "</schema>\n"
+                      "</table>\n"
+                    "</context>\n"
+                }
+            };
+
+        std::string const created(SNAP_CATCH2_NAMESPACE::setup_context("bloom-context", bloom_context));
+        CATCH_REQUIRE_FALSE(created.empty());
+        if(created.empty())
+        {
+            return;
+        }
+
+        std::string database_path(created + "/database");
+        std::string tables_path(created + "/tables");
+
+        advgetopt::option options[] =
+        {
+            advgetopt::define_option(
+                  advgetopt::Name("context")
+                , advgetopt::Flags(advgetopt::standalone_all_flags<
+                              advgetopt::GETOPT_FLAG_GROUP_OPTIONS>())
+                , advgetopt::Help("context is mandatory")
+            ),
+            advgetopt::define_option(
+                  advgetopt::Name("table-schema-path")
+                , advgetopt::Flags(advgetopt::command_flags<
+                              advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+                            , advgetopt::GETOPT_FLAG_REQUIRED
+                            , advgetopt::GETOPT_FLAG_MULTIPLE>())
+                , advgetopt::Help("path to the list of table schemata is mandatory")
+            ),
+            advgetopt::end_options()
+        };
+
+        options[0].f_default = database_path.c_str();
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+        advgetopt::options_environment const options_environment =
+        {
+            .f_project_name = "database",
+            .f_group_name = nullptr,
+            .f_options = options,
+        };
+#pragma GCC diagnostic pop
+
+        char const * cargv[] =
+        {
+            "/usr/bin/bloom",
+            "--table-schema-path",
+            tables_path.c_str(),
+            nullptr
+        };
+        int const argc(sizeof(cargv) / sizeof(cargv[0]) - 1);
+        char ** argv = const_cast<char **>(cargv);
+
+        // the Bloom Filter works with the murmur of the primary key
+        //
+        auto murmur_key = [](snapdatabase::table::pointer_t table, std::uint32_t key)
+        {
+            snapdatabase::conditions cond;
+            snapdatabase::row::pointer_t k(table->row_new());
+            k->get_cell("key", true)->set_uint32(key);
+            cond.set_key("primary", k, snapdatabase::row::pointer_t());
+            return cond.get_murmur_key();
+        };
+
+        auto find_row = [](snapdatabase::table::pointer_t table, std::uint32_t key)
+        {
+            snapdatabase::conditions cond;
+            cond.set_columns({"key", "value"});
+            snapdatabase::row::pointer_t k(table->row_new());
+            k->get_cell("key", true)->set_uint32(key);
+            cond.set_key("primary", k, snapdatabase::row::pointer_t());
+            return table->row_select(cond)->next_row();
+        };
+
+        // the even keys get inserted, the odd keys are never present
+        //
+        std::uint32_t const row_count(1000);
+
+        // no false negatives: all the keys which were added are found
+        //
+        auto verify_present_keys = [&](snapdatabase::table::pointer_t table)
+        {
+            snapdatabase::file_bloom_filter::pointer_t bloom_filter(table->get_bloom_filter());
+            CATCH_REQUIRE(bloom_filter != nullptr);
+            CATCH_REQUIRE(bloom_filter->get_item_count() == row_count);
+
+            for(std::uint32_t idx(0); idx < row_count; ++idx)
+            {
+                std::uint32_t const key(idx * 2);
+                CATCH_REQUIRE(bloom_filter->contains(murmur_key(table, key)));
+
+                snapdatabase::row::pointer_t r(find_row(table, key));
+                CATCH_REQUIRE(r != nullptr);
+                CATCH_REQUIRE(r->get_cell("value", false)->get_string() == "value #" + std::to_string(key));
+            }
+        };
+
+        {
+            advgetopt::getopt::pointer_t opt(std::make_shared<advgetopt::getopt>(options_environment, argc, argv));
+            snapdatabase::context::pointer_t context(snapdatabase::context::create_context(opt));
+
+            snapdatabase::table::pointer_t table(context->get_table("keys"));
+            CATCH_REQUIRE(table != nullptr);
+
+            snapdatabase::file_bloom_filter::pointer_t bloom_filter(table->get_bloom_filter());
+            CATCH_REQUIRE(bloom_filter != nullptr);
+            CATCH_REQUIRE(bloom_filter->get_item_count() == 0);
+            CATCH_REQUIRE_FALSE(bloom_filter->contains(murmur_key(table, 0)));
+
+            for(std::uint32_t idx(0); idx < row_count; ++idx)
+            {
+                std::uint32_t const key(idx * 2);
+                snapdatabase::row::pointer_t row(table->row_new());
+                row->get_cell("key", true)->set_uint32(key);
+                row->get_cell("value", true)->set_string("value #" + std::to_string(key));
+                CATCH_REQUIRE(table->row_insert(row));
+            }
+
+            verify_present_keys(table);
+
+            // false positives: the filter was sized for a 1% rate, make
+            // sure we are in that range; the rows are never found anyway
+            //
+            std::uint32_t const absent_count(10000);
+            std::uint32_t false_positives(0);
+            for(std::uint32_t idx(0); idx < absent_count; ++idx)
+            {
+                std::uint32_t const key(idx * 2 + 1);
+                if(bloom_filter->contains(murmur_key(table, key)))
+                {
+                    ++false_positives;
+                }
+                CATCH_REQUIRE(find_row(table, key) == nullptr);
+            }
+            CATCH_REQUIRE(false_positives < absent_count * 3 / 100);
+
+            context.reset();
+        }
+
+        // the filter is saved along the table; its pages are journaled
+        // so the rows committed again from the commit log do not get
+        // counted twice
+        //
+        {
+            advgetopt::getopt::pointer_t opt(std::make_shared<advgetopt::getopt>(options_environment, argc, argv));
+            snapdatabase::context::pointer_t context(snapdatabase::context::create_context(opt));
+
+            snapdatabase::table::pointer_t table(context->get_table("keys"));
+            CATCH_REQUIRE(table != nullptr);
+
+            verify_present_keys(table);
+
+            context.reset();
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("compressed strings at their limits")
+    {
+        std::vector<std::string> const strings_context =
+            {
+                {
+                    "<!-- name=strings-context -->\n"
+                    "<context>\n"
+                      "<table name='strings' model='content' row-key='key'>\n"
+                        "<block-size>4096</block-size>\n"
+                        "<description>Compressed Strings</description>\n"
+                        "<schema>\n"
+                          "<column name='key' type='uint32' required='required'>\n"
+                            "<description>the key</description>\n"
+                          "</column>\n"
+                          "<column name='s8' type='p8string' compress='lz4'>\n"
+                            "<description>a short compressed string</description>\n"
+                          "</column>\n"
+                          "<column name='s16' type='p16string' compress='zstd'>\n"
+                            "<description>a longer compressed string</description>\n"
+                          "</column>\n"
+                        "</schema>\n"
+                      "</table>\n"
+                    "</context>\n"
+                }
+            };
+
+        std::string const created(SNAP_CATCH2_NAMESPACE::setup_context("strings-context", strings_context));
+        CATCH_REQUIRE_FALSE(created.empty());
+        if(created.empty())
+        {
+            return;
+        }
+
+        std::string database_path(created + "/database");
+        std::string tables_path(created + "/tables");
+
+        advgetopt::option options[] =
+        {
+            advgetopt::define_option(
+                  advgetopt::Name("context")
+                , advgetopt::Flags(advgetopt::standalone_all_flags<
+                              advgetopt::GETOPT_FLAG_GROUP_OPTIONS>())
+                , advgetopt::Help("context is mandatory")
+            ),
+            advgetopt::define_option(
+                  advgetopt::Name("table-schema-path")
+                , advgetopt::Flags(advgetopt::command_flags<
+                              advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+                            , advgetopt::GETOPT_FLAG_REQUIRED
+                            , advgetopt::GETOPT_FLAG_MULTIPLE>())
+                , advgetopt::Help("path to the list of table schemata is mandatory")
+            ),
+            advgetopt::end_options()
+        };
+
+        options[0].f_default = database_path.c_str();
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+        advgetopt::options_environment const options_environment =
+        {
+            .f_project_name = "database",
+            .f_group_name = nullptr,
+            .f_options = options,
+        };
+#pragma GCC diagnostic pop
+
+        char const * cargv[] =
+        {
+            "/usr/bin/strings",
+            "--table-schema-path",
+            tables_path.c_str(),
+            nullptr
+        };
+        int const argc(sizeof(cargv) / sizeof(cargv[0]) - 1);
+        char ** argv = const_cast<char **>(cargv);
+
+        advgetopt::getopt::pointer_t opt(std::make_shared<advgetopt::getopt>(options_environment, argc, argv));
+        snapdatabase::context::pointer_t context(snapdatabase::context::create_context(opt));
+
+        snapdatabase::table::pointer_t table(context->get_table("strings"));
+        CATCH_REQUIRE(table != nullptr);
+
+        // strings which do not compress at all
+        //
+        std::uint32_t seed(1);
+        auto random_string = [&seed](std::size_t size)
+        {
+            std::string result(size, '\0');
+            for(auto & c : result)
+            {
+                seed = seed * 1103515245 + 12345;
+                c = static_cast<char>(seed >> 23);
+            }
+            return result;
+        };
+
+        auto round_trip = [&table](std::string const & name, std::string const & value)
+        {
+            snapdatabase::row::pointer_t row(table->row_new());
+            row->get_cell("key", true)->set_uint32(1);
+            row->get_cell(name, true)->set_string(value);
+            snapdatabase::buffer_t const binary(row->to_binary());
+
+            snapdatabase::row::pointer_t copy(table->row_new());
+            copy->from_binary(binary);
+            return copy->get_cell(name, false)->get_string();
+        };
+
+        auto too_long = [&table](std::string const & name, std::string const & value)
+        {
+            snapdatabase::row::pointer_t row(table->row_new());
+            row->get_cell("key", true)->set_uint32(1);
+            row->get_cell(name, true)->set_string(value);
+            CATCH_REQUIRE_THROWS_AS(row->to_binary(), snapdatabase::out_of_bounds);
+        };
+
+        // the compression header uses one byte of the value
+        //
+        std::string value(random_string(254));
+        CATCH_REQUIRE(round_trip("s8", value) == value);
+        too_long("s8", random_string(255));
+
+        value = random_string(65534);
+        CATCH_REQUIRE(round_trip("s16", value) == value);
+        too_long("s16", random_string(65535));
+
+        // a string which compresses can use the whole size
+        //
+        value = std::string(255, 'a');
+        CATCH_REQUIRE(round_trip("s8", value) == value);
+
+        value = std::string(65535, 'a');
+        CATCH_REQUIRE(round_trip("s16", value) == value);
+
         context.reset();
     }
     CATCH_END_SECTION()
@@ -0,0 +1,302 @@
+// Copyright (c) 2019  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapdatabase
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// self
+//
+#include    "main.h"
+
+
+// snapdatabase lib
+//
+#include    <snapdatabase/data/dbfile.h>
+#include    <snapdatabase/exception.h>
+
+
+// C lib
+//
+#include    <fcntl.h>
+#include    <unistd.h>
+
+
+
+namespace
+{
+
+
+
+// the dbfile uses the table name as a sub-directory
+//
+snapdatabase::dbfile::pointer_t create_dbfile(std::string const & table_name, size_t page_size)
+{
+    snapdatabase::dbfile::pointer_t f(std::make_shared<snapdatabase::dbfile>(
+                  SNAP_CATCH2_NAMESPACE::g_tmp_dir()
+                , table_name
+                , "segments"));
+
+    // start with a brand new file
+    //
+    unlink(f->get_fullname().c_str());
+
+    // the bloom filter type prevents the dbfile from creating a table header
+    //
+    f->set_type(snapdatabase::dbtype_t::FILE_TYPE_BLOOM_FILTER);
+    f->set_page_size(page_size);
+
+    return f;
+}
+
+
+void fill_page(snapdatabase::data_t ptr, size_t size, std::uint8_t seed)
+{
+    for(size_t idx(0); idx < size; ++idx)
+    {
+        ptr[idx] = static_cast<std::uint8_t>(seed + idx * 7);
+    }
+}
+
+
+bool verify_page(snapdatabase::const_data_t ptr, size_t size, std::uint8_t seed)
+{
+    for(size_t idx(0); idx < size; ++idx)
+    {
+        if(ptr[idx] != static_cast<std::uint8_t>(seed + idx * 7))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+bool verify_file_page(std::string const & filename, snapdatabase::reference_t offset, size_t size, std::uint8_t seed)
+{
+    int const fd(open(filename.c_str(), O_RDONLY | O_CLOEXEC));
+    if(fd == -1)
+    {
+        return false;
+    }
+    std::vector<std::uint8_t> buf(size);
+    ssize_t const r(pread(fd, buf.data(), size, offset));
+    close(fd);
+    return r == static_cast<ssize_t>(size)
+        && verify_page(buf.data(), size, seed);
+}
+
+
+
+}
+// no name namespace
+
+
+
+CATCH_TEST_CASE("DBFile", "[dbfile]")
+{
+    CATCH_START_SECTION("segment size")
+    {
+        snapdatabase::dbfile::pointer_t f(std::make_shared<snapdatabase::dbfile>(
+                      SNAP_CATCH2_NAMESPACE::g_tmp_dir()
+                    , "dbfile_segment_size"
+                    , "segments"));
+
+        CATCH_REQUIRE_THROWS_AS(f->get_segment_size(), snapdatabase::snapdatabase_logic_error);
+
+        size_t const system_page_size(snapdatabase::dbfile::get_system_page_size());
+
+        // a page size of 3 system pages does not divide the default
+        // segment size; the segment has to be a multiple of the pages
+        // so a block never crosses a segment boundary
+        //
+        f->set_page_size(system_page_size * 3);
+        CATCH_REQUIRE(f->get_page_size() == system_page_size * 3);
+
+        size_t const segment_size(f->get_segment_size());
+        CATCH_REQUIRE(segment_size % f->get_page_size() == 0);
+        CATCH_REQUIRE(segment_size <= snapdatabase::dbfile::DEFAULT_SEGMENT_SIZE);
+        CATCH_REQUIRE(segment_size + f->get_page_size() > snapdatabase::dbfile::DEFAULT_SEGMENT_SIZE);
+
+        CATCH_REQUIRE_THROWS_AS(f->set_page_size(system_page_size), snapdatabase::snapdatabase_logic_error);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("pages at segment boundaries")
+    {
+        size_t const page_size(snapdatabase::dbfile::get_system_page_size() * 3);
+        snapdatabase::dbfile::pointer_t f(create_dbfile("dbfile_boundaries", page_size));
+        size_t const segment_size(f->get_segment_size());
+
+        // three segments, the last one with a single page
+        //
+        f->grow(segment_size * 2 + page_size);
+        CATCH_REQUIRE(f->get_size() == segment_size * 2 + page_size);
+
+        snapdatabase::reference_t const offsets[] =
+        {
+            0,
+            page_size,
+            segment_size - page_size,   // last page of the first segment
+            segment_size,               // first page of the second segment
+            segment_size + page_size,
+            segment_size * 2 - page_size,
+            segment_size * 2,           // last page of the file
+        };
+
+        std::uint8_t seed(1);
+        for(auto const o : offsets)
+        {
+            snapdatabase::data_t ptr(f->data(o));
+            CATCH_REQUIRE(ptr != nullptr);
+            fill_page(ptr, page_size, seed);
+            ++seed;
+        }
+
+        // within one segment the pages are contiguous in memory
+        //
+        CATCH_REQUIRE(f->data(page_size) == f->data(0) + page_size);
+        CATCH_REQUIRE(f->data(segment_size - page_size) == f->data(0) + segment_size - page_size);
+        CATCH_REQUIRE(f->data(segment_size + page_size) == f->data(segment_size) + page_size);
+
+        // accessing the same page again returns the same pointer
+        //
+        seed = 1;
+        for(auto const o : offsets)
+        {
+            snapdatabase::data_t ptr(f->data(o));
+            CATCH_REQUIRE(f->data(o) == ptr);
+            CATCH_REQUIRE(verify_page(ptr, page_size, seed));
+            f->release_data(ptr);
+            ++seed;
+        }
+
+        // an offset within a page returns a pointer within that page
+        //
+        CATCH_REQUIRE(f->data(segment_size + 100) == f->data(segment_size) + 100);
+
+        // the data makes it to the file
+        //
+        f->flush();
+        seed = 1;
+        for(auto const o : offsets)
+        {
+            CATCH_REQUIRE(verify_file_page(f->get_fullname(), o, page_size, seed));
+            ++seed;
+        }
+
+        // a new dbfile maps the same data
+        //
+        snapdatabase::dbfile::pointer_t g(std::make_shared<snapdatabase::dbfile>(
+                      SNAP_CATCH2_NAMESPACE::g_tmp_dir()
+                    , "dbfile_boundaries"
+                    , "segments"));
+        g->set_type(snapdatabase::dbtype_t::FILE_TYPE_BLOOM_FILTER);
+        g->set_page_size(page_size);
+        seed = 1;
+        for(auto const o : offsets)
+        {
+            CATCH_REQUIRE(verify_page(g->data(o), page_size, seed));
+            ++seed;
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("growing and shrinking the file does not remap")
+    {
+        size_t const page_size(snapdatabase::dbfile::get_system_page_size());
+        snapdatabase::dbfile::pointer_t f(create_dbfile("dbfile_remap", page_size));
+        size_t const segment_size(f->get_segment_size());
+
+        f->grow(page_size);
+        snapdatabase::data_t const first(f->data(0));
+        fill_page(first, page_size, 33);
+
+        // grow within the first segment and in the next one
+        //
+        f->grow(segment_size + page_size * 2);
+        CATCH_REQUIRE(f->data(0) == first);
+        CATCH_REQUIRE(f->data(page_size) == first + page_size);
+        CATCH_REQUIRE(verify_page(first, page_size, 33));
+
+        snapdatabase::data_t const second(f->data(segment_size + page_size));
+        fill_page(second, page_size, 77);
+
+        // shrink and grow again, the segments remain mapped where they were
+        //
+        f->truncate(page_size);
+        CATCH_REQUIRE(f->get_size() == page_size);
+        CATCH_REQUIRE_THROWS_AS(f->truncate(page_size / 2), snapdatabase::snapdatabase_logic_error);
+
+        f->grow(segment_size + page_size * 2);
+        CATCH_REQUIRE(f->data(0) == first);
+        CATCH_REQUIRE(f->data(segment_size + page_size) == second);
+        CATCH_REQUIRE(verify_page(first, page_size, 33));
+
+        // the truncated pages come back as zeroes
+        //
+        for(size_t idx(0); idx < page_size; ++idx)
+        {
+            CATCH_REQUIRE(second[idx] == 0);
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("access patterns, prefetch and release")
+    {
+        size_t const page_size(snapdatabase::dbfile::get_system_page_size());
+        snapdatabase::dbfile::pointer_t f(create_dbfile("dbfile_prefetch", page_size));
+        size_t const segment_size(f->get_segment_size());
+
+        CATCH_REQUIRE(f->get_access_pattern() == snapdatabase::access_pattern_t::ACCESS_PATTERN_RANDOM);
+
+        f->grow(segment_size * 2);
+
+        snapdatabase::reference_t const last(segment_size - page_size);
+        fill_page(f->data(last), page_size, 5);
+        fill_page(f->data(segment_size), page_size, 9);
+
+        // prefetch an area crossing the segment boundary, including a
+        // segment which was not yet mapped
+        //
+        f->set_access_pattern(snapdatabase::access_pattern_t::ACCESS_PATTERN_SEQUENTIAL);
+        CATCH_REQUIRE(f->get_access_pattern() == snapdatabase::access_pattern_t::ACCESS_PATTERN_SEQUENTIAL);
+        f->prefetch(last, page_size * 2);
+        f->prefetch(segment_size * 2 - page_size, page_size);
+        f->set_access_pattern(snapdatabase::access_pattern_t::ACCESS_PATTERN_NORMAL);
+        CATCH_REQUIRE(f->get_access_pattern() == snapdatabase::access_pattern_t::ACCESS_PATTERN_NORMAL);
+
+        // releasing a page only drops it from our address space, the
+        // data is read back from the page cache
+        //
+        f->release_page(last);
+        f->release_page(segment_size);
+        CATCH_REQUIRE(verify_page(f->data(last), page_size, 5));
+        CATCH_REQUIRE(verify_page(f->data(segment_size), page_size, 9));
+
+        // releasing a page in a segment not yet mapped is ignored
+        //
+        f->release_page(segment_size * 5);
+
+        // pointers which are not ours are refused
+        //
+        std::uint8_t buf[16];
+        CATCH_REQUIRE_THROWS_AS(f->release_data(buf), snapdatabase::page_not_found);
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
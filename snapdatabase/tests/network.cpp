@@ -0,0 +1,392 @@
+// Copyright (c) 2019  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/snapdatabase
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// self
+//
+#include    "main.h"
+
+
+// snapdatabase lib
+//
+#include    <snapdatabase/exception.h>
+#include    <snapdatabase/network/client.h>
+#include    <snapdatabase/network/server.h>
+
+
+// advgetopt lib
+//
+#include    <advgetopt/options.h>
+
+
+// C++ lib
+//
+#include    <thread>
+
+
+
+
+CATCH_TEST_CASE("Network", "[network]")
+{
+    CATCH_START_SECTION("message frames")
+    {
+        snapdatabase::message ping(snapdatabase::command_t::COMMAND_PING, 33);
+
+        snapdatabase::message get(snapdatabase::command_t::COMMAND_GET, 0xFFFFFFFF);
+        get.add_string("table");
+        get.add_uint16(0x1234);
+        get.add_uint64(0x0102030405060708ULL);
+        get.add_buffer(snapdatabase::buffer_t{ 1, 2, 3 });
+
+        snapdatabase::message error(
+                  snapdatabase::command_t::COMMAND_ACKNOWLEDGEMENT
+                , 34
+                , snapdatabase::status_t::STATUS_TABLE_NOT_FOUND);
+
+        snapdatabase::buffer_t frames;
+        ping.to_binary(frames);
+        get.to_binary(frames);
+        error.to_binary(frames);
+        CATCH_REQUIRE(frames.size() == snapdatabase::MESSAGE_HEADER_SIZE * 3 + get.get_payload().size());
+
+        // an incomplete header or payload is not an error
+        //
+        snapdatabase::message msg;
+        CATCH_REQUIRE(snapdatabase::message::from_binary(frames.data(), snapdatabase::MESSAGE_HEADER_SIZE - 1, msg) == 0);
+        CATCH_REQUIRE(snapdatabase::message::from_binary(
+                  frames.data() + snapdatabase::MESSAGE_HEADER_SIZE
+                , snapdatabase::MESSAGE_HEADER_SIZE + get.get_payload().size() - 1
+                , msg) == 0);
+
+        std::size_t pos(snapdatabase::message::from_binary(frames.data(), frames.size(), msg));
+        CATCH_REQUIRE(pos == snapdatabase::MESSAGE_HEADER_SIZE);
+        CATCH_REQUIRE(msg.get_command() == snapdatabase::command_t::COMMAND_PING);
+        CATCH_REQUIRE(msg.get_request_id() == 33);
+        CATCH_REQUIRE(msg.end());
+
+        pos += snapdatabase::message::from_binary(frames.data() + pos, frames.size() - pos, msg);
+        CATCH_REQUIRE(msg.get_command() == snapdatabase::command_t::COMMAND_GET);
+        CATCH_REQUIRE(msg.get_request_id() == 0xFFFFFFFF);
+        CATCH_REQUIRE(msg.get_status() == snapdatabase::status_t::STATUS_OK);
+        CATCH_REQUIRE(msg.read_string() == "table");
+        CATCH_REQUIRE(msg.read_uint16() == 0x1234);
+        CATCH_REQUIRE(msg.read_uint64() == 0x0102030405060708ULL);
+        CATCH_REQUIRE(msg.read_buffer() == snapdatabase::buffer_t({ 1, 2, 3 }));
+        CATCH_REQUIRE(msg.end());
+        CATCH_REQUIRE_THROWS_AS(msg.read_uint8(), snapdatabase::protocol_error);
+
+        pos += snapdatabase::message::from_binary(frames.data() + pos, frames.size() - pos, msg);
+        CATCH_REQUIRE(pos == frames.size());
+        CATCH_REQUIRE(msg.get_command() == snapdatabase::command_t::COMMAND_ACKNOWLEDGEMENT);
+        CATCH_REQUIRE(msg.get_status() == snapdatabase::status_t::STATUS_TABLE_NOT_FOUND);
+
+        // a frame which does not start with the magic cannot be skipped
+        //
+        frames[1] = 'X';
+        CATCH_REQUIRE_THROWS_AS(
+                  snapdatabase::message::from_binary(frames.data(), frames.size(), msg)
+                , snapdatabase::protocol_error);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("change feed")
+    {
+        snapdatabase::change_feed feed(4);
+        CATCH_REQUIRE(feed.get_capacity() == 4);
+        CATCH_REQUIRE(feed.get_epoch() != 0);
+        CATCH_REQUIRE(feed.get_sequence() == 0);
+
+        std::vector<std::uint64_t> received;
+        snapdatabase::change_feed::listener_id_t const id(feed.add_listener(
+                [&received](snapdatabase::change_t const & c)
+                {
+                    received.push_back(c.f_sequence);
+                }));
+
+        for(std::uint8_t idx(1); idx <= 6; ++idx)
+        {
+            CATCH_REQUIRE(feed.append(snapdatabase::change_type_t::CHANGE_TYPE_INSERT, snapdatabase::buffer_t{ idx }) == idx);
+        }
+        CATCH_REQUIRE(received == std::vector<std::uint64_t>({ 1, 2, 3, 4, 5, 6 }));
+        CATCH_REQUIRE(feed.get_sequence() == 6);
+        CATCH_REQUIRE(feed.get_oldest_sequence() == 3);
+
+        // resume from a change still in the ring
+        //
+        snapdatabase::change_t::vector_t changes;
+        CATCH_REQUIRE(feed.read(4, changes));
+        CATCH_REQUIRE(changes.size() == 2);
+        CATCH_REQUIRE(changes[0].f_sequence == 5);
+        CATCH_REQUIRE(changes[0].f_row == snapdatabase::buffer_t{ 5 });
+        CATCH_REQUIRE(changes[1].f_sequence == 6);
+
+        changes.clear();
+        CATCH_REQUIRE(feed.read(2, changes));
+        CATCH_REQUIRE(changes.size() == 4);
+
+        changes.clear();
+        CATCH_REQUIRE(feed.read(6, changes));
+        CATCH_REQUIRE(changes.empty());
+
+        // changes 2 and 3 were overwritten
+        //
+        CATCH_REQUIRE_FALSE(feed.read(1, changes, 3));
+        CATCH_REQUIRE(changes.size() == 3);
+        CATCH_REQUIRE(changes[0].f_sequence == 3);
+
+        // a sequence from a previous epoch
+        //
+        changes.clear();
+        CATCH_REQUIRE_FALSE(feed.read(100, changes));
+        CATCH_REQUIRE(changes.size() == 4);
+
+        feed.remove_listener(id);
+        feed.append(snapdatabase::change_type_t::CHANGE_TYPE_UPDATE, snapdatabase::buffer_t());
+        CATCH_REQUIRE(received.size() == 6);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("loopback server")
+    {
+        std::vector<std::string> const network_context =
+            {
+                {
+                    "<!-- name=network-context -->\n"
+                    "<context>\n"
+                      "<table name='kv' model='content' row-key='key'>\n"
+                        "<block-size>4096</block-size>\n"
+                        "<description>Table accessed through the network</description>\n"
+                        "<schema>\n"
+                          "<column name='key' type='uint64' required='required'>\n"
+                            "<description>the key</description>\n"
+                          "</column>\n"
+                          "<column name='value' type='p32string'>\n"
+                            "<description>the value</description>\n"
+                          "</column>\n"
+                        "</schema>\n"
+                      "</table>\n"
+                    "</context>\n"
+                }
+            };
+
+        std::string const created(SNAP_CATCH2_NAMESPACE::setup_context("network-context", network_context));
+        CATCH_REQUIRE_FALSE(created.empty());
+        if(created.empty())
+        {
+            return;
+        }
+
+        std::string database_path(created + "/database");
+        std::string tables_path(created + "/tables");
+
+        advgetopt::option options[] =
+        {
+            advgetopt::define_option(
+                  advgetopt::Name("context")
+                , advgetopt::Flags(advgetopt::standalone_all_flags<
+                              advgetopt::GETOPT_FLAG_GROUP_OPTIONS>())
+                , advgetopt::Help("context is mandatory")
+            ),
+            advgetopt::define_option(
+                  advgetopt::Name("table-schema-path")
+                , advgetopt::Flags(advgetopt::command_flags<
+                              advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+                            , advgetopt::GETOPT_FLAG_REQUIRED
+                            , advgetopt::GETOPT_FLAG_MULTIPLE>())
+                , advgetopt::Help("path to the list of table schemata is mandatory")
+            ),
+            advgetopt::end_options()
+        };
+
+        options[0].f_default = database_path.c_str();
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+        advgetopt::options_environment const options_environment =
+        {
+            .f_project_name = "database",
+            .f_group_name = nullptr,
+            .f_options = options,
+        };
+#pragma GCC diagnostic pop
+
+        char const * cargv[] =
+        {
+            "/usr/bin/network",
+            "--table-schema-path",
+            tables_path.c_str(),
+            nullptr
+        };
+        int const argc(sizeof(cargv) / sizeof(cargv[0]) - 1);
+        char ** argv = const_cast<char **>(cargv);
+
+        advgetopt::getopt::pointer_t opt(std::make_shared<advgetopt::getopt>(options_environment, argc, argv));
+        snapdatabase::context::pointer_t context(snapdatabase::context::create_context(opt));
+        snapdatabase::table::pointer_t table(context->get_table("kv"));
+        CATCH_REQUIRE(table != nullptr);
+
+        // the rows are generated before the server starts since the
+        // context cannot be used by two threads at once
+        //
+        auto make_row = [table](std::uint64_t key, std::string const & value)
+            {
+                snapdatabase::row::pointer_t row(table->row_new());
+                row->get_cell("key", true)->set_uint64(key);
+                if(!value.empty())
+                {
+                    row->get_cell("value", true)->set_string(value);
+                }
+                return row->to_binary();
+            };
+
+        std::vector<snapdatabase::buffer_t> rows;
+        for(std::uint64_t key(0); key < 100; ++key)
+        {
+            rows.push_back(make_row(key, "value #" + std::to_string(key)));
+        }
+        snapdatabase::buffer_t const updated_row(make_row(5, "updated"));
+        snapdatabase::buffer_t const set_row(make_row(7, "set"));
+        snapdatabase::buffer_t const missing_row(make_row(1000, "missing"));
+        snapdatabase::client::buffers_t const keys{
+                  make_row(5, std::string())
+                , make_row(1000, std::string())
+                , make_row(99, std::string())
+            };
+
+        snapdatabase::server s(context, "127.0.0.1", 0);
+        CATCH_REQUIRE(s.get_port() != 0);
+        std::thread server_thread([&s]() { s.run(); });
+
+        snapdatabase::client::buffers_t found;
+        snapdatabase::change_t::vector_t changes;
+        {
+            snapdatabase::client c("127.0.0.1", s.get_port(), "unittest");
+            CATCH_REQUIRE_FALSE(c.get_server_version().empty());
+            c.ping();
+
+            snapdatabase::client l("127.0.0.1", s.get_port(), "listener");
+            snapdatabase::client::listen_t const listening(l.listen("kv"));
+            CATCH_REQUIRE(listening.f_epoch != 0);
+            CATCH_REQUIRE(listening.f_sequence == 0);
+            CATCH_REQUIRE_FALSE(listening.f_lost);
+            CATCH_REQUIRE_THROWS_AS(l.listen("unknown"), snapdatabase::protocol_error);
+
+            // pipeline all the inserts
+            //
+            std::vector<snapdatabase::request_id_t> ids;
+            for(auto const & r : rows)
+            {
+                snapdatabase::message msg(snapdatabase::client::make_commit(
+                          snapdatabase::command_t::COMMAND_INSERT
+                        , "kv"
+                        , r));
+                ids.push_back(c.post(msg));
+            }
+            for(auto const id : ids)
+            {
+                CATCH_REQUIRE(snapdatabase::client::is_acknowledged(c.wait(id)));
+            }
+
+            CATCH_REQUIRE_FALSE(c.insert("kv", rows[5]));
+            CATCH_REQUIRE_FALSE(c.update("kv", missing_row));
+            CATCH_REQUIRE(c.update("kv", updated_row));
+            CATCH_REQUIRE(c.set("kv", set_row));
+
+            // setting a row to the values it already has is not a change
+            //
+            CATCH_REQUIRE(c.set("kv", set_row));
+
+            found = c.get("kv", keys, { "key", "value" });
+
+            CATCH_REQUIRE_THROWS_AS(c.get("unknown", keys), snapdatabase::protocol_error);
+
+            // 100 inserts, one update, one set; the failed commits are
+            // not part of the feed
+            //
+            snapdatabase::change_t change;
+            snapdatabase::request_id_t listen_id(0);
+            for(std::uint64_t sequence(1); sequence <= 102; ++sequence)
+            {
+                CATCH_REQUIRE(l.next_change(change, listen_id, 5000));
+                CATCH_REQUIRE(listen_id == listening.f_request_id);
+                CATCH_REQUIRE(change.f_sequence == sequence);
+                changes.push_back(change);
+            }
+            CATCH_REQUIRE_FALSE(l.next_change(change, listen_id, 0));
+
+            // resume where a previous listener stopped
+            //
+            snapdatabase::client r("127.0.0.1", s.get_port(), "resume");
+            snapdatabase::client::listen_t const resumed(r.listen("kv", listening.f_epoch, 100));
+            CATCH_REQUIRE(resumed.f_epoch == listening.f_epoch);
+            CATCH_REQUIRE(resumed.f_sequence == 102);
+            CATCH_REQUIRE_FALSE(resumed.f_lost);
+            CATCH_REQUIRE(r.next_change(change, listen_id, 5000));
+            CATCH_REQUIRE(change.f_sequence == 101);
+            CATCH_REQUIRE(r.next_change(change, listen_id, 5000));
+            CATCH_REQUIRE(change.f_sequence == 102);
+            CATCH_REQUIRE_FALSE(r.next_change(change, listen_id, 0));
+
+            // a sequence from another epoch gets everything in the feed
+            //
+            snapdatabase::client::listen_t const restarted(r.listen("kv", listening.f_epoch - 1, 100));
+            CATCH_REQUIRE(restarted.f_lost);
+            CATCH_REQUIRE(r.next_change(change, listen_id, 5000));
+            CATCH_REQUIRE(listen_id == restarted.f_request_id);
+            CATCH_REQUIRE(change.f_sequence == 1);
+
+            c.disconnect();
+            l.disconnect();
+            r.disconnect();
+        }
+
+        s.stop();
+        server_thread.join();
+
+        snapdatabase::server::statistics_t const stats(s.get_statistics());
+        CATCH_REQUIRE(stats.f_connections == 3);
+        CATCH_REQUIRE(stats.f_errors == 4);
+        CATCH_REQUIRE(stats.f_changes == 102 + 2 + 102);
+
+        CATCH_REQUIRE(found.size() == 3);
+        CATCH_REQUIRE(found[1].empty());
+
+        snapdatabase::row::pointer_t r(table->row_new());
+        r->from_binary(found[0]);
+        CATCH_REQUIRE(r->get_cell("key", false)->get_uint64() == 5);
+        CATCH_REQUIRE(r->get_cell("value", false)->get_string() == "updated");
+
+        r = table->row_new();
+        r->from_binary(found[2]);
+        CATCH_REQUIRE(r->get_cell("key", false)->get_uint64() == 99);
+        CATCH_REQUIRE(r->get_cell("value", false)->get_string() == "value #99");
+
+        CATCH_REQUIRE(changes[0].f_type == snapdatabase::change_type_t::CHANGE_TYPE_INSERT);
+        CATCH_REQUIRE(changes[100].f_type == snapdatabase::change_type_t::CHANGE_TYPE_UPDATE);
+        r = table->row_new();
+        r->from_binary(changes[100].f_row);
+        CATCH_REQUIRE(r->get_cell("key", false)->get_uint64() == 5);
+        CATCH_REQUIRE(r->get_cell("value", false)->get_string() == "updated");
+
+        CATCH_REQUIRE(table->get_change_feed()->get_sequence() == 102);
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
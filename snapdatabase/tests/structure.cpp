@@ -309,6 +309,53 @@ CATCH_TEST_CASE("Structure", "[structure]")
         CATCH_REQUIRE(description->get_uinteger("model") == model);
     }
     CATCH_END_SECTION()
+
+    CATCH_START_SECTION("static fields")
+    {
+        constexpr snapdatabase::static_field_t<std::uint32_t> const count_field(snapdatabase::define_static_field<std::uint32_t>(g_description1, "count"));
+        constexpr snapdatabase::static_field_t<std::uint32_t> const size_field(snapdatabase::define_static_field<std::uint32_t>(g_description1, "size"));
+        constexpr snapdatabase::static_field_t<std::uint64_t> const previous_field(snapdatabase::define_static_field<std::uint64_t>(g_description1, "previous"));
+        static_assert(count_field.f_offset == 4, "count is expected at offset 4");
+        static_assert(previous_field.f_offset == 20, "previous is expected at offset 20");
+        static_assert(snapdatabase::static_structure_size(g_description1) == 28, "g_description1 is expected to be 28 bytes");
+
+        snapdatabase::structure::pointer_t description(std::make_shared<snapdatabase::structure>(g_description1));
+        description->init_buffer();
+
+        std::uint32_t count(123);
+        description->set_uinteger("count", count);
+        std::uint32_t size(900000);
+        description->set_uinteger("size", size);
+        snapdatabase::reference_t previous(0xff11ff11ff11);
+        description->set_uinteger("previous", previous);
+
+        // the static fields read the same data as the structure
+        //
+        snapdatabase::reference_t start_offset(0);
+        snapdatabase::virtual_buffer::pointer_t buffer(description->get_virtual_buffer(start_offset));
+        snapdatabase::buffer_t data(buffer->size());
+        buffer->pread(data.data(), data.size(), 0);
+        CATCH_REQUIRE(count_field.get(data.data()) == count);
+        CATCH_REQUIRE(size_field.get(data.data()) == size);
+        CATCH_REQUIRE(previous_field.get(data.data()) == previous);
+
+        previous_field.set(data.data(), 0x1234);
+        CATCH_REQUIRE(previous_field.get(data.data()) == 0x1234);
+        CATCH_REQUIRE(size_field.get(data.data()) == size);
+
+        // fields after a variable size field cannot be static
+        //
+        CATCH_REQUIRE_THROWS_AS(
+                  snapdatabase::define_static_field<std::uint16_t>(g_description2, "model")
+                , snapdatabase::invalid_size);
+        CATCH_REQUIRE_THROWS_AS(
+                  snapdatabase::define_static_field<std::uint64_t>(g_description1, "count")
+                , snapdatabase::invalid_size);
+        CATCH_REQUIRE_THROWS_AS(
+                  snapdatabase::define_static_field<std::uint32_t>(g_description1, "unknown")
+                , snapdatabase::field_not_found);
+    }
+    CATCH_END_SECTION()
 }
 
 
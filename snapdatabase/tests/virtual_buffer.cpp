@@ -122,6 +122,78 @@ CATCH_TEST_CASE("VirtualBuffer", "[virtual-buffer]")
         }
     }
     CATCH_END_SECTION()
+
+    CATCH_START_SECTION("many inserts and erases")
+    {
+        snapdatabase::virtual_buffer::pointer_t v(std::make_shared<snapdatabase::virtual_buffer>());
+
+        // the expected data is kept in a simple vector
+        //
+        std::vector<std::uint8_t> expected;
+        for(int count(0); count < 1000; ++count)
+        {
+            std::vector<std::uint8_t> buf(rand() % (count % 50 == 0 ? 100000 : 300) + 1);
+            for(auto & c : buf)
+            {
+                c = rand();
+            }
+
+            switch(rand() % 4)
+            {
+            case 0: // append
+                CATCH_REQUIRE(v->pwrite(buf.data(), buf.size(), expected.size(), true) == static_cast<int>(buf.size()));
+                expected.insert(expected.end(), buf.begin(), buf.end());
+                break;
+
+            case 1: // insert
+                {
+                    std::size_t const offset(rand() % (expected.size() + 1));
+                    CATCH_REQUIRE(v->pinsert(buf.data(), buf.size(), offset) == static_cast<int>(buf.size()));
+                    expected.insert(expected.begin() + offset, buf.begin(), buf.end());
+                }
+                break;
+
+            case 2: // erase
+                if(!expected.empty())
+                {
+                    std::size_t const offset(rand() % expected.size());
+                    std::size_t const size(std::min(static_cast<std::size_t>(rand() % 500), expected.size() - offset));
+                    CATCH_REQUIRE(v->perase(size, offset) == static_cast<int>(size));
+                    expected.erase(expected.begin() + offset, expected.begin() + offset + size);
+                }
+                break;
+
+            case 3: // overwrite
+                if(!expected.empty())
+                {
+                    std::size_t const offset(rand() % expected.size());
+                    std::size_t const size(std::min(buf.size(), expected.size() - offset));
+                    CATCH_REQUIRE(v->pwrite(buf.data(), size, offset) == static_cast<int>(size));
+                    std::copy(buf.begin(), buf.begin() + size, expected.begin() + offset);
+                }
+                break;
+
+            }
+
+            CATCH_REQUIRE(v->size() == expected.size());
+        }
+
+        std::vector<std::uint8_t> saved(expected.size());
+        CATCH_REQUIRE(v->pread(saved.data(), saved.size(), 0, true) == static_cast<int>(saved.size()));
+        CATCH_REQUIRE(saved == expected);
+
+        // and a few partial reads
+        //
+        for(int count(0); count < 100 && !expected.empty(); ++count)
+        {
+            std::size_t const offset(rand() % expected.size());
+            std::size_t const size(std::min(static_cast<std::size_t>(rand() % 1000 + 1), expected.size() - offset));
+            std::vector<std::uint8_t> part(size);
+            CATCH_REQUIRE(v->pread(part.data(), size, offset, true) == static_cast<int>(size));
+            CATCH_REQUIRE(std::equal(part.begin(), part.end(), expected.begin() + offset));
+        }
+    }
+    CATCH_END_SECTION()
 }
 
 
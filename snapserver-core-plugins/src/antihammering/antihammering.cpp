@@ -26,6 +26,10 @@
  * (which can be quite a few pages since.) The HTML pages is what we
  * primary want to count, although the first hit could be to any
  * other type of data (i.e. someone who links to one of our images.)
+ *
+ * The hits are counted in memory shared by all the snap_child processes
+ * (see hit_counter). The database is only written to when we decide to
+ * block a client.
  */
 
 
@@ -189,6 +193,29 @@ libdbproxy::table::pointer_t antihammering::get_antihammering_table()
 }
 
 
+/** \brief Get the shared hit counters.
+ *
+ * This function maps the file holding the hit counters shared by all
+ * the snap_child processes running on this computer. The file is saved
+ * under the run_path directory which is a RAM disk.
+ *
+ * \return The pointer to the hit counters.
+ */
+hit_counter::pointer_t antihammering::get_hit_counter()
+{
+    if(!f_hit_counter)
+    {
+        QString run_path(f_snap->get_server_parameter("run_path"));
+        if(run_path.isEmpty())
+        {
+            run_path = "/run/snapwebsites";
+        }
+        f_hit_counter = std::make_shared<hit_counter>((run_path + "/antihammering.counters").toUtf8().data());
+    }
+    return f_hit_counter;
+}
+
+
 /** \brief Count the hits from the output result.
  *
  * We count the hits whenever the hit goes out, this way we actually have
@@ -205,7 +232,7 @@ libdbproxy::table::pointer_t antihammering::get_antihammering_table()
  */
 void antihammering::on_output_result(QString const & uri_path, QByteArray & output)
 {
-    snapdev::NOT_USED(output);
+    snapdev::NOT_USED(uri_path, output);
 
     // retrieve the status
     //
@@ -233,40 +260,29 @@ void antihammering::on_output_result(QString const & uri_path, QByteArray & outp
         }
     }
 
-    // save the entry
-    //
-    // we save each entry separately because that way we can use Cassandra
-    // to auto-delete entries using the TTL instead of having to do that
-    // with a backend
+    // at this time we only count the HTML pages that were sent
+    // successfully, attachments and errors are ignored
     //
-    content::path_info_t ipath;
-    ipath.set_path(uri_path);
-
-    libdbproxy::value value;
-    value.setStringValue(ipath.get_key());
-    value.setTtl(10 * 60); // 10 min. -- change to use settings?
-
-    QString type("html-page");
+    if(code != 200)
+    {
+        return;
+    }
     if(f_snap->has_header(snap::get_name(snap::name_t::SNAP_NAME_CORE_CONTENT_TYPE_HEADER)))
     {
         QString const content_type(f_snap->get_header(snap::get_name(snap::name_t::SNAP_NAME_CORE_CONTENT_TYPE_HEADER)));
-        if(content_type == "text/html"
-        || content_type.startsWith("text/html;"))
+        if(content_type != "text/html"
+        && !content_type.startsWith("text/html;"))
         {
-            type = "html-page";
-        }
-        else
-        {
-            type = "attachment";
+            // an attachment
+            return;
         }
     }
 
-    QString const key(QString("%1 %2 %3").arg(code).arg(type).arg(f_snap->get_start_date(), 19, 10, QChar('0')));
-
+    // count the hit in memory; this used to be one database cell per
+    // hit which doubled the database load when we were being hammered
+    //
     QString const ip(f_snap->snapenv(snap::get_name(snap::name_t::SNAP_NAME_CORE_REMOTE_ADDR)));
-
-    libdbproxy::table::pointer_t antihammering_table(get_antihammering_table());
-    antihammering_table->getRow(ip)->getCell(key)->setValue(value);
+    get_hit_counter()->add_hit(ip, f_snap->get_start_date() / 1000000LL);
 }
 
 
@@ -342,17 +358,14 @@ void antihammering::on_check_for_redirect(content::path_info_t & ipath)
         snapdev::NOT_REACHED();
     }
 
-    // count the number of 200 which are HTML pages (result starts with "200 html-page")
-    //libdbproxy::QCassandraColumnRangePredicate html_page_predicate;
-    //html_page_predicate.setStartCellKey("200 html-page 0");
-    //html_page_predicate.setEndCellKey("200 html-page 9");
-    //int const page_count(antihammering_table->getRow(ip)->cellCount(html_page_predicate));
-
+    // count the number of 200 which are HTML pages in the last
+    // few seconds (the counters are in shared memory)
+    //
     int64_t const hit_limit_duration(row->getCell(get_name(name_t::SNAP_NAME_ANTIHAMMERING_HIT_LIMIT_DURATION))->getValue().safeInt64Value(0, 1LL));
-    auto html_page_predicate = std::make_shared<libdbproxy::cell_range_predicate>();
-    html_page_predicate->setStartCellKey(QString("200 html-page %1").arg(start_date - hit_limit_duration * 1000000LL, 19, 10, QChar('0')));
-    html_page_predicate->setEndCellKey("200 html-page 9"); // up to the end
-    int const page_count(antihammering_table->getRow(ip)->cellCount(html_page_predicate));
+    int64_t const page_count(get_hit_counter()->count(
+                      ip
+                    , start_date / 1000000LL
+                    , static_cast<int>(std::min(hit_limit_duration, static_cast<int64_t>(hit_counter::MAX_DURATION)))));
     int64_t const hit_limit(row->getCell(get_name(name_t::SNAP_NAME_ANTIHAMMERING_HIT_LIMIT))->getValue().safeInt64Value(0, 100LL));
     if(page_count >= hit_limit)
     {
@@ -372,16 +385,6 @@ void antihammering::on_check_for_redirect(content::path_info_t & ipath)
         snapdev::NOT_REACHED();
     }
 
-    // then count the number of errors (result over 399)
-    //auto error_predicate = std::make_shared<libdbproxy::cell_range_predicate>();
-    //error_predicate.setStartCellKey("400");
-    //error_predicate.setEndCellKey(":");
-    //int const error_count(antihammering_table->getRow(ip)->cellCount(error_predicate));
-
-    // now check where we stand
-    //int const total_count(antihammering_table->getRow(ip)->cellCount());
-    //SNAP_LOG_INFO("total count: ")(total_count)(", page count: ")(page_count)(", error count: ")(error_count);
-
 }
 
 
@@ -21,6 +21,11 @@
 #include "../path/path.h"
 
 
+// C++ lib
+//
+#include <memory>
+
+
 namespace snap
 {
 namespace antihammering
@@ -45,6 +50,31 @@ DECLARE_MAIN_EXCEPTION(antihammering_exception);
 
 
 
+class hit_counter
+{
+public:
+    typedef std::shared_ptr<hit_counter>    pointer_t;
+
+    static int const        MAX_DURATION = 60;  // in seconds
+
+                            hit_counter(std::string const & filename);
+                            hit_counter(hit_counter const &) = delete;
+                            ~hit_counter();
+
+    hit_counter &           operator = (hit_counter const &) = delete;
+
+    bool                    is_valid() const;
+    void                    add_hit(QString const & ip, int64_t now);
+    uint32_t                count(QString const & ip, int64_t now, int duration) const;
+
+private:
+    struct shared_data_t;
+
+    shared_data_t *         f_data = nullptr;
+};
+
+
+
 SERVERPLUGINS_VERSION(antihammering, 1, 0)
 
 
@@ -59,6 +89,7 @@ public:
     virtual time_t          do_update(time_t last_updated, unsigned int phase) override;
 
     libdbproxy::table::pointer_t get_antihammering_table();
+    hit_counter::pointer_t  get_hit_counter();
 
     // server signals
     void                    on_output_result(QString const & uri_path, QByteArray & output);
@@ -71,6 +102,7 @@ private:
 
     snap_child *                    f_snap = nullptr;
     libdbproxy::table::pointer_t    f_antihammering_table = libdbproxy::table::pointer_t();
+    hit_counter::pointer_t          f_hit_counter = hit_counter::pointer_t();
 };
 
 
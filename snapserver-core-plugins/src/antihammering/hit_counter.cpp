@@ -0,0 +1,459 @@
+// Copyright (c) 2013-2022  Made to Order Software Corp.  All Rights Reserved
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+/** \file
+ * \brief Count the hits of each IP address in shared memory.
+ *
+ * The anti-hammering plugin needs to know how many pages one IP address
+ * requested in the last few seconds. Saving one cell per hit in the
+ * database doubles the database load exactly when we are being attacked.
+ *
+ * Instead, all the snap_child processes of a computer share a memory
+ * mapped file in which the hits get counted. The file has a fixed size
+ * whatever the number of IP addresses: the counters form a count-min
+ * sketch per second. A count-min sketch may over-estimate a count when
+ * many IP addresses hit us at the same time, but it never under-estimates
+ * it, which is what we want to detect hammering.
+ *
+ * The sketch uses conservative updates: a hit only raises the counters
+ * of an IP address which are at its current minimum. The counters shared
+ * with other IP addresses which are already larger are left alone, which
+ * keeps the over-estimates much smaller under heavy traffic.
+ */
+
+
+// self
+//
+#include    "antihammering.h"
+
+
+// snaplogger
+//
+#include    <snaplogger/message.h>
+
+
+// C++ lib
+//
+#include    <algorithm>
+#include    <atomic>
+#include    <limits>
+
+
+// C lib
+//
+#include    <fcntl.h>
+#include    <sched.h>
+#include    <signal.h>
+#include    <string.h>
+#include    <sys/mman.h>
+#include    <sys/stat.h>
+#include    <unistd.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace snap
+{
+namespace antihammering
+{
+
+
+namespace
+{
+
+
+/** \brief Number of counters per IP address.
+ *
+ * Each IP address increments one counter in each row of the sketch.
+ * The count is the smallest of those counters.
+ */
+size_t const SKETCH_DEPTH = 4;
+
+
+/** \brief Number of counters in each row of the sketch.
+ */
+size_t const SKETCH_WIDTH = 1024;
+
+
+/** \brief Number of one second buckets.
+ *
+ * This must be larger than hit_counter::MAX_DURATION so the bucket
+ * being reused is never one we are reading.
+ */
+size_t const BUCKET_COUNT = 64;
+
+
+/** \brief Number of locks serializing the hits.
+ *
+ * The hits of one IP address always use the same lock.
+ */
+size_t const LOCK_COUNT = 64;
+
+
+/** \brief Number of attempts at getting a lock before yielding.
+ *
+ * After that many attempts, we also check whether the process holding
+ * the lock died.
+ */
+int const LOCK_ATTEMPTS = 1000;
+
+
+static_assert(BUCKET_COUNT > static_cast<size_t>(hit_counter::MAX_DURATION), "BUCKET_COUNT must be larger than MAX_DURATION");
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "std::atomic<uint32_t> must be usable in shared memory");
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "std::atomic<uint64_t> must be usable in shared memory");
+
+
+/** \brief Hash an IP address.
+ *
+ * We use the 64 bit FNV-1a hash. The two halves are used to compute
+ * the index of the IP in each row of the sketch.
+ *
+ * \param[in] ip  The IP address to hash.
+ *
+ * \return The 64 bit hash.
+ */
+uint64_t hash_ip(QString const & ip)
+{
+    QByteArray const utf8(ip.toUtf8());
+    uint64_t hash(14695981039346656037ULL);
+    for(char const c : utf8)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+
+/** \brief Compute the index of a hash in a given row.
+ *
+ * \param[in] hash  The hash of the IP address.
+ * \param[in] row  The row of the sketch.
+ *
+ * \return The index of the counter in that row.
+ */
+size_t counter_index(uint64_t hash, size_t row)
+{
+    uint64_t const h1(hash & 0xFFFFFFFF);
+    uint64_t const h2((hash >> 32) | 1);
+    return (h1 + row * h2) % SKETCH_WIDTH;
+}
+
+
+/** \brief Get the number of hits of a counter.
+ *
+ * Each counter holds the second it counts in its upper 32 bits and
+ * the number of hits in its lower 32 bits. A counter which was last
+ * used for another second has no hits for \p second.
+ *
+ * \param[in] counter  The value of the counter.
+ * \param[in] second  The second being counted.
+ *
+ * \return The number of hits during \p second.
+ */
+uint32_t counter_hits(uint64_t counter, int64_t second)
+{
+    if(static_cast<uint32_t>(counter >> 32) != static_cast<uint32_t>(second))
+    {
+        return 0;
+    }
+    return static_cast<uint32_t>(counter);
+}
+
+
+/** \brief Raise a counter to a number of hits.
+ *
+ * The counter is set to \p hits unless it already counts at least that
+ * many hits during \p second. A counter of an older second is reset at
+ * the same time. Since the second is part of the counter, the reset
+ * cannot lose the hits of other processes.
+ *
+ * \param[in] counter  The counter to raise.
+ * \param[in] second  The second being counted.
+ * \param[in] hits  The new minimum number of hits.
+ */
+void raise_counter(std::atomic<uint64_t> & counter, int64_t second, uint32_t hits)
+{
+    uint64_t current(counter.load(std::memory_order_relaxed));
+    for(;;)
+    {
+        uint32_t const counter_second(static_cast<uint32_t>(current >> 32));
+        if(static_cast<int32_t>(counter_second - static_cast<uint32_t>(second)) > 0)
+        {
+            // another process already moved to the next second
+            //
+            return;
+        }
+
+        if(counter_hits(current, second) >= hits)
+        {
+            return;
+        }
+
+        uint64_t const desired((static_cast<uint64_t>(static_cast<uint32_t>(second)) << 32) | hits);
+        if(counter.compare_exchange_weak(current, desired, std::memory_order_relaxed))
+        {
+            return;
+        }
+    }
+}
+
+
+/** \brief Lock the hits of an IP address.
+ *
+ * The lock holds the PID of the process which acquired it. If that
+ * process dies before releasing the lock, the lock gets stolen.
+ *
+ * \param[in] lock  The lock to acquire.
+ */
+void lock_hits(std::atomic<uint32_t> & lock)
+{
+    uint32_t const pid(static_cast<uint32_t>(getpid()));
+    for(int attempt(1);; ++attempt)
+    {
+        uint32_t expected(0);
+        if(lock.compare_exchange_weak(expected, pid, std::memory_order_acquire))
+        {
+            return;
+        }
+        if(attempt % LOCK_ATTEMPTS == 0)
+        {
+            if(expected != 0
+            && kill(static_cast<pid_t>(expected), 0) != 0
+            && errno == ESRCH
+            && lock.compare_exchange_strong(expected, pid, std::memory_order_acquire))
+            {
+                return;
+            }
+            sched_yield();
+        }
+    }
+}
+
+
+}
+// no name namespace
+
+
+
+/** \brief The data shared between all the processes.
+ *
+ * The memory mapped file starts zeroed which is a valid state: all the
+ * counters are viewed as belonging to second 0 and thus are too old to
+ * be counted.
+ */
+struct hit_counter::shared_data_t
+{
+    struct bucket_t
+    {
+        std::atomic<uint64_t>   f_counters[SKETCH_DEPTH][SKETCH_WIDTH];
+    };
+
+    std::atomic<uint32_t>       f_locks[LOCK_COUNT];
+    bucket_t                    f_buckets[BUCKET_COUNT];
+};
+
+
+
+/** \class hit_counter
+ * \brief Sliding window counter of hits per IP address.
+ *
+ * The hits are counted in one second buckets. The count of the last
+ * N seconds is the sum of the last N buckets.
+ *
+ * The buckets get reused every BUCKET_COUNT seconds. Each counter
+ * records the second it counts so a counter of a reused bucket restarts
+ * at zero the first time it gets hit. There is no global reset which
+ * could lose the hits counted by other processes in the meantime.
+ */
+
+
+/** \brief Map the shared counters.
+ *
+ * The file is created if it does not exist yet. All the processes
+ * opening the same file share the same counters.
+ *
+ * If the file cannot be opened or mapped, an error is logged and
+ * is_valid() returns false.
+ *
+ * \param[in] filename  The name of the file holding the counters.
+ */
+hit_counter::hit_counter(std::string const & filename)
+{
+    int const fd(open(filename.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600));
+    if(fd == -1)
+    {
+        int const e(errno);
+        SNAP_LOG_ERROR
+            << "could not open \""
+            << filename
+            << "\" for the antihammering hit counters (errno: "
+            << e
+            << ", "
+            << strerror(e)
+            << ")."
+            << SNAP_LOG_SEND;
+        return;
+    }
+
+    // the first process to open the file gives it its size, the new
+    // space is filled with zeroes
+    //
+    struct stat st = {};
+    if(fstat(fd, &st) != 0
+    || (static_cast<size_t>(st.st_size) != sizeof(shared_data_t)
+            && ftruncate(fd, sizeof(shared_data_t)) != 0))
+    {
+        int const e(errno);
+        SNAP_LOG_ERROR
+            << "could not resize \""
+            << filename
+            << "\" for the antihammering hit counters (errno: "
+            << e
+            << ", "
+            << strerror(e)
+            << ")."
+            << SNAP_LOG_SEND;
+        close(fd);
+        return;
+    }
+
+    void * ptr(mmap(nullptr, sizeof(shared_data_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+    close(fd);
+    if(ptr == MAP_FAILED)
+    {
+        int const e(errno);
+        SNAP_LOG_ERROR
+            << "could not map \""
+            << filename
+            << "\" for the antihammering hit counters (errno: "
+            << e
+            << ", "
+            << strerror(e)
+            << ")."
+            << SNAP_LOG_SEND;
+        return;
+    }
+
+    f_data = reinterpret_cast<shared_data_t *>(ptr);
+}
+
+
+/** \brief Unmap the shared counters.
+ */
+hit_counter::~hit_counter()
+{
+    if(f_data != nullptr)
+    {
+        munmap(f_data, sizeof(shared_data_t));
+    }
+}
+
+
+/** \brief Check whether the counters are available.
+ *
+ * \return true if the shared memory was mapped.
+ */
+bool hit_counter::is_valid() const
+{
+    return f_data != nullptr;
+}
+
+
+/** \brief Count one hit for the specified IP address.
+ *
+ * \param[in] ip  The IP address of the client.
+ * \param[in] now  The current time in seconds.
+ */
+void hit_counter::add_hit(QString const & ip, int64_t now)
+{
+    if(f_data == nullptr)
+    {
+        return;
+    }
+
+    shared_data_t::bucket_t & bucket(f_data->f_buckets[now % BUCKET_COUNT]);
+    uint64_t const hash(hash_ip(ip));
+
+    // two hits of the same IP address must not both raise its counters
+    // to the same minimum, so they get serialized
+    //
+    std::atomic<uint32_t> & lock(f_data->f_locks[hash % LOCK_COUNT]);
+    lock_hits(lock);
+
+    // conservative update: the current count is the minimum, only the
+    // counters at that minimum need to be incremented
+    //
+    uint32_t minimum(std::numeric_limits<uint32_t>::max());
+    for(size_t row(0); row < SKETCH_DEPTH; ++row)
+    {
+        minimum = std::min(minimum, counter_hits(bucket.f_counters[row][counter_index(hash, row)].load(std::memory_order_relaxed), now));
+    }
+    for(size_t row(0); row < SKETCH_DEPTH; ++row)
+    {
+        raise_counter(bucket.f_counters[row][counter_index(hash, row)], now, minimum + 1);
+    }
+
+    lock.store(0, std::memory_order_release);
+}
+
+
+/** \brief Count the hits of an IP address in the last few seconds.
+ *
+ * The count includes the current second and the \p duration - 1
+ * previous seconds.
+ *
+ * \param[in] ip  The IP address of the client.
+ * \param[in] now  The current time in seconds.
+ * \param[in] duration  The number of seconds to count, clamped between
+ *                      1 and MAX_DURATION.
+ *
+ * \return The number of hits, possibly over-estimated.
+ */
+uint32_t hit_counter::count(QString const & ip, int64_t now, int duration) const
+{
+    if(f_data == nullptr)
+    {
+        return 0;
+    }
+
+    duration = std::max(1, std::min(duration, static_cast<int>(MAX_DURATION)));
+
+    uint64_t const hash(hash_ip(ip));
+    uint32_t total(0);
+    for(int64_t second(now - duration + 1); second <= now; ++second)
+    {
+        shared_data_t::bucket_t const & bucket(f_data->f_buckets[second % BUCKET_COUNT]);
+        uint32_t hits(std::numeric_limits<uint32_t>::max());
+        for(size_t row(0); row < SKETCH_DEPTH; ++row)
+        {
+            hits = std::min(hits, counter_hits(bucket.f_counters[row][counter_index(hash, row)].load(std::memory_order_relaxed), second));
+        }
+        total += hits;
+    }
+
+    return total;
+}
+
+
+
+} // namespace antihammering
+} // namespace snap
+// vim: ts=4 sw=4 et
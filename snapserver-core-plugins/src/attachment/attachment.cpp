@@ -379,18 +379,28 @@ bool attachment::check_for_minified_js_or_css(content::path_info_t & ipath, path
     // depending on whether we have the .gz, define which fields we want to
     // check for the data of this file
     bool must_be_compressed(false);
+    bool accept_compressed(false);
     content::name_t name(content::name_t::SNAP_NAME_CONTENT_FILES_DATA_MINIFIED);
     content::name_t fallback_name(content::name_t::SNAP_NAME_CONTENT_FILES_DATA);
     if(versioned_filename.endsWith(".min" + extension))
     {
         versioned_filename = versioned_filename.left(versioned_filename.length() - extension.length() - 4);
 
-        // we can use the encoded version only if the client supports gzip
-        // (note that we are not going to be using the best possible
-        // compression in this case...)
+        // the variant we send depends on the Accept-Encoding header,
+        // including when the client accepts none of our compressions,
+        // so caches must keep one copy per encoding
+        //
+        f_snap->set_header("Vary", "Accept-Encoding", snap_child::HEADER_MODE_NO_ERROR);
+
+        // we can use an encoded version only if the client supports
+        // one of our compressions; the smallest one gets selected below
+        //
         snap_child::compression_vector_t compressions(f_snap->get_compression());
-        if(compressions.contains(snap_child::compression_t::COMPRESSION_GZIP))
+        if(compressions.contains(snap_child::compression_t::COMPRESSION_GZIP)
+        || compressions.contains(snap_child::compression_t::COMPRESSION_BROTLI)
+        || compressions.contains(snap_child::compression_t::COMPRESSION_ZSTD))
         {
+            accept_compressed = true;
             name = content::name_t::SNAP_NAME_CONTENT_FILES_DATA_MINIFIED_GZIP_COMPRESSED;
             fallback_name = content::name_t::SNAP_NAME_CONTENT_FILES_DATA_GZIP_COMPRESSED;
         }
@@ -514,31 +524,52 @@ bool attachment::check_for_minified_js_or_css(content::path_info_t & ipath, path
         return false;
     }
 
+    libdbproxy::row::pointer_t file_row(files_table->getRow(attachment_key.binaryValue()));
     for(;;)
     {
         // check for the minified version
-        bool const field_name(files_table->getRow(attachment_key.binaryValue())->exists(content::get_name(name)));
-        bool field_fallback_name(false);
-        if(!field_name)
+        //
+        content::name_t field(name);
+        QString encoding;
+        bool found(false);
+        if(accept_compressed)
+        {
+            // send the smallest variant the client accepts, minified
+            // if available
+            //
+            found = select_compressed_variant(file_row, true, field, encoding)
+                 || select_compressed_variant(file_row, false, field, encoding);
+        }
+        else if(file_row->exists(content::get_name(name)))
+        {
+            found = true;
+        }
+        else if(file_row->exists(content::get_name(fallback_name)))
         {
-            field_fallback_name = files_table->getRow(attachment_key.binaryValue())->exists(content::get_name(fallback_name));
+            field = fallback_name;
+            found = true;
         }
-        if(field_name || field_fallback_name)
+        if(found)
         {
             // this compression only applies if no errors occur later
-            if(name == content::name_t::SNAP_NAME_CONTENT_FILES_DATA_MINIFIED_GZIP_COMPRESSED
-            && !must_be_compressed)
+            //
+            if(!encoding.isEmpty())
             {
-                f_snap->set_header("Content-Encoding", "gzip", snap_child::HEADER_MODE_NO_ERROR);
+                f_snap->set_header("Content-Encoding", encoding, snap_child::HEADER_MODE_NO_ERROR);
             }
 
             // use the MD5 sum
             //
             // note that all versions get the same MD5SUM but so it the
             // Last-Modified so I don't think that will make any difference
-            // at this point
+            // at this point; the encoding is added since each variant
+            // has different bytes
             //
-            QString const md5sum(dbutils::key_to_string(attachment_key.binaryValue()));
+            QString md5sum(dbutils::key_to_string(attachment_key.binaryValue()));
+            if(!encoding.isEmpty())
+            {
+                md5sum += "-" + encoding;
+            }
             f_snap->set_header("ETag", md5sum);
 
             // get the last modification time of this very version
@@ -552,18 +583,22 @@ bool attachment::check_for_minified_js_or_css(content::path_info_t & ipath, path
             cache_control_settings & page_cache_control(f_snap->page_cache_control());
 
             page_cache_control.add_tag("attachment");
-            switch(field_name ? name : fallback_name)
+            switch(field)
             {
             case content::name_t::SNAP_NAME_CONTENT_FILES_DATA_MINIFIED:
                 page_cache_control.add_tag("minified");
                 break;
 
+            case content::name_t::SNAP_NAME_CONTENT_FILES_DATA_MINIFIED_BROTLI_COMPRESSED:
             case content::name_t::SNAP_NAME_CONTENT_FILES_DATA_MINIFIED_GZIP_COMPRESSED:
+            case content::name_t::SNAP_NAME_CONTENT_FILES_DATA_MINIFIED_ZSTD_COMPRESSED:
                 page_cache_control.add_tag("minified");
                 page_cache_control.add_tag("compressed");
                 break;
 
+            case content::name_t::SNAP_NAME_CONTENT_FILES_DATA_BROTLI_COMPRESSED:
             case content::name_t::SNAP_NAME_CONTENT_FILES_DATA_GZIP_COMPRESSED:
+            case content::name_t::SNAP_NAME_CONTENT_FILES_DATA_ZSTD_COMPRESSED:
                 page_cache_control.add_tag("compressed");
                 break;
 
@@ -623,7 +658,7 @@ bool attachment::check_for_minified_js_or_css(content::path_info_t & ipath, path
             // tell the path plugin that we know how to handle this one
             //
             plugin_info.set_plugin_if_renamed(this, attachment_ipath.get_cpath());
-            ipath.set_parameter("attachment_field", content::get_name(field_name ? name : fallback_name));
+            ipath.set_parameter("attachment_field", content::get_name(field));
             ipath.set_parameter("attachment_version", version);
             return true;
         }
@@ -638,6 +673,7 @@ bool attachment::check_for_minified_js_or_css(content::path_info_t & ipath, path
             break;
         }
 
+        accept_compressed = false;
         name = content::name_t::SNAP_NAME_CONTENT_FILES_DATA_MINIFIED;
         fallback_name = content::name_t::SNAP_NAME_CONTENT_FILES_DATA;
     }
@@ -646,6 +682,97 @@ bool attachment::check_for_minified_js_or_css(content::path_info_t & ipath, path
 }
 
 
+/** \brief Select the smallest compressed variant accepted by the client.
+ *
+ * The backend saves a gzip, a brotli, and a zstd compressed version of
+ * each file (see content::backend_compress_variants()). This function
+ * reads the size of each variant and returns the smallest one that the
+ * client accepts as per its Accept-Encoding header.
+ *
+ * A size of zero means that the compressor could not make the file any
+ * smaller so that variant does not exist.
+ *
+ * Since the response depends on the Accept-Encoding header, this
+ * function also adds a "Vary: Accept-Encoding" header, whether or not
+ * a variant gets selected.
+ *
+ * \param[in] file_row  The row of the file in the files table.
+ * \param[in] minified  Whether to check the minified variants.
+ * \param[out] name  The name of the field holding the selected variant.
+ * \param[out] encoding  The Content-Encoding of the selected variant.
+ *
+ * \return true if a variant was selected.
+ */
+bool attachment::select_compressed_variant(libdbproxy::row::pointer_t file_row, bool minified, content::name_t & name, QString & encoding)
+{
+    struct variant_t
+    {
+        snap_child::compression_t   f_compression = snap_child::compression_t::COMPRESSION_IDENTITY;
+        char const *                f_encoding = nullptr;
+        content::name_t             f_data = content::name_t::SNAP_NAME_CONTENT_FILES_DATA;
+        content::name_t             f_size = content::name_t::SNAP_NAME_CONTENT_FILES_SIZE;
+    };
+    variant_t const variants[] =
+    {
+        { snap_child::compression_t::COMPRESSION_GZIP,   "gzip", content::name_t::SNAP_NAME_CONTENT_FILES_DATA_GZIP_COMPRESSED,   content::name_t::SNAP_NAME_CONTENT_FILES_SIZE_GZIP_COMPRESSED   },
+        { snap_child::compression_t::COMPRESSION_BROTLI, "br",   content::name_t::SNAP_NAME_CONTENT_FILES_DATA_BROTLI_COMPRESSED, content::name_t::SNAP_NAME_CONTENT_FILES_SIZE_BROTLI_COMPRESSED },
+        { snap_child::compression_t::COMPRESSION_ZSTD,   "zstd", content::name_t::SNAP_NAME_CONTENT_FILES_DATA_ZSTD_COMPRESSED,   content::name_t::SNAP_NAME_CONTENT_FILES_SIZE_ZSTD_COMPRESSED   },
+    };
+    variant_t const minified_variants[] =
+    {
+        { snap_child::compression_t::COMPRESSION_GZIP,   "gzip", content::name_t::SNAP_NAME_CONTENT_FILES_DATA_MINIFIED_GZIP_COMPRESSED,   content::name_t::SNAP_NAME_CONTENT_FILES_SIZE_MINIFIED_GZIP_COMPRESSED   },
+        { snap_child::compression_t::COMPRESSION_BROTLI, "br",   content::name_t::SNAP_NAME_CONTENT_FILES_DATA_MINIFIED_BROTLI_COMPRESSED, content::name_t::SNAP_NAME_CONTENT_FILES_SIZE_MINIFIED_BROTLI_COMPRESSED },
+        { snap_child::compression_t::COMPRESSION_ZSTD,   "zstd", content::name_t::SNAP_NAME_CONTENT_FILES_DATA_MINIFIED_ZSTD_COMPRESSED,   content::name_t::SNAP_NAME_CONTENT_FILES_SIZE_MINIFIED_ZSTD_COMPRESSED   },
+    };
+
+    f_snap->set_header("Vary", "Accept-Encoding", snap_child::HEADER_MODE_NO_ERROR);
+
+    snap_child::compression_vector_t const compressions(f_snap->get_compression());
+
+    // read all the size fields at once
+    //
+    char const * size_name(content::get_name(content::name_t::SNAP_NAME_CONTENT_FILES_SIZE));
+    auto column_predicate(std::make_shared<libdbproxy::cell_range_predicate>());
+    column_predicate->setStartCellKey(QString("%1::").arg(size_name));
+    column_predicate->setEndCellKey(QString("%1:;").arg(size_name));
+    column_predicate->setCount(100);
+    file_row->readCells(column_predicate);
+    libdbproxy::cells const cells(file_row->getCells());
+
+    uint32_t best_size(0);
+    variant_t const * list(minified ? minified_variants : variants);
+    size_t const max_variants(sizeof(variants) / sizeof(variants[0]));
+    for(size_t idx(0); idx < max_variants; ++idx)
+    {
+        variant_t const & v(list[idx]);
+        if(!compressions.contains(v.f_compression))
+        {
+            continue;
+        }
+        libdbproxy::cells::const_iterator const it(cells.find(QByteArray(content::get_name(v.f_size))));
+        if(it == cells.end())
+        {
+            continue;
+        }
+        libdbproxy::value const size((*it)->getValue());
+        if(size.size() != sizeof(uint32_t)
+        || size.uint32Value() == 0)
+        {
+            continue;
+        }
+        if(best_size == 0
+        || size.uint32Value() < best_size)
+        {
+            best_size = size.uint32Value();
+            name = v.f_data;
+            encoding = v.f_encoding;
+        }
+    }
+
+    return best_size != 0;
+}
+
+
 /** \brief Execute a page: generate the complete attachment of that page.
  *
  * This function displays the page that the user is trying to view. It is
@@ -777,6 +904,20 @@ SNAP_LOG_TRACE
 
     libdbproxy::row::pointer_t file_row(files_table->getRow(attachment_key.binaryValue()));
 
+    // send the smallest precompressed variant that the client accepts
+    // (only for the file as is, a renamed path already selected its field)
+    //
+    QString encoding;
+    if(renamed.isEmpty())
+    {
+        content::name_t variant(content::name_t::SNAP_NAME_CONTENT_FILES_DATA);
+        if(select_compressed_variant(file_row, false, variant, encoding))
+        {
+            field_name = content::get_name(variant);
+            f_snap->set_header("Content-Encoding", encoding, snap_child::HEADER_MODE_NO_ERROR);
+        }
+    }
+
     // get the attachment MIME type and tweak it if it is a known text format
     libdbproxy::value attachment_mime_type(file_row->getCell(content::get_name(content::name_t::SNAP_NAME_CONTENT_FILES_MIME_TYPE))->getValue());
     QString content_type(attachment_mime_type.stringValue());
@@ -796,9 +937,19 @@ SNAP_LOG_TRACE
         // them but clients are expected to query for them on each load
         // (i.e. a must-revalidate type of cache)
         //
-        QString const md5sum(dbutils::key_to_string(attachment_key.binaryValue()));
+        QString md5sum(dbutils::key_to_string(attachment_key.binaryValue()));
+        if(!encoding.isEmpty())
+        {
+            md5sum += "-" + encoding;
+        }
         f_snap->set_header("ETag", md5sum);
 
+        // large files such as videos and PDFs are often read in parts
+        // (seek, resume a download) so let the client use Range with
+        // the ETag above as the If-Range validator
+        //
+        f_snap->accept_byte_ranges();
+
         cache_control_settings & page_cache_control(f_snap->page_cache_control());
         page_cache_control.add_tag("attachment");
 
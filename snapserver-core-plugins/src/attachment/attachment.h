@@ -89,6 +89,7 @@ private:
 
     bool                check_for_uncompressed_file(content::path_info_t & ipath, path::dynamic_plugin_t & plugin_info);
     bool                check_for_minified_js_or_css(content::path_info_t & ipath, path::dynamic_plugin_t & plugin_info, QString const & extension);
+    bool                select_compressed_variant(libdbproxy::row::pointer_t file_row, bool minified, content::name_t & name, QString & encoding);
 
     snap_child *        f_snap = nullptr;
 };
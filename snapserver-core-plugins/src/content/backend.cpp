@@ -1019,22 +1019,73 @@ bool content::process_attachment_impl(libdbproxy::row::pointer_t file_row, attac
  */
 void content::backend_compressed_file(libdbproxy::row::pointer_t file_row, attachment_file const & file)
 {
-    if(!file_row->exists(get_name(name_t::SNAP_NAME_CONTENT_FILES_SIZE_GZIP_COMPRESSED)))
+    backend_compress_variants(file_row, file.get_file().get_data(), false, true);
+}
+
+
+/** \brief Save the compressed variants of a file.
+ *
+ * This function compresses \p data with each one of the compressors
+ * that browsers support (gzip, brotli, and zstd) and saves the results
+ * in the corresponding data and size fields. The attachment plugin then
+ * sends the smallest variant that the client accepts.
+ *
+ * The compression happens once, here, so we can use the highest level.
+ *
+ * When a compressor does not make the data any smaller, the size field
+ * is set to zero and no data field gets created.
+ *
+ * \param[in] file_row  The row to the file being processed.
+ * \param[in] data  The data to compress.
+ * \param[in] minified  Whether \p data is the minified version of the file.
+ * \param[in] only_if_missing  Skip variants which already have a size field.
+ */
+void content::backend_compress_variants(libdbproxy::row::pointer_t file_row, QByteArray const & data, bool minified, bool only_if_missing)
+{
+    struct variant_t
+    {
+        char const *    f_compressor = nullptr;
+        name_t          f_data = name_t::SNAP_NAME_CONTENT_FILES_DATA;
+        name_t          f_size = name_t::SNAP_NAME_CONTENT_FILES_SIZE;
+    };
+    variant_t const variants[] =
     {
-        QString compressor_name("gzip");
-        QByteArray compressed_file(compression::compress(compressor_name, file.get_file().get_data(), 100, false));
-        if(compressor_name == "gzip")
+        { "gzip",   name_t::SNAP_NAME_CONTENT_FILES_DATA_GZIP_COMPRESSED,   name_t::SNAP_NAME_CONTENT_FILES_SIZE_GZIP_COMPRESSED   },
+        { "brotli", name_t::SNAP_NAME_CONTENT_FILES_DATA_BROTLI_COMPRESSED, name_t::SNAP_NAME_CONTENT_FILES_SIZE_BROTLI_COMPRESSED },
+        { "zstd",   name_t::SNAP_NAME_CONTENT_FILES_DATA_ZSTD_COMPRESSED,   name_t::SNAP_NAME_CONTENT_FILES_SIZE_ZSTD_COMPRESSED   },
+    };
+    variant_t const minified_variants[] =
+    {
+        { "gzip",   name_t::SNAP_NAME_CONTENT_FILES_DATA_MINIFIED_GZIP_COMPRESSED,   name_t::SNAP_NAME_CONTENT_FILES_SIZE_MINIFIED_GZIP_COMPRESSED   },
+        { "brotli", name_t::SNAP_NAME_CONTENT_FILES_DATA_MINIFIED_BROTLI_COMPRESSED, name_t::SNAP_NAME_CONTENT_FILES_SIZE_MINIFIED_BROTLI_COMPRESSED },
+        { "zstd",   name_t::SNAP_NAME_CONTENT_FILES_DATA_MINIFIED_ZSTD_COMPRESSED,   name_t::SNAP_NAME_CONTENT_FILES_SIZE_MINIFIED_ZSTD_COMPRESSED   },
+    };
+
+    variant_t const * list(minified ? minified_variants : variants);
+    size_t const max_variants(sizeof(variants) / sizeof(variants[0]));
+    for(size_t idx(0); idx < max_variants; ++idx)
+    {
+        variant_t const & v(list[idx]);
+        if(only_if_missing
+        && file_row->exists(get_name(v.f_size)))
+        {
+            continue;
+        }
+
+        QString compressor_name(v.f_compressor);
+        QByteArray compressed_file(compression::compress(compressor_name, data, 100, false));
+        if(compressor_name == v.f_compressor)
         {
             // compression succeeded
-            file_row->getCell(get_name(name_t::SNAP_NAME_CONTENT_FILES_DATA_GZIP_COMPRESSED))->setValue(compressed_file);
+            file_row->getCell(get_name(v.f_data))->setValue(compressed_file);
             uint32_t const compressed_size(compressed_file.size());
-            file_row->getCell(get_name(name_t::SNAP_NAME_CONTENT_FILES_SIZE_GZIP_COMPRESSED))->setValue(compressed_size);
+            file_row->getCell(get_name(v.f_size))->setValue(compressed_size);
         }
         else
         {
             // no better when compressed, mark such with a size of zero
             uint32_t const empty_size(0);
-            file_row->getCell(get_name(name_t::SNAP_NAME_CONTENT_FILES_SIZE_GZIP_COMPRESSED))->setValue(empty_size);
+            file_row->getCell(get_name(v.f_size))->setValue(empty_size);
         }
     }
 }
@@ -1048,8 +1099,8 @@ void content::backend_compressed_file(libdbproxy::row::pointer_t file_row, attac
  * gets parsed by the csspp library. If the parsing and compiling works,
  * then it gets saved minified.
  *
- * The minified also gets compressed by gzip and saved as a minified
- * compressed version of the file.
+ * The minified also gets compressed by gzip, brotli, and zstd and saved
+ * as minified compressed versions of the file.
  *
  * If we ever create a CSS plugin (i.e. to let the end users edit CSS,
  * for example) we certainly should move this processing in that
@@ -1112,21 +1163,7 @@ void content::backend_minify_css_file(libdbproxy::row::pointer_t file_row, attac
 
                     // now attempt to compress (it should pretty much always
                     // get compressed since it is text)
-                    QString compressor_name("gzip");
-                    QByteArray compressed_file(compression::compress(compressor_name, minified, 100, false));
-                    if(compressor_name == "gzip")
-                    {
-                        // compression succeeded
-                        file_row->getCell(get_name(name_t::SNAP_NAME_CONTENT_FILES_DATA_MINIFIED_GZIP_COMPRESSED))->setValue(compressed_file);
-                        uint32_t const compressed_size(compressed_file.size());
-                        file_row->getCell(get_name(name_t::SNAP_NAME_CONTENT_FILES_SIZE_MINIFIED_GZIP_COMPRESSED))->setValue(compressed_size);
-                    }
-                    else
-                    {
-                        // no better when compressed, mark such with a size of zero
-                        uint32_t const empty_size(0);
-                        file_row->getCell(get_name(name_t::SNAP_NAME_CONTENT_FILES_SIZE_MINIFIED_GZIP_COMPRESSED))->setValue(empty_size);
-                    }
+                    backend_compress_variants(file_row, minified, true, false);
                 }
             }
         }
@@ -232,15 +232,27 @@ char const * get_name(name_t name)
     case name_t::SNAP_NAME_CONTENT_FILES_DATA:
         return "content::files::data";
 
+    case name_t::SNAP_NAME_CONTENT_FILES_DATA_BROTLI_COMPRESSED:
+        return "content::files::data::brotli_compressed";
+
     case name_t::SNAP_NAME_CONTENT_FILES_DATA_GZIP_COMPRESSED:
         return "content::files::data::gzip_compressed";
 
     case name_t::SNAP_NAME_CONTENT_FILES_DATA_MINIFIED:
         return "content::files::data::minified";
 
+    case name_t::SNAP_NAME_CONTENT_FILES_DATA_MINIFIED_BROTLI_COMPRESSED:
+        return "content::files::data::minified::brotli_compressed";
+
     case name_t::SNAP_NAME_CONTENT_FILES_DATA_MINIFIED_GZIP_COMPRESSED:
         return "content::files::data::minified::gzip_compressed";
 
+    case name_t::SNAP_NAME_CONTENT_FILES_DATA_MINIFIED_ZSTD_COMPRESSED:
+        return "content::files::data::minified::zstd_compressed";
+
+    case name_t::SNAP_NAME_CONTENT_FILES_DATA_ZSTD_COMPRESSED:
+        return "content::files::data::zstd_compressed";
+
     case name_t::SNAP_NAME_CONTENT_FILES_DEPENDENCY:
         return "content::files::dependency";
 
@@ -283,15 +295,27 @@ char const * get_name(name_t name)
     case name_t::SNAP_NAME_CONTENT_FILES_SIZE:
         return "content::files::size";
 
+    case name_t::SNAP_NAME_CONTENT_FILES_SIZE_BROTLI_COMPRESSED:
+        return "content::files::size::brotli_compressed";
+
     case name_t::SNAP_NAME_CONTENT_FILES_SIZE_GZIP_COMPRESSED:
         return "content::files::size::gzip_compressed";
 
     case name_t::SNAP_NAME_CONTENT_FILES_SIZE_MINIFIED:
         return "content::files::size::minified";
 
+    case name_t::SNAP_NAME_CONTENT_FILES_SIZE_MINIFIED_BROTLI_COMPRESSED:
+        return "content::files::size::minified::brotli_compressed";
+
     case name_t::SNAP_NAME_CONTENT_FILES_SIZE_MINIFIED_GZIP_COMPRESSED:
         return "content::files::size::minified::gzip_compressed";
 
+    case name_t::SNAP_NAME_CONTENT_FILES_SIZE_MINIFIED_ZSTD_COMPRESSED:
+        return "content::files::size::minified::zstd_compressed";
+
+    case name_t::SNAP_NAME_CONTENT_FILES_SIZE_ZSTD_COMPRESSED:
+        return "content::files::size::zstd_compressed";
+
     case name_t::SNAP_NAME_CONTENT_FILES_TABLE:
         return "files";
 
@@ -539,6 +563,9 @@ time_t content::do_update(time_t last_updated, unsigned int phase)
  * \li content::files::data::minified::gzip_compressed
  * \li content::files::size::minified::gzip_compressed
  *
+ * The brotli and zstd compressors use the same scheme with
+ * "brotli_compressed" and "zstd_compressed" as the last segment.
+ *
  * So... the "content::files::compressor" field is not required. Not
  * only that, so far I created it with a direct 'char const *' pointer
  * which means 0x01 was saved in that field instead of the intended
@@ -77,9 +77,13 @@ enum class name_t
     SNAP_NAME_CONTENT_FILES_CREATION_TIME,
     SNAP_NAME_CONTENT_FILES_CSS,
     SNAP_NAME_CONTENT_FILES_DATA,
+    SNAP_NAME_CONTENT_FILES_DATA_BROTLI_COMPRESSED,
     SNAP_NAME_CONTENT_FILES_DATA_GZIP_COMPRESSED,
     SNAP_NAME_CONTENT_FILES_DATA_MINIFIED,
+    SNAP_NAME_CONTENT_FILES_DATA_MINIFIED_BROTLI_COMPRESSED,
     SNAP_NAME_CONTENT_FILES_DATA_MINIFIED_GZIP_COMPRESSED,
+    SNAP_NAME_CONTENT_FILES_DATA_MINIFIED_ZSTD_COMPRESSED,
+    SNAP_NAME_CONTENT_FILES_DATA_ZSTD_COMPRESSED,
     SNAP_NAME_CONTENT_FILES_DEPENDENCY,
     SNAP_NAME_CONTENT_FILES_FILENAME,
     SNAP_NAME_CONTENT_FILES_IMAGE_HEIGHT,
@@ -94,9 +98,13 @@ enum class name_t
     SNAP_NAME_CONTENT_FILES_SECURE_LAST_CHECK,
     SNAP_NAME_CONTENT_FILES_SECURITY_REASON,
     SNAP_NAME_CONTENT_FILES_SIZE,
+    SNAP_NAME_CONTENT_FILES_SIZE_BROTLI_COMPRESSED,
     SNAP_NAME_CONTENT_FILES_SIZE_GZIP_COMPRESSED,
     SNAP_NAME_CONTENT_FILES_SIZE_MINIFIED,
+    SNAP_NAME_CONTENT_FILES_SIZE_MINIFIED_BROTLI_COMPRESSED,
     SNAP_NAME_CONTENT_FILES_SIZE_MINIFIED_GZIP_COMPRESSED,
+    SNAP_NAME_CONTENT_FILES_SIZE_MINIFIED_ZSTD_COMPRESSED,
+    SNAP_NAME_CONTENT_FILES_SIZE_ZSTD_COMPRESSED,
     SNAP_NAME_CONTENT_FILES_TABLE,
     SNAP_NAME_CONTENT_FILES_UPDATED,
     SNAP_NAME_CONTENT_FINAL,
@@ -842,6 +850,7 @@ private:
     void        backend_action_new_file();
     void        backend_compressed_file(libdbproxy::row::pointer_t file_row, attachment_file const& file);
     void        backend_minify_css_file(libdbproxy::row::pointer_t file_row, attachment_file const& file);
+    void        backend_compress_variants(libdbproxy::row::pointer_t file_row, QByteArray const & data, bool minified, bool only_if_missing);
     void        backend_action_rebuild_index();
 
     void        journal_list_pop(journal_list * journal);
@@ -27,6 +27,11 @@
 #include    "content.h"
 
 
+// snapwebsites
+//
+#include    <snapwebsites/db_prefetch.h>
+
+
 // snaplogger
 //
 #include    <snaplogger/message.h>
@@ -713,14 +718,37 @@ snap_version::version_number_t path_info_t::get_revision() const
             //
             if(snap_version::SPECIAL_VERSION_UNDEFINED == f_revision)
             {
+                // read the current revision of all the locales of this
+                // branch at once instead of one access per locale; the
+                // cell without a locale has no "::" so it gets added
+                // by name, the prefix includes the "::" so branch 1
+                // does not also match branches 10 to 19
+                //
+                QString const revision_prefix(QString("%1::%2::%3")
+                        .arg(get_name(name_t::SNAP_NAME_CONTENT_REVISION_CONTROL))
+                        .arg(get_name(get_working_branch()
+                                ? name_t::SNAP_NAME_CONTENT_REVISION_CONTROL_CURRENT_WORKING_REVISION
+                                : name_t::SNAP_NAME_CONTENT_REVISION_CONTROL_CURRENT_REVISION))
+                        .arg(f_branch));
+                db_prefetch prefetch;
+                prefetch.add(f_content_table, key, revision_prefix);
+                prefetch.add_prefix(f_content_table, key, revision_prefix + "::");
+                prefetch.execute();
+
                 // search for a locale that works
                 //
                 for(auto const & l: locales)
                 {
                     QString const locale(l.get_composed());
-                    f_revision = f_content_plugin->get_current_revision(key, f_branch, locale, get_working_branch());
-                    if(snap_version::SPECIAL_VERSION_UNDEFINED != f_revision)
+                    QString revision_key(revision_prefix);
+                    if(!locale.isEmpty())
+                    {
+                        revision_key += "::" + locale;
+                    }
+                    libdbproxy::value const revision(prefetch.get_value(f_content_table, key, revision_key));
+                    if(revision.size() == sizeof(uint32_t))
                     {
+                        f_revision = revision.uint32Value();
                         f_locale = locale;
                         break;
                     }
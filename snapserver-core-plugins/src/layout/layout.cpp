@@ -116,6 +116,12 @@ char const * get_name(name_t name)
     case name_t::SNAP_NAME_LAYOUT_BOXES:
         return "layout::boxes";
 
+    case name_t::SNAP_NAME_LAYOUT_BOXES_LAST_UPDATED:
+        return "layout::boxes_last_updated";
+
+    case name_t::SNAP_NAME_LAYOUT_CACHE_BOX:
+        return "layout::cache_box";
+
     case name_t::SNAP_NAME_LAYOUT_CONTENT_XML:
         return "content.xml";
 
@@ -161,6 +167,8 @@ void layout::bootstrap()
     SERVERPLUGINS_LISTEN(layout, "server", server, load_file, boost::placeholders::_1, boost::placeholders::_2);
     SERVERPLUGINS_LISTEN(layout, "server", server, improve_signature, boost::placeholders::_1, boost::placeholders::_2, boost::placeholders::_3);
     SERVERPLUGINS_LISTEN(layout, "content", content::content, copy_branch_cells, boost::placeholders::_1, boost::placeholders::_2, boost::placeholders::_3);
+    SERVERPLUGINS_LISTEN(layout, "content", content::content, modified_content, boost::placeholders::_1);
+    SERVERPLUGINS_LISTEN(layout, "links", links::links, modified_link, boost::placeholders::_1, boost::placeholders::_2);
 }
 
 
@@ -1545,7 +1553,7 @@ SNAP_LOG_TRACE
                                 //QDomElement metadata(snap_dom::get_element(doc, "metadata"));
                                 //generate_header_content(ipath, head, metadata, "");
 
-                                lb->on_generate_boxes_content(ipath, box_ipath, page, filter_box);
+                                generate_box_content(lb, ipath, box_ipath, page, filter_box);
 
                                 // Unfortunately running the full page content
                                 // signal would overwrite the main data... not good!
@@ -1572,6 +1580,150 @@ SNAP_LOG_TRACE
 }
 
 
+/** \brief Generate the content of one box.
+ *
+ * This function calls the on_generate_boxes_content() function of the
+ * plugin owning the box unless the output of that box is available in
+ * the cache table.
+ *
+ * Only boxes with a layout::cache_box field are cached. The field is
+ * expected to be set to one of the following:
+ *
+ * \li "site" -- the box output is the same on all the pages of the
+ *     website (i.e. a navigation menu, a list of the latest news);
+ * \li "page" -- the box output depends on the page being displayed.
+ *
+ * The cache key also includes the branch, revision, and locale of the
+ * box and whatever other plugins add through the box_cache_key() signal
+ * (the permissions plugin adds the class of the user so people with
+ * different rights never share the same box output.)
+ *
+ * The cached data becomes invalid as soon as any page or link gets
+ * modified (see reset_boxes_cache().)
+ *
+ * The cells are never updated once their key is not used anymore
+ * (i.e. older revisions, pages or user classes no longer accessed)
+ * so they are saved with a TTL of one day. A box displayed more often
+ * than that gets regenerated once a day at most.
+ *
+ * \warning
+ * A cached box only saves the children of its \<filter> tag. A box
+ * which also modifies the rest of the page (i.e. adds a JavaScript
+ * to the header) must not be marked as cacheable.
+ *
+ * \param[in] lb  The plugin that generates this box.
+ * \param[in,out] page_ipath  The page being displayed.
+ * \param[in,out] box_ipath  The box being generated.
+ * \param[in,out] page  The page element.
+ * \param[in,out] filter_box  The element receiving the box output.
+ */
+void layout::generate_box_content(layout_boxes * lb, content::path_info_t & page_ipath, content::path_info_t & box_ipath, QDomElement & page, QDomElement & filter_box)
+{
+    content::content * content_plugin(content::content::instance());
+    libdbproxy::table::pointer_t branch_table(content_plugin->get_branch_table());
+    QString const cache_box_name(get_name(name_t::SNAP_NAME_LAYOUT_CACHE_BOX));
+    QString cache_mode;
+    if(branch_table->exists(box_ipath.get_branch_key())
+    && branch_table->getRow(box_ipath.get_branch_key())->exists(cache_box_name))
+    {
+        cache_mode = branch_table->getRow(box_ipath.get_branch_key())->getCell(cache_box_name)->getValue().stringValue();
+    }
+    if(cache_mode != "site"
+    && cache_mode != "page")
+    {
+        lb->on_generate_boxes_content(page_ipath, box_ipath, page, filter_box);
+        return;
+    }
+
+    QString cache_key(QString("%1::box::%2.%3::%4")
+                .arg(get_name(name_t::SNAP_NAME_LAYOUT_NAMESPACE))
+                .arg(box_ipath.get_branch())
+                .arg(box_ipath.get_revision())
+                .arg(box_ipath.get_locale()));
+    if(cache_mode == "page")
+    {
+        cache_key += "::";
+        cache_key += page_ipath.get_cpath();
+    }
+    box_cache_key(box_ipath, cache_key);
+
+    libdbproxy::table::pointer_t cache_table(content_plugin->get_cache_table());
+    QString const box_key(box_ipath.get_key());
+    if(cache_table->exists(box_key)
+    && cache_table->getRow(box_key)->exists(cache_key))
+    {
+        libdbproxy::value const cache_value(cache_table->getRow(box_key)->getCell(cache_key)->getValue());
+        int64_t const timestamp(cache_value.safeInt64Value());
+        libdbproxy::value const last_updated_value(f_snap->get_site_parameter(get_name(name_t::SNAP_NAME_LAYOUT_BOXES_LAST_UPDATED)));
+        if(timestamp >= last_updated_value.safeInt64Value())
+        {
+            QDomDocument cached_box;
+            if(cached_box.setContent(cache_value.stringValue(sizeof(int64_t))))
+            {
+                QDomDocument doc(filter_box.ownerDocument());
+                for(QDomNode child(cached_box.documentElement().firstChild()); !child.isNull(); child = child.nextSibling())
+                {
+                    filter_box.appendChild(doc.importNode(child, true));
+                }
+                return;
+            }
+        }
+    }
+
+    lb->on_generate_boxes_content(page_ipath, box_ipath, page, filter_box);
+
+    // save the result for the next time
+    //
+    QDomDocument box_doc;
+    QDomElement root(box_doc.createElement("box"));
+    box_doc.appendChild(root);
+    for(QDomNode child(filter_box.firstChild()); !child.isNull(); child = child.nextSibling())
+    {
+        root.appendChild(box_doc.importNode(child, true));
+    }
+
+    int const BOX_CACHE_TTL = 86400; // 1 day
+
+    QByteArray value;
+    libdbproxy::setInt64Value(value, f_snap->get_start_date());
+    libdbproxy::appendStringValue(value, box_doc.toString(-1));
+    libdbproxy::value box_value;
+    box_value.setBinaryValue(value);
+    box_value.setTtl(BOX_CACHE_TTL);
+    cache_table->getRow(box_key)->getCell(cache_key)->setValue(box_value);
+}
+
+
+/** \brief Reset the boxes cache.
+ *
+ * This function saves 'now' as the threshold of the boxes cache. Any
+ * box output cached before that date is ignored and gets regenerated.
+ *
+ * Like the permissions cache, we add a small epsilon so requests
+ * running in parallel to this one do not save an old box output
+ * as valid.
+ *
+ * To avoid writing to the database on each modification (a request
+ * may modify many pages) the threshold is only updated once it was
+ * reached.
+ */
+void layout::reset_boxes_cache()
+{
+    int64_t const EXPECTED_TIME_ACCURACY_EPSILON = 10000; // 10ms
+
+    int64_t const now(f_snap->get_current_date());
+    if(now < f_boxes_cache_reset)
+    {
+        return;
+    }
+    f_boxes_cache_reset = now + EXPECTED_TIME_ACCURACY_EPSILON;
+
+    libdbproxy::value value;
+    value.setInt64Value(f_boxes_cache_reset);
+    f_snap->set_site_parameter(get_name(name_t::SNAP_NAME_LAYOUT_BOXES_LAST_UPDATED), value);
+}
+
+
 /** \brief Apply the theme on an XML document.
  *
  * This function applies the theme to an XML document representing a
@@ -2395,6 +2547,38 @@ void layout::on_copy_branch_cells(libdbproxy::cells & source_cells, libdbproxy::
 }
 
 
+/** \brief A page was modified.
+ *
+ * Any page may be part of a box (a list, a menu...) so we have to
+ * invalidate the boxes cache.
+ *
+ * \param[in,out] ipath  The page that was modified.
+ */
+void layout::on_modified_content(content::path_info_t & ipath)
+{
+    snapdev::NOT_USED(ipath);
+
+    reset_boxes_cache();
+}
+
+
+/** \brief A link was modified.
+ *
+ * Links define the children of a page, its tags, its permissions, etc.
+ * all of which may change the output of a box so we have to invalidate
+ * the boxes cache.
+ *
+ * \param[in] link  The link that was modified.
+ * \param[in] created  Whether the link was created.
+ */
+void layout::on_modified_link(links::link_info const & link, bool const created)
+{
+    snapdev::NOT_USED(link, created);
+
+    reset_boxes_cache();
+}
+
+
 bool layout::on_improve_signature(QString const & path, QDomDocument doc, QDomElement & signature_tag)
 {
     snapdev::NOT_USED(path, signature_tag);
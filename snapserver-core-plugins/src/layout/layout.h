@@ -31,6 +31,8 @@ enum class name_t
     SNAP_NAME_LAYOUT_BODY_XSL,
     SNAP_NAME_LAYOUT_BOX,
     SNAP_NAME_LAYOUT_BOXES,
+    SNAP_NAME_LAYOUT_BOXES_LAST_UPDATED,
+    SNAP_NAME_LAYOUT_CACHE_BOX,
     SNAP_NAME_LAYOUT_CONTENT_XML,
     SNAP_NAME_LAYOUT_LAYOUT,
     SNAP_NAME_LAYOUT_LAYOUTS_PATH,
@@ -92,6 +94,10 @@ public:
 
     // content signals
     void                on_copy_branch_cells(libdbproxy::cells & source_cells, libdbproxy::row::pointer_t destination_row, snap_version::version_number_t const destination_branch);
+    void                on_modified_content(content::path_info_t & ipath);
+
+    // links signals
+    void                on_modified_link(links::link_info const & link, bool const created);
 
     QString             get_layout(content::path_info_t & ipath, const QString & column_name, bool use_qs_theme);
     QDomDocument        create_document(content::path_info_t & ipath, plugin * content_plugin);
@@ -103,11 +109,13 @@ public:
     void                replace_includes(QString & xsl);
     //void                add_layout_from_resources(QString const & name);
     void                extract_js_and_css(QDomDocument & doc, QDomDocument & doc_output);
+    void                reset_boxes_cache();
 
     SNAP_SIGNAL(generate_header_content, (content::path_info_t & ipath, QDomElement & header, QDomElement & metadata), (ipath, header, metadata));
     SNAP_SIGNAL_WITH_MODE(add_layout_from_resources, (QString const & name), (name), START_AND_DONE);
     SNAP_SIGNAL_WITH_MODE(generate_page_content, (content::path_info_t & ipath, QDomElement & page, QDomElement & body), (ipath, page, body), NEITHER);
     SNAP_SIGNAL_WITH_MODE(filtered_content, (content::path_info_t & ipath, QDomDocument & doc, QString const & xsl), (ipath, doc, xsl), NEITHER);
+    SNAP_SIGNAL_WITH_MODE(box_cache_key, (content::path_info_t & ipath, QString & key), (ipath, key), NEITHER);
 
 private:
     void                content_update(int64_t variables_timestamp);
@@ -116,10 +124,12 @@ private:
     void                finish_install_layout();
 
     void                generate_boxes(content::path_info_t & ipath, QString const & layout_name, QDomDocument doc);
+    void                generate_box_content(layout_boxes * lb, content::path_info_t & page_ipath, content::path_info_t & box_ipath, QDomElement & page, QDomElement & filter_box);
 
     snap_child *                    f_snap = nullptr;
     libdbproxy::table::pointer_t    f_content_table = libdbproxy::table::pointer_t();
     std::vector<QString>            f_initialized_layout = std::vector<QString>();
+    int64_t                         f_boxes_cache_reset = 0;
 };
 
 
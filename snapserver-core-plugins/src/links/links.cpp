@@ -30,6 +30,11 @@
 #include    "../content/content.h"
 
 
+// snapwebsites
+//
+#include    <snapwebsites/db_prefetch.h>
+
+
 // snaplogger
 //
 #include    <snaplogger/message.h>
@@ -1782,87 +1787,68 @@ link_info_pair::vector_t links::list_of_links(QString const & path)
     content::content * content_plugin(content::content::instance());
     libdbproxy::table::pointer_t branch_table(content_plugin->get_branch_table());
 
-    libdbproxy::row::pointer_t row(branch_table->getRow(ipath.get_branch_key()));
-    row->clearCache();
+    QString const branch_key(ipath.get_branch_key());
+    branch_table->getRow(branch_key)->clearCache();
 
     QString const links_namespace_start(QString("%1::").arg(get_name(name_t::SNAP_NAME_LINKS_NAMESPACE)));
-    QString const links_namespace_end(QString("%1:;").arg(get_name(name_t::SNAP_NAME_LINKS_NAMESPACE)));
     int const start_pos(links_namespace_start.length());
 
-    auto column_predicate = std::make_shared<libdbproxy::cell_range_predicate>();
-    column_predicate->setCount(100);
-    column_predicate->setIndex(); // behave like an index
-    column_predicate->setStartCellKey(links_namespace_start); // limit the loading to links at least
-    column_predicate->setEndCellKey(links_namespace_end);
-
-    // loop until all cells are handled
+    // read all the links of that branch; the prefetch reads them by
+    // pages of many cells and avoids the last empty read when the
+    // last page is not full
     //
-    for(;;)
+    db_prefetch prefetch;
+    prefetch.add_prefix(branch_table, branch_key, links_namespace_start);
+    prefetch.execute();
+
+    for(auto const & c : prefetch.get_values(branch_table, branch_key))
     {
-        row->readCells(column_predicate);
-        libdbproxy::cells const cells(row->getCells());
-        if(cells.isEmpty())
+        link_info src;
+        src.set_key(ipath.get_key());
+        src.set_branch(ipath.get_branch());
+
+        QString const & cell_name(c.first);
+        int const hash(cell_name.indexOf('#'));
+        if(hash == -1)
         {
-            // no more cells
-            //
-            break;
+            throw links_exception_invalid_name("cell name includes no '#' which is not valid for a link");
         }
-
-        // handle one batch
-        //
-        for(libdbproxy::cells::const_iterator c(cells.begin());
-                c != cells.end();
-                ++c)
+        int pos(hash);
+        int const dash(cell_name.indexOf('-'));
+        if(dash != -1)
         {
-            libdbproxy::cell::pointer_t cell(*c);
+            pos = dash;
+        }
+        QString const link_name(cell_name.mid(start_pos, pos - start_pos));
+        src.set_name(link_name, dash == -1); // if dash == -1 then link_name is a unique name
 
-            link_info src;
-            src.set_key(ipath.get_key());
-            src.set_branch(ipath.get_branch());
+        // the multiple link number cannot be saved in the link_info
+        // at this point... so we ignore it. For what we need links
+        // for, it is fine.
+        //if(dash != -1)
+        //{
+        //    QString const unique_number(cell_name.mid(dash + 1, hash - dash - 1));
+        //    ... // nothing we can do with this one for now
+        //}
 
-            QString const cell_name(cell->columnName());
-            int const hash(cell_name.indexOf('#'));
-            if(hash == -1)
-            {
-                throw links_exception_invalid_name("cell name includes no '#' which is not valid for a link");
-            }
-            int pos(hash);
-            int const dash(cell_name.indexOf('-'));
-            if(dash != -1)
-            {
-                pos = dash;
-            }
-            QString const link_name(cell_name.mid(start_pos, pos - start_pos));
-            src.set_name(link_name, dash == -1); // if dash == -1 then link_name is a unique name
-
-            // the multiple link number cannot be saved in the link_info
-            // at this point... so we ignore it. For what we need links
-            // for, it is fine.
-            //if(dash != -1)
-            //{
-            //    QString const unique_number(cell_name.mid(dash + 1, hash - dash - 1));
-            //    ... // nothing we can do with this one for now
-            //}
-
-            // THE FOLLOWING IS INCORRECT, the branch in the name is used
-            // to create a unique name per branch of the DESTINATION so there
-            // is a repeat (since the value of that link also includes that
-            // branch number) but that doesn't change the fact that we have
-            // to use the branch from the ipath (done above) and not from
-            // the cell name as we're trying to do here
-            //
-            // the branch is defined after the '#'
-            //QString const branch_number(cell_name.mid(hash + 1));
-            //src.set_branch(branch_number.toLong());
+        // THE FOLLOWING IS INCORRECT, the branch in the name is used
+        // to create a unique name per branch of the DESTINATION so there
+        // is a repeat (since the value of that link also includes that
+        // branch number) but that doesn't change the fact that we have
+        // to use the branch from the ipath (done above) and not from
+        // the cell name as we're trying to do here
+        //
+        // the branch is defined after the '#'
+        //QString const branch_number(cell_name.mid(hash + 1));
+        //src.set_branch(branch_number.toLong());
 
-            // this one we have all the data in the cell's value
-            //
-            link_info dst;
-            dst.from_data(cell->getValue().stringValue());
+        // this one we have all the data in the cell's value
+        //
+        link_info dst;
+        dst.from_data(c.second.stringValue());
 
-            link_info_pair pair(src, dst);
-            results.push_back(pair);
-        }
+        link_info_pair pair(src, dst);
+        results.push_back(pair);
     }
 
     return results;
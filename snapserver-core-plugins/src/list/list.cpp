@@ -31,6 +31,7 @@
 
 // snapwebsites
 //
+#include    <snapwebsites/db_prefetch.h>
 #include    <snapwebsites/dbutils.h>
 #include    <snapwebsites/qdomhelpers.h>
 #include    <snapwebsites/snap_backend.h>
@@ -65,6 +66,7 @@
 // C++
 //
 #include    <iostream>
+#include    <vector>
 
 
 // C
@@ -72,6 +74,7 @@
 #include    <sys/file.h>
 #include    <sys/stat.h>
 #include    <sys/time.h>
+#include    <sys/wait.h>
 
 
 // last include
@@ -278,6 +281,28 @@ int g_unique_service = 0;
 int g_unique_id = 0;
 
 
+/** \brief Convert a list of strings to a set.
+ *
+ * QStringList::toSet() is deprecated in newer versions of Qt and the
+ * QSet range constructor does not exist in older versions, so we
+ * build the set explicitly.
+ *
+ * \param[in] list  The list of strings to convert.
+ *
+ * \return A set with the strings of \p list.
+ */
+QSet<QString> to_set(snap_string_list const & list)
+{
+    QSet<QString> result;
+    result.reserve(list.size());
+    for(auto const & s : list)
+    {
+        result.insert(s);
+    }
+    return result;
+}
+
+
 }
 // no name namespace
 
@@ -3413,6 +3438,93 @@ int list::generate_all_lists(QString const & site_key)
         };
     int64_t const loop_timeout(get_timeout("list::looptimeout", 60LL * 1000000LL));
 
+    // the number of worker processes used to check the pages against
+    // the lists; with 1 (the default) the pages are checked serially
+    // by this process
+    //
+    int workers(1);
+    {
+        QString const workers_str(f_snap->get_server_parameter("list::workers"));
+        if(!workers_str.isEmpty())
+        {
+            bool ok(false);
+            workers = workers_str.toInt(&ok, 10);
+            if(!ok || workers < 1 || workers > LIST_MAXIMUM_WORKERS)
+            {
+                SNAP_LOG_WARNING("invalid number of list workers \"")(workers_str)("\", using 1 instead.");
+                workers = 1;
+            }
+        }
+    }
+
+    // function to delete the journal entries once we are done with them
+    //
+    auto delete_entry = [&](QVariant const & id)
+        {
+            qdelete.bindValue(":id", id);
+            if(!qdelete.exec())
+            {
+                // the query failed
+                // (is this a fatal error?)
+                //
+                SNAP_LOG_WARNING("Delete of entry ")
+                                (id.toString())
+                                (" failed. lastError=[")
+                                (qdelete.lastError().text())
+                                ("], lastQuery=[")
+                                (qdelete.lastQuery())
+                                ("]");
+            }
+        };
+
+    // function to process a batch of entries with the workers
+    //
+    journal_entry_vector_t batch;
+    auto handle_batch = [&]()
+        {
+            if(batch.empty())
+            {
+                return;
+            }
+
+            int const did_work_on_batch(generate_all_lists_with_workers(site_key, batch, workers));
+            if(did_work_on_batch < 0)
+            {
+                // one of the workers failed, release the entries so
+                // they get processed again on our next run
+                //
+                QSqlQuery qrelease;
+                qrelease.prepare(
+                        "UPDATE snaplist.journal"
+                            " SET status = NULL"
+                            " WHERE id = :id"
+                    );
+                for(auto const & e : batch)
+                {
+                    qrelease.bindValue(":id", e.f_id);
+                    if(!qrelease.exec())
+                    {
+                        SNAP_LOG_WARNING("Release of entry ")
+                                        (e.f_id.toString())
+                                        (" failed. lastError=[")
+                                        (qrelease.lastError().text())
+                                        ("]");
+                    }
+                }
+            }
+            else
+            {
+                did_work |= did_work_on_batch;
+                for(auto const & e : batch)
+                {
+                    delete_entry(e.f_id);
+                }
+            }
+            did_work |= 1;
+
+            batch.clear();
+        };
+
     // function to handle a row, whether it is a high priority or not
     //
     auto handle_rows = [&](QString const & query_string)
@@ -3493,39 +3605,44 @@ int list::generate_all_lists(QString const & site_key)
                                     ("]");
                 }
 
-                // THIS IS THE CALL THAT DOES THE WORK IN THIS LOOP
-                //
-                // check that specific "row_key" against the lists
-                //
-                did_work |= generate_all_lists_for_page(site_key, row_key, update_request_time);
-
-                // we handled that page for all the lists that we have on
-                // this website, so delete it now
-                //
-                qdelete.bindValue(":id", id);
-                if(!qdelete.exec())
+                if(workers > 1)
                 {
-                    // the query failed
-                    // (is this a fatal error?)
+                    // the workers check the pages in batches, each worker
+                    // taking care of a subset of the lists
                     //
-                    SNAP_LOG_WARNING("Delete of entry ")
-                                    (id.toString())
-                                    (" failed. lastError=[")
-                                    (qdelete.lastError().text())
-                                    ("], lastQuery=[")
-                                    (qdelete.lastQuery())
-                                    ("]");
+                    batch.push_back(journal_entry_t{id, row_key, update_request_time});
+                    if(batch.size() >= static_cast<size_t>(workers * LIST_WORKER_BATCH_SIZE))
+                    {
+                        handle_batch();
+                    }
                 }
+                else
+                {
+                    // THIS IS THE CALL THAT DOES THE WORK IN THIS LOOP
+                    //
+                    // check that specific "row_key" against the lists
+                    //
+                    did_work |= generate_all_lists_for_page(site_key, row_key, update_request_time);
 
-                did_work |= 1; // since we delete an entry, we did something and we have to return did_work != 0
+                    // we handled that page for all the lists that we have on
+                    // this website, so delete it now
+                    //
+                    delete_entry(id);
+
+                    did_work |= 1; // since we delete an entry, we did something and we have to return did_work != 0
+                }
 
                 SNAP_LOG_TRACE("list is done working on this column.");
 
                 // were we asked to stop?
                 // (i.e. snap_backend received a Ctrl-C)
                 //
+                // the entries of a partial batch were already marked as
+                // being worked on so we process them before returning
+                //
                 if(f_backend->stop_received())
                 {
+                    handle_batch();
                     return;
                 }
 
@@ -3534,9 +3651,14 @@ int list::generate_all_lists(QString const & site_key)
                 int64_t const loop_time_spent(f_snap->get_current_date() - loop_start_time);
                 if(loop_time_spent > loop_timeout)
                 {
+                    handle_batch();
                     return;
                 }
             }
+
+            // work on the last entries
+            //
+            handle_batch();
         };
 
     // although we could limit the query so it only returns entries that
@@ -3621,11 +3743,25 @@ int list::generate_all_lists(QString const & site_key)
     // clear our cache
     f_check_expressions.clear();
     f_item_key_expressions.clear();
+    f_list_index = list_index_t();
 
     return did_work;
 }
 
 
+/** \brief Check a page against the lists it may belong to.
+ *
+ * This function re-evaluates the test script of each list which can be
+ * affected by a change to \p page_key. The lists are found using the
+ * reverse index of the list selectors (see get_affected_lists()) so
+ * lists whose selector cannot match this page are not checked.
+ *
+ * \param[in] site_key  The site we are working on.
+ * \param[in] page_key  The key of the page that was modified.
+ * \param[in] update_request_time  The time when the last change was registered.
+ *
+ * \return 1 if any list was modified, 0 otherwise.
+ */
 int list::generate_all_lists_for_page(QString const & site_key, QString const & page_key, int64_t update_request_time)
 {
     content::path_info_t page_ipath;
@@ -3633,8 +3769,88 @@ int list::generate_all_lists_for_page(QString const & site_key, QString const &
 
     int did_work(0);
 
-    // go through all the lists that exist in this database
+    // Entries are defined with the following:
+    //
+    // name_t::SNAP_NAME_LIST_ITEM_KEY_SCRIPT
+    //    The script used to generate the item key used to sort items
+    //    of the list.
+    //
+    // name_t::SNAP_NAME_LIST_KEY
+    //    list::key::<list key>
+    //
+    //    The <list key> part is the the ipath.get_key() from the
+    //    list page. This way we can find the lists this item is a
+    //    part of.
+    //
+    // name_t::SNAP_NAME_LIST_ORDERED_PAGES
+    //    list::ordered_pages::<item key>
+    //
+    //    The <item key> part is defined using the
+    //    name_t::SNAP_NAME_LIST_ITEM_KEY_SCRIPT script. If not yet defined, use
+    //    name_t::SNAP_NAME_LIST_ORIGINAL_ITEM_KEY_SCRIPT to create the compiled
+    //    script. Note that this script may change under our feet so that
+    //    means we'd lose access to the reference. For this reason, the
+    //    reference is saved in the item under "list::key::<list key>".
+    //
+    // name_t::SNAP_NAME_LIST_ORIGINAL_ITEM_KEY_SCRIPT
+    //    This cell includes the original script used to compute the
+    //    item key. This script is compiled from the script in the
+    //    name_t::SNAP_NAME_LIST_ITEM_KEY_SCRIPT.
     //
+    // name_t::SNAP_NAME_LIST_TYPE
+    //    The list type, used for the standard link of a list page to
+    //    the list content type.
+    //
+    QSet<QString> const affected_lists(get_affected_lists(site_key, page_ipath));
+    for(auto const & key : affected_lists)
+    {
+        content::path_info_t list_ipath;
+        list_ipath.set_path(key);
+//SNAP_LOG_WARNING("generate list \"")(list_ipath.get_key())("\" for page \"")(page_ipath.get_key());
+        auto const child_info(f_list_index.f_list_links.find(key));
+        int const did_work_on_list(generate_list_for_page(
+                      page_ipath
+                    , list_ipath
+                    , update_request_time
+                    , child_info == f_list_index.f_list_links.end() ? nullptr : &child_info.value()));
+        if(did_work_on_list != 0)
+        {
+            did_work |= did_work_on_list;
+
+            list_modified(list_ipath);
+        }
+    }
+
+    return did_work;
+}
+
+
+/** \brief Build the reverse index of the list selectors.
+ *
+ * Each list defines a selector (see generate_new_lists()) which limits
+ * the pages it can include: the children of a page, pages of a given
+ * type, etc. This function reads the selector of all the lists of the
+ * website and saves the list keys in maps indexed by the page attribute
+ * they depend on. This way, when a page changes, we only have to check
+ * the lists that can include it.
+ *
+ * The link to each list is also kept so generate_list_for_page() can
+ * remove it if the list turns out to be invalid.
+ *
+ * The index is kept until the end of generate_all_lists().
+ *
+ * \param[in] site_key  The site we are working on.
+ */
+void list::load_list_index(QString const & site_key)
+{
+    if(f_list_index.f_loaded)
+    {
+        return;
+    }
+
+    content::content * content_plugin(content::content::instance());
+    libdbproxy::table::pointer_t branch_table(content_plugin->get_branch_table());
+
     content::path_info_t ipath;
     ipath.set_path(site_key + get_name(name_t::SNAP_NAME_LIST_TAXONOMY_PATH));
     links::link_info info(get_name(name_t::SNAP_NAME_LIST_TYPE), false, ipath.get_key(), ipath.get_branch());
@@ -3642,47 +3858,348 @@ int list::generate_all_lists_for_page(QString const & site_key, QString const &
     links::link_info child_info;
     while(link_ctxt->next_link(child_info))
     {
-        // Entries are defined with the following:
-        //
-        // name_t::SNAP_NAME_LIST_ITEM_KEY_SCRIPT
-        //    The script used to generate the item key used to sort items
-        //    of the list.
-        //
-        // name_t::SNAP_NAME_LIST_KEY
-        //    list::key::<list key>
-        //
-        //    The <list key> part is the the ipath.get_key() from the
-        //    list page. This way we can find the lists this item is a
-        //    part of.
-        //
-        // name_t::SNAP_NAME_LIST_ORDERED_PAGES
-        //    list::ordered_pages::<item key>
-        //
-        //    The <item key> part is defined using the
-        //    name_t::SNAP_NAME_LIST_ITEM_KEY_SCRIPT script. If not yet defined, use
-        //    name_t::SNAP_NAME_LIST_ORIGINAL_ITEM_KEY_SCRIPT to create the compiled
-        //    script. Note that this script may change under our feet so that
-        //    means we'd lose access to the reference. For this reason, the
-        //    reference is saved in the item under "list::key::<list key>".
-        //
-        // name_t::SNAP_NAME_LIST_ORIGINAL_ITEM_KEY_SCRIPT
-        //    This cell includes the original script used to compute the
-        //    item key. This script is compiled from the script in the
-        //    name_t::SNAP_NAME_LIST_ITEM_KEY_SCRIPT.
-        //
-        // name_t::SNAP_NAME_LIST_TYPE
-        //    The list type, used for the standard link of a list page to
-        //    the list content type.
-        //
-
         QString const key(child_info.key());
+        f_list_index.f_all_lists << key;
+        f_list_index.f_list_links[key] = child_info;
+
+        QString selector;
+        try
+        {
+            content::path_info_t list_ipath;
+            list_ipath.set_path(key);
+            selector = branch_table->getRow(list_ipath.get_branch_key())->getCell(get_name(name_t::SNAP_NAME_LIST_SELECTOR))->getValue().stringValue();
+        }
+        catch(content::content_exception_data_missing const &)
+        {
+            // invalid link, generate_new_lists() removes those; here
+            // we let the list be checked against all pages so
+            // generate_list_for_page() can report the problem
+        }
+        add_list_to_index(site_key, key, selector);
+    }
+
+    f_list_index.f_loaded = true;
+}
+
+
+/** \brief Add one list to the reverse index.
+ *
+ * The selectors are the same as the ones supported by generate_new_lists().
+ * Lists with the "all" selector, no selector, or an unknown selector are
+ * checked against all the pages.
+ *
+ * \param[in] site_key  The site we are working on.
+ * \param[in] list_key  The key of the list.
+ * \param[in] selector  The selector of the list.
+ */
+void list::add_list_to_index(QString const & site_key, QString const & list_key, QString const & selector)
+{
+    auto path_key = [](QString const & path)
+        {
+            content::path_info_t root_ipath;
+            root_ipath.set_path(path);
+            return root_ipath.get_key();
+        };
+
+    if(selector == "children")
+    {
+        f_list_index.f_lists_by_parent[list_key] << list_key;
+    }
+    else if(selector.startsWith("children="))
+    {
+        f_list_index.f_lists_by_parent[path_key(selector.mid(9))] << list_key;
+    }
+    else if(selector == "descendants")
+    {
+        f_list_index.f_lists_by_ancestor[list_key] << list_key;
+    }
+    else if(selector.startsWith("descendants="))
+    {
+        f_list_index.f_lists_by_ancestor[path_key(selector.mid(12))] << list_key;
+    }
+    else if(selector == "public")
+    {
+        f_list_index.f_lists_by_type[site_key + "types/taxonomy/system/content-types/page/public"] << list_key;
+    }
+    else if(selector.startsWith("type="))
+    {
+        f_list_index.f_lists_by_type[site_key + selector.mid(5)] << list_key;
+    }
+    else if(selector.startsWith("hand-picked="))
+    {
+        snap_string_list const pages(selector.mid(12).split("\n", QString::SkipEmptyParts));
+        for(auto const & path : pages)
+        {
+            f_list_index.f_lists_by_page[path_key(path)] << list_key;
+        }
+    }
+    else
+    {
+        f_list_index.f_any_page_lists << list_key;
+    }
+}
+
+
+/** \brief Determine the lists which may be affected by a page change.
+ *
+ * The function returns the lists whose selector matches the page
+ * (see load_list_index()) and the lists which currently include the
+ * page, since a page which does not match a selector anymore must be
+ * removed from that list.
+ *
+ * If the page does not exist (anymore), we cannot know its attributes
+ * so all the lists are returned.
+ *
+ * \param[in] site_key  The site we are working on.
+ * \param[in,out] page_ipath  The page that was modified.
+ *
+ * \return The set of keys of the lists to check against that page.
+ */
+QSet<QString> list::get_affected_lists(QString const & site_key, content::path_info_t & page_ipath)
+{
+    load_list_index(site_key);
+
+    QSet<QString> result(to_set(f_list_index.f_any_page_lists));
+
+    content::content * content_plugin(content::content::instance());
+    libdbproxy::table::pointer_t content_table(content_plugin->get_content_table());
+    libdbproxy::table::pointer_t branch_table(content_plugin->get_branch_table());
+    try
+    {
+        if(!content_table->exists(page_ipath.get_key())
+        || !branch_table->exists(page_ipath.get_branch_key()))
+        {
+            return to_set(f_list_index.f_all_lists);
+        }
+    }
+    catch(content::content_exception_data_missing const &)
+    {
+        return to_set(f_list_index.f_all_lists);
+    }
+
+    auto add_lists = [&result](QMap<QString, snap_string_list> const & index, QString const & key)
+        {
+            auto const it(index.find(key));
+            if(it != index.end())
+            {
+                result.unite(to_set(it.value()));
+            }
+        };
+
+    // hand-picked
+    //
+    add_lists(f_list_index.f_lists_by_page, page_ipath.get_key());
+
+    // children and descendants
+    //
+    // (keys are the site key followed by the cpath)
+    //
+    QString cpath(page_ipath.get_cpath());
+    bool direct_parent(true);
+    while(!cpath.isEmpty())
+    {
+        int const pos(cpath.lastIndexOf('/'));
+        cpath = pos <= 0 ? QString() : cpath.left(pos);
+        QString const parent_key(site_key + cpath);
+        if(direct_parent)
+        {
+            add_lists(f_list_index.f_lists_by_parent, parent_key);
+            direct_parent = false;
+        }
+        add_lists(f_list_index.f_lists_by_ancestor, parent_key);
+    }
+
+    // type and public
+    //
+    if(!f_list_index.f_lists_by_type.isEmpty())
+    {
+        links::link_info info(content::get_name(content::name_t::SNAP_NAME_CONTENT_PAGE_TYPE), true, page_ipath.get_key(), page_ipath.get_branch());
+        QSharedPointer<links::link_context> link_ctxt(links::links::instance()->new_link_context(info));
+        links::link_info type_info;
+        if(link_ctxt->next_link(type_info)) // use if() since it is unique on this end
+        {
+            add_lists(f_list_index.f_lists_by_type, type_info.key());
+        }
+    }
+
+    // lists which currently include this page (so it gets removed if
+    // it does not match anymore)
+    //
+    QString const list_key_prefix(QString("%1::").arg(get_name(name_t::SNAP_NAME_LIST_KEY)));
+    db_prefetch prefetch;
+    prefetch.add_prefix(branch_table, page_ipath.get_branch_key(), list_key_prefix);
+    prefetch.execute();
+    db_prefetch::cell_values_t const & values(prefetch.get_values(branch_table, page_ipath.get_branch_key()));
+    for(auto const & v : values)
+    {
+        result.insert(v.first.mid(list_key_prefix.length()));
+    }
+
+    return result;
+}
+
+
+/** \brief Check a batch of pages against all the lists using workers.
+ *
+ * On large websites, checking each page against each list one after the
+ * other does not keep up with bursts of edits. This function splits the
+ * work between \p workers processes. The lists are partitioned between
+ * the workers so each list is only ever modified by one worker. Each
+ * worker checks all the pages of the batch against its own lists.
+ *
+ * Each worker also holds a snap_lock on the list it is working on so
+ * another backend working on the same website cannot update that list
+ * simultaneously.
+ *
+ * If a worker cannot be created, its lists are processed by this
+ * process instead.
+ *
+ * \param[in] site_key  The site we are working on.
+ * \param[in] entries  The journal entries to check.
+ * \param[in] workers  The maximum number of workers to create.
+ *
+ * \return 1 if any list was modified, 0 if none, and -1 if a worker
+ *         failed in which case the entries need to be processed again.
+ */
+int list::generate_all_lists_with_workers(QString const & site_key, journal_entry_vector_t const & entries, int workers)
+{
+    // get the list of lists once, the workers inherit it
+    //
+    std::vector<QString> list_keys;
+    {
+        content::path_info_t ipath;
+        ipath.set_path(site_key + get_name(name_t::SNAP_NAME_LIST_TAXONOMY_PATH));
+        links::link_info info(get_name(name_t::SNAP_NAME_LIST_TYPE), false, ipath.get_key(), ipath.get_branch());
+        QSharedPointer<links::link_context> link_ctxt(links::links::instance()->new_link_context(info));
+        links::link_info child_info;
+        while(link_ctxt->next_link(child_info))
+        {
+            list_keys.push_back(child_info.key());
+        }
+    }
+    if(list_keys.empty())
+    {
+        return 0;
+    }
+    workers = std::min(workers, static_cast<int>(list_keys.size()));
+
+    // determine which lists each page can affect before we create the
+    // workers so they all share that information
+    //
+    std::vector<QSet<QString>> affected_lists;
+    affected_lists.reserve(entries.size());
+    for(auto const & e : entries)
+    {
+        content::path_info_t page_ipath;
+        page_ipath.set_path(e.f_uri);
+        affected_lists.push_back(get_affected_lists(site_key, page_ipath));
+    }
+
+    int did_work(0);
+    std::vector<pid_t> pids;
+    for(int w(0); w < workers; ++w)
+    {
+        pid_t const p(f_backend->fork_worker());
+        if(p == 0)
+        {
+            // worker process
+            //
+            int exit_code(2);
+            try
+            {
+                exit_code = generate_lists_for_worker(list_keys, affected_lists, entries, w, workers) != 0 ? 1 : 0;
+            }
+            catch(std::exception const & e)
+            {
+                SNAP_LOG_ERROR("list worker ")(w)(" failed: ")(e.what());
+            }
+            snap_backend::exit_worker(exit_code);
+        }
+        if(p == -1)
+        {
+            int const e(errno);
+            SNAP_LOG_WARNING("could not create list worker ")
+                            (w)
+                            (" (errno: ")
+                            (e)
+                            (" -- ")
+                            (strerror(e))
+                            ("), working on its lists directly.");
+            did_work |= generate_lists_for_worker(list_keys, affected_lists, entries, w, workers);
+            continue;
+        }
+        pids.push_back(p);
+    }
+
+    bool failed(false);
+    for(auto const p : pids)
+    {
+        int status(0);
+        if(waitpid(p, &status, 0) != p
+        || !WIFEXITED(status)
+        || WEXITSTATUS(status) > 1)
+        {
+            SNAP_LOG_ERROR("list worker process ")(p)(" failed.");
+            failed = true;
+        }
+        else
+        {
+            did_work |= WEXITSTATUS(status);
+        }
+    }
+
+    return failed ? -1 : did_work;
+}
+
+
+/** \brief Check the pages of a batch against the lists of one worker.
+ *
+ * The worker number \p worker handles the lists found at positions
+ * \p worker, \p worker + \p workers, \p worker + 2 x \p workers, etc.
+ *
+ * Pages are only checked against the lists they can affect.
+ *
+ * \param[in] list_keys  The keys of all the lists of the website.
+ * \param[in] affected_lists  The lists affected by each entry.
+ * \param[in] entries  The journal entries to check.
+ * \param[in] worker  The number of this worker.
+ * \param[in] workers  The total number of workers.
+ *
+ * \return 1 if any list was modified, 0 otherwise.
+ */
+int list::generate_lists_for_worker(std::vector<QString> const & list_keys, std::vector<QSet<QString>> const & affected_lists, journal_entry_vector_t const & entries, int worker, int workers)
+{
+    int did_work(0);
+
+    for(size_t idx(worker); idx < list_keys.size(); idx += workers)
+    {
         content::path_info_t list_ipath;
-        list_ipath.set_path(key);
-//SNAP_LOG_WARNING("generate list \"")(list_ipath.get_key())("\" for page \"")(page_ipath.get_key());
-        int const did_work_on_list(generate_list_for_page(page_ipath, list_ipath, update_request_time, &child_info));
+        list_ipath.set_path(list_keys[idx]);
+        auto const child_info(f_list_index.f_list_links.find(list_keys[idx]));
+
+        // the lock duration needs to be long enough to check all the
+        // pages of the batch against this list
+        //
+        snap_lock lock(QString("%1#list").arg(list_ipath.get_key()).toUtf8().data(), 60 * 60);
+
+        int did_work_on_list(0);
+        for(size_t e(0); e < entries.size(); ++e)
+        {
+            if(!affected_lists[e].contains(list_keys[idx]))
+            {
+                continue;
+            }
+            content::path_info_t page_ipath;
+            page_ipath.set_path(entries[e].f_uri);
+            did_work_on_list |= generate_list_for_page(
+                      page_ipath
+                    , list_ipath
+                    , entries[e].f_update_request_time
+                    , child_info == f_list_index.f_list_links.end() ? nullptr : &child_info.value());
+        }
         if(did_work_on_list != 0)
         {
-            did_work |= did_work_on_list;
+            did_work = 1;
 
             list_modified(list_ipath);
         }
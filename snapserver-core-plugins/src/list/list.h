@@ -175,6 +175,8 @@ class list
 public:
     static int const LIST_PROCESSING_LATENCY = 10 * 1000000; // 10 seconds in micro-seconds
     static int const LIST_MAXIMUM_ITEMS = 10000; // maximum number of items returned by read_list()
+    static int const LIST_MAXIMUM_WORKERS = 64; // maximum number of list::workers
+    static int const LIST_WORKER_BATCH_SIZE = 100; // number of journal entries per worker in one batch
 
     typedef int64_t             timeout_t;
 
@@ -287,10 +289,36 @@ public:
     //SNAP_TEST_PLUGIN_SUITE_SIGNALS()
 
 private:
+    struct journal_entry_t
+    {
+        QVariant            f_id = QVariant();
+        QString             f_uri = QString();
+        int64_t             f_update_request_time = 0;
+    };
+    typedef std::vector<journal_entry_t>    journal_entry_vector_t;
+
+    // reverse index of the list selectors: page attribute -> list keys
+    struct list_index_t
+    {
+        bool                            f_loaded = false;
+        snap_string_list                f_all_lists = snap_string_list();
+        QMap<QString, links::link_info> f_list_links = QMap<QString, links::link_info>();
+        snap_string_list                f_any_page_lists = snap_string_list();
+        QMap<QString, snap_string_list> f_lists_by_type = QMap<QString, snap_string_list>();
+        QMap<QString, snap_string_list> f_lists_by_parent = QMap<QString, snap_string_list>();
+        QMap<QString, snap_string_list> f_lists_by_ancestor = QMap<QString, snap_string_list>();
+        QMap<QString, snap_string_list> f_lists_by_page = QMap<QString, snap_string_list>();
+    };
+
     void                content_update(int64_t variables_timestamp);
     void                add_all_pages_to_list_table(QString const & f);
     int                 generate_all_lists(QString const & site_key);
     int                 generate_all_lists_for_page(QString const & site_key, QString const & row_key, int64_t update_request_time);
+    int                 generate_all_lists_with_workers(QString const & site_key, journal_entry_vector_t const & entries, int workers);
+    int                 generate_lists_for_worker(std::vector<QString> const & list_keys, std::vector<QSet<QString>> const & affected_lists, journal_entry_vector_t const & entries, int worker, int workers);
+    void                load_list_index(QString const & site_key);
+    void                add_list_to_index(QString const & site_key, QString const & list_key, QString const & selector);
+    QSet<QString>       get_affected_lists(QString const & site_key, content::path_info_t & page_ipath);
     int                 generate_new_lists(QString const & site_key);
     int                 generate_new_list_for_all_pages(QString const & site_key, content::path_info_t & list_ipath);
     int                 generate_new_list_for_descendants(QString const & site_key, content::path_info_t & list_ipath);
@@ -315,6 +343,7 @@ private:
     priority_t                              f_priority = LIST_PRIORITY_NEW_PAGE;                // specific order in which pages should be worked on
     int64_t                                 f_start_date_offset = LIST_PROCESSING_LATENCY;      // minimum amount of time to wait for the next data
     int64_t                                 f_date_limit = 0;
+    list_index_t                            f_list_index = list_index_t();
 };
 
 
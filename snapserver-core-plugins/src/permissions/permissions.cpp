@@ -54,6 +54,17 @@
 //#include    <libdbproxy/value.h>
 
 
+// Qt
+//
+#include    <QCryptographicHash>
+
+
+// C++
+//
+#include    <algorithm>
+#include    <vector>
+
+
 // OpenSSL
 //
 #include    <openssl/rand.h>
@@ -100,6 +111,88 @@ libdbproxy::table::pointer_t     g_cache_table;
 QMap<QString, bool>                         g_user_cache_reviewed;
 QMap<QString, bool>                         g_plugin_cache_reviewed;
 
+// the rights of each group flattened (i.e. including the rights of its
+// children); the key includes the action and last updated timestamp
+//
+QMap<QString, permissions::sets_t::set_t>   g_group_rights;
+
+// compiled rights: each right path gets a dense identifier so the sets
+// can be compared using bitsets; these are never invalidated since a
+// path always gets the same identifier within this process
+//
+typedef std::vector<uint64_t>               right_bits_t;
+
+QMap<QString, int>                          g_right_ids;
+QMap<QString, right_bits_t>                 g_permission_bits;
+
+
+/** \brief Get the identifier of a right.
+ *
+ * Each right path receives a small identifier the first time it is
+ * seen. The identifiers are used as bit numbers in right_bits_t.
+ *
+ * \param[in] right  The right path (ending with a slash).
+ *
+ * \return The identifier of \p right.
+ */
+int get_right_id(QString const & right)
+{
+    auto it(g_right_ids.find(right));
+    if(it != g_right_ids.end())
+    {
+        return it.value();
+    }
+    int const id(g_right_ids.size());
+    g_right_ids[right] = id;
+    return id;
+}
+
+
+/** \brief Set the bit of a right in a bitset.
+ *
+ * \param[in,out] bits  The bitset to update.
+ * \param[in] id  The identifier of the right.
+ */
+void set_right_bit(right_bits_t & bits, int id)
+{
+    size_t const word(id / 64);
+    if(word >= bits.size())
+    {
+        bits.resize(word + 1, 0);
+    }
+    bits[word] |= 1ULL << (id % 64);
+}
+
+
+/** \brief Get the bitset matching a plugin permission.
+ *
+ * A user right R gives access to a plugin permission P when P starts
+ * with R. Since all rights end with a slash, that means R is one of the
+ * prefixes of P ending with a slash. This function returns the bitset
+ * of all those prefixes so the test becomes an AND between bitsets.
+ *
+ * The result only depends on \p permission so it is computed once.
+ *
+ * \param[in] permission  The plugin permission (ending with a slash).
+ *
+ * \return The bitset of all the rights which give that permission.
+ */
+right_bits_t const & get_permission_bits(QString const & permission)
+{
+    auto it(g_permission_bits.find(permission));
+    if(it != g_permission_bits.end())
+    {
+        return it.value();
+    }
+
+    right_bits_t bits;
+    for(int pos(permission.indexOf('/')); pos != -1; pos = permission.indexOf('/', pos + 1))
+    {
+        set_right_bit(bits, get_right_id(permission.left(pos + 1)));
+    }
+    return *g_permission_bits.insert(permission, bits);
+}
+
 
 name_t login_status_from_string(QString const & status)
 {
@@ -1393,26 +1486,30 @@ for(req_sets_t::const_iterator pp(f_plugin_permissions.begin());
         return false;
     }
 
-    int const max_rights(f_user_rights.size());
+    // compile the user rights in a bitset
+    //
+    details::right_bits_t user_bits;
+    for(auto const & right : f_user_rights)
+    {
+        details::set_right_bit(user_bits, details::get_right_id(right));
+    }
+
     for(req_sets_t::const_iterator pp(f_plugin_permissions.begin());
             pp != f_plugin_permissions.end();
             ++pp)
     {
         // enough rights with this one?
-        set_t p(*pp);
-        set_t::const_iterator i;
-        for(i = p.begin(); i != p.end(); ++i)
+        //
+        // (i.e. one of the user rights is a prefix of one of the
+        // permissions of this plugin)
+        //
+        for(auto const & plugin_permission : *pp)
         {
-            // the list of plugin permissions is generally smaller so
-            // we loop through that list although this contains can be
-            // slow... we may want to change the set_t type to a QMap
-            // which uses a faster binary search; although on very small
-            // maps it may not be any faster
-            for(int j(0); j < max_rights; ++j)
+            details::right_bits_t const & bits(details::get_permission_bits(plugin_permission));
+            size_t const max_words(std::min(bits.size(), user_bits.size()));
+            for(size_t w(0); w < max_words; ++w)
             {
-                QString const & plugin_permission ( *i               );
-                QString const & user_right        ( f_user_rights[j] );
-                if( plugin_permission.startsWith(user_right) )
+                if((bits[w] & user_bits[w]) != 0)
                 {
                     //break 2;
                     goto next_plugin;
@@ -1495,6 +1592,7 @@ void permissions::bootstrap()
     SERVERPLUGINS_LISTEN(permissions, "path", path::path, check_for_redirect, boost::placeholders::_1);
     SERVERPLUGINS_LISTEN(permissions, "users", users::users, user_verified, boost::placeholders::_1, boost::placeholders::_2);
     SERVERPLUGINS_LISTEN(permissions, "layout", layout::layout, generate_header_content, boost::placeholders::_1, boost::placeholders::_2, boost::placeholders::_3);
+    SERVERPLUGINS_LISTEN(permissions, "layout", layout::layout, box_cache_key, boost::placeholders::_1, boost::placeholders::_2);
     SERVERPLUGINS_LISTEN(permissions, "links", links::links, modified_link, boost::placeholders::_1, boost::placeholders::_2);
 }
 
@@ -2584,13 +2682,89 @@ void permissions::add_user_rights(QString const & group, sets_t & sets)
     }
 
 //SNAP_LOG_DEBUG("*** add_user_rights...");
-    recursive_add_user_rights(group, sets);
+    for(auto const & right : get_group_rights(group, sets.get_action()))
+    {
+        sets.add_user_right(right);
+    }
 }
 
 
-/** \brief Recursively retrieve all the user rights.
+/** \brief Get the flattened rights of a group.
+ *
+ * Groups are pages linked to rights for each action. A group also
+ * includes the rights of all of its children. Walking that tree means
+ * reading many links so the result is saved in the cache table (under
+ * the group row) and in memory.
+ *
+ * The cached data uses the same format as the user rights cache: a
+ * 64 bit timestamp followed by lines of rights. It is ignored once
+ * older than the permissions last updated timestamp.
+ *
+ * \param[in] group  The key of the group.
+ * \param[in] action  The action for which rights are being checked.
  *
- * User rights are defined in groups and this function reads all the
+ * \return The rights of the group and all of its children.
+ */
+permissions::sets_t::set_t const & permissions::get_group_rights(QString const & group, QString const & action)
+{
+    libdbproxy::value const last_updated_value(f_snap->get_site_parameter(get_name(name_t::SNAP_NAME_PERMISSIONS_LAST_UPDATED)));
+    int64_t const last_updated(last_updated_value.safeInt64Value());
+
+    QString const memory_key(QString("%1 %2 %3").arg(group).arg(action).arg(last_updated));
+    auto it(details::g_group_rights.find(memory_key));
+    if(it != details::g_group_rights.end())
+    {
+        return it.value();
+    }
+
+    if(!details::g_cache_table)
+    {
+        details::g_cache_table = content::content::instance()->get_cache_table();
+    }
+
+    QString const cache_key(QString("%1::%2::%3::%4")
+                                .arg(get_name(name_t::SNAP_NAME_PERMISSIONS_NAMESPACE))
+                                .arg(get_name(name_t::SNAP_NAME_PERMISSIONS_GROUP_NAMESPACE))
+                                .arg(get_name(name_t::SNAP_NAME_PERMISSIONS_ACTION_NAMESPACE))
+                                .arg(action));
+
+    sets_t::set_t rights;
+    if(details::g_cache_table->exists(group)
+    && details::g_cache_table->getRow(group)->exists(cache_key))
+    {
+        libdbproxy::value const cache_value(details::g_cache_table->getRow(group)->getCell(cache_key)->getValue());
+        if(cache_value.safeInt64Value() >= last_updated)
+        {
+            QString const all_rights(cache_value.stringValue(sizeof(int64_t)));
+            int start(0);
+            int pos(all_rights.indexOf('\n'));
+            while(pos != -1)
+            {
+                rights.push_back(all_rights.mid(start, pos - start));
+                start = pos + 1;
+                pos = all_rights.indexOf('\n', start);
+            }
+            return *details::g_group_rights.insert(memory_key, rights);
+        }
+    }
+
+    recursive_collect_group_rights(group, action, rights);
+
+    QByteArray value;
+    libdbproxy::setInt64Value(value, f_snap->get_start_date());
+    for(auto const & right : rights)
+    {
+        libdbproxy::appendStringValue(value, QString("%1\n").arg(right));
+    }
+    details::g_cache_table->getRow(group)->getCell(cache_key)->setValue(value);
+
+    return *details::g_group_rights.insert(memory_key, rights);
+}
+
+
+/** \brief Recursively retrieve all the rights of a group.
+ *
+ * Rights are defined in groups and this function reads all the
  * rights defined in a group and all of its children.
  *
  * The recursivity works over the group children, and children of those
@@ -2598,19 +2772,17 @@ void permissions::add_user_rights(QString const & group, sets_t & sets)
  * limited.
  *
  * \param[in] group  The group being added (a row).
- * \param[in] sets  The sets where the different paths are being added.
+ * \param[in] action  The action for which rights are being checked.
+ * \param[in,out] rights  The vector where the rights get added.
  */
-void permissions::recursive_add_user_rights(QString const & group, sets_t & sets)
+void permissions::recursive_collect_group_rights(QString const & group, QString const & action, sets_t::set_t & rights)
 {
-//SNAP_LOG_DEBUG("*** user right key: [")(group)("]");
     libdbproxy::table::pointer_t content_table(content::content::instance()->get_content_table());
     if(!content_table->exists(group))
     {
-        throw permissions_exception_invalid_group_name("caller is trying to access group \"" + group + "\" (user)");
+        throw permissions_exception_invalid_group_name("caller is trying to access group \"" + group + "\" which does not exist");
     }
 
-    libdbproxy::row::pointer_t row(content_table->getRow(group));
-
     content::path_info_t group_ipath;
     group_ipath.set_path(group);
 
@@ -2620,15 +2792,14 @@ void permissions::recursive_add_user_rights(QString const & group, sets_t & sets
                         QString("%1::%2::%3")
                             .arg(get_name(name_t::SNAP_NAME_PERMISSIONS_NAMESPACE))
                             .arg(get_name(name_t::SNAP_NAME_PERMISSIONS_ACTION_NAMESPACE))
-                            .arg(sets.get_action()));
+                            .arg(action));
         links::link_info info(link_start_name, false, group_ipath.get_key(), group_ipath.get_branch());
         QSharedPointer<links::link_context> link_ctxt(links::links::instance()->new_link_context(info));
         links::link_info right_info;
         while(link_ctxt->next_link(right_info))
         {
-            // a user right is attached to this page
-            QString const right_key(right_info.key());
-            sets.add_user_right(right_key);
+            // a right is attached to this page
+            rights.push_back(right_info.key());
         }
     }
 
@@ -2637,13 +2808,10 @@ void permissions::recursive_add_user_rights(QString const & group, sets_t & sets
         QString const children_name(content::get_name(content::name_t::SNAP_NAME_CONTENT_CHILDREN));
         links::link_info info(children_name, false, group_ipath.get_key(), group_ipath.get_branch());
         QSharedPointer<links::link_context> link_ctxt(links::links::instance()->new_link_context(info));
-        links::link_info right_info;
-        while(link_ctxt->next_link(right_info))
+        links::link_info child_info;
+        while(link_ctxt->next_link(child_info))
         {
-            // a user right is attached to this page
-            const QString child_key(right_info.key());
-//SNAP_LOG_DEBUG("*** children...");
-            recursive_add_user_rights(child_key, sets);
+            recursive_collect_group_rights(child_info.key(), action, rights);
         }
     }
 }
@@ -2677,65 +2845,9 @@ void permissions::add_plugin_permissions(QString const & plugin_name, QString co
         throw snap_logic_exception("you cannot add rights using add_plugin_permissions(), for those just use sets.add_plugin_permission() directly");
     }
 
-    recursive_add_plugin_permissions(plugin_name, group, sets);
-}
-
-
-/** \brief Recursively retrieve all the user rights.
- *
- * User rights are defined in groups and this function reads all the
- * rights defined in a group and all of its children.
- *
- * The recursivity works over the group children, and children of those
- * children and so on. So the number of iteration will remain relatively
- * limited.
- *
- * \param[in] plugin_name  The name of the plugin adding these rights.
- * \param[in] group  The key of the group being added (a row).
- * \param[in] sets  The sets where the different paths are being added.
- */
-void permissions::recursive_add_plugin_permissions(QString const & plugin_name, QString const & group, sets_t & sets)
-{
-    libdbproxy::table::pointer_t content_table(content::content::instance()->get_content_table());
-    if(!content_table->exists(group))
-    {
-        throw permissions_exception_invalid_group_name("caller is trying to access group \"" + group + "\" which does not exist (recursive_add_plugin_permissions)");
-    }
-
-    content::path_info_t ipath;
-    ipath.set_path(group);
-
-    // get the rights at this level
-    {
-        // this is always an immediate action (no "direct" namespace)
-        QString const link_start_name(
-                    QString("%1::%2::%3")
-                        .arg(get_name(name_t::SNAP_NAME_PERMISSIONS_NAMESPACE))
-                        .arg(get_name(name_t::SNAP_NAME_PERMISSIONS_ACTION_NAMESPACE))
-                        .arg(sets.get_action()));
-        links::link_info info(link_start_name, false, ipath.get_key(), ipath.get_branch());
-        QSharedPointer<links::link_context> link_ctxt(links::links::instance()->new_link_context(info));
-        links::link_info right_info;
-        while(link_ctxt->next_link(right_info))
-        {
-            // an author is attached to this page
-            QString const right_key(right_info.key());
-            sets.add_plugin_permission(plugin_name, right_key);
-        }
-    }
-
-    // get all the children and do a recursive call with them all
+    for(auto const & right : get_group_rights(group, sets.get_action()))
     {
-        QString const children_name(content::get_name(content::name_t::SNAP_NAME_CONTENT_CHILDREN));
-        links::link_info info(children_name, false, ipath.get_key(), ipath.get_branch());
-        QSharedPointer<links::link_context> link_ctxt(links::links::instance()->new_link_context(info));
-        links::link_info right_info;
-        while(link_ctxt->next_link(right_info))
-        {
-            // an author is attached to this page
-            QString const child_key(right_info.key());
-            recursive_add_plugin_permissions(plugin_name, child_key, sets);
-        }
+        sets.add_plugin_permission(plugin_name, right);
     }
 }
 
@@ -3378,6 +3490,42 @@ void permissions::on_generate_header_content(content::path_info_t & ipath, QDomE
 }
 
 
+/** \brief Add the class of the current user to a box cache key.
+ *
+ * The output of a box may depend on what the current user is permitted
+ * to see. This function adds the login status and a checksum of the
+ * rights of the current user to the key used to cache the box output.
+ * That way users with the exact same rights share the same cached
+ * boxes.
+ *
+ * \param[in,out] ipath  The path to the box being cached.
+ * \param[in,out] key  The cache key to complete.
+ */
+void permissions::on_box_cache_key(content::path_info_t & ipath, QString & key)
+{
+    if(f_user_rights_class.isEmpty())
+    {
+        QString const & login_status(get_login_status());
+        sets_t sets(f_snap, get_user_path(), ipath, "view", login_status);
+        get_user_rights(this, sets);
+
+        snap_string_list rights;
+        for(auto const & r : sets.get_user_rights())
+        {
+            rights << r;
+        }
+        rights.sort();
+
+        f_user_rights_class = login_status
+                            + "::"
+                            + QString::fromLatin1(QCryptographicHash::hash(rights.join("\n").toUtf8(), QCryptographicHash::Md5).toHex());
+    }
+
+    key += "::";
+    key += f_user_rights_class;
+}
+
+
 /** \brief Whenever a permissions link changes we reset the caches.
  *
  * To make sure that the permissions caches are up to date we have
@@ -3388,6 +3536,11 @@ void permissions::on_generate_header_content(content::path_info_t & ipath, QDomE
  * call.) This means that the cache will remain invalid throughout
  * this request...
  *
+ * The flattened group rights (see get_group_rights()) also include
+ * the rights of the children of a group or right. So adding or
+ * removing a child under the groups or rights paths also resets
+ * the caches.
+ *
  * \param[in] link  The link information being modified.
  * \param[in] created  Whether this was a new link (true) or not.
  */
@@ -3397,8 +3550,26 @@ void permissions::on_modified_link(links::link_info const & link, bool const cre
 
     if(!link.name().startsWith(QString("%1::").arg(get_name(name_t::SNAP_NAME_PERMISSIONS_NAMESPACE))))
     {
-        // not a permission link, who cares
-        return;
+        if(link.name() != content::get_name(content::name_t::SNAP_NAME_CONTENT_CHILDREN))
+        {
+            // not a permission link, who cares
+            return;
+        }
+
+        // a child added to or removed from a group or a right changes
+        // the flattened rights of its ancestors
+        //
+        QString const site_key(f_snap->get_site_key_with_slash());
+        QString const groups_path(site_key + get_name(name_t::SNAP_NAME_PERMISSIONS_GROUPS_PATH));
+        QString const rights_path(site_key + get_name(name_t::SNAP_NAME_PERMISSIONS_RIGHTS_PATH));
+        QString const key(link.key());
+        if(key != groups_path
+        && !key.startsWith(groups_path + "/")
+        && key != rights_path
+        && !key.startsWith(rights_path + "/"))
+        {
+            return;
+        }
     }
 
     // a permissions link got modified, reset the timestamp date and time
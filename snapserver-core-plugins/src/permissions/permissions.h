@@ -185,6 +185,7 @@ public:
 
     // layout signals
     void                    on_generate_header_content(content::path_info_t & path, QDomElement & hader, QDomElement & metadata);
+    void                    on_box_cache_key(content::path_info_t & ipath, QString & key);
 
     // users signals
     void                    on_user_verified(content::path_info_t & ipath, int64_t identifier);
@@ -207,14 +208,15 @@ public:
 
 private:
     void                    content_update(int64_t variables_timestamp);
-    void                    recursive_add_user_rights(QString const & key, sets_t & sets);
-    void                    recursive_add_plugin_permissions(QString const & plugin_name, QString const & key, sets_t & sets);
+    sets_t::set_t const &   get_group_rights(QString const & group, QString const & action);
+    void                    recursive_collect_group_rights(QString const & group, QString const & action, sets_t::set_t & rights);
     void                    check_permissions(QString const & email, QString const & page, QString const & action, QString const & status);
 
     snap_child *                f_snap = nullptr;
     QString                     f_login_status = QString();
     bool                        f_has_user_path = false;
     QString                     f_user_path = QString();
+    QString                     f_user_rights_class = QString();
     std::map<QString, bool>     f_valid_actions = std::map<QString, bool>();
 };
 